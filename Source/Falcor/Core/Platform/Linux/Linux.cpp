@@ -26,6 +26,7 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "stdafx.h"
+#include <sys/resource.h>
 // #include "Utils/StringUtils.h"
 // #include "Utils/Platform/OS.h"
 // #include "Utils/Logger.h"
@@ -514,6 +515,23 @@ namespace Falcor
         return (uint32_t)__builtin_popcount(a);
     }
 
+    uint64_t getProcessWorkingSetSize()
+    {
+        // The second field of statm is the resident set size in pages.
+        std::ifstream statm("/proc/self/statm");
+        uint64_t size = 0, resident = 0;
+        if (!(statm >> size >> resident)) return 0;
+        return resident * (uint64_t)sysconf(_SC_PAGESIZE);
+    }
+
+    uint64_t getProcessPeakWorkingSetSize()
+    {
+        // ru_maxrss is reported in kilobytes.
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+        return (uint64_t)usage.ru_maxrss * 1024;
+    }
+
     DllHandle loadDll(const std::string& libPath)
     {
         return dlopen(libPath.c_str(), RTLD_LAZY);
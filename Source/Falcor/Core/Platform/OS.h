@@ -382,6 +382,14 @@ namespace Falcor
     */
     dlldecl uint64_t  getProcessUsedVirtualMemory();
 
+    /** Get the physical memory currently used by this process (resident set size / working set) in bytes, or 0 if it can't be queried.
+    */
+    dlldecl uint64_t getProcessWorkingSetSize();
+
+    /** Get the peak physical memory used by this process since it started in bytes, or 0 if it can't be queried.
+    */
+    dlldecl uint64_t getProcessPeakWorkingSetSize();
+
     /** Returns index of most significant set bit, or 0 if no bits were set.
     */
     dlldecl uint32_t bitScanReverse(uint32_t a);
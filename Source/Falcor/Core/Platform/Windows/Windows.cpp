@@ -692,6 +692,20 @@ namespace Falcor
         return virtualMemUsedByMe;
     }
 
+    uint64_t getProcessWorkingSetSize()
+    {
+        PROCESS_MEMORY_COUNTERS pmc;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+        return pmc.WorkingSetSize;
+    }
+
+    uint64_t getProcessPeakWorkingSetSize()
+    {
+        PROCESS_MEMORY_COUNTERS pmc;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+        return pmc.PeakWorkingSetSize;
+    }
+
     uint32_t bitScanReverse(uint32_t a)
     {
         unsigned long index;
@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "EmissivePowerSampler.h"
+#include "Utils/Sampling/AliasTable.h"
 #include <glm/gtc/constants.hpp>
 #include <glm/gtx/io.hpp>
 #include <algorithm>
@@ -71,6 +72,17 @@ namespace Falcor
         return samplerChanged;        
     }
 
+    Program::DefineList EmissivePowerSampler::getDefines() const
+    {
+        // Call the base class first.
+        auto defines = EmissiveLightSampler::getDefines();
+
+        // The table format is chosen when the table is built. Changing it requires recompiling the program.
+        defines.add("_EMISSIVE_POWER_WIDE_ALIAS_TABLE", mTriangleTable.wideIndices ? "1" : "0");
+
+        return defines;
+    }
+
     bool EmissivePowerSampler::setShaderData(const ShaderVar& var) const
     {
         assert(var.isValid());
@@ -90,93 +102,44 @@ namespace Falcor
 
     EmissivePowerSampler::AliasTable EmissivePowerSampler::generateAliasTable(std::vector<float> weights)
     {
-        uint32_t N = uint32_t(weights.size());
-        std::uniform_int_distribution<uint32_t> rngDist;
-
-        double sum = 0.0f;
-        for (float f : weights)
-        {
-            sum += f;
-        }
-        for (float& f : weights)
-        {
-            f *= N / float(sum);
-        }
-
-        std::vector<uint32_t> permutation(N);
-        for (uint32_t i = 0; i < N; ++i)
-        {
-            permutation[i] = i;
-        }
-        std::sort(permutation.begin(), permutation.end(), [&](uint32_t a, uint32_t b) { return weights[a] < weights[b]; });
-
-        std::vector<float> thresholds(N);
-        std::vector<uint32_t> redirect(N);
-        std::vector<uint2> merged(N);
-        std::vector<uint2> fullTable(N);
-
-        uint32_t head = 0;
-        uint32_t tail = N - 1;
-
-        while (head != tail)
-        {
-            int i = permutation[head];
-            int j = permutation[tail];
+        const uint64_t seed = ((uint64_t)mAliasTableRng() << 32) | mAliasTableRng();
+        return createAliasTable(weights, seed, weights.size() > kMaxPackedAliasTableEntries);
+    }
 
-            thresholds[i] = weights[i];
-            redirect[i] = j;
-            weights[j] -= 1.0f - weights[i];
+    EmissivePowerSampler::AliasTable EmissivePowerSampler::createAliasTable(const std::vector<float>& weights, uint64_t seed, bool wideIndices)
+    {
+        uint32_t N = uint32_t(weights.size());
+        if (!wideIndices && N > kMaxPackedAliasTableEntries) throw std::exception("Too many entries for packed alias table.");
 
-            if (head == tail - 1)
-            {
-                thresholds[j] = 1.0f;
-                redirect[j] = j;
-                break;
-            }
-            else if (weights[j] < 1.0f)
-            {
-                std::swap(permutation[head], permutation[tail]);
-                tail--;
-            }
-            else
-            {
-                head++;
-            }
-        }
+        double sum = 0.0;
+        std::vector<Falcor::AliasTable::Item> items = Falcor::AliasTable::build(weights, seed, &sum);
 
-        for (uint32_t i = 0; i < N; ++i)
+        AliasTable result
         {
-            permutation[i] = i;
-        }
+            float(sum),
+            N,
+            wideIndices,
+        };
 
-        for (uint32_t i = 0; i < N; ++i)
+        if (result.wideIndices)
         {
-            uint32_t dst = i + (rngDist(mAliasTableRng) % (N - i));
-            std::swap(thresholds[i], thresholds[dst]);
-            std::swap(redirect[i], redirect[dst]);
-            std::swap(permutation[i], permutation[dst]);
+            // The table items match the layout of the uint4 entries.
+            static_assert(sizeof(Falcor::AliasTable::Item) == sizeof(uint4));
+            result.fullTable = Buffer::createTyped<uint4>(N, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, reinterpret_cast<const uint4*>(items.data()));
         }
-
-        for (uint32_t i = 0; i < N; ++i)
+        else
         {
-            merged[i] = uint2(redirect[i], permutation[i]);
-
             // Pack 16-bit threshold (i.e., a half float) plus 2x 24-bit table entries
-            uint32_t prob = (uint32_t(f32tof16(thresholds[i])) << 16u);
-            uint2 lowPrec = uint2(redirect[i] & 0xFFFFFFu, permutation[i] & 0xFFFFFFu);
-            uint2 mergedEntry = uint2(prob | ((lowPrec.x >> 8u) & 0xFFFFu), ((lowPrec.x & 0xFFu) << 24u) | lowPrec.y);
-            fullTable[i] = mergedEntry;
+            std::vector<uint2> fullTable(N);
+            for (uint32_t i = 0; i < N; ++i)
+            {
+                const auto& item = items[i];
+                uint32_t prob = (uint32_t(f32tof16(item.threshold)) << 16u);
+                fullTable[i] = uint2(prob | ((item.indexA >> 8u) & 0xFFFFu), ((item.indexA & 0xFFu) << 24u) | item.indexB);
+            }
+            result.fullTable = Buffer::createTyped<uint2>(N, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, fullTable.data());
         }
 
-        AliasTable result
-        {
-            float(sum),
-            N,
-            Buffer::createTyped<uint2>(N),
-        };
-
-        result.fullTable->setBlob(&fullTable[0], 0, N * sizeof(uint2));
-
         return result;
     }
 }
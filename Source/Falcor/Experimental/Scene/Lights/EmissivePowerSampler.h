@@ -43,9 +43,14 @@ namespace Falcor
         {
             float weightSum;                ///< Total weight of all elements used to create the alias table
             uint32_t N;                     ///< Number of entries in the alias table (and # elements in the buffers)
-            Buffer::SharedPtr fullTable;    ///< A compressed/packed merged table.  Max 2^24 (16 million) entries per table.
+            bool wideIndices = false;       ///< True if the table stores full 32-bit indices and thresholds (uint4 entries), false if it is packed into uint2 entries.
+            Buffer::SharedPtr fullTable;    ///< A compressed/packed merged table. The packed format holds max 2^24 (16 million) entries, larger tables use wide indices.
         };
 
+        /** Largest number of entries that fit the packed alias table format with 24-bit indices.
+        */
+        static const uint32_t kMaxPackedAliasTableEntries = 1u << 24;
+
         virtual ~EmissivePowerSampler() = default;
 
         /** Creates a EmissivePowerSampler for a given scene.
@@ -61,12 +66,25 @@ namespace Falcor
         */
         virtual bool update(RenderContext* pRenderContext) override;
 
+        /** Return a list of shader defines to use this light sampler.
+            \return Returns a list of shader defines.
+        */
+        virtual Program::DefineList getDefines() const override;
+
         /** Bind the light sampler data to a given shader variable.
             \param[in] var Shader variable.
             \return True if successful, false otherwise.
         */
         virtual bool setShaderData(const ShaderVar& var) const override;
 
+        /** Create an alias table in the format read by EmissivePowerSampler.slang.
+            \param[in] weights The weights we'd like to sample each entry proportional to.
+            \param[in] seed Seed of the shuffle of the table slots.
+            \param[in] wideIndices True to store full 32-bit indices and thresholds, false to pack the entries (at most kMaxPackedAliasTableEntries).
+            \returns The alias table.
+        */
+        static AliasTable createAliasTable(const std::vector<float>& weights, uint64_t seed, bool wideIndices);
+
     protected:
         EmissivePowerSampler(RenderContext* pRenderContext, Scene::SharedPtr pScene);
 
@@ -0,0 +1,490 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "EmissiveTriangleIntegrator.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/HashUtils.h"
+#include "Utils/Color/ColorHelpers.slang"
+#include "Utils/Timing/CpuTimer.h"
+#include <execution>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kCacheMagic = 0x584c4645; // "EFLX"
+        const uint32_t kCacheVersion = 1;
+
+        const uint32_t kTrianglesPerChunk = 256;
+
+        /** Channel layout of a supported texture format.
+        */
+        struct TexelLayout
+        {
+            uint32_t channelCount;
+            uint32_t channelBits;
+            bool isFloat;
+            bool isSrgb;
+            bool isBgr;
+        };
+
+        bool getTexelLayout(ResourceFormat format, TexelLayout& layout)
+        {
+            if (format == ResourceFormat::Unknown || isCompressedFormat(format)) return false;
+
+            layout.channelCount = getFormatChannelCount(format);
+            layout.channelBits = getNumChannelBits(format, 0);
+            for (uint32_t c = 1; c < layout.channelCount; c++)
+            {
+                if (getNumChannelBits(format, c) != layout.channelBits) return false;
+            }
+            if (layout.channelCount * layout.channelBits != getFormatBytesPerBlock(format) * 8) return false;
+
+            const ResourceFormat linearFormat = srgbToLinearFormat(format);
+            layout.isBgr = linearFormat == ResourceFormat::BGRA8Unorm || linearFormat == ResourceFormat::BGRX8Unorm;
+
+            FormatType type = getFormatType(format);
+            layout.isFloat = type == FormatType::Float;
+            layout.isSrgb = type == FormatType::UnormSrgb;
+            if (type == FormatType::Unorm || type == FormatType::UnormSrgb) return layout.channelBits == 8;
+            if (layout.isFloat) return layout.channelBits == 16 || layout.channelBits == 32;
+            return false;
+        }
+
+        /** Converts a row of texels to linear RGB, as returned by the texture sampler. Missing channels are zero.
+        */
+        void convertRow(const uint8_t* pSrc, float3* pDst, uint32_t width, const TexelLayout& layout, const float* pSrgbTable)
+        {
+            const uint32_t rgbCount = std::min(layout.channelCount, 3u);
+            for (uint32_t x = 0; x < width; x++)
+            {
+                float3 texel = float3(0.f);
+                for (uint32_t c = 0; c < rgbCount; c++)
+                {
+                    const size_t i = size_t(x) * layout.channelCount + c;
+                    switch (layout.channelBits)
+                    {
+                    case 8:
+                        texel[c] = layout.isSrgb ? pSrgbTable[pSrc[i]] : pSrc[i] * (1.f / 255.f);
+                        break;
+                    case 16:
+                        texel[c] = f16tof32(reinterpret_cast<const uint16_t*>(pSrc)[i]);
+                        break;
+                    default:
+                        texel[c] = reinterpret_cast<const float*>(pSrc)[i];
+                        break;
+                    }
+                }
+                pDst[x] = layout.isBgr ? float3(texel.z, texel.y, texel.x) : texel;
+            }
+        }
+
+        /** Maps a texel index to the texture, following the sampler address mode.
+            Returns -1 if the index is outside of a texture with border addressing.
+        */
+        int64_t addressTexel(int64_t i, int64_t n, Sampler::AddressMode mode)
+        {
+            switch (mode)
+            {
+            case Sampler::AddressMode::Clamp:
+                return std::clamp(i, int64_t(0), n - 1);
+            case Sampler::AddressMode::Border:
+                return i >= 0 && i < n ? i : -1;
+            case Sampler::AddressMode::Mirror:
+            {
+                int64_t m = ((i % (2 * n)) + 2 * n) % (2 * n);
+                return m < n ? m : 2 * n - 1 - m;
+            }
+            case Sampler::AddressMode::MirrorOnce:
+                return std::min(i < 0 ? -i - 1 : i, n - 1);
+            default:
+                return ((i % n) + n) % n;
+            }
+        }
+
+        /** Convex polygon in texel space. Clipping a triangle against the four sides of a texel gives at most seven vertices.
+        */
+        struct Polygon
+        {
+            float2 v[8];
+            uint32_t count = 0;
+        };
+
+        /** Clips a convex polygon against the half-plane where sign * (p[axis] - c) >= 0 (Sutherland-Hodgman).
+        */
+        Polygon clip(const Polygon& poly, int axis, float c, float sign)
+        {
+            Polygon result;
+            for (uint32_t i = 0; i < poly.count; i++)
+            {
+                const float2& a = poly.v[i];
+                const float2& b = poly.v[i + 1 < poly.count ? i + 1 : 0];
+                const float da = sign * (a[axis] - c);
+                const float db = sign * (b[axis] - c);
+                if (da >= 0.f) result.v[result.count++] = a;
+                if ((da < 0.f && db > 0.f) || (da > 0.f && db < 0.f))
+                {
+                    float2 p = a + (b - a) * (da / (da - db));
+                    p[axis] = c;
+                    result.v[result.count++] = p;
+                }
+            }
+            return result;
+        }
+
+        float getArea(const Polygon& poly)
+        {
+            float area = 0.f;
+            for (uint32_t i = 0; i < poly.count; i++)
+            {
+                const float2& a = poly.v[i];
+                const float2& b = poly.v[i + 1 < poly.count ? i + 1 : 0];
+                area += a.x * b.y - b.x * a.y;
+            }
+            return std::abs(area) * 0.5f;
+        }
+    }
+
+    EmissiveTriangleIntegrator::EmissiveTriangleIntegrator(Sampler::AddressMode addressModeU, Sampler::AddressMode addressModeV, uint32_t maxTexelsPerTriangle)
+        : mAddressModeU(addressModeU)
+        , mAddressModeV(addressModeV)
+        , mMaxTexelsPerTriangle(std::max(maxTexelsPerTriangle, 1u))
+    {
+    }
+
+    bool EmissiveTriangleIntegrator::isFormatSupported(ResourceFormat format)
+    {
+        TexelLayout layout;
+        return getTexelLayout(format, layout);
+    }
+
+    uint32_t EmissiveTriangleIntegrator::addTexture(uint32_t width, uint32_t height, ResourceFormat format, const void* pData)
+    {
+        assert(width > 0 && height > 0 && pData);
+
+        TexelLayout layout;
+        if (!getTexelLayout(format, layout))
+        {
+            logWarning("EmissiveTriangleIntegrator: Unsupported texture format " + to_string(format) + ".");
+            return kNoTexture;
+        }
+
+        const uint8_t* pSrc = reinterpret_cast<const uint8_t*>(pData);
+        const size_t size = size_t(width) * getFormatBytesPerBlock(format) * height;
+
+        Texture texture;
+        texture.width = width;
+        texture.height = height;
+        texture.format = format;
+        texture.data.assign(pSrc, pSrc + size);
+        texture.hash = fnvHashValue(fnvHashValue(fnvHashValue(kFnvOffsetBasis64, width), height), format);
+        texture.hash = fnvHashData(texture.hash, pSrc, size);
+
+        mTextures.push_back(std::move(texture));
+        return (uint32_t)mTextures.size() - 1;
+    }
+
+    void EmissiveTriangleIntegrator::buildMips(Texture& texture)
+    {
+        TexelLayout layout;
+        getTexelLayout(texture.format, layout);
+
+        float srgbTable[256];
+        for (uint32_t i = 0; i < 256; i++) srgbTable[i] = sRGBToLinear(i * (1.f / 255.f));
+
+        const uint32_t width = texture.width;
+        const size_t rowPitch = size_t(width) * getFormatBytesPerBlock(texture.format);
+
+        // Convert the base mip.
+        texture.mipSizes.push_back(uint2(width, texture.height));
+        texture.mips.emplace_back(size_t(width) * texture.height);
+        auto rows = NumericRange<size_t>(0, texture.height);
+        std::for_each(std::execution::par, rows.begin(), rows.end(), [&](size_t y)
+        {
+            convertRow(texture.data.data() + y * rowPitch, texture.mips[0].data() + y * width, width, layout, srgbTable);
+        });
+        texture.data = std::vector<uint8_t>();
+
+        // Downsample with a 2x2 box filter. The last row and column of odd-sized mips are clamped.
+        while (texture.mipSizes.back().x > 1 || texture.mipSizes.back().y > 1)
+        {
+            const uint2 srcSize = texture.mipSizes.back();
+            const uint2 dstSize = uint2(std::max(1u, srcSize.x / 2), std::max(1u, srcSize.y / 2));
+            std::vector<float3> dst(size_t(dstSize.x) * dstSize.y);
+            const std::vector<float3>& src = texture.mips.back();
+
+            auto dstRows = NumericRange<size_t>(0, dstSize.y);
+            std::for_each(std::execution::par, dstRows.begin(), dstRows.end(), [&](size_t y)
+            {
+                const float3* pRow0 = src.data() + std::min(2 * (uint32_t)y, srcSize.y - 1) * size_t(srcSize.x);
+                const float3* pRow1 = src.data() + std::min(2 * (uint32_t)y + 1, srcSize.y - 1) * size_t(srcSize.x);
+                for (uint32_t x = 0; x < dstSize.x; x++)
+                {
+                    const uint32_t x0 = std::min(2 * x, srcSize.x - 1);
+                    const uint32_t x1 = std::min(2 * x + 1, srcSize.x - 1);
+                    dst[y * dstSize.x + x] = ((pRow0[x0] + pRow0[x1]) + (pRow1[x0] + pRow1[x1])) * 0.25f;
+                }
+            });
+
+            texture.mipSizes.push_back(dstSize);
+            texture.mips.push_back(std::move(dst));
+        }
+    }
+
+    float3 EmissiveTriangleIntegrator::integrateTexture(const Texture& texture, const Triangle& triangle, uint64_t& texelCount) const
+    {
+        const float2 uvMin = glm::min(glm::min(triangle.texCoords[0], triangle.texCoords[1]), triangle.texCoords[2]);
+        const float2 uvMax = glm::max(glm::max(triangle.texCoords[0], triangle.texCoords[1]), triangle.texCoords[2]);
+
+        // Offset the texture coordinates by whole texture repetitions to keep the texel positions small, as in EmissiveIntegrator.ps.slang.
+        const float2 offset = glm::floor(uvMin);
+
+        // Select the finest mip at which the triangle's bounding box covers at most mMaxTexelsPerTriangle texels.
+        uint32_t mip = 0;
+        for (; mip + 1 < (uint32_t)texture.mips.size(); mip++)
+        {
+            const float2 size = float2(texture.mipSizes[mip]);
+            const float2 extent = glm::ceil((uvMax - offset) * size) - glm::floor((uvMin - offset) * size);
+            if ((double)std::max(extent.x, 1.f) * std::max(extent.y, 1.f) <= mMaxTexelsPerTriangle) break;
+        }
+
+        const uint2 size = texture.mipSizes[mip];
+        const std::vector<float3>& texels = texture.mips[mip];
+        const int64_t offsetX = (int64_t)offset.x * size.x;
+        const int64_t offsetY = (int64_t)offset.y * size.y;
+
+        auto fetch = [&](int64_t x, int64_t y)
+        {
+            int64_t ax = addressTexel(x + offsetX, size.x, mAddressModeU);
+            int64_t ay = addressTexel(y + offsetY, size.y, mAddressModeV);
+            return ax >= 0 && ay >= 0 ? texels[size_t(ay) * size.x + size_t(ax)] : float3(0.f);
+        };
+
+        Polygon tri;
+        tri.count = 3;
+        for (uint32_t i = 0; i < 3; i++) tri.v[i] = (triangle.texCoords[i] - offset) * float2(size);
+
+        // Sum the texels weighted by their exact overlap with the triangle.
+        // The triangle is cut into rows of texels, and each row into individual texels.
+        glm::dvec3 sum = glm::dvec3(0.0);
+        double weight = 0.0;
+
+        const float2 pMin = glm::min(glm::min(tri.v[0], tri.v[1]), tri.v[2]);
+        const float2 pMax = glm::max(glm::max(tri.v[0], tri.v[1]), tri.v[2]);
+        Polygon remaining = tri;
+        for (int64_t y = (int64_t)std::floor(pMin.y); y < (int64_t)std::ceil(pMax.y) && remaining.count >= 3; y++)
+        {
+            Polygon row = clip(remaining, 1, float(y + 1), -1.f);
+            remaining = clip(remaining, 1, float(y + 1), 1.f);
+            if (row.count < 3) continue;
+
+            // Find the texels that are entirely inside the triangle. The row is convex, so its extent along x within the row
+            // is smallest at the bottom or top of the row. Both are only spanned if the row has vertices on them.
+            float rowMinX = row.v[0].x, rowMaxX = row.v[0].x;
+            float2 bottom = float2(std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+            float2 top = bottom;
+            for (uint32_t i = 0; i < row.count; i++)
+            {
+                const float2& v = row.v[i];
+                rowMinX = std::min(rowMinX, v.x);
+                rowMaxX = std::max(rowMaxX, v.x);
+                if (v.y == float(y)) bottom = float2(std::min(bottom.x, v.x), std::max(bottom.y, v.x));
+                if (v.y == float(y + 1)) top = float2(std::min(top.x, v.x), std::max(top.y, v.x));
+            }
+            const int64_t innerBegin = (int64_t)std::ceil(std::max(bottom.x, top.x));
+            const int64_t innerEnd = (int64_t)std::floor(std::min(bottom.y, top.y));
+
+            for (int64_t x = (int64_t)std::floor(rowMinX); x < (int64_t)std::ceil(rowMaxX) && row.count >= 3; x++)
+            {
+                if (x == innerBegin && innerBegin < innerEnd)
+                {
+                    for (; x < innerEnd; x++) sum += glm::dvec3(fetch(x, y));
+                    weight += double(innerEnd - innerBegin);
+                    texelCount += innerEnd - innerBegin;
+                    row = clip(row, 0, float(x), 1.f);
+                    x--;
+                    continue;
+                }
+
+                Polygon cell = clip(row, 0, float(x + 1), -1.f);
+                row = clip(row, 0, float(x + 1), 1.f);
+
+                const float area = cell.count >= 3 ? getArea(cell) : 0.f;
+                if (area > 0.f)
+                {
+                    sum += glm::dvec3(fetch(x, y)) * (double)area;
+                    weight += area;
+                    texelCount++;
+                }
+            }
+        }
+
+        if (weight > 0.0) return float3(sum / weight);
+
+        // The triangle is degenerate in texture space. Use the texel at its centroid.
+        const float2 centroid = (tri.v[0] + tri.v[1] + tri.v[2]) / 3.f;
+        texelCount++;
+        return fetch((int64_t)std::floor(centroid.x), (int64_t)std::floor(centroid.y));
+    }
+
+    std::vector<EmissiveFlux> EmissiveTriangleIntegrator::integrate(const std::vector<Triangle>& triangles, const std::vector<Material>& materials)
+    {
+        auto startTime = CpuTimer::getCurrentTimePoint();
+
+        for (auto& texture : mTextures)
+        {
+            if (texture.mips.empty()) buildMips(texture);
+        }
+
+        const uint32_t triangleCount = (uint32_t)triangles.size();
+        const size_t chunkCount = div_round_up(triangleCount, kTrianglesPerChunk);
+        const auto chunks = NumericRange<size_t>(0, chunkCount);
+        std::vector<uint32_t> chunkTexturedCounts(chunkCount, 0);
+        std::vector<uint64_t> chunkTexelCounts(chunkCount, 0);
+
+        std::vector<EmissiveFlux> result(triangleCount);
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
+        {
+            const uint32_t begin = (uint32_t)chunk * kTrianglesPerChunk;
+            const uint32_t end = std::min(begin + kTrianglesPerChunk, triangleCount);
+            for (uint32_t i = begin; i < end; i++)
+            {
+                const Triangle& triangle = triangles[i];
+                assert(triangle.materialID < materials.size());
+                const Material& material = materials[triangle.materialID];
+
+                float3 averageEmissiveColor = material.emissive;
+                if (material.textureID != kNoTexture)
+                {
+                    assert(material.textureID < mTextures.size());
+                    averageEmissiveColor = integrateTexture(mTextures[material.textureID], triangle, chunkTexelCounts[chunk]);
+                    chunkTexturedCounts[chunk]++;
+                }
+
+                // Same as FinalizeIntegration.cs.slang. We assume diffuse emitters and integrate per side (hemisphere) => the scale factor is pi.
+                const float3 averageRadiance = averageEmissiveColor * material.emissiveFactor;
+                result[i].flux = luminance(averageRadiance) * triangle.area * (float)M_PI;
+                result[i].averageRadiance = averageRadiance;
+            }
+        });
+
+        mStats = Stats();
+        mStats.triangleCount = triangleCount;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            mStats.texturedTriangleCount += chunkTexturedCounts[chunk];
+            mStats.texelCount += chunkTexelCounts[chunk];
+        }
+        mStats.time = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) * 1e-3;
+
+        return result;
+    }
+
+    std::vector<EmissiveFlux> EmissiveTriangleIntegrator::integrateCached(const std::vector<Triangle>& triangles, const std::vector<Material>& materials, const std::string& cacheDirectory)
+    {
+        const uint64_t hash = computeHash(triangles, materials);
+        const uint32_t triangleCount = (uint32_t)triangles.size();
+
+        std::string directory = cacheDirectory.empty() ? getDefaultCacheDirectory() : cacheDirectory;
+        char hashString[17];
+        snprintf(hashString, sizeof(hashString), "%016llx", (unsigned long long)hash);
+        std::string cachePath = directory + "/" + hashString + ".bin";
+
+        // Load the results from the cache.
+        if (doesFileExist(cachePath))
+        {
+            BinaryFileStream stream(cachePath, BinaryFileStream::Mode::Read);
+
+            uint32_t magic = 0, version = 0, cachedCount = 0;
+            uint64_t cachedHash = 0;
+            stream >> magic >> version >> cachedCount >> cachedHash;
+            if (!stream.isFail() && magic == kCacheMagic && version == kCacheVersion && cachedCount == triangleCount && cachedHash == hash &&
+                stream.getRemainingStreamSize() == triangleCount * sizeof(EmissiveFlux))
+            {
+                std::vector<EmissiveFlux> result(triangleCount);
+                stream.read(result.data(), result.size() * sizeof(EmissiveFlux));
+                if (!stream.isFail())
+                {
+                    mStats = Stats();
+                    mStats.triangleCount = triangleCount;
+                    for (const auto& triangle : triangles)
+                    {
+                        if (materials[triangle.materialID].textureID != kNoTexture) mStats.texturedTriangleCount++;
+                    }
+                    mStats.cached = true;
+                    return result;
+                }
+            }
+            logWarning("EmissiveTriangleIntegrator: Ignoring invalid cache file '" + cachePath + "'.");
+        }
+
+        std::vector<EmissiveFlux> result = integrate(triangles, materials);
+
+        // Create the cache directory and its parent, if needed.
+        bool success = isDirectoryExists(directory);
+        if (!success)
+        {
+            std::string parent = getDirectoryFromFile(directory);
+            if (!parent.empty() && !isDirectoryExists(parent)) createDirectory(parent);
+            success = createDirectory(directory);
+        }
+        if (success)
+        {
+            BinaryFileStream stream(cachePath, BinaryFileStream::Mode::Write);
+            stream << kCacheMagic << kCacheVersion << triangleCount << hash;
+            stream.write(result.data(), result.size() * sizeof(EmissiveFlux));
+            success = !stream.isFail();
+            stream.close();
+            if (!success) stream.remove();
+        }
+        if (!success) logWarning("EmissiveTriangleIntegrator: Failed to write cache file '" + cachePath + "'.");
+
+        return result;
+    }
+
+    std::string EmissiveTriangleIntegrator::getDefaultCacheDirectory()
+    {
+        return getAppDataDirectory() + "/Falcor/EmissiveCache";
+    }
+
+    uint64_t EmissiveTriangleIntegrator::computeHash(const std::vector<Triangle>& triangles, const std::vector<Material>& materials) const
+    {
+        static_assert(sizeof(Triangle) == 32, "Triangle has padding");
+        static_assert(sizeof(Material) == 20, "Material has padding");
+
+        uint64_t hash = kFnvOffsetBasis64;
+        hash = fnvHashValue(hash, kCacheVersion);
+        hash = fnvHashValue(hash, mAddressModeU);
+        hash = fnvHashValue(hash, mAddressModeV);
+        hash = fnvHashValue(hash, mMaxTexelsPerTriangle);
+        hash = fnvHashData(hash, triangles.data(), triangles.size() * sizeof(Triangle));
+        hash = fnvHashData(hash, materials.data(), materials.size() * sizeof(Material));
+        for (const auto& texture : mTextures) hash = fnvHashValue(hash, texture.hash);
+        return hash;
+    }
+}
@@ -0,0 +1,150 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "LightCollectionShared.slang"
+
+namespace Falcor
+{
+    /** Pre-integration of emissive triangles on the host.
+
+        This computes the same per-triangle average radiance and flux as the raster integration in
+        LightCollection (EmissiveIntegrator.ps.slang followed by FinalizeIntegration.cs.slang), without using the GPU.
+        The emissive texture is treated as piecewise constant over its texels, and each texel is weighted by
+        the exact area of its overlap with the triangle in texture space. Small triangles therefore get the
+        texels they overlap instead of falling back to a default radiance when they miss all texel centers.
+
+        Large triangles are integrated over a coarser mip of the texture, chosen so that the triangle's bounding
+        box covers at most maxTexelsPerTriangle texels. The mips are box filtered, so this only blurs the texels
+        along the triangle's edges. Triangles are integrated in parallel.
+
+        Results can be cached on disk, in files named by a hash of all inputs (texture coordinates, areas,
+        emissive parameters, texels and integration settings).
+    */
+    class dlldecl EmissiveTriangleIntegrator
+    {
+    public:
+        static const uint32_t kNoTexture = 0xffffffff;
+        static const uint32_t kDefaultMaxTexelsPerTriangle = 256;
+
+        /** Emissive triangle.
+        */
+        struct Triangle
+        {
+            float2 texCoords[3];        ///< Per-vertex texture coordinates.
+            float area = 0.f;           ///< Triangle area in world space.
+            uint32_t materialID = 0;    ///< Index into the materials passed to integrate().
+        };
+
+        /** Emissive parameters of a material.
+        */
+        struct Material
+        {
+            float3 emissive = float3(0.f);      ///< Emissive color, used if the material has no emissive texture.
+            float emissiveFactor = 1.f;         ///< Scale of the emissive color or texture.
+            uint32_t textureID = kNoTexture;    ///< Emissive texture returned by addTexture(), or kNoTexture.
+        };
+
+        struct Stats
+        {
+            uint32_t triangleCount = 0;             ///< Number of triangles integrated.
+            uint32_t texturedTriangleCount = 0;     ///< Number of triangles with an emissive texture.
+            uint64_t texelCount = 0;                ///< Number of texels overlapping the textured triangles, at the mips used.
+            double time = 0.0;                      ///< Integration time in seconds. Zero if the results were loaded from the cache.
+            bool cached = false;                    ///< True if the results were loaded from the cache.
+
+            double getTrianglesPerSecond() const { return time > 0.0 ? triangleCount / time : 0.0; }
+        };
+
+        /** Constructor.
+            \param[in] addressModeU Texture addressing in u, as used by the material sampler.
+            \param[in] addressModeV Texture addressing in v, as used by the material sampler.
+            \param[in] maxTexelsPerTriangle Largest number of texels in a triangle's bounding box before a coarser mip is used.
+        */
+        EmissiveTriangleIntegrator(Sampler::AddressMode addressModeU = Sampler::AddressMode::Wrap, Sampler::AddressMode addressModeV = Sampler::AddressMode::Wrap, uint32_t maxTexelsPerTriangle = kDefaultMaxTexelsPerTriangle);
+
+        /** Check if a texture format is supported. These are the uncompressed formats with 8-bit unorm (linear or sRGB), 16-bit float or 32-bit float channels.
+        */
+        static bool isFormatSupported(ResourceFormat format);
+
+        /** Add an emissive texture. The texels are copied and hashed.
+            They are converted to linear RGB, as returned by the texture sampler, and a mip chain is built only when
+            the triangles are integrated, so that loading the results from the cache skips this work.
+            \param[in] width Width in texels.
+            \param[in] height Height in texels.
+            \param[in] format Texel format.
+            \param[in] pData Texels of the base mip with rows tightly packed.
+            \return Texture ID, or kNoTexture if the format is not supported.
+        */
+        uint32_t addTexture(uint32_t width, uint32_t height, ResourceFormat format, const void* pData);
+
+        /** Integrate the emissive triangles.
+            \param[in] triangles Triangles.
+            \param[in] materials Materials referenced by the triangles.
+            \return Flux and average radiance per triangle, in the layout of the flux buffer of LightCollection.
+        */
+        std::vector<EmissiveFlux> integrate(const std::vector<Triangle>& triangles, const std::vector<Material>& materials);
+
+        /** Integrate the emissive triangles, or load the results from the cache.
+            \param[in] triangles Triangles.
+            \param[in] materials Materials referenced by the triangles.
+            \param[in] cacheDirectory Directory of the cache files. If empty, the default cache directory is used.
+            \return Flux and average radiance per triangle.
+        */
+        std::vector<EmissiveFlux> integrateCached(const std::vector<Triangle>& triangles, const std::vector<Material>& materials, const std::string& cacheDirectory = "");
+
+        /** Get the statistics of the last integration.
+        */
+        const Stats& getStats() const { return mStats; }
+
+        /** Get the default cache directory, which is located in the application data directory.
+        */
+        static std::string getDefaultCacheDirectory();
+
+    private:
+        struct Texture
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            ResourceFormat format = ResourceFormat::Unknown;
+            std::vector<uint8_t> data;              ///< Texels of the base mip as passed to addTexture(). Released once the mips are built.
+            std::vector<uint2> mipSizes;
+            std::vector<std::vector<float3>> mips;  ///< Texels of each mip in linear RGB. Empty until the first integration.
+            uint64_t hash = 0;                      ///< Hash of the base mip texels.
+        };
+
+        static void buildMips(Texture& texture);
+        float3 integrateTexture(const Texture& texture, const Triangle& triangle, uint64_t& texelCount) const;
+        uint64_t computeHash(const std::vector<Triangle>& triangles, const std::vector<Material>& materials) const;
+
+        Sampler::AddressMode mAddressModeU;
+        Sampler::AddressMode mAddressModeV;
+        uint32_t mMaxTexelsPerTriangle;
+        std::vector<Texture> mTextures;
+        Stats mStats;
+    };
+}
@@ -0,0 +1,451 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "EnvMapImportanceMap.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/HashUtils.h"
+#include "Utils/Image/PixelConversion.h"
+#include "glm/gtc/integer.hpp"
+#include <immintrin.h>
+#include <execution>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kCacheMagic = 0x504d4945; // "EIMP"
+        const uint32_t kCacheVersion = 2;
+
+        const float kInv2Pi = (float)(0.5 * M_1_PI);
+        const float kInv4Pi = (float)(0.25 * M_1_PI);
+
+        float signf(float v) { return v > 0.f ? 1.f : (v < 0.f ? -1.f : 0.f); }
+
+        // Host versions of the mappings in MathHelpers.slang. They use fp32 math to match the GPU.
+
+        float2 world_to_latlong_map(float3 dir)
+        {
+            float3 p = glm::normalize(dir);
+            float2 uv;
+            uv.x = std::atan2(p.x, -p.z) * kInv2Pi + 0.5f;
+            uv.y = std::acos(std::clamp(p.y, -1.f, 1.f)) * (float)M_1_PI;
+            return uv;
+        }
+
+        float2 ndir_to_oct_equal_area_unorm(float3 n)
+        {
+            float r = std::sqrt(std::max(1.f - std::abs(n.z), 0.f));
+            float phi = std::atan2(std::abs(n.y), std::abs(n.x));
+
+            float2 p;
+            p.y = r * phi * (float)M_2_PI;
+            p.x = r - p.y;
+
+            if (n.z < 0.f) p = float2(1.f - p.y, 1.f - p.x);
+            p *= float2(signf(n.x), signf(n.y));
+
+            return p * 0.5f + 0.5f;
+        }
+
+        float3 oct_to_ndir_equal_area_unorm(float2 p)
+        {
+            p = p * 2.f - 1.f;
+
+            float d = 1.f - (std::abs(p.x) + std::abs(p.y));
+            float r = 1.f - std::abs(d);
+
+            float phi = (r > 0.f) ? ((std::abs(p.y) - std::abs(p.x)) / r + 1.f) * (float)M_PI_4 : 0.f;
+
+            float f = r * std::sqrt(2.f - r * r);
+            float x = f * signf(p.x) * std::cos(phi);
+            float y = f * signf(p.y) * std::sin(phi);
+            float z = signf(d) * (1.f - r * r);
+
+            return float3(x, y, z);
+        }
+
+        /** Converts the environment map to RGBA32Float, the layout expected by the resampling step.
+            Returns an empty vector if the format is not supported. RGBA32Float bitmaps are used in place and not copied.
+        */
+        std::vector<float> convertToRGBA32Float(const Bitmap& envMap, bool& isSupported)
+        {
+            const uint32_t width = envMap.getWidth();
+            const uint32_t height = envMap.getHeight();
+            const ResourceFormat format = envMap.getFormat();
+            const uint8_t* pSrc = envMap.getData();
+
+            isSupported = true;
+            std::vector<float> pixels;
+            switch (format)
+            {
+            case ResourceFormat::RGBA32Float:
+                return pixels;
+            case ResourceFormat::RGB32Float:
+            case ResourceFormat::RGBA16Float:
+            case ResourceFormat::RGB16Float:
+            case ResourceFormat::BGRA8Unorm:
+            case ResourceFormat::BGRX8Unorm:
+                break;
+            default:
+                isSupported = false;
+                return pixels;
+            }
+
+            pixels.resize(size_t(width) * height * 4);
+            auto rows = NumericRange<size_t>(0, height);
+            std::for_each(std::execution::par, rows.begin(), rows.end(), [&](size_t y)
+            {
+                const uint8_t* pSrcRow = pSrc + y * envMap.getRowPitch();
+                float* pDstRow = pixels.data() + y * width * 4;
+
+                switch (format)
+                {
+                case ResourceFormat::RGB32Float:
+                    convertRGBToRGBA32Float(reinterpret_cast<const float*>(pSrcRow), pDstRow, width);
+                    break;
+                case ResourceFormat::RGBA16Float:
+                    convertHalfToFloat(reinterpret_cast<const uint16_t*>(pSrcRow), pDstRow, size_t(width) * 4);
+                    break;
+                case ResourceFormat::RGB16Float:
+                    // Expand in place from the back of the row, which holds the RGB values.
+                    convertHalfToFloat(reinterpret_cast<const uint16_t*>(pSrcRow), pDstRow + width, size_t(width) * 3);
+                    for (uint32_t x = 0; x < width; x++)
+                    {
+                        float r = pDstRow[width + x * 3 + 0], g = pDstRow[width + x * 3 + 1], b = pDstRow[width + x * 3 + 2];
+                        pDstRow[x * 4 + 0] = r;
+                        pDstRow[x * 4 + 1] = g;
+                        pDstRow[x * 4 + 2] = b;
+                        pDstRow[x * 4 + 3] = 1.f;
+                    }
+                    break;
+                default:
+                    for (uint32_t x = 0; x < width; x++)
+                    {
+                        pDstRow[x * 4 + 0] = pSrcRow[x * 4 + 2] * (1.f / 255.f);
+                        pDstRow[x * 4 + 1] = pSrcRow[x * 4 + 1] * (1.f / 255.f);
+                        pDstRow[x * 4 + 2] = pSrcRow[x * 4 + 0] * (1.f / 255.f);
+                        pDstRow[x * 4 + 3] = 1.f;
+                    }
+                    break;
+                }
+            });
+            return pixels;
+        }
+    }
+
+    EnvMapImportanceMap::EnvMapImportanceMap(uint32_t dimension)
+        : mDimension(dimension)
+    {
+        // We create log2(N)+1 mips from NxN...1x1 texels resolution.
+        uint32_t mips = glm::log2(dimension) + 1;
+        size_t offset = 0;
+        for (uint32_t mip = 0; mip < mips; mip++)
+        {
+            mMipOffsets.push_back(offset);
+            offset += size_t(dimension >> mip) * (dimension >> mip);
+        }
+        mData.resize(offset);
+    }
+
+    EnvMapImportanceMap::SharedPtr EnvMapImportanceMap::create(const Bitmap& envMap, uint32_t dimension, uint32_t samples)
+    {
+        assert(isPowerOf2(dimension) && dimension > 1);
+        assert(isPowerOf2(samples));
+
+        bool isSupported = false;
+        std::vector<float> converted = convertToRGBA32Float(envMap, isSupported);
+        if (!isSupported)
+        {
+            logWarning("EnvMapImportanceMap: Unsupported environment map format " + to_string(envMap.getFormat()) + ".");
+            return nullptr;
+        }
+
+        const float* pEnv = converted.empty() ? reinterpret_cast<const float*>(envMap.getData()) : converted.data();
+        const uint32_t envWidth = envMap.getWidth();
+        const uint32_t envHeight = envMap.getHeight();
+        const size_t envRowStride = converted.empty() ? envMap.getRowPitch() / sizeof(float) : size_t(envWidth) * 4;
+
+        SharedPtr pMap = SharedPtr(new EnvMapImportanceMap(dimension));
+
+        // Same sample distribution as in EnvMapSamplerSetup.cs.slang.
+        const uint32_t samplesX = std::max(1u, (uint32_t)std::sqrt(samples));
+        const uint32_t samplesY = samples / samplesX;
+        assert(samples == samplesX * samplesY);
+        const float2 invDimInSamples = 1.f / float2(float(dimension * samplesX), float(dimension * samplesY));
+        const float invSamples = 1.f / (samplesX * samplesY);
+
+        // Compute the base mip. The mapping to the lat-long map is scalar, the bilinear
+        // filtering (wrap in u, clamp in v) and the accumulation of radiance use SSE.
+        float* pBase = pMap->mData.data();
+        auto rows = NumericRange<size_t>(0, dimension);
+        std::for_each(std::execution::par, rows.begin(), rows.end(), [&](size_t row)
+        {
+            const uint32_t py = (uint32_t)row;
+            for (uint32_t px = 0; px < dimension; px++)
+            {
+                __m128 L = _mm_setzero_ps();
+                for (uint32_t y = 0; y < samplesY; y++)
+                {
+                    for (uint32_t x = 0; x < samplesX; x++)
+                    {
+                        uint2 samplePos = uint2(px * samplesX + x, py * samplesY + y);
+                        float2 p = (float2(samplePos) + 0.5f) * invDimInSamples;
+
+                        float3 dir = oct_to_ndir_equal_area_unorm(p);
+                        float2 uv = world_to_latlong_map(dir);
+
+                        float fx = uv.x * envWidth - 0.5f;
+                        float fy = uv.y * envHeight - 0.5f;
+                        float x0f = std::floor(fx);
+                        float y0f = std::floor(fy);
+                        __m128 wx = _mm_set1_ps(fx - x0f);
+                        __m128 wy = _mm_set1_ps(fy - y0f);
+
+                        int32_t x0 = (int32_t)x0f % (int32_t)envWidth;
+                        if (x0 < 0) x0 += envWidth;
+                        int32_t x1 = x0 + 1 == (int32_t)envWidth ? 0 : x0 + 1;
+                        int32_t y0 = std::clamp((int32_t)y0f, 0, (int32_t)envHeight - 1);
+                        int32_t y1 = std::clamp((int32_t)y0f + 1, 0, (int32_t)envHeight - 1);
+
+                        const float* pRow0 = pEnv + y0 * envRowStride;
+                        const float* pRow1 = pEnv + y1 * envRowStride;
+                        __m128 c00 = _mm_loadu_ps(pRow0 + x0 * 4);
+                        __m128 c10 = _mm_loadu_ps(pRow0 + x1 * 4);
+                        __m128 c01 = _mm_loadu_ps(pRow1 + x0 * 4);
+                        __m128 c11 = _mm_loadu_ps(pRow1 + x1 * 4);
+
+                        __m128 top = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), wx));
+                        __m128 bottom = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), wx));
+                        L = _mm_add_ps(L, _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), wy)));
+                    }
+                }
+
+                // Luminance is linear, so it's applied to the sum of the radiance samples.
+                float sum[4];
+                _mm_storeu_ps(sum, L);
+                float luminance = 0.2126f * sum[0] + 0.7152f * sum[1] + 0.0722f * sum[2];
+                pBase[size_t(py) * dimension + px] = luminance * invSamples;
+            }
+        });
+
+        pMap->buildMips();
+        return pMap;
+    }
+
+    void EnvMapImportanceMap::buildMips()
+    {
+        // Each texel is the average of 2x2 texels in the previous mip, which is what generateMips() produces for power-of-two textures.
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        for (uint32_t mip = 1; mip < getMipCount(); mip++)
+        {
+            const uint32_t srcDim = mDimension >> (mip - 1);
+            const uint32_t dstDim = mDimension >> mip;
+            const float* pSrc = mData.data() + mMipOffsets[mip - 1];
+            float* pDst = mData.data() + mMipOffsets[mip];
+
+            auto rows = NumericRange<size_t>(0, dstDim);
+            std::for_each(std::execution::par, rows.begin(), rows.end(), [&](size_t y)
+            {
+                const float* pSrc0 = pSrc + 2 * y * srcDim;
+                const float* pSrc1 = pSrc0 + srcDim;
+                float* pDstRow = pDst + y * dstDim;
+
+                uint32_t x = 0;
+                for (; x + 4 <= dstDim; x += 4)
+                {
+                    // Sum the two rows, then add horizontal pairs.
+                    __m128 a = _mm_add_ps(_mm_loadu_ps(pSrc0 + 2 * x), _mm_loadu_ps(pSrc1 + 2 * x));
+                    __m128 b = _mm_add_ps(_mm_loadu_ps(pSrc0 + 2 * x + 4), _mm_loadu_ps(pSrc1 + 2 * x + 4));
+                    __m128 even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                    __m128 odd = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                    _mm_storeu_ps(pDstRow + x, _mm_mul_ps(_mm_add_ps(even, odd), quarter));
+                }
+                for (; x < dstDim; x++)
+                {
+                    pDstRow[x] = ((pSrc0[2 * x] + pSrc1[2 * x]) + (pSrc0[2 * x + 1] + pSrc1[2 * x + 1])) * 0.25f;
+                }
+            });
+        }
+    }
+
+    EnvMapImportanceMap::SharedPtr EnvMapImportanceMap::createFromFile(const std::string& filename, uint32_t dimension, uint32_t samples, const std::string& cacheDirectory)
+    {
+        assert(isPowerOf2(dimension) && dimension > 1);
+        assert(isPowerOf2(samples));
+
+        // DDS files are loaded with the GPU formats, which are not supported here.
+        if (hasSuffix(filename, ".dds", false)) return nullptr;
+
+        std::string fullpath;
+        if (!findFileInDataDirectories(filename, fullpath))
+        {
+            logWarning("EnvMapImportanceMap: Can't find environment map file '" + filename + "'.");
+            return nullptr;
+        }
+
+        uint64_t fileHash = 0;
+        if (!fnvHashFile(fullpath, fileHash))
+        {
+            logWarning("EnvMapImportanceMap: Failed to read environment map file '" + fullpath + "'.");
+            return nullptr;
+        }
+
+        std::string directory = cacheDirectory.empty() ? getDefaultCacheDirectory() : cacheDirectory;
+        char hashString[17];
+        snprintf(hashString, sizeof(hashString), "%016llx", (unsigned long long)fileHash);
+        std::string cachePath = directory + "/" + hashString + "_" + std::to_string(dimension) + "_" + std::to_string(samples) + ".bin";
+
+        if (doesFileExist(cachePath))
+        {
+            if (auto pMap = loadCache(cachePath, fileHash, dimension, samples)) return pMap;
+            logWarning("EnvMapImportanceMap: Ignoring invalid cache file '" + cachePath + "'.");
+        }
+
+        auto pBitmap = Bitmap::createFromFile(fullpath, true);
+        if (!pBitmap) return nullptr;
+
+        auto pMap = create(*pBitmap, dimension, samples);
+        if (pMap && !pMap->saveCache(cachePath, fileHash, samples))
+        {
+            logWarning("EnvMapImportanceMap: Failed to write cache file '" + cachePath + "'.");
+        }
+        return pMap;
+    }
+
+    std::string EnvMapImportanceMap::getDefaultCacheDirectory()
+    {
+        return getAppDataDirectory() + "/Falcor/EnvMapCache";
+    }
+
+    bool EnvMapImportanceMap::saveCache(const std::string& path, uint64_t fileHash, uint32_t samples) const
+    {
+        // Create the cache directory and its parent, if needed.
+        std::string directory = getDirectoryFromFile(path);
+        if (!isDirectoryExists(directory))
+        {
+            std::string parent = getDirectoryFromFile(directory);
+            if (!parent.empty() && !isDirectoryExists(parent)) createDirectory(parent);
+            if (!createDirectory(directory)) return false;
+        }
+
+        BinaryFileStream stream(path, BinaryFileStream::Mode::Write);
+        stream << kCacheMagic << kCacheVersion << mDimension << samples << fileHash;
+        stream.write(mData.data(), mData.size() * sizeof(float));
+        bool success = !stream.isFail();
+        stream.close();
+        if (!success) stream.remove();
+        return success;
+    }
+
+    EnvMapImportanceMap::SharedPtr EnvMapImportanceMap::loadCache(const std::string& path, uint64_t fileHash, uint32_t dimension, uint32_t samples)
+    {
+        BinaryFileStream stream(path, BinaryFileStream::Mode::Read);
+
+        uint32_t magic = 0, version = 0, cachedDimension = 0, cachedSamples = 0;
+        uint64_t cachedHash = 0;
+        stream >> magic >> version >> cachedDimension >> cachedSamples >> cachedHash;
+        if (stream.isFail() || magic != kCacheMagic || version != kCacheVersion) return nullptr;
+        if (cachedDimension != dimension || cachedSamples != samples || cachedHash != fileHash) return nullptr;
+
+        SharedPtr pMap = SharedPtr(new EnvMapImportanceMap(dimension));
+        if (stream.getRemainingStreamSize() != pMap->mData.size() * sizeof(float)) return nullptr;
+        stream.read(pMap->mData.data(), pMap->mData.size() * sizeof(float));
+        if (stream.isFail()) return nullptr;
+        return pMap;
+    }
+
+    EnvMapImportanceMap::Sample EnvMapImportanceMap::sample(float2 rnd) const
+    {
+        float2 p = rnd;
+        uint2 pos = uint2(0);
+
+        // Iterate over mips of 2x2...NxN resolution, as in EnvMapSampler.slang.
+        const int baseMip = (int)getMipCount() - 1;
+        for (int mip = baseMip - 1; mip >= 0; mip--)
+        {
+            pos *= 2u;
+
+            float w[4];
+            w[0] = getTexel(mip, pos);
+            w[1] = getTexel(mip, pos + uint2(1, 0));
+            w[2] = getTexel(mip, pos + uint2(0, 1));
+            w[3] = getTexel(mip, pos + uint2(1, 1));
+
+            float q[2];
+            q[0] = w[0] + w[2];
+            q[1] = w[1] + w[3];
+
+            uint2 off;
+
+            // Horizontal warp.
+            float d = q[0] / (q[0] + q[1]);
+            if (p.x < d)
+            {
+                off.x = 0;
+                p.x = p.x / d;
+            }
+            else
+            {
+                off.x = 1;
+                p.x = (p.x - d) / (1.f - d);
+            }
+
+            // Vertical warp.
+            float e = w[off.x] / q[off.x];
+            if (p.y < e)
+            {
+                off.y = 0;
+                p.y = p.y / e;
+            }
+            else
+            {
+                off.y = 1;
+                p.y = (p.y - e) / (1.f - e);
+            }
+
+            pos += off;
+        }
+
+        float2 uv = (float2(pos) + p) / float(mDimension);
+
+        Sample result;
+        result.dir = oct_to_ndir_equal_area_unorm(uv);
+        result.pdf = getTexel(0, pos) / getTexel(baseMip, uint2(0)) * kInv4Pi;
+        result.texel = pos;
+        return result;
+    }
+
+    float EnvMapImportanceMap::evalPdf(float3 dir) const
+    {
+        // Point sampling with clamp to edge, as with the sampler created by EnvMapSampler.
+        float2 uv = ndir_to_oct_equal_area_unorm(dir);
+        uint2 texel = glm::min(uint2(glm::max(uv * float(mDimension), float2(0.f))), uint2(mDimension - 1));
+        float avg = getTexel(getMipCount() - 1, uint2(0));
+        return getTexel(0, texel) / avg * kInv4Pi;
+    }
+}
@@ -0,0 +1,125 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+namespace Falcor
+{
+    /** Hierarchical importance map for sampling an environment map, built on the host.
+
+        The map has the same layout as the one built on the GPU by EnvMapSamplerSetup.cs.slang:
+        a square R32Float image with mips from NxN down to 1x1 texels, where the base mip holds
+        the average luminance of the environment map over each texel of an equal-area octahedral
+        map and each following mip the average of 2x2 texels of the previous one.
+
+        The class also implements the sampling and pdf evaluation of EnvMapSampler.slang, so that
+        environment map sampling can be validated without a GPU.
+    */
+    class dlldecl EnvMapImportanceMap
+    {
+    public:
+        using SharedPtr = std::shared_ptr<EnvMapImportanceMap>;
+
+        // The defaults are 512x512 @ 64spp in the resampling step.
+        static const uint32_t kDefaultDimension = 512;
+        static const uint32_t kDefaultSamples = 64;
+
+        /** Result of sampling the importance map.
+        */
+        struct Sample
+        {
+            float3 dir;         ///< Sampled direction in the local frame of the environment map.
+            float pdf;          ///< Probability density function for the sampled direction with respect to solid angle.
+            uint2 texel;        ///< Sampled texel of the base mip.
+        };
+
+        /** Build an importance map from environment map pixels.
+            \param[in] envMap Environment map in lat-long layout with the top row first, as loaded with Bitmap::createFromFile(filename, true).
+                Supported formats are RGBA32Float, RGB32Float, RGBA16Float, RGB16Float, BGRA8Unorm and BGRX8Unorm.
+            \param[in] dimension Width and height of the base mip. Must be a power of two larger than 1.
+            \param[in] samples Number of environment map samples per texel of the base mip. Must be a power of two.
+            \return New object, or nullptr if the bitmap format is not supported.
+        */
+        static SharedPtr create(const Bitmap& envMap, uint32_t dimension = kDefaultDimension, uint32_t samples = kDefaultSamples);
+
+        /** Build an importance map from an environment map file, or load it from the cache.
+            Importance maps are cached on disk in files named by a hash of the environment map file and the build parameters.
+            \param[in] filename Environment map filename. Searched for in the data directories if not absolute.
+            \param[in] dimension Width and height of the base mip. Must be a power of two larger than 1.
+            \param[in] samples Number of environment map samples per texel of the base mip. Must be a power of two.
+            \param[in] cacheDirectory Directory of the cache files. If empty, the default cache directory is used.
+            \return New object, or nullptr if the file can't be loaded or its format is not supported (e.g. DDS).
+        */
+        static SharedPtr createFromFile(const std::string& filename, uint32_t dimension = kDefaultDimension, uint32_t samples = kDefaultSamples, const std::string& cacheDirectory = "");
+
+        /** Get the default cache directory, which is located in the application data directory.
+        */
+        static std::string getDefaultCacheDirectory();
+
+        /** Draw a sample, using the same hierarchical warping as EnvMapSampler::sample() on the GPU.
+            \param[in] rnd Uniform random numbers in [0,1)^2.
+            \return Sampled direction and pdf.
+        */
+        Sample sample(float2 rnd) const;
+
+        /** Evaluate the pdf of sampling a direction, like EnvMapSampler::evalPdf() on the GPU.
+            \param[in] dir Normalized direction in the local frame of the environment map.
+            \return Probability density function with respect to solid angle.
+        */
+        float evalPdf(float3 dir) const;
+
+        /** Get the width and height of the base mip in texels.
+        */
+        uint32_t getDimension() const { return mDimension; }
+
+        /** Get the number of mips, including the base mip and the 1x1 mip.
+        */
+        uint32_t getMipCount() const { return (uint32_t)mMipOffsets.size(); }
+
+        /** Get a texel.
+            \param[in] mip Mip level. Mip 0 is the base mip.
+            \param[in] texel Texel coordinates in the mip.
+        */
+        float getTexel(uint32_t mip, uint2 texel) const { return mData[mMipOffsets[mip] + size_t(texel.y) * (mDimension >> mip) + texel.x]; }
+
+        /** Get the texels of all mips, from the base mip to the 1x1 mip. This is the layout expected for the initial data of a texture with a full mip chain.
+        */
+        const std::vector<float>& getData() const { return mData; }
+
+    private:
+        EnvMapImportanceMap(uint32_t dimension);
+
+        void buildMips();
+        bool saveCache(const std::string& path, uint64_t fileHash, uint32_t samples) const;
+        static SharedPtr loadCache(const std::string& path, uint64_t fileHash, uint32_t dimension, uint32_t samples);
+
+        uint32_t mDimension;
+        std::vector<size_t> mMipOffsets;    ///< Offset of each mip in mData.
+        std::vector<float> mData;           ///< Texels of all mips.
+    };
+}
@@ -36,13 +36,13 @@ namespace Falcor
         const char kShaderFilenameSetup[] = "Experimental/Scene/Lights/EnvMapSamplerSetup.cs.slang";
 
         // The defaults are 512x512 @ 64spp in the resampling step.
-        const uint32_t kDefaultDimension = 512;
-        const uint32_t kDefaultSpp = 64;
+        const uint32_t kDefaultDimension = EnvMapImportanceMap::kDefaultDimension;
+        const uint32_t kDefaultSpp = EnvMapImportanceMap::kDefaultSamples;
     }
 
-    EnvMapSampler::SharedPtr EnvMapSampler::create(RenderContext* pRenderContext, EnvMap::SharedPtr pEnvMap)
+    EnvMapSampler::SharedPtr EnvMapSampler::create(RenderContext* pRenderContext, EnvMap::SharedPtr pEnvMap, bool buildOnHost)
     {
-        return SharedPtr(new EnvMapSampler(pRenderContext, pEnvMap));
+        return SharedPtr(new EnvMapSampler(pRenderContext, pEnvMap, buildOnHost));
     }
 
     void EnvMapSampler::setShaderData(const ShaderVar& var) const
@@ -59,14 +59,11 @@ namespace Falcor
         var["importanceSampler"] = mpImportanceSampler;
     }
 
-    EnvMapSampler::EnvMapSampler(RenderContext* pRenderContext, EnvMap::SharedPtr pEnvMap)
+    EnvMapSampler::EnvMapSampler(RenderContext* pRenderContext, EnvMap::SharedPtr pEnvMap, bool buildOnHost)
         : mpEnvMap(pEnvMap)
     {
         assert(pEnvMap);
 
-        // Create compute program for the setup phase.
-        mpSetupPass = ComputePass::create(kShaderFilenameSetup, "main");
-
         // Create sampler.
         Sampler::Desc samplerDesc;
         samplerDesc.setFilterMode(Sampler::Filter::Point, Sampler::Filter::Point, Sampler::Filter::Point);
@@ -74,17 +71,19 @@ namespace Falcor
         mpImportanceSampler = Sampler::create(samplerDesc);
 
         // Create hierarchical importance map for sampling.
-        if (!createImportanceMap(pRenderContext, kDefaultDimension, kDefaultSpp))
+        if (!createImportanceMap(pRenderContext, kDefaultDimension, kDefaultSpp, buildOnHost))
         {
             throw std::exception("Failed to create importance map");
         }
     }
 
-    bool EnvMapSampler::createImportanceMap(RenderContext* pRenderContext, uint32_t dimension, uint32_t samples)
+    bool EnvMapSampler::createImportanceMap(RenderContext* pRenderContext, uint32_t dimension, uint32_t samples, bool buildOnHost)
     {
         assert(isPowerOf2(dimension));
         assert(isPowerOf2(samples));
 
+        if (buildOnHost && createImportanceMapOnHost(dimension, samples)) return true;
+
         // We create log2(N)+1 mips from NxN...1x1 texels resolution.
         uint32_t mips = glm::log2(dimension) + 1;
         assert((1u << (mips - 1)) == dimension);
@@ -94,6 +93,9 @@ namespace Falcor
         mpImportanceMap = Texture::create2D(dimension, dimension, ResourceFormat::R32Float, 1, mips, nullptr, Resource::BindFlags::ShaderResource | Resource::BindFlags::RenderTarget | Resource::BindFlags::UnorderedAccess);
         assert(mpImportanceMap);
 
+        // Create compute program for the setup phase.
+        if (!mpSetupPass) mpSetupPass = ComputePass::create(kShaderFilenameSetup, "main");
+
         mpSetupPass["gEnvMap"] = mpEnvMap->getEnvMap();
         mpSetupPass["gImportanceMap"] = mpImportanceMap;
 
@@ -115,4 +117,19 @@ namespace Falcor
         return true;
     }
 
+    bool EnvMapSampler::createImportanceMapOnHost(uint32_t dimension, uint32_t samples)
+    {
+        // The importance map is built from the environment map file, so the file must be available.
+        const std::string& filename = mpEnvMap->getFilename();
+        if (filename.empty()) return false;
+
+        auto pMap = EnvMapImportanceMap::createFromFile(filename, dimension, samples);
+        if (!pMap) return false;
+
+        // Upload all mips. The host map has the same layout as the one built on the GPU, so no render target access is needed.
+        mpImportanceMap = Texture::create2D(dimension, dimension, ResourceFormat::R32Float, 1, pMap->getMipCount(), pMap->getData().data(), Resource::BindFlags::ShaderResource);
+        assert(mpImportanceMap);
+
+        return true;
+    }
 }
@@ -28,6 +28,7 @@
 #pragma once
 
 #include "EnvMap.h"
+#include "EnvMapImportanceMap.h"
 
 namespace Falcor
 {
@@ -44,8 +45,9 @@ namespace Falcor
         /** Create a new object.
             \param[in] pRenderContext A render-context that will be used for processing.
             \param[in] pEnvMap The environment map.
+            \param[in] buildOnHost Build the importance map on the host with EnvMapImportanceMap, which caches it on disk. Falls back to building it on the GPU if the environment map file can't be loaded on the host.
         */
-        static SharedPtr create(RenderContext* pRenderContext, EnvMap::SharedPtr pEnvMap);
+        static SharedPtr create(RenderContext* pRenderContext, EnvMap::SharedPtr pEnvMap, bool buildOnHost = true);
 
         /** Bind the environment map sampler to a given shader variable.
             \param[in] var Shader variable.
@@ -57,13 +59,14 @@ namespace Falcor
         const Texture::SharedPtr& getImportanceMap() const { return mpImportanceMap; }
 
     protected:
-        EnvMapSampler(RenderContext* pRenderContext, EnvMap::SharedPtr pEnvMap);
+        EnvMapSampler(RenderContext* pRenderContext, EnvMap::SharedPtr pEnvMap, bool buildOnHost);
 
-        bool createImportanceMap(RenderContext* pRenderContext, uint32_t dimension, uint32_t samples);
+        bool createImportanceMap(RenderContext* pRenderContext, uint32_t dimension, uint32_t samples, bool buildOnHost);
+        bool createImportanceMapOnHost(uint32_t dimension, uint32_t samples);
 
         EnvMap::SharedPtr       mpEnvMap;           ///< Environment map.
 
-        ComputePass::SharedPtr  mpSetupPass;        ///< Compute pass for creating the importance map.
+        ComputePass::SharedPtr  mpSetupPass;        ///< Compute pass for creating the importance map on the GPU. Created on first use.
 
         Texture::SharedPtr      mpImportanceMap;    ///< Hierarchical importance map (luminance).
         Sampler::SharedPtr      mpImportanceSampler;
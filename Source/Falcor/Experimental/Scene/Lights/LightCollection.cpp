@@ -45,10 +45,10 @@ namespace Falcor
         const char kFinalizeIntegrationFile[] = "Experimental/Scene/Lights/FinalizeIntegration.cs.slang";
     }
 
-    LightCollection::SharedPtr LightCollection::create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene)
+    LightCollection::SharedPtr LightCollection::create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, bool integrateOnHost)
     {
         SharedPtr ptr = SharedPtr(new LightCollection());
-        return ptr->init(pRenderContext, pScene) ? ptr : nullptr;
+        return ptr->init(pRenderContext, pScene, integrateOnHost) ? ptr : nullptr;
     }
 
     bool LightCollection::update(RenderContext* pRenderContext, UpdateStatus* pUpdateStatus)
@@ -92,10 +92,11 @@ namespace Falcor
         return false;
     }
 
-    bool LightCollection::init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene)
+    bool LightCollection::init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, bool integrateOnHost)
     {
         assert(pScene);
         mpScene = pScene;
+        mIntegrateOnHost = integrateOnHost;
 
         // Setup the lights.
         if (!setupMeshLights(*pScene)) return false;
@@ -234,15 +235,19 @@ namespace Falcor
             // Prepare GPU buffers.
             prepareTriangleData(pRenderContext, scene);
 
-            // Pre-integrate emissive triangles.
+            // Pre-integrate emissive triangles. The host integration leaves the CPU data valid, the results of the raster integration are read back.
             // TODO: We might want to redo this in update() for animated meshes or after scale changes as that affects the flux.
-            integrateEmissive(pRenderContext, scene);
+            mIntegrationStats = EmissiveTriangleIntegrator::Stats();
+            if (!mIntegrateOnHost || !integrateEmissiveOnHost(pRenderContext, scene))
+            {
+                integrateEmissive(pRenderContext, scene);
 
-            mCPUInvalidData = CPUOutOfDateFlags::All;
-            mStagingBufferValid = false;
-            mStatsValid = false;
+                mCPUInvalidData = CPUOutOfDateFlags::All;
+                mStagingBufferValid = false;
 
-            prepareSyncCPUData(pRenderContext);
+                prepareSyncCPUData(pRenderContext);
+            }
+            mStatsValid = false;
 
             // Build list of active triangles.
             updateActiveTriangleList();
@@ -355,6 +360,92 @@ namespace Falcor
         }
     }
 
+    bool LightCollection::integrateEmissiveOnHost(RenderContext* pRenderContext, const Scene& scene)
+    {
+        assert(mTriangleCount > 0);
+        assert(mMeshLights.size() > 0);
+
+        // Fall back to the raster integration if any emissive texture can't be read on the host.
+        for (const auto& meshLight : mMeshLights)
+        {
+            const auto& pTexture = scene.getMaterial(meshLight.materialID)->getEmissiveTexture();
+            if (pTexture && !EmissiveTriangleIntegrator::isFormatSupported(pTexture->getFormat()))
+            {
+                logInfo("LightCollection: Emissive texture format " + to_string(pTexture->getFormat()) + " is not supported on the host. Integrating emissive triangles on the GPU.");
+                return false;
+            }
+        }
+
+        // Read back the triangle data. The texture coordinates are quantized the same way as for the raster integration.
+        mCPUInvalidData = CPUOutOfDateFlags::TriangleData;
+        mStagingBufferValid = false;
+        prepareSyncCPUData(pRenderContext);
+        syncCPUData();
+
+        // Emissive textures are addressed as by the material sampler, which only exists if there are emissive textures.
+        const Sampler::AddressMode addressModeU = mpSamplerState ? mpSamplerState->getAddressModeU() : Sampler::AddressMode::Wrap;
+        const Sampler::AddressMode addressModeV = mpSamplerState ? mpSamplerState->getAddressModeV() : Sampler::AddressMode::Wrap;
+        EmissiveTriangleIntegrator integrator(addressModeU, addressModeV);
+
+        // Setup the emissive parameters per mesh light. Each texture is read back once.
+        std::unordered_map<const Texture*, uint32_t> textureIDs;
+        std::vector<EmissiveTriangleIntegrator::Material> materials(mMeshLights.size());
+        for (size_t lightIdx = 0; lightIdx < mMeshLights.size(); lightIdx++)
+        {
+            const Material::SharedPtr& pMaterial = scene.getMaterial(mMeshLights[lightIdx].materialID);
+            auto& material = materials[lightIdx];
+            material.emissive = pMaterial->getEmissiveColor();
+            material.emissiveFactor = pMaterial->getEmissiveFactor();
+
+            if (const auto& pTexture = pMaterial->getEmissiveTexture())
+            {
+                auto it = textureIDs.find(pTexture.get());
+                if (it == textureIDs.end())
+                {
+                    std::vector<uint8_t> texels = pRenderContext->readTextureSubresource(pTexture.get(), pTexture->getSubresourceIndex(0, 0));
+                    uint32_t textureID = integrator.addTexture(pTexture->getWidth(), pTexture->getHeight(), pTexture->getFormat(), texels.data());
+                    it = textureIDs.emplace(pTexture.get(), textureID).first;
+                }
+                material.textureID = it->second;
+            }
+        }
+
+        std::vector<EmissiveTriangleIntegrator::Triangle> triangles(mTriangleCount);
+        for (uint32_t triIdx = 0; triIdx < mTriangleCount; triIdx++)
+        {
+            const auto& tri = mMeshLightTriangles[triIdx];
+            for (uint32_t j = 0; j < 3; j++) triangles[triIdx].texCoords[j] = tri.vtx[j].uv;
+            triangles[triIdx].area = tri.area;
+            triangles[triIdx].materialID = tri.lightIdx;
+        }
+
+        std::vector<EmissiveFlux> fluxData = integrator.integrateCached(triangles, materials);
+        assert(fluxData.size() == mTriangleCount);
+
+        // Update the CPU and GPU data.
+        for (uint32_t triIdx = 0; triIdx < mTriangleCount; triIdx++)
+        {
+            mMeshLightTriangles[triIdx].flux = fluxData[triIdx].flux;
+            mMeshLightTriangles[triIdx].averageRadiance = fluxData[triIdx].averageRadiance;
+        }
+        mpFluxData->setBlob(fluxData.data(), 0, fluxData.size() * sizeof(EmissiveFlux));
+        mCPUInvalidData = CPUOutOfDateFlags::None;
+
+        mIntegrationStats = integrator.getStats();
+        if (mIntegrationStats.cached)
+        {
+            logInfo("LightCollection: Loaded " + std::to_string(mTriangleCount) + " pre-integrated emissive triangles from the cache.");
+        }
+        else
+        {
+            std::ostringstream oss;
+            oss << "LightCollection: Integrated " << mTriangleCount << " emissive triangles (" << mIntegrationStats.texturedTriangleCount << " textured) on the host in "
+                << mIntegrationStats.time * 1000.0 << " ms (" << mIntegrationStats.getTrianglesPerSecond() << " triangles/s).";
+            logInfo(oss.str());
+        }
+        return true;
+    }
+
     void LightCollection::computeStats() const
     {
         if (mStatsValid) return;
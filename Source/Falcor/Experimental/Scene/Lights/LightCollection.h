@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include "MeshLightData.slang"
+#include "EmissiveTriangleIntegrator.h"
 
 namespace Falcor
 {
@@ -109,9 +110,10 @@ namespace Falcor
             Note that update() must be called before the collection is ready to use.
             \param[in] pRenderContext The render context.
             \param[in] pScene The scene.
+            \param[in] integrateOnHost Pre-integrate the emissive triangles on the host. If false, or if an emissive texture format is not supported on the host, they are integrated on the GPU.
             \return Ptr to the created object, or nullptr if an error occured.
         */
-        static SharedPtr create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene);
+        static SharedPtr create(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, bool integrateOnHost = true);
 
         /** Updates the light collection to the current state of the scene.
             \param[in] pRenderContext The render context.
@@ -138,6 +140,11 @@ namespace Falcor
         */
         const MeshLightStats& getStats() const { computeStats(); return mMeshLightStats; }
 
+        /** Returns stats of the pre-integration of the emissive triangles on the host.
+            The triangle count is zero if the triangles were integrated on the GPU.
+        */
+        const EmissiveTriangleIntegrator::Stats& getIntegrationStats() const { return mIntegrationStats; }
+
         /** Returns a CPU buffer with all emissive triangles in world space.
             Note that update() must have been called before for the data to be valid.
             Call prepareSyncCPUData() ahead of time to avoid stalling the GPU.
@@ -173,13 +180,14 @@ namespace Falcor
     protected:
         LightCollection() = default;
 
-        bool init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene);
+        bool init(RenderContext* pRenderContext, const std::shared_ptr<Scene>& pScene, bool integrateOnHost);
         bool initIntegrator(const Scene& scene);
         bool setupMeshLights(const Scene& scene);
         void build(RenderContext* pRenderContext, const Scene& scene);
         void prepareTriangleData(RenderContext* pRenderContext, const Scene& scene);
         void prepareMeshData(const Scene& scene);
         void integrateEmissive(RenderContext* pRenderContext, const Scene& scene);
+        bool integrateEmissiveOnHost(RenderContext* pRenderContext, const Scene& scene);
         void computeStats() const;
         void buildTriangleList(RenderContext* pRenderContext, const Scene& scene);
         void updateActiveTriangleList();
@@ -198,6 +206,8 @@ namespace Falcor
         mutable std::vector<uint32_t>           mActiveTriangleList;    ///< List of active (non-culled) emissive triangles.
         mutable MeshLightStats                  mMeshLightStats;        ///< Stats before/after pre-processing of mesh lights. Do not access this directly, use getStats() which ensures the stats are up-to-date.
         mutable bool                            mStatsValid = false;    ///< True when stats are valid.
+        bool                                    mIntegrateOnHost = true; ///< Pre-integrate the emissive triangles on the host when possible.
+        EmissiveTriangleIntegrator::Stats       mIntegrationStats;      ///< Stats of the host pre-integration.
 
         // GPU resources for the mesh lights and emissive triangles.
         Buffer::SharedPtr                       mpTriangleData;         ///< Per-triangle geometry data for emissive triangles (mTriangleCount elements).
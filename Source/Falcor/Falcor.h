@@ -129,6 +129,7 @@
 #include "Utils/Algorithm/ParallelReduction.h"
 #include "Utils/Image/Bitmap.h"
 #include "Utils/Image/ImageIO.h"
+#include "Utils/Image/ImageSequence.h"
 #include "Utils/Math/CubicSpline.h"
 #include "Utils/Math/FalcorMath.h"
 #include "Utils/Scripting/Dictionary.h"
@@ -415,6 +415,7 @@ namespace Falcor
         c.pRenderContext = pContext;
         c.defaultTexDims = mCompilerDeps.defaultResourceProps.dims;
         c.defaultTexFormat = mCompilerDeps.defaultResourceProps.format;
+        c.prepareWorkerCount = mPrepareWorkerCount;
         mpExe->execute(c);
     }
 
@@ -590,6 +591,13 @@ namespace Falcor
         return mNodeData.find(graphOut.nodeId)->second.name + "." + graphOut.field;
     }
 
+    void RenderGraph::setResourceAliasingEnabled(bool enabled)
+    {
+        if (mCompilerDeps.defaultResourceProps.enableAliasing == enabled) return;
+        mCompilerDeps.defaultResourceProps.enableAliasing = enabled;
+        mRecompile = true;
+    }
+
     void RenderGraph::onResize(const Fbo* pTargetFbo)
     {
         // Store the back-buffer values
@@ -740,6 +748,51 @@ namespace Falcor
             widget.separator();
         }
 
+        if (auto resourceGroup = widget.group("Resource Allocation"))
+        {
+            bool enableAliasing = isResourceAliasingEnabled();
+            if (resourceGroup.checkbox("Alias transient resources", enableAliasing)) setResourceAliasingEnabled(enableAliasing);
+            resourceGroup.tooltip("Share resources between fields whose lifetimes don't overlap.\n"
+                "Graph outputs, internal and persistent resources are never shared.", true);
+
+            if (mpExe)
+            {
+                const auto& stats = mpExe->getAllocationStats();
+                std::ostringstream oss;
+                oss << "Resources: " << stats.resourceCount << " for " << stats.fieldCount << " fields" << std::endl
+                    << "Allocated memory: " << formatByteSize(stats.allocatedBytes) << std::endl
+                    << "Naive memory: " << formatByteSize(stats.naiveBytes) << std::endl
+                    << "Peak live memory: " << formatByteSize(stats.peakBytes) << std::endl;
+                resourceGroup.text(oss.str());
+            }
+        }
+
+        if (auto executionGroup = widget.group("Execution"))
+        {
+            executionGroup.var("Prepare worker threads", mPrepareWorkerCount, 0u, Threading::getLogicalThreadCount());
+            executionGroup.tooltip("Number of worker threads preparing independent passes on the CPU while the main thread records GPU work.\n"
+                "Only passes implementing RenderPass::prepareExecute() benefit from this.", true);
+
+            if (mpExe)
+            {
+                const auto& scheduler = mpExe->getScheduler();
+                double prepareTime = 0.0, recordTime = 0.0, waitTime = 0.0;
+                for (const auto& t : scheduler.getTimings())
+                {
+                    prepareTime += t.prepareTime;
+                    recordTime += t.recordTime;
+                    waitTime += t.waitTime;
+                }
+                std::ostringstream oss;
+                oss << scheduler.getPassCount() << " passes in " << scheduler.getLevelCount() << " dependency levels" << std::endl
+                    << std::fixed << std::setprecision(3)
+                    << "CPU prepare: " << prepareTime << " ms" << std::endl
+                    << "CPU execute: " << recordTime << " ms" << std::endl
+                    << "Wait for workers: " << waitTime << " ms" << std::endl;
+                executionGroup.text(oss.str());
+            }
+        }
+
         if (mpExe) mpExe->renderUI(widget);
     }
 
@@ -763,6 +816,8 @@ namespace Falcor
         pybind11::class_<RenderGraph, RenderGraph::SharedPtr> renderGraph(m, "RenderGraph");
         renderGraph.def(pybind11::init(&RenderGraph::create));
         renderGraph.def_property("name", &RenderGraph::getName, &RenderGraph::setName);
+        renderGraph.def_property("resourceAliasing", &RenderGraph::isResourceAliasingEnabled, &RenderGraph::setResourceAliasingEnabled);
+        renderGraph.def_property("prepareWorkerCount", &RenderGraph::getPrepareWorkerCount, &RenderGraph::setPrepareWorkerCount);
         renderGraph.def(RenderGraphIR::kAddPass, &RenderGraph::addPass, "pass"_a, "name"_a);
         renderGraph.def(RenderGraphIR::kRemovePass, &RenderGraph::removePass, "name"_a);
         renderGraph.def(RenderGraphIR::kAddEdge, &RenderGraph::addEdge, "src"_a, "dst"_a);
@@ -200,6 +200,22 @@ namespace Falcor
         */
         void setName(const std::string& name) { mName = name; }
 
+        /** Enable/disable sharing of resources between fields whose lifetimes don't overlap. Changing the setting triggers a recompile.
+        */
+        void setResourceAliasingEnabled(bool enabled);
+
+        /** Check if resource aliasing is enabled
+        */
+        bool isResourceAliasingEnabled() const { return mCompilerDeps.defaultResourceProps.enableAliasing; }
+
+        /** Set the number of worker threads running RenderPass::prepareExecute() concurrently. With 0 workers, passes are prepared on the calling thread.
+        */
+        void setPrepareWorkerCount(uint32_t workerCount) { mPrepareWorkerCount = workerCount; }
+
+        /** Get the number of worker threads running RenderPass::prepareExecute()
+        */
+        uint32_t getPrepareWorkerCount() const { return mPrepareWorkerCount; }
+
         /** Compile the graph
         */
         bool compile(RenderContext* pContext, std::string& log);
@@ -259,5 +275,6 @@ namespace Falcor
         RenderGraphExe::SharedPtr mpExe;
         bool mRecompile = false;
         RenderGraphCompiler::Dependencies mCompilerDeps;
+        uint32_t mPrepareWorkerCount = 0;
     };
 }
@@ -63,6 +63,7 @@ namespace Falcor
         {
             pExe->insertPass(e.name, e.pPass);
         }
+        pExe->mpScheduler = c.createScheduler();
         c.restoreCompilationChanges();
         pExe->mpResourceCache = pResourcesCache;
         return pExe;
@@ -235,13 +236,6 @@ namespace Falcor
 
     void RenderGraphCompiler::allocateResources(ResourceCache* pResourceCache)
     {
-        // Build list to look up execution order index from the pass
-        std::unordered_map<RenderPass*, uint32_t> passToIndex;
-        for (size_t i = 0; i < mExecutionList.size(); i++)
-        {
-            passToIndex.emplace(mExecutionList[i].pPass.get(), uint32_t(i));
-        }
-
         for (size_t i = 0; i < mExecutionList.size(); i++)
         {
             uint32_t nodeIndex = mExecutionList[i].index;
@@ -303,9 +297,8 @@ namespace Falcor
                 std::string srcFieldName = mGraph.mNodeData[pEdge->getSourceNode()].name + '.' + edgeData.srcField;
                 std::string dstFieldName = mGraph.mNodeData[nodeIndex].name + '.' + dstField.getName();
 
-                const auto& pSrcPass = mGraph.mNodeData[pEdge->getSourceNode()].pPass.get();
-                const auto& srcReflection = mExecutionList[passToIndex.at(pSrcPass)].reflector;
-                pResourceCache->registerField(dstFieldName, dstField, passToIndex[pSrcPass], srcFieldName);
+                // The lifetime of the resource extends to the last pass reading it
+                pResourceCache->registerField(dstFieldName, dstField, uint32_t(i), srcFieldName);
             }
         }
 
@@ -313,6 +306,27 @@ namespace Falcor
     }
 
 
+    std::unique_ptr<RenderGraphScheduler> RenderGraphCompiler::createScheduler() const
+    {
+        std::unordered_map<uint32_t, uint32_t> nodeToIndex;
+        for (size_t i = 0; i < mExecutionList.size(); i++) nodeToIndex[mExecutionList[i].index] = uint32_t(i);
+
+        // Every incoming edge is a dependency, both the ones carrying resources and execution-edges
+        auto pScheduler = std::make_unique<RenderGraphScheduler>((uint32_t)mExecutionList.size());
+        for (size_t i = 0; i < mExecutionList.size(); i++)
+        {
+            const DirectedGraph::Node* pNode = mGraph.mpGraph->getNode(mExecutionList[i].index);
+            assert(pNode);
+            for (uint32_t e = 0; e < pNode->getIncomingEdgeCount(); e++)
+            {
+                uint32_t srcNode = mGraph.mpGraph->getEdge(pNode->getIncomingEdge(e))->getSourceNode();
+                auto it = nodeToIndex.find(srcNode);
+                if (it != nodeToIndex.end()) pScheduler->addDependency(uint32_t(i), it->second);
+            }
+        }
+        return pScheduler;
+    }
+
     void RenderGraphCompiler::restoreCompilationChanges()
     {
         for (const auto& name : mCompilationChanges.generatedPasses) mGraph.removePass(name);
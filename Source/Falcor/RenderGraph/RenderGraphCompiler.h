@@ -69,6 +69,7 @@ namespace Falcor
         bool insertAutoPasses();
         void allocateResources(ResourceCache* pResourceCache);
         void validateGraph() const;
+        std::unique_ptr<RenderGraphScheduler> createScheduler() const;
         void restoreCompilationChanges();
         RenderPass::CompileData prepPassCompilationData(const PassData& passData);
     };
@@ -34,19 +34,34 @@ namespace Falcor
     {
         PROFILE("RenderGraphExe::execute()");
 
-        for (const auto& pass : mExecutionList)
+        assert(mpScheduler && mpScheduler->getPassCount() == mExecutionList.size());
+        mpScheduler->setWorkerCount(ctx.prepareWorkerCount);
+
+        // The profiler isn't thread-safe, so only the execution on the calling thread is profiled
+        auto prepare = [&](uint32_t passIndex)
         {
+            const auto& pass = mExecutionList[passIndex];
+            RenderData renderData(pass.name, mpResourceCache, ctx.pGraphDictionary, ctx.defaultTexDims, ctx.defaultTexFormat);
+            pass.pPass->prepareExecute(renderData);
+        };
+
+        auto record = [&](uint32_t passIndex)
+        {
+            const auto& pass = mExecutionList[passIndex];
             PROFILE(pass.name);
 
             RenderData renderData(pass.name, mpResourceCache, ctx.pGraphDictionary, ctx.defaultTexDims, ctx.defaultTexFormat);
             pass.pPass->execute(ctx.pRenderContext, renderData);
-        }
+        };
+
+        mpScheduler->execute(prepare, record);
     }
 
     void RenderGraphExe::renderUI(Gui::Widgets& widget)
     {
-        for (const auto& p : mExecutionList)
+        for (size_t passIndex = 0; passIndex < mExecutionList.size(); passIndex++)
         {
+            const auto& p = mExecutionList[passIndex];
             const auto& pPass = p.pPass;
 
             if (auto passGroup = widget.group(p.name))
@@ -54,6 +69,16 @@ namespace Falcor
                 // If you are thinking about displaying the profiler results next to the group label, it won't work. Since the times change every frame, IMGUI thinks it's a different group and will not expand it
                 const auto& desc = pPass->getDesc();
                 if (desc.size()) passGroup.tooltip(desc);
+
+                if (mpScheduler)
+                {
+                    const auto& t = mpScheduler->getTimings()[passIndex];
+                    std::ostringstream oss;
+                    oss << std::fixed << std::setprecision(3) << "CPU prepare " << t.prepareTime << " ms" << (t.preparedOnWorker ? " (worker)" : "")
+                        << ", execute " << t.recordTime << " ms";
+                    passGroup.text(oss.str());
+                }
+
                 pPass->renderUI(passGroup);
             }
         }
@@ -29,6 +29,7 @@
 #include "ResourceCache.h"
 #include "Utils/InternalDictionary.h"
 #include "RenderPass.h"
+#include "RenderGraphScheduler.h"
 
 namespace Falcor
 {
@@ -44,6 +45,7 @@ namespace Falcor
             InternalDictionary::SharedPtr pGraphDictionary;
             uint2 defaultTexDims;
             ResourceFormat defaultTexFormat;
+            uint32_t prepareWorkerCount = 0;    ///< Number of worker threads for RenderPass::prepareExecute(). With 0 workers, passes are prepared on the calling thread.
         };
 
         /** Execute the graph
@@ -73,6 +75,14 @@ namespace Falcor
         */
         Resource::SharedPtr getResource(const std::string& name) const;
 
+        /** Get memory statistics of the resources allocated for the graph
+        */
+        const ResourceCache::AllocationStats& getAllocationStats() const { return mpResourceCache->getAllocationStats(); }
+
+        /** Get the pass dependency graph and the CPU timings of the last execute() call. Passes are indexed in execution order.
+        */
+        const RenderGraphScheduler& getScheduler() const { return *mpScheduler; }
+
         /** Set an external input resource
             \param[in] name Input name. Has the format `renderPassName.resourceName`
             \param[in] pResource The resource to bind. If this is nullptr, will unregister the resource
@@ -97,5 +107,6 @@ namespace Falcor
 
         std::vector<Pass> mExecutionList;
         ResourceCache::SharedPtr mpResourceCache;
+        std::unique_ptr<RenderGraphScheduler> mpScheduler;
     };
 }
@@ -0,0 +1,226 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "RenderGraphScheduler.h"
+
+namespace Falcor
+{
+    RenderGraphScheduler::RenderGraphScheduler(uint32_t passCount)
+        : mPasses(passCount)
+        , mTimings(passCount)
+    {
+    }
+
+    RenderGraphScheduler::~RenderGraphScheduler()
+    {
+        setWorkerCount(0);
+    }
+
+    void RenderGraphScheduler::addDependency(uint32_t passIndex, uint32_t dependencyIndex)
+    {
+        if (passIndex >= getPassCount() || dependencyIndex >= getPassCount())
+        {
+            throw std::exception("RenderGraphScheduler::addDependency() - pass index is out of range");
+        }
+        if (dependencyIndex >= passIndex)
+        {
+            throw std::exception("RenderGraphScheduler::addDependency() - a pass can only depend on passes earlier in the execution order");
+        }
+
+        auto& dependencies = mPasses[passIndex].dependencies;
+        if (std::find(dependencies.begin(), dependencies.end(), dependencyIndex) != dependencies.end()) return;
+
+        dependencies.push_back(dependencyIndex);
+        mPasses[dependencyIndex].dependents.push_back(passIndex);
+
+        // Dependencies always point backwards in the execution order, so levels of later passes are updated in order.
+        for (uint32_t i = passIndex; i < getPassCount(); i++)
+        {
+            uint32_t level = 0;
+            for (uint32_t d : mPasses[i].dependencies) level = std::max(level, mPasses[d].level + 1);
+            mPasses[i].level = level;
+        }
+    }
+
+    uint32_t RenderGraphScheduler::getLevelCount() const
+    {
+        uint32_t count = 0;
+        for (const auto& p : mPasses) count = std::max(count, p.level + 1);
+        return count;
+    }
+
+    void RenderGraphScheduler::setWorkerCount(uint32_t workerCount)
+    {
+        if (workerCount == mWorkers.size()) return;
+
+        // Stop the current workers
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+        }
+        mWorkAvailable.notify_all();
+        for (auto& t : mWorkers) t.join();
+        mWorkers.clear();
+        mTerminate = false;
+
+        for (uint32_t i = 0; i < workerCount; i++) mWorkers.emplace_back(&RenderGraphScheduler::workerLoop, this);
+    }
+
+    void RenderGraphScheduler::workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true)
+        {
+            mWorkAvailable.wait(lock, [this]() { return mTerminate || !mReadyQueue.empty(); });
+            if (mTerminate) return;
+
+            uint32_t passIndex = mReadyQueue.front();
+            mReadyQueue.pop_front();
+
+            // The calling thread may have picked up the pass itself in the meantime
+            if (mPasses[passIndex].state != State::Ready) continue;
+            mPasses[passIndex].state = State::Preparing;
+
+            const PassFunc& prepare = *mpPrepare;
+            lock.unlock();
+            runPrepare(passIndex, prepare, true);
+            lock.lock();
+
+            mPasses[passIndex].state = State::Prepared;
+            mPassPrepared.notify_all();
+        }
+    }
+
+    void RenderGraphScheduler::runPrepare(uint32_t passIndex, const PassFunc& prepare, bool onWorker)
+    {
+        auto start = CpuTimer::getCurrentTimePoint();
+        try
+        {
+            prepare(passIndex);
+        }
+        catch (...)
+        {
+            mPasses[passIndex].pException = std::current_exception();
+        }
+        mTimings[passIndex].prepareTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        mTimings[passIndex].preparedOnWorker = onWorker;
+    }
+
+    void RenderGraphScheduler::execute(const PassFunc& prepare, const PassFunc& record)
+    {
+        const uint32_t passCount = getPassCount();
+        mTimings.assign(passCount, {});
+
+        // Reset the per-execution state and queue the passes without dependencies
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mpPrepare = &prepare;
+            mReadyQueue.clear();
+            for (uint32_t i = 0; i < passCount; i++)
+            {
+                auto& p = mPasses[i];
+                p.pendingDependencies = (uint32_t)p.dependencies.size();
+                p.pException = nullptr;
+                p.state = p.pendingDependencies == 0 ? State::Ready : State::Waiting;
+                if (p.state == State::Ready) mReadyQueue.push_back(i);
+            }
+        }
+        mWorkAvailable.notify_all();
+
+        std::exception_ptr pException;
+        for (uint32_t i = 0; i < passCount && !pException; i++)
+        {
+            auto& p = mPasses[i];
+
+            // Make sure the pass is prepared. If no worker picked it up yet, prepare it here instead of waiting.
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                assert(p.state != State::Waiting);
+                if (p.state == State::Ready)
+                {
+                    p.state = State::Preparing;
+                    lock.unlock();
+                    runPrepare(i, prepare, false);
+                    lock.lock();
+                    p.state = State::Prepared;
+                }
+                else
+                {
+                    auto start = CpuTimer::getCurrentTimePoint();
+                    mPassPrepared.wait(lock, [&p]() { return p.state == State::Prepared; });
+                    mTimings[i].waitTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+                }
+                pException = p.pException;
+            }
+            if (pException) break;
+
+            auto start = CpuTimer::getCurrentTimePoint();
+            try
+            {
+                record(i);
+            }
+            catch (...)
+            {
+                pException = std::current_exception();
+            }
+            mTimings[i].recordTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+            // Release the dependents whose dependencies have all been recorded
+            bool queued = false;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                p.state = State::Recorded;
+                for (uint32_t d : p.dependents)
+                {
+                    auto& dependent = mPasses[d];
+                    assert(dependent.pendingDependencies > 0);
+                    if (--dependent.pendingDependencies == 0)
+                    {
+                        dependent.state = State::Ready;
+                        mReadyQueue.push_back(d);
+                        queued = true;
+                    }
+                }
+            }
+            if (queued) mWorkAvailable.notify_all();
+        }
+
+        // Don't leave workers running user code after returning. Passes that were never reached are dropped.
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mReadyQueue.clear();
+            mPassPrepared.wait(lock, [this]()
+            {
+                return std::none_of(mPasses.begin(), mPasses.end(), [](const PassData& p) { return p.state == State::Preparing; });
+            });
+            mpPrepare = nullptr;
+        }
+
+        if (pException) std::rethrow_exception(pException);
+    }
+}
@@ -0,0 +1,140 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Utils/Timing/CpuTimer.h"
+
+namespace Falcor
+{
+    /** Dependency graph of the passes of a compiled render graph and the executor running them.
+
+        Passes are identified by their index in the execution order, which is a topological order of the graph.
+        Each pass has two phases:
+        - prepare: CPU-only work. It may run on a worker thread, concurrently with other passes.
+        - record: submission of GPU work. It always runs on the calling thread, in execution order, since the render context isn't thread-safe.
+
+        The preparation of a pass starts once all passes it depends on have been recorded, as it may read state they produced.
+        Passes without a path between them in the graph can therefore prepare concurrently while the calling thread records.
+
+        The class doesn't know anything about render passes, which allows testing the scheduling with mock passes.
+    */
+    class dlldecl RenderGraphScheduler
+    {
+    public:
+        using PassFunc = std::function<void(uint32_t passIndex)>;
+
+        /** CPU timing of a pass for the last execute() call, in milliseconds.
+        */
+        struct PassTiming
+        {
+            double prepareTime = 0.0;   ///< Time spent in the prepare phase.
+            double recordTime = 0.0;    ///< Time spent in the record phase.
+            double waitTime = 0.0;      ///< Time the calling thread waited for the prepare phase to finish on a worker thread.
+            bool preparedOnWorker = false;
+        };
+
+        /** Create a scheduler.
+            \param[in] passCount Number of passes.
+        */
+        RenderGraphScheduler(uint32_t passCount = 0);
+        ~RenderGraphScheduler();
+
+        RenderGraphScheduler(const RenderGraphScheduler&) = delete;
+        RenderGraphScheduler& operator=(const RenderGraphScheduler&) = delete;
+
+        /** Add a dependency between two passes.
+            \param[in] passIndex The dependent pass.
+            \param[in] dependencyIndex The pass it depends on. Must be executed before passIndex.
+        */
+        void addDependency(uint32_t passIndex, uint32_t dependencyIndex);
+
+        uint32_t getPassCount() const { return (uint32_t)mPasses.size(); }
+        const std::vector<uint32_t>& getDependencies(uint32_t passIndex) const { return mPasses[passIndex].dependencies; }
+        const std::vector<uint32_t>& getDependents(uint32_t passIndex) const { return mPasses[passIndex].dependents; }
+
+        /** Get the level of a pass, i.e. the length of the longest dependency chain leading to it.
+            Passes on the same level are independent of each other.
+        */
+        uint32_t getLevel(uint32_t passIndex) const { return mPasses[passIndex].level; }
+
+        /** Get the number of levels. This is the length of the critical path through the graph.
+        */
+        uint32_t getLevelCount() const;
+
+        /** Set the number of worker threads used for the prepare phase. With 0 workers all passes are prepared on the calling thread.
+        */
+        void setWorkerCount(uint32_t workerCount);
+        uint32_t getWorkerCount() const { return (uint32_t)mWorkers.size(); }
+
+        /** Run all passes.
+            Exceptions thrown by the prepare phase are rethrown on the calling thread when the pass is reached.
+            \param[in] prepare Function running the prepare phase of a pass. Can be called from any thread.
+            \param[in] record Function running the record phase of a pass. Called on the calling thread in execution order.
+        */
+        void execute(const PassFunc& prepare, const PassFunc& record);
+
+        /** Get the timings of the last execute() call.
+        */
+        const std::vector<PassTiming>& getTimings() const { return mTimings; }
+
+    private:
+        enum class State
+        {
+            Waiting,    ///< Waiting for dependencies to be recorded.
+            Ready,      ///< Can be prepared.
+            Preparing,
+            Prepared,
+            Recorded,
+        };
+
+        struct PassData
+        {
+            std::vector<uint32_t> dependencies;
+            std::vector<uint32_t> dependents;
+            uint32_t level = 0;
+
+            // Per-execution state, protected by mMutex.
+            State state = State::Waiting;
+            uint32_t pendingDependencies = 0;
+            std::exception_ptr pException;
+        };
+
+        void workerLoop();
+        void runPrepare(uint32_t passIndex, const PassFunc& prepare, bool onWorker);
+
+        std::vector<PassData> mPasses;
+        std::vector<PassTiming> mTimings;
+
+        std::vector<std::thread> mWorkers;
+        std::mutex mMutex;
+        std::condition_variable mWorkAvailable;
+        std::condition_variable mPassPrepared;
+        std::deque<uint32_t> mReadyQueue;
+        const PassFunc* mpPrepare = nullptr;
+        bool mTerminate = false;
+    };
+}
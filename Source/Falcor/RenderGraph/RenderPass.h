@@ -113,6 +113,12 @@ namespace Falcor
         */
         virtual void compile(RenderContext* pContext, const CompileData& compileData) {}
 
+        /** Optional CPU-side preparation, called every frame before execute().
+            The render graph may call this on a worker thread, concurrently with the preparation and execution of passes that don't depend on this one.
+            All passes this pass depends on have executed when it is called. Don't use the render context or write to the graph dictionary here.
+        */
+        virtual void prepareExecute(const RenderData& renderData) {}
+
         /** Executes the pass.
         */
         virtual void execute(RenderContext* pRenderContext, const RenderData& renderData) = 0;
@@ -0,0 +1,133 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "ResourceAliasingPlanner.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        bool hasBindFlagConflict(ResourceBindFlags flags)
+        {
+            return is_set(flags, ResourceBindFlags::DepthStencil) && is_set(flags, ResourceBindFlags::RenderTarget | ResourceBindFlags::UnorderedAccess);
+        }
+
+        /** Compute the largest total footprint of requests that are alive at the same time.
+            The maximum is always reached at the start of some lifetime, so it's enough to sweep over start and end events.
+        */
+        uint64_t computePeakBytes(const std::vector<ResourceAliasingPlanner::Request>& requests)
+        {
+            // Events are (time, isEnd, size). Lifetimes are inclusive, so a resource is released at the index after its last use.
+            std::vector<std::tuple<uint64_t, bool, uint64_t>> events;
+            events.reserve(requests.size() * 2);
+            for (const auto& r : requests)
+            {
+                events.emplace_back(r.lifetime.first, false, r.byteSize);
+                events.emplace_back(uint64_t(r.lifetime.second) + 1, true, r.byteSize);
+            }
+            std::sort(events.begin(), events.end(), [](const auto& a, const auto& b)
+            {
+                if (std::get<0>(a) != std::get<0>(b)) return std::get<0>(a) < std::get<0>(b);
+                return std::get<1>(a) && !std::get<1>(b); // Release before allocating at the same index
+            });
+
+            uint64_t live = 0, peak = 0;
+            for (const auto& [time, isEnd, size] : events)
+            {
+                if (isEnd) live -= size;
+                else live += size;
+                peak = std::max(peak, live);
+            }
+            return peak;
+        }
+    }
+
+    bool ResourceAliasingPlanner::areBindFlagsCompatible(ResourceBindFlags a, ResourceBindFlags b)
+    {
+        if (!hasBindFlagConflict(a | b)) return true;
+        return hasBindFlagConflict(a) && hasBindFlagConflict(b);
+    }
+
+    ResourceAliasingPlanner::Plan ResourceAliasingPlanner::plan(const std::vector<Request>& requests)
+    {
+        Plan plan;
+        plan.requestToSlot.resize(requests.size());
+
+        // Visit the requests in order of first use. Ties are broken by index to keep the plan deterministic.
+        std::vector<uint32_t> order(requests.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return requests[a].lifetime.first < requests[b].lifetime.first; });
+
+        std::unordered_map<std::string, std::vector<uint32_t>> slotsPerKey;
+
+        for (uint32_t requestIndex : order)
+        {
+            const Request& r = requests[requestIndex];
+            assert(r.lifetime.first <= r.lifetime.second);
+            plan.naiveBytes += r.byteSize;
+
+            // Find a free slot with the same key. Among the candidates pick the one that was released last,
+            // which keeps slots that were released early available for requests with other bind flags.
+            uint32_t slotIndex = uint32_t(-1);
+            if (r.canAlias)
+            {
+                for (uint32_t candidate : slotsPerKey[r.compatibilityKey])
+                {
+                    const Slot& s = plan.slots[candidate];
+                    if (s.lifetime.second >= r.lifetime.first) continue;
+                    if (!areBindFlagsCompatible(s.bindFlags, r.bindFlags)) continue;
+                    if (slotIndex == uint32_t(-1) || s.lifetime.second > plan.slots[slotIndex].lifetime.second) slotIndex = candidate;
+                }
+            }
+
+            if (slotIndex == uint32_t(-1))
+            {
+                slotIndex = (uint32_t)plan.slots.size();
+                Slot s;
+                s.compatibilityKey = r.compatibilityKey;
+                s.bindFlags = r.bindFlags;
+                s.lifetime = r.lifetime;
+                s.canAlias = r.canAlias;
+                plan.slots.push_back(s);
+                if (r.canAlias) slotsPerKey[r.compatibilityKey].push_back(slotIndex);
+            }
+
+            Slot& s = plan.slots[slotIndex];
+            s.bindFlags |= r.bindFlags;
+            s.lifetime.second = std::max(s.lifetime.second, r.lifetime.second);
+            s.byteSize = std::max(s.byteSize, r.byteSize);
+            s.requests.push_back(requestIndex);
+            plan.requestToSlot[requestIndex] = slotIndex;
+        }
+
+        for (const auto& s : plan.slots) plan.plannedBytes += s.byteSize;
+        plan.peakBytes = computePeakBytes(requests);
+
+        return plan;
+    }
+}
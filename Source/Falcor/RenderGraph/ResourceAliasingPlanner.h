@@ -0,0 +1,84 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/API/Formats.h"
+
+namespace Falcor
+{
+    /** Plans how transient render graph resources can share memory.
+
+        Every request describes a resource together with the range of execution indices in which it is used.
+        Requests with identical compatibility keys, compatible bind flags and non-overlapping lifetimes are
+        assigned to the same slot, so a single allocation can back all of them. This is greedy interval colouring
+        done independently for each compatibility key.
+
+        The planner doesn't touch the GPU, which makes it possible to test it on synthetic graphs.
+    */
+    class dlldecl ResourceAliasingPlanner
+    {
+    public:
+        struct Request
+        {
+            std::string compatibilityKey;                           ///< Only requests with equal keys can share a slot. The key should encode resource type, dimensions, format etc.
+            ResourceBindFlags bindFlags = ResourceBindFlags::None;  ///< Bind flags required by the request. A shared slot uses the union of the flags of its requests.
+            std::pair<uint32_t, uint32_t> lifetime = { 0, 0 };      ///< Inclusive range of execution indices in which the resource is used.
+            uint64_t byteSize = 0;                                  ///< Estimated memory footprint of the resource.
+            bool canAlias = true;                                   ///< If false, the request is given a slot of its own (graph outputs, internal and persistent resources).
+        };
+
+        struct Slot
+        {
+            std::string compatibilityKey;                           ///< Compatibility key shared by all requests in the slot.
+            ResourceBindFlags bindFlags = ResourceBindFlags::None;  ///< Union of the bind flags of the requests in the slot.
+            std::pair<uint32_t, uint32_t> lifetime = { 0, 0 };      ///< Range covering the lifetimes of all requests in the slot.
+            uint64_t byteSize = 0;                                  ///< Largest footprint of the requests in the slot.
+            bool canAlias = true;                                   ///< False if the slot holds a single request that can't be shared.
+            std::vector<uint32_t> requests;                         ///< Indices of the requests in the slot, ordered by first use.
+        };
+
+        struct Plan
+        {
+            std::vector<Slot> slots;
+            std::vector<uint32_t> requestToSlot;    ///< Slot index for each request.
+            uint64_t naiveBytes = 0;                ///< Memory required if every request gets an allocation of its own.
+            uint64_t plannedBytes = 0;              ///< Memory required by the slots of the plan.
+            uint64_t peakBytes = 0;                 ///< Largest total footprint of requests alive at the same time. This is a lower bound for any plan.
+        };
+
+        /** Compute an aliasing plan.
+            \param[in] requests List of resource requests.
+            \return The plan. Every request is assigned to exactly one slot.
+        */
+        static Plan plan(const std::vector<Request>& requests);
+
+        /** Check if two sets of bind flags can be combined on a single resource.
+            Depth-stencil resources can't also be render targets or UAVs, so such combinations are only allowed if both sets already contain them.
+        */
+        static bool areBindFlagsCompatible(ResourceBindFlags a, ResourceBindFlags b);
+    };
+}
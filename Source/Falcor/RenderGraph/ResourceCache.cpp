@@ -28,6 +28,7 @@
 #include "stdafx.h"
 #include "ResourceCache.h"
 #include "Core/API/Texture.h"
+#include "ResourceAliasingPlanner.h"
 
 namespace Falcor
 {
@@ -40,6 +41,7 @@ namespace Falcor
     {
         mNameToIndex.clear();
         mResourceData.clear();
+        mAllocationStats = {};
     }
 
     const Resource::SharedPtr& ResourceCache::getResource(const std::string& name) const
@@ -115,85 +117,202 @@ namespace Falcor
         }
     }
 
-    Resource::SharedPtr createResourceForPass(const ResourceCache::DefaultProperties& params, const RenderPassReflection::Field& field, bool resolveBindFlags, const std::string& resourceName)
+    namespace
     {
-        uint32_t width = field.getWidth() ? field.getWidth() : params.dims.x;
-        uint32_t height = field.getHeight() ? field.getHeight() : params.dims.y;
-        uint32_t depth = field.getDepth() ? field.getDepth() : 1;
-        uint32_t sampleCount = field.getSampleCount() ? field.getSampleCount() : 1;
-        auto bindFlags = field.getBindFlags();
-        auto arraySize = field.getArraySize();
-        auto mipLevels = field.getMipCount();
-
-        ResourceFormat format = ResourceFormat::Unknown;
+        /** Resource description with all defaults resolved.
+        */
+        struct ResolvedDesc
+        {
+            RenderPassReflection::Field::Type type;
+            uint32_t width;
+            uint32_t height;
+            uint32_t depth;
+            uint32_t sampleCount;
+            uint32_t arraySize;
+            uint32_t mipLevels;
+            ResourceFormat format = ResourceFormat::Unknown;
+            ResourceBindFlags bindFlags;
+        };
 
-        if (!field.isBuffer())
+        ResolvedDesc resolveDesc(const ResourceCache::DefaultProperties& params, const RenderPassReflection::Field& field, bool resolveBindFlags)
         {
-            format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
-            if (resolveBindFlags)
+            ResolvedDesc desc;
+            desc.type = field.getType();
+            desc.width = field.getWidth() ? field.getWidth() : params.dims.x;
+            desc.height = field.getHeight() ? field.getHeight() : params.dims.y;
+            desc.depth = field.getDepth() ? field.getDepth() : 1;
+            desc.sampleCount = field.getSampleCount() ? field.getSampleCount() : 1;
+            desc.bindFlags = field.getBindFlags();
+            desc.arraySize = field.getArraySize();
+            desc.mipLevels = field.getMipCount();
+
+            if (!field.isBuffer())
+            {
+                desc.format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
+                if (resolveBindFlags)
+                {
+                    ResourceBindFlags mask = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
+                    bool isOutput = is_set(field.getVisibility(), RenderPassReflection::Field::Visibility::Output);
+                    bool isInternal = is_set(field.getVisibility(), RenderPassReflection::Field::Visibility::Internal);
+                    if (isOutput || isInternal) mask |= Resource::BindFlags::DepthStencil | Resource::BindFlags::RenderTarget;
+                    auto supported = getFormatBindFlags(desc.format);
+                    mask &= supported;
+                    desc.bindFlags |= mask;
+                }
+            }
+            else // *Buffer
             {
-                ResourceBindFlags mask = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
-                bool isOutput = is_set(field.getVisibility(), RenderPassReflection::Field::Visibility::Output);
-                bool isInternal = is_set(field.getVisibility(), RenderPassReflection::Field::Visibility::Internal);
-                if (isOutput || isInternal) mask |= Resource::BindFlags::DepthStencil | Resource::BindFlags::RenderTarget;
-                auto supported = getFormatBindFlags(format);
-                mask &= supported;
-                bindFlags |= mask;
+                if (field.getType() == RenderPassReflection::Field::Type::TypedBuffer) desc.format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
+                if (resolveBindFlags) desc.bindFlags = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
             }
+            return desc;
         }
-        else // *Buffer
+
+        /** Key identifying resources that are interchangeable apart from their bind flags.
+        */
+        std::string getCompatibilityKey(const ResolvedDesc& desc)
         {
-            if (field.getType() == RenderPassReflection::Field::Type::TypedBuffer) format = field.getFormat() == ResourceFormat::Unknown ? params.format : field.getFormat();
-            if (resolveBindFlags) bindFlags = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
+            std::ostringstream key;
+            key << (uint32_t)desc.type << ':' << desc.width << 'x' << desc.height << 'x' << desc.depth << ':' << (uint32_t)desc.format
+                << ":s" << desc.sampleCount << ":a" << desc.arraySize << ":m" << desc.mipLevels;
+            return key.str();
         }
-        Resource::SharedPtr pResource;
 
-        switch (field.getType())
+        /** Estimate the memory footprint of a resource. Alignment and padding are ignored.
+        */
+        uint64_t estimateByteSize(const ResolvedDesc& desc)
         {
-        case RenderPassReflection::Field::Type::RawBuffer:
-            pResource = Buffer::create(width, bindFlags, Buffer::CpuAccess::None);
-            break;
-        case RenderPassReflection::Field::Type::StructuredBuffer:
-            pResource = Buffer::createStructured(height, width, bindFlags, Buffer::CpuAccess::None);
-            break;
-        case RenderPassReflection::Field::Type::TypedBuffer:
-            pResource = Buffer::createTyped(format, width, bindFlags, Buffer::CpuAccess::None);
-            break;
-        case RenderPassReflection::Field::Type::Texture1D:
-            pResource = Texture::create1D(width, format, arraySize, mipLevels, nullptr, bindFlags);
-            break;
-        case RenderPassReflection::Field::Type::Texture2D:
-            if (sampleCount > 1)
+            using Type = RenderPassReflection::Field::Type;
+            switch (desc.type)
+            {
+            case Type::RawBuffer:
+                return desc.width;
+            case Type::StructuredBuffer:
+                return uint64_t(desc.width) * desc.height;
+            case Type::TypedBuffer:
+                return uint64_t(desc.width) * getFormatBytesPerBlock(desc.format);
+            default:
+                break;
+            }
+
+            uint32_t width = desc.width;
+            uint32_t height = desc.type == Type::Texture1D ? 1 : desc.height;
+            uint32_t depth = desc.type == Type::Texture3D ? desc.depth : 1;
+            uint32_t mipLevels = desc.sampleCount > 1 ? 1 : desc.mipLevels;
+            if (mipLevels == Resource::kMaxPossible) mipLevels = 1 + (uint32_t)std::floor(std::log2((float)std::max(std::max(width, height), depth)));
+
+            uint64_t bytes = 0;
+            for (uint32_t mip = 0; mip < mipLevels; mip++)
             {
-                pResource = Texture::create2DMS(width, height, format, sampleCount, arraySize, bindFlags);
+                uint64_t pixels = uint64_t(std::max(width >> mip, 1u)) * std::max(height >> mip, 1u) * std::max(depth >> mip, 1u);
+                bytes += pixels * getFormatBytesPerBlock(desc.format) / getFormatPixelsPerBlock(desc.format);
             }
-            else
+
+            uint32_t layers = desc.type == Type::TextureCube ? desc.arraySize * 6 : desc.arraySize;
+            return bytes * layers * desc.sampleCount;
+        }
+
+        Resource::SharedPtr createResource(const ResolvedDesc& desc, const std::string& resourceName)
+        {
+            Resource::SharedPtr pResource;
+
+            switch (desc.type)
             {
-                pResource = Texture::create2D(width, height, format, arraySize, mipLevels, nullptr, bindFlags);
+            case RenderPassReflection::Field::Type::RawBuffer:
+                pResource = Buffer::create(desc.width, desc.bindFlags, Buffer::CpuAccess::None);
+                break;
+            case RenderPassReflection::Field::Type::StructuredBuffer:
+                pResource = Buffer::createStructured(desc.height, desc.width, desc.bindFlags, Buffer::CpuAccess::None);
+                break;
+            case RenderPassReflection::Field::Type::TypedBuffer:
+                pResource = Buffer::createTyped(desc.format, desc.width, desc.bindFlags, Buffer::CpuAccess::None);
+                break;
+            case RenderPassReflection::Field::Type::Texture1D:
+                pResource = Texture::create1D(desc.width, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags);
+                break;
+            case RenderPassReflection::Field::Type::Texture2D:
+                if (desc.sampleCount > 1)
+                {
+                    pResource = Texture::create2DMS(desc.width, desc.height, desc.format, desc.sampleCount, desc.arraySize, desc.bindFlags);
+                }
+                else
+                {
+                    pResource = Texture::create2D(desc.width, desc.height, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags);
+                }
+                break;
+            case RenderPassReflection::Field::Type::Texture3D:
+                pResource = Texture::create3D(desc.width, desc.height, desc.depth, desc.format, desc.mipLevels, nullptr, desc.bindFlags);
+                break;
+            case RenderPassReflection::Field::Type::TextureCube:
+                pResource = Texture::createCube(desc.width, desc.height, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags);
+                break;
+            default:
+                should_not_get_here();
+                return nullptr;
             }
-            break;
-        case RenderPassReflection::Field::Type::Texture3D:
-            pResource = Texture::create3D(width, height, depth, format, mipLevels, nullptr, bindFlags);
-            break;
-        case RenderPassReflection::Field::Type::TextureCube:
-            pResource = Texture::createCube(width, height, format, arraySize, mipLevels, nullptr, bindFlags);
-            break;
-        default:
-            should_not_get_here();
-            return nullptr;
+            pResource->setName(resourceName);
+            return pResource;
         }
-        pResource->setName(resourceName);
-        return pResource;
     }
 
     void ResourceCache::allocateResources(const DefaultProperties& params)
     {
-        for (auto& data : mResourceData)
+        // Collect the fields that need a new resource
+        std::vector<uint32_t> pending;
+        std::vector<ResolvedDesc> descs;
+        std::vector<ResourceAliasingPlanner::Request> requests;
+
+        for (uint32_t i = 0; i < (uint32_t)mResourceData.size(); i++)
         {
-            if ((data.pResource == nullptr) && (data.field.isValid()))
-            {
-                data.pResource = createResourceForPass(params, data.field, data.resolveBindFlags, data.name);
-            }
+            const auto& data = mResourceData[i];
+            if ((data.pResource != nullptr) || (!data.field.isValid())) continue;
+
+            ResolvedDesc desc = resolveDesc(params, data.field, data.resolveBindFlags);
+
+            // Graph outputs (lifetime extends to the end of the graph), internal and persistent resources
+            // keep their content across frames and must never share memory with other fields.
+            bool isInternal = is_set(data.field.getVisibility(), RenderPassReflection::Field::Visibility::Internal);
+            bool isPersistent = is_set(data.field.getFlags(), RenderPassReflection::Field::Flags::Persistent);
+            bool isGraphOutput = data.lifetime.second == uint32_t(-1);
+
+            ResourceAliasingPlanner::Request request;
+            request.compatibilityKey = getCompatibilityKey(desc);
+            request.bindFlags = desc.bindFlags;
+            request.lifetime = data.lifetime;
+            request.byteSize = estimateByteSize(desc);
+            request.canAlias = params.enableAliasing && !isInternal && !isPersistent && !isGraphOutput;
+
+            pending.push_back(i);
+            descs.push_back(desc);
+            requests.push_back(request);
+        }
+
+        auto plan = ResourceAliasingPlanner::plan(requests);
+
+        // Create one resource per slot and share it between all fields assigned to the slot
+        for (const auto& slot : plan.slots)
+        {
+            assert(!slot.requests.empty());
+            ResolvedDesc desc = descs[slot.requests[0]];
+            desc.bindFlags = slot.bindFlags;
+
+            std::string name = mResourceData[pending[slot.requests[0]]].name;
+            if (slot.requests.size() > 1) name += " (aliased with " + std::to_string(slot.requests.size() - 1) + " other fields)";
+
+            Resource::SharedPtr pResource = createResource(desc, name);
+            for (uint32_t r : slot.requests) mResourceData[pending[r]].pResource = pResource;
+        }
+
+        mAllocationStats.fieldCount = (uint32_t)requests.size();
+        mAllocationStats.resourceCount = (uint32_t)plan.slots.size();
+        mAllocationStats.naiveBytes = plan.naiveBytes;
+        mAllocationStats.allocatedBytes = plan.plannedBytes;
+        mAllocationStats.peakBytes = plan.peakBytes;
+
+        if (params.enableAliasing && !requests.empty())
+        {
+            logInfo("ResourceCache: allocated " + std::to_string(plan.slots.size()) + " resources for " + std::to_string(requests.size()) + " fields. "
+                "Estimated memory " + formatByteSize(plan.plannedBytes) + " (naive " + formatByteSize(plan.naiveBytes) + ", peak live " + formatByteSize(plan.peakBytes) + ").");
         }
     }
 }
@@ -47,6 +47,18 @@ namespace Falcor
         {
             uint2 dims;                                         ///< Width, height of the swap chain
             ResourceFormat format = ResourceFormat::Unknown;    ///< Format to use for texture creation
+            bool enableAliasing = false;                        ///< Share resources between fields whose lifetimes don't overlap
+        };
+
+        /** Memory statistics for the resources allocated by the cache.
+        */
+        struct AllocationStats
+        {
+            uint32_t fieldCount = 0;        ///< Number of resources requested by the graph (aliased fields count once).
+            uint32_t resourceCount = 0;     ///< Number of resources actually allocated.
+            uint64_t naiveBytes = 0;        ///< Estimated memory if every requested resource is allocated separately.
+            uint64_t allocatedBytes = 0;    ///< Estimated memory of the allocated resources.
+            uint64_t peakBytes = 0;         ///< Estimated memory of the resources alive at the same time. Lower bound for allocatedBytes.
         };
 
         /** Add/Remove reference to a graph input resource not owned by the cache
@@ -77,6 +89,10 @@ namespace Falcor
         */
         void allocateResources(const DefaultProperties& params);
 
+        /** Get memory statistics of the last allocateResources() call.
+        */
+        const AllocationStats& getAllocationStats() const { return mAllocationStats; }
+
         /** Clears all registered field/resource properties and allocated resources.
         */
         void reset();
@@ -99,6 +115,8 @@ namespace Falcor
 
         // References to output resources not to be allocated by the render graph
         ResourcesMap mExternalResources;
+
+        AllocationStats mAllocationStats;
     };
 
 }
@@ -0,0 +1,128 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "RenderPasses/Shared/Caustics/CachingPointData.slang"
+#include "Utils/Math/PackedFormats.h"
+
+/** Host-side conversion between the caching point structs and their packed versions.
+
+    The functions defined here should match the corresponding GPU-side
+    functions in CachingPointPacking.slang, but numerical differences are possible.
+*/
+
+namespace Falcor
+{
+    /** Log-encodes a search radius over [2^kPackedRadiusLog2Min, 2^kPackedRadiusLog2Max].
+        \param[in] radius Search radius. Values <= 0 (and NaNs) are encoded as 0.
+        \param[in] bitCount Number of bits of the encoding.
+        \return Encoded radius.
+    */
+    inline uint32_t encodeLogRadius(float radius, uint32_t bitCount)
+    {
+        if (!(radius > 0.f)) return 0;
+        const uint32_t maxCode = (1u << bitCount) - 1u;
+        const float t = std::clamp((std::log2(radius) - kPackedRadiusLog2Min) / (kPackedRadiusLog2Max - kPackedRadiusLog2Min), 0.f, 1.f);
+        return 1u + (uint32_t)(t * float(maxCode - 1u) + 0.5f);
+    }
+
+    /** Decodes a search radius encoded with encodeLogRadius().
+    */
+    inline float decodeLogRadius(uint32_t code, uint32_t bitCount)
+    {
+        if (code == 0) return 0.f;
+        const uint32_t maxCode = (1u << bitCount) - 1u;
+        const float t = float(code - 1u) / float(maxCode - 1u);
+        return std::exp2(kPackedRadiusLog2Min + t * (kPackedRadiusLog2Max - kPackedRadiusLog2Min));
+    }
+
+    /** Packs a caching point.
+        \param[in] data Caching point.
+        \param[in] origin Origin relative to which the position is stored, typically the camera position of the frame.
+        \return Packed caching point.
+    */
+    inline PackedCachingPointData packCachingPoint(const CachingPointData& data, const float3& origin)
+    {
+        const float3 offset = data.position - origin;
+        const float distance = glm::length(offset);
+        const uint32_t depth = std::min(data.depthAndMaterialID >> 16, kPackedCachingPointMaxDepth);
+
+        PackedCachingPointData packed;
+        packed.direction = encodeNormal2x16(distance > 0.f ? offset / distance : float3(0.f, 0.f, 1.f));
+        packed.distance = distance;
+        packed.normal = encodeNormal2x16(data.normal);
+        packed.radiusDepthAndMaterialID = (encodeLogRadius(data.searchRadius, kPackedCachingPointRadiusBits) << 20) | (depth << 16) | (data.depthAndMaterialID & 0xffff);
+        return packed;
+    }
+
+    /** Unpacks a caching point packed with packCachingPoint().
+        \param[in] packed Packed caching point.
+        \param[in] origin Origin that was used when packing.
+        \return Caching point.
+    */
+    inline CachingPointData unpackCachingPoint(const PackedCachingPointData& packed, const float3& origin)
+    {
+        CachingPointData data;
+        data.position = origin + decodeNormal2x16(packed.direction) * packed.distance;
+        data.searchRadius = decodeLogRadius(packed.radiusDepthAndMaterialID >> 20, kPackedCachingPointRadiusBits);
+        data.normal = decodeNormal2x16(packed.normal);
+        data.depthAndMaterialID = packed.radiusDepthAndMaterialID & 0x000fffff;
+        return data;
+    }
+
+    /** Packs the data of the path leading to a caching point.
+    */
+    inline PackedPathToCachingPointData packPathToCachingPoint(const PathToCachingPointData& data)
+    {
+        PackedPathToCachingPointData packed;
+        packed.incomingCameraDir = encodeNormal2x16(data.incomingCameraDir);
+        packed.pathThroughput = encodeRGB9E5(data.pathThroughput);
+        packed.materialIDAndHitInfoType = data.materialIDAndHitInfoType;
+        packed.hitInfoInstanceID = data.hitInfoInstanceID;
+        packed.hitInfoPrimitiveIndex = data.hitInfoPrimitiveIndex;
+        packed.hitInfoBarycentrics = glm::packUnorm2x16(data.hitInfoBarycentrics);
+        packed.searchRadius = encodeLogRadius(data.searchRadius, kPackedPathRadiusBits);
+        packed._pad = 0;
+        return packed;
+    }
+
+    /** Unpacks the data of the path leading to a caching point packed with packPathToCachingPoint().
+        Note that non-positive search radii (used to flag pixels without caching point) are unpacked as 0.
+    */
+    inline PathToCachingPointData unpackPathToCachingPoint(const PackedPathToCachingPointData& packed)
+    {
+        PathToCachingPointData data;
+        data.incomingCameraDir = decodeNormal2x16(packed.incomingCameraDir);
+        data.searchRadius = decodeLogRadius(packed.searchRadius & 0xffff, kPackedPathRadiusBits);
+        data.pathThroughput = decodeRGB9E5(packed.pathThroughput);
+        data.materialIDAndHitInfoType = packed.materialIDAndHitInfoType;
+        data.hitInfoInstanceID = packed.hitInfoInstanceID;
+        data.hitInfoPrimitiveIndex = packed.hitInfoPrimitiveIndex;
+        data.hitInfoBarycentrics = glm::unpackUnorm2x16(packed.hitInfoBarycentrics);
+        return data;
+    }
+}
@@ -0,0 +1,63 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "RenderPasses/Shared/Caustics/CachingPointData.slang"
+
+/** Host-side reference implementation of the caching point reprojection.
+
+    The functions defined here should match the corresponding GPU-side
+    functions in CachingPointReprojection.slang, and are used for regression testing.
+*/
+
+namespace Falcor
+{
+    static const float kReprojectionNormalThreshold = 0.9f;
+    static const float kReprojectionPlaneDistance = 1e-2f;
+
+    /** Finds the pixel of the previous frame that a pixel reprojects to.
+        See reprojectPixel() in CachingPointReprojection.slang for details.
+    */
+    inline bool reprojectPixel(const uint2& pixel, const float2& motionVector, const uint2& frameDim, uint2& previousPixel)
+    {
+        const float2 previousPos = ((float2(pixel) + 0.5f) / float2(frameDim) + motionVector) * float2(frameDim);
+        previousPixel = uint2(glm::max(previousPos, float2(0.f)));
+        return previousPos.x >= 0.f && previousPos.y >= 0.f && previousPos.x < float(frameDim.x) && previousPos.y < float(frameDim.y);
+    }
+
+    /** Checks whether a previous-frame caching point can stand in for a current one.
+        See isValidReprojection() in CachingPointReprojection.slang for details.
+    */
+    inline bool isValidReprojection(const CachingPointData& current, const CachingPointData& previous)
+    {
+        if ((current.depthAndMaterialID >> 16) != 0 || current.depthAndMaterialID != previous.depthAndMaterialID) return false;
+        if (glm::dot(current.normal, previous.normal) <= kReprojectionNormalThreshold) return false;
+
+        const float3 toPrevious = previous.position - current.position;
+        return glm::length(toPrevious) <= current.searchRadius && std::abs(glm::dot(toPrevious, current.normal)) <= kReprojectionPlaneDistance;
+    }
+}
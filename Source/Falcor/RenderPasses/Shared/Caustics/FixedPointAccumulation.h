@@ -0,0 +1,91 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+/** Host-side fixed-point formats used to accumulate photon contributions.
+
+    The functions defined here should match the corresponding GPU-side
+    functions in FixedPointAccumulation.slang, and are used to simulate the
+    accumulation on the CPU.
+*/
+
+namespace Falcor
+{
+    static const uint32_t kFixedBitCount = 28;
+    static const uint32_t kSplitFixedFractionBits = 40;
+
+    /** Converts a value to 32-bit fixed point. The value is clamped to the representable range.
+    */
+    inline uint32_t toFixed(float value)
+    {
+        const uint32_t maxIntegerValue = (1u << (32 - kFixedBitCount)) - 1u;
+        value = std::clamp(value, 0.0f, (float)maxIntegerValue);
+        const float scaled = value * (1 << kFixedBitCount);
+        return (uint32_t)(scaled + 0.5f);
+    }
+
+    /** Converts a 32-bit fixed-point value back to floating point.
+    */
+    inline float fromFixed(uint32_t value)
+    {
+        return ((float)value) / (1 << kFixedBitCount);
+    }
+
+    /** Converts a value to 64-bit fixed point. The value is clamped to the representable range.
+        \return Low word in x, high word in y.
+    */
+    inline uint2 toSplitFixed(float value)
+    {
+        const float scaled = std::clamp(value, 0.0f, 16777215.0f) * std::exp2(float(kSplitFixedFractionBits) - 32.0f);
+        const float high = std::floor(scaled);
+        const float low = (scaled - high) * 4294967296.0f;
+        return uint2((uint32_t)low, (uint32_t)high);
+    }
+
+    /** Converts a 64-bit fixed-point value back to floating point.
+        \param[in] value Low word in x, high word in y.
+    */
+    inline float fromSplitFixed(const uint2& value)
+    {
+        return ((float)value.y + (float)value.x * (1.0f / 4294967296.0f)) * std::exp2(32.0f - float(kSplitFixedFractionBits));
+    }
+
+    /** Adds a 64-bit fixed-point value to an accumulator, in the same way as interlockedAddSplitFixed() does on the GPU.
+        \param[in,out] accumulator Accumulator (low word in x, high word in y).
+        \param[in] value Value to add (low word in x, high word in y).
+    */
+    inline void addSplitFixed(uint2& accumulator, const uint2& value)
+    {
+        const uint32_t previousLow = accumulator.x;
+        accumulator.x += value.x;
+        const uint32_t carry = previousLow > 0xFFFFFFFFu - value.x ? 1u : 0u;
+        accumulator.y += value.y + carry;
+    }
+}
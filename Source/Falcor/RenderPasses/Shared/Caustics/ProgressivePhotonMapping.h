@@ -0,0 +1,68 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "RenderPasses/Shared/Caustics/CachingPointData.slang"
+
+/** Host-side reference implementation of the progressive photon mapping (SPPM) radius schedule.
+
+    The functions defined here should match the corresponding GPU-side
+    functions in ProgressivePhotonMapping.slang, and are used for regression testing.
+*/
+
+namespace Falcor
+{
+    /** Advances a progressive photon mapping state by one frame.
+        See updateProgressivePhotonState() in ProgressivePhotonMapping.slang for details.
+        \param[in] state State after the previous frame. An invalid state (radius <= 0) is restarted.
+        \param[in] frameRadiance Reflected radiance estimated this frame.
+        \param[in] framePhotonCount Number of photons gathered this frame.
+        \param[in] frameRadius Search radius used this frame.
+        \param[in] alpha Fraction of the new photons kept per frame, in (0,1].
+        \return Updated state.
+    */
+    inline ProgressivePhotonState updateProgressivePhotonState(ProgressivePhotonState state, const float3& frameRadiance, float framePhotonCount, float frameRadius, float alpha)
+    {
+        if (!(state.radius > 0.f))
+        {
+            state.radiance = float3(0.f);
+            state.photonCount = 0.f;
+            state.iterationCount = 0;
+        }
+
+        const float photonCount = state.photonCount + alpha * framePhotonCount;
+        const float totalPhotonCount = state.photonCount + framePhotonCount;
+        const float radiusScale = totalPhotonCount > 0.f ? std::sqrt(photonCount / totalPhotonCount) : 1.f;
+
+        const float iterationCount = float(state.iterationCount);
+        state.radiance = (state.radiance * iterationCount + frameRadiance) / (iterationCount + 1.f);
+        state.radius = frameRadius * radiusScale;
+        state.photonCount = photonCount;
+        state.iterationCount = state.iterationCount + 1;
+        return state;
+    }
+}
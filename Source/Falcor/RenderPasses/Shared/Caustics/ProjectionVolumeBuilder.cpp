@@ -0,0 +1,356 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "ProjectionVolumeBuilder.h"
+#include "Utils/Math/MathHelpers.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        struct Cluster
+        {
+            std::vector<uint32_t> items;    ///< Indices into the list of caster bounds.
+            AABB bounds;                    ///< Union of the bounds of all items.
+            bool splittable = true;         ///< False once we know no split can reduce the area of this cluster.
+        };
+
+        AABB computeBounds(const std::vector<AABB>& boxes, const std::vector<uint32_t>& items, size_t begin, size_t end)
+        {
+            AABB bounds;
+            for (size_t i = begin; i < end; ++i) bounds.include(boxes[items[i]]);
+            return bounds;
+        }
+
+        /** Splits a cluster in two along the plane minimising the summed surface area of both halves.
+            All three axes are tried, with the items sorted by the center of their bounds.
+            \return False if no split reduces the surface area of the cluster.
+        */
+        bool splitCluster(const std::vector<AABB>& boxes, const Cluster& cluster, Cluster& left, Cluster& right)
+        {
+            const size_t itemCount = cluster.items.size();
+            if (itemCount < 2) return false;
+
+            float bestCost = cluster.bounds.area();
+            size_t bestSplit = 0;
+            std::vector<uint32_t> bestOrder;
+
+            std::vector<uint32_t> order = cluster.items;
+            std::vector<float> rightAreas(itemCount);
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return boxes[a].center()[axis] < boxes[b].center()[axis]; });
+
+                AABB accumulated;
+                for (size_t i = itemCount - 1; i > 0; --i)
+                {
+                    accumulated.include(boxes[order[i]]);
+                    rightAreas[i] = accumulated.area();
+                }
+
+                accumulated.invalidate();
+                for (size_t i = 0; i + 1 < itemCount; ++i)
+                {
+                    accumulated.include(boxes[order[i]]);
+                    const float cost = accumulated.area() + rightAreas[i + 1];
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestSplit = i + 1;
+                        bestOrder = order;
+                    }
+                }
+            }
+
+            if (bestSplit == 0) return false;
+
+            left.items.assign(bestOrder.begin(), bestOrder.begin() + bestSplit);
+            right.items.assign(bestOrder.begin() + bestSplit, bestOrder.end());
+            left.bounds = computeBounds(boxes, left.items, 0, left.items.size());
+            right.bounds = computeBounds(boxes, right.items, 0, right.items.size());
+            return true;
+        }
+
+        bool intersectRayAABB(const float3& origin, const float3& dir, const AABB& box)
+        {
+            const float3 invDir = 1.f / dir;
+            const float3 t0 = (box.minPoint - origin) * invDir;
+            const float3 t1 = (box.maxPoint - origin) * invDir;
+            const float3 tNear = glm::min(t0, t1);
+            const float3 tFar = glm::max(t0, t1);
+            const float tMin = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.f));
+            const float tMax = std::min(std::min(tFar.x, tFar.y), tFar.z);
+            return tMin <= tMax;
+        }
+
+        /** Host-side equivalent of sample_cone() in MathHelpers.slang.
+        */
+        float3 sampleCone(const float2& u, float cosTheta)
+        {
+            const float z = u.x * (1.f - cosTheta) + cosTheta;
+            const float r = std::sqrt(std::max(0.f, 1.f - z * z));
+            const float phi = 2.f * glm::pi<float>() * u.y;
+            return float3(r * std::cos(phi), r * std::sin(phi), z);
+        }
+
+        /** Host-side equivalent of computeBoundingCone() in ProjectionLightSampling.slang.
+            \return Solid angle of the cone.
+        */
+        float computeBoundingCone(const float3& origin, const AABB& volume, bool useCenterCone, float3& coneDir, float& cosTheta)
+        {
+            float sinTheta;
+            if (useCenterCone) boundBoxSubtendedConeAngleCenter(origin, volume.minPoint, volume.maxPoint, coneDir, sinTheta, cosTheta);
+            else boundBoxSubtendedConeAngleAverage(origin, volume.minPoint, volume.maxPoint, coneDir, sinTheta, cosTheta);
+
+            // From inside the volume, bound it by the whole sphere of directions.
+            if (!(glm::dot(coneDir, coneDir) > 0.f))
+            {
+                coneDir = float3(0.f, 0.f, 1.f);
+                cosTheta = -1.f;
+            }
+            return 2.f * glm::pi<float>() * (1.f - cosTheta);
+        }
+
+        float computeTotalSolidAngle(const std::vector<AABB>& volumes, const float3& origin, bool useCenterCone)
+        {
+            float3 coneDir;
+            float cosTheta;
+            float totalSolidAngle = 0.f;
+            for (const AABB& volume : volumes) totalSolidAngle += computeBoundingCone(origin, volume, useCenterCone, coneDir, cosTheta);
+            return totalSolidAngle;
+        }
+
+        /** Counts the volumes whose bounding cone contains a direction.
+            Each of them contributes (solidAngle / totalSolidAngle) * (1 / solidAngle) to the pdf of the mixture.
+        */
+        uint32_t countContainingCones(const std::vector<AABB>& volumes, const float3& origin, bool useCenterCone, const float3& dir)
+        {
+            uint32_t containingConeCount = 0;
+            for (const AABB& volume : volumes)
+            {
+                float3 coneDir;
+                float cosTheta;
+                computeBoundingCone(origin, volume, useCenterCone, coneDir, cosTheta);
+                if (glm::dot(dir, coneDir) >= cosTheta) ++containingConeCount;
+            }
+            return containingConeCount;
+        }
+
+        /** Host-side equivalent of projectVolumeToPlane() in ProjectionLightSampling.slang, for a plane with the given tangent frame.
+        */
+        void projectVolumeToPlane(const float3& tangent, const float3& binormal, const AABB& volume, float2& rectMin, float2& rectSize)
+        {
+            rectMin = float2(std::numeric_limits<float>::max());
+            float2 rectMax = float2(-std::numeric_limits<float>::max());
+            for (uint32_t i = 0; i < 8; ++i)
+            {
+                const float3 corner = float3((i & 1) ? volume.maxPoint.x : volume.minPoint.x, (i & 2) ? volume.maxPoint.y : volume.minPoint.y, (i & 4) ? volume.maxPoint.z : volume.minPoint.z);
+                const float2 planeCoords = float2(glm::dot(tangent, corner), glm::dot(binormal, corner));
+                rectMin = glm::min(rectMin, planeCoords);
+                rectMax = glm::max(rectMax, planeCoords);
+            }
+            rectSize = rectMax - rectMin;
+        }
+
+        bool hitsCaster(const std::vector<AABB>& casterBounds, const float3& origin, const float3& dir)
+        {
+            for (const AABB& caster : casterBounds)
+            {
+                if (caster.valid() && intersectRayAABB(origin, dir, caster)) return true;
+            }
+            return false;
+        }
+
+        /** Selects an item proportionally to its weight, like the volume selection loops on the GPU.
+        */
+        size_t selectProportional(const std::vector<float>& weights, float totalWeight, float u)
+        {
+            float target = u * totalWeight;
+            size_t selected = 0;
+            for (; selected + 1 < weights.size(); ++selected)
+            {
+                if (target < weights[selected]) break;
+                target -= weights[selected];
+            }
+            return selected;
+        }
+    }
+
+    std::vector<AABB> ProjectionVolumeBuilder::build(const std::vector<AABB>& casterBounds, uint32_t maxVolumeCount)
+    {
+        Cluster root;
+        for (uint32_t i = 0; i < (uint32_t)casterBounds.size(); ++i)
+        {
+            if (casterBounds[i].valid()) root.items.push_back(i);
+        }
+        if (root.items.empty() || maxVolumeCount == 0) return {};
+        root.bounds = computeBounds(casterBounds, root.items, 0, root.items.size());
+
+        std::vector<Cluster> clusters;
+        clusters.push_back(std::move(root));
+
+        while (clusters.size() < maxVolumeCount)
+        {
+            // Always refine the cluster which currently wastes the most, i.e. the largest one.
+            size_t selected = clusters.size();
+            for (size_t i = 0; i < clusters.size(); ++i)
+            {
+                if (!clusters[i].splittable) continue;
+                if (selected == clusters.size() || clusters[i].bounds.area() > clusters[selected].bounds.area()) selected = i;
+            }
+            if (selected == clusters.size()) break;
+
+            Cluster left, right;
+            if (!splitCluster(casterBounds, clusters[selected], left, right))
+            {
+                clusters[selected].splittable = false;
+                continue;
+            }
+
+            clusters[selected] = std::move(left);
+            clusters.push_back(std::move(right));
+        }
+
+        std::vector<AABB> volumes;
+        volumes.reserve(clusters.size());
+        for (const auto& cluster : clusters) volumes.push_back(cluster.bounds);
+        return volumes;
+    }
+
+    bool ProjectionVolumeBuilder::sampleDirection(const std::vector<AABB>& volumes, const float3& origin, bool useCenterCone, float uSelect, const float2& u, float3& dir, float& pdf)
+    {
+        dir = float3(0.f);
+        pdf = 0.f;
+
+        const float totalSolidAngle = computeTotalSolidAngle(volumes, origin, useCenterCone);
+        if (!(totalSolidAngle > 0.f)) return false;
+
+        // Select a volume proportionally to the solid angle covered by its bounding cone.
+        float3 coneDir;
+        float cosTheta;
+        float target = uSelect * totalSolidAngle;
+        for (size_t i = 0; i < volumes.size(); ++i)
+        {
+            const float solidAngle = computeBoundingCone(origin, volumes[i], useCenterCone, coneDir, cosTheta);
+            if (target < solidAngle || i + 1 == volumes.size()) break;
+            target -= solidAngle;
+        }
+
+        const float3 localDir = sampleCone(u, cosTheta);
+        const float3 coneTangent = glm::normalize(perp_stark(coneDir));
+        const float3 coneBitangent = glm::cross(coneDir, coneTangent);
+        dir = coneDir * localDir.z + coneTangent * localDir.x + coneBitangent * localDir.y;
+
+        pdf = std::max(1u, countContainingCones(volumes, origin, useCenterCone, dir)) / totalSolidAngle;
+        return true;
+    }
+
+    float ProjectionVolumeBuilder::evalDirectionPdf(const std::vector<AABB>& volumes, const float3& origin, bool useCenterCone, const float3& dir)
+    {
+        const float totalSolidAngle = computeTotalSolidAngle(volumes, origin, useCenterCone);
+        if (!(totalSolidAngle > 0.f)) return 0.f;
+        return countContainingCones(volumes, origin, useCenterCone, dir) / totalSolidAngle;
+    }
+
+    ProjectionVolumeBuilder::HitRateEstimate ProjectionVolumeBuilder::estimateHitRate(const std::vector<AABB>& volumes, const std::vector<AABB>& casterBounds,
+                                                                                      const std::vector<Emitter>& emitters, uint32_t samplesPerEmitter, uint32_t seed)
+    {
+        HitRateEstimate estimate;
+        estimate.volumeCount = (uint32_t)volumes.size();
+        if (volumes.empty() || emitters.empty() || samplesPerEmitter == 0) return estimate;
+
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> dist(0.f, 1.f);
+
+        const size_t volumeCount = volumes.size();
+        std::vector<float> weights(volumeCount);
+        std::vector<float2> rectMins(volumeCount);
+        std::vector<float2> rectSizes(volumeCount);
+
+        double solidAngleSum = 0.0;
+        uint32_t coneEmitterCount = 0;
+        for (const Emitter& emitter : emitters)
+        {
+            if (emitter.type == Emitter::Type::Directional)
+            {
+                // Sample positions on the volumes projected onto a plane orthogonal to the light, as in sampleDirectionalLight().
+                const float3 normal = emitter.dirW;
+                const float3 tangent = glm::normalize(perp_stark(normal));
+                const float3 binormal = glm::cross(normal, tangent);
+                const float3 planeOrigin = -2.3f * normal;
+
+                float totalArea = 0.f;
+                for (size_t i = 0; i < volumeCount; ++i)
+                {
+                    projectVolumeToPlane(tangent, binormal, volumes[i], rectMins[i], rectSizes[i]);
+                    weights[i] = rectSizes[i].x * rectSizes[i].y;
+                    totalArea += weights[i];
+                }
+                if (!(totalArea > 0.f)) continue;
+
+                for (uint32_t s = 0; s < samplesPerEmitter; ++s)
+                {
+                    const size_t selected = selectProportional(weights, totalArea, dist(rng));
+                    const float2 planeCoords = rectMins[selected] + rectSizes[selected] * float2(dist(rng), dist(rng));
+                    const float3 origin = planeOrigin + planeCoords.x * tangent + planeCoords.y * binormal;
+                    if (hitsCaster(casterBounds, origin, normal)) ++estimate.hitCount;
+                }
+                estimate.sampleCount += samplesPerEmitter;
+                continue;
+            }
+
+            // Bound each volume by a cone, as in sampleProjectionVolumes(): average cones for point lights, centered cones for triangles.
+            const bool useCenterCone = emitter.type == Emitter::Type::Triangle;
+            const float3& origin = emitter.posW;
+            const float totalSolidAngle = computeTotalSolidAngle(volumes, origin, useCenterCone);
+            if (!(totalSolidAngle > 0.f)) continue;
+
+            solidAngleSum += std::min(totalSolidAngle, 4.f * glm::pi<float>());
+            ++coneEmitterCount;
+
+            for (uint32_t s = 0; s < samplesPerEmitter; ++s)
+            {
+                const float uSelect = dist(rng);
+                const float2 u = float2(dist(rng), dist(rng));
+                float3 dir;
+                float pdf;
+                if (!sampleDirection(volumes, origin, useCenterCone, uSelect, u, dir, pdf)) continue;
+
+                // Triangles only emit on their front side.
+                if (emitter.type == Emitter::Type::Triangle && glm::dot(emitter.dirW, dir) <= 0.f) continue;
+
+                if (hitsCaster(casterBounds, origin, dir)) ++estimate.hitCount;
+            }
+            estimate.sampleCount += samplesPerEmitter;
+        }
+
+        estimate.averageSolidAngle = coneEmitterCount > 0 ? (float)(solidAngleSum / coneEmitterCount) : 0.f;
+        return estimate;
+    }
+}
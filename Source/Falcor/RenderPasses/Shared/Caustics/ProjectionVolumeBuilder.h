@@ -0,0 +1,122 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Utils/Math/AABB.h"
+#include <vector>
+
+namespace Falcor
+{
+    /** Builds the set of projection volumes towards which caustic light paths are guided.
+
+        Instead of a single box around every specular caster in the scene, the casters are
+        clustered into a small number of boxes using a greedy top-down BVH cut. Light sources
+        then pick one of the boxes proportionally to its solid angle (or projected area for
+        directional lights), which avoids shooting most photons into the empty space between
+        casters that are spread out over a large scene.
+    */
+    class dlldecl ProjectionVolumeBuilder
+    {
+    public:
+        /** Light source from which photons are emitted in a hit-rate estimation.
+        */
+        struct Emitter
+        {
+            enum class Type
+            {
+                Point,          ///< Point light, sampling the cones centered on the average direction to the volume corners.
+                Triangle,       ///< Emissive triangle, sampling the cones centered on the volume centers above the triangle.
+                Directional,    ///< Directional light, sampling positions on the volumes projected along the light direction.
+            };
+
+            Type type = Type::Point;
+            float3 posW = float3(0.f);              ///< Position of a point light, or center of an emissive triangle.
+            float3 dirW = float3(0.f, -1.f, 0.f);   ///< Direction of a directional light, or normal of an emissive triangle.
+        };
+
+        /** Result of a hit-rate estimation.
+        */
+        struct HitRateEstimate
+        {
+            uint32_t volumeCount = 0;       ///< Number of projection volumes used for the estimate.
+            uint64_t sampleCount = 0;       ///< Total number of directions that were sampled.
+            uint64_t hitCount = 0;          ///< Number of sampled directions which hit at least one caster.
+            float averageSolidAngle = 0.f;  ///< Average over point and triangle emitters of the solid angle covered by the volumes (in sr).
+
+            float getHitRate() const { return sampleCount > 0 ? (float)((double)hitCount / (double)sampleCount) : 0.f; }
+        };
+
+        /** Clusters the bounds of the caster instances into at most maxVolumeCount boxes.
+            The cluster with the largest surface area is repeatedly split along the plane that
+            minimises the summed surface area of its children, until the requested number of
+            volumes is reached or no split reduces the area anymore.
+            \param[in] casterBounds World-space bounds of every caster instance. Invalid boxes are ignored.
+            \param[in] maxVolumeCount Maximum number of volumes to generate; 1 gives the single global box.
+            \return List of volumes, empty if there were no valid caster bounds.
+        */
+        static std::vector<AABB> build(const std::vector<AABB>& casterBounds, uint32_t maxVolumeCount);
+
+        /** Samples a direction towards a set of projection volumes.
+            Host-side equivalent of sampleProjectionVolumes() in ProjectionLightSampling.slang: a volume is selected
+            proportionally to the solid angle of its bounding cone, then a direction is sampled uniformly within that cone.
+            A volume containing the origin is bounded by the whole sphere of directions.
+            \param[in] volumes Projection volumes.
+            \param[in] origin Point from which the direction is sampled.
+            \param[in] useCenterCone True to centre the bounding cones on the volume centres, false to use the average direction to their corners.
+            \param[in] uSelect Uniform random number used for selecting a volume.
+            \param[in] u Uniform random numbers (2D) used for sampling the cone.
+            \param[out] dir Sampled direction (normalized).
+            \param[out] pdf Solid angle pdf of the sampled direction, with respect to the whole mixture.
+            \return True if a direction was sampled, false otherwise.
+        */
+        static bool sampleDirection(const std::vector<AABB>& volumes, const float3& origin, bool useCenterCone, float uSelect, const float2& u, float3& dir, float& pdf);
+
+        /** Evaluates the solid angle pdf with which sampleDirection() generates a direction.
+            \param[in] volumes Projection volumes.
+            \param[in] origin Point from which the direction is sampled.
+            \param[in] useCenterCone True to centre the bounding cones on the volume centres, false to use the average direction to their corners.
+            \param[in] dir Direction (normalized).
+            \return The pdf, zero if the direction cannot be sampled.
+        */
+        static float evalDirectionPdf(const std::vector<AABB>& volumes, const float3& origin, bool useCenterCone, const float3& dir);
+
+        /** Estimates the fraction of photons, emitted following the projection-volume sampling
+            strategy used by ScreenSpaceCaustics, that would hit at least one caster.
+            Each emitter type follows the corresponding sampling function in ProjectionLightSampling.slang.
+            Each caster is approximated by its bounding box, so the estimate is an upper bound of the
+            actual hit rate; it is however representative when comparing different sets of volumes.
+            \param[in] volumes Projection volumes to evaluate.
+            \param[in] casterBounds World-space bounds of every caster instance.
+            \param[in] emitters Light sources from which photons are emitted.
+            \param[in] samplesPerEmitter Number of directions to sample from each emitter.
+            \param[in] seed Seed for the random number generator, making the estimate reproducible.
+            \return The estimate.
+        */
+        static HitRateEstimate estimateHitRate(const std::vector<AABB>& volumes, const std::vector<AABB>& casterBounds,
+                                               const std::vector<Emitter>& emitters, uint32_t samplesPerEmitter, uint32_t seed = 0u);
+    };
+}
@@ -36,11 +36,15 @@ namespace Falcor
         const std::string kWorldMatrices = "worldMatrices";
         const std::string kInverseTransposeWorldMatrices = "inverseTransposeWorldMatrices";
         const std::string kPreviousFrameWorldMatrices = "previousFrameWorldMatrices";
+
+        // Dirty matrix ranges separated by at most this many unchanged matrices are uploaded with a single write.
+        const uint32_t kUploadMaxGap = 4;
     }
 
     AnimationController::AnimationController(Scene* pScene, const StaticVertexVector& staticVertexData, const DynamicVertexVector& dynamicVertexData, const std::vector<Animation::SharedPtr>& animations)
         : mpScene(pScene)
         , mLocalMatrices(pScene->mSceneGraph.size())
+        , mGlobalMatrices(pScene->mSceneGraph.size())
         , mInvTransposeGlobalMatrices(pScene->mSceneGraph.size())
         , mMatricesAnimated(pScene->mSceneGraph.size())
         , mMatricesChanged(pScene->mSceneGraph.size())
@@ -116,7 +120,9 @@ namespace Falcor
         PROFILE("animate");
 
         mMatricesChanged.assign(mMatricesChanged.size(), false);
+        mUploadedBytes = 0;
 
+        const bool updateAll = mAnimationChanged;
         if (mAnimationChanged == false)
         {
             if (!mEnabled || !hasAnimations()) return false;
@@ -124,6 +130,7 @@ namespace Falcor
             {
                 // Copy the current matrices to the previous matrices. We can do that only once, but not sure if it we'll help perf (it only occures when the animation is paused)
                 pContext->copyResource(mpPrevWorldMatricesBuffer.get(), mpWorldMatricesBuffer.get());
+                mPrevChangedMatrices.clear();
                 return false;
             }
         }
@@ -144,27 +151,29 @@ namespace Falcor
         }
 
         swap(mpPrevWorldMatricesBuffer, mpWorldMatricesBuffer);
-        updateMatrices();
+        updateMatrices(updateAll);
         bindBuffers();
         executeSkinningPass(pContext);
 
         return true;
     }
 
-    void AnimationController::updateMatrices()
+    void AnimationController::updateMatrices(bool updateAll)
     {
-        // We can optimize this
-        mGlobalMatrices = mLocalMatrices;
+        // Only matrices that changed, or have a changed ancestor, are recomputed and uploaded.
+        DirtyRanges changedMatrices;
 
         for (size_t i = 0; i < mGlobalMatrices.size(); i++)
         {
-            if (mpScene->mSceneGraph[i].parent != SceneBuilder::kInvalidNode)
+            const uint32_t parent = mpScene->mSceneGraph[i].parent;
+            if (parent != SceneBuilder::kInvalidNode)
             {
-                mGlobalMatrices[i] = mGlobalMatrices[mpScene->mSceneGraph[i].parent] * mGlobalMatrices[i];
-                mMatricesChanged[i] = mMatricesChanged[i] || mMatricesChanged[mpScene->mSceneGraph[i].parent];
+                mMatricesChanged[i] = mMatricesChanged[i] || mMatricesChanged[parent];
                 assert(!mMatricesChanged[i] || mMatricesAnimated[i]);
             }
+            if (!updateAll && !mMatricesChanged[i]) continue;
 
+            mGlobalMatrices[i] = parent != SceneBuilder::kInvalidNode ? mGlobalMatrices[parent] * mLocalMatrices[i] : mLocalMatrices[i];
             mInvTransposeGlobalMatrices[i] = transpose(inverse(mGlobalMatrices[i]));
 
             if (mpSkinningPass)
@@ -172,9 +181,18 @@ namespace Falcor
                 mSkinningMatrices[i] = mGlobalMatrices[i] * mpScene->mSceneGraph[i].localToBindSpace;
                 mInvTransposeSkinningMatrices[i] = transpose(inverse(mSkinningMatrices[i]));
             }
+
+            changedMatrices.mark((uint32_t)i);
         }
-        mpWorldMatricesBuffer->setBlob(mGlobalMatrices.data(), 0, mpWorldMatricesBuffer->getSize());
-        mpInvTransposeWorldMatricesBuffer->setBlob(mInvTransposeGlobalMatrices.data(), 0, mpInvTransposeWorldMatricesBuffer->getSize());
+
+        // The world matrix buffers are swapped every frame, so the buffer written now last received the matrices two frames ago.
+        // Upload the matrices updated in this or the previous frame. The inverse transpose buffer is not swapped.
+        DirtyRanges worldMatrices = mPrevChangedMatrices;
+        for (const auto& range : changedMatrices.coalesce()) worldMatrices.mark(range.begin, range.end);
+        mPrevChangedMatrices = changedMatrices;
+
+        mUploadedBytes += worldMatrices.upload(mpWorldMatricesBuffer.get(), mGlobalMatrices.data(), sizeof(glm::mat4), kUploadMaxGap);
+        mUploadedBytes += changedMatrices.upload(mpInvTransposeWorldMatricesBuffer.get(), mInvTransposeGlobalMatrices.data(), sizeof(glm::mat4), kUploadMaxGap);
     }
 
     void AnimationController::bindBuffers()
@@ -203,7 +221,13 @@ namespace Falcor
     void AnimationController::createSkinningPass(const std::vector<PackedStaticVertexData>& staticVertexData, const std::vector<DynamicVertexData>& dynamicVertexData)
     {
         // We always copy the static data, to initialize the non-skinned vertices.
+        // Compressed vertex data is uploaded by the scene builder. Skinning is not supported with compressed vertices.
         const Buffer::SharedPtr& pVB = mpScene->mpVao->getVertexBuffer(Scene::kStaticDataBufferIndex);
+        if (mpScene->mHasCompressedVertices)
+        {
+            assert(dynamicVertexData.empty());
+            return;
+        }
         assert(pVB->getSize() == staticVertexData.size() * sizeof(staticVertexData[0]));
         pVB->setBlob(staticVertexData.data(), 0, pVB->getSize());
 
@@ -29,6 +29,7 @@
 #include "Animation.h"
 #include "RenderGraph/BasePasses/ComputePass.h"
 #include "Scene/SceneTypes.slang"
+#include "Utils/Algorithm/DirtyRanges.h"
 
 namespace Falcor
 {
@@ -105,6 +106,10 @@ namespace Falcor
         */
         const std::vector<glm::mat4>& getGlobalMatrices() const { return mGlobalMatrices; }
 
+        /** Get the number of bytes of matrix data uploaded by the last call to animate().
+        */
+        uint64_t getUploadedBytes() const { return mUploadedBytes; }
+
         /** Render the UI.
         */
         void renderUI(Gui::Widgets& widget);
@@ -125,7 +130,7 @@ namespace Falcor
 
         void initFlags();
         void bindBuffers();
-        void updateMatrices();
+        void updateMatrices(bool updateAll);
 
         void createSkinningPass(const std::vector<PackedStaticVertexData>& staticVertexData, const std::vector<DynamicVertexData>& dynamicVertexData);
         void executeSkinningPass(RenderContext* pContext);
@@ -138,6 +143,8 @@ namespace Falcor
         std::vector<glm::mat4> mInvTransposeGlobalMatrices;
         std::vector<bool> mMatricesAnimated;        ///< Flag per matrix, true if matrix is affected by animations.
         std::vector<bool> mMatricesChanged;         ///< Flag per matrix, true if matrix changed since last frame.
+        DirtyRanges mPrevChangedMatrices;           ///< Matrices updated in the previous frame. These are stale in the world matrix buffer written next.
+        uint64_t mUploadedBytes = 0;                ///< Bytes of matrix data uploaded by the last call to animate().
 
         bool mEnabled = true;
         bool mAnimationChanged = true;
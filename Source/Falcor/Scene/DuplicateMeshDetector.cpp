@@ -0,0 +1,344 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "DuplicateMeshDetector.h"
+#include <execution>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Radius of gyration bins per octave in the shape descriptor.
+        const float kRadiusBinsPerOctave = 64.f;
+
+        // Smallest cosine of the angle between matching normals or tangents.
+        const float kMinDirectionCosine = 0.999f;
+
+        struct Descriptor
+        {
+            uint64_t hash = 0;
+            float radius = 0.f;     ///< Bounding sphere radius around the centroid in world space.
+        };
+
+        void hashWord(uint64_t& h, uint64_t v)
+        {
+            // FNV-1a over 32-bit words.
+            h = (h ^ (v & 0xffffffff)) * 0x100000001b3ull;
+            h = (h ^ (v >> 32)) * 0x100000001b3ull;
+        }
+
+        uint32_t floatBits(float f)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            return bits;
+        }
+
+        uint32_t getIndexWordCount(const DuplicateMeshDetector::Mesh& mesh)
+        {
+            return mesh.use16BitIndices ? (mesh.indexCount + 1) / 2 : mesh.indexCount;
+        }
+
+        void transformPositions(const DuplicateMeshDetector::Mesh& mesh, std::vector<float3>& positions)
+        {
+            positions.resize(mesh.vertexCount);
+            for (uint32_t i = 0; i < mesh.vertexCount; i++) positions[i] = float3(mesh.transform * float4(mesh.vertices[i].position, 1.f));
+        }
+
+        Descriptor computeDescriptor(const DuplicateMeshDetector::Mesh& mesh, std::vector<float3>& positions)
+        {
+            // Hash the attributes that are invariant to rigid transforms: connectivity and texture coordinates.
+            uint64_t h = 0xcbf29ce484222325ull;
+            hashWord(h, mesh.key);
+            hashWord(h, ((uint64_t)mesh.vertexCount << 32) | mesh.indexCount);
+            hashWord(h, mesh.use16BitIndices ? 1 : 0);
+            const uint32_t wordCount = getIndexWordCount(mesh);
+            for (uint32_t i = 0; i < wordCount; i++) hashWord(h, mesh.indexData[i]);
+            for (uint32_t i = 0; i < mesh.vertexCount; i++)
+            {
+                const float2 uv = mesh.vertices[i].texCrd;
+                hashWord(h, ((uint64_t)floatBits(uv.x) << 32) | floatBits(uv.y));
+            }
+
+            // Add the radius of gyration in world space, quantized on a log scale.
+            transformPositions(mesh, positions);
+            glm::dvec3 centroid(0.0);
+            for (const auto& p : positions) centroid += glm::dvec3(p);
+            centroid /= (double)std::max(mesh.vertexCount, 1u);
+
+            double sumSqrDist = 0.0, maxSqrDist = 0.0;
+            for (const auto& p : positions)
+            {
+                const glm::dvec3 d = glm::dvec3(p) - centroid;
+                const double sqrDist = glm::dot(d, d);
+                sumSqrDist += sqrDist;
+                maxSqrDist = std::max(maxSqrDist, sqrDist);
+            }
+
+            const double gyration = std::sqrt(sumSqrDist / std::max(mesh.vertexCount, 1u));
+            hashWord(h, gyration > 0.0 ? (uint64_t)(int64_t)std::floor(std::log2(gyration) * kRadiusBinsPerOctave) : 0);
+
+            return { h, (float)std::sqrt(maxSqrDist) };
+        }
+
+        /** Compute the eigenvector of the largest eigenvalue of a symmetric 4x4 matrix with Jacobi rotations.
+        */
+        void largestEigenvector(double a[4][4], double v[4])
+        {
+            double vectors[4][4] = {};
+            for (int i = 0; i < 4; i++) vectors[i][i] = 1.0;
+
+            for (int sweep = 0; sweep < 32; sweep++)
+            {
+                double offDiagonal = 0.0;
+                for (int p = 0; p < 3; p++) for (int q = p + 1; q < 4; q++) offDiagonal += a[p][q] * a[p][q];
+                if (offDiagonal < 1e-30) break;
+
+                for (int p = 0; p < 3; p++)
+                {
+                    for (int q = p + 1; q < 4; q++)
+                    {
+                        if (a[p][q] == 0.0) continue;
+
+                        const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                        const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                        const double c = 1.0 / std::sqrt(t * t + 1.0);
+                        const double s = t * c;
+
+                        for (int k = 0; k < 4; k++)
+                        {
+                            const double akp = a[k][p], akq = a[k][q];
+                            a[k][p] = c * akp - s * akq;
+                            a[k][q] = s * akp + c * akq;
+                        }
+                        for (int k = 0; k < 4; k++)
+                        {
+                            const double apk = a[p][k], aqk = a[q][k];
+                            a[p][k] = c * apk - s * aqk;
+                            a[q][k] = s * apk + c * aqk;
+                        }
+                        for (int k = 0; k < 4; k++)
+                        {
+                            const double vkp = vectors[k][p], vkq = vectors[k][q];
+                            vectors[k][p] = c * vkp - s * vkq;
+                            vectors[k][q] = s * vkp + c * vkq;
+                        }
+                    }
+                }
+            }
+
+            int largest = 0;
+            for (int i = 1; i < 4; i++) if (a[i][i] > a[largest][largest]) largest = i;
+            for (int k = 0; k < 4; k++) v[k] = vectors[k][largest];
+        }
+
+        /** Check if a mesh is a rigidly transformed copy of a prototype and compute the transform.
+        */
+        bool matchMesh(const DuplicateMeshDetector::Mesh& prototype, const std::vector<float3>& prototypePositions,
+                       const DuplicateMeshDetector::Mesh& mesh, const std::vector<float3>& positions,
+                       float maxError, DuplicateMeshDetector::Match& match)
+        {
+            // The descriptor hash may collide, so compare the transform invariant data exactly.
+            if (prototype.key != mesh.key || prototype.vertexCount != mesh.vertexCount || prototype.indexCount != mesh.indexCount ||
+                prototype.use16BitIndices != mesh.use16BitIndices) return false;
+            if (mesh.indexCount > 0 && std::memcmp(prototype.indexData, mesh.indexData, getIndexWordCount(mesh) * sizeof(uint32_t)) != 0) return false;
+            for (uint32_t i = 0; i < mesh.vertexCount; i++)
+            {
+                if (prototype.vertices[i].texCrd != mesh.vertices[i].texCrd) return false;
+            }
+
+            // Register the positions and verify the error.
+            const glm::mat4 transform = DuplicateMeshDetector::registerPoints(prototypePositions.data(), positions.data(), positions.size());
+            float maxSqrError = 0.f;
+            for (uint32_t i = 0; i < mesh.vertexCount; i++)
+            {
+                const float3 d = float3(transform * float4(prototypePositions[i], 1.f)) - positions[i];
+                maxSqrError = std::max(maxSqrError, glm::dot(d, d));
+                if (maxSqrError > maxError * maxError) return false;
+            }
+
+            // Verify the shading frames. Normals transform by the inverse transpose and tangents by the upper 3x3 of the transforms.
+            const glm::mat3 rotation = glm::mat3(transform);
+            const glm::mat3 prototypeNormalTransform = glm::transpose(glm::inverse(glm::mat3(prototype.transform)));
+            const glm::mat3 normalTransform = glm::transpose(glm::inverse(glm::mat3(mesh.transform)));
+            auto matchDirection = [&](float3 a, float3 b)
+            {
+                const float lengthA = glm::length(a), lengthB = glm::length(b);
+                if (lengthA == 0.f || lengthB == 0.f) return lengthA == lengthB;
+                return glm::dot(rotation * a, b) >= kMinDirectionCosine * lengthA * lengthB;
+            };
+
+            for (uint32_t i = 0; i < mesh.vertexCount; i++)
+            {
+                const auto& a = prototype.vertices[i];
+                const auto& b = mesh.vertices[i];
+                if (!matchDirection(prototypeNormalTransform * a.normal, normalTransform * b.normal)) return false;
+                if (a.tangent.w != b.tangent.w) return false;
+                if (a.tangent.w != 0.f && !matchDirection(glm::mat3(prototype.transform) * float3(a.tangent), glm::mat3(mesh.transform) * float3(b.tangent))) return false;
+            }
+
+            match.transform = transform;
+            match.error = std::sqrt(maxSqrError);
+            return true;
+        }
+    }
+
+    glm::mat4 DuplicateMeshDetector::registerPoints(const float3* src, const float3* dst, size_t count)
+    {
+        if (count == 0) return glm::identity<glm::mat4>();
+
+        glm::dvec3 srcCentroid(0.0), dstCentroid(0.0);
+        for (size_t i = 0; i < count; i++)
+        {
+            srcCentroid += glm::dvec3(src[i]);
+            dstCentroid += glm::dvec3(dst[i]);
+        }
+        srcCentroid /= (double)count;
+        dstCentroid /= (double)count;
+
+        // Cross-covariance of the centered point sets, s[j][k] = sum(a_j * b_k).
+        double s[3][3] = {};
+        for (size_t i = 0; i < count; i++)
+        {
+            const glm::dvec3 a = glm::dvec3(src[i]) - srcCentroid;
+            const glm::dvec3 b = glm::dvec3(dst[i]) - dstCentroid;
+            for (int j = 0; j < 3; j++) for (int k = 0; k < 3; k++) s[j][k] += a[j] * b[k];
+        }
+
+        // The optimal rotation is the unit quaternion maximizing q^T N q, i.e. the eigenvector of the largest eigenvalue of N (Horn 1987).
+        const double sxx = s[0][0], sxy = s[0][1], sxz = s[0][2];
+        const double syx = s[1][0], syy = s[1][1], syz = s[1][2];
+        const double szx = s[2][0], szy = s[2][1], szz = s[2][2];
+        double n[4][4] =
+        {
+            { sxx + syy + szz, syz - szy, szx - sxz, sxy - syx },
+            { syz - szy, sxx - syy - szz, sxy + syx, szx + sxz },
+            { szx - sxz, sxy + syx, -sxx + syy - szz, syz + szy },
+            { sxy - syx, szx + sxz, syz + szy, -sxx - syy + szz },
+        };
+
+        double q[4];
+        largestEigenvector(n, q);
+        const double length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        const double w = q[0] / length, x = q[1] / length, y = q[2] / length, z = q[3] / length;
+
+        // Rotation matrix of the unit quaternion (w, x, y, z), stored by columns.
+        const glm::dvec3 r[3] =
+        {
+            { 1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y + w * z), 2.0 * (x * z - w * y) },
+            { 2.0 * (x * y - w * z), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z + w * x) },
+            { 2.0 * (x * z + w * y), 2.0 * (y * z - w * x), 1.0 - 2.0 * (x * x + y * y) },
+        };
+        const glm::dvec3 t = dstCentroid - (r[0] * srcCentroid.x + r[1] * srcCentroid.y + r[2] * srcCentroid.z);
+
+        glm::mat4 transform = glm::identity<glm::mat4>();
+        for (int c = 0; c < 3; c++) transform[c] = float4(float3(r[c]), 0.f);
+        transform[3] = float4(float3(t), 1.f);
+        return transform;
+    }
+
+    std::vector<DuplicateMeshDetector::Match> DuplicateMeshDetector::detect(const std::vector<Mesh>& meshes, float tolerance, Stats* pStats)
+    {
+        const uint32_t meshCount = (uint32_t)meshes.size();
+        std::vector<Match> matches(meshCount);
+
+        // Compute the shape descriptors.
+        std::vector<Descriptor> descriptors(meshCount);
+        auto meshIDs = NumericRange<uint32_t>(0, meshCount);
+        std::for_each(std::execution::par, meshIDs.begin(), meshIDs.end(), [&](uint32_t meshID)
+        {
+            thread_local std::vector<float3> positions;
+            descriptors[meshID] = computeDescriptor(meshes[meshID], positions);
+        });
+
+        // Sort the meshes by descriptor to form buckets of potential duplicates. Ties are ordered by mesh ID, so prototypes have the lowest IDs.
+        std::vector<uint32_t> order(meshCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+        {
+            return descriptors[a].hash != descriptors[b].hash ? descriptors[a].hash < descriptors[b].hash : a < b;
+        });
+
+        std::vector<uint32_t> bucketStart;
+        for (uint32_t i = 0; i < meshCount; i++)
+        {
+            if (i == 0 || descriptors[order[i]].hash != descriptors[order[i - 1]].hash) bucketStart.push_back(i);
+        }
+        bucketStart.push_back(meshCount);
+
+        // Match the meshes within each bucket against the prototypes found so far in the bucket.
+        std::atomic<uint32_t> registrationCount = 0;
+        auto buckets = NumericRange<uint32_t>(0, (uint32_t)bucketStart.size() - 1);
+        std::for_each(std::execution::par, buckets.begin(), buckets.end(), [&](uint32_t bucket)
+        {
+            const uint32_t begin = bucketStart[bucket], end = bucketStart[bucket + 1];
+            if (end - begin < 2) return;
+
+            std::vector<std::pair<uint32_t, std::vector<float3>>> prototypes;
+            std::vector<float3> positions;
+            for (uint32_t i = begin; i < end; i++)
+            {
+                const uint32_t meshID = order[i];
+                const auto& mesh = meshes[meshID];
+                transformPositions(mesh, positions);
+
+                const float maxError = tolerance * descriptors[meshID].radius;
+                bool matched = false;
+                for (const auto& [prototypeID, prototypePositions] : prototypes)
+                {
+                    registrationCount++;
+                    if (matchMesh(meshes[prototypeID], prototypePositions, mesh, positions, maxError, matches[meshID]))
+                    {
+                        matches[meshID].prototypeID = prototypeID;
+                        matched = true;
+                        break;
+                    }
+                }
+                if (!matched) prototypes.push_back({ meshID, positions });
+            }
+        });
+
+        if (pStats)
+        {
+            *pStats = Stats();
+            pStats->meshCount = meshCount;
+            pStats->registrationCount = registrationCount;
+            std::vector<bool> isPrototype(meshCount, false);
+            for (uint32_t meshID = 0; meshID < meshCount; meshID++)
+            {
+                pStats->vertexCount += meshes[meshID].vertexCount;
+                if (matches[meshID].prototypeID == kInvalidID) continue;
+                pStats->duplicateCount++;
+                if (!isPrototype[matches[meshID].prototypeID]) pStats->prototypeCount++;
+                isPrototype[matches[meshID].prototypeID] = true;
+            }
+        }
+
+        return matches;
+    }
+}
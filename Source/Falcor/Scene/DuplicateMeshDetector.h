@@ -0,0 +1,89 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "SceneTypes.slang"
+
+namespace Falcor
+{
+    /** Detection of meshes that are rigidly transformed copies of each other.
+
+        Imported assets often contain many copies of the same object with the transform baked into the vertices.
+        Meshes are bucketed by a hash of a shape descriptor that is invariant to rotation and translation
+        (connectivity, texture coordinates and the radius of gyration). Within a bucket, the rigid transform
+        between two meshes is recovered from their corresponding vertices by point registration (Horn's
+        quaternion method) and the match is verified against all vertex attributes.
+    */
+    class dlldecl DuplicateMeshDetector
+    {
+    public:
+        static const uint32_t kInvalidID = 0xffffffff;
+
+        struct Mesh
+        {
+            const StaticVertexData* vertices = nullptr; ///< Vertex data in object space.
+            uint32_t vertexCount = 0;                   ///< Number of vertices.
+            const uint32_t* indexData = nullptr;        ///< Triangle list indices packed in 16-bit or 32-bit format, or nullptr if non-indexed.
+            uint32_t indexCount = 0;                    ///< Number of indices.
+            bool use16BitIndices = false;               ///< True if the indices are in 16-bit format.
+            glm::mat4 transform = glm::identity<glm::mat4>(); ///< Object to world transform.
+            uint64_t key = 0;                           ///< Meshes are only matched if their keys are equal (e.g. material and winding).
+        };
+
+        struct Match
+        {
+            uint32_t prototypeID = kInvalidID;          ///< Mesh this mesh is a copy of, or kInvalidID if the mesh is unique or a prototype.
+            glm::mat4 transform = glm::identity<glm::mat4>(); ///< Rigid transform in world space from the prototype to this mesh.
+            float error = 0.f;                          ///< Largest position error of the transform in world space.
+        };
+
+        struct Stats
+        {
+            uint32_t meshCount = 0;                     ///< Number of meshes analyzed.
+            uint32_t prototypeCount = 0;                ///< Number of meshes with at least one copy.
+            uint32_t duplicateCount = 0;                ///< Number of meshes that are copies of a prototype.
+            uint32_t registrationCount = 0;             ///< Number of point registrations performed.
+            uint64_t vertexCount = 0;                   ///< Number of vertices analyzed.
+        };
+
+        /** Find rigidly transformed duplicates.
+            \param[in] meshes Meshes to analyze.
+            \param[in] tolerance Largest accepted position error relative to the mesh bounding sphere radius.
+            \param[out] pStats Optional detection statistics.
+            \return Match for each mesh. The prototype of a match always has a lower index than the duplicate.
+        */
+        static std::vector<Match> detect(const std::vector<Mesh>& meshes, float tolerance, Stats* pStats = nullptr);
+
+        /** Find the rigid transform that best maps a set of points onto another in the least squares sense.
+            \param[in] src Source points.
+            \param[in] dst Destination points. The point at each index corresponds to the source point with the same index.
+            \param[in] count Number of points.
+            \return Rigid transform (rotation and translation) from the source to the destination points.
+        */
+        static glm::mat4 registerPoints(const float3* src, const float3* dst, size_t count);
+    };
+}
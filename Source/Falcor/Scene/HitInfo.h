@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include "Falcor.h"
+#include "HitInfoType.slang"
 
 namespace Falcor
 {
@@ -60,6 +61,38 @@ namespace Falcor
             else return ResourceFormat::RGBA32Uint; // RGB32Uint can't be used for UAV writes
         }
 
+        /** Encode hit information on the host, producing the same packed data as HitInfo::encode() in HitInfo.slang.
+            This is used to match the output of the CPU ray tracing backend (SceneBVH) with GPU ray tracing.
+            \param[in] instanceType Type of the hit instance.
+            \param[in] instanceID Instance ID.
+            \param[in] primitiveIndex Primitive index within the instance.
+            \param[in] barycentrics Barycentrics of the hit.
+            \return Packed hit information. Only the first two components are used for the RG32Uint format.
+        */
+        uint4 encode(InstanceType instanceType, uint32_t instanceID, uint32_t primitiveIndex, float2 barycentrics) const
+        {
+            auto packUnorm16 = [](float v) { return (uint32_t)std::trunc(std::clamp(v, 0.f, 1.f) * 65535.f + 0.5f); };
+            const uint32_t packedBarycentrics = (packUnorm16(barycentrics.y) << 16) | packUnorm16(barycentrics.x);
+
+            uint4 packed(0);
+            if (mInstanceTypeBits + mInstanceIndexBits + mPrimitiveIndexBits <= 32)
+            {
+                packed.x = ((uint32_t)instanceType << (mInstanceIndexBits + mPrimitiveIndexBits)) | (instanceID << mPrimitiveIndexBits) | primitiveIndex;
+                packed.y = packedBarycentrics;
+            }
+            else
+            {
+                packed.x = ((uint32_t)instanceType << mInstanceIndexBits) | instanceID;
+                packed.y = primitiveIndex;
+                packed.z = packedBarycentrics;
+            }
+            return packed;
+        }
+
+        /** Returns the packed data of an invalid hit.
+        */
+        static uint4 encodeInvalid() { return uint4(kInvalidIndex, 0, 0, 0); }
+
         HitInfo() = default;
         HitInfo(const Scene & scene) { init(scene); }
         void init(const Scene& scene);
@@ -503,95 +503,108 @@ namespace Falcor
             }
         }
 
-        void createMeshes(ImporterData& data)
+        SceneBuilder::ProcessedMesh processMesh(ImporterData& data, const aiMesh* pAiMesh, bool loadTangents)
         {
-            const aiScene* pScene = data.pScene;
-            const bool loadTangents = is_set(data.builder.getFlags(), SceneBuilder::Flags::UseOriginalTangentSpace);
+            const uint32_t perFaceIndexCount = pAiMesh->mFaces[0].mNumIndices;
 
-            uint32_t meshCount = pScene->mNumMeshes;
+            SceneBuilder::Mesh mesh;
+            mesh.name = pAiMesh->mName.C_Str();
+            mesh.faceCount = pAiMesh->mNumFaces;
+
+            // Temporary memory for the vertex and index data.
+            std::vector<uint32_t> indexList;
+            std::vector<float2> texCrds;
+            std::vector<float4> tangents;
+            std::vector<uint4> boneIds;
+            std::vector<float4> boneWeights;
+
+            // Indices
+            createIndexList(pAiMesh, indexList);
+            assert(indexList.size() <= std::numeric_limits<uint32_t>::max());
+            mesh.indexCount = (uint32_t)indexList.size();
+            mesh.pIndices = indexList.data();
+
+            // Vertices
+            assert(pAiMesh->mVertices);
+            mesh.vertexCount = pAiMesh->mNumVertices;
+            static_assert(sizeof(pAiMesh->mVertices[0]) == sizeof(mesh.positions.pData[0]));
+            static_assert(sizeof(pAiMesh->mNormals[0]) == sizeof(mesh.normals.pData[0]));
+            mesh.positions.pData = reinterpret_cast<float3*>(pAiMesh->mVertices);
+            mesh.positions.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
+            mesh.normals.pData = reinterpret_cast<float3*>(pAiMesh->mNormals);
+            mesh.normals.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
+
+            if (pAiMesh->HasTextureCoords(0))
+            {
+                createTexCrdList(pAiMesh->mTextureCoords[0], pAiMesh->mNumVertices, texCrds);
+                assert(!texCrds.empty());
+                mesh.texCrds.pData = texCrds.data();
+                mesh.texCrds.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
+            }
 
-            // Pre-process meshes.
-            std::vector<SceneBuilder::ProcessedMesh> processedMeshes(meshCount);
-            auto range = NumericRange<uint32_t>(0, meshCount);
-            std::for_each(std::execution::par, range.begin(), range.end(), [&] (uint32_t i) {
-                const aiMesh* pAiMesh = pScene->mMeshes[i];
-                const uint32_t perFaceIndexCount = pAiMesh->mFaces[0].mNumIndices;
-
-                SceneBuilder::Mesh mesh;
-                mesh.name = pAiMesh->mName.C_Str();
-                mesh.faceCount = pAiMesh->mNumFaces;
-
-                // Temporary memory for the vertex and index data.
-                std::vector<uint32_t> indexList;
-                std::vector<float2> texCrds;
-                std::vector<float4> tangents;
-                std::vector<uint4> boneIds;
-                std::vector<float4> boneWeights;
-
-                // Indices
-                createIndexList(pAiMesh, indexList);
-                assert(indexList.size() <= std::numeric_limits<uint32_t>::max());
-                mesh.indexCount = (uint32_t)indexList.size();
-                mesh.pIndices = indexList.data();
-
-                // Vertices
-                assert(pAiMesh->mVertices);
-                mesh.vertexCount = pAiMesh->mNumVertices;
-                static_assert(sizeof(pAiMesh->mVertices[0]) == sizeof(mesh.positions.pData[0]));
-                static_assert(sizeof(pAiMesh->mNormals[0]) == sizeof(mesh.normals.pData[0]));
-                mesh.positions.pData = reinterpret_cast<float3*>(pAiMesh->mVertices);
-                mesh.positions.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
-                mesh.normals.pData = reinterpret_cast<float3*>(pAiMesh->mNormals);
-                mesh.normals.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
-
-                if (pAiMesh->HasTextureCoords(0))
-                {
-                    createTexCrdList(pAiMesh->mTextureCoords[0], pAiMesh->mNumVertices, texCrds);
-                    assert(!texCrds.empty());
-                    mesh.texCrds.pData = texCrds.data();
-                    mesh.texCrds.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
-                }
+            if (loadTangents && pAiMesh->HasTangentsAndBitangents())
+            {
+                createTangentList(pAiMesh->mTangents, pAiMesh->mBitangents, pAiMesh->mNormals, pAiMesh->mNumVertices, tangents);
+                assert(!tangents.empty());
+                mesh.tangents.pData = tangents.data();
+                mesh.tangents.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
+            }
 
-                if (loadTangents && pAiMesh->HasTangentsAndBitangents())
-                {
-                    createTangentList(pAiMesh->mTangents, pAiMesh->mBitangents, pAiMesh->mNormals, pAiMesh->mNumVertices, tangents);
-                    assert(!tangents.empty());
-                    mesh.tangents.pData = tangents.data();
-                    mesh.tangents.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
-                }
+            if (pAiMesh->HasBones())
+            {
+                loadBones(pAiMesh, data, boneWeights, boneIds);
+                mesh.boneIDs.pData = boneIds.data();
+                mesh.boneIDs.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
+                mesh.boneWeights.pData = boneWeights.data();
+                mesh.boneWeights.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
+            }
 
-                if (pAiMesh->HasBones())
-                {
-                    loadBones(pAiMesh, data, boneWeights, boneIds);
-                    mesh.boneIDs.pData = boneIds.data();
-                    mesh.boneIDs.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
-                    mesh.boneWeights.pData = boneWeights.data();
-                    mesh.boneWeights.frequency = SceneBuilder::Mesh::AttributeFrequency::Vertex;
-                }
+            switch (perFaceIndexCount)
+            {
+            case 1: mesh.topology = Vao::Topology::PointList; break;
+            case 2: mesh.topology = Vao::Topology::LineList; break;
+            case 3: mesh.topology = Vao::Topology::TriangleList; break;
+            default:
+                logError("Error when creating mesh. Unknown topology with " + std::to_string(perFaceIndexCount) + " indices per face.");
+                should_not_get_here();
+            }
 
-                switch (perFaceIndexCount)
-                {
-                case 1: mesh.topology = Vao::Topology::PointList; break;
-                case 2: mesh.topology = Vao::Topology::LineList; break;
-                case 3: mesh.topology = Vao::Topology::TriangleList; break;
-                default:
-                    logError("Error when creating mesh. Unknown topology with " + std::to_string(perFaceIndexCount) + " indices per face.");
-                    should_not_get_here();
-                }
+            mesh.pMaterial = data.materialMap.at(pAiMesh->mMaterialIndex);
+
+            return data.builder.processMesh(mesh);
+        }
 
-                mesh.pMaterial = data.materialMap.at(pAiMesh->mMaterialIndex);
+        void createMeshes(ImporterData& data)
+        {
+            const aiScene* pScene = data.pScene;
+            const bool loadTangents = is_set(data.builder.getFlags(), SceneBuilder::Flags::UseOriginalTangentSpace);
 
-                processedMeshes[i] = data.builder.processMesh(mesh);
-            });
+            uint32_t meshCount = pScene->mNumMeshes;
+
+            // Meshes are processed in batches to bound the peak memory usage. Only the processed meshes of a single batch
+            // are alive at any time. The source data is owned by the assimp importer and released with it.
+            const uint32_t batchSize = std::max(1u, std::thread::hardware_concurrency());
+            std::vector<SceneBuilder::ProcessedMesh> processedMeshes;
 
-            // Add meshes to the scene.
-            // We retain a deterministic order of the meshes in the global scene buffer by adding
-            // them sequentially after being processed in parallel.
-            uint32_t i = 0;
-            for (const auto& mesh : processedMeshes)
+            for (uint32_t batchStart = 0; batchStart < meshCount; batchStart += batchSize)
             {
-                uint32_t meshID = data.builder.addProcessedMesh(mesh);
-                data.meshMap[i++] = meshID;
+                const uint32_t batchEnd = std::min(batchStart + batchSize, meshCount);
+                processedMeshes.resize(batchEnd - batchStart);
+
+                // Pre-process meshes.
+                auto range = NumericRange<uint32_t>(batchStart, batchEnd);
+                std::for_each(std::execution::par, range.begin(), range.end(), [&] (uint32_t i) {
+                    processedMeshes[i - batchStart] = processMesh(data, pScene->mMeshes[i], loadTangents);
+                });
+
+                // Add meshes to the scene.
+                // We retain a deterministic order of the meshes in the global scene buffer by adding
+                // them sequentially after being processed in parallel.
+                for (uint32_t i = batchStart; i < batchEnd; i++)
+                {
+                    uint32_t meshID = data.builder.addProcessedMesh(std::move(processedMeshes[i - batchStart]));
+                    data.meshMap[i] = meshID;
+                }
             }
         }
 
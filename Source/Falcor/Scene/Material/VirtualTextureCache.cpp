@@ -0,0 +1,423 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "VirtualTextureCache.h"
+#include <sstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kMaxPhysicalPageCount = 1 << 24; // Limited by the page table entry encoding.
+
+        double getElapsedSeconds(CpuTimer::TimePoint start)
+        {
+            return CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1e-3;
+        }
+    }
+
+    VirtualTextureCache::VirtualTextureCache(const VirtualTexturePageFile::SharedPtr& pPageFile, const Desc& desc)
+        : mpPageFile(pPageFile)
+        , mDesc(desc)
+    {
+        // Every texture needs a physical page for its coarsest mip, plus one to load other pages into.
+        const uint32_t textureCount = pPageFile->getTextureCount();
+        const uint32_t slotCount = std::min(kMaxPhysicalPageCount, std::max(desc.physicalPageCount, textureCount + 1));
+        if (slotCount != desc.physicalPageCount)
+        {
+            logWarning("VirtualTextureCache: Using " + std::to_string(slotCount) + " physical pages instead of " + std::to_string(desc.physicalPageCount) + ".");
+        }
+
+        mSlots.resize(slotCount);
+        mFreeSlots.resize(slotCount);
+        for (uint32_t i = 0; i < slotCount; i++) mFreeSlots[i] = slotCount - 1 - i;
+
+        mSlotBytes = pPageFile->getMaxPageBytes();
+        mSlotData.resize(mSlotBytes * slotCount);
+
+        size_t pageCount = 0;
+        for (uint32_t i = 0; i < textureCount; i++)
+        {
+            mTableOffsets.push_back(pageCount);
+            pageCount += pPageFile->getTexture(i).pageCount;
+        }
+        mPageSlots.resize(pageCount, uint32_t(kInvalidSlot));
+        mPageTable.resize(pageCount, uint32_t(kNonResident));
+    }
+
+    VirtualTextureCache::~VirtualTextureCache()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+        }
+        mCondition.notify_all();
+        for (auto& thread : mThreads) thread.join();
+    }
+
+    VirtualTextureCache::SharedPtr VirtualTextureCache::create(const VirtualTexturePageFile::SharedPtr& pPageFile, const Desc& desc)
+    {
+        if (!pPageFile) return nullptr;
+
+        SharedPtr pCache = SharedPtr(new VirtualTextureCache(pPageFile, desc));
+        if (!pCache->loadCoarsestMips()) return nullptr;
+
+        for (uint32_t i = 0; i < std::max(1u, desc.threadCount); i++)
+        {
+            pCache->mThreads.emplace_back(&VirtualTextureCache::runWorker, pCache.get());
+        }
+        return pCache;
+    }
+
+    bool VirtualTextureCache::loadCoarsestMips()
+    {
+        // The coarsest stored mip always fits into a single page.
+        for (uint32_t texture = 0; texture < mpPageFile->getTextureCount(); texture++)
+        {
+            const auto& desc = mpPageFile->getTexture(texture);
+            PageID page = { texture, desc.mipCount - 1, 0, 0 };
+            assert(desc.pageCount - desc.mipPageOffsets[page.mip] == 1);
+
+            uint32_t slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+            if (!mpPageFile->readPage(page, &mSlotData[slot * mSlotBytes]))
+            {
+                logError("VirtualTextureCache: Failed to load the coarsest mip of texture '" + desc.name + "'.");
+                return false;
+            }
+
+            mSlots[slot].page = page;
+            mSlots[slot].state = SlotState::Pinned;
+            mPageSlots[getTableIndex(page)] = slot;
+            updatePageTable(page);
+            mPageUpdates.push_back({ page, slot });
+        }
+        return true;
+    }
+
+    void VirtualTextureCache::requestPages(const std::vector<PageID>& pages)
+    {
+        for (const auto& page : pages)
+        {
+            if (!mpPageFile->isValidPage(page)) continue;
+            if (!mRequestedKeys.insert(page.getKey()).second) continue;
+            if (mRecordTrace) mFrameRequests.push_back(page);
+
+            mStats.requests++;
+            uint32_t slot = mPageSlots[getTableIndex(page)];
+            if (slot != kInvalidSlot)
+            {
+                // Mark the page as most recently used.
+                mStats.hits++;
+                Slot& s = mSlots[slot];
+                s.lastRequestFrame = mFrame;
+                if (s.state == SlotState::Resident) mLru.splice(mLru.end(), mLru, s.lruIt);
+            }
+            else
+            {
+                mStats.misses++;
+                if (mLoadingPages.count(page.getKey()) == 0) mRequests.push_back(page);
+            }
+        }
+    }
+
+    void VirtualTextureCache::update(bool waitForLoads)
+    {
+        mPageUpdates.clear();
+        applyCompletedLoads();
+        startLoads();
+
+        if (waitForLoads)
+        {
+            this->waitForLoads();
+            applyCompletedLoads();
+        }
+
+        if (mRecordTrace) mRecordedTrace.push_back(std::move(mFrameRequests));
+        mFrameRequests.clear();
+        mRequests.clear();
+        mRequestedKeys.clear();
+        mStats.frames++;
+        mFrame++;
+    }
+
+    void VirtualTextureCache::waitForLoads()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCondition.wait(lock, [this] { return mJobsInFlight == 0; });
+    }
+
+    void VirtualTextureCache::applyCompletedLoads()
+    {
+        std::vector<LoadJob> completedJobs;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            std::swap(completedJobs, mCompletedJobs);
+        }
+
+        // Apply the loads in the order they were started, independent of the order the threads finished them.
+        std::sort(completedJobs.begin(), completedJobs.end(), [](const LoadJob& a, const LoadJob& b) { return a.sequence < b.sequence; });
+
+        for (const auto& job : completedJobs)
+        {
+            mLoadingPages.erase(job.page.getKey());
+            mStats.loadTime += job.loadTime;
+            if (job.success)
+            {
+                mStats.pagesLoaded++;
+                mStats.bytesLoaded += mpPageFile->getTexture(job.page.texture).pageBytes;
+                setResident(job.page, job.slot);
+            }
+            else
+            {
+                mStats.loadFailures++;
+                mSlots[job.slot].state = SlotState::Free;
+                mFreeSlots.push_back(job.slot);
+            }
+        }
+    }
+
+    void VirtualTextureCache::startLoads()
+    {
+        // Load coarse mips first, so that fallbacks for finer pages become available early.
+        std::stable_sort(mRequests.begin(), mRequests.end(), [](const PageID& a, const PageID& b) { return a.mip > b.mip; });
+
+        std::vector<LoadJob> jobs;
+        for (const auto& page : mRequests)
+        {
+            if (jobs.size() >= mDesc.maxLoadsPerUpdate) break;
+
+            uint32_t slot = allocateSlot();
+            if (slot == kInvalidSlot) break;
+
+            mSlots[slot].page = page;
+            mSlots[slot].state = SlotState::Loading;
+            mSlots[slot].lastRequestFrame = mFrame;
+            mLoadingPages.insert(page.getKey());
+            jobs.push_back({ page, slot, mLoadSequence++ });
+        }
+        mStats.loadsDeferred += mRequests.size() - jobs.size();
+        if (jobs.empty()) return;
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mJobsInFlight += (uint32_t)jobs.size();
+            mJobs.insert(mJobs.end(), jobs.begin(), jobs.end());
+        }
+        mCondition.notify_all();
+    }
+
+    uint32_t VirtualTextureCache::allocateSlot()
+    {
+        if (!mFreeSlots.empty())
+        {
+            uint32_t slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+            return slot;
+        }
+
+        // Evict the least recently requested page, unless it was requested in this frame.
+        if (mLru.empty()) return kInvalidSlot;
+        uint32_t slot = mLru.front();
+        Slot& s = mSlots[slot];
+        if (s.lastRequestFrame >= mFrame) return kInvalidSlot;
+
+        mLru.pop_front();
+        mPageSlots[getTableIndex(s.page)] = kInvalidSlot;
+        updatePageTable(s.page);
+        s.state = SlotState::Free;
+        mStats.pagesEvicted++;
+        return slot;
+    }
+
+    void VirtualTextureCache::setResident(const PageID& page, uint32_t slot)
+    {
+        Slot& s = mSlots[slot];
+        s.state = SlotState::Resident;
+        s.lruIt = mLru.insert(mLru.end(), slot);
+        mPageSlots[getTableIndex(page)] = slot;
+        updatePageTable(page);
+        mPageUpdates.push_back({ page, slot });
+    }
+
+    void VirtualTextureCache::updatePageTable(const PageID& page)
+    {
+        // Walk down the mips, updating the entries of the page and all pages resolving to it.
+        // A page is the parent of the pages at the next finer mip covering it. The last row and column of
+        // pages in a mip is also the parent of the pages that extend beyond it, as mip sizes are rounded down.
+        uint32_t x0 = page.x, x1 = page.x + 1, y0 = page.y, y1 = page.y + 1;
+        for (int mip = (int)page.mip; mip >= 0; mip--)
+        {
+            if (mip < (int)page.mip)
+            {
+                uint2 parentCount = mpPageFile->getPageCount(page.texture, mip + 1);
+                uint2 pageCount = mpPageFile->getPageCount(page.texture, mip);
+                x1 = x1 == parentCount.x ? pageCount.x : std::min(2 * x1, pageCount.x);
+                y1 = y1 == parentCount.y ? pageCount.y : std::min(2 * y1, pageCount.y);
+                x0 = std::min(2 * x0, x1);
+                y0 = std::min(2 * y0, y1);
+            }
+
+            for (uint32_t y = y0; y < y1; y++)
+            {
+                for (uint32_t x = x0; x < x1; x++)
+                {
+                    PageID p = { page.texture, (uint32_t)mip, x, y };
+                    mPageTable[getTableIndex(p)] = resolveEntry(p);
+                }
+            }
+        }
+    }
+
+    uint32_t VirtualTextureCache::resolveEntry(PageID page) const
+    {
+        const uint32_t mipCount = mpPageFile->getTexture(page.texture).mipCount;
+        while (true)
+        {
+            uint32_t slot = mPageSlots[getTableIndex(page)];
+            if (slot != kInvalidSlot) return slot | (page.mip << 24);
+            if (++page.mip >= mipCount) return kNonResident;
+
+            uint2 pageCount = mpPageFile->getPageCount(page.texture, page.mip);
+            page.x = std::min(page.x / 2, pageCount.x - 1);
+            page.y = std::min(page.y / 2, pageCount.y - 1);
+        }
+    }
+
+    uint32_t VirtualTextureCache::getSlot(const PageID& page) const
+    {
+        if (!mpPageFile->isValidPage(page)) return kInvalidSlot;
+        return mPageSlots[getTableIndex(page)];
+    }
+
+    uint32_t VirtualTextureCache::getPageTableEntry(const PageID& page) const
+    {
+        if (!mpPageFile->isValidPage(page)) return kNonResident;
+        return mPageTable[getTableIndex(page)];
+    }
+
+    const uint32_t* VirtualTextureCache::getPageTable(uint32_t texture, uint32_t mip) const
+    {
+        assert(mpPageFile->isValidPage({ texture, mip, 0, 0 }));
+        return &mPageTable[mTableOffsets[texture] + mpPageFile->getTexture(texture).mipPageOffsets[mip]];
+    }
+
+    VirtualTextureCache::Stats VirtualTextureCache::getStats() const
+    {
+        Stats stats = mStats;
+        stats.pendingPages = (uint32_t)mLoadingPages.size();
+        stats.residentPages = (uint32_t)(mSlots.size() - mFreeSlots.size()) - stats.pendingPages;
+        return stats;
+    }
+
+    void VirtualTextureCache::resetStats()
+    {
+        mStats = Stats();
+    }
+
+    void VirtualTextureCache::setTraceRecording(bool enabled)
+    {
+        if (enabled && !mRecordTrace) mRecordedTrace.clear();
+        mRecordTrace = enabled;
+        mFrameRequests.clear();
+    }
+
+    VirtualTextureCache::Stats VirtualTextureCache::replayTrace(const Trace& trace, bool waitForLoads)
+    {
+        resetStats();
+        for (const auto& frame : trace)
+        {
+            requestPages(frame);
+            update(waitForLoads);
+        }
+        return getStats();
+    }
+
+    bool VirtualTextureCache::saveTrace(const std::string& filename, const Trace& trace)
+    {
+        std::ofstream stream(filename);
+        if (!stream.is_open()) return false;
+
+        for (const auto& frame : trace)
+        {
+            for (size_t i = 0; i < frame.size(); i++)
+            {
+                const auto& page = frame[i];
+                stream << (i > 0 ? " " : "") << page.texture << "," << page.mip << "," << page.x << "," << page.y;
+            }
+            stream << "\n";
+        }
+        return stream.good();
+    }
+
+    bool VirtualTextureCache::loadTrace(const std::string& filename, Trace& trace)
+    {
+        std::ifstream stream(filename);
+        if (!stream.is_open()) return false;
+
+        trace.clear();
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            std::vector<PageID> frame;
+            std::istringstream lineStream(line);
+            std::string token;
+            while (lineStream >> token)
+            {
+                PageID page;
+                if (std::sscanf(token.c_str(), "%u,%u,%u,%u", &page.texture, &page.mip, &page.x, &page.y) != 4) return false;
+                frame.push_back(page);
+            }
+            trace.push_back(std::move(frame));
+        }
+        return true;
+    }
+
+    void VirtualTextureCache::runWorker()
+    {
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mTerminate || !mJobs.empty(); });
+            if (mTerminate) break;
+
+            LoadJob job = mJobs.front();
+            mJobs.pop_front();
+            lock.unlock();
+
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            job.success = mpPageFile->readPage(job.page, &mSlotData[job.slot * mSlotBytes]);
+            job.loadTime = getElapsedSeconds(startTime);
+
+            lock.lock();
+            mCompletedJobs.push_back(job);
+            mJobsInFlight--;
+            mDoneCondition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,258 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "VirtualTexturePageFile.h"
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Falcor
+{
+    /** Host page cache for out-of-core virtual texturing.
+
+        The cache holds a fixed budget of physical pages in host memory, each of which can hold any page of
+        the page file. The renderer reports the pages it needs (typically read back from a feedback buffer)
+        with requestPages(), and calls update() once per frame. update() starts asynchronous loads for the
+        missing pages, coarse mips first, and evicts the least recently requested pages to make room.
+        Pages requested in the current frame are never evicted.
+
+        The page table maps every page of every texture to the physical page holding it, or holding its
+        nearest resident ancestor in a coarser mip. The coarsest stored mip of each texture is loaded when
+        the cache is created and stays resident, so that every lookup resolves to some physical page.
+        A GPU backend uploads the pages listed by getPageUpdates() into a physical texture atlas and the
+        page table into indirection textures; the cache itself has no GPU dependencies.
+
+        Page requests can be recorded into a trace and replayed, which makes the residency behavior
+        reproducible and testable without rendering.
+    */
+    class dlldecl VirtualTextureCache
+    {
+    public:
+        using SharedPtr = std::shared_ptr<VirtualTextureCache>;
+        using PageID = VirtualTexturePageFile::PageID;
+
+        /** Page requests of a sequence of frames.
+        */
+        using Trace = std::vector<std::vector<PageID>>;
+
+        static const uint32_t kInvalidSlot = 0xffffffff;
+        static const uint32_t kNonResident = 0xffffffff;    ///< Page table entry of a page without resident ancestor.
+
+        struct Desc
+        {
+            uint32_t physicalPageCount = 1024;  ///< Number of physical pages, i.e. the residency budget.
+            uint32_t threadCount = 2;           ///< Number of page loading threads.
+            uint32_t maxLoadsPerUpdate = 256;   ///< Maximum number of page loads started per update.
+        };
+
+        struct Stats
+        {
+            uint64_t frames = 0;            ///< Number of updates.
+            uint64_t requests = 0;          ///< Number of page requests, counting each page once per frame.
+            uint64_t hits = 0;              ///< Requests of resident pages.
+            uint64_t misses = 0;            ///< Requests of pages that were not resident.
+            uint64_t pagesLoaded = 0;       ///< Number of pages loaded.
+            uint64_t pagesEvicted = 0;      ///< Number of pages evicted to make room for other pages.
+            uint64_t loadFailures = 0;      ///< Number of pages that failed to load.
+            uint64_t loadsDeferred = 0;     ///< Requests not loaded because of the per-update limit or because all physical pages were in use.
+            uint64_t bytesLoaded = 0;       ///< Number of bytes read from the page file.
+            double loadTime = 0.0;          ///< Time spent loading pages in seconds, summed over the loading threads.
+            uint32_t residentPages = 0;     ///< Number of resident pages.
+            uint32_t pendingPages = 0;      ///< Number of pages being loaded.
+
+            double getHitRate() const { return requests > 0 ? (double)hits / requests : 0.0; }
+        };
+
+        /** Page that became resident during the last update.
+        */
+        struct PageUpdate
+        {
+            PageID page;
+            uint32_t slot;      ///< Physical page holding it.
+        };
+
+        /** Create a cache for a page file.
+            \param[in] pPageFile Page file.
+            \param[in] desc Cache description. The physical page count is raised to hold the coarsest mips of all textures if needed.
+            \return New object, or nullptr if the coarsest mips can't be loaded.
+        */
+        static SharedPtr create(const VirtualTexturePageFile::SharedPtr& pPageFile, const Desc& desc);
+
+        ~VirtualTextureCache();
+
+        /** Request pages for the current frame. Invalid pages are ignored.
+            \param[in] pages Pages sampled by the renderer.
+        */
+        void requestPages(const std::vector<PageID>& pages);
+
+        /** Finish the current frame. This makes the pages loaded since the last update resident, then starts loading the pages
+            requested in this frame that are missing, and clears the requests.
+            \param[in] waitForLoads If true, wait for the started loads to complete and make the pages resident before returning.
+        */
+        void update(bool waitForLoads = false);
+
+        /** Wait for all pending page loads to complete. The pages become resident in the next update.
+        */
+        void waitForLoads();
+
+        /** Get the pages that became resident during the last update, or when the cache was created if update() wasn't called yet.
+        */
+        const std::vector<PageUpdate>& getPageUpdates() const { return mPageUpdates; }
+
+        /** Get the physical page holding a page.
+            \return Physical page, or kInvalidSlot if not resident.
+        */
+        uint32_t getSlot(const PageID& page) const;
+
+        bool isResident(const PageID& page) const { return getSlot(page) != kInvalidSlot; }
+
+        /** Get the page table entry of a page, encoding the physical page in the low 24 bits and the mip level it holds in the high 8 bits.
+            If the page is not resident, the entry refers to its nearest resident ancestor.
+            \return Page table entry, or kNonResident if no ancestor is resident.
+        */
+        uint32_t getPageTableEntry(const PageID& page) const;
+
+        /** Get the page table of a mip, with getPageCount(texture, mip) entries in row-major order. See getPageTableEntry().
+        */
+        const uint32_t* getPageTable(uint32_t texture, uint32_t mip) const;
+
+        /** Get the texels of a resident physical page, see VirtualTexturePageFile::readPage().
+        */
+        const uint8_t* getSlotData(uint32_t slot) const { return &mSlotData[size_t(slot) * mSlotBytes]; }
+
+        static uint32_t getEntrySlot(uint32_t entry) { return entry & 0xffffff; }
+        static uint32_t getEntryMip(uint32_t entry) { return entry >> 24; }
+
+        const VirtualTexturePageFile::SharedPtr& getPageFile() const { return mpPageFile; }
+        uint32_t getPhysicalPageCount() const { return (uint32_t)mSlots.size(); }
+
+        /** Get the host memory used by the physical pages in bytes.
+        */
+        size_t getMemoryUsage() const { return mSlotData.size(); }
+
+        Stats getStats() const;
+        void resetStats();
+
+        /** Enable or disable recording of the requested pages. Enabling clears the recorded trace.
+        */
+        void setTraceRecording(bool enabled);
+        const Trace& getRecordedTrace() const { return mRecordedTrace; }
+
+        /** Replay a trace, calling requestPages() and update() for each frame.
+            \param[in] trace Page requests per frame.
+            \param[in] waitForLoads Wait for the loads of each frame, which makes the replay deterministic.
+            \return Statistics of the replay. The statistics are reset before replaying.
+        */
+        Stats replayTrace(const Trace& trace, bool waitForLoads = true);
+
+        /** Save a trace as text, with one line per frame listing the pages as 'texture,mip,x,y'.
+        */
+        static bool saveTrace(const std::string& filename, const Trace& trace);
+
+        /** Load a trace saved with saveTrace().
+        */
+        static bool loadTrace(const std::string& filename, Trace& trace);
+
+    private:
+        VirtualTextureCache(const VirtualTexturePageFile::SharedPtr& pPageFile, const Desc& desc);
+
+        enum class SlotState
+        {
+            Free,
+            Loading,
+            Resident,
+            Pinned,
+        };
+
+        struct Slot
+        {
+            PageID page;
+            SlotState state = SlotState::Free;
+            uint64_t lastRequestFrame = 0;
+            std::list<uint32_t>::iterator lruIt;
+        };
+
+        struct LoadJob
+        {
+            PageID page;
+            uint32_t slot;
+            uint64_t sequence;          ///< Order in which the loads were started.
+            bool success = false;
+            double loadTime = 0.0;
+        };
+
+        bool loadCoarsestMips();
+        void applyCompletedLoads();
+        void startLoads();
+        uint32_t allocateSlot();
+        void setResident(const PageID& page, uint32_t slot);
+        void updatePageTable(const PageID& page);
+        uint32_t resolveEntry(PageID page) const;
+        size_t getTableIndex(const PageID& page) const { return mTableOffsets[page.texture] + mpPageFile->getPageIndex(page); }
+        void runWorker();
+
+        VirtualTexturePageFile::SharedPtr mpPageFile;
+        Desc mDesc;
+
+        // Residency (main thread)
+        std::vector<Slot> mSlots;
+        std::vector<uint32_t> mFreeSlots;
+        std::list<uint32_t> mLru;                   ///< Resident slots that can be evicted, least recently requested first.
+        std::vector<size_t> mTableOffsets;          ///< Offset of each texture in mPageSlots and mPageTable.
+        std::vector<uint32_t> mPageSlots;           ///< Physical page of each page, or kInvalidSlot.
+        std::vector<uint32_t> mPageTable;           ///< Page table entry of each page.
+        std::unordered_set<uint64_t> mLoadingPages; ///< Keys of the pages being loaded.
+        std::vector<PageID> mRequests;              ///< Missing pages requested in the current frame.
+        std::unordered_set<uint64_t> mRequestedKeys;
+        std::vector<PageUpdate> mPageUpdates;
+        uint64_t mFrame = 1;
+        uint64_t mLoadSequence = 0;
+        Stats mStats;
+        bool mRecordTrace = false;
+        Trace mRecordedTrace;
+        std::vector<PageID> mFrameRequests;         ///< Pages requested in the current frame, if recording.
+
+        // Physical page data, written by the loading threads while the slot is in the Loading state.
+        size_t mSlotBytes = 0;
+        std::vector<uint8_t> mSlotData;
+
+        // Loading threads
+        std::vector<std::thread> mThreads;
+        std::mutex mMutex;
+        std::condition_variable mCondition;         ///< Signals new jobs or termination to the loading threads.
+        std::condition_variable mDoneCondition;     ///< Signals completed jobs.
+        std::deque<LoadJob> mJobs;                  ///< Pending jobs, coarse mips first.
+        std::vector<LoadJob> mCompletedJobs;
+        uint32_t mJobsInFlight = 0;
+        bool mTerminate = false;
+    };
+}
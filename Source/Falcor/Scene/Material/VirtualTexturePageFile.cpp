@@ -0,0 +1,464 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "VirtualTexturePageFile.h"
+#include "Utils/Color/ColorHelpers.slang"
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kFileMagic = 0x46505456; // "VTPF"
+        const uint32_t kFileVersion = 1;
+        const uint32_t kHeaderSize = 32;
+
+        struct FileHeader
+        {
+            uint32_t magic = kFileMagic;
+            uint32_t version = kFileVersion;
+            uint32_t pageSize = 0;
+            uint32_t border = 0;
+            uint32_t textureCount = 0;
+            uint32_t reserved = 0;
+            uint64_t directoryOffset = 0;
+        };
+        static_assert(sizeof(FileHeader) == kHeaderSize);
+
+        /** Channel layout of a supported texture format.
+        */
+        struct TexelLayout
+        {
+            uint32_t channelCount;
+            uint32_t channelBits;
+            bool isFloat;
+        };
+
+        bool getTexelLayout(ResourceFormat format, TexelLayout& layout)
+        {
+            if (format == ResourceFormat::Unknown || isCompressedFormat(format)) return false;
+
+            layout.channelCount = getFormatChannelCount(format);
+            layout.channelBits = getNumChannelBits(format, 0);
+            for (uint32_t c = 1; c < layout.channelCount; c++)
+            {
+                if (getNumChannelBits(format, c) != layout.channelBits) return false;
+            }
+            if (layout.channelCount * layout.channelBits != getFormatBytesPerBlock(format) * 8) return false;
+
+            FormatType type = getFormatType(format);
+            layout.isFloat = type == FormatType::Float;
+            if (type == FormatType::Unorm || type == FormatType::UnormSrgb) return layout.channelBits == 8;
+            if (layout.isFloat) return layout.channelBits == 16 || layout.channelBits == 32;
+            return false;
+        }
+
+        float loadChannel(const uint8_t* pTexel, uint32_t channel, const TexelLayout& layout, bool srgb)
+        {
+            switch (layout.channelBits)
+            {
+            case 8:
+            {
+                float v = pTexel[channel] * (1.f / 255.f);
+                return srgb && channel < 3 ? sRGBToLinear(v) : v;
+            }
+            case 16:
+                return f16tof32(reinterpret_cast<const uint16_t*>(pTexel)[channel]);
+            default:
+                return reinterpret_cast<const float*>(pTexel)[channel];
+            }
+        }
+
+        void storeChannel(uint8_t* pTexel, uint32_t channel, const TexelLayout& layout, bool srgb, float v)
+        {
+            switch (layout.channelBits)
+            {
+            case 8:
+                if (srgb && channel < 3) v = linearToSRGB(v);
+                pTexel[channel] = (uint8_t)std::lround(std::clamp(v, 0.f, 1.f) * 255.f);
+                break;
+            case 16:
+                reinterpret_cast<uint16_t*>(pTexel)[channel] = (uint16_t)f32tof16(v);
+                break;
+            default:
+                reinterpret_cast<float*>(pTexel)[channel] = v;
+                break;
+            }
+        }
+
+        /** Downsample an image with a 2x2 box filter. The last row and column of odd-sized images are clamped.
+        */
+        Bitmap::UniqueConstPtr downsample(const Bitmap& src, const TexelLayout& layout, bool srgb)
+        {
+            const uint32_t srcWidth = src.getWidth();
+            const uint32_t srcHeight = src.getHeight();
+            const uint32_t width = std::max(1u, srcWidth / 2);
+            const uint32_t height = std::max(1u, srcHeight / 2);
+            const uint32_t texelSize = getFormatBytesPerBlock(src.getFormat());
+
+            std::vector<uint8_t> data(size_t(width) * height * texelSize);
+            for (uint32_t y = 0; y < height; y++)
+            {
+                const uint8_t* pRows[2] =
+                {
+                    src.getData() + size_t(std::min(2 * y, srcHeight - 1)) * src.getRowPitch(),
+                    src.getData() + size_t(std::min(2 * y + 1, srcHeight - 1)) * src.getRowPitch(),
+                };
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    const size_t offsets[2] = { size_t(std::min(2 * x, srcWidth - 1)) * texelSize, size_t(std::min(2 * x + 1, srcWidth - 1)) * texelSize };
+                    uint8_t* pDst = &data[(size_t(y) * width + x) * texelSize];
+                    for (uint32_t c = 0; c < layout.channelCount; c++)
+                    {
+                        float sum = 0.f;
+                        for (uint32_t i = 0; i < 4; i++) sum += loadChannel(pRows[i >> 1] + offsets[i & 1], c, layout, srgb);
+                        storeChannel(pDst, c, layout, srgb, sum * 0.25f);
+                    }
+                }
+            }
+            return Bitmap::create(width, height, src.getFormat(), data.data());
+        }
+
+        int wrap(int i, int n)
+        {
+            return ((i % n) + n) % n;
+        }
+
+        void initLayout(VirtualTexturePageFile::TextureDesc& desc, uint32_t pageSize, uint32_t border)
+        {
+            const uint32_t paddedSize = pageSize + 2 * border;
+            desc.pageBytes = paddedSize * paddedSize * getFormatBytesPerBlock(desc.format);
+            desc.mipPageOffsets.resize(desc.mipCount);
+            desc.pageCount = 0;
+            for (uint32_t mip = 0; mip < desc.mipCount; mip++)
+            {
+                desc.mipPageOffsets[mip] = desc.pageCount;
+                const uint32_t width = std::max(1u, desc.width >> mip);
+                const uint32_t height = std::max(1u, desc.height >> mip);
+                desc.pageCount += div_round_up(width, pageSize) * div_round_up(height, pageSize);
+            }
+        }
+    }
+
+    // Builder
+
+    VirtualTexturePageFile::Builder::Builder(const std::string& filename, uint32_t pageSize, uint32_t border, bool temporary)
+        : mFilename(filename)
+        , mPageSize(pageSize)
+        , mBorder(border)
+        , mTemporary(temporary)
+    {
+    }
+
+    VirtualTexturePageFile::Builder::~Builder()
+    {
+        if (!mFinalized)
+        {
+            mStream.close();
+            std::remove(mFilename.c_str());
+        }
+    }
+
+    VirtualTexturePageFile::Builder::UniquePtr VirtualTexturePageFile::Builder::create(const std::string& filename, uint32_t pageSize, uint32_t border, bool temporary)
+    {
+        if (pageSize == 0 || !isPowerOf2(pageSize) || border > pageSize)
+        {
+            logError("VirtualTexturePageFile: Page size must be a power of two and larger than the border.");
+            return nullptr;
+        }
+
+        UniquePtr pBuilder = UniquePtr(new Builder(filename, pageSize, border, temporary));
+        pBuilder->mStream.open(filename, std::ios::binary | std::ios::trunc);
+        if (!pBuilder->mStream.is_open())
+        {
+            logError("VirtualTexturePageFile: Can't create page file '" + filename + "'.");
+            return nullptr;
+        }
+
+        // Reserve space for the header, which is written once the directory offset is known.
+        FileHeader header;
+        pBuilder->mStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        return pBuilder;
+    }
+
+    uint32_t VirtualTexturePageFile::Builder::addTexture(const std::vector<Bitmap::UniqueConstPtr>& mips, ResourceFormat format, const std::string& name)
+    {
+        assert(!mFinalized);
+        if (mips.empty() || !mips[0]) return kInvalidTexture;
+
+        const Bitmap& base = *mips[0];
+        TexelLayout layout;
+        if (srgbToLinearFormat(format) != srgbToLinearFormat(base.getFormat()) || !getTexelLayout(format, layout))
+        {
+            logWarning("VirtualTexturePageFile: Texture '" + name + "' has an unsupported format.");
+            return kInvalidTexture;
+        }
+
+        TextureDesc desc;
+        desc.name = name;
+        desc.width = base.getWidth();
+        desc.height = base.getHeight();
+        desc.mipCount = getStoredMipCount(desc.width, desc.height, mPageSize);
+        desc.format = format;
+        desc.dataOffset = (uint64_t)mStream.tellp();
+        initLayout(desc, mPageSize, mBorder);
+
+        if (mips.size() < desc.mipCount)
+        {
+            logWarning("VirtualTexturePageFile: Texture '" + name + "' has an incomplete mip chain.");
+            return kInvalidTexture;
+        }
+        for (uint32_t mip = 0; mip < desc.mipCount; mip++)
+        {
+            if (!mips[mip] || mips[mip]->getFormat() != base.getFormat() ||
+                mips[mip]->getWidth() != std::max(1u, desc.width >> mip) || mips[mip]->getHeight() != std::max(1u, desc.height >> mip))
+            {
+                logWarning("VirtualTexturePageFile: Texture '" + name + "' has a mip " + std::to_string(mip) + " of the wrong size or format.");
+                return kInvalidTexture;
+            }
+        }
+
+        // Copy the texels of each page including the border, wrapping around the edges of the mip.
+        const uint32_t texelSize = getFormatBytesPerBlock(format);
+        const int paddedSize = int(mPageSize + 2 * mBorder);
+        std::vector<uint8_t> page(desc.pageBytes);
+
+        for (uint32_t mip = 0; mip < desc.mipCount; mip++)
+        {
+            const Bitmap& bitmap = *mips[mip];
+            const int width = (int)bitmap.getWidth();
+            const int height = (int)bitmap.getHeight();
+            const uint32_t pagesX = div_round_up((uint32_t)width, mPageSize);
+            const uint32_t pagesY = div_round_up((uint32_t)height, mPageSize);
+
+            for (uint32_t py = 0; py < pagesY; py++)
+            {
+                for (uint32_t px = 0; px < pagesX; px++)
+                {
+                    uint8_t* pDst = page.data();
+                    for (int r = 0; r < paddedSize; r++)
+                    {
+                        const uint8_t* pRow = bitmap.getData() + size_t(wrap(int(py * mPageSize) + r - int(mBorder), height)) * bitmap.getRowPitch();
+                        for (int c = 0; c < paddedSize; c++, pDst += texelSize)
+                        {
+                            std::memcpy(pDst, pRow + size_t(wrap(int(px * mPageSize) + c - int(mBorder), width)) * texelSize, texelSize);
+                        }
+                    }
+                    mStream.write(reinterpret_cast<const char*>(page.data()), page.size());
+                }
+            }
+        }
+
+        if (!mStream.good())
+        {
+            logError("VirtualTexturePageFile: Failed to write page file '" + mFilename + "'.");
+            return kInvalidTexture;
+        }
+
+        mTextures.push_back(std::move(desc));
+        return (uint32_t)mTextures.size() - 1;
+    }
+
+    VirtualTexturePageFile::SharedPtr VirtualTexturePageFile::Builder::finalize()
+    {
+        assert(!mFinalized);
+
+        FileHeader header;
+        header.pageSize = mPageSize;
+        header.border = mBorder;
+        header.textureCount = (uint32_t)mTextures.size();
+        header.directoryOffset = (uint64_t)mStream.tellp();
+
+        for (const auto& desc : mTextures)
+        {
+            const uint32_t nameLength = (uint32_t)desc.name.size();
+            const uint32_t values[] = { nameLength, desc.width, desc.height, desc.mipCount, (uint32_t)desc.format };
+            mStream.write(reinterpret_cast<const char*>(&values[0]), sizeof(uint32_t));
+            mStream.write(desc.name.data(), nameLength);
+            mStream.write(reinterpret_cast<const char*>(&values[1]), sizeof(values) - sizeof(uint32_t));
+            mStream.write(reinterpret_cast<const char*>(&desc.dataOffset), sizeof(desc.dataOffset));
+        }
+
+        mStream.seekp(0);
+        mStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        const bool good = mStream.good();
+        mStream.close();
+
+        if (!good)
+        {
+            logError("VirtualTexturePageFile: Failed to write page file '" + mFilename + "'.");
+            return nullptr;
+        }
+
+        mFinalized = true;
+        auto pPageFile = open(mFilename, mTemporary);
+        if (!pPageFile && mTemporary) std::remove(mFilename.c_str());
+        return pPageFile;
+    }
+
+    // VirtualTexturePageFile
+
+    VirtualTexturePageFile::~VirtualTexturePageFile()
+    {
+        if (mTemporary)
+        {
+            mStream.close();
+            std::remove(mFilename.c_str());
+        }
+    }
+
+    VirtualTexturePageFile::SharedPtr VirtualTexturePageFile::open(const std::string& filename, bool temporary)
+    {
+        SharedPtr pPageFile = SharedPtr(new VirtualTexturePageFile());
+        pPageFile->mFilename = filename;
+        pPageFile->mStream.open(filename, std::ios::binary);
+        if (!pPageFile->mStream.is_open())
+        {
+            logError("VirtualTexturePageFile: Can't open page file '" + filename + "'.");
+            return nullptr;
+        }
+
+        auto& stream = pPageFile->mStream;
+        FileHeader header;
+        stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!stream.good() || header.magic != kFileMagic || header.version != kFileVersion || header.pageSize == 0 || !isPowerOf2(header.pageSize))
+        {
+            logError("VirtualTexturePageFile: '" + filename + "' is not a valid page file.");
+            return nullptr;
+        }
+
+        pPageFile->mPageSize = header.pageSize;
+        pPageFile->mBorder = header.border;
+        pPageFile->mTextures.resize(header.textureCount);
+
+        stream.seekg(header.directoryOffset);
+        for (auto& desc : pPageFile->mTextures)
+        {
+            uint32_t nameLength = 0;
+            stream.read(reinterpret_cast<char*>(&nameLength), sizeof(nameLength));
+            if (!stream.good() || nameLength > 65536) break;
+            desc.name.resize(nameLength);
+            stream.read(desc.name.data(), nameLength);
+
+            uint32_t values[4] = {};
+            stream.read(reinterpret_cast<char*>(values), sizeof(values));
+            stream.read(reinterpret_cast<char*>(&desc.dataOffset), sizeof(desc.dataOffset));
+            desc.width = values[0];
+            desc.height = values[1];
+            desc.mipCount = values[2];
+            desc.format = (ResourceFormat)values[3];
+
+            TexelLayout layout;
+            if (desc.width == 0 || desc.height == 0 || desc.mipCount != getStoredMipCount(desc.width, desc.height, header.pageSize) || !getTexelLayout(desc.format, layout))
+            {
+                stream.setstate(std::ios::failbit);
+                break;
+            }
+            initLayout(desc, header.pageSize, header.border);
+            pPageFile->mMaxPageBytes = std::max(pPageFile->mMaxPageBytes, desc.pageBytes);
+        }
+
+        if (!stream.good())
+        {
+            logError("VirtualTexturePageFile: '" + filename + "' has an invalid texture directory.");
+            return nullptr;
+        }
+
+        pPageFile->mTemporary = temporary;
+        return pPageFile;
+    }
+
+    bool VirtualTexturePageFile::isFormatSupported(ResourceFormat format)
+    {
+        TexelLayout layout;
+        return getTexelLayout(format, layout);
+    }
+
+    std::vector<Bitmap::UniqueConstPtr> VirtualTexturePageFile::generateMips(const Bitmap& bitmap, bool srgb)
+    {
+        std::vector<Bitmap::UniqueConstPtr> mips;
+        TexelLayout layout;
+        if (!getTexelLayout(bitmap.getFormat(), layout)) return mips;
+
+        srgb = srgb && layout.channelBits == 8;
+        mips.push_back(Bitmap::create(bitmap.getWidth(), bitmap.getHeight(), bitmap.getFormat(), bitmap.getData()));
+        while (mips.back()->getWidth() > 1 || mips.back()->getHeight() > 1)
+        {
+            mips.push_back(downsample(*mips.back(), layout, srgb));
+        }
+        return mips;
+    }
+
+    uint32_t VirtualTexturePageFile::getStoredMipCount(uint32_t width, uint32_t height, uint32_t pageSize)
+    {
+        uint32_t mip = 0;
+        while (std::max(1u, width >> mip) > pageSize || std::max(1u, height >> mip) > pageSize) mip++;
+        return mip + 1;
+    }
+
+    uint32_t VirtualTexturePageFile::findTexture(const std::string& name) const
+    {
+        for (size_t i = 0; i < mTextures.size(); i++)
+        {
+            if (mTextures[i].name == name) return (uint32_t)i;
+        }
+        return kInvalidTexture;
+    }
+
+    uint2 VirtualTexturePageFile::getPageCount(uint32_t texture, uint32_t mip) const
+    {
+        const auto& desc = mTextures[texture];
+        return uint2(div_round_up(std::max(1u, desc.width >> mip), mPageSize), div_round_up(std::max(1u, desc.height >> mip), mPageSize));
+    }
+
+    bool VirtualTexturePageFile::isValidPage(const PageID& page) const
+    {
+        if (page.texture >= mTextures.size() || page.mip >= mTextures[page.texture].mipCount) return false;
+        uint2 pageCount = getPageCount(page.texture, page.mip);
+        return page.x < pageCount.x && page.y < pageCount.y;
+    }
+
+    uint32_t VirtualTexturePageFile::getPageIndex(const PageID& page) const
+    {
+        assert(isValidPage(page));
+        return mTextures[page.texture].mipPageOffsets[page.mip] + page.y * getPageCount(page.texture, page.mip).x + page.x;
+    }
+
+    bool VirtualTexturePageFile::readPage(const PageID& page, void* pDst) const
+    {
+        if (!isValidPage(page)) return false;
+
+        const auto& desc = mTextures[page.texture];
+        const uint64_t offset = desc.dataOffset + uint64_t(getPageIndex(page)) * desc.pageBytes;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStream.clear();
+        mStream.seekg(offset);
+        mStream.read(reinterpret_cast<char*>(pDst), desc.pageBytes);
+        return mStream.good();
+    }
+}
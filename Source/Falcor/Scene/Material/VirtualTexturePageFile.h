@@ -0,0 +1,215 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Utils/Image/Bitmap.h"
+#include <fstream>
+#include <mutex>
+
+namespace Falcor
+{
+    /** File of texture pages for out-of-core virtual texturing.
+
+        Each texture is stored as a mip chain cut into square pages of pageSize x pageSize texels. Every page
+        has a border of texels copied from its neighbours (with wrap addressing), so that a page can be filtered
+        on its own once it is resident in a physical page of a texture atlas. The pages of all mips of a texture
+        are stored consecutively, starting with the base mip, and within a mip in row-major order.
+
+        Only the mips down to the first one that fits into a single page are stored. Coarser mips are small
+        enough to stay resident in GPU memory at all times, and are expected to be sampled from a regular texture.
+
+        Page files are written with the Builder, one texture at a time, so that only one mip chain has to be held
+        in memory. Pages can then be read concurrently from multiple threads, see VirtualTextureCache.
+    */
+    class dlldecl VirtualTexturePageFile
+    {
+    public:
+        using SharedPtr = std::shared_ptr<VirtualTexturePageFile>;
+
+        static const uint32_t kDefaultPageSize = 128;
+        static const uint32_t kDefaultBorder = 4;
+        static const uint32_t kInvalidTexture = 0xffffffff;
+
+        /** Address of a page.
+        */
+        struct PageID
+        {
+            uint32_t texture = 0;   ///< Texture index in the page file.
+            uint32_t mip = 0;       ///< Mip level.
+            uint32_t x = 0;         ///< Page column in the mip.
+            uint32_t y = 0;         ///< Page row in the mip.
+
+            bool operator==(const PageID& other) const { return texture == other.texture && mip == other.mip && x == other.x && y == other.y; }
+            bool operator!=(const PageID& other) const { return !(*this == other); }
+
+            /** Get a unique 64-bit key of the page, for use in hash maps. Supports up to 65536 textures, 256 mips and 4096x4096 pages per mip.
+            */
+            uint64_t getKey() const { return (uint64_t(texture) << 40) | (uint64_t(mip) << 32) | (uint64_t(y) << 16) | x; }
+        };
+
+        /** Description of a texture in the page file.
+        */
+        struct TextureDesc
+        {
+            std::string name;               ///< Texture name, e.g. the full path of the image file.
+            uint32_t width = 0;             ///< Width of the base mip in texels.
+            uint32_t height = 0;            ///< Height of the base mip in texels.
+            uint32_t mipCount = 0;          ///< Number of mips in the page file.
+            ResourceFormat format = ResourceFormat::Unknown;
+            uint32_t pageBytes = 0;         ///< Size of a page including its border in bytes.
+            uint32_t pageCount = 0;         ///< Number of pages of all mips.
+            uint64_t dataOffset = 0;        ///< Offset of the first page in the file.
+            std::vector<uint32_t> mipPageOffsets;   ///< Index of the first page of each mip.
+        };
+
+        /** Writes a page file.
+        */
+        class dlldecl Builder
+        {
+        public:
+            using UniquePtr = std::unique_ptr<Builder>;
+
+            /** Create a page file for writing.
+                \param[in] filename Page file to create. An existing file is overwritten.
+                \param[in] pageSize Width and height of the pages in texels, excluding the border. Must be a power of two.
+                \param[in] border Width of the page border in texels.
+                \param[in] temporary If true, the file is deleted when the page file returned by finalize() is destroyed.
+                \return New object, or nullptr if the file can't be created.
+            */
+            static UniquePtr create(const std::string& filename, uint32_t pageSize = kDefaultPageSize, uint32_t border = kDefaultBorder, bool temporary = false);
+
+            /** Deletes the file unless finalize() was called.
+            */
+            ~Builder();
+
+            /** Tile a texture and append its pages to the file.
+                \param[in] mips Mip chain starting with the base mip, as returned by generateMips(). Mips after the first one that fits into a single page are ignored.
+                \param[in] format Format of the texture. This can be the sRGB variant of the bitmap format.
+                \param[in] name Texture name.
+                \return Texture index, or kInvalidTexture if the mip chain or its format is not supported.
+            */
+            uint32_t addTexture(const std::vector<Bitmap::UniqueConstPtr>& mips, ResourceFormat format, const std::string& name);
+
+            /** Get the number of textures added so far.
+            */
+            uint32_t getTextureCount() const { return (uint32_t)mTextures.size(); }
+
+            /** Write the texture directory, close the file and open it for reading.
+                \return The page file, or nullptr on error.
+            */
+            SharedPtr finalize();
+
+        private:
+            Builder(const std::string& filename, uint32_t pageSize, uint32_t border, bool temporary);
+
+            std::string mFilename;
+            std::ofstream mStream;
+            uint32_t mPageSize;
+            uint32_t mBorder;
+            bool mTemporary;
+            bool mFinalized = false;
+            std::vector<TextureDesc> mTextures;
+        };
+
+        /** Open a page file for reading.
+            \param[in] filename Page file.
+            \param[in] temporary If true, the file is deleted when the object is destroyed.
+            \return New object, or nullptr if the file can't be opened or is invalid.
+        */
+        static SharedPtr open(const std::string& filename, bool temporary = false);
+
+        ~VirtualTexturePageFile();
+
+        /** Check if a format is supported. These are the uncompressed formats with 8-bit unorm (linear or sRGB), 16-bit float or 32-bit float channels.
+        */
+        static bool isFormatSupported(ResourceFormat format);
+
+        /** Generate a mip chain with a 2x2 box filter, down to a 1x1 mip.
+            Mips of non power-of-two images are rounded down in size, like the mips of textures.
+            \param[in] bitmap Base mip.
+            \param[in] srgb If true, the color channels of 8-bit formats are averaged in linear space and stored as sRGB.
+            \return Mip chain starting with a copy of the base mip, or an empty list if the format is not supported.
+        */
+        static std::vector<Bitmap::UniqueConstPtr> generateMips(const Bitmap& bitmap, bool srgb);
+
+        /** Get the number of mips stored in a page file for a texture of the given size, i.e. the number of mips down to the first one that fits into a single page.
+        */
+        static uint32_t getStoredMipCount(uint32_t width, uint32_t height, uint32_t pageSize);
+
+        const std::string& getFilename() const { return mFilename; }
+        uint32_t getPageSize() const { return mPageSize; }
+        uint32_t getBorder() const { return mBorder; }
+
+        /** Get the width and height of a page including its border in texels.
+        */
+        uint32_t getPaddedPageSize() const { return mPageSize + 2 * mBorder; }
+
+        /** Get the size of the largest page of all textures in bytes.
+        */
+        uint32_t getMaxPageBytes() const { return mMaxPageBytes; }
+
+        uint32_t getTextureCount() const { return (uint32_t)mTextures.size(); }
+        const TextureDesc& getTexture(uint32_t texture) const { return mTextures[texture]; }
+
+        /** Find a texture by name.
+            \return Texture index, or kInvalidTexture if not found.
+        */
+        uint32_t findTexture(const std::string& name) const;
+
+        /** Get the number of pages of a mip in x and y.
+        */
+        uint2 getPageCount(uint32_t texture, uint32_t mip) const;
+
+        /** Check if a page exists in the file.
+        */
+        bool isValidPage(const PageID& page) const;
+
+        /** Get the index of a page among the pages of its texture.
+        */
+        uint32_t getPageIndex(const PageID& page) const;
+
+        /** Read a page. This is thread-safe.
+            \param[in] page Page to read.
+            \param[out] pDst Destination of getTexture(page.texture).pageBytes bytes. The texels are stored in row-major order, including the border.
+            \return True if successful.
+        */
+        bool readPage(const PageID& page, void* pDst) const;
+
+    private:
+        VirtualTexturePageFile() = default;
+
+        std::string mFilename;
+        bool mTemporary = false;
+        uint32_t mPageSize = 0;
+        uint32_t mBorder = 0;
+        uint32_t mMaxPageBytes = 0;
+        std::vector<TextureDesc> mTextures;
+
+        mutable std::ifstream mStream;
+        mutable std::mutex mMutex;
+    };
+}
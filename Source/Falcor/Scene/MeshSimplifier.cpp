@@ -0,0 +1,261 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "MeshSimplifier.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Area-weighted sum of squared distances to a set of planes.
+        */
+        struct Quadric
+        {
+            double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+            double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+            double c = 0.0;
+            double weight = 0.0;
+
+            void addPlane(const float3& n, float d, float w)
+            {
+                a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+                a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+                b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+                c += w * d * d;
+                weight += w;
+            }
+
+            Quadric& operator+=(const Quadric& q)
+            {
+                a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+                b0 += q.b0; b1 += q.b1; b2 += q.b2;
+                c += q.c;
+                weight += q.weight;
+                return *this;
+            }
+
+            /** Evaluate the mean squared distance to the planes.
+            */
+            double eval(const float3& p) const
+            {
+                if (weight == 0.0) return 0.0;
+                const double x = p.x, y = p.y, z = p.z;
+                double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+                return std::max(e, 0.0) / weight;
+            }
+        };
+
+        struct Collapse
+        {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+
+        struct PositionHash
+        {
+            size_t operator()(const float3& p) const
+            {
+                uint32_t u[3];
+                std::memcpy(u, &p, sizeof(u));
+                return ((size_t)u[0] * 73856093) ^ ((size_t)u[1] * 19349663) ^ ((size_t)u[2] * 83492791);
+            }
+        };
+
+        bool isDegenerate(uint32_t a, uint32_t b, uint32_t c) { return a == b || b == c || a == c; }
+
+        /** Vertex to triangle adjacency in compressed row format.
+        */
+        struct Adjacency
+        {
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> triangles;
+
+            void build(const std::vector<uint32_t>& indices, size_t vertexCount)
+            {
+                offsets.assign(vertexCount + 1, 0);
+                for (uint32_t v : indices) offsets[v + 1]++;
+                std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+                triangles.resize(indices.size());
+                std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+                for (size_t i = 0; i < indices.size(); i++) triangles[cursor[indices[i]]++] = (uint32_t)(i / 3);
+            }
+
+            /** Count the triangles containing the directed edge (a, b).
+            */
+            uint32_t countEdge(const std::vector<uint32_t>& indices, uint32_t a, uint32_t b) const
+            {
+                uint32_t count = 0;
+                for (uint32_t i = offsets[a]; i < offsets[a + 1]; i++)
+                {
+                    const uint32_t* t = &indices[3 * triangles[i]];
+                    count += (t[0] == a && t[1] == b) || (t[1] == a && t[2] == b) || (t[2] == a && t[0] == b);
+                }
+                return count;
+            }
+        };
+
+        /** Find the vertices that must not move: vertices sharing a position with other vertices, and vertices on open or non-manifold edges.
+        */
+        std::vector<uint8_t> findLockedVertices(const float3* positions, size_t vertexCount, const std::vector<uint32_t>& indices, const Adjacency& adjacency)
+        {
+            std::vector<uint8_t> locked(vertexCount, 0);
+
+            std::unordered_map<float3, uint32_t, PositionHash> firstVertex;
+            firstVertex.reserve(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                auto it = firstVertex.emplace(positions[v], v);
+                if (!it.second) locked[v] = locked[it.first->second] = 1;
+            }
+
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                uint32_t a = indices[i], b = indices[i % 3 == 2 ? i - 2 : i + 1];
+                if (adjacency.countEdge(indices, a, b) != 1 || adjacency.countEdge(indices, b, a) != 1) locked[a] = locked[b] = 1;
+            }
+
+            return locked;
+        }
+    }
+
+    MeshSimplifier::Result MeshSimplifier::simplify(const float3* positions, size_t vertexCount, const std::vector<uint32_t>& indices, size_t targetIndexCount, float targetError)
+    {
+        assert(indices.size() % 3 == 0);
+
+        Result result;
+        result.indices.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            if (isDegenerate(indices[i], indices[i + 1], indices[i + 2])) continue;
+            result.indices.insert(result.indices.end(), indices.begin() + i, indices.begin() + i + 3);
+        }
+
+        Adjacency adjacency;
+        adjacency.build(result.indices, vertexCount);
+        const std::vector<uint8_t> locked = findLockedVertices(positions, vertexCount, result.indices, adjacency);
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t i = 0; i < result.indices.size(); i += 3)
+        {
+            const float3& p0 = positions[result.indices[i]];
+            float3 n = glm::cross(positions[result.indices[i + 1]] - p0, positions[result.indices[i + 2]] - p0);
+            float area = glm::length(n);
+            if (area == 0.f) continue;
+            n /= area;
+            for (uint32_t k = 0; k < 3; k++) quadrics[result.indices[i + k]].addPlane(n, -glm::dot(n, p0), area);
+        }
+
+        auto flips = [&](uint32_t i0, uint32_t i1, uint32_t i2, uint32_t from, uint32_t to)
+        {
+            const float3 n0 = glm::cross(positions[i1] - positions[i0], positions[i2] - positions[i0]);
+            const float3& p0 = positions[i0 == from ? to : i0];
+            const float3& p1 = positions[i1 == from ? to : i1];
+            const float3& p2 = positions[i2 == from ? to : i2];
+            return glm::dot(n0, glm::cross(p1 - p0, p2 - p0)) <= 0.f;
+        };
+
+        const double maxCost = (double)targetError * targetError;
+        double performedCost = 0.0;
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<uint8_t> touched(vertexCount);
+        std::vector<Collapse> collapses;
+
+        for (bool firstPass = true; result.indices.size() > targetIndexCount; firstPass = false)
+        {
+            if (!firstPass) adjacency.build(result.indices, vertexCount);
+
+            // Rank the edge collapses. Interior edges are seen from both of their triangles, so only the one with a < b is
+            // used, in the cheaper direction. Open edges have locked end points and are skipped.
+            collapses.clear();
+            for (size_t i = 0; i < result.indices.size(); i++)
+            {
+                uint32_t a = result.indices[i], b = result.indices[i % 3 == 2 ? i - 2 : i + 1];
+                if (a > b || (locked[a] && locked[b])) continue;
+                double costAB = locked[a] ? std::numeric_limits<double>::infinity() : quadrics[a].eval(positions[b]);
+                double costBA = locked[b] ? std::numeric_limits<double>::infinity() : quadrics[b].eval(positions[a]);
+                collapses.push_back(costAB <= costBA ? Collapse{ a, b, costAB } : Collapse{ b, a, costBA });
+            }
+
+            // Each collapse of an interior edge removes two triangles. Only the cheapest candidates need to be sorted,
+            // as the collapses in a pass are limited by the budget and by the vertices they touch.
+            const size_t collapseBudget = std::max<size_t>(1, (result.indices.size() - targetIndexCount + 5) / 6);
+            auto byCost = [](const Collapse& lhs, const Collapse& rhs) { return lhs.cost < rhs.cost; };
+            auto sortedEnd = collapses.begin() + std::min(collapses.size(), 4 * collapseBudget);
+            std::nth_element(collapses.begin(), sortedEnd, collapses.end(), byCost);
+            std::sort(collapses.begin(), sortedEnd, byCost);
+            collapses.erase(sortedEnd, collapses.end());
+
+            // Perform the cheapest collapses. The vertices around a collapsed vertex are excluded from further collapses
+            // in this pass, so each flip test sees the final triangles.
+            std::iota(remap.begin(), remap.end(), 0);
+            std::fill(touched.begin(), touched.end(), 0);
+            size_t collapseCount = 0;
+            for (const auto& collapse : collapses)
+            {
+                if (collapseCount >= collapseBudget || collapse.cost > maxCost) break;
+                if (touched[collapse.from] || touched[collapse.to]) continue;
+
+                bool isValid = true;
+                for (uint32_t i = adjacency.offsets[collapse.from]; i < adjacency.offsets[collapse.from + 1] && isValid; i++)
+                {
+                    const uint32_t* t = &result.indices[3 * adjacency.triangles[i]];
+                    if (t[0] == collapse.to || t[1] == collapse.to || t[2] == collapse.to) continue;
+                    isValid = !flips(t[0], t[1], t[2], collapse.from, collapse.to);
+                }
+                if (!isValid) continue;
+
+                remap[collapse.from] = collapse.to;
+                quadrics[collapse.to] += quadrics[collapse.from];
+                for (uint32_t i = adjacency.offsets[collapse.from]; i < adjacency.offsets[collapse.from + 1]; i++)
+                {
+                    const uint32_t* t = &result.indices[3 * adjacency.triangles[i]];
+                    touched[t[0]] = touched[t[1]] = touched[t[2]] = 1;
+                }
+                performedCost = std::max(performedCost, collapse.cost);
+                collapseCount++;
+            }
+            if (collapseCount == 0) break;
+
+            // Apply the collapses and remove the triangles that became degenerate.
+            size_t indexCount = 0;
+            for (size_t i = 0; i < result.indices.size(); i += 3)
+            {
+                uint32_t a = remap[result.indices[i]], b = remap[result.indices[i + 1]], c = remap[result.indices[i + 2]];
+                if (isDegenerate(a, b, c)) continue;
+                result.indices[indexCount++] = a;
+                result.indices[indexCount++] = b;
+                result.indices[indexCount++] = c;
+            }
+            result.indices.resize(indexCount);
+        }
+
+        result.error = (float)std::sqrt(performedCost);
+        return result;
+    }
+}
@@ -0,0 +1,60 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+
+namespace Falcor
+{
+    /** Triangle mesh simplification with quadric error metrics.
+
+        Edges are collapsed onto one of their existing end points, so the simplified mesh references a subset of the
+        original vertices and only needs a new index buffer. Collapses are done in passes ordered by error, and
+        collapses that would flip a triangle are rejected.
+
+        Vertices that share a position with another vertex (attribute seams, e.g. UV seams or hard normals) and
+        vertices on open edges (mesh borders) are locked, so seams and borders are preserved exactly.
+    */
+    class dlldecl MeshSimplifier
+    {
+    public:
+        struct Result
+        {
+            std::vector<uint32_t> indices;  ///< Simplified triangle list.
+            float error = 0.f;              ///< Largest quadric error of the performed collapses as a distance in object space.
+        };
+
+        /** Simplify an indexed triangle list.
+            \param[in] positions Vertex positions.
+            \param[in] vertexCount Number of vertices.
+            \param[in] indices Triangle list with indices into 'positions'.
+            \param[in] targetIndexCount Stop when the index count is at or below this count.
+            \param[in] targetError Stop before doing collapses with a larger error (distance in object space).
+            \return Simplified triangle list and its error. The list is unchanged if no collapse is possible.
+        */
+        static Result simplify(const float3* positions, size_t vertexCount, const std::vector<uint32_t>& indices, size_t targetIndexCount, float targetError);
+    };
+}
@@ -36,16 +36,13 @@ namespace Falcor
 {
     static_assert(sizeof(MeshDesc) % 16 == 0, "MeshDesc size should be a multiple of 16");
     static_assert(sizeof(PackedStaticVertexData) % 16 == 0, "PackedStaticVertexData size should be a multiple of 16");
+    static_assert(sizeof(CompressedStaticVertexData) == 20, "CompressedStaticVertexData size should be 20B");
     static_assert(sizeof(PackedMeshInstanceData) % 16 == 0, "PackedMeshInstanceData size should be a multiple of 16");
     static_assert(sizeof(ProceduralPrimitiveData) % 16 == 0, "ProceduralPrimitiveData size should be a multiple of 16");
     static_assert(PackedMeshInstanceData::kMatrixBits + PackedMeshInstanceData::kMeshBits + PackedMeshInstanceData::kFlagsBits + PackedMeshInstanceData::kMaterialBits <= 64);
 
     namespace
     {
-        // Large scenes are split into multiple BLAS groups in order to reduce build memory usage.
-        // The target is max 0.5GB intermediate memory per BLAS group. Note that this is not a strict limit.
-        const size_t kMaxBLASBuildMemory = 1ull << 29;
-
         const std::string kParameterBlockName = "gScene";
         const std::string kMeshBufferName = "meshes";
         const std::string kMeshInstanceBufferName = "meshInstances";
@@ -83,6 +80,13 @@ namespace Falcor
         const std::string kAddViewpoint = "addViewpoint";
         const std::string kRemoveViewpoint = "kRemoveViewpoint";
         const std::string kSelectViewpoint = "selectViewpoint";
+        const std::string kBenchmarkCpuBVH = "benchmarkCpuBVH";
+        const std::string kBenchmarkMeshletCulling = "benchmarkMeshletCulling";
+        const std::string kSelectMeshLODs = "selectMeshLODs";
+        const std::string kUploadStats = "uploadStats";
+
+        // Dirty ranges separated by at most this many clean elements are uploaded with a single write.
+        const uint32_t kUploadMaxGap = 4;
 
         // Checks if the transform flips the coordinate system handedness (its determinant is negative).
         bool doesTransformFlip(const glm::mat4& m)
@@ -120,6 +124,7 @@ namespace Falcor
         defines.add("SCENE_HAS_INDEXED_VERTICES", hasIndexBuffer() ? "1" : "0");
         defines.add("SCENE_HAS_16BIT_INDICES", mHas16BitIndices ? "1" : "0");
         defines.add("SCENE_HAS_32BIT_INDICES", mHas32BitIndices ? "1" : "0");
+        defines.add("SCENE_HAS_COMPRESSED_VERTICES", mHasCompressedVertices ? "1" : "0");
         defines.add(mHitInfo.getDefines());
         return defines;
     }
@@ -226,11 +231,13 @@ namespace Falcor
 
         mpMaterialsBuffer = Buffer::createStructured(mpSceneBlock[kMaterialsBufferName], (uint32_t)mMaterials.size(), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, nullptr, false);
         mpMaterialsBuffer->setName("Scene::mpMaterialsBuffer");
+        mMaterialData.resize(mMaterials.size());
 
         if (!mLights.empty())
         {
             mpLightsBuffer = Buffer::createStructured(mpSceneBlock[kLightsBufferName], (uint32_t)mLights.size(), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, nullptr, false);
             mpLightsBuffer->setName("Scene::mpLightsBuffer");
+            mLightData.resize(mLights.size());
         }
 
         if (!mVolumes.empty())
@@ -268,15 +275,15 @@ namespace Falcor
         }
     }
 
-    // TODO: On initial upload of materials, we could improve this by not having separate calls to setElement()
-    // but instead prepare a buffer containing all data.
     void Scene::uploadMaterial(uint32_t materialID)
     {
         assert(materialID < mMaterials.size());
 
         const auto& material = mMaterials[materialID];
 
-        mpMaterialsBuffer->setElement(materialID, material->getData());
+        // The material data is uploaded in coalesced ranges by updateMaterials().
+        mMaterialData[materialID] = material->getData();
+        mDirtyMaterials.mark(materialID);
 
         const auto& resources = material->getResources();
 
@@ -331,11 +338,11 @@ namespace Falcor
 
     void Scene::updateMeshInstances(bool forceUpdate)
     {
-        bool dataChanged = false;
         const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
 
-        for (auto& inst : mMeshInstanceData)
+        for (uint32_t instanceID = 0; instanceID < (uint32_t)mMeshInstanceData.size(); instanceID++)
         {
+            auto& inst = mMeshInstanceData[instanceID];
             uint32_t prevFlags = inst.flags;
 
             const glm::mat4& transform = globalMatrices[inst.globalMatrixID];
@@ -352,10 +359,12 @@ namespace Falcor
             if (isWorldFrontFaceCW) inst.flags |= (uint32_t)MeshInstanceFlags::IsWorldFrontFaceCW;
             else inst.flags &= ~(uint32_t)MeshInstanceFlags::IsWorldFrontFaceCW;
 
-            dataChanged |= (inst.flags != prevFlags);
+            if (inst.flags != prevFlags) mDirtyMeshInstances.mark(instanceID);
         }
 
-        if (forceUpdate || dataChanged)
+        if (forceUpdate) mDirtyMeshInstances.mark(0, (uint32_t)mMeshInstanceData.size());
+
+        if (!mDirtyMeshInstances.empty())
         {
             // Make sure the scene data fits in the packed format.
             size_t maxMatrices = 1 << PackedMeshInstanceData::kMatrixBits;
@@ -376,18 +385,17 @@ namespace Falcor
                 throw std::exception(("Number of materials (" + std::to_string(mMaterials.size()) + ") exceeds the maximum (" + std::to_string(maxMaterials) + ").").c_str());
             }
 
-            // Prepare packed mesh instance data.
+            // Prepare packed mesh instance data for the changed instances.
             assert(mMeshInstanceData.size() > 0);
             mPackedMeshInstanceData.resize(mMeshInstanceData.size());
 
-            for (size_t i = 0; i < mMeshInstanceData.size(); i++)
+            for (const auto& range : mDirtyMeshInstances.coalesce())
             {
-                mPackedMeshInstanceData[i].pack(mMeshInstanceData[i]);
+                for (uint32_t i = range.begin; i < range.end; i++) mPackedMeshInstanceData[i].pack(mMeshInstanceData[i]);
             }
 
-            size_t byteSize = sizeof(PackedMeshInstanceData) * mPackedMeshInstanceData.size();
-            assert(mpMeshInstancesBuffer && mpMeshInstancesBuffer->getSize() == byteSize);
-            mpMeshInstancesBuffer->setBlob(mPackedMeshInstanceData.data(), 0, byteSize);
+            assert(mpMeshInstancesBuffer && mpMeshInstancesBuffer->getSize() == sizeof(PackedMeshInstanceData) * mPackedMeshInstanceData.size());
+            mUploadStats.meshInstanceBytes += mDirtyMeshInstances.upload(mpMeshInstancesBuffer.get(), mPackedMeshInstanceData.data(), sizeof(PackedMeshInstanceData), kUploadMaxGap);
         }
     }
 
@@ -499,6 +507,29 @@ namespace Falcor
             s.instancedTriangleCount += mesh.getTriangleCount();
         }
 
+        s.meshGroupCount = mMeshGroups.size();
+        s.meshGroupMaxTriangleCount = 0;
+        for (const auto& meshGroup : mMeshGroups)
+        {
+            uint64_t triangleCount = 0;
+            for (auto meshID : meshGroup.meshList) triangleCount += getMesh(meshID).getTriangleCount();
+            s.meshGroupMaxTriangleCount = std::max(s.meshGroupMaxTriangleCount, triangleCount);
+        }
+
+        s.lodCount = 0;
+        s.lodTriangleCount = 0;
+        s.lodIndexMemoryInBytes = 0;
+
+        for (uint32_t meshID = 0; meshID < getMeshCount(); meshID++)
+        {
+            for (const auto& lod : mMeshLODs[meshID])
+            {
+                s.lodCount++;
+                s.lodTriangleCount += lod.indexCount / 3;
+                s.lodIndexMemoryInBytes += getMesh(meshID).use16BitIndices() ? div_round_up(lod.indexCount, 2u) * sizeof(uint32_t) : lod.indexCount * sizeof(uint32_t);
+            }
+        }
+
         s.uniqueCurvePointCount = 0;
         s.uniqueCurveSegmentCount = 0;
         s.instancedCurvePointCount = 0;
@@ -530,6 +561,7 @@ namespace Falcor
 
         s.indexMemoryInBytes += pIB ? pIB->getSize() : 0;
         s.vertexMemoryInBytes += pVB ? pVB->getSize() : 0;
+        s.uncompressedVertexMemoryInBytes = mHasCompressedVertices ? sizeof(PackedStaticVertexData) * s.uniqueVertexCount : s.vertexMemoryInBytes;
 
         s.curveIndexMemoryInBytes = 0;
         s.curveVertexMemoryInBytes = 0;
@@ -605,6 +637,7 @@ namespace Falcor
         }
         if (mpBlasScratch) s.blasScratchMemoryInBytes += mpBlasScratch->getSize();
         if (mpBlasStaticWorldMatrices) s.blasScratchMemoryInBytes += mpBlasStaticWorldMatrices->getSize();
+        if (mpBlasCompressedMeshTransforms) s.blasScratchMemoryInBytes += mpBlasCompressedMeshTransforms->getSize();
     }
 
     void Scene::updateRaytracingTLASStats()
@@ -753,13 +786,15 @@ namespace Falcor
 
             if (changes != Light::Changes::None || is_set(combinedChanges, Light::Changes::Active) || forceUpdate)
             {
-                // TODO: This is slow since the buffer is not CPU writable. Copy into CPU buffer and upload once instead.
-                mpLightsBuffer->setElement(lightCount, light->getData());
+                mLightData[lightCount] = light->getData();
+                mDirtyLights.mark(lightCount);
             }
 
             lightCount++;
         }
 
+        if (mpLightsBuffer) mUploadStats.lightBytes += mDirtyLights.upload(mpLightsBuffer.get(), mLightData.data(), sizeof(LightData), kUploadMaxGap);
+
         if (combinedChanges != Light::Changes::None || forceUpdate)
         {
             mpSceneBlock["lightCount"] = lightCount;
@@ -856,23 +891,26 @@ namespace Falcor
     {
         UpdateFlags flags = UpdateFlags::None;
 
-        // Early out if no materials have changed
-        if (!forceUpdate && Material::getGlobalUpdates() == Material::UpdateFlags::None) return flags;
-
-        for (uint32_t materialId = 0; materialId < (uint32_t)mMaterials.size(); ++materialId)
+        if (forceUpdate || Material::getGlobalUpdates() != Material::UpdateFlags::None)
         {
-            auto& material = mMaterials[materialId];
-            auto materialUpdates = material->getUpdates();
-            if (forceUpdate || materialUpdates != Material::UpdateFlags::None)
+            for (uint32_t materialId = 0; materialId < (uint32_t)mMaterials.size(); ++materialId)
             {
-                material->clearUpdates();
-                uploadMaterial(materialId);
-                flags |= UpdateFlags::MaterialsChanged;
+                auto& material = mMaterials[materialId];
+                auto materialUpdates = material->getUpdates();
+                if (forceUpdate || materialUpdates != Material::UpdateFlags::None)
+                {
+                    material->clearUpdates();
+                    uploadMaterial(materialId);
+                    flags |= UpdateFlags::MaterialsChanged;
+                }
             }
+
+            updateMaterialStats();
+            Material::clearGlobalUpdates();
         }
 
-        updateMaterialStats();
-        Material::clearGlobalUpdates();
+        // Upload the material data changed here or through the UI since the last update.
+        mUploadStats.materialBytes += mDirtyMaterials.upload(mpMaterialsBuffer.get(), mMaterialData.data(), sizeof(MaterialData), kUploadMaxGap);
 
         return flags;
     }
@@ -880,7 +918,10 @@ namespace Falcor
     Scene::UpdateFlags Scene::update(RenderContext* pContext, double currentTime)
     {
         mUpdates = UpdateFlags::None;
-        if (mpAnimationController->animate(pContext, currentTime))
+        mUploadStats = UploadStats();
+        bool animated = mpAnimationController->animate(pContext, currentTime);
+        mUploadStats.matrixBytes = mpAnimationController->getUploadedBytes();
+        if (animated)
         {
             mUpdates |= UpdateFlags::SceneGraphChanged;
             for (const auto& inst : mMeshInstanceData)
@@ -902,6 +943,7 @@ namespace Falcor
         {
             mTlasCache.clear();
             updateMeshInstances(false);
+            if (mpCpuBVH) mpCpuBVH->updateTransforms(mpAnimationController->getGlobalMatrices());
         }
 
         // If a transform in the scene changed, update BLASes with skinned meshes
@@ -1088,7 +1130,16 @@ namespace Falcor
                 << "  Instanced triangle count: " << s.instancedTriangleCount << std::endl
                 << "  Instanced vertex count: " << s.instancedVertexCount << std::endl
                 << "  Index  buffer memory: " << formatByteSize(s.indexMemoryInBytes) << std::endl
-                << "  Vertex buffer memory: " << formatByteSize(s.vertexMemoryInBytes) << std::endl
+                << "  Vertex buffer memory: " << formatByteSize(s.vertexMemoryInBytes);
+            if (mHasCompressedVertices) oss << " (compressed from " << formatByteSize(s.uncompressedVertexMemoryInBytes) << ")";
+            oss << std::endl;
+            if (s.lodCount > 0)
+            {
+                oss << "  LOD count: " << s.lodCount << std::endl
+                    << "  LOD triangle count: " << s.lodTriangleCount << std::endl
+                    << "  LOD index memory: " << formatByteSize(s.lodIndexMemoryInBytes) << std::endl;
+            }
+            oss
                 << "  Geometry data memory: " << formatByteSize(s.geometryMemoryInBytes) << std::endl
                 << "  Animation data memory: " << formatByteSize(s.animationMemoryInBytes) << std::endl
                 << "  Curve count: " << getCurveCount() << std::endl
@@ -1111,6 +1162,9 @@ namespace Falcor
                 << "  TLAS count: " << s.tlasCount << std::endl
                 << "  TLAS memory (final): " << formatByteSize(s.tlasMemoryInBytes) << std::endl
                 << "  TLAS memory (scratch): " << formatByteSize(s.tlasScratchMemoryInBytes) << std::endl
+                << "  Mesh group count: " << s.meshGroupCount << std::endl
+                << "  Mesh group max triangle count: " << s.meshGroupMaxTriangleCount << std::endl
+                << "  Mesh group traversal cost (estimated): " << s.meshGroupTraversalCost << std::endl
                 << std::endl;
 
             // Material stats.
@@ -1185,6 +1239,15 @@ namespace Falcor
                 << "  Grid memory: " << formatByteSize(s.gridMemoryInBytes) << std::endl
                 << std::endl;
 
+            // Upload stats of the last update.
+            oss << "Upload stats (last frame):" << std::endl
+                << "  Mesh instance data: " << formatByteSize(mUploadStats.meshInstanceBytes) << std::endl
+                << "  Matrices: " << formatByteSize(mUploadStats.matrixBytes) << std::endl
+                << "  Materials: " << formatByteSize(mUploadStats.materialBytes) << std::endl
+                << "  Lights: " << formatByteSize(mUploadStats.lightBytes) << std::endl
+                << "  Total: " << formatByteSize(mUploadStats.getTotalBytes()) << std::endl
+                << std::endl;
+
             if (statsGroup.button("Print to log")) logInfo("\n" + oss.str());
 
             statsGroup.text(oss.str());
@@ -1430,6 +1493,7 @@ namespace Falcor
     {
         assert(mBlasData.empty());
         assert(!mpBlasStaticWorldMatrices);
+        assert(!mpBlasCompressedMeshTransforms);
 
         const VertexBufferLayout::SharedConstPtr& pVbLayout = mpVao->getVertexLayout()->getBufferLayout(kStaticDataBufferIndex);
         const Buffer::SharedPtr& pVb = mpVao->getVertexBuffer(kStaticDataBufferIndex);
@@ -1459,6 +1523,40 @@ namespace Falcor
             return mpBlasStaticWorldMatrices;
         };
 
+        auto getCompressedMeshTransformsBuffer = [&]()
+        {
+            // With compressed vertices, the BLAS build reads the quantized positions as 16-bit unorm values.
+            // Each mesh gets a transform that maps them back to object space, combined with the object-to-world
+            // transform for static meshes that are pre-transformed in the BLAS.
+            if (!mpBlasCompressedMeshTransforms)
+            {
+                std::vector<glm::mat4> transposedMatrices(mMeshDesc.size());
+                for (const auto& meshGroup : mMeshGroups)
+                {
+                    for (const uint32_t meshID : meshGroup.meshList)
+                    {
+                        const MeshDesc& mesh = mMeshDesc[meshID];
+                        glm::mat4 transform = glm::scale(glm::translate(glm::identity<glm::mat4>(), mesh.positionOrigin), mesh.positionScale);
+                        if (meshGroup.isStatic)
+                        {
+                            assert(mMeshIdToInstanceIds[meshID].size() == 1);
+                            uint32_t instanceID = mMeshIdToInstanceIds[meshID][0];
+                            transform = globalMatrices[mMeshInstanceData[instanceID].globalMatrixID] * transform;
+                        }
+                        transposedMatrices[meshID] = glm::transpose(transform);
+                    }
+                }
+
+                uint32_t float4Count = (uint32_t)transposedMatrices.size() * 4;
+                mpBlasCompressedMeshTransforms = Buffer::createStructured(sizeof(float4), float4Count, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, transposedMatrices.data(), false);
+                mpBlasCompressedMeshTransforms->setName("Scene::mpBlasCompressedMeshTransforms");
+
+                // Transition the resource to non-pixel shader state as expected by DXR.
+                pContext->resourceBarrier(mpBlasCompressedMeshTransforms.get(), Resource::State::NonPixelShader);
+            }
+            return mpBlasCompressedMeshTransforms;
+        };
+
         assert(mMeshGroups.size() > 0);
         uint32_t totalBlasCount = (uint32_t)mMeshGroups.size() + (mpRtAABBBuffer ? 1 : 0); // If there are custom primitives, they are all placed in one more BLAS
         mBlasData.resize(totalBlasCount);
@@ -1483,7 +1581,12 @@ namespace Falcor
                 desc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
                 desc.Triangles.Transform3x4 = 0; // The default is no transform
 
-                if (isStatic)
+                if (mHasCompressedVertices)
+                {
+                    // Compressed meshes always need a transform to dequantize the positions.
+                    desc.Triangles.Transform3x4 = getCompressedMeshTransformsBuffer()->getGpuAddress() + meshID * 64ull;
+                }
+                else if (isStatic)
                 {
                     // Static meshes will be pre-transformed when building the BLAS.
                     // Lookup the matrix ID here. If it is an identity matrix, no action is needed.
@@ -1508,7 +1611,7 @@ namespace Falcor
                 desc.Triangles.VertexBuffer.StartAddress = pVb->getGpuAddress() + (mesh.vbOffset * pVbLayout->getStride());
                 desc.Triangles.VertexBuffer.StrideInBytes = pVbLayout->getStride();
                 desc.Triangles.VertexCount = mesh.vertexCount;
-                desc.Triangles.VertexFormat = getDxgiFormat(pVbLayout->getElementFormat(0));
+                desc.Triangles.VertexFormat = getDxgiFormat(mHasCompressedVertices ? ResourceFormat::RGBA16Unorm : pVbLayout->getElementFormat(0));
 
                 // Set index data
                 if (pIb)
@@ -2378,6 +2481,124 @@ namespace Falcor
         return c;
     }
 
+    pybind11::dict Scene::benchmarkCpuBVH(uint32_t width, uint32_t height) const
+    {
+        pybind11::dict d;
+        if (!mpCpuBVH)
+        {
+            logWarning("Scene::benchmarkCpuBVH() - The scene was not built with the BuildCpuBVH flag.");
+            return d;
+        }
+
+        // Generate primary rays in pixel order, following the pinhole camera convention of the GPU ray generation.
+        const CameraData& data = getCamera()->getData();
+        std::vector<SceneBVH::Ray> rays((size_t)width * height);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                float2 p = (float2(x, y) + 0.5f) / float2(width, height);
+                float2 ndc = float2(2, -2) * p + float2(-1, 1);
+                SceneBVH::Ray& ray = rays[(size_t)y * width + x];
+                ray.origin = data.posW;
+                ray.dir = glm::normalize(ndc.x * data.cameraU + ndc.y * data.cameraV + data.cameraW);
+            }
+        }
+
+        SceneBVH::BenchmarkResult result = mpCpuBVH->benchmark(rays);
+        std::string msg = "CPU BVH benchmark (" + std::to_string(width) + "x" + std::to_string(height) + " primary rays):\n";
+        msg += "  closest hit: " + std::to_string(result.closestHitSingle) + " Mrays/s (single), " + std::to_string(result.closestHitStream) + " Mrays/s (stream)\n";
+        msg += "  any hit:     " + std::to_string(result.anyHitSingle) + " Mrays/s (single), " + std::to_string(result.anyHitStream) + " Mrays/s (stream)";
+        logInfo(msg);
+
+        d["closestHitSingle"] = result.closestHitSingle;
+        d["closestHitStream"] = result.closestHitStream;
+        d["anyHitSingle"] = result.anyHitSingle;
+        d["anyHitStream"] = result.anyHitStream;
+        return d;
+    }
+
+    uint32_t Scene::selectMeshLOD(uint32_t meshInstanceID, float maxPixelError, uint32_t viewportHeight) const
+    {
+        const auto& instance = mMeshInstanceData[meshInstanceID];
+        const auto& lods = mMeshLODs[instance.meshID];
+        if (lods.empty()) return 0;
+
+        // Bound the instance with a sphere in world space. The object-space errors are scaled by the largest axis scale.
+        const glm::mat4& transform = mpAnimationController->getGlobalMatrices()[instance.globalMatrixID];
+        const AABB& bounds = mMeshBBs[instance.meshID];
+        const float scale = std::max(glm::length(float3(transform[0])), std::max(glm::length(float3(transform[1])), glm::length(float3(transform[2]))));
+        const float3 center = float3(transform * float4(bounds.center(), 1.f));
+        const float radius = bounds.radius() * scale;
+
+        const auto& pCamera = getCamera();
+        const float distance = std::max(glm::length(center - pCamera->getPosition()) - radius, pCamera->getNearPlane());
+        const float fovY = focalLengthToFovY(pCamera->getFocalLength(), pCamera->getFrameHeight());
+        const float pixelsPerUnit = viewportHeight / (2.f * std::tan(0.5f * fovY) * distance);
+
+        uint32_t lod = 0;
+        while (lod < lods.size() && lods[lod].error * scale * pixelsPerUnit <= maxPixelError) lod++;
+        return lod;
+    }
+
+    std::vector<uint32_t> Scene::selectMeshLODs(float maxPixelError, uint32_t viewportHeight) const
+    {
+        std::vector<uint32_t> lods(mMeshInstanceData.size());
+        for (uint32_t instanceID = 0; instanceID < lods.size(); instanceID++) lods[instanceID] = selectMeshLOD(instanceID, maxPixelError, viewportHeight);
+        return lods;
+    }
+
+    pybind11::dict Scene::benchmarkMeshletCulling(uint32_t iterations) const
+    {
+        pybind11::dict d;
+        if (!mpMeshlets)
+        {
+            logWarning("Scene::benchmarkMeshletCulling() - The scene was not built with the GenerateMeshlets flag.");
+            return d;
+        }
+
+        const auto& pCamera = getCamera();
+        const glm::mat4 viewProj = pCamera->getViewProjMatrix();
+        const float3 viewPos = pCamera->getPosition();
+        const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
+
+        SceneMeshlets::CullStats total;
+        double bestTime = std::numeric_limits<double>::infinity(); // In milliseconds.
+        for (uint32_t i = 0; i < std::max(iterations, 1u); i++)
+        {
+            total = SceneMeshlets::CullStats();
+            auto start = CpuTimer::getCurrentTimePoint();
+            for (const auto& instance : mMeshInstanceData)
+            {
+                auto stats = mpMeshlets->cull(instance.meshID, globalMatrices[instance.globalMatrixID], viewProj, viewPos);
+                total.testedCount += stats.testedCount;
+                total.frustumCulledCount += stats.frustumCulledCount;
+                total.coneCulledCount += stats.coneCulledCount;
+            }
+            bestTime = std::min(bestTime, CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()));
+        }
+
+        const auto& stats = mpMeshlets->getStats();
+        const uint64_t visibleCount = total.testedCount - total.frustumCulledCount - total.coneCulledCount;
+        std::string msg = "Meshlet culling benchmark (" + std::to_string(stats.meshletCount) + " meshlets, " + std::to_string(total.testedCount) + " instanced):\n";
+        msg += "  frustum culled: " + std::to_string(total.frustumCulledCount) + ", cone culled: " + std::to_string(total.coneCulledCount) + ", visible: " + std::to_string(visibleCount) + "\n";
+        msg += "  time: " + std::to_string(bestTime) + " ms (" + std::to_string(total.testedCount / bestTime * 1e-3) + " Mmeshlets/s)";
+        logInfo(msg);
+
+        d["meshletCount"] = stats.meshletCount;
+        d["avgVertexCount"] = stats.avgVertexCount;
+        d["avgTriangleCount"] = stats.avgTriangleCount;
+        d["avgRadius"] = stats.avgRadius;
+        d["coneCullableCount"] = stats.coneCullableCount;
+        d["meshletMemoryInBytes"] = stats.memoryInBytes;
+        d["testedCount"] = total.testedCount;
+        d["frustumCulledCount"] = total.frustumCulledCount;
+        d["coneCulledCount"] = total.coneCulledCount;
+        d["visibleCount"] = visibleCount;
+        d["timeMs"] = bestTime;
+        return d;
+    }
+
     pybind11::dict Scene::SceneStats::toPython() const
     {
         pybind11::dict d;
@@ -2389,8 +2610,12 @@ namespace Falcor
         d["instancedVertexCount"] = instancedVertexCount;
         d["indexMemoryInBytes"] = indexMemoryInBytes;
         d["vertexMemoryInBytes"] = vertexMemoryInBytes;
+        d["uncompressedVertexMemoryInBytes"] = uncompressedVertexMemoryInBytes;
         d["geometryMemoryInBytes"] = geometryMemoryInBytes;
         d["animationMemoryInBytes"] = animationMemoryInBytes;
+        d["lodCount"] = lodCount;
+        d["lodTriangleCount"] = lodTriangleCount;
+        d["lodIndexMemoryInBytes"] = lodIndexMemoryInBytes;
 
         // Curve stats
         d["uniqueCurveSegmentCount"] = uniqueCurveSegmentCount;
@@ -2411,6 +2636,9 @@ namespace Falcor
         // Raytracing stats
         d["blasGroupCount"] = blasGroupCount;
         d["blasCount"] = blasCount;
+        d["meshGroupCount"] = meshGroupCount;
+        d["meshGroupMaxTriangleCount"] = meshGroupMaxTriangleCount;
+        d["meshGroupTraversalCost"] = meshGroupTraversalCost;
         d["blasCompactedCount"] = blasCompactedCount;
         d["blasMemoryInBytes"] = blasMemoryInBytes;
         d["blasScratchMemoryInBytes"] = blasScratchMemoryInBytes;
@@ -2442,10 +2670,22 @@ namespace Falcor
         return d;
     }
 
+    pybind11::dict Scene::UploadStats::toPython() const
+    {
+        pybind11::dict d;
+        d["meshInstanceBytes"] = meshInstanceBytes;
+        d["matrixBytes"] = matrixBytes;
+        d["materialBytes"] = materialBytes;
+        d["lightBytes"] = lightBytes;
+        d["totalBytes"] = getTotalBytes();
+        return d;
+    }
+
     SCRIPT_BINDING(Scene)
     {
         pybind11::class_<Scene, Scene::SharedPtr> scene(m, "Scene");
         scene.def_property_readonly(kStats.c_str(), [] (const Scene* pScene) { return pScene->getSceneStats().toPython(); });
+        scene.def_property_readonly(kUploadStats.c_str(), [] (const Scene* pScene) { return pScene->getUploadStats().toPython(); });
         scene.def_property_readonly(kBounds.c_str(), &Scene::getSceneBounds, pybind11::return_value_policy::copy);
         scene.def_property(kCamera.c_str(), &Scene::getCamera, &Scene::setCamera);
         scene.def_property(kEnvMap.c_str(), &Scene::getEnvMap, &Scene::setEnvMap);
@@ -2466,6 +2706,9 @@ namespace Falcor
         scene.def(kGetMaterial.c_str(), &Scene::getMaterialByName, "name"_a);
         scene.def(kGetVolume.c_str(), &Scene::getVolume, "index"_a);
         scene.def(kGetVolume.c_str(), &Scene::getVolumeByName, "name"_a);
+        scene.def(kBenchmarkCpuBVH.c_str(), &Scene::benchmarkCpuBVH, "width"_a = 1920, "height"_a = 1080);
+        scene.def(kBenchmarkMeshletCulling.c_str(), &Scene::benchmarkMeshletCulling, "iterations"_a = 10);
+        scene.def(kSelectMeshLODs.c_str(), &Scene::selectMeshLODs, "maxPixelError"_a = 1.f, "viewportHeight"_a = 1080);
 
         // Viewpoints
         scene.def(kAddViewpoint.c_str(), pybind11::overload_cast<>(&Scene::addViewpoint)); // add current camera as viewpoint
@@ -40,6 +40,8 @@
 #include "Experimental/Scene/Lights/EnvMap.h"
 #include "SceneTypes.slang"
 #include "HitInfo.h"
+#include "SceneBVH.h"
+#include "SceneMeshlets.h"
 
 // Indicating the implementation of curve back-face culling is in anyhit shaders or intersection shaders.
 // Currently, the performance numbers on BabyCheetah scene with 20 indirect bounces are 77ms (with anyhit) and 73ms (without anyhit).
@@ -92,6 +94,11 @@ namespace Falcor
 
         static const uint32_t kCurveIntersectionTypeID = 0;
 
+        /** Large scenes are split into multiple BLAS groups in order to reduce build memory usage.
+            The target is max 0.5GB intermediate memory per BLAS group. Note that this is not a strict limit.
+        */
+        static const size_t kMaxBLASBuildMemory = 1ull << 29;
+
         static const FileDialogFilterVec& getFileExtensionFilters();
 
         /** Create scene from file.
@@ -189,8 +196,12 @@ namespace Falcor
             uint64_t instancedVertexCount = 0;          ///< Number of instanced vertices. This is the total number of vertices in the rendered triangles.
             uint64_t indexMemoryInBytes = 0;            ///< Total memory in bytes used by the index buffer.
             uint64_t vertexMemoryInBytes = 0;           ///< Total memory in bytes used by the vertex buffer.
+            uint64_t uncompressedVertexMemoryInBytes = 0; ///< Memory in bytes the vertex buffer would use in the default format. Differs from vertexMemoryInBytes only for compressed vertices.
             uint64_t geometryMemoryInBytes = 0;         ///< Total memory in bytes used by the geometry data (meshes, curves, instances).
             uint64_t animationMemoryInBytes = 0;        ///< Total memory in bytes used by the animation system (transforms, skinning buffers).
+            uint64_t lodCount = 0;                      ///< Number of mesh LODs.
+            uint64_t lodTriangleCount = 0;              ///< Number of unique triangles in the mesh LODs. These are not included in uniqueTriangleCount.
+            uint64_t lodIndexMemoryInBytes = 0;         ///< Memory in bytes used by the mesh LODs in the index buffer. This is included in indexMemoryInBytes.
 
             // Curve stats
             uint64_t uniqueCurveSegmentCount = 0;       ///< Number of unique curve segments (linear tube segments by default). A segment can exist in multiple instances.
@@ -217,6 +228,9 @@ namespace Falcor
             uint64_t tlasCount = 0;                     ///< Number of TLASes.
             uint64_t tlasMemoryInBytes = 0;             ///< Total memory in bytes used by the TLASes.
             uint64_t tlasScratchMemoryInBytes = 0;      ///< Additional memory in bytes kept around for TLAS updates etc.
+            uint64_t meshGroupCount = 0;                ///< Number of mesh groups. Each mesh group is built into one BLAS.
+            uint64_t meshGroupMaxTriangleCount = 0;     ///< Number of triangles in the largest mesh group.
+            float meshGroupTraversalCost = 0.f;         ///< Estimated relative traversal cost of the mesh groups (BLASes), summed over the groups before splitting. Lower is better.
 
             // Light stats
             uint64_t activeLightCount = 0;              ///< Number of active lights.
@@ -257,6 +271,25 @@ namespace Falcor
 
         const SceneStats& getSceneStats() const { return mSceneStats; }
 
+        /** Statistics of the scene data uploaded to the GPU by the last call to update().
+            Only the changed ranges of the instance, matrix, material and light buffers are uploaded.
+        */
+        struct UploadStats
+        {
+            uint64_t meshInstanceBytes = 0;     ///< Bytes of mesh instance data uploaded.
+            uint64_t matrixBytes = 0;           ///< Bytes of world and inverse transpose world matrices uploaded.
+            uint64_t materialBytes = 0;         ///< Bytes of material data uploaded.
+            uint64_t lightBytes = 0;            ///< Bytes of light data uploaded.
+
+            uint64_t getTotalBytes() const { return meshInstanceBytes + matrixBytes + materialBytes + lightBytes; }
+
+            /** Convert to python dict.
+            */
+            pybind11::dict toPython() const;
+        };
+
+        const UploadStats& getUploadStats() const { return mUploadStats; }
+
         /** Get the render settings.
         */
         const RenderSettings& getRenderSettings() const { return mRenderSettings; }
@@ -358,6 +391,11 @@ namespace Falcor
         */
         uint32_t getMeshCount() const { return (uint32_t)mMeshDesc.size(); }
 
+        /** Check whether the scene vertices are stored in the compressed format (see SceneBuilder::Flags::UseCompressedVertices).
+            Shaders select the matching vertex buffer layout with the SCENE_HAS_COMPRESSED_VERTICES define.
+        */
+        bool hasCompressedVertices() const { return mHasCompressedVertices; }
+
         /** Get the number of procedural primitives.
         */
         uint32_t getProceduralPrimitiveCount() const { return (uint32_t)mProceduralPrimData.size(); }
@@ -430,10 +468,66 @@ namespace Falcor
         */
         const AABB& getSceneBounds() const { return mSceneBB; }
 
+        /** Get the CPU ray tracing acceleration structure.
+            \return The acceleration structure, or nullptr if the scene was not built with SceneBuilder::Flags::BuildCpuBVH.
+        */
+        const SceneBVH::SharedPtr& getCpuBVH() const { return mpCpuBVH; }
+
+        /** Measure the throughput of the CPU ray tracing acceleration structure.
+            Primary rays are generated from the selected camera, and the same rays are used for the any-hit queries.
+            The results (in Mrays/s) are written to the log.
+            \param[in] width Ray grid width.
+            \param[in] height Ray grid height.
+            \return Dictionary with the throughput of each query type, or an empty dictionary if there is no CPU acceleration structure.
+        */
+        pybind11::dict benchmarkCpuBVH(uint32_t width, uint32_t height) const;
+
+        /** Get the meshlet partitioning of the meshes. Meshlets are indexed by mesh ID, see SceneMeshlets::getMeshRange().
+            \return The meshlets, or nullptr if the scene was not built with SceneBuilder::Flags::GenerateMeshlets.
+        */
+        const SceneMeshlets::SharedPtr& getMeshlets() const { return mpMeshlets; }
+
+        /** Measure the throughput of CPU meshlet culling.
+            All mesh instances are culled against the view frustum of the selected camera and with the meshlet normal cones.
+            The results are written to the log.
+            \param[in] iterations Number of times the scene is culled. The fastest iteration is reported.
+            \return Dictionary with the meshlet stats, culling counts and time, or an empty dictionary if there are no meshlets.
+        */
+        pybind11::dict benchmarkMeshletCulling(uint32_t iterations) const;
+
         /** Get a mesh's bounds in object space.
         */
         const AABB& getMeshBounds(uint32_t meshID) const { return mMeshBBs[meshID]; }
 
+        /** Simplified level of detail of a mesh (see SceneBuilder::Flags::GenerateLODs).
+            A LOD uses the vertices of its mesh with a separate range of the global index buffer in the same index format.
+            It can be drawn by replacing MeshDesc::ibOffset and MeshDesc::indexCount.
+        */
+        struct MeshLOD
+        {
+            uint32_t ibOffset = 0;      ///< Offset into the global index buffer.
+            uint32_t indexCount = 0;    ///< Index count.
+            float error = 0.f;          ///< Largest geometric deviation from the original mesh in object space.
+        };
+
+        /** Get the LODs of a mesh, ordered from finest to coarsest. The original mesh is LOD 0 and is not included.
+        */
+        const std::vector<MeshLOD>& getMeshLODs(uint32_t meshID) const { return mMeshLODs[meshID]; }
+
+        /** Select the LOD of a mesh instance for the selected camera by screen-space error.
+            The error of each LOD is projected at the nearest point of the instance bounds.
+            \param[in] meshInstanceID Mesh instance ID.
+            \param[in] maxPixelError Largest acceptable error in pixels.
+            \param[in] viewportHeight Viewport height in pixels.
+            \return The coarsest acceptable LOD, where 0 is the original mesh and i > 0 is getMeshLODs()[i - 1].
+        */
+        uint32_t selectMeshLOD(uint32_t meshInstanceID, float maxPixelError, uint32_t viewportHeight) const;
+
+        /** Select the LODs of all mesh instances, see selectMeshLOD().
+            \return LOD per mesh instance, indexed by mesh instance ID.
+        */
+        std::vector<uint32_t> selectMeshLODs(float maxPixelError, uint32_t viewportHeight) const;
+
         /** Get a curve's bounds in object space.
         */
         const AABB& getCurveBounds(uint32_t curveID) const { return mCurveBBs[curveID]; }
@@ -759,11 +853,13 @@ namespace Falcor
         std::vector<MeshDesc> mMeshDesc;                            ///< Copy of mesh data GPU buffer (mpMeshes).
         std::vector<MeshInstanceData> mMeshInstanceData;            ///< Mesh instance data.
         std::vector<PackedMeshInstanceData> mPackedMeshInstanceData;///< Copy of packed mesh instance data GPU buffer (mpMeshInstances).
+        DirtyRanges mDirtyMeshInstances;                            ///< Ranges of mPackedMeshInstanceData to upload.
         std::vector<ProceduralPrimitiveData> mProceduralPrimData;   ///< Procedural intersection AABB index data (offset, count) including all primitive types (custom primitives, curves, etc.).
         std::vector<AABB> mCustomPrimitiveAABBs;                    ///< User-defined custom primitive AABBs.
         std::vector<CurveDesc> mCurveDesc;                          ///< Copy of curve data GPU buffer (mpCurves).
         std::vector<CurveInstanceData> mCurveInstanceData;          ///< Curve instance data.
         std::vector<MeshGroup> mMeshGroups;                         ///< Groups of meshes. Each group maps to a BLAS for ray tracing.
+        std::vector<std::vector<MeshLOD>> mMeshLODs;                ///< Simplified levels of detail, indexed by mesh ID.
         std::vector<std::string> mMeshNames;                        ///< Mesh names, indxed by mesh ID
         std::vector<Node> mSceneGraph;                              ///< For each index i, the array element indicates the parent node. Indices are in relation to mLocalToWorldMatrices.
 
@@ -776,14 +872,19 @@ namespace Falcor
 
         bool mHas16BitIndices = false;                              ///< True if any meshes use 16-bit indices.
         bool mHas32BitIndices = false;                              ///< True if any meshes use 32-bit indices.
+        bool mHasCompressedVertices = false;                        ///< True if the vertex buffer uses the CompressedStaticVertexData format.
 
         // Materials
         std::vector<Material::SharedPtr> mMaterials;                ///< Bound to parameter block.
+        std::vector<MaterialData> mMaterialData;                    ///< Copy of material data GPU buffer (mpMaterialsBuffer).
+        DirtyRanges mDirtyMaterials;                                ///< Ranges of mMaterialData to upload.
         std::vector<uint32_t> mSortedMaterialIndices;               ///< Indices of materials, sorted alphabetically by case-insensitive name
         bool mSortMaterialsByName = false;                          ///< If true, display materials sorted by name, rather than by ID
 
         // Lights
         std::vector<Light::SharedPtr> mLights;                      ///< Bound to parameter block.
+        std::vector<LightData> mLightData;                          ///< Copy of light data GPU buffer (mpLightsBuffer), active lights only.
+        DirtyRanges mDirtyLights;                                   ///< Ranges of mLightData to upload.
         std::vector<Volume::SharedPtr> mVolumes;                    ///< Bound to parameter block.
         std::vector<Grid::SharedPtr> mGrids;                        ///< Bound to parameter block.
         std::unordered_map<Grid::SharedPtr, uint32_t> mGridIDs;
@@ -797,9 +898,12 @@ namespace Falcor
         std::vector<AABB> mCurveBBs;                                ///< Bounding boxes for curves (not instances) in object space.
         std::vector<std::vector<uint32_t>> mCurveIdToInstanceIds;   ///< Mapping of what instances belong to which curve.
         HitInfo mHitInfo;                                           ///< Geometry hit info requirements.
+        SceneBVH::SharedPtr mpCpuBVH;                               ///< CPU ray tracing acceleration structure, or nullptr if not requested.
+        SceneMeshlets::SharedPtr mpMeshlets;                        ///< Meshlet partitioning of the meshes, or nullptr if not requested.
         AABB mSceneBB;                                              ///< Bounding boxes of the entire scene in world space.
         std::vector<bool> mMeshHasDynamicData;                      ///< Whether a Mesh has dynamic data, meaning it is skinned.
         SceneStats mSceneStats;                                     ///< Scene statistics.
+        UploadStats mUploadStats;                                   ///< Upload statistics of the last update.
         RenderSettings mRenderSettings;                             ///< Render settings.
         RenderSettings mPrevRenderSettings;
 
@@ -900,6 +1004,7 @@ namespace Falcor
         std::vector<BlasGroup> mBlasGroups;                 ///< BLAS group data.
         Buffer::SharedPtr mpBlasScratch;                    ///< Scratch buffer used for BLAS builds.
         Buffer::SharedPtr mpBlasStaticWorldMatrices;        ///< Object-to-world transform matrices in row-major format. Only valid for static meshes.
+        Buffer::SharedPtr mpBlasCompressedMeshTransforms;   ///< Per-mesh transforms in row-major format that dequantize compressed vertex positions. Static meshes include the object-to-world transform.
         bool mRebuildBlas = true;                           ///< Flag to indicate BLASes need to be rebuilt.
         bool mHasSkinnedMesh = false;                       ///< Whether the scene has a skinned mesh at all.
 
@@ -0,0 +1,306 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "SceneBVH.h"
+#include <execution>
+
+namespace Falcor
+{
+    SceneBVH::SharedPtr SceneBVH::create(Geometry geometry, const std::vector<glm::mat4>& matrices, const BVH4::BuildOptions& options)
+    {
+        SharedPtr pBVH = SharedPtr(new SceneBVH());
+        pBVH->mGeometry = std::move(geometry);
+        pBVH->mOptions = options;
+
+        const Geometry& g = pBVH->mGeometry;
+        Stats& stats = pBVH->mStats;
+
+        // Build the bottom levels. The meshes are independent, so they are built in parallel.
+        pBVH->mBottomLevels.resize(g.meshes.size());
+        auto meshIDs = NumericRange<uint32_t>(0, (uint32_t)g.meshes.size());
+        std::for_each(std::execution::par, meshIDs.begin(), meshIDs.end(), [&](uint32_t meshID)
+        {
+            std::vector<AABB> triangleBounds;
+            const auto& mesh = g.meshes[meshID];
+            triangleBounds.resize(mesh.triangleCount);
+            for (uint32_t t = 0; t < mesh.triangleCount; t++)
+            {
+                AABB b;
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    uint32_t v = mesh.isIndexed ? g.indices[mesh.indexOffset + 3 * t + k] : 3 * t + k;
+                    b.include(g.positions[mesh.vertexOffset + v]);
+                }
+                triangleBounds[t] = b;
+            }
+            pBVH->mBottomLevels[meshID].build(triangleBounds, options);
+        });
+
+        stats.meshCount = (uint32_t)g.meshes.size();
+        stats.instanceCount = (uint32_t)g.instances.size();
+        stats.memoryInBytes = g.positions.size() * sizeof(float3) + g.indices.size() * sizeof(uint32_t);
+        uint32_t maxBottomDepth = 0;
+        for (uint32_t meshID = 0; meshID < g.meshes.size(); meshID++)
+        {
+            const auto& blas = pBVH->mBottomLevels[meshID];
+            stats.triangleCount += g.meshes[meshID].triangleCount;
+            stats.nodeCount += blas.getNodes().size();
+            stats.memoryInBytes += blas.getNodes().size() * sizeof(BVH4::Node) + blas.getPrimitiveIndices().size() * sizeof(uint32_t);
+            maxBottomDepth = std::max(maxBottomDepth, blas.getDepth());
+        }
+
+        pBVH->updateTransforms(matrices);
+        stats.maxDepth = pBVH->mTopLevel.getDepth() + maxBottomDepth;
+
+        return pBVH;
+    }
+
+    void SceneBVH::updateTransforms(const std::vector<glm::mat4>& matrices)
+    {
+        mInstances.resize(mGeometry.instances.size());
+        std::vector<AABB> instanceBounds(mGeometry.instances.size());
+
+        for (uint32_t i = 0; i < mGeometry.instances.size(); i++)
+        {
+            const auto& instance = mGeometry.instances[i];
+            if (instance.matrixID >= matrices.size()) throw std::exception("SceneBVH::updateTransforms() - instance references a missing transform");
+
+            const glm::mat4& objectToWorld = matrices[instance.matrixID];
+            mInstances[i].worldToObject = glm::inverse(objectToWorld);
+            mInstances[i].meshID = instance.meshID;
+
+            const BVH4& blas = mBottomLevels[instance.meshID];
+            if (!blas.empty()) instanceBounds[i] = blas.getBounds().transform(objectToWorld);
+        }
+
+        mTopLevel.build(instanceBounds, mOptions);
+    }
+
+    bool SceneBVH::intersectTriangle(uint32_t meshID, uint32_t triangleIndex, const float3& origin, const float3& dir, float tMin, float& tMax, float2& barycentrics) const
+    {
+        const auto& mesh = mGeometry.meshes[meshID];
+        float3 p[3];
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            uint32_t v = mesh.isIndexed ? mGeometry.indices[mesh.indexOffset + 3 * triangleIndex + k] : 3 * triangleIndex + k;
+            p[k] = mGeometry.positions[mesh.vertexOffset + v];
+        }
+
+        // Moller-Trumbore without backface culling.
+        const float3 e1 = p[1] - p[0];
+        const float3 e2 = p[2] - p[0];
+        const float3 pvec = glm::cross(dir, e2);
+        const float det = glm::dot(e1, pvec);
+        if (det == 0.f) return false;
+
+        const float invDet = 1.f / det;
+        const float3 tvec = origin - p[0];
+        const float u = glm::dot(tvec, pvec) * invDet;
+        if (u < 0.f || u > 1.f) return false;
+
+        const float3 qvec = glm::cross(tvec, e1);
+        const float v = glm::dot(dir, qvec) * invDet;
+        if (v < 0.f || u + v > 1.f) return false;
+
+        const float t = glm::dot(e2, qvec) * invDet;
+        if (t < tMin || t > tMax) return false;
+
+        tMax = t;
+        barycentrics = float2(u, v);
+        return true;
+    }
+
+    bool SceneBVH::closestHit(const Ray& ray, Hit& hit) const
+    {
+        hit = Hit();
+        float tMax = ray.tMax;
+
+        mTopLevel.traverse(ray.origin, ray.dir, ray.tMin, tMax, [&](uint32_t instanceID, float& tMaxTop)
+        {
+            const InstanceData& instance = mInstances[instanceID];
+            const float3 origin = float3(instance.worldToObject * float4(ray.origin, 1.f));
+            const float3 dir = float3(instance.worldToObject * float4(ray.dir, 0.f));
+
+            mBottomLevels[instance.meshID].traverse(origin, dir, ray.tMin, tMaxTop, [&](uint32_t triangleIndex, float& tMaxBottom)
+            {
+                float2 barycentrics;
+                if (intersectTriangle(instance.meshID, triangleIndex, origin, dir, ray.tMin, tMaxBottom, barycentrics))
+                {
+                    hit.instanceID = instanceID;
+                    hit.primitiveIndex = triangleIndex;
+                    hit.barycentrics = barycentrics;
+                    hit.t = tMaxBottom;
+                }
+                return false;
+            });
+            return false;
+        });
+
+        return hit.isValid();
+    }
+
+    bool SceneBVH::anyHit(const Ray& ray) const
+    {
+        bool occluded = false;
+        float tMax = ray.tMax;
+
+        mTopLevel.traverse(ray.origin, ray.dir, ray.tMin, tMax, [&](uint32_t instanceID, float& tMaxTop)
+        {
+            const InstanceData& instance = mInstances[instanceID];
+            const float3 origin = float3(instance.worldToObject * float4(ray.origin, 1.f));
+            const float3 dir = float3(instance.worldToObject * float4(ray.dir, 0.f));
+
+            float tMaxBottom = tMaxTop;
+            mBottomLevels[instance.meshID].traverse(origin, dir, ray.tMin, tMaxBottom, [&](uint32_t triangleIndex, float& tMaxTriangle)
+            {
+                float2 barycentrics;
+                occluded = intersectTriangle(instance.meshID, triangleIndex, origin, dir, ray.tMin, tMaxTriangle, barycentrics);
+                return occluded;
+            });
+            return occluded;
+        });
+
+        return occluded;
+    }
+
+    template<bool kAnyHit>
+    void SceneBVH::tracePacket(const Ray* rays, Hit* hits, uint8_t* occluded, uint32_t rayCount) const
+    {
+        assert(rayCount <= kPacketSize);
+        float3 origins[kPacketSize], dirs[kPacketSize];
+        float tMins[kPacketSize], tMaxs[kPacketSize];
+        for (uint32_t r = 0; r < rayCount; r++)
+        {
+            origins[r] = rays[r].origin;
+            dirs[r] = rays[r].dir;
+            tMins[r] = rays[r].tMin;
+            tMaxs[r] = rays[r].tMax;
+            if (kAnyHit) occluded[r] = 0;
+            else hits[r] = Hit();
+        }
+
+        // For each instance, the rays entering it are transformed to object space and traced as a sub-packet through the bottom level.
+        mTopLevel.traversePacket(origins, dirs, tMins, tMaxs, rayCount, [&](uint64_t rayMask, uint32_t instanceID, float* tMaxTop) -> uint64_t
+        {
+            const InstanceData& instance = mInstances[instanceID];
+
+            uint32_t rayIndex[kPacketSize];
+            float3 objOrigins[kPacketSize], objDirs[kPacketSize];
+            float objTMins[kPacketSize], objTMaxs[kPacketSize];
+            uint32_t count = 0;
+            for (uint64_t remaining = rayMask; remaining != 0; remaining &= remaining - 1)
+            {
+                uint32_t r = BVH4::lowestSetBit(remaining);
+                rayIndex[count] = r;
+                objOrigins[count] = float3(instance.worldToObject * float4(origins[r], 1.f));
+                objDirs[count] = float3(instance.worldToObject * float4(dirs[r], 0.f));
+                objTMins[count] = tMins[r];
+                objTMaxs[count] = tMaxTop[r];
+                count++;
+            }
+
+            uint64_t terminated = 0;
+            mBottomLevels[instance.meshID].traversePacket(objOrigins, objDirs, objTMins, objTMaxs, count, [&](uint64_t subMask, uint32_t triangleIndex, float* tMaxBottom) -> uint64_t
+            {
+                uint64_t subTerminated = 0;
+                for (uint64_t remaining = subMask; remaining != 0; remaining &= remaining - 1)
+                {
+                    uint32_t s = BVH4::lowestSetBit(remaining);
+                    float2 barycentrics;
+                    if (!intersectTriangle(instance.meshID, triangleIndex, objOrigins[s], objDirs[s], objTMins[s], tMaxBottom[s], barycentrics)) continue;
+
+                    uint32_t r = rayIndex[s];
+                    if (kAnyHit)
+                    {
+                        occluded[r] = 1;
+                        subTerminated |= 1ull << s;
+                        terminated |= 1ull << r;
+                    }
+                    else
+                    {
+                        hits[r].instanceID = instanceID;
+                        hits[r].primitiveIndex = triangleIndex;
+                        hits[r].barycentrics = barycentrics;
+                        hits[r].t = tMaxBottom[s];
+                    }
+                }
+                return subTerminated;
+            });
+
+            for (uint32_t s = 0; s < count; s++) tMaxTop[rayIndex[s]] = objTMaxs[s];
+            return terminated;
+        });
+    }
+
+    void SceneBVH::closestHit(const Ray* rays, Hit* hits, size_t rayCount) const
+    {
+        for (size_t first = 0; first < rayCount; first += kPacketSize)
+        {
+            uint32_t count = (uint32_t)std::min<size_t>(kPacketSize, rayCount - first);
+            tracePacket<false>(rays + first, hits + first, nullptr, count);
+        }
+    }
+
+    void SceneBVH::anyHit(const Ray* rays, uint8_t* occluded, size_t rayCount) const
+    {
+        for (size_t first = 0; first < rayCount; first += kPacketSize)
+        {
+            uint32_t count = (uint32_t)std::min<size_t>(kPacketSize, rayCount - first);
+            tracePacket<true>(rays + first, nullptr, occluded + first, count);
+        }
+    }
+
+    SceneBVH::BenchmarkResult SceneBVH::benchmark(const std::vector<Ray>& rays, uint32_t iterations) const
+    {
+        BenchmarkResult result;
+        if (rays.empty()) return result;
+
+        std::vector<Hit> hits(rays.size());
+        std::vector<uint8_t> occluded(rays.size());
+
+        auto measure = [&](auto func)
+        {
+            double bestTime = std::numeric_limits<double>::max();
+            for (uint32_t i = 0; i < std::max(iterations, 1u); i++)
+            {
+                auto start = CpuTimer::getCurrentTimePoint();
+                func();
+                bestTime = std::min(bestTime, CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()));
+            }
+            // Duration is in milliseconds.
+            return rays.size() / (std::max(bestTime, 1e-6) * 1e3);
+        };
+
+        result.closestHitSingle = measure([&]() { for (size_t i = 0; i < rays.size(); i++) closestHit(rays[i], hits[i]); });
+        result.closestHitStream = measure([&]() { closestHit(rays.data(), hits.data(), rays.size()); });
+        result.anyHitSingle = measure([&]() { for (size_t i = 0; i < rays.size(); i++) occluded[i] = anyHit(rays[i]) ? 1 : 0; });
+        result.anyHitStream = measure([&]() { anyHit(rays.data(), occluded.data(), rays.size()); });
+
+        return result;
+    }
+}
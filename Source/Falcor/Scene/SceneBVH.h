@@ -0,0 +1,180 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Utils/AccelerationStructures/BVH4.h"
+#include "HitInfoType.slang"
+
+namespace Falcor
+{
+    /** CPU ray tracing acceleration structure for the triangle meshes of a scene.
+
+        This is a two-level hierarchy. Each mesh has a bottom-level BVH4 over its triangles in object space,
+        and a top-level BVH4 over the world-space bounds of the mesh instances. Instance transforms can be
+        updated without touching the bottom levels.
+
+        Hits are reported with the same IDs as GPU ray tracing: the mesh instance ID, the triangle index
+        within the mesh and barycentrics of the second and third vertex. Use HitInfo::encode() to pack
+        them in the same format as the GPU.
+
+        Limitations: all geometry is treated as opaque (no alpha testing), skinned meshes use their bind pose
+        and curves are not supported. All queries are const and can be issued from multiple threads.
+    */
+    class dlldecl SceneBVH
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneBVH>;
+        static const uint32_t kInvalidIndex = 0xffffffff;
+        static const uint32_t kPacketSize = 16;     ///< Number of rays traced together by the stream functions.
+
+        /** Scene geometry used to build the acceleration structure.
+        */
+        struct Geometry
+        {
+            struct Mesh
+            {
+                uint32_t vertexOffset = 0;  ///< Offset of the first vertex in 'positions'.
+                uint32_t indexOffset = 0;   ///< Offset of the first index in 'indices'.
+                uint32_t triangleCount = 0;
+                bool isIndexed = true;      ///< If false, triangle i uses vertices 3i, 3i+1, 3i+2.
+            };
+
+            struct Instance
+            {
+                uint32_t meshID = 0;
+                uint32_t matrixID = 0;      ///< Index into the transform matrices.
+            };
+
+            std::vector<float3> positions;  ///< Object-space vertex positions of all meshes.
+            std::vector<uint32_t> indices;  ///< Vertex indices of all indexed meshes, relative to the mesh vertex offset.
+            std::vector<Mesh> meshes;
+            std::vector<Instance> instances; ///< Mesh instances, indexed by mesh instance ID.
+        };
+
+        struct Ray
+        {
+            float3 origin = float3(0.f);
+            float tMin = 0.f;
+            float3 dir = float3(0.f, 0.f, 1.f);
+            float tMax = std::numeric_limits<float>::infinity();
+        };
+
+        struct Hit
+        {
+            InstanceType type = InstanceType::TriangleMesh;
+            uint32_t instanceID = kInvalidIndex;        ///< Mesh instance ID.
+            uint32_t primitiveIndex = kInvalidIndex;    ///< Triangle index within the mesh.
+            float2 barycentrics = float2(0.f);          ///< Barycentric weights of the second and third vertex.
+            float t = std::numeric_limits<float>::infinity();
+
+            bool isValid() const { return instanceID != kInvalidIndex; }
+        };
+
+        struct Stats
+        {
+            uint32_t meshCount = 0;
+            uint32_t instanceCount = 0;
+            uint64_t triangleCount = 0;         ///< Number of unique triangles.
+            uint64_t nodeCount = 0;             ///< Number of BVH4 nodes in all levels.
+            uint32_t maxDepth = 0;              ///< Depth of the top level plus the deepest bottom level.
+            uint64_t memoryInBytes = 0;         ///< Memory used by geometry and hierarchies.
+        };
+
+        /** Build the acceleration structure.
+            \param[in] geometry Scene geometry. The object takes ownership.
+            \param[in] matrices World transforms referenced by the instances.
+            \param[in] options Build options used for all levels.
+        */
+        static SharedPtr create(Geometry geometry, const std::vector<glm::mat4>& matrices, const BVH4::BuildOptions& options = BVH4::BuildOptions());
+
+        /** Update the instance transforms and rebuild the top level.
+        */
+        void updateTransforms(const std::vector<glm::mat4>& matrices);
+
+        /** Find the closest hit along a ray.
+            \return True if something was hit.
+        */
+        bool closestHit(const Ray& ray, Hit& hit) const;
+
+        /** Check if anything is hit along a ray.
+        */
+        bool anyHit(const Ray& ray) const;
+
+        /** Find the closest hits for a stream of rays. Rays are traced in packets of kPacketSize with packet traversal,
+            so neighbouring rays should be coherent for best performance.
+        */
+        void closestHit(const Ray* rays, Hit* hits, size_t rayCount) const;
+
+        /** Check visibility for a stream of rays.
+            \param[out] occluded Set to 1 for rays that hit something, 0 otherwise.
+        */
+        void anyHit(const Ray* rays, uint8_t* occluded, size_t rayCount) const;
+
+        /** Throughput of the different query types in millions of rays per second.
+        */
+        struct BenchmarkResult
+        {
+            double closestHitSingle = 0.0;      ///< closestHit() called for each ray.
+            double closestHitStream = 0.0;      ///< closestHit() called on the whole stream (packet traversal).
+            double anyHitSingle = 0.0;          ///< anyHit() called for each ray.
+            double anyHitStream = 0.0;          ///< anyHit() called on the whole stream (packet traversal).
+        };
+
+        /** Measure the query throughput on the calling thread.
+            \param[in] rays Rays to trace. Coherent streams (e.g. primary rays in pixel order) benefit most from packet traversal.
+            \param[in] iterations Number of times each query type traces the rays. The fastest iteration is reported.
+        */
+        BenchmarkResult benchmark(const std::vector<Ray>& rays, uint32_t iterations = 3) const;
+
+        const Stats& getStats() const { return mStats; }
+        const AABB& getBounds() const { return mTopLevel.getBounds(); }
+
+    private:
+        SceneBVH() = default;
+
+        struct InstanceData
+        {
+            glm::mat4 worldToObject;
+            uint32_t meshID;
+        };
+
+        /** Intersect a ray with a triangle of a mesh.
+            \return True if there is a hit in [tMin, tMax], in which case tMax is set to the hit distance.
+        */
+        bool intersectTriangle(uint32_t meshID, uint32_t triangleIndex, const float3& origin, const float3& dir, float tMin, float& tMax, float2& barycentrics) const;
+
+        template<bool kAnyHit>
+        void tracePacket(const Ray* rays, Hit* hits, uint8_t* occluded, uint32_t rayCount) const;
+
+        Geometry mGeometry;
+        std::vector<BVH4> mBottomLevels;        ///< One hierarchy per mesh.
+        std::vector<InstanceData> mInstances;
+        BVH4 mTopLevel;
+        BVH4::BuildOptions mOptions;
+        Stats mStats;
+    };
+}
@@ -28,23 +28,36 @@
 #include "stdafx.h"
 #include "SceneBuilder.h"
 #include "Importer.h"
+#include "MeshSimplifier.h"
+#include "DuplicateMeshDetector.h"
 #include "Utils/Math/MathConstants.slangh"
 #include "Utils/Timing/TimeReport.h"
 #include <mikktspace.h>
 #include <filesystem>
+#include <execution>
 
 namespace Falcor
 {
     namespace
     {
-        // Large mesh groups are split in order to reduce the size of the largest BLAS.
-        // The target is max 16M triangles per BLAS (= approx 0.5GB post-compaction). Note that this is not a strict limit.
-        const size_t kMaxTrianglesPerBLAS = 1ull << 24;
+        // Parameters for the SAH mesh grouping. Costs are relative to descending one level in a BLAS.
+        const uint32_t kMeshGroupSAHBinCount = 16;
+        const float kBLASEntryCost = 4.f;   ///< Cost of entering a BLAS (instance transform, traversal setup).
 
         // Texture coordinates for textured emissive materials are quantized for performance reasons.
         // We'll log a warning if the maximum quantization error exceeds this value.
         const float kMaxTexelError = 0.5f;
 
+        // Parameters for the mesh LOD generation (Flags::GenerateLODs).
+        const uint32_t kMaxLODCount = 4;
+        const float kLODReductionFactor = 0.5f;     // Target triangle count of each LOD relative to the previous level.
+        const float kMaxLODTriangleRatio = 0.8f;    // Stop when a LOD keeps more than this fraction of the triangles of the previous level.
+        const uint32_t kMinLODTriangleCount = 256;  // Meshes and LODs with fewer triangles are not simplified further.
+        const float kMaxLODRelativeError = 0.05f;   // Maximum LOD error relative to the mesh bounding sphere radius.
+
+        // Largest position error relative to the mesh radius for meshes to be detected as copies (Flags::DetectInstances).
+        const float kInstanceDetectionTolerance = 1e-4f;
+
         int largestAxis(const float3& v)
         {
             if (v.x >= v.y && v.x >= v.z) return 0;
@@ -52,6 +65,80 @@ namespace Falcor
             else return 2;
         }
 
+        struct SAHSplit
+        {
+            int axis = -1;          ///< Split axis, or -1 if no valid split was found.
+            float pos = 0.f;        ///< Split position. Items with centroid < pos go to the left side.
+            float cost = std::numeric_limits<float>::infinity();
+        };
+
+        /** Find the binned SAH split of a set of weighted items.
+            \param[in] bounds Bounding box of each item.
+            \param[in] weights Weight of each item, e.g. its triangle count.
+            \return The best split plane. The cost is the sum of the surface area times weight of both sides, relative to the area of all items.
+        */
+        SAHSplit findSAHSplit(const std::vector<AABB>& bounds, const std::vector<size_t>& weights)
+        {
+            assert(bounds.size() == weights.size());
+            AABB totalBounds, centroidBounds;
+            for (const auto& b : bounds)
+            {
+                totalBounds.include(b);
+                centroidBounds.include(b.center());
+            }
+
+            SAHSplit best;
+            const float totalArea = std::max(totalBounds.area(), std::numeric_limits<float>::min());
+            const float3 extent = centroidBounds.extent();
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (extent[axis] <= 0.f) continue;
+
+                AABB binBounds[kMeshGroupSAHBinCount];
+                size_t binWeights[kMeshGroupSAHBinCount] = {};
+                const float scale = kMeshGroupSAHBinCount / extent[axis];
+                for (size_t i = 0; i < bounds.size(); i++)
+                {
+                    uint32_t bin = std::min((uint32_t)((bounds[i].center()[axis] - centroidBounds.minPoint[axis]) * scale), kMeshGroupSAHBinCount - 1);
+                    binBounds[bin].include(bounds[i]);
+                    binWeights[bin] += weights[i];
+                }
+
+                // Accumulate the right side from the last bin, then sweep the splits from the left.
+                AABB rightBounds[kMeshGroupSAHBinCount];
+                size_t rightWeights[kMeshGroupSAHBinCount] = {};
+                AABB accumBounds;
+                size_t accumWeight = 0;
+                for (uint32_t bin = kMeshGroupSAHBinCount - 1; bin > 0; bin--)
+                {
+                    accumBounds.include(binBounds[bin]);
+                    accumWeight += binWeights[bin];
+                    rightBounds[bin] = accumBounds;
+                    rightWeights[bin] = accumWeight;
+                }
+
+                accumBounds = AABB();
+                accumWeight = 0;
+                for (uint32_t bin = 0; bin + 1 < kMeshGroupSAHBinCount; bin++)
+                {
+                    accumBounds.include(binBounds[bin]);
+                    accumWeight += binWeights[bin];
+                    if (accumWeight == 0 || rightWeights[bin + 1] == 0) continue;
+
+                    float cost = (accumBounds.area() * accumWeight + rightBounds[bin + 1].area() * rightWeights[bin + 1]) / totalArea;
+                    if (cost < best.cost)
+                    {
+                        best.axis = axis;
+                        best.pos = centroidBounds.minPoint[axis] + (bin + 1) / scale;
+                        best.cost = cost;
+                    }
+                }
+            }
+
+            return best;
+        }
+
         class MikkTSpaceWrapper
         {
         public:
@@ -163,6 +250,12 @@ namespace Falcor
         return pBuilder->import(filename, instances) ? pBuilder : nullptr;
     }
 
+    void SceneBuilder::setMaxTrianglesPerBLAS(size_t maxTriangles)
+    {
+        if (maxTriangles == 0) throw std::exception("SceneBuilder::setMaxTrianglesPerBLAS() - Triangle budget must be larger than zero");
+        mMaxTrianglesPerBLAS = maxTriangles;
+    }
+
     bool SceneBuilder::import(const std::string& filename, const InstanceMatrices& instances, const Dictionary& dict)
     {
         bool success = Importer::import(filename, *this, instances, dict);
@@ -196,10 +289,12 @@ namespace Falcor
         TimeReport timeReport;
 
         removeUnusedMeshes();
+        if (is_set(mFlags, Flags::DetectInstances)) detectInstances();
         pretransformStaticMeshes();
         calculateMeshBoundingBoxes();
         createMeshGroups();
         optimizeGeometry();
+        if (is_set(mFlags, Flags::GenerateLODs)) generateMeshLODs();
         createGlobalBuffers();
         createCurveGlobalBuffers();
         removeDuplicateMaterials();
@@ -222,6 +317,7 @@ namespace Falcor
         mpScene->mGridIDs = mGridIDs;
         mpScene->mpEnvMap = mpEnvMap;
         mpScene->mFilename = mFilename;
+        mpScene->mSceneStats.meshGroupTraversalCost = mMeshGroupTraversalCost;
 
         // Prepare scene resources.
         createNodeList();
@@ -246,6 +342,19 @@ namespace Falcor
         mpScene->finalize();
 
         timeReport.measure("Creating resources");
+
+        if (is_set(mFlags, Flags::BuildCpuBVH))
+        {
+            createCpuBVH();
+            timeReport.measure("Building CPU BVH");
+        }
+
+        if (is_set(mFlags, Flags::GenerateMeshlets))
+        {
+            createMeshlets();
+            timeReport.measure("Generating meshlets");
+        }
+
         timeReport.printToLog();
 
         return mpScene;
@@ -493,13 +602,19 @@ namespace Falcor
     }
 
     uint32_t SceneBuilder::addProcessedMesh(const ProcessedMesh& mesh)
+    {
+        ProcessedMesh meshCopy = mesh;
+        return addProcessedMesh(std::move(meshCopy));
+    }
+
+    uint32_t SceneBuilder::addProcessedMesh(ProcessedMesh&& mesh)
     {
         const bool isIndexed = !is_set(mFlags, Flags::NonIndexedVertices);
 
         MeshSpec spec;
 
         // Add the mesh to the scene.
-        spec.name = mesh.name;
+        spec.name = std::move(mesh.name);
         spec.topology = mesh.topology;
         spec.materialId = addMaterial(mesh.pMaterial);
         spec.isFrontFaceCW = mesh.isFrontFaceCW;
@@ -523,7 +638,7 @@ namespace Falcor
             spec.hasDynamicData = true;
         }
 
-        mMeshes.push_back(spec);
+        mMeshes.push_back(std::move(spec));
 
         if (mMeshes.size() > std::numeric_limits<uint32_t>::max())
         {
@@ -847,39 +962,109 @@ namespace Falcor
         if (unusedCount > 0)
         {
             logWarning("Scene has " + std::to_string(unusedCount) + " unused meshes that will be removed.");
+            removeMeshesWithoutInstances();
+        }
+    }
 
-            const size_t meshCount = mMeshes.size();
-            MeshList meshes;
-            meshes.reserve(meshCount);
+    void SceneBuilder::removeMeshesWithoutInstances()
+    {
+        const size_t meshCount = mMeshes.size();
+        MeshList meshes;
+        meshes.reserve(meshCount);
+
+        for (uint32_t meshID = 0; meshID < (uint32_t)meshCount; meshID++)
+        {
+            auto& mesh = mMeshes[meshID];
+            if (mesh.instances.empty()) continue; // Skip unused meshes
 
-            for (uint32_t meshID = 0; meshID < (uint32_t)meshCount; meshID++)
+            // Get new mesh ID.
+            const uint32_t newMeshID = (uint32_t)meshes.size();
+
+            // Update scene graph nodes meshIDs.
+            for (const auto nodeID : mesh.instances)
             {
-                auto& mesh = mMeshes[meshID];
-                if (mesh.instances.empty()) continue; // Skip unused meshes
+                assert(nodeID < mSceneGraph.size());
+                auto& node = mSceneGraph[nodeID];
+                std::replace(node.meshes.begin(), node.meshes.end(), meshID, newMeshID);
+            }
 
-                // Get new mesh ID.
-                const uint32_t newMeshID = (uint32_t)meshes.size();
+            meshes.push_back(std::move(mesh));
+        }
 
-                // Update scene graph nodes meshIDs.
-                for (const auto nodeID : mesh.instances)
-                {
-                    assert(nodeID < mSceneGraph.size());
-                    auto& node = mSceneGraph[nodeID];
-                    std::replace(node.meshes.begin(), node.meshes.end(), meshID, newMeshID);
-                }
+        mMeshes = std::move(meshes);
 
-                meshes.push_back(std::move(mesh));
-            }
+        // Validate scene graph.
+        for (const auto& node : mSceneGraph)
+        {
+            for (uint32_t meshID : node.meshes) assert(meshID < mMeshes.size());
+        }
+    }
 
-            mMeshes = std::move(meshes);
+    void SceneBuilder::detectInstances()
+    {
+        auto getGlobalMatrix = [this](uint32_t nodeID)
+        {
+            glm::mat4 transform = glm::identity<glm::mat4>();
+            for (; nodeID != kInvalidNode; nodeID = mSceneGraph[nodeID].parent) transform = mSceneGraph[nodeID].transform * transform;
+            return transform;
+        };
 
-            // Validate scene graph.
-            assert(mMeshes.size() == meshCount - unusedCount);
-            for (const auto& node : mSceneGraph)
-            {
-                for (uint32_t meshID : node.meshes) assert(meshID < mMeshes.size());
-            }
+        // Collect the static, non-instanced triangle meshes. These would otherwise be pre-transformed into the static mesh group.
+        // The key separates meshes that can't share data: different materials, index formats or front facing side in world space.
+        std::vector<uint32_t> candidates;
+        std::vector<DuplicateMeshDetector::Mesh> meshes;
+        for (uint32_t meshID = 0; meshID < (uint32_t)mMeshes.size(); meshID++)
+        {
+            const auto& mesh = mMeshes[meshID];
+            assert(!mesh.instances.empty());
+            if (mesh.instances.size() > 1 || isNodeAnimated(mesh.instances[0]) || mesh.hasDynamicData || mesh.topology != Vao::Topology::TriangleList) continue;
+
+            DuplicateMeshDetector::Mesh desc;
+            desc.vertices = mesh.staticData.data();
+            desc.vertexCount = (uint32_t)mesh.staticData.size();
+            desc.indexData = mesh.indexData.empty() ? nullptr : mesh.indexData.data();
+            desc.indexCount = mesh.indexCount;
+            desc.use16BitIndices = mesh.use16BitIndices;
+            desc.transform = getGlobalMatrix(mesh.instances[0]);
+            const bool isWorldFrontFaceCW = mesh.isFrontFaceCW ^ (glm::determinant((glm::mat3)desc.transform) < 0.f);
+            desc.key = ((uint64_t)mesh.materialId << 2) | (mesh.use16BitIndices ? 2 : 0) | (isWorldFrontFaceCW ? 1 : 0);
+
+            candidates.push_back(meshID);
+            meshes.push_back(desc);
         }
+
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        DuplicateMeshDetector::Stats stats;
+        auto matches = DuplicateMeshDetector::detect(meshes, kInstanceDetectionTolerance, &stats);
+        const double seconds = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) * 1e-3;
+
+        // Replace each duplicate by an instance of its prototype. The instance gets a new root node with the
+        // prototype's world transform followed by the detected rigid transform.
+        uint64_t savedBytes = 0;
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            if (matches[i].prototypeID == DuplicateMeshDetector::kInvalidID) continue;
+
+            auto& mesh = mMeshes[candidates[i]];
+            const uint32_t prototypeMeshID = candidates[matches[i].prototypeID];
+            const glm::mat4 transform = matches[i].transform * meshes[matches[i].prototypeID].transform;
+
+            auto& prevNode = mSceneGraph[mesh.instances[0]];
+            prevNode.meshes.erase(std::find(prevNode.meshes.begin(), prevNode.meshes.end(), candidates[i]));
+            uint32_t nodeID = addNode(Node{ mesh.name, transform, glm::identity<glm::mat4>() });
+            addMeshInstance(nodeID, prototypeMeshID);
+
+            savedBytes += mesh.staticData.size() * sizeof(PackedStaticVertexData) + mesh.indexData.size() * sizeof(uint32_t);
+            mesh.instances.clear();
+        }
+
+        if (stats.duplicateCount > 0) removeMeshesWithoutInstances();
+
+        std::ostringstream msg;
+        msg << "Detected " << stats.duplicateCount << " copies of " << stats.prototypeCount << " meshes among " << stats.meshCount << " static meshes in "
+            << std::fixed << std::setprecision(2) << seconds << " s (" << (seconds > 0.0 ? stats.vertexCount / seconds * 1e-6 : 0.0) << " Mvertices/s, "
+            << stats.registrationCount << " registrations). Converting them to instances saves " << formatByteSize(savedBytes) << " of vertex and index data.";
+        logInfo(msg.str());
     }
 
     void SceneBuilder::pretransformStaticMeshes()
@@ -1204,12 +1389,12 @@ namespace Falcor
         return bb;
     }
 
-    bool SceneBuilder::needsSplit(const MeshGroup& meshGroup, size_t& triangleCount) const
+    bool SceneBuilder::needsSplit(const MeshGroup& meshGroup, size_t maxTriangles, size_t& triangleCount) const
     {
         assert(!meshGroup.meshList.empty());
         triangleCount = countTriangles(meshGroup);
 
-        if (triangleCount <= kMaxTrianglesPerBLAS)
+        if (triangleCount <= maxTriangles)
         {
             return false;
         }
@@ -1224,12 +1409,12 @@ namespace Falcor
             return false;
         }
         assert(meshGroup.meshList.size() > 1);
-        assert(triangleCount > kMaxTrianglesPerBLAS);
+        assert(triangleCount > maxTriangles);
 
         return true;
     }
 
-    SceneBuilder::MeshGroupList SceneBuilder::splitMeshGroupSimple(MeshGroup& meshGroup) const
+    SceneBuilder::MeshGroupList SceneBuilder::splitMeshGroupSimple(MeshGroup& meshGroup, size_t maxTriangles) const
     {
         // This function partitions a mesh group into smaller groups based on triangle count.
         // Note that the meshes are *not* reordered and individual meshes are not split,
@@ -1237,11 +1422,11 @@ namespace Falcor
 
         // Early out if splitting is not needed or possible.
         size_t triangleCount = 0;
-        if (!needsSplit(meshGroup, triangleCount)) return MeshGroupList{ std::move(meshGroup) };
+        if (!needsSplit(meshGroup, maxTriangles, triangleCount)) return MeshGroupList{ std::move(meshGroup) };
 
         // Each new group holds at least one mesh, or if multiple, up to the target number of triangles.
         assert(triangleCount > 0);
-        size_t targetGroupCount = div_round_up(triangleCount, kMaxTrianglesPerBLAS);
+        size_t targetGroupCount = div_round_up(triangleCount, maxTriangles);
         size_t targetTrianglesPerGroup = triangleCount / targetGroupCount;
 
         triangleCount = 0;
@@ -1266,7 +1451,7 @@ namespace Falcor
         return groups;
     }
 
-    SceneBuilder::MeshGroupList SceneBuilder::splitMeshGroupMedian(MeshGroup& meshGroup) const
+    SceneBuilder::MeshGroupList SceneBuilder::splitMeshGroupMedian(MeshGroup& meshGroup, size_t maxTriangles) const
     {
         // This function implements a recursive top-down BVH builder to partition a mesh group
         // into smaller groups by splitting at the median in terms of triangle count.
@@ -1274,7 +1459,7 @@ namespace Falcor
 
         // Early out if splitting is not needed or possible.
         size_t triangleCount = 0;
-        if (!needsSplit(meshGroup, triangleCount)) return MeshGroupList{ std::move(meshGroup) };
+        if (!needsSplit(meshGroup, maxTriangles, triangleCount)) return MeshGroupList{ std::move(meshGroup) };
 
         // Sort the meshes by centroid along the largest axis.
         AABB bb = calculateBoundingBox(meshGroup);
@@ -1310,8 +1495,8 @@ namespace Falcor
         MeshGroup rightGroup{ std::vector<uint32_t>(splitIter, meshes.end()), meshGroup.isStatic };
         assert(!leftGroup.meshList.empty() && !rightGroup.meshList.empty());
 
-        MeshGroupList leftList = splitMeshGroupMedian(leftGroup);
-        MeshGroupList rightList = splitMeshGroupMedian(rightGroup);
+        MeshGroupList leftList = splitMeshGroupMedian(leftGroup, maxTriangles);
+        MeshGroupList rightList = splitMeshGroupMedian(rightGroup, maxTriangles);
 
         // Move elements into a single list and return.
         leftList.insert(
@@ -1322,7 +1507,7 @@ namespace Falcor
         return leftList;
     }
 
-    SceneBuilder::MeshGroupList SceneBuilder::splitMeshGroupMidpointMeshes(MeshGroup& meshGroup)
+    SceneBuilder::MeshGroupList SceneBuilder::splitMeshGroupMidpointMeshes(MeshGroup& meshGroup, size_t maxTriangles)
     {
         // This function recursively splits a mesh group at the midpoint along the largest axis.
         // Individual meshes that straddle the splitting plane are split into two halves.
@@ -1330,7 +1515,7 @@ namespace Falcor
 
         // Early out if splitting is not needed or possible.
         size_t triangleCount = 0;
-        if (!needsSplit(meshGroup, triangleCount)) return MeshGroupList{ std::move(meshGroup) };
+        if (!needsSplit(meshGroup, maxTriangles, triangleCount)) return MeshGroupList{ std::move(meshGroup) };
 
         // Find the midpoint along the largest axis.
         AABB bb = calculateBoundingBox(meshGroup);
@@ -1354,8 +1539,105 @@ namespace Falcor
         MeshGroup leftGroup{ std::move(leftMeshes), meshGroup.isStatic };
         MeshGroup rightGroup{ std::move(rightMeshes), meshGroup.isStatic };
 
-        MeshGroupList leftList = splitMeshGroupMidpointMeshes(leftGroup);
-        MeshGroupList rightList = splitMeshGroupMidpointMeshes(rightGroup);
+        MeshGroupList leftList = splitMeshGroupMidpointMeshes(leftGroup, maxTriangles);
+        MeshGroupList rightList = splitMeshGroupMidpointMeshes(rightGroup, maxTriangles);
+
+        // Move elements into a single list and return.
+        leftList.insert(
+            leftList.end(),
+            std::make_move_iterator(rightList.begin()),
+            std::make_move_iterator(rightList.end()));
+
+        return leftList;
+    }
+
+    std::vector<uint32_t> SceneBuilder::splitMeshSAH(uint32_t meshID, size_t maxTriangles)
+    {
+        // This function recursively splits a mesh with binned SAH over its triangles until each part is within the triangle budget.
+        const auto& mesh = mMeshes[meshID];
+        const size_t triangleCount = mesh.getTriangleCount();
+        if (triangleCount <= maxTriangles) return { meshID };
+
+        // Only static indexed triangle meshes can be split.
+        if (mesh.indexCount == 0 || mesh.hasDynamicData || mesh.topology != Vao::Topology::TriangleList)
+        {
+            logWarning("Mesh '" + mesh.name + "' has " + std::to_string(triangleCount) + " triangles and cannot be split, expect extraneous GPU memory usage.");
+            return { meshID };
+        }
+
+        std::vector<AABB> triangleBounds(triangleCount);
+        for (size_t i = 0; i < triangleCount; i++)
+        {
+            for (size_t j = 0; j < 3; j++) triangleBounds[i].include(mesh.staticData[mesh.getIndex(3 * i + j)].position);
+        }
+
+        SAHSplit split = findSAHSplit(triangleBounds, std::vector<size_t>(triangleCount, 1));
+        if (split.axis < 0) return { meshID };
+
+        auto result = splitMesh(meshID, split.axis, split.pos);
+        if (!result.first || !result.second) return { meshID };
+
+        std::vector<uint32_t> meshIDs = splitMeshSAH(*result.first, maxTriangles);
+        std::vector<uint32_t> rightMeshIDs = splitMeshSAH(*result.second, maxTriangles);
+        meshIDs.insert(meshIDs.end(), rightMeshIDs.begin(), rightMeshIDs.end());
+        return meshIDs;
+    }
+
+    SceneBuilder::MeshGroupList SceneBuilder::splitMeshGroupSAH(MeshGroup& meshGroup, size_t maxTriangles)
+    {
+        // This function implements a recursive top-down builder that partitions a mesh group into groups within the triangle budget.
+        // The split planes minimize the surface area heuristic over the mesh bounds, so that spatially close meshes end up in the same group.
+        // Meshes that exceed the budget on their own are split along their own SAH planes first.
+
+        assert(!meshGroup.meshList.empty());
+        if (countTriangles(meshGroup) <= maxTriangles) return MeshGroupList{ std::move(meshGroup) };
+
+        if (meshGroup.isStatic)
+        {
+            std::vector<uint32_t> meshList;
+            for (auto meshID : meshGroup.meshList)
+            {
+                auto splitMeshIDs = splitMeshSAH(meshID, maxTriangles);
+                meshList.insert(meshList.end(), splitMeshIDs.begin(), splitMeshIDs.end());
+            }
+            meshGroup.meshList = std::move(meshList);
+        }
+        if (meshGroup.meshList.size() == 1) return MeshGroupList{ std::move(meshGroup) };
+
+        std::vector<AABB> meshBounds;
+        std::vector<size_t> meshWeights;
+        for (auto meshID : meshGroup.meshList)
+        {
+            meshBounds.push_back(mMeshes[meshID].boundingBox);
+            meshWeights.push_back(mMeshes[meshID].getTriangleCount());
+        }
+
+        std::vector<uint32_t> leftMeshes, rightMeshes;
+        SAHSplit split = findSAHSplit(meshBounds, meshWeights);
+        if (split.axis >= 0)
+        {
+            for (auto meshID : meshGroup.meshList)
+            {
+                if (mMeshes[meshID].boundingBox.center()[split.axis] < split.pos) leftMeshes.push_back(meshID);
+                else rightMeshes.push_back(meshID);
+            }
+        }
+
+        // If no valid split was found (e.g. all mesh centroids coincide), fall back on splitting the mesh list in the middle.
+        if (leftMeshes.empty() || rightMeshes.empty())
+        {
+            auto mid = meshGroup.meshList.begin() + meshGroup.meshList.size() / 2;
+            leftMeshes.assign(meshGroup.meshList.begin(), mid);
+            rightMeshes.assign(mid, meshGroup.meshList.end());
+        }
+        assert(!leftMeshes.empty() && !rightMeshes.empty());
+
+        // Recursively split the left and right mesh groups.
+        MeshGroup leftGroup{ std::move(leftMeshes), meshGroup.isStatic };
+        MeshGroup rightGroup{ std::move(rightMeshes), meshGroup.isStatic };
+
+        MeshGroupList leftList = splitMeshGroupSAH(leftGroup, maxTriangles);
+        MeshGroupList rightList = splitMeshGroupSAH(rightGroup, maxTriangles);
 
         // Move elements into a single list and return.
         leftList.insert(
@@ -1366,6 +1648,22 @@ namespace Falcor
         return leftList;
     }
 
+    float SceneBuilder::estimateTraversalCost(const MeshGroup& sourceGroup, const MeshGroupList& groups) const
+    {
+        // Estimate the expected cost of a ray that intersects the bounds of the source group, when its geometry is stored in the given groups.
+        // The probability of entering a group is the ratio of surface areas. The cost within a group grows with the depth of its BLAS.
+        // Overlapping groups are entered by more rays, which increases the cost.
+        const float sourceArea = std::max(calculateBoundingBox(sourceGroup).area(), std::numeric_limits<float>::min());
+
+        float cost = 0.f;
+        for (const auto& group : groups)
+        {
+            float probability = calculateBoundingBox(group).area() / sourceArea;
+            cost += probability * (kBLASEntryCost + std::log2(1.f + (float)countTriangles(group)));
+        }
+        return cost;
+    }
+
     void SceneBuilder::optimizeGeometry()
     {
         // This function optimizes the geometry for raytracing performance and memory usage.
@@ -1379,13 +1677,27 @@ namespace Falcor
         //  - Split large meshes into smaller to reduce spatial overlap between BLASes.
         //  - Sort meshes into BLASes based on spatial locality.
 
+        //
+        // By default, groups are split with SAH. Both strategies split to the same triangle budget (see setMaxTrianglesPerBLAS()),
+        // so the estimated traversal cost stored in the scene stats can be used to compare them.
+
+        const bool useSAH = !is_set(mFlags, Flags::RTMidpointMeshGroupSplit);
+        const size_t maxTriangles = mMaxTrianglesPerBLAS;
+
         MeshGroupList optimizedGroups;
+        mMeshGroupTraversalCost = 0.f;
 
         for (auto& meshGroup : mMeshGroups)
         {
-            //auto groups = splitMeshGroupSimple(meshGroup);
-            //auto groups = splitMeshGroupMedian(meshGroup);
-            auto groups = splitMeshGroupMidpointMeshes(meshGroup);
+            //auto groups = splitMeshGroupSimple(meshGroup, maxTriangles);
+            //auto groups = splitMeshGroupMedian(meshGroup, maxTriangles);
+            const bool isStatic = meshGroup.isStatic;
+            auto groups = useSAH ? splitMeshGroupSAH(meshGroup, maxTriangles) : splitMeshGroupMidpointMeshes(meshGroup, maxTriangles);
+
+            // Meshes may have been split, so the cost is computed against the union of the resulting meshes.
+            MeshGroup splitSourceGroup{ {}, isStatic };
+            for (const auto& group : groups) splitSourceGroup.meshList.insert(splitSourceGroup.meshList.end(), group.meshList.begin(), group.meshList.end());
+            mMeshGroupTraversalCost += estimateTraversalCost(splitSourceGroup, groups);
 
             if (groups.size() > 1) logWarning("SceneBuilder::optimizeGeometry() performance warning - Mesh group was split into " + std::to_string(groups.size()) + " groups");
 
@@ -1398,6 +1710,80 @@ namespace Falcor
         mMeshGroups = std::move(optimizedGroups);
     }
 
+    void SceneBuilder::generateMeshLODs()
+    {
+        if (is_set(mFlags, Flags::NonIndexedVertices))
+        {
+            logWarning("Mesh LODs are not supported with non-indexed vertices. Skipping LOD generation.");
+            return;
+        }
+
+        // Simplify the meshes in parallel. Each LOD is simplified from the previous level, so its error is the sum of the
+        // errors along the chain. The LODs reference the mesh vertices, so only index data is added.
+        std::vector<float> meshRadius(mMeshes.size(), 0.f);
+        std::atomic<uint64_t> simplifiedTriangleCount = 0;
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        auto meshIDs = NumericRange<uint32_t>(0, (uint32_t)mMeshes.size());
+        std::for_each(std::execution::par, meshIDs.begin(), meshIDs.end(), [&](uint32_t meshID)
+        {
+            auto& mesh = mMeshes[meshID];
+            if (mesh.topology != Vao::Topology::TriangleList || mesh.indexCount == 0 || mesh.getTriangleCount() < kMinLODTriangleCount) return;
+
+            AABB bounds;
+            std::vector<float3> positions(mesh.staticData.size());
+            for (size_t i = 0; i < positions.size(); i++) bounds.include(positions[i] = mesh.staticData[i].position);
+            meshRadius[meshID] = bounds.radius();
+
+            std::vector<uint32_t> indices(mesh.indexCount);
+            for (uint32_t i = 0; i < mesh.indexCount; i++) indices[i] = mesh.getIndex(i);
+
+            const float maxError = kMaxLODRelativeError * meshRadius[meshID];
+            float error = 0.f;
+            while (mesh.lods.size() < kMaxLODCount && indices.size() / 3 >= kMinLODTriangleCount)
+            {
+                const size_t targetIndexCount = (size_t)(indices.size() / 3 * kLODReductionFactor) * 3;
+                auto result = MeshSimplifier::simplify(positions.data(), positions.size(), indices, targetIndexCount, std::max(0.f, maxError - error));
+                simplifiedTriangleCount += indices.size() / 3;
+                if (result.indices.empty() || result.indices.size() > indices.size() * kMaxLODTriangleRatio) break;
+
+                error += result.error;
+                indices = std::move(result.indices);
+
+                MeshSpec::LODSpec lod;
+                lod.indexCount = (uint32_t)indices.size();
+                lod.indexData = mesh.use16BitIndices ? compact16BitIndices(indices) : indices;
+                lod.error = error;
+                mesh.lods.push_back(std::move(lod));
+            }
+        });
+        const double seconds = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) * 1e-3;
+
+        // Report the simplification throughput and the triangle count and largest relative error per level.
+        std::vector<uint64_t> levelTriangleCount(kMaxLODCount, 0);
+        std::vector<float> levelMaxError(kMaxLODCount, 0.f);
+        uint32_t meshCount = 0, lodCount = 0;
+        for (size_t meshID = 0; meshID < mMeshes.size(); meshID++)
+        {
+            const auto& lods = mMeshes[meshID].lods;
+            if (!lods.empty()) meshCount++;
+            for (size_t level = 0; level < lods.size(); level++)
+            {
+                lodCount++;
+                levelTriangleCount[level] += lods[level].indexCount / 3;
+                if (meshRadius[meshID] > 0.f) levelMaxError[level] = std::max(levelMaxError[level], lods[level].error / meshRadius[meshID]);
+            }
+        }
+
+        std::ostringstream msg;
+        msg << "Generated " << lodCount << " LODs for " << meshCount << " meshes in " << std::fixed << std::setprecision(2) << seconds << " s ("
+            << (seconds > 0.0 ? simplifiedTriangleCount / seconds * 1e-6 : 0.0) << " Mtriangles/s simplified).";
+        for (uint32_t level = 0; level < kMaxLODCount && levelTriangleCount[level] > 0; level++)
+        {
+            msg << "\n  LOD " << level + 1 << ": " << levelTriangleCount[level] << " triangles, max error " << std::setprecision(4) << levelMaxError[level] << " of mesh radius";
+        }
+        logInfo(msg.str());
+    }
+
     void SceneBuilder::createGlobalBuffers()
     {
         assert(mBuffersData.indexData.empty());
@@ -1414,6 +1800,7 @@ namespace Falcor
         for (const auto& mesh : mMeshes)
         {
             totalIndexDataCount += mesh.indexData.size();
+            for (const auto& lod : mesh.lods) totalIndexDataCount += lod.indexData.size();
             totalStaticVertexCount += mesh.staticData.size();
             totalDynamicVertexCount += mesh.dynamicData.size();
         }
@@ -1444,6 +1831,14 @@ namespace Falcor
             {
                 mesh.indexOffset = (uint32_t)mBuffersData.indexData.size();
                 mBuffersData.indexData.insert(mBuffersData.indexData.end(), mesh.indexData.begin(), mesh.indexData.end());
+
+                // The LODs follow the mesh indices. They use the same index format and vertices.
+                for (auto& lod : mesh.lods)
+                {
+                    lod.indexOffset = (uint32_t)mBuffersData.indexData.size();
+                    mBuffersData.indexData.insert(mBuffersData.indexData.end(), lod.indexData.begin(), lod.indexData.end());
+                    std::vector<uint32_t>().swap(lod.indexData);
+                }
             }
 
             if (!mesh.dynamicData.empty())
@@ -1457,10 +1852,11 @@ namespace Falcor
                 }
             }
 
-            // Free the mesh local data.
-            mesh.indexData.clear();
-            mesh.staticData.clear();
-            mesh.dynamicData.clear();
+            // Free the mesh local data. Swapping with empty vectors releases the memory, which clear() would keep allocated.
+            // This bounds the peak memory to the global buffers plus the not yet copied meshes.
+            std::vector<uint32_t>().swap(mesh.indexData);
+            std::vector<StaticVertexData>().swap(mesh.staticData);
+            std::vector<DynamicVertexData>().swap(mesh.dynamicData);
         }
     }
 
@@ -1626,15 +2022,21 @@ namespace Falcor
         }
 
         // Create the vertex data structured buffer.
+        // With compressed vertices, the buffer is initialized here. Otherwise the animation controller initializes it.
+        const bool compressed = mpScene->mHasCompressedVertices;
         const size_t vertexCount = (uint32_t)mBuffersData.staticData.size();
-        size_t staticVbSize = sizeof(PackedStaticVertexData) * vertexCount;
+        const size_t vertexStride = compressed ? sizeof(CompressedStaticVertexData) : sizeof(PackedStaticVertexData);
+        size_t staticVbSize = vertexStride * vertexCount;
         if (staticVbSize > std::numeric_limits<uint32_t>::max())
         {
             throw std::exception("Vertex buffer size exceeds 4GB");
         }
 
+        std::vector<CompressedStaticVertexData> compressedData;
+        if (compressed) compressedData = createCompressedVertexData();
+
         ResourceBindFlags vbBindFlags = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess | ResourceBindFlags::Vertex;
-        Buffer::SharedPtr pStaticBuffer = Buffer::createStructured(sizeof(PackedStaticVertexData), (uint32_t)vertexCount, vbBindFlags, Buffer::CpuAccess::None, nullptr, false);
+        Buffer::SharedPtr pStaticBuffer = Buffer::createStructured((uint32_t)vertexStride, (uint32_t)vertexCount, vbBindFlags, Buffer::CpuAccess::None, compressed ? compressedData.data() : nullptr, false);
 
         Vao::BufferVec pVBs(Scene::kVertexBufferCount);
         pVBs[Scene::kStaticDataBufferIndex] = pStaticBuffer;
@@ -1667,10 +2069,20 @@ namespace Falcor
         VertexLayout::SharedPtr pLayout = VertexLayout::create();
 
         // Add the packed static vertex data layout.
+        // For compressed vertices the position and normal/tangent are passed as raw data and decoded in the vertex shader (see VSIn in Raster.slang).
         VertexBufferLayout::SharedPtr pStaticLayout = VertexBufferLayout::create();
-        pStaticLayout->addElement(VERTEX_POSITION_NAME, offsetof(PackedStaticVertexData, position), ResourceFormat::RGB32Float, 1, VERTEX_POSITION_LOC);
-        pStaticLayout->addElement(VERTEX_PACKED_NORMAL_TANGENT_NAME, offsetof(PackedStaticVertexData, packedNormalTangent), ResourceFormat::RGB32Float, 1, VERTEX_PACKED_NORMAL_TANGENT_LOC);
-        pStaticLayout->addElement(VERTEX_TEXCOORD_NAME, offsetof(PackedStaticVertexData, texCrd), ResourceFormat::RG32Float, 1, VERTEX_TEXCOORD_LOC);
+        if (compressed)
+        {
+            pStaticLayout->addElement(VERTEX_POSITION_NAME, offsetof(CompressedStaticVertexData, packedPosition), ResourceFormat::RG32Uint, 1, VERTEX_POSITION_LOC);
+            pStaticLayout->addElement(VERTEX_PACKED_NORMAL_TANGENT_NAME, offsetof(CompressedStaticVertexData, packedNormal), ResourceFormat::RG32Uint, 1, VERTEX_PACKED_NORMAL_TANGENT_LOC);
+            pStaticLayout->addElement(VERTEX_TEXCOORD_NAME, offsetof(CompressedStaticVertexData, packedTexCrd), ResourceFormat::RG16Float, 1, VERTEX_TEXCOORD_LOC);
+        }
+        else
+        {
+            pStaticLayout->addElement(VERTEX_POSITION_NAME, offsetof(PackedStaticVertexData, position), ResourceFormat::RGB32Float, 1, VERTEX_POSITION_LOC);
+            pStaticLayout->addElement(VERTEX_PACKED_NORMAL_TANGENT_NAME, offsetof(PackedStaticVertexData, packedNormalTangent), ResourceFormat::RGB32Float, 1, VERTEX_PACKED_NORMAL_TANGENT_LOC);
+            pStaticLayout->addElement(VERTEX_TEXCOORD_NAME, offsetof(PackedStaticVertexData, texCrd), ResourceFormat::RG32Float, 1, VERTEX_TEXCOORD_LOC);
+        }
         pLayout->addBufferLayout(Scene::kStaticDataBufferIndex, pStaticLayout);
 
         // Add the draw ID layout.
@@ -1687,6 +2099,27 @@ namespace Falcor
         mpScene->mpVao16Bit = Vao::create(mMeshes[0].topology, pLayout, pVBs, pIB, ResourceFormat::R16Uint);
     }
 
+    std::vector<CompressedStaticVertexData> SceneBuilder::createCompressedVertexData() const
+    {
+        assert(mpScene->mHasCompressedVertices);
+        std::vector<CompressedStaticVertexData> compressedData(mBuffersData.staticData.size());
+
+        for (uint32_t meshID = 0; meshID < mMeshes.size(); meshID++)
+        {
+            // The positions are quantized relative to the mesh bounds. The same parameters are used for decoding (see MeshDesc).
+            const auto& mesh = mMeshes[meshID];
+            const auto& meshDesc = mpScene->mMeshDesc[meshID];
+
+            for (uint32_t i = 0; i < mesh.staticVertexCount; i++)
+            {
+                const uint32_t index = mesh.staticVertexOffset + i;
+                compressedData[index].pack(mBuffersData.staticData[index].unpack(), meshDesc.positionOrigin, meshDesc.positionScale);
+            }
+        }
+
+        return compressedData;
+    }
+
     uint32_t SceneBuilder::createMeshData()
     {
         assert(mpScene->mMeshDesc.empty());
@@ -1694,13 +2127,24 @@ namespace Falcor
         assert(mpScene->mMeshHasDynamicData.empty());
         assert(mpScene->mMeshIdToInstanceIds.empty());
         assert(mpScene->mMeshGroups.empty());
+        assert(mpScene->mMeshLODs.empty());
 
         auto& meshData = mpScene->mMeshDesc;
         auto& instanceData = mpScene->mMeshInstanceData;
         meshData.resize(mMeshes.size());
         mpScene->mMeshHasDynamicData.resize(mMeshes.size());
+        mpScene->mMeshLODs.resize(mMeshes.size());
         size_t drawCount = 0;
 
+        // Check if the compressed vertex format can be used.
+        // Skinning writes the vertex buffer in the default format, and the BLAS build needs 16-bit unorm vertex positions.
+        if (is_set(mFlags, Flags::UseCompressedVertices))
+        {
+            if (!mBuffersData.dynamicData.empty()) logWarning("Compressed vertices are not supported for scenes with skinned meshes. Using the default vertex format.");
+            else if (!gpDevice->isFeatureSupported(Device::SupportedFeatures::RaytracingTier1_1)) logWarning("Compressed vertices require DirectX Raytracing Tier 1.1. Using the default vertex format.");
+            else mpScene->mHasCompressedVertices = true;
+        }
+
         // Setup all mesh data.
         for (uint32_t meshID = 0; meshID < mMeshes.size(); meshID++)
         {
@@ -1712,6 +2156,9 @@ namespace Falcor
             meshData[meshID].indexCount = mesh.indexCount;
             meshData[meshID].dynamicVbOffset = mesh.hasDynamicData ? mesh.dynamicVertexOffset : 0;
             assert(mesh.dynamicVertexCount == 0 || mesh.dynamicVertexCount == mesh.staticVertexCount);
+            meshData[meshID].positionOrigin = mesh.boundingBox.valid() ? mesh.boundingBox.minPoint : float3(0.f);
+            meshData[meshID].positionScale = mesh.boundingBox.valid() ? mesh.boundingBox.extent() : float3(0.f);
+            for (const auto& lod : mesh.lods) mpScene->mMeshLODs[meshID].push_back({ lod.indexOffset, lod.indexCount, lod.error });
 
             mpScene->mMeshNames.push_back(mesh.name);
 
@@ -1957,6 +2404,82 @@ namespace Falcor
         }
     }
 
+    void SceneBuilder::createCpuBVH()
+    {
+        // Gather the mesh geometry in the same layout as the GPU buffers, with indices expanded to 32 bits.
+        SceneBVH::Geometry geometry;
+        geometry.positions.reserve(mBuffersData.staticData.size());
+        for (const auto& v : mBuffersData.staticData) geometry.positions.push_back(v.position);
+
+        geometry.meshes.resize(mMeshes.size());
+        for (size_t meshID = 0; meshID < mMeshes.size(); meshID++)
+        {
+            const auto& mesh = mMeshes[meshID];
+            auto& desc = geometry.meshes[meshID];
+            desc.vertexOffset = mesh.staticVertexOffset;
+            desc.triangleCount = mesh.getTriangleCount();
+            desc.isIndexed = mesh.indexCount > 0;
+            if (!desc.isIndexed) continue;
+
+            desc.indexOffset = (uint32_t)geometry.indices.size();
+            const uint32_t* pIndexData = mBuffersData.indexData.data() + mesh.indexOffset;
+            for (uint32_t i = 0; i < mesh.indexCount; i++)
+            {
+                geometry.indices.push_back(mesh.use16BitIndices ? reinterpret_cast<const uint16_t*>(pIndexData)[i] : pIndexData[i]);
+            }
+        }
+
+        geometry.instances.resize(mpScene->mMeshInstanceData.size());
+        for (size_t instanceID = 0; instanceID < mpScene->mMeshInstanceData.size(); instanceID++)
+        {
+            geometry.instances[instanceID].meshID = mpScene->mMeshInstanceData[instanceID].meshID;
+            geometry.instances[instanceID].matrixID = mpScene->mMeshInstanceData[instanceID].globalMatrixID;
+        }
+
+        mpScene->mpCpuBVH = SceneBVH::create(std::move(geometry), mpScene->mpAnimationController->getGlobalMatrices());
+
+        const auto& stats = mpScene->mpCpuBVH->getStats();
+        logInfo("Built CPU BVH with " + std::to_string(stats.nodeCount) + " nodes over " + std::to_string(stats.triangleCount) + " triangles (" + formatByteSize(stats.memoryInBytes) + ").");
+    }
+
+    void SceneBuilder::createMeshlets()
+    {
+        // Gather the mesh geometry in the same layout as the GPU buffers, with indices expanded to 32 bits.
+        SceneMeshlets::Geometry geometry;
+        geometry.positions.reserve(mBuffersData.staticData.size());
+        for (const auto& v : mBuffersData.staticData) geometry.positions.push_back(v.position);
+
+        geometry.meshes.resize(mMeshes.size());
+        for (size_t meshID = 0; meshID < mMeshes.size(); meshID++)
+        {
+            const auto& mesh = mMeshes[meshID];
+            auto& desc = geometry.meshes[meshID];
+            desc.vertexOffset = mesh.staticVertexOffset;
+            desc.vertexCount = mesh.staticVertexCount;
+            desc.triangleCount = mesh.getTriangleCount();
+            desc.isIndexed = mesh.indexCount > 0;
+            desc.isFrontFaceCW = mesh.isFrontFaceCW;
+            if (!desc.isIndexed) continue;
+
+            desc.indexOffset = (uint32_t)geometry.indices.size();
+            const uint32_t* pIndexData = mBuffersData.indexData.data() + mesh.indexOffset;
+            for (uint32_t i = 0; i < mesh.indexCount; i++)
+            {
+                geometry.indices.push_back(mesh.use16BitIndices ? reinterpret_cast<const uint16_t*>(pIndexData)[i] : pIndexData[i]);
+            }
+        }
+
+        mpScene->mpMeshlets = SceneMeshlets::create(geometry);
+
+        const auto& stats = mpScene->mpMeshlets->getStats();
+        std::ostringstream msg;
+        msg << std::fixed << std::setprecision(1);
+        msg << "Generated " << stats.meshletCount << " meshlets over " << stats.triangleCount << " triangles (" << formatByteSize(stats.memoryInBytes) << "). ";
+        msg << "Average " << stats.avgVertexCount << " vertices and " << stats.avgTriangleCount << " triangles per meshlet, ";
+        msg << stats.coneCullableCount << " meshlets with normal cones.";
+        logInfo(msg.str());
+    }
+
     void SceneBuilder::calculateCurveBoundingBoxes()
     {
         // Calculate curve bounding boxes.
@@ -2011,6 +2534,12 @@ namespace Falcor
         flags.value("Force32BitIndices", SceneBuilder::Flags::Force32BitIndices);
         flags.value("RTDontMergeStatic", SceneBuilder::Flags::RTDontMergeStatic);
         flags.value("RTDontMergeDynamic", SceneBuilder::Flags::RTDontMergeDynamic);
+        flags.value("BuildCpuBVH", SceneBuilder::Flags::BuildCpuBVH);
+        flags.value("RTMidpointMeshGroupSplit", SceneBuilder::Flags::RTMidpointMeshGroupSplit);
+        flags.value("UseCompressedVertices", SceneBuilder::Flags::UseCompressedVertices);
+        flags.value("GenerateMeshlets", SceneBuilder::Flags::GenerateMeshlets);
+        flags.value("GenerateLODs", SceneBuilder::Flags::GenerateLODs);
+        flags.value("DetectInstances", SceneBuilder::Flags::DetectInstances);
         ScriptBindings::addEnumBinaryOperators(flags);
 
         pybind11::class_<SceneBuilder, SceneBuilder::SharedPtr> sceneBuilder(m, "SceneBuilder");
@@ -2024,6 +2553,7 @@ namespace Falcor
         sceneBuilder.def_property("envMap", &SceneBuilder::getEnvMap, &SceneBuilder::setEnvMap);
         sceneBuilder.def_property("selectedCamera", &SceneBuilder::getSelectedCamera, &SceneBuilder::setSelectedCamera);
         sceneBuilder.def_property("cameraSpeed", &SceneBuilder::getCameraSpeed, &SceneBuilder::setCameraSpeed);
+        sceneBuilder.def_property("maxTrianglesPerBLAS", &SceneBuilder::getMaxTrianglesPerBLAS, &SceneBuilder::setMaxTrianglesPerBLAS);
         sceneBuilder.def("importScene", [] (SceneBuilder* pSceneBuilder, const std::string& filename, const pybind11::dict& dict, const std::vector<Transform>& instances) {
             SceneBuilder::InstanceMatrices instanceMatrices;
             for (const auto& instance : instances)
@@ -61,6 +61,12 @@ namespace Falcor
             Force32BitIndices           = 0x80,   ///< Force 32-bit indices for all meshes. By default, 16-bit indices are used for small meshes.
             RTDontMergeStatic           = 0x100,  ///< For raytracing, don't merge all static meshes into single pre-transformed BLAS.
             RTDontMergeDynamic          = 0x200,  ///< For raytracing, don't merge all dynamic meshes with identical transforms into single BLAS.
+            BuildCpuBVH                 = 0x400,  ///< Build a CPU ray tracing acceleration structure, see Scene::getCpuBVH(). This keeps a CPU copy of the mesh positions and indices.
+            RTMidpointMeshGroupSplit    = 0x800,  ///< For raytracing, split large mesh groups at the spatial midpoint instead of using SAH. Use the 'meshGroupTraversalCost' scene stat to compare the strategies.
+            UseCompressedVertices       = 0x1000, ///< Store vertices in the compact CompressedStaticVertexData format (20B instead of 32B). Positions are quantized to 16 bits relative to the mesh bounds. Not supported for skinned meshes.
+            GenerateMeshlets            = 0x2000, ///< Partition the meshes into meshlets with bounding spheres and normal cones, see Scene::getMeshlets(). This keeps a CPU copy of the meshlet data.
+            GenerateLODs                = 0x4000, ///< Generate simplified levels of detail for indexed triangle meshes, see Scene::getMeshLODs(). The LODs share the mesh vertices and add index data only.
+            DetectInstances             = 0x8000, ///< Detect static meshes that are rigidly transformed copies of each other (e.g. with the transform baked into the vertices) and convert them into instances of a single mesh.
 
             Default = None
         };
@@ -238,6 +244,11 @@ namespace Falcor
 
         static const uint32_t kInvalidNode = Scene::kInvalidNode;
 
+        /** Default triangle budget per mesh group (BLAS) for ray tracing.
+            16M triangles is approx 0.5GB post-compaction.
+        */
+        static const size_t kDefaultMaxTrianglesPerBLAS = 1ull << 24;
+
         struct Node
         {
             std::string name;
@@ -276,6 +287,17 @@ namespace Falcor
         */
         Flags getFlags() const { return mFlags; }
 
+        /** Set the triangle budget per mesh group (BLAS) for ray tracing.
+            Larger mesh groups are split until they are within the budget, using the strategy selected by the build flags.
+            Note that this is not a strict limit, as some meshes cannot be split.
+            \param[in] maxTriangles Max triangles per BLAS. Must be larger than zero.
+        */
+        void setMaxTrianglesPerBLAS(size_t maxTriangles);
+
+        /** Get the triangle budget per mesh group (BLAS) for ray tracing.
+        */
+        size_t getMaxTrianglesPerBLAS() const { return mMaxTrianglesPerBLAS; }
+
         /** Set the render settings.
         */
         void setRenderSettings(const Scene::RenderSettings& renderSettings) { mRenderSettings = renderSettings; }
@@ -317,6 +339,13 @@ namespace Falcor
         */
         uint32_t addProcessedMesh(const ProcessedMesh& mesh);
 
+        /** Add a pre-processed mesh, taking ownership of its data.
+            This avoids copying the vertex and index data, which reduces peak memory usage when importing large scenes.
+            \param mesh The pre-processed mesh.
+            \return The ID of the mesh in the scene. Note that all of the instances share the same mesh ID.
+        */
+        uint32_t addProcessedMesh(ProcessedMesh&& mesh);
+
         // Procedural primitives, including custom primitives, curves, etc.
 
         // Custom primitives
@@ -529,6 +558,15 @@ namespace Falcor
             std::vector<StaticVertexData> staticData;
             std::vector<DynamicVertexData> dynamicData;
 
+            struct LODSpec
+            {
+                std::vector<uint32_t> indexData; ///< Vertex indices in the same format as the mesh 'indexData'.
+                uint32_t indexOffset = 0;       ///< Offset into the shared 'indexData' array. This is calculated in createGlobalBuffers().
+                uint32_t indexCount = 0;        ///< Number of indices.
+                float error = 0.f;              ///< Geometric error relative to the original mesh in object space.
+            };
+            std::vector<LODSpec> lods;          ///< Simplified levels of detail from finest to coarsest. These are generated in generateMeshLODs().
+
             uint32_t getTriangleCount() const
             {
                 assert(topology == Vao::Topology::TriangleList);
@@ -591,6 +629,8 @@ namespace Falcor
 
         MeshList mMeshes;
         MeshGroupList mMeshGroups; ///< Groups of meshes. Each group represents all the geometries in a BLAS for ray tracing.
+        size_t mMaxTrianglesPerBLAS = kDefaultMaxTrianglesPerBLAS; ///< Triangle budget per mesh group (BLAS) used by optimizeGeometry().
+        float mMeshGroupTraversalCost = 0.f; ///< Estimated traversal cost of the mesh groups, computed in optimizeGeometry().
 
         std::vector<ProceduralPrimitiveData> mProceduralPrimitives;           ///< GPU Data struct of procedural primitive metadata.
         std::unordered_map<uint32_t, uint32_t> mProceduralPrimInstanceCount;  ///< Map typeId to instance count.
@@ -624,17 +664,23 @@ namespace Falcor
         // Mesh group helpers
         size_t countTriangles(const MeshGroup& meshGroup) const;
         AABB calculateBoundingBox(const MeshGroup& meshGroup) const;
-        bool needsSplit(const MeshGroup& meshGroup, size_t& triangleCount) const;
-        MeshGroupList splitMeshGroupSimple(MeshGroup& meshGroup) const;
-        MeshGroupList splitMeshGroupMedian(MeshGroup& meshGroup) const;
-        MeshGroupList splitMeshGroupMidpointMeshes(MeshGroup& meshGroup);
+        bool needsSplit(const MeshGroup& meshGroup, size_t maxTriangles, size_t& triangleCount) const;
+        MeshGroupList splitMeshGroupSimple(MeshGroup& meshGroup, size_t maxTriangles) const;
+        MeshGroupList splitMeshGroupMedian(MeshGroup& meshGroup, size_t maxTriangles) const;
+        MeshGroupList splitMeshGroupMidpointMeshes(MeshGroup& meshGroup, size_t maxTriangles);
+        MeshGroupList splitMeshGroupSAH(MeshGroup& meshGroup, size_t maxTriangles);
+        std::vector<uint32_t> splitMeshSAH(uint32_t meshID, size_t maxTriangles);
+        float estimateTraversalCost(const MeshGroup& sourceGroup, const MeshGroupList& groups) const;
 
         // Post processing
         void removeUnusedMeshes();
+        void removeMeshesWithoutInstances();
+        void detectInstances();
         void pretransformStaticMeshes();
         void calculateMeshBoundingBoxes();
         void createMeshGroups();
         void optimizeGeometry();
+        void generateMeshLODs();
         void createGlobalBuffers();
         void createCurveGlobalBuffers();
         void removeDuplicateMaterials();
@@ -644,6 +690,7 @@ namespace Falcor
         // Scene setup
         uint32_t createMeshData();
         void createMeshVao(uint32_t drawCount);
+        std::vector<CompressedStaticVertexData> createCompressedVertexData() const;
         void createCurveData();
         void createCurveVao();
         void mapCurvesToProceduralPrimitives(uint32_t typeID);
@@ -651,6 +698,8 @@ namespace Falcor
         void createNodeList();
         void createMeshBoundingBoxes();
         void calculateCurveBoundingBoxes();
+        void createCpuBVH();
+        void createMeshlets();
 
         void pushProceduralPrimitive(uint32_t typeID, uint32_t instanceIdx, uint32_t AABBOffset, uint32_t AABBCount);
     };
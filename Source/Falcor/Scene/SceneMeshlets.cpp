@@ -0,0 +1,377 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "SceneMeshlets.h"
+#include <execution>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kInvalidIndex = 0xffffffff;
+        const uint32_t kFallbackCandidateCount = 16;    ///< Number of unassigned triangles considered when a meshlet has no connected triangles left.
+        const float kMinConeCosine = 0.1f;              ///< Normal cones wider than this are treated as degenerate, as they would rarely cull anything.
+
+        struct MeshletList
+        {
+            std::vector<SceneMeshlets::Meshlet> meshlets;
+            std::vector<uint32_t> vertices;
+            std::vector<uint32_t> triangles;
+        };
+
+        /** Compute the bounding sphere and normal cone of a meshlet.
+        */
+        void computeBounds(SceneMeshlets::Meshlet& meshlet, const float3* positions, const uint32_t* vertices, const uint32_t* triangles, bool isFrontFaceCW)
+        {
+            AABB bounds;
+            for (uint32_t i = 0; i < meshlet.vertexCount; i++) bounds.include(positions[vertices[i]]);
+            meshlet.center = bounds.center();
+            meshlet.radius = 0.f;
+            for (uint32_t i = 0; i < meshlet.vertexCount; i++) meshlet.radius = std::max(meshlet.radius, glm::length(positions[vertices[i]] - meshlet.center));
+
+            // Front-facing triangle normals. Degenerate triangles don't affect the cone.
+            auto getNormal = [&](uint32_t t, float3& p0)
+            {
+                uint3 tri = SceneMeshlets::unpackTriangle(triangles[t]);
+                p0 = positions[vertices[tri.x]];
+                float3 n = glm::cross(positions[vertices[tri.y]] - p0, positions[vertices[tri.z]] - p0);
+                float len = glm::length(n);
+                if (len == 0.f) return float3(0.f);
+                return (isFrontFaceCW ? -n : n) / len;
+            };
+
+            float3 p0;
+            float3 axis = float3(0.f);
+            for (uint32_t t = 0; t < meshlet.triangleCount; t++) axis += getNormal(t, p0);
+
+            meshlet.coneApex = meshlet.center;
+            meshlet.coneCutoff = 1.f;
+            float axisLength = glm::length(axis);
+            if (axisLength == 0.f)
+            {
+                meshlet.coneAxis = float3(0.f, 0.f, 1.f);
+                return;
+            }
+            meshlet.coneAxis = axis / axisLength;
+
+            float minDot = 1.f;
+            for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+            {
+                float3 n = getNormal(t, p0);
+                if (n != float3(0.f)) minDot = std::min(minDot, glm::dot(n, meshlet.coneAxis));
+            }
+            if (minDot <= kMinConeCosine) return;
+
+            // Move the apex back along the axis until it is behind all triangle planes. A viewer in front of
+            // any triangle then sees the apex at an angle of less than 90 degrees minus the cone half angle.
+            float maxT = -std::numeric_limits<float>::max();
+            for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+            {
+                float3 n = getNormal(t, p0);
+                if (n == float3(0.f)) continue;
+                maxT = std::max(maxT, glm::dot(meshlet.center - p0, n) / glm::dot(meshlet.coneAxis, n));
+            }
+            meshlet.coneApex = meshlet.center - meshlet.coneAxis * maxT;
+            meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+        }
+
+        /** Partition a mesh into meshlets.
+            Triangles are added greedily to the current meshlet, preferring connected triangles that add the fewest
+            new vertices and, among those, the one closest to the meshlet centroid.
+        */
+        MeshletList buildMeshlets(const SceneMeshlets::Geometry& g, uint32_t meshID, const SceneMeshlets::Options& options)
+        {
+            const auto& mesh = g.meshes[meshID];
+            const float3* positions = g.positions.data() + mesh.vertexOffset;
+            const uint32_t triangleCount = mesh.triangleCount;
+            const uint32_t vertexCount = mesh.isIndexed ? mesh.vertexCount : 3 * triangleCount;
+
+            auto getIndex = [&](uint32_t t, uint32_t k) { return mesh.isIndexed ? g.indices[mesh.indexOffset + 3 * t + k] : 3 * t + k; };
+
+            // Build the vertex to triangle adjacency in compressed row format.
+            std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+            for (uint32_t t = 0; t < triangleCount; t++)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    uint32_t v = getIndex(t, k);
+                    if (v >= vertexCount) throw std::exception("SceneMeshlets::create() - mesh index out of range");
+                    adjacencyOffsets[v + 1]++;
+                }
+            }
+            std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+            std::vector<uint32_t> adjacency(3 * (size_t)triangleCount);
+            std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t t = 0; t < triangleCount; t++)
+            {
+                for (uint32_t k = 0; k < 3; k++) adjacency[cursor[getIndex(t, k)]++] = t;
+            }
+
+            std::vector<float3> triangleCenters(triangleCount);
+            for (uint32_t t = 0; t < triangleCount; t++) triangleCenters[t] = (positions[getIndex(t, 0)] + positions[getIndex(t, 1)] + positions[getIndex(t, 2)]) / 3.f;
+
+            std::vector<uint8_t> emitted(triangleCount, 0);
+            std::vector<uint32_t> localIndex(vertexCount, kInvalidIndex);
+            std::vector<uint32_t> meshletVertices;
+            std::vector<uint32_t> meshletTriangles;
+            // Unassigned triangles connected to the current meshlet, and the index of the meshlet each triangle was last added as a candidate for.
+            std::vector<uint32_t> candidates;
+            std::vector<uint32_t> candidateMeshlet(triangleCount, kInvalidIndex);
+            float3 positionSum = float3(0.f);
+            uint32_t scanCursor = 0;
+
+            MeshletList result;
+
+            auto newVertexCount = [&](uint32_t t)
+            {
+                uint32_t a = getIndex(t, 0), b = getIndex(t, 1), c = getIndex(t, 2);
+                return (uint32_t)(localIndex[a] == kInvalidIndex) + (uint32_t)(localIndex[b] == kInvalidIndex && b != a) + (uint32_t)(localIndex[c] == kInvalidIndex && c != a && c != b);
+            };
+
+            auto distance2 = [&](uint32_t t, const float3& p)
+            {
+                float3 d = triangleCenters[t] - p;
+                return glm::dot(d, d);
+            };
+
+            auto finishMeshlet = [&]()
+            {
+                if (meshletTriangles.empty()) return;
+
+                SceneMeshlets::Meshlet meshlet;
+                meshlet.meshID = meshID;
+                meshlet.vertexOffset = (uint32_t)result.vertices.size();
+                meshlet.triangleOffset = (uint32_t)result.triangles.size();
+                meshlet.vertexCount = (uint32_t)meshletVertices.size();
+                meshlet.triangleCount = (uint32_t)meshletTriangles.size();
+                result.vertices.insert(result.vertices.end(), meshletVertices.begin(), meshletVertices.end());
+                result.triangles.insert(result.triangles.end(), meshletTriangles.begin(), meshletTriangles.end());
+                computeBounds(meshlet, positions, meshletVertices.data(), meshletTriangles.data(), mesh.isFrontFaceCW);
+                result.meshlets.push_back(meshlet);
+
+                for (uint32_t v : meshletVertices) localIndex[v] = kInvalidIndex;
+                meshletVertices.clear();
+                meshletTriangles.clear();
+                candidates.clear();
+                positionSum = float3(0.f);
+            };
+
+            for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+            {
+                const float3 centroid = meshletVertices.empty() ? float3(0.f) : positionSum / (float)meshletVertices.size();
+
+                // Find the best unassigned triangle connected to the current meshlet, dropping assigned candidates on the way.
+                uint32_t best = kInvalidIndex;
+                uint32_t bestNewVertexCount = 4;
+                float bestDistance = std::numeric_limits<float>::infinity();
+                size_t candidateCount = 0;
+                for (uint32_t t : candidates)
+                {
+                    if (emitted[t]) continue;
+                    candidates[candidateCount++] = t;
+                    uint32_t n = newVertexCount(t);
+                    if (n > bestNewVertexCount) continue;
+                    float d = distance2(t, centroid);
+                    if (n < bestNewVertexCount || d < bestDistance)
+                    {
+                        best = t;
+                        bestNewVertexCount = n;
+                        bestDistance = d;
+                    }
+                }
+                candidates.resize(candidateCount);
+
+                // If there is none, pick the closest of the next few unassigned triangles in index order.
+                if (best == kInvalidIndex)
+                {
+                    while (emitted[scanCursor]) scanCursor++;
+                    best = scanCursor;
+                    if (!meshletVertices.empty())
+                    {
+                        bestDistance = distance2(best, centroid);
+                        uint32_t count = 1;
+                        for (uint32_t t = scanCursor + 1; t < triangleCount && count < kFallbackCandidateCount; t++)
+                        {
+                            if (emitted[t]) continue;
+                            count++;
+                            float d = distance2(t, centroid);
+                            if (d < bestDistance)
+                            {
+                                best = t;
+                                bestDistance = d;
+                            }
+                        }
+                    }
+                }
+
+                if (meshletVertices.size() + newVertexCount(best) > options.maxVertices || meshletTriangles.size() + 1 > options.maxTriangles) finishMeshlet();
+
+                emitted[best] = 1;
+                const uint32_t meshletIndex = (uint32_t)result.meshlets.size();
+                uint32_t local[3];
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    uint32_t v = getIndex(best, k);
+                    if (localIndex[v] == kInvalidIndex)
+                    {
+                        localIndex[v] = (uint32_t)meshletVertices.size();
+                        meshletVertices.push_back(v);
+                        positionSum += positions[v];
+
+                        for (uint32_t i = adjacencyOffsets[v]; i < adjacencyOffsets[v + 1]; i++)
+                        {
+                            uint32_t t = adjacency[i];
+                            if (emitted[t] || candidateMeshlet[t] == meshletIndex) continue;
+                            candidateMeshlet[t] = meshletIndex;
+                            candidates.push_back(t);
+                        }
+                    }
+                    local[k] = localIndex[v];
+                }
+                meshletTriangles.push_back(SceneMeshlets::packTriangle(local[0], local[1], local[2]));
+            }
+            finishMeshlet();
+
+            return result;
+        }
+    }
+
+    SceneMeshlets::SharedPtr SceneMeshlets::create(const Geometry& geometry, const Options& options)
+    {
+        if (options.maxVertices < 3 || options.maxVertices > 256) throw std::exception("SceneMeshlets::create() - maxVertices must be in [3, 256]");
+        if (options.maxTriangles < 1) throw std::exception("SceneMeshlets::create() - maxTriangles must be at least 1");
+
+        SharedPtr pMeshlets = SharedPtr(new SceneMeshlets());
+        pMeshlets->mOptions = options;
+
+        // Partition the meshes. They are independent, so they are processed in parallel.
+        std::vector<MeshletList> lists(geometry.meshes.size());
+        auto meshIDs = NumericRange<uint32_t>(0, (uint32_t)geometry.meshes.size());
+        std::for_each(std::execution::par, meshIDs.begin(), meshIDs.end(), [&](uint32_t meshID)
+        {
+            lists[meshID] = buildMeshlets(geometry, meshID, options);
+        });
+
+        // Concatenate the per-mesh lists.
+        size_t meshletCount = 0, vertexCount = 0, triangleCount = 0;
+        for (const auto& list : lists)
+        {
+            meshletCount += list.meshlets.size();
+            vertexCount += list.vertices.size();
+            triangleCount += list.triangles.size();
+        }
+        pMeshlets->mMeshlets.reserve(meshletCount);
+        pMeshlets->mVertices.reserve(vertexCount);
+        pMeshlets->mTriangles.reserve(triangleCount);
+        pMeshlets->mMeshRanges.resize(lists.size());
+
+        for (size_t meshID = 0; meshID < lists.size(); meshID++)
+        {
+            auto& list = lists[meshID];
+            pMeshlets->mMeshRanges[meshID] = { (uint32_t)pMeshlets->mMeshlets.size(), (uint32_t)list.meshlets.size() };
+            for (auto meshlet : list.meshlets)
+            {
+                meshlet.vertexOffset += (uint32_t)pMeshlets->mVertices.size();
+                meshlet.triangleOffset += (uint32_t)pMeshlets->mTriangles.size();
+                pMeshlets->mMeshlets.push_back(meshlet);
+            }
+            pMeshlets->mVertices.insert(pMeshlets->mVertices.end(), list.vertices.begin(), list.vertices.end());
+            pMeshlets->mTriangles.insert(pMeshlets->mTriangles.end(), list.triangles.begin(), list.triangles.end());
+            list = MeshletList();
+        }
+
+        Stats& stats = pMeshlets->mStats;
+        stats.meshCount = (uint32_t)geometry.meshes.size();
+        stats.meshletCount = meshletCount;
+        stats.vertexCount = vertexCount;
+        stats.triangleCount = triangleCount;
+        double radiusSum = 0.0;
+        for (const auto& meshlet : pMeshlets->mMeshlets)
+        {
+            if (meshlet.coneCutoff < 1.f) stats.coneCullableCount++;
+            radiusSum += meshlet.radius;
+        }
+        if (meshletCount > 0)
+        {
+            stats.avgVertexCount = (float)vertexCount / meshletCount;
+            stats.avgTriangleCount = (float)triangleCount / meshletCount;
+            stats.avgRadius = (float)(radiusSum / meshletCount);
+        }
+        stats.memoryInBytes = meshletCount * sizeof(Meshlet) + (vertexCount + triangleCount) * sizeof(uint32_t) + lists.size() * sizeof(MeshRange);
+
+        return pMeshlets;
+    }
+
+    bool SceneMeshlets::isBackfacing(const Meshlet& meshlet, const float3& viewPos)
+    {
+        return meshlet.coneCutoff < 1.f && glm::dot(glm::normalize(meshlet.coneApex - viewPos), meshlet.coneAxis) >= meshlet.coneCutoff;
+    }
+
+    SceneMeshlets::CullStats SceneMeshlets::cull(uint32_t meshID, const glm::mat4& objectToWorld, const glm::mat4& viewProj, const float3& viewPos, std::vector<uint32_t>* visible) const
+    {
+        // Extract the world-space frustum planes from the rows of the view-projection matrix (clip space 0 <= z <= w).
+        const glm::mat4 rows = glm::transpose(viewProj);
+        float4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2] };
+        for (auto& p : planes) p /= glm::length(float3(p));
+
+        // The bounding spheres are tested in world space with a conservative radius scale. The cone test is
+        // done in object space against the view position transformed into object space. An invertible affine
+        // transform maps each side of a triangle plane to the same side, so which side the viewer is on does not change.
+        // Mirrored instances (negative determinant) need no special case: the scene flips their front face winding
+        // (isWorldFrontFaceCW), so the world-space front side is the transformed object-space front side.
+        const float radiusScale = std::max(glm::length(float3(objectToWorld[0])), std::max(glm::length(float3(objectToWorld[1])), glm::length(float3(objectToWorld[2]))));
+        const float3 viewPosLocal = float3(glm::inverse(objectToWorld) * float4(viewPos, 1.f));
+
+        CullStats stats;
+        const MeshRange& range = mMeshRanges[meshID];
+        for (uint32_t meshletID = range.meshletOffset; meshletID < range.meshletOffset + range.meshletCount; meshletID++)
+        {
+            const Meshlet& meshlet = mMeshlets[meshletID];
+            stats.testedCount++;
+
+            const float3 center = float3(objectToWorld * float4(meshlet.center, 1.f));
+            const float radius = meshlet.radius * radiusScale;
+            bool outside = false;
+            for (const auto& p : planes) outside |= glm::dot(float3(p), center) + p.w < -radius;
+            if (outside)
+            {
+                stats.frustumCulledCount++;
+                continue;
+            }
+
+            if (isBackfacing(meshlet, viewPosLocal))
+            {
+                stats.coneCulledCount++;
+                continue;
+            }
+
+            if (visible) visible->push_back(meshletID);
+        }
+        return stats;
+    }
+}
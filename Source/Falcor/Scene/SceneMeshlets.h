@@ -0,0 +1,176 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Utils/Math/AABB.h"
+
+namespace Falcor
+{
+    /** Meshlet (cluster) partitioning of the triangle meshes of a scene.
+
+        Each mesh is split into meshlets of at most Options::maxVertices vertices and Options::maxTriangles triangles.
+        A meshlet references its vertices through a list of mesh-relative vertex indices, and its triangles are stored
+        as local indices into that list, packed 8 bits per corner. Neighbouring triangles are grouped greedily so that
+        meshlets are spatially compact, which keeps their bounds tight for culling.
+
+        Each meshlet stores a bounding sphere and a normal cone in object space. The cone follows the convention
+        of meshoptimizer: the meshlet is entirely backfacing for a viewer at position p if
+        dot(normalize(coneApex - p), coneAxis) >= coneCutoff. A cutoff of 1 means the meshlet can never be cone culled.
+
+        Skinned meshes are partitioned in their bind pose. All queries are const and can be issued from multiple threads.
+    */
+    class dlldecl SceneMeshlets
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneMeshlets>;
+
+        struct Options
+        {
+            uint32_t maxVertices = 64;      ///< Maximum number of vertices per meshlet. Must be in [3, 256].
+            uint32_t maxTriangles = 124;    ///< Maximum number of triangles per meshlet. Must be at least 1.
+        };
+
+        /** Scene geometry to partition.
+        */
+        struct Geometry
+        {
+            struct Mesh
+            {
+                uint32_t vertexOffset = 0;  ///< Offset of the first vertex in 'positions'.
+                uint32_t indexOffset = 0;   ///< Offset of the first index in 'indices'.
+                uint32_t vertexCount = 0;
+                uint32_t triangleCount = 0;
+                bool isIndexed = true;      ///< If false, triangle i uses vertices 3i, 3i+1, 3i+2.
+                bool isFrontFaceCW = false; ///< Indicate whether front-facing side has clockwise winding in object space.
+            };
+
+            std::vector<float3> positions;  ///< Object-space vertex positions of all meshes.
+            std::vector<uint32_t> indices;  ///< Vertex indices of all indexed meshes, relative to the mesh vertex offset.
+            std::vector<Mesh> meshes;
+        };
+
+        struct Meshlet
+        {
+            uint32_t vertexOffset = 0;      ///< Offset of the first vertex in the meshlet vertex list, see getVertices().
+            uint32_t triangleOffset = 0;    ///< Offset of the first triangle in the meshlet triangle list, see getTriangles().
+            uint32_t vertexCount = 0;
+            uint32_t triangleCount = 0;
+            float3 center = float3(0.f);    ///< Bounding sphere center in object space.
+            float radius = 0.f;             ///< Bounding sphere radius.
+            float3 coneApex = float3(0.f);  ///< Normal cone apex in object space.
+            float coneCutoff = 1.f;         ///< Sine of the normal cone half angle, or 1 if the cone is degenerate.
+            float3 coneAxis = float3(0.f);  ///< Normal cone axis (normalized).
+            uint32_t meshID = 0;            ///< Mesh the meshlet belongs to.
+        };
+
+        /** Range of meshlets of a mesh.
+        */
+        struct MeshRange
+        {
+            uint32_t meshletOffset = 0;
+            uint32_t meshletCount = 0;
+        };
+
+        struct Stats
+        {
+            uint32_t meshCount = 0;
+            uint64_t meshletCount = 0;
+            uint64_t triangleCount = 0;         ///< Number of triangles in all meshlets.
+            uint64_t vertexCount = 0;           ///< Number of meshlet vertex references. Vertices shared between meshlets are counted once per meshlet.
+            uint64_t coneCullableCount = 0;     ///< Number of meshlets with a non-degenerate normal cone.
+            float avgVertexCount = 0.f;         ///< Average number of vertices per meshlet.
+            float avgTriangleCount = 0.f;       ///< Average number of triangles per meshlet.
+            float avgRadius = 0.f;              ///< Average bounding sphere radius in object space.
+            uint64_t memoryInBytes = 0;         ///< Memory used by meshlet descriptors, vertex and triangle lists.
+        };
+
+        /** Meshlet culling results, see cull().
+        */
+        struct CullStats
+        {
+            uint64_t testedCount = 0;           ///< Number of meshlets tested.
+            uint64_t frustumCulledCount = 0;    ///< Number of meshlets outside the view frustum.
+            uint64_t coneCulledCount = 0;       ///< Number of meshlets inside the frustum that face away from the viewer.
+        };
+
+        /** Partition the meshes into meshlets. The meshes are processed in parallel.
+            \param[in] geometry Scene geometry.
+            \param[in] options Partitioning options.
+        */
+        static SharedPtr create(const Geometry& geometry, const Options& options);
+        static SharedPtr create(const Geometry& geometry) { return create(geometry, Options()); }
+
+        /** Pack the local vertex indices of a triangle into the meshlet triangle format.
+        */
+        static uint32_t packTriangle(uint32_t i0, uint32_t i1, uint32_t i2) { return i0 | (i1 << 8) | (i2 << 16); }
+
+        /** Unpack a triangle in the meshlet triangle format into local vertex indices.
+        */
+        static uint3 unpackTriangle(uint32_t packed) { return uint3(packed & 0xff, (packed >> 8) & 0xff, (packed >> 16) & 0xff); }
+
+        /** Check if a meshlet is entirely backfacing.
+            \param[in] meshlet Meshlet.
+            \param[in] viewPos Viewer position in the meshlet's object space.
+        */
+        static bool isBackfacing(const Meshlet& meshlet, const float3& viewPos);
+
+        /** Cull the meshlets of a mesh instance against a view.
+            \param[in] meshID Mesh ID.
+            \param[in] objectToWorld Transform of the mesh instance.
+            \param[in] viewProj View-projection matrix. The frustum is extracted from it.
+            \param[in] viewPos Viewer position in world space.
+            \param[out] visible IDs of the meshlets that pass culling are appended. Can be nullptr if only the counts are needed.
+            \return Culling counts for the mesh instance.
+        */
+        CullStats cull(uint32_t meshID, const glm::mat4& objectToWorld, const glm::mat4& viewProj, const float3& viewPos, std::vector<uint32_t>* visible = nullptr) const;
+
+        const std::vector<Meshlet>& getMeshlets() const { return mMeshlets; }
+        const Meshlet& getMeshlet(uint32_t meshletID) const { return mMeshlets[meshletID]; }
+        const MeshRange& getMeshRange(uint32_t meshID) const { return mMeshRanges[meshID]; }
+
+        /** Get the meshlet vertex list. Entries are vertex indices relative to the mesh's first vertex.
+        */
+        const std::vector<uint32_t>& getVertices() const { return mVertices; }
+
+        /** Get the meshlet triangle list. Entries are local vertex indices packed with packTriangle().
+        */
+        const std::vector<uint32_t>& getTriangles() const { return mTriangles; }
+
+        const Options& getOptions() const { return mOptions; }
+        const Stats& getStats() const { return mStats; }
+
+    private:
+        SceneMeshlets() = default;
+
+        Options mOptions;
+        std::vector<Meshlet> mMeshlets;
+        std::vector<MeshRange> mMeshRanges;    ///< Meshlet range of each mesh, indexed by mesh ID.
+        std::vector<uint32_t> mVertices;
+        std::vector<uint32_t> mTriangles;
+        Stats mStats;
+    };
+}
@@ -0,0 +1,332 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "BVH4.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        struct BinaryNode
+        {
+            AABB bounds;
+            uint32_t left = 0;      ///< Index of the left child, or the first primitive for leaves.
+            uint32_t right = 0;     ///< Index of the right child.
+            uint32_t count = 0;     ///< Number of primitives for leaves, zero for inner nodes.
+
+            bool isLeaf() const { return count > 0; }
+        };
+
+        struct Bin
+        {
+            AABB bounds;
+            uint32_t count = 0;
+        };
+
+        uint32_t ceilLog2(uint32_t n)
+        {
+            uint32_t log2 = 0;
+            while (log2 < 32 && (1ull << log2) < n) log2++;
+            return log2;
+        }
+
+        /** Build a binary hierarchy with binned SAH.
+            The primitive index array is reordered so that each leaf references a contiguous range.
+            Nodes that could otherwise end up deeper than the maximum depth are split at the object median instead,
+            which halves the primitive count per level. Leaves are then reached within the depth limit.
+        */
+        std::vector<BinaryNode> buildBinary(const std::vector<AABB>& bounds, std::vector<uint32_t>& indices, const BVH4::BuildOptions& options)
+        {
+            const uint32_t binCount = std::max(options.binCount, 2u);
+            const uint32_t maxLeafSize = std::max(options.maxLeafSize, 1u);
+            const uint32_t maxDepth = std::clamp(options.maxDepth, 1 + ceilLog2((uint32_t)indices.size()), BVH4::kMaxDepth);
+
+            std::vector<float3> centroids(bounds.size());
+            for (uint32_t i : indices) centroids[i] = bounds[i].center();
+
+            std::vector<BinaryNode> nodes;
+            nodes.reserve(2 * indices.size() / maxLeafSize + 1);
+            nodes.emplace_back();
+
+            struct Task
+            {
+                uint32_t nodeIndex;
+                uint32_t begin;
+                uint32_t end;
+                uint32_t depth;
+            };
+            std::vector<Task> tasks;
+            tasks.push_back({ 0, 0, (uint32_t)indices.size(), 1 });
+
+            std::vector<Bin> bins(binCount);
+            std::vector<AABB> rightBounds(binCount);
+            std::vector<uint32_t> rightCounts(binCount);
+
+            while (!tasks.empty())
+            {
+                const Task task = tasks.back();
+                tasks.pop_back();
+
+                const uint32_t count = task.end - task.begin;
+                AABB nodeBounds, centroidBounds;
+                for (uint32_t i = task.begin; i < task.end; i++)
+                {
+                    nodeBounds.include(bounds[indices[i]]);
+                    centroidBounds.include(centroids[indices[i]]);
+                }
+                nodes[task.nodeIndex].bounds = nodeBounds;
+
+                auto makeLeaf = [&]()
+                {
+                    nodes[task.nodeIndex].left = task.begin;
+                    nodes[task.nodeIndex].count = count;
+                };
+
+                auto pushChildren = [&](uint32_t mid)
+                {
+                    assert(mid > task.begin && mid < task.end);
+                    uint32_t left = (uint32_t)nodes.size();
+                    nodes.emplace_back();
+                    nodes.emplace_back();
+                    nodes[task.nodeIndex].left = left;
+                    nodes[task.nodeIndex].right = left + 1;
+                    tasks.push_back({ left, task.begin, mid, task.depth + 1 });
+                    tasks.push_back({ left + 1, mid, task.end, task.depth + 1 });
+                };
+
+                if (count == 1)
+                {
+                    makeLeaf();
+                    continue;
+                }
+
+                // Median splits keep depth + ceil(log2(count)) constant, so once that reaches the limit every leaf stays within it.
+                uint32_t mid;
+                if (task.depth + ceilLog2(count) >= maxDepth)
+                {
+                    if (count <= maxLeafSize)
+                    {
+                        makeLeaf();
+                        continue;
+                    }
+                    const float3 extent = centroidBounds.extent();
+                    const uint32_t axis = extent.x >= extent.y ? (extent.x >= extent.z ? 0 : 2) : (extent.y >= extent.z ? 1 : 2);
+                    mid = task.begin + count / 2;
+                    std::nth_element(indices.begin() + task.begin, indices.begin() + mid, indices.begin() + task.end, [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+                    pushChildren(mid);
+                    continue;
+                }
+
+                // Find the best split plane over all axes. Costs are relative to the cost of intersecting one primitive.
+                const float3 extent = centroidBounds.extent();
+                const float nodeArea = std::max(nodeBounds.area(), 1e-30f);
+                float bestCost = std::numeric_limits<float>::infinity();
+                uint32_t bestAxis = 0, bestBin = 0;
+
+                for (uint32_t axis = 0; axis < 3; axis++)
+                {
+                    if (extent[axis] <= 0.f) continue;
+                    const float scale = binCount / extent[axis];
+
+                    for (auto& b : bins) b = Bin();
+                    for (uint32_t i = task.begin; i < task.end; i++)
+                    {
+                        uint32_t b = std::min((uint32_t)((centroids[indices[i]][axis] - centroidBounds.minPoint[axis]) * scale), binCount - 1);
+                        bins[b].bounds.include(bounds[indices[i]]);
+                        bins[b].count++;
+                    }
+
+                    // Sweep from the right to accumulate bounds of the right side of each split
+                    AABB accumBounds;
+                    uint32_t accumCount = 0;
+                    for (uint32_t b = binCount - 1; b > 0; b--)
+                    {
+                        accumBounds.include(bins[b].bounds);
+                        accumCount += bins[b].count;
+                        rightBounds[b] = accumBounds;
+                        rightCounts[b] = accumCount;
+                    }
+
+                    // Sweep from the left and evaluate the split after each bin
+                    accumBounds = AABB();
+                    accumCount = 0;
+                    for (uint32_t b = 0; b < binCount - 1; b++)
+                    {
+                        accumBounds.include(bins[b].bounds);
+                        accumCount += bins[b].count;
+                        if (accumCount == 0 || rightCounts[b + 1] == 0) continue;
+
+                        float cost = options.traversalCost + (accumBounds.area() * accumCount + rightBounds[b + 1].area() * rightCounts[b + 1]) / nodeArea;
+                        if (cost < bestCost)
+                        {
+                            bestCost = cost;
+                            bestAxis = axis;
+                            bestBin = b;
+                        }
+                    }
+                }
+
+                if (bestCost < std::numeric_limits<float>::infinity())
+                {
+                    if (count <= maxLeafSize && (float)count <= bestCost)
+                    {
+                        makeLeaf();
+                        continue;
+                    }
+
+                    const float scale = binCount / extent[bestAxis];
+                    auto it = std::partition(indices.begin() + task.begin, indices.begin() + task.end, [&](uint32_t i)
+                    {
+                        uint32_t b = std::min((uint32_t)((centroids[i][bestAxis] - centroidBounds.minPoint[bestAxis]) * scale), binCount - 1);
+                        return b <= bestBin;
+                    });
+                    mid = (uint32_t)(it - indices.begin());
+                }
+                else
+                {
+                    // All centroids coincide. Split in the middle of the range unless the primitives fit in a leaf.
+                    if (count <= maxLeafSize)
+                    {
+                        makeLeaf();
+                        continue;
+                    }
+                    mid = task.begin + count / 2;
+                }
+                pushChildren(mid);
+            }
+
+            return nodes;
+        }
+
+        void setChildBounds(BVH4::Node& node, uint32_t slot, const AABB& bounds)
+        {
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                node.bounds[axis][slot] = bounds.minPoint[axis];
+                node.bounds[axis + 3][slot] = bounds.maxPoint[axis];
+            }
+        }
+    }
+
+    void BVH4::build(const std::vector<AABB>& primitiveBounds, const BuildOptions& options)
+    {
+        mNodes.clear();
+        mPrimitiveIndices.clear();
+        mBounds = AABB();
+        mDepth = 0;
+
+        for (uint32_t i = 0; i < (uint32_t)primitiveBounds.size(); i++)
+        {
+            if (primitiveBounds[i].valid()) mPrimitiveIndices.push_back(i);
+        }
+        if (mPrimitiveIndices.empty()) return;
+
+        const std::vector<BinaryNode> binary = buildBinary(primitiveBounds, mPrimitiveIndices, options);
+        mBounds = binary[0].bounds;
+
+        // Collapse the binary tree. Each wide node adopts up to four descendants of a binary node,
+        // repeatedly opening the inner child with the largest surface area.
+        struct Task
+        {
+            uint32_t binaryIndex;
+            uint32_t nodeIndex;
+            uint32_t depth;
+        };
+        std::vector<Task> tasks;
+        mNodes.emplace_back();
+        tasks.push_back({ 0, 0, 1 });
+
+        while (!tasks.empty())
+        {
+            const Task task = tasks.back();
+            tasks.pop_back();
+            mDepth = std::max(mDepth, task.depth);
+            assert(mDepth <= kMaxDepth);
+
+            uint32_t children[4];
+            uint32_t childCount = 0;
+            const BinaryNode& root = binary[task.binaryIndex];
+            if (root.isLeaf())
+            {
+                children[childCount++] = task.binaryIndex;
+            }
+            else
+            {
+                children[childCount++] = root.left;
+                children[childCount++] = root.right;
+            }
+
+            while (childCount < 4)
+            {
+                int best = -1;
+                float bestArea = -1.f;
+                for (uint32_t c = 0; c < childCount; c++)
+                {
+                    const BinaryNode& child = binary[children[c]];
+                    if (!child.isLeaf() && child.bounds.area() > bestArea)
+                    {
+                        best = (int)c;
+                        bestArea = child.bounds.area();
+                    }
+                }
+                if (best < 0) break;
+
+                const BinaryNode& opened = binary[children[best]];
+                children[best] = opened.left;
+                children[childCount++] = opened.right;
+            }
+
+            Node node;
+            for (uint32_t slot = 0; slot < 4; slot++)
+            {
+                setChildBounds(node, slot, AABB());
+                node.children[slot] = kEmpty;
+                node.counts[slot] = 0;
+            }
+
+            for (uint32_t slot = 0; slot < childCount; slot++)
+            {
+                const BinaryNode& child = binary[children[slot]];
+                setChildBounds(node, slot, child.bounds);
+                if (child.isLeaf())
+                {
+                    node.children[slot] = kLeafFlag | child.left;
+                    node.counts[slot] = child.count;
+                }
+                else
+                {
+                    uint32_t childNode = (uint32_t)mNodes.size();
+                    mNodes.emplace_back();
+                    node.children[slot] = childNode;
+                    tasks.push_back({ children[slot], childNode, task.depth + 1 });
+                }
+            }
+            mNodes[task.nodeIndex] = node;
+        }
+    }
+}
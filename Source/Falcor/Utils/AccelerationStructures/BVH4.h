@@ -0,0 +1,334 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Utils/Math/AABB.h"
+#include <xmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Falcor
+{
+    /** Four-wide bounding volume hierarchy for CPU ray tracing.
+
+        The hierarchy is built with binned SAH into a binary tree, which is then collapsed into nodes
+        with up to four children. The child bounds of a node are stored in SoA layout so that a ray is
+        tested against all four children at once with SSE.
+
+        The BVH only references primitives by index. The primitives themselves are intersected by a
+        callback given to the traversal functions, which allows the same code to be used for triangles
+        and for instances in a two-level hierarchy.
+    */
+    class dlldecl BVH4
+    {
+    public:
+        static const uint32_t kLeafFlag = 0x80000000;   ///< Set in child references that point to a range of primitives.
+        static const uint32_t kEmpty = 0xffffffff;      ///< Unused child slot.
+        static const uint32_t kMaxPacketSize = 64;      ///< Maximum number of rays in a packet.
+        static const uint32_t kMaxDepth = 64;           ///< Maximum depth of the hierarchy. The builder switches to median splits to stay within it.
+        static const uint32_t kStackSize = 3 * kMaxDepth + 1;  ///< Traversal stack size. Each level leaves at most three siblings on the stack, plus four children of the deepest node.
+
+        struct BuildOptions
+        {
+            uint32_t binCount = 16;         ///< Number of SAH bins per axis.
+            uint32_t maxLeafSize = 4;       ///< Maximum number of primitives per leaf.
+            float traversalCost = 1.f;      ///< SAH cost of traversing a node, relative to intersecting a primitive.
+            uint32_t maxDepth = kMaxDepth;  ///< Maximum depth of the hierarchy. Clamped to kMaxDepth, and raised to the depth of a balanced binary hierarchy if smaller.
+        };
+
+        struct alignas(16) Node
+        {
+            float bounds[6][4];     ///< Child bounds in SoA layout: minX, minY, minZ, maxX, maxY, maxZ. Unused slots hold inverted boxes which are never hit.
+            uint32_t children[4];   ///< Child references. Inner child: node index. Leaf child: kLeafFlag | first primitive in getPrimitiveIndices(). Unused: kEmpty.
+            uint32_t counts[4];     ///< Number of primitives of leaf children, zero for inner children.
+        };
+
+        /** Build the hierarchy.
+            \param[in] primitiveBounds Bounding box of each primitive. Primitives with invalid boxes are excluded.
+            \param[in] options Build options.
+        */
+        void build(const std::vector<AABB>& primitiveBounds, const BuildOptions& options = BuildOptions());
+
+        /** Check if the hierarchy contains no primitives.
+        */
+        bool empty() const { return mNodes.empty(); }
+
+        /** Get the bounds of all primitives.
+        */
+        const AABB& getBounds() const { return mBounds; }
+
+        const std::vector<Node>& getNodes() const { return mNodes; }
+
+        /** Get the primitive indices referenced by the leaves.
+        */
+        const std::vector<uint32_t>& getPrimitiveIndices() const { return mPrimitiveIndices; }
+
+        /** Get the depth of the hierarchy, counting the root node as one. This is at most kMaxDepth.
+        */
+        uint32_t getDepth() const { return mDepth; }
+
+        /** Traverse the hierarchy with a single ray.
+            Children are visited front to back, and subtrees beyond the current tMax are skipped.
+            \param[in] origin Ray origin.
+            \param[in] dir Ray direction.
+            \param[in] tMin Minimum ray distance.
+            \param[in,out] tMax Maximum ray distance. The leaf callback shortens it when a closer hit is found.
+            \param[in] leafFunc Callback bool(uint32_t primitiveIndex, float& tMax) called for each primitive in a leaf the ray enters.
+                Returning true terminates the traversal, which is used for any-hit queries.
+        */
+        template<typename LeafFunc>
+        void traverse(const float3& origin, const float3& dir, float tMin, float& tMax, LeafFunc leafFunc) const;
+
+        /** Traverse the hierarchy with a packet of rays that share a traversal stack.
+            This is efficient for coherent rays such as primary rays or shadow rays towards a common point.
+            A subtree is entered if any active ray intersects its bounds, but leaf primitives are only tested against rays that intersect the leaf.
+            \param[in] origins Ray origins.
+            \param[in] dirs Ray directions.
+            \param[in] tMins Minimum ray distances.
+            \param[in,out] tMaxs Maximum ray distances.
+            \param[in] rayCount Number of rays, at most kMaxPacketSize.
+            \param[in] leafFunc Callback uint64_t(uint64_t rayMask, uint32_t primitiveIndex, float* tMaxs) called for each primitive in a leaf
+                with the mask of active rays that intersect the leaf. It may shorten the tMaxs of these rays and returns a mask of rays to terminate,
+                which is used for any-hit queries.
+        */
+        template<typename LeafFunc>
+        void traversePacket(const float3* origins, const float3* dirs, const float* tMins, float* tMaxs, uint32_t rayCount, LeafFunc leafFunc) const;
+
+        /** Get the index of the lowest set bit in a non-zero mask. Used to iterate over the rays in a packet.
+        */
+        static uint32_t lowestSetBit(uint64_t mask)
+        {
+            assert(mask != 0);
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward64(&index, mask);
+            return (uint32_t)index;
+#else
+            return (uint32_t)__builtin_ctzll(mask);
+#endif
+        }
+
+    private:
+        struct SimdRay
+        {
+            __m128 origin[3];
+            __m128 invDir[3];
+            uint32_t nearOffset[3];     ///< Index of the near plane in Node::bounds for each axis, selected by the direction sign.
+
+            SimdRay(const float3& o, const float3& d);
+
+            /** Intersect the four children of a node.
+                \param[out] tNear Entry distance for each child.
+                \return Bit mask of children that are hit within [tMin, tMax].
+            */
+            uint32_t intersect(const Node& node, float tMin, float tMax, float tNear[4]) const;
+        };
+
+        std::vector<Node> mNodes;
+        std::vector<uint32_t> mPrimitiveIndices;
+        AABB mBounds;
+        uint32_t mDepth = 0;
+    };
+
+    inline BVH4::SimdRay::SimdRay(const float3& o, const float3& d)
+    {
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            // Avoid infinities in the inverse direction. They lead to NaNs when the origin lies on a slab plane.
+            float dirAxis = d[axis];
+            if (std::abs(dirAxis) < 1e-20f) dirAxis = std::copysign(1e-20f, dirAxis);
+            origin[axis] = _mm_set1_ps(o[axis]);
+            invDir[axis] = _mm_set1_ps(1.f / dirAxis);
+            nearOffset[axis] = dirAxis >= 0.f ? axis : axis + 3;
+        }
+    }
+
+    inline uint32_t BVH4::SimdRay::intersect(const Node& node, float tMin, float tMax, float tNear[4]) const
+    {
+        // Slab test with the near/far planes chosen by direction sign. Inverted (unused) boxes always produce tNear > tFar.
+        __m128 nearT = _mm_set1_ps(tMin);
+        __m128 farT = _mm_set1_ps(tMax);
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            uint32_t nearIndex = nearOffset[axis];
+            uint32_t farIndex = nearIndex >= 3 ? nearIndex - 3 : nearIndex + 3;
+            __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearIndex]), origin[axis]), invDir[axis]);
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[farIndex]), origin[axis]), invDir[axis]);
+            nearT = _mm_max_ps(nearT, t0);
+            farT = _mm_min_ps(farT, t1);
+        }
+        _mm_storeu_ps(tNear, nearT);
+        return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(nearT, farT));
+    }
+
+    template<typename LeafFunc>
+    void BVH4::traverse(const float3& origin, const float3& dir, float tMin, float& tMax, LeafFunc leafFunc) const
+    {
+        if (mNodes.empty()) return;
+
+        struct StackEntry
+        {
+            uint32_t ref;
+            uint32_t count;
+            float tNear;
+        };
+        StackEntry stack[kStackSize];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = { 0, 0, tMin };
+
+        const SimdRay ray(origin, dir);
+
+        while (stackSize > 0)
+        {
+            const StackEntry entry = stack[--stackSize];
+            if (entry.tNear > tMax) continue;
+
+            if (entry.ref & kLeafFlag)
+            {
+                const uint32_t first = entry.ref & ~kLeafFlag;
+                for (uint32_t i = 0; i < entry.count; i++)
+                {
+                    if (leafFunc(mPrimitiveIndices[first + i], tMax)) return;
+                }
+                continue;
+            }
+
+            const Node& node = mNodes[entry.ref];
+            float tNear[4];
+            uint32_t mask = ray.intersect(node, tMin, tMax, tNear);
+            if (mask == 0) continue;
+
+            // Sort the hit children by distance and push them far to near, so the nearest is visited first.
+            uint32_t order[4];
+            uint32_t hitCount = 0;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                if (!(mask & (1u << c))) continue;
+                uint32_t j = hitCount++;
+                while (j > 0 && tNear[order[j - 1]] < tNear[c])
+                {
+                    order[j] = order[j - 1];
+                    j--;
+                }
+                order[j] = c;
+            }
+            for (uint32_t i = 0; i < hitCount; i++)
+            {
+                uint32_t c = order[i];
+                assert(stackSize < kStackSize);
+                stack[stackSize++] = { node.children[c], node.counts[c], tNear[c] };
+            }
+        }
+    }
+
+    template<typename LeafFunc>
+    void BVH4::traversePacket(const float3* origins, const float3* dirs, const float* tMins, float* tMaxs, uint32_t rayCount, LeafFunc leafFunc) const
+    {
+        if (mNodes.empty() || rayCount == 0) return;
+        assert(rayCount <= kMaxPacketSize);
+
+        // Rays are stored in a local array to avoid heap allocations per packet.
+        alignas(16) uint8_t rayStorage[kMaxPacketSize * sizeof(SimdRay)];
+        SimdRay* rays = reinterpret_cast<SimdRay*>(rayStorage);
+        uint64_t active = 0;
+        for (uint32_t r = 0; r < rayCount; r++)
+        {
+            new (&rays[r]) SimdRay(origins[r], dirs[r]);
+            if (tMins[r] <= tMaxs[r]) active |= 1ull << r;
+        }
+
+        // Each stack entry carries the rays that hit the node, so that only those are tested against its children.
+        struct StackEntry
+        {
+            uint32_t node;
+            uint64_t rayMask;
+        };
+        StackEntry stack[kStackSize];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = { 0, active };
+
+        while (stackSize > 0 && active != 0)
+        {
+            const StackEntry entry = stack[--stackSize];
+            const uint64_t nodeRays = entry.rayMask & active;
+            if (nodeRays == 0) continue;
+            const Node& node = mNodes[entry.node];
+
+            // Find which children are hit by which rays
+            uint64_t childRays[4] = { 0, 0, 0, 0 };
+            const float kFar = std::numeric_limits<float>::max();
+            float childNear[4] = { kFar, kFar, kFar, kFar };
+            for (uint64_t remaining = nodeRays; remaining != 0; remaining &= remaining - 1)
+            {
+                uint32_t r = lowestSetBit(remaining);
+
+                float tNear[4];
+                uint32_t mask = rays[r].intersect(node, tMins[r], tMaxs[r], tNear);
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    if (!(mask & (1u << c))) continue;
+                    childRays[c] |= 1ull << r;
+                    childNear[c] = std::min(childNear[c], tNear[c]);
+                }
+            }
+
+            // Leaves are intersected right away with the rays that hit them. Inner children are pushed far to near.
+            uint32_t order[4];
+            uint32_t innerCount = 0;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                if (childRays[c] == 0) continue;
+                if (node.children[c] & kLeafFlag)
+                {
+                    const uint32_t first = node.children[c] & ~kLeafFlag;
+                    uint64_t leafRays = childRays[c] & active;
+                    for (uint32_t i = 0; i < node.counts[c] && leafRays != 0; i++)
+                    {
+                        uint64_t terminated = leafFunc(leafRays, mPrimitiveIndices[first + i], tMaxs) & leafRays;
+                        active &= ~terminated;
+                        leafRays &= ~terminated;
+                    }
+                    continue;
+                }
+
+                uint32_t j = innerCount++;
+                while (j > 0 && childNear[order[j - 1]] < childNear[c])
+                {
+                    order[j] = order[j - 1];
+                    j--;
+                }
+                order[j] = c;
+            }
+            for (uint32_t i = 0; i < innerCount; i++)
+            {
+                assert(stackSize < kStackSize);
+                stack[stackSize++] = { node.children[order[i]], childRays[order[i]] };
+            }
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <algorithm>
+#include <vector>
+
+namespace Falcor
+{
+    /** Tracks dirty element ranges of a CPU-side array that is mirrored in a GPU buffer.
+        Elements are marked dirty as they change, and the ranges are coalesced into a sorted list of
+        disjoint ranges so only the changed parts of the buffer are uploaded.
+    */
+    class DirtyRanges
+    {
+    public:
+        /** Half-open element range [begin, end).
+        */
+        struct Range
+        {
+            uint32_t begin = 0;
+            uint32_t end = 0;
+
+            uint32_t size() const { return end - begin; }
+            bool operator==(const Range& other) const { return begin == other.begin && end == other.end; }
+        };
+
+        /** Mark a single element as dirty.
+        */
+        void mark(uint32_t index) { mark(index, index + 1); }
+
+        /** Mark the elements in [begin, end) as dirty.
+        */
+        void mark(uint32_t begin, uint32_t end)
+        {
+            if (begin >= end) return;
+
+            // Extend the last range if the new one overlaps or adjoins it. This keeps sequential marking cheap.
+            if (!mRanges.empty() && begin >= mRanges.back().begin && begin <= mRanges.back().end)
+            {
+                mRanges.back().end = std::max(mRanges.back().end, end);
+                return;
+            }
+
+            mIsCoalesced = mRanges.empty() || (mIsCoalesced && begin > mRanges.back().end);
+            mRanges.push_back({ begin, end });
+        }
+
+        /** Check if any elements are dirty.
+        */
+        bool empty() const { return mRanges.empty(); }
+
+        /** Clear all dirty ranges.
+        */
+        void clear()
+        {
+            mRanges.clear();
+            mIsCoalesced = true;
+        }
+
+        /** Sort and merge the dirty ranges.
+            \param[in] maxGap Ranges separated by at most this many clean elements are merged. One larger upload is typically cheaper than several small ones.
+            \return Sorted list of disjoint ranges.
+        */
+        const std::vector<Range>& coalesce(uint32_t maxGap = 0)
+        {
+            if (mRanges.empty() || (mIsCoalesced && maxGap == 0)) return mRanges;
+
+            if (!mIsCoalesced) std::sort(mRanges.begin(), mRanges.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+            size_t count = 0;
+            for (size_t i = 1; i < mRanges.size(); i++)
+            {
+                Range& last = mRanges[count];
+                if ((uint64_t)mRanges[i].begin <= (uint64_t)last.end + maxGap) last.end = std::max(last.end, mRanges[i].end);
+                else mRanges[++count] = mRanges[i];
+            }
+            mRanges.resize(count + 1);
+            mIsCoalesced = true;
+
+            return mRanges;
+        }
+
+        /** Get the number of dirty elements.
+        */
+        uint32_t getDirtyCount()
+        {
+            uint32_t count = 0;
+            for (const auto& range : coalesce()) count += range.size();
+            return count;
+        }
+
+        /** Upload the dirty ranges to a buffer and clear them.
+            \param[in] pBuffer Buffer to write. Any type with a setBlob(pData, offset, size) member function.
+            \param[in] pData Pointer to the CPU-side elements. The buffer holds the same elements at the same offsets.
+            \param[in] elementSize Size of an element in bytes.
+            \param[in] maxGap Ranges separated by at most this many clean elements are uploaded together, see coalesce().
+            \return Number of bytes uploaded.
+        */
+        template<typename BufferT>
+        uint64_t upload(BufferT* pBuffer, const void* pData, size_t elementSize, uint32_t maxGap = 0)
+        {
+            uint64_t bytes = 0;
+            for (const auto& range : coalesce(maxGap))
+            {
+                const size_t offset = range.begin * elementSize;
+                const size_t size = range.size() * elementSize;
+                pBuffer->setBlob(static_cast<const uint8_t*>(pData) + offset, offset, size);
+                bytes += size;
+            }
+            clear();
+            return bytes;
+        }
+
+    private:
+        std::vector<Range> mRanges;
+        bool mIsCoalesced = true;           ///< True if mRanges is sorted and disjoint.
+    };
+}
@@ -42,6 +42,16 @@ namespace
     const std::string kCamera = "camera";
     const std::string kParameterBlockName = "params";
 
+    const FileDialogFilterVec kDumpFileFilters = { { "pathdump", "Path dump files" } };
+
+    const Gui::DropdownList kFilterList =
+    {
+        { (uint32_t)PathDebugFilter::All, "All paths" },
+        { (uint32_t)PathDebugFilter::Pixel, "Paths reaching the selected pixel" },
+        { (uint32_t)PathDebugFilter::Material, "Paths hitting a material" },
+        { (uint32_t)PathDebugFilter::ProjectionVolume, "Paths hitting a projection volume" },
+    };
+
     const uint32_t kRayVertexCount = 8 + 5;
     const uint32_t kRayIndexCount = (12 + 6) * 3;
     void appendRay(float3 origin, float3 direction, float thicknessScale, float lengthScale, std::uint32_t vertexOffset, std::uint32_t indexOffset, float4* pVertices, std::uint32_t* pIndices);
@@ -69,6 +79,8 @@ void PathDebug::setPrefix(const std::string& resourcePrefix)
     if (mRasteriser.pMatrixBuffer) mRasteriser.pMatrixBuffer->setName(mResourcePrefix + ".MatricesBuffer");
     if (mpPathDescription) mpPathDescription->setName(mResourcePrefix + ".pathDescription");
     if (mpPathDescriptionStaging) mpPathDescriptionStaging->setName(mResourcePrefix + ".pathDescriptionStaging");
+    if (mpPathRecords) mpPathRecords->setName(mResourcePrefix + ".pathRecords");
+    if (mpPathRecordsStaging) mpPathRecordsStaging->setName(mResourcePrefix + ".pathRecordsStaging");
 }
 
 void PathDebug::setScene(RenderContext* pRenderContext, const Scene::SharedPtr& pScene)
@@ -113,6 +125,42 @@ bool PathDebug::renderUI(Gui::Widgets& widget)
             dirty |= widget.rgbColor("Unselected color", mUnselectedColor);
         }
 
+        widget.checkbox("Compact recording", mCompactRecording);
+        widget.tooltip("Record only the paths passing a filter, reservoir sampled to a fixed number of paths per frame.", true);
+        if (mCompactRecording)
+        {
+            widget.var("Max recorded paths", mRecordBudget, 1u, 1u << 20);
+            widget.dropdown("Filter", kFilterList, (uint32_t&)mFilter);
+            if (mFilter == PathDebugFilter::Pixel)
+            {
+                widget.var("Pixel radius", mFilterPixelRadius, 0u, 64u);
+                widget.text("Selected pixel: " + std::to_string(mFilterPixel.x) + ", " + std::to_string(mFilterPixel.y));
+            }
+            if (mFilter == PathDebugFilter::Material) widget.var("Material ID", mFilterMaterialID);
+
+            if (mpRecordedPaths)
+            {
+                const auto stats = mpRecordedPaths->computeStats();
+                std::ostringstream oss;
+                oss << "Recorded " << stats.pathCount << " of " << stats.matchingPathCount << " matching paths.\n"
+                    << "Mean vertex count:\t" << stats.meanVertexCount << "\n"
+                    << "Mean segment length:\t" << stats.meanSegmentLength << "\n"
+                    << "Missed paths:\t" << stats.missedPathCount;
+                widget.text(oss.str());
+            }
+
+            if (!mpDumpWriter)
+            {
+                std::string path;
+                if (widget.button("Start dump") && saveFileDialog(kDumpFileFilters, path)) startDump(path);
+            }
+            else
+            {
+                widget.text("Dumping to " + mpDumpWriter->getPath() + " (" + std::to_string(mpDumpWriter->getFrameCount()) + " frames)");
+                if (widget.button("Stop dump")) stopDump();
+            }
+        }
+
         // Fetch data and show it if available.
         copyDataToCPU();
         if (mDataValid)
@@ -157,6 +205,9 @@ void PathDebug::beginFrame(RenderContext* pRenderContext, const PathDebugSegment
     mSegmentIDLimits = segmentIDLimits;
     if (mSegmentIDLimits.pathIndex == 0u || mSegmentIDLimits.segmentIndex == 0u) return;
 
+    // The buffers are only needed when debugging is enabled.
+    if (!mEnabled) return;
+
     mHasDepthBuffer = static_cast<bool>(pGeometryAttachment);
     if (mHasDepthBuffer)
     {
@@ -166,20 +217,44 @@ void PathDebug::beginFrame(RenderContext* pRenderContext, const PathDebugSegment
     mRasteriser.pFbo->attachColorTarget(pColorAttachment, 0u);
     mHasColorOutput = static_cast<bool>(pColorAttachment);
 
-    const auto maxSegmentCount = mSegmentIDLimits.pathIndex * mSegmentIDLimits.segmentIndex;
+    // In compact recording mode, only the recorded paths are stored and rendered.
+    const uint32_t recordedPathCount = mCompactRecording ? std::min(mRecordBudget, mSegmentIDLimits.pathIndex) : mSegmentIDLimits.pathIndex;
+    const auto maxSegmentCount = recordedPathCount * mSegmentIDLimits.segmentIndex;
     const auto maxVertexCount = maxSegmentCount + mSegmentIDLimits.pathIndex;
 
-    if (!mpPathDescription || mpPathDescription->getElementCount() < maxVertexCount)
+    if (mCompactRecording)
     {
-        mpPathDescription = Buffer::createStructured(sizeof(PathDebugDescription), maxVertexCount);
-        mpPathDescription->setName(mResourcePrefix + ".pathDescription");
-        mDescriptionClearing.pVars["pathDescriptions"] = mpPathDescription;
-    }
+        const uint64_t recordsSize = 16ull + (uint64_t)mRecordBudget * getRecordStride();
+        if (!mpPathRecords || mpPathRecords->getSize() != recordsSize)
+        {
+            mpPathRecords = Buffer::create(recordsSize, Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr);
+            mpPathRecords->setName(mResourcePrefix + ".pathRecords");
+            mpPathRecordsStaging = Buffer::create(recordsSize, ResourceBindFlags::None, Buffer::CpuAccess::Read, nullptr);
+            mpPathRecordsStaging->setName(mResourcePrefix + ".pathRecordsStaging");
+        }
 
-    if (!mpPathDescriptionStaging || mpPathDescriptionStaging->getElementCount() < maxVertexCount)
+        // Release the buffers of the full recording mode.
+        mpPathDescription = nullptr;
+        mpPathDescriptionStaging = nullptr;
+    }
+    else
     {
-        mpPathDescriptionStaging = Buffer::createStructured(sizeof(PathDebugDescription), maxVertexCount, ResourceBindFlags::None, Buffer::CpuAccess::Read);
-        mpPathDescriptionStaging->setName(mResourcePrefix + ".pathDescriptionStaging");
+        if (!mpPathDescription || mpPathDescription->getElementCount() < maxVertexCount)
+        {
+            mpPathDescription = Buffer::createStructured(sizeof(PathDebugDescription), maxVertexCount);
+            mpPathDescription->setName(mResourcePrefix + ".pathDescription");
+            mDescriptionClearing.pVars["pathDescriptions"] = mpPathDescription;
+        }
+
+        if (!mpPathDescriptionStaging || mpPathDescriptionStaging->getElementCount() < maxVertexCount)
+        {
+            mpPathDescriptionStaging = Buffer::createStructured(sizeof(PathDebugDescription), maxVertexCount, ResourceBindFlags::None, Buffer::CpuAccess::Read);
+            mpPathDescriptionStaging->setName(mResourcePrefix + ".pathDescriptionStaging");
+        }
+
+        mpPathRecords = nullptr;
+        mpPathRecordsStaging = nullptr;
+        mpRecordedPaths = nullptr;
     }
 
     if (!mRasteriser.pMatrixBuffer || mRasteriser.pMatrixBuffer->getElementCount() < maxSegmentCount)
@@ -210,6 +285,13 @@ void PathDebug::beginFrame(RenderContext* pRenderContext, const PathDebugSegment
     if (!mpReadFence) mpReadFence = GpuFence::create();
     if (!mpWriteFence) mpWriteFence = GpuFence::create();
 
+    if (mCompactRecording)
+    {
+        // Reset the path counter and the record tickets.
+        pRenderContext->clearUAV(mpPathRecords->getUAV().get(), uint4(0));
+        return;
+    }
+
     uint3 gridSize = uint3(mSegmentIDLimits.pathIndex, 1u, 1u);
     if (gridSize.x > D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION)
     {
@@ -250,12 +332,16 @@ void PathDebug::endFrame(RenderContext* pRenderContext, const PathDebugSegmentID
                                          copyDstSize);
     };
 
-    if (mAutomaticUpdates)
+    // Streaming to a dump file needs the data of every frame.
+    if (mAutomaticUpdates || (mCompactRecording && mpDumpWriter))
     {
-        copyBuffer(mpPathDescriptionStaging.get(), mpPathDescription.get());
+        if (mCompactRecording) copyBuffer(mpPathRecordsStaging.get(), mpPathRecords.get());
+        else copyBuffer(mpPathDescriptionStaging.get(), mpPathDescription.get());
         pRenderContext->flush(false);
         mpReadFence->gpuSignal(pRenderContext->getLowLevelData()->getCommandQueue());
         mWaitingForData = true;
+
+        if (mCompactRecording) readRecords();
     }
 
     const bool shouldRenderPaths = mHasColorOutput && mVisualizePaths;
@@ -293,7 +379,12 @@ bool PathDebug::prepareProgram(const Program::SharedPtr& pProgram)
 
     if (mEnabled)
     {
-        return pProgram->addDefine("_PATH_DEBUG_ENABLED");
+        Shader::DefineList defines;
+        defines.add("_PATH_DEBUG_ENABLED");
+        defines.add("_PATH_DEBUG_COMPACT", mCompactRecording ? "1" : "0");
+        defines.add("_PATH_DEBUG_FILTER", std::to_string((uint32_t)mFilter));
+        defines.add("_PATH_DEBUG_MAX_VERTEX_COUNT", std::to_string(mSegmentIDLimits.segmentIndex + 1u));
+        return pProgram->addDefines(defines);
     }
     else
     {
@@ -308,8 +399,15 @@ void PathDebug::setShaderData(const ShaderVar& var)
     if (mEnabled)
     {
         var["gPathDescription"] = mpPathDescription;
+        var["gPathRecords"] = mpPathRecords;
         var["PathDebugCB"]["gPathCount"] = mSegmentIDLimits.pathIndex;
         var["PathDebugCB"]["gMaxVertexCount"] = mSegmentIDLimits.segmentIndex + 1u;
+        var["PathDebugCB"]["gRecordBudget"] = mRecordBudget;
+        var["PathDebugCB"]["gRecordStride"] = getRecordStride();
+        var["PathDebugCB"]["gFilterPixel"] = mFilterPixel;
+        var["PathDebugCB"]["gFilterPixelRadius"] = mFilterPixelRadius;
+        var["PathDebugCB"]["gFilterMaterialID"] = mFilterMaterialID;
+        var["PathDebugCB"]["gFrameSeed"] = mFrameIndex;
     }
 }
 
@@ -405,7 +503,8 @@ uint32_t PathDebug::fillInstanceData()
 
     PROFILE("PathDebug::fillInstanceData()");
 
-    const auto pPathDescription = reinterpret_cast<const PathDebugDescription*>(mpPathDescriptionStaging->map(Buffer::MapType::Read));
+    if (mCompactRecording ? !mpRecordedPaths : !mpPathDescriptionStaging) return 0u;
+
     auto pRayCoords = reinterpret_cast<uint2*>(mRasteriser.pRayCoordsStagingBuffer->map(Buffer::MapType::WriteDiscard));
     auto pMatrices = reinterpret_cast<glm::mat4x3*>(mRasteriser.pMatrixStagingBuffer->map(Buffer::MapType::WriteDiscard));
 
@@ -432,28 +531,50 @@ uint32_t PathDebug::fillInstanceData()
         return true;
     };
 
-    for (uint32_t pathIndex = 0; pathIndex < mSegmentIDLimits.pathIndex; ++pathIndex)
+    if (mCompactRecording)
+    {
+        const auto& vertices = mpRecordedPaths->getVertices();
+        for (const auto& path : mpRecordedPaths->getPaths())
+        {
+            for (uint32_t segmentIndex = 0u; segmentIndex + 1u < path.vertexCount; ++segmentIndex)
+            {
+                const bool isLastSegment = segmentIndex + 2u == path.vertexCount;
+                PathDebugDescription origin = {}, end = {};
+                origin.rayExtremity = vertices[path.firstVertex + segmentIndex];
+                end.rayExtremity = vertices[path.firstVertex + segmentIndex + 1u];
+                end.pathLength = path.missed && isLastSegment ? 0x80000000u : 0u;
+                if (processSegment(path.pathIndex, segmentIndex, instanceIndex, &origin, &end)) ++instanceIndex;
+            }
+        }
+    }
+    else
     {
-        const PathDebugDescription* const pPathOrigin = pPathDescription + pathIndex;
-        const bool isPathValid = pPathOrigin->pathLength > 0u;
-        if (!isPathValid) continue;
+        const auto pPathDescription = reinterpret_cast<const PathDebugDescription*>(mpPathDescriptionStaging->map(Buffer::MapType::Read));
 
-        const uint32_t segmentCount = std::min(pPathOrigin->pathLength, mSegmentIDLimits.segmentIndex);
-        for (uint32_t segmentIndex = 0u; segmentIndex < segmentCount; ++segmentIndex)
+        for (uint32_t pathIndex = 0; pathIndex < mSegmentIDLimits.pathIndex; ++pathIndex)
         {
-            const PathDebugDescription* const pOrigin = pPathOrigin + segmentIndex * static_cast<std::size_t>(mSegmentIDLimits.pathIndex);
-            const PathDebugDescription* const pEnd = pOrigin + mSegmentIDLimits.pathIndex;
-            const bool wasProcessed = processSegment(pathIndex, segmentIndex, instanceIndex, pOrigin, pEnd);
-            assert(wasProcessed || (!wasProcessed && (segmentIndex + 1u == segmentCount)));
-            if (!wasProcessed) continue;
+            const PathDebugDescription* const pPathOrigin = pPathDescription + pathIndex;
+            const bool isPathValid = pPathOrigin->pathLength > 0u;
+            if (!isPathValid) continue;
+
+            const uint32_t segmentCount = std::min(pPathOrigin->pathLength, mSegmentIDLimits.segmentIndex);
+            for (uint32_t segmentIndex = 0u; segmentIndex < segmentCount; ++segmentIndex)
+            {
+                const PathDebugDescription* const pOrigin = pPathOrigin + segmentIndex * static_cast<std::size_t>(mSegmentIDLimits.pathIndex);
+                const PathDebugDescription* const pEnd = pOrigin + mSegmentIDLimits.pathIndex;
+                const bool wasProcessed = processSegment(pathIndex, segmentIndex, instanceIndex, pOrigin, pEnd);
+                assert(wasProcessed || (!wasProcessed && (segmentIndex + 1u == segmentCount)));
+                if (!wasProcessed) continue;
 
-            ++instanceIndex;
+                ++instanceIndex;
+            }
         }
+
+        mpPathDescriptionStaging->unmap();
     }
 
     mRasteriser.pMatrixStagingBuffer->unmap();
     mRasteriser.pRayCoordsStagingBuffer->unmap();
-    mpPathDescriptionStaging->unmap();
 
     return instanceIndex;
 }
@@ -475,7 +596,29 @@ void PathDebug::copyDataToCPU()
         mWaitingForData = false;
     }
 
-    if (mEnabled)
+    if (mEnabled && mCompactRecording)
+    {
+        // Only the recorded paths are available.
+        mDataValid = false;
+        if (!mpRecordedPaths) return;
+
+        const auto& paths = mpRecordedPaths->getPaths();
+        auto it = std::find_if(paths.begin(), paths.end(), [this](const PathDump::Path& path) { return path.pathIndex == mSelectedSegmentID.pathIndex; });
+        if (it == paths.end() || it->vertexCount < 2u) return;
+
+        const auto& vertices = mpRecordedPaths->getVertices();
+        mSelectedPathLength = it->vertexCount - 1u;
+        mSelectedSegmentID.segmentIndex = std::min(mSelectedSegmentID.segmentIndex, mSelectedPathLength - 1u);
+        const float3 origin = vertices[it->firstVertex + mSelectedSegmentID.segmentIndex];
+        const float3 endPoint = vertices[it->firstVertex + mSelectedSegmentID.segmentIndex + 1u];
+
+        mSelectedSegmentOrigin = origin;
+        mSelectedSegmentHasHit = !(it->missed && mSelectedSegmentID.segmentIndex + 1u == mSelectedPathLength);
+        mSelectedSegmentHit = mSelectedSegmentHasHit ? endPoint : float3(0.0f);
+        mSelectedSegmentDirection = mSelectedSegmentHasHit ? glm::normalize(endPoint - origin) : endPoint;
+        mDataValid = true;
+    }
+    else if (mEnabled && mpPathDescriptionStaging)
     {
         const auto pPathDescription = reinterpret_cast<PathDebugDescription const*>(mpPathDescriptionStaging->map(Buffer::MapType::Read));
 
@@ -499,6 +642,49 @@ void PathDebug::copyDataToCPU()
     }
 }
 
+void PathDebug::readRecords()
+{
+    assert(mCompactRecording && mWaitingForData);
+
+    // Wait for signal.
+    mpReadFence->syncCpu();
+    mWaitingForData = false;
+
+    PROFILE("PathDebug::readRecords()");
+
+    const uint8_t* pData = reinterpret_cast<const uint8_t*>(mpPathRecordsStaging->map(Buffer::MapType::Read));
+
+    PathDump::FrameHeader header;
+    header.frameIndex = mFrameIndex++;
+    header.matchingPathCount = *reinterpret_cast<const uint32_t*>(pData);
+    header.recordCount = std::min(header.matchingPathCount, mRecordBudget);
+    header.recordStride = getRecordStride();
+
+    // Records are filled in order, so the first recordCount records are valid.
+    mpRecordedPaths = PathDump::decode(header, pData + 16);
+    if (mpDumpWriter) mpDumpWriter->writeFrame(header, pData + 16);
+
+    mpPathRecordsStaging->unmap();
+}
+
+void PathDebug::startDump(const std::string& path)
+{
+    try
+    {
+        mpDumpWriter = PathDump::Writer::create(path);
+    }
+    catch (const std::exception& e)
+    {
+        logError(std::string("PathDebug::startDump() - ") + e.what());
+    }
+}
+
+void PathDebug::stopDump()
+{
+    if (mpDumpWriter) logInfo("Wrote " + std::to_string(mpDumpWriter->getFrameCount()) + " frames of light paths to '" + mpDumpWriter->getPath() + "'.");
+    mpDumpWriter = nullptr;
+}
+
 namespace
 {
     float3 getNormal(float3 direction)
@@ -627,3 +813,15 @@ namespace
         pIndices[indexOffset + 53u] = vertexOffset +  9u;
     }
 }
+
+namespace Falcor
+{
+    SCRIPT_BINDING(PathDebugFilter)
+    {
+        pybind11::enum_<PathDebugFilter> filter(m, "PathDebugFilter");
+        filter.value("All", PathDebugFilter::All);
+        filter.value("Pixel", PathDebugFilter::Pixel);
+        filter.value("Material", PathDebugFilter::Material);
+        filter.value("ProjectionVolume", PathDebugFilter::ProjectionVolume);
+    }
+}
@@ -28,6 +28,7 @@
 #pragma once
 #include "Falcor.h"
 #include "PathDebugData.slang"
+#include "PathDump.h"
 #include "RenderGraph/RenderPassHelpers.h"
 
 using namespace Falcor;
@@ -64,11 +65,30 @@ public:
 
     bool renderUI(Gui::Widgets& widget);
 
+    /** Set the pixel used by PathDebugFilter::Pixel in compact recording mode.
+    */
+    void setSelectedPixel(const uint2& pixel) { mFilterPixel = pixel; }
+
+    /** Start streaming the paths recorded in compact recording mode to a dump file (see PathDump).
+        \param[in] path File path.
+    */
+    void startDump(const std::string& path);
+
+    /** Stop streaming the recorded paths to the dump file.
+    */
+    void stopDump();
+
+    /** Get the paths recorded in the last frame in compact recording mode, or nullptr if none.
+    */
+    const PathDump::SharedPtr& getRecordedPaths() const { return mpRecordedPaths; }
+
 protected:
     PathDebug(const Dictionary& dict);
     void updateVAO();
     uint32_t fillInstanceData();
     void copyDataToCPU();
+    void readRecords();
+    uint32_t getRecordStride() const { return sizeof(PathDebugRecordHeader) + mSegmentIDLimits.segmentIndex * sizeof(uint2); }
 
     // Internal state
     Scene::SharedPtr                    mpScene;
@@ -76,6 +96,10 @@ protected:
     Buffer::SharedPtr                   mpPathDescriptionStaging;
     GpuFence::SharedPtr                 mpReadFence;                    ///< GPU fence for sychronizing readback.
     GpuFence::SharedPtr                 mpWriteFence;                   ///< GPU fence for sychronizing writeback.
+    Buffer::SharedPtr                   mpPathRecords;                  ///< Number of paths passing the filter followed by the path records in compact recording mode.
+    Buffer::SharedPtr                   mpPathRecordsStaging;
+    PathDump::SharedPtr                 mpRecordedPaths;                ///< Paths read back in compact recording mode.
+    PathDump::Writer::SharedPtr         mpDumpWriter;                   ///< Dump file the recorded paths are streamed to, if any.
 
     // Configuration
     bool                                mEnabled = false;               ///< Enables debugging features.
@@ -91,10 +115,17 @@ protected:
     float3                              mSelectedPathColor = float3(0.8f, 0.8f, 0.2f);
     float3                              mSelectedSegmentColor = float3(0.8f, 0.2f, 0.2f);
     float3                              mUnselectedColor = float3(0.3f, 0.3f, 0.3f);
+    bool                                mCompactRecording = false;      ///< Record only the paths passing the filter, reservoir sampled to a fixed number of records.
+    PathDebugFilter                     mFilter = PathDebugFilter::All; ///< Filter selecting the paths to record in compact recording mode.
+    uint32_t                            mRecordBudget = 4096;           ///< Max number of paths recorded per frame in compact recording mode.
+    uint32_t                            mFilterMaterialID = 0;          ///< Material selected by PathDebugFilter::Material.
+    uint32_t                            mFilterPixelRadius = 2;         ///< Max distance in pixels to the selected pixel for PathDebugFilter::Pixel.
 
     // Runtime data
     std::string                         mResourcePrefix = "PathDebug";
     PathDebugSegmentID                  mSegmentIDLimits;
+    uint2                               mFilterPixel = uint2(0u);
+    uint32_t                            mFrameIndex = 0;
 
     bool                                mRunning = false;               ///< True when data collection is running (in between begin()/end() calls).
     bool                                mWaitingForData = false;        ///< True if we are waiting for data to become available on the GPU.
@@ -157,6 +188,11 @@ protected:
         serialize(mSelectedPathColor);
         serialize(mSelectedSegmentColor);
         serialize(mUnselectedColor);
+        serialize(mCompactRecording);
+        serialize(mRecordBudget);
+        serialize(mFilter);
+        serialize(mFilterMaterialID);
+        serialize(mFilterPixelRadius);
 
         if constexpr (loadFromDict)
         {
@@ -0,0 +1,291 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "PathDump.h"
+#include <execution>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Number of records or paths processed per parallel task.
+        const size_t kChunkSize = 4096;
+
+        /** Returns the number of vertices of a record, or zero if the record is empty or was overwritten concurrently.
+        */
+        uint32_t getValidVertexCount(const uint8_t* pRecord, uint32_t recordStride)
+        {
+            PathDebugRecordHeader header;
+            std::memcpy(&header, pRecord, sizeof(header));
+            if (header.ticket == 0 || header.vertexCount == 0) return 0;
+            if (sizeof(header) + (header.vertexCount - 1) * sizeof(uint2) > recordStride) return 0;
+
+            const uint32_t tag = header.ticket & 0xffff;
+            if ((header.flags >> 16) != tag) return 0;
+
+            const uint8_t* pVertices = pRecord + sizeof(header);
+            for (uint32_t i = 0; i + 1 < header.vertexCount; i++)
+            {
+                uint2 v;
+                std::memcpy(&v, pVertices + i * sizeof(uint2), sizeof(v));
+                if ((v.y >> 16) != tag) return 0;
+            }
+            return header.vertexCount;
+        }
+    }
+
+    PathDump::Writer::SharedPtr PathDump::Writer::create(const std::string& path)
+    {
+        return SharedPtr(new Writer(path));
+    }
+
+    PathDump::Writer::Writer(const std::string& path)
+        : mPath(path)
+    {
+        mStream.open(path, std::ios::binary | std::ios::trunc);
+        if (!mStream) throw std::exception(("Can't create path dump file '" + path + "'.").c_str());
+
+        FileHeader header;
+        mStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    void PathDump::Writer::writeFrame(const FrameHeader& header, const void* pRecords)
+    {
+        mStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        mStream.write(reinterpret_cast<const char*>(pRecords), (size_t)header.recordCount * header.recordStride);
+        mStream.flush();
+        mFrameCount++;
+    }
+
+    PathDump::SharedPtr PathDump::load(const std::string& path)
+    {
+        std::ifstream stream(path, std::ios::binary | std::ios::ate);
+        if (!stream) throw std::exception(("Can't open path dump file '" + path + "'.").c_str());
+
+        // Read the whole file at once, then decode the frames in place.
+        std::vector<uint8_t> data((size_t)stream.tellg());
+        stream.seekg(0);
+        stream.read(reinterpret_cast<char*>(data.data()), data.size());
+
+        FileHeader fileHeader;
+        if (data.size() < sizeof(fileHeader)) throw std::exception(("Path dump file '" + path + "' is truncated.").c_str());
+        std::memcpy(&fileHeader, data.data(), sizeof(fileHeader));
+        if (fileHeader.magic != kMagic) throw std::exception(("File '" + path + "' is not a path dump.").c_str());
+        if (fileHeader.version != kVersion) throw std::exception(("Path dump file '" + path + "' has unsupported version " + std::to_string(fileHeader.version) + ".").c_str());
+
+        std::vector<std::pair<FrameHeader, const uint8_t*>> frames;
+        size_t offset = sizeof(fileHeader);
+        while (offset + sizeof(FrameHeader) <= data.size())
+        {
+            FrameHeader header;
+            std::memcpy(&header, data.data() + offset, sizeof(header));
+            offset += sizeof(header);
+
+            const size_t size = (size_t)header.recordCount * header.recordStride;
+            if (offset + size > data.size() || header.recordStride < sizeof(PathDebugRecordHeader))
+            {
+                logWarning("Path dump file '" + path + "' is truncated after " + std::to_string(frames.size()) + " frames.");
+                break;
+            }
+            frames.emplace_back(header, data.data() + offset);
+            offset += size;
+        }
+
+        SharedPtr pDump = SharedPtr(new PathDump());
+        pDump->decodeFrames(frames);
+        return pDump;
+    }
+
+    PathDump::SharedPtr PathDump::decode(const FrameHeader& header, const void* pRecords)
+    {
+        SharedPtr pDump = SharedPtr(new PathDump());
+        pDump->decodeFrames({ { header, reinterpret_cast<const uint8_t*>(pRecords) } });
+        return pDump;
+    }
+
+    void PathDump::decodeFrames(const std::vector<std::pair<FrameHeader, const uint8_t*>>& frames)
+    {
+        mFrameCount = (uint32_t)frames.size();
+
+        // List all records.
+        struct Record
+        {
+            const uint8_t* pData;
+            uint32_t frameIndex;
+            uint32_t stride;
+        };
+        std::vector<Record> records;
+        for (const auto& [header, pData] : frames)
+        {
+            mMatchingPathCount += header.matchingPathCount;
+            for (uint32_t i = 0; i < header.recordCount; i++) records.push_back({ pData + (size_t)i * header.recordStride, header.frameIndex, header.recordStride });
+        }
+
+        // Validate the records and compute the vertex offsets.
+        const size_t recordCount = records.size();
+        const auto chunks = NumericRange<size_t>(0, (recordCount + kChunkSize - 1) / kChunkSize);
+        std::vector<uint32_t> vertexCounts(recordCount);
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
+        {
+            for (size_t i = chunk * kChunkSize; i < std::min(recordCount, (chunk + 1) * kChunkSize); i++) vertexCounts[i] = getValidVertexCount(records[i].pData, records[i].stride);
+        });
+
+        std::vector<uint32_t> pathOffsets(recordCount);
+        uint32_t pathCount = 0;
+        uint32_t vertexCount = 0;
+        std::vector<uint32_t> vertexOffsets(recordCount);
+        for (size_t i = 0; i < recordCount; i++)
+        {
+            pathOffsets[i] = pathCount;
+            vertexOffsets[i] = vertexCount;
+            if (vertexCounts[i] > 0) pathCount++;
+            else
+            {
+                uint32_t ticket;
+                std::memcpy(&ticket, records[i].pData, sizeof(ticket));
+                if (ticket != 0) mTornRecordCount++;
+            }
+            vertexCount += vertexCounts[i];
+        }
+
+        // Decode the vertices.
+        mPaths.resize(pathCount);
+        mVertices.resize(vertexCount);
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
+        {
+            for (size_t i = chunk * kChunkSize; i < std::min(recordCount, (chunk + 1) * kChunkSize); i++)
+            {
+                if (vertexCounts[i] == 0) continue;
+
+                PathDebugRecordHeader header;
+                std::memcpy(&header, records[i].pData, sizeof(header));
+
+                Path& path = mPaths[pathOffsets[i]];
+                path.frameIndex = records[i].frameIndex;
+                path.pathIndex = header.pathIndex;
+                path.firstVertex = vertexOffsets[i];
+                path.vertexCount = header.vertexCount;
+                path.missed = (header.flags & 1) != 0;
+
+                float3* pVertex = &mVertices[vertexOffsets[i]];
+                float3 prev = header.origin;
+                pVertex[0] = prev;
+                for (uint32_t j = 1; j < header.vertexCount; j++)
+                {
+                    uint2 v;
+                    std::memcpy(&v, records[i].pData + sizeof(header) + (j - 1) * sizeof(uint2), sizeof(v));
+                    const float3 value = f16tof32(uint3(v.x & 0xffff, v.x >> 16, v.y & 0xffff));
+
+                    // The last vertex of a missed path is the ray direction, all others are deltas to the previous vertex.
+                    if (path.missed && j + 1 == header.vertexCount) pVertex[j] = value;
+                    else pVertex[j] = prev = prev + value;
+                }
+            }
+        });
+    }
+
+    PathDump::Stats PathDump::computeStats() const
+    {
+        Stats stats;
+        stats.frameCount = mFrameCount;
+        stats.matchingPathCount = mMatchingPathCount;
+        stats.tornRecordCount = mTornRecordCount;
+        stats.pathCount = mPaths.size();
+
+        // Accumulate per chunk, then merge the chunks in order.
+        const size_t chunkCount = (mPaths.size() + kChunkSize - 1) / kChunkSize;
+        const auto chunks = NumericRange<size_t>(0, chunkCount);
+        std::vector<Stats> chunkStats(chunkCount);
+        std::vector<double> chunkLengths(chunkCount, 0.0);
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
+        {
+            Stats& s = chunkStats[chunk];
+            for (size_t i = chunk * kChunkSize; i < std::min(mPaths.size(), (chunk + 1) * kChunkSize); i++)
+            {
+                const Path& path = mPaths[i];
+                const uint32_t pointCount = path.missed ? path.vertexCount - 1 : path.vertexCount;
+                if (path.missed) s.missedPathCount++;
+                if (s.vertexCountHistogram.size() <= path.vertexCount) s.vertexCountHistogram.resize(path.vertexCount + 1, 0);
+                s.vertexCountHistogram[path.vertexCount]++;
+                s.meanVertexCount += path.vertexCount;
+
+                for (uint32_t j = 0; j < pointCount; j++)
+                {
+                    const float3& p = mVertices[path.firstVertex + j];
+                    s.bounds.include(p);
+                    if (j > 0) chunkLengths[chunk] += glm::length(p - mVertices[path.firstVertex + j - 1]);
+                }
+                s.segmentCount += pointCount > 0 ? pointCount - 1 : 0;
+            }
+        });
+
+        double totalLength = 0.0;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            const Stats& s = chunkStats[chunk];
+            stats.missedPathCount += s.missedPathCount;
+            stats.segmentCount += s.segmentCount;
+            stats.meanVertexCount += s.meanVertexCount;
+            stats.bounds.include(s.bounds);
+            if (stats.vertexCountHistogram.size() < s.vertexCountHistogram.size()) stats.vertexCountHistogram.resize(s.vertexCountHistogram.size(), 0);
+            for (size_t i = 0; i < s.vertexCountHistogram.size(); i++) stats.vertexCountHistogram[i] += s.vertexCountHistogram[i];
+            totalLength += chunkLengths[chunk];
+        }
+
+        if (stats.pathCount > 0) stats.meanVertexCount /= stats.pathCount;
+        if (stats.segmentCount > 0) stats.meanSegmentLength = totalLength / stats.segmentCount;
+
+        return stats;
+    }
+
+    pybind11::dict PathDump::Stats::toPython() const
+    {
+        pybind11::dict d;
+
+        d["frameCount"] = frameCount;
+        d["matchingPathCount"] = matchingPathCount;
+        d["pathCount"] = pathCount;
+        d["missedPathCount"] = missedPathCount;
+        d["tornRecordCount"] = tornRecordCount;
+        d["segmentCount"] = segmentCount;
+        d["meanVertexCount"] = meanVertexCount;
+        d["meanSegmentLength"] = meanSegmentLength;
+        d["vertexCountHistogram"] = vertexCountHistogram;
+        d["bounds"] = bounds;
+
+        return d;
+    }
+
+    SCRIPT_BINDING(PathDump)
+    {
+        pybind11::class_<PathDump, PathDump::SharedPtr> pathDump(m, "PathDump");
+        pathDump.def_static("load", &PathDump::load, "path"_a);
+        pathDump.def_property_readonly("pathCount", [](const PathDump& dump) { return dump.getPaths().size(); });
+        pathDump.def("computeStats", [](const PathDump& dump) { return dump.computeStats().toPython(); });
+    }
+}
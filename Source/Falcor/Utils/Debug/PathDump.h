@@ -0,0 +1,154 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "PathDebugData.slang"
+#include "Utils/Math/AABB.h"
+#include <fstream>
+
+namespace Falcor
+{
+    /** Light paths recorded by PathDebug in compact recording mode.
+
+        The paths are streamed to disk frame by frame, and can be loaded and analysed on the CPU.
+        The file starts with a FileHeader, followed by one FrameHeader per frame, each directly followed by
+        the frame's records. The records are stored as read back from the GPU (see PathDebugRecordHeader).
+    */
+    class dlldecl PathDump
+    {
+    public:
+        using SharedPtr = std::shared_ptr<PathDump>;
+
+        static const uint32_t kMagic = 0x44445046;  ///< 'FPDD'
+        static const uint32_t kVersion = 1;
+
+        struct FileHeader
+        {
+            uint32_t magic = kMagic;
+            uint32_t version = kVersion;
+        };
+
+        struct FrameHeader
+        {
+            uint32_t frameIndex = 0;        ///< Index of the frame the paths were recorded in.
+            uint32_t matchingPathCount = 0; ///< Number of paths that passed the filter, before reservoir sampling.
+            uint32_t recordCount = 0;       ///< Number of records following the header.
+            uint32_t recordStride = 0;      ///< Size of a record in bytes.
+        };
+
+        /** Decoded light path.
+        */
+        struct Path
+        {
+            uint32_t frameIndex = 0;        ///< Index of the frame the path was recorded in.
+            uint32_t pathIndex = 0;         ///< Index of the light path within the frame.
+            uint32_t firstVertex = 0;       ///< Index of the first vertex in the vertex list.
+            uint32_t vertexCount = 0;       ///< Number of vertices, including the origin.
+            bool missed = false;            ///< True if the path ended with a miss. The last vertex is then the ray direction.
+        };
+
+        /** Path statistics.
+        */
+        struct Stats
+        {
+            uint32_t frameCount = 0;                    ///< Number of recorded frames.
+            uint64_t matchingPathCount = 0;             ///< Number of paths that passed the filter, before reservoir sampling.
+            uint64_t pathCount = 0;                     ///< Number of recorded paths.
+            uint64_t missedPathCount = 0;               ///< Number of recorded paths ending with a miss.
+            uint64_t tornRecordCount = 0;               ///< Number of records dropped because they were overwritten concurrently on the GPU.
+            uint64_t segmentCount = 0;                  ///< Number of segments between hits.
+            double meanVertexCount = 0.0;               ///< Average number of vertices per path.
+            double meanSegmentLength = 0.0;             ///< Average length of the segments between hits.
+            std::vector<uint64_t> vertexCountHistogram; ///< Number of paths per vertex count.
+            AABB bounds;                                ///< Bounds of all path vertices (ray directions excluded).
+
+            /** Convert to python dict.
+            */
+            pybind11::dict toPython() const;
+        };
+
+        /** Writes frames of records to a dump file.
+        */
+        class dlldecl Writer
+        {
+        public:
+            using SharedPtr = std::shared_ptr<Writer>;
+
+            /** Create a dump file.
+                \param[in] path File path.
+                \return New object, or throws an exception if the file can't be created.
+            */
+            static SharedPtr create(const std::string& path);
+
+            /** Append the records of a frame.
+                \param[in] header Frame header.
+                \param[in] pRecords Records, header.recordCount * header.recordStride bytes.
+            */
+            void writeFrame(const FrameHeader& header, const void* pRecords);
+
+            const std::string& getPath() const { return mPath; }
+            uint32_t getFrameCount() const { return mFrameCount; }
+
+        private:
+            Writer(const std::string& path);
+
+            std::string mPath;
+            std::ofstream mStream;
+            uint32_t mFrameCount = 0;
+        };
+
+        /** Load a dump file and decode all paths.
+            \param[in] path File path.
+            \return New object, or throws an exception if the file can't be read.
+        */
+        static SharedPtr load(const std::string& path);
+
+        /** Decode the records of a single frame, as read back from the GPU or stored in a dump file.
+            \param[in] header Frame header.
+            \param[in] pRecords Records, header.recordCount * header.recordStride bytes.
+            \return Object holding the decoded paths.
+        */
+        static SharedPtr decode(const FrameHeader& header, const void* pRecords);
+
+        const std::vector<Path>& getPaths() const { return mPaths; }
+        const std::vector<float3>& getVertices() const { return mVertices; }
+
+        /** Compute statistics of the decoded paths.
+        */
+        Stats computeStats() const;
+
+    private:
+        PathDump() = default;
+        void decodeFrames(const std::vector<std::pair<FrameHeader, const uint8_t*>>& frames);
+
+        std::vector<Path> mPaths;
+        std::vector<float3> mVertices;
+        uint32_t mFrameCount = 0;
+        uint64_t mMatchingPathCount = 0;
+        uint64_t mTornRecordCount = 0;
+    };
+}
@@ -0,0 +1,90 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+    /** Initial value of a 64-bit FNV-1a hash.
+    */
+    static const uint64_t kFnvOffsetBasis64 = 0xcbf29ce484222325ull;
+
+    /** Continues a 64-bit hash (FNV-1a over 64-bit words) with a block of data.
+        The last word is zero padded, and the size of the block is hashed after the data.
+        \param[in] hash Hash to continue, or kFnvOffsetBasis64 to start a new hash.
+        \param[in] pData Data to hash.
+        \param[in] size Size of the data in bytes.
+        \return The updated hash.
+    */
+    inline uint64_t fnvHashData(uint64_t hash, const void* pData, size_t size)
+    {
+        const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+        for (size_t offset = 0; offset < size; offset += sizeof(uint64_t))
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, pBytes + offset, std::min(sizeof(uint64_t), size - offset));
+            hash = (hash ^ word) * 0x100000001b3ull;
+        }
+        return (hash ^ size) * 0x100000001b3ull;
+    }
+
+    /** Continues a 64-bit hash with the bytes of a value, see fnvHashData().
+    */
+    template<typename T>
+    uint64_t fnvHashValue(uint64_t hash, const T& value)
+    {
+        return fnvHashData(hash, &value, sizeof(T));
+    }
+
+    /** Computes a 64-bit hash of the content of a file, see fnvHashData().
+        \param[in] path Path of the file.
+        \param[out] hash Hash of the file content.
+        \return True if the file was read successfully.
+    */
+    inline bool fnvHashFile(const std::string& path, uint64_t& hash)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return false;
+
+        hash = kFnvOffsetBasis64;
+        std::vector<char> buffer(1 << 20);
+        while (file)
+        {
+            file.read(buffer.data(), buffer.size());
+            size_t bytes = (size_t)file.gcount();
+            if (bytes == 0) break;
+            hash = fnvHashData(hash, buffer.data(), bytes);
+        }
+        return !file.bad();
+    }
+}
@@ -27,10 +27,14 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "Bitmap.h"
+#include "ImageDecoder.h"
+#include "PixelConversion.h"
 #include "Core/API/Texture.h"
 #include "Utils/StringUtils.h"
 
 #include <FreeImage.h>
+#include <execution>
+#include <filesystem>
 
 namespace Falcor
 {
@@ -50,6 +54,22 @@ namespace Falcor
         logWarning(err);
     }
 
+    static std::mutex sLoadStatsMutex;
+    static std::map<std::string, Bitmap::LoadStats> sLoadStats;
+
+    static void recordLoad(const std::string& formatName, uint64_t fileBytes, uint64_t pixelCount, CpuTimer::TimePoint startTime, bool usedDecoder)
+    {
+        const double loadTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) * 1e-3;
+
+        std::lock_guard<std::mutex> lock(sLoadStatsMutex);
+        auto& stats = sLoadStats[formatName];
+        stats.fileCount++;
+        if (usedDecoder) stats.decoderFileCount++;
+        stats.fileBytes += fileBytes;
+        stats.pixelCount += pixelCount;
+        stats.loadTime += loadTime;
+    }
+
     static bool isConvertibleToRGBA32Float(ResourceFormat format)
     {
         FormatType type = getFormatType(format);
@@ -62,17 +82,28 @@ namespace Falcor
     */
     static std::vector<float> convertHalfToRGBA32Float(uint32_t width, uint32_t height, uint32_t channelCount, const void* pData)
     {
-        std::vector<float> newData(width * height * 4u, 0.f);
-        const glm::detail::hdata* pSrc = reinterpret_cast<const glm::detail::hdata*>(pData);
-        float* pDst = newData.data();
+        const size_t pixelCount = size_t(width) * height;
+        const uint16_t* pSrc = reinterpret_cast<const uint16_t*>(pData);
+        std::vector<float> newData(pixelCount * 4u, 0.f);
 
-        for (uint32_t i = 0; i < width * height; ++i)
+        if (channelCount == 4)
         {
-            for (uint32_t c = 0; c < channelCount; ++c)
+            convertHalfToFloat(pSrc, newData.data(), newData.size());
+            return newData;
+        }
+
+        std::vector<float> floatData(pixelCount * channelCount);
+        convertHalfToFloat(pSrc, floatData.data(), floatData.size());
+        if (channelCount == 3)
+        {
+            convertRGBToRGBA32Float(floatData.data(), newData.data(), pixelCount);
+        }
+        else
+        {
+            for (size_t i = 0; i < pixelCount; ++i)
             {
-                *pDst++ = glm::detail::toFloat32(*pSrc++);
+                for (uint32_t c = 0; c < channelCount; ++c) newData[i * 4 + c] = floatData[i * channelCount + c];
             }
-            pDst += (4 - channelCount);
         }
 
         return newData;
@@ -146,41 +177,36 @@ namespace Falcor
         return floatData;
     }
 
-    /** Converts 96bpp to 128bpp RGBA without clamping.
+    /** Copies the pixels of a FreeImage bitmap, with the same result as FreeImage_ConvertToRawBits() but with rows converted in parallel.
+        24bpp BGR pixels are expanded to 32bpp BGRX. 96bpp RGB pixels are expanded to 128bpp RGBA with an alpha of 1, without clamping.
         Note that we can't use FreeImage_ConvertToRGBAF() as it clamps to [0,1].
     */
-    static FIBITMAP* convertToRGBAF(FIBITMAP* pDib)
+    static void copyPixels(FIBITMAP* pDib, uint8_t* pDst, uint32_t dstRowPitch, uint32_t dstBpp, bool isTopDown)
     {
-        const unsigned width = FreeImage_GetWidth(pDib);
-        const unsigned height = FreeImage_GetHeight(pDib);
-
-        auto pNew = FreeImage_AllocateT(FIT_RGBAF, width, height);
-        FreeImage_CloneMetadata(pNew, pDib);
-
-        const unsigned src_pitch = FreeImage_GetPitch(pDib);
-        const unsigned dst_pitch = FreeImage_GetPitch(pNew);
+        const uint32_t width = FreeImage_GetWidth(pDib);
+        const uint32_t height = FreeImage_GetHeight(pDib);
+        const uint32_t srcBpp = FreeImage_GetBPP(pDib);
+        const uint32_t lineSize = FreeImage_GetLine(pDib);
 
-        const BYTE *src_bits = (BYTE*)FreeImage_GetBits(pDib);
-        BYTE* dst_bits = (BYTE*)FreeImage_GetBits(pNew);
+        // Process rows in tasks of at least 256kB to keep small images on one thread.
+        const uint32_t rowsPerTask = std::max((1u << 18) / std::max(lineSize, 1u), 1u);
+        const auto tasks = NumericRange<uint32_t>(0, (height + rowsPerTask - 1) / rowsPerTask);
 
-        for (unsigned y = 0; y < height; y++)
+        std::for_each(std::execution::par, tasks.begin(), tasks.end(), [&](uint32_t task)
         {
-            const FIRGBF *src_pixel = (FIRGBF*)src_bits;
-            FIRGBAF* dst_pixel = (FIRGBAF*)dst_bits;
-
-            for (unsigned x = 0; x < width; x++)
+            const uint32_t begin = task * rowsPerTask;
+            const uint32_t end = std::min(begin + rowsPerTask, height);
+            for (uint32_t y = begin; y < end; y++)
             {
-                // Convert pixels directly, while adding a "dummy" alpha of 1.0
-                dst_pixel[x].red = src_pixel[x].red;
-                dst_pixel[x].green = src_pixel[x].green;
-                dst_pixel[x].blue = src_pixel[x].blue;
-                dst_pixel[x].alpha = 1.0F;
+                // FreeImage stores the bottom row first.
+                const uint8_t* pSrcRow = FreeImage_GetScanLine(pDib, isTopDown ? height - 1 - y : y);
+                uint8_t* pDstRow = pDst + size_t(y) * dstRowPitch;
 
+                if (srcBpp == 24 && dstBpp == 32) convertBGRToBGRX8(pSrcRow, pDstRow, width);
+                else if (srcBpp == 96 && dstBpp == 128) convertRGBToRGBA32Float(reinterpret_cast<const float*>(pSrcRow), reinterpret_cast<float*>(pDstRow), width);
+                else std::memcpy(pDstRow, pSrcRow, lineSize);
             }
-            src_bits += src_pitch;
-            dst_bits += dst_pitch;
-        }
-        return pNew;
+        });
     }
 
     Bitmap::UniqueConstPtr Bitmap::create(uint32_t width, uint32_t height, ResourceFormat format, const uint8_t* pData)
@@ -188,6 +214,18 @@ namespace Falcor
         return Bitmap::UniqueConstPtr(new Bitmap(width, height, format, pData));
     }
 
+    std::map<std::string, Bitmap::LoadStats> Bitmap::getLoadStats()
+    {
+        std::lock_guard<std::mutex> lock(sLoadStatsMutex);
+        return sLoadStats;
+    }
+
+    void Bitmap::resetLoadStats()
+    {
+        std::lock_guard<std::mutex> lock(sLoadStatsMutex);
+        sLoadStats.clear();
+    }
+
     Bitmap::UniqueConstPtr Bitmap::createFromFile(const std::string& filename, bool isTopDown)
     {
         std::string fullpath;
@@ -219,6 +257,28 @@ namespace Falcor
             return nullptr;
         }
 
+        const auto startTime = CpuTimer::getCurrentTimePoint();
+        const std::string formatName = FreeImage_GetFormatFromFIF(fifFormat);
+
+        // Decode EXR and HDR files with the parallel decoders. Files using features they don't support are loaded with FreeImage.
+        std::unique_ptr<ImageDecoder> pDecoder;
+        if (fifFormat == FIF_EXR) pDecoder = ImageDecoder::create(ImageDecoder::Format::Exr);
+        else if (fifFormat == FIF_HDR) pDecoder = ImageDecoder::create(ImageDecoder::Format::Hdr);
+
+        // The decoders always produce RGBA. Images without alpha are loaded as RGB32Float by FreeImage where that format is supported.
+        if (pDecoder && pDecoder->open(fullpath) && (pDecoder->hasAlpha() || isRGB32fSupported() == false))
+        {
+            const uint32_t width = pDecoder->getWidth();
+            const uint32_t height = pDecoder->getHeight();
+            UniqueConstPtr pBmp = UniqueConstPtr(new Bitmap(width, height, ResourceFormat::RGBA32Float));
+            if (pDecoder->decode(pBmp->getData(), pBmp->getRowPitch(), isTopDown))
+            {
+                recordLoad(formatName, pDecoder->getFileSize(), uint64_t(width) * height, startTime, true);
+                return pBmp;
+            }
+        }
+        pDecoder.reset(); // Release the file data before loading with FreeImage.
+
         // Read the DIB
         FIBITMAP* pDib = FreeImage_Load(fifFormat, fullpath.c_str());
         if (pDib == nullptr)
@@ -285,25 +345,31 @@ namespace Falcor
             return nullptr;
         }
 
-        // Convert the image to RGBX image
+        // Expand RGB images to RGBX or RGBA. This is done while copying the pixels below.
         if (bpp == 24)
         {
             bpp = 32;
-            auto pNew = FreeImage_ConvertTo32Bits(pDib);
-            FreeImage_Unload(pDib);
-            pDib = pNew;
         }
         else if (bpp == 96 && (isRGB32fSupported() == false))
         {
             bpp = 128;
-            auto pNew = convertToRGBAF(pDib);
-            FreeImage_Unload(pDib);
-            pDib = pNew;
         }
 
         UniqueConstPtr pBmp = UniqueConstPtr(new Bitmap(width, height, format));
-        FreeImage_ConvertToRawBits(pBmp->getData(), pDib, pBmp->getRowPitch(), bpp, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, isTopDown);
+        if (bpp == 16)
+        {
+            // FreeImage converts between 555 and 565 layouts for 16bpp images.
+            FreeImage_ConvertToRawBits(pBmp->getData(), pDib, pBmp->getRowPitch(), bpp, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, isTopDown);
+        }
+        else
+        {
+            copyPixels(pDib, pBmp->getData(), pBmp->getRowPitch(), bpp, isTopDown);
+        }
         FreeImage_Unload(pDib);
+
+        std::error_code ec;
+        const uint64_t fileBytes = std::filesystem::file_size(fullpath, ec);
+        recordLoad(formatName, ec ? 0 : fileBytes, uint64_t(width) * height, startTime, false);
         return pBmp;
     }
 
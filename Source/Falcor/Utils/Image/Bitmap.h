@@ -59,6 +59,25 @@ namespace Falcor
         using UniquePtr = std::unique_ptr<Bitmap>;
         using UniqueConstPtr = std::unique_ptr<const Bitmap>;
 
+        /** Statistics of the images loaded with createFromFile() for one file format.
+        */
+        struct LoadStats
+        {
+            uint64_t fileCount = 0;         ///< Number of loaded files.
+            uint64_t decoderFileCount = 0;  ///< Number of files loaded with the parallel decoders instead of FreeImage.
+            uint64_t fileBytes = 0;         ///< Total size of the loaded files in bytes.
+            uint64_t pixelCount = 0;        ///< Total number of loaded pixels.
+            double loadTime = 0.0;          ///< Total load time in seconds.
+
+            /** Get the load throughput in megabytes of file data per second.
+            */
+            double getMegabytesPerSecond() const { return loadTime > 0.0 ? fileBytes / (loadTime * 1e6) : 0.0; }
+
+            /** Get the load throughput in megapixels per second.
+            */
+            double getMegapixelsPerSecond() const { return loadTime > 0.0 ? pixelCount / (loadTime * 1e6) : 0.0; }
+        };
+
         /** Create from memory.
             \param[in] width Width in pixels.
             \param[in] height Height in pixels
@@ -75,6 +94,16 @@ namespace Falcor
         */
         static UniqueConstPtr createFromFile(const std::string& filename, bool isTopDown);
 
+        /** Get the statistics of all images loaded with createFromFile() since startup or the last call to resetLoadStats().
+            Safe to call from any thread.
+            \return Statistics per file format, keyed by the format name (e.g. "EXR", "PNG").
+        */
+        static std::map<std::string, LoadStats> getLoadStats();
+
+        /** Reset the load statistics.
+        */
+        static void resetLoadStats();
+
         /** Store a memory buffer to a file.
             \param[in] filename Output filename. Can include a path - absolute or relative to the executable directory.
             \param[in] width The width of the image.
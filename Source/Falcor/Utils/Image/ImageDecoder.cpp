@@ -0,0 +1,583 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "ImageDecoder.h"
+#include "PixelConversion.h"
+#include <FreeImage.h>
+#include <execution>
+#include <fstream>
+#include <sstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Bounds-checked reader for little-endian file data.
+        */
+        class Reader
+        {
+        public:
+            Reader(const uint8_t* pData, size_t size, size_t offset = 0) : mpData(pData), mSize(size), mOffset(offset) {}
+
+            template<typename T>
+            bool read(T& value)
+            {
+                if (remaining() < sizeof(T)) return false;
+                std::memcpy(&value, mpData + mOffset, sizeof(T));
+                mOffset += sizeof(T);
+                return true;
+            }
+
+            /** Read a null-terminated string.
+            */
+            bool readString(std::string& str)
+            {
+                const uint8_t* pEnd = static_cast<const uint8_t*>(std::memchr(mpData + mOffset, 0, remaining()));
+                if (!pEnd) return false;
+                str.assign(reinterpret_cast<const char*>(mpData + mOffset), pEnd - (mpData + mOffset));
+                mOffset += str.size() + 1;
+                return true;
+            }
+
+            /** Read a line terminated by a newline, which is not included in the string.
+            */
+            bool readLine(std::string& str)
+            {
+                const uint8_t* pEnd = static_cast<const uint8_t*>(std::memchr(mpData + mOffset, '\n', remaining()));
+                if (!pEnd) return false;
+                str.assign(reinterpret_cast<const char*>(mpData + mOffset), pEnd - (mpData + mOffset));
+                mOffset += str.size() + 1;
+                return true;
+            }
+
+            /** Skip bytes.
+                \return Pointer to the skipped bytes, or nullptr if there are not enough bytes left.
+            */
+            const uint8_t* skip(size_t size)
+            {
+                if (remaining() < size) return nullptr;
+                const uint8_t* p = mpData + mOffset;
+                mOffset += size;
+                return p;
+            }
+
+            size_t getOffset() const { return mOffset; }
+            size_t remaining() const { return mOffset < mSize ? mSize - mOffset : 0; }
+
+        private:
+            const uint8_t* mpData;
+            size_t mSize;
+            size_t mOffset;
+        };
+
+        // Largest image we decode. Bitmap stores its size in 32 bits.
+        const uint64_t kMaxImageBytes = std::numeric_limits<uint32_t>::max();
+
+        bool isValidImageSize(int64_t width, int64_t height)
+        {
+            const int64_t maxPixels = kMaxImageBytes / (4 * sizeof(float));
+            return width > 0 && height > 0 && width <= maxPixels && height <= maxPixels / width;
+        }
+
+        float* getDstRow(uint8_t* pDst, uint32_t rowPitch, uint32_t height, uint32_t y, bool isTopDown)
+        {
+            return reinterpret_cast<float*>(pDst + size_t(isTopDown ? y : height - 1 - y) * rowPitch);
+        }
+
+        /** OpenEXR decoder.
+            See the OpenEXR file layout documentation for the format. Files are decoded chunk by chunk using the offset table.
+        */
+        class ExrDecoder : public ImageDecoder
+        {
+        public:
+            bool decode(uint8_t* pDst, uint32_t rowPitch, bool isTopDown) const override;
+
+        protected:
+            bool parseHeader() override;
+
+        private:
+            enum class Compression : uint8_t
+            {
+                None = 0,
+                RLE = 1,
+                ZIPS = 2,
+                ZIP = 3,
+            };
+
+            enum class PixelType : int32_t
+            {
+                Uint = 0,
+                Half = 1,
+                Float = 2,
+            };
+
+            struct Channel
+            {
+                PixelType type;
+                uint32_t offset;    ///< Offset in bytes of the channel in a pixel. The channel starts at width * offset in each line.
+            };
+
+            bool parseChannels(Reader& r);
+            bool uncompress(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize, std::vector<uint8_t>& scratch) const;
+            bool decodeChunk(size_t index, uint8_t* pDst, uint32_t rowPitch, bool isTopDown, std::vector<uint8_t>& unpacked, std::vector<uint8_t>& scratch, std::vector<float>& planes) const;
+
+            static const uint32_t kMagic = 20000630;
+            static const uint32_t kVersionTiled = 0x200;
+            static const uint32_t kVersionDeep = 0x800;
+            static const uint32_t kVersionMultipart = 0x1000;
+
+            std::vector<Channel> mChannels;
+            int32_t mRGBA[4] = { -1, -1, -1, -1 };  ///< Index in mChannels of the R, G, B and A channels, or -1 if not present.
+            uint32_t mPixelSize = 0;                ///< Size of all channels of a pixel in bytes.
+            Compression mCompression = Compression::None;
+            uint32_t mLinesPerBlock = 1;
+            bool mIsTiled = false;
+            uint32_t mTileWidth = 0;
+            uint32_t mTileHeight = 0;
+            uint32_t mTileCountX = 0;
+            int32_t mMinY = 0;
+            std::vector<uint64_t> mOffsets;         ///< File offsets of the scanline blocks or level 0 tiles.
+        };
+
+        bool ExrDecoder::parseChannels(Reader& r)
+        {
+            mChannels.clear();
+            std::fill(std::begin(mRGBA), std::end(mRGBA), -1);
+            mPixelSize = 0;
+            while (true)
+            {
+                std::string name;
+                if (!r.readString(name)) return false;
+                if (name.empty()) break;
+
+                PixelType type;
+                int32_t xSampling, ySampling;
+                if (!r.read(type) || !r.skip(4) || !r.read(xSampling) || !r.read(ySampling)) return false;
+                if (type != PixelType::Uint && type != PixelType::Half && type != PixelType::Float) return false;
+                if (xSampling != 1 || ySampling != 1) return false;
+
+                const char* kNames[] = { "R", "G", "B", "A" };
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    if (name != kNames[c]) continue;
+                    if (type == PixelType::Uint) return false;
+                    mRGBA[c] = (int32_t)mChannels.size();
+                }
+
+                mChannels.push_back({ type, mPixelSize });
+                mPixelSize += type == PixelType::Half ? 2 : 4;
+            }
+            return true;
+        }
+
+        bool ExrDecoder::parseHeader()
+        {
+            Reader r(mData.data(), mData.size());
+            uint32_t magic, version;
+            if (!r.read(magic) || !r.read(version)) return false;
+            if (magic != kMagic || (version & 0xff) != 2) return false;
+            if (version & (kVersionDeep | kVersionMultipart)) return false;
+            mIsTiled = (version & kVersionTiled) != 0;
+
+            bool hasChannels = false, hasCompression = false, hasDataWindow = false, hasTiles = false;
+            int32_t minX = 0, maxX = 0, maxY = 0;
+            while (true)
+            {
+                std::string name, type;
+                if (!r.readString(name)) return false;
+                if (name.empty()) break;
+
+                int32_t size;
+                if (!r.readString(type) || !r.read(size) || size < 0) return false;
+                const uint8_t* pAttribute = r.skip(size);
+                if (!pAttribute) return false;
+                Reader a(pAttribute, size);
+
+                if (name == "channels" && type == "chlist")
+                {
+                    if (!parseChannels(a)) return false;
+                    hasChannels = true;
+                }
+                else if (name == "compression" && type == "compression")
+                {
+                    if (!a.read(mCompression)) return false;
+                    hasCompression = true;
+                }
+                else if (name == "dataWindow" && type == "box2i")
+                {
+                    if (!a.read(minX) || !a.read(mMinY) || !a.read(maxX) || !a.read(maxY)) return false;
+                    hasDataWindow = true;
+                }
+                else if (name == "tiles" && type == "tiledesc")
+                {
+                    uint8_t mode;
+                    if (!a.read(mTileWidth) || !a.read(mTileHeight) || !a.read(mode)) return false;
+                    // Only level 0 is decoded, which is stored first for both single level and mipmapped files. Ripmaps are not supported.
+                    if ((mode & 0xf) > 1 || mTileWidth == 0 || mTileHeight == 0) return false;
+                    hasTiles = true;
+                }
+            }
+
+            if (!hasChannels || !hasCompression || !hasDataWindow || (mIsTiled && !hasTiles)) return false;
+            if (mRGBA[0] < 0 || mRGBA[1] < 0 || mRGBA[2] < 0) return false;
+            mHasAlpha = mRGBA[3] >= 0;
+
+            switch (mCompression)
+            {
+            case Compression::None:
+            case Compression::RLE:
+            case Compression::ZIPS:
+                mLinesPerBlock = 1;
+                break;
+            case Compression::ZIP:
+                mLinesPerBlock = 16;
+                break;
+            default:
+                return false;
+            }
+
+            const int64_t width = int64_t(maxX) - minX + 1;
+            const int64_t height = int64_t(maxY) - mMinY + 1;
+            if (!isValidImageSize(width, height)) return false;
+            mWidth = (uint32_t)width;
+            mHeight = (uint32_t)height;
+
+            size_t chunkCount = 0;
+            if (mIsTiled)
+            {
+                mTileCountX = (mWidth + mTileWidth - 1) / mTileWidth;
+                chunkCount = size_t(mTileCountX) * ((mHeight + mTileHeight - 1) / mTileHeight);
+            }
+            else
+            {
+                chunkCount = (mHeight + mLinesPerBlock - 1) / mLinesPerBlock;
+            }
+
+            mOffsets.resize(chunkCount);
+            for (auto& offset : mOffsets)
+            {
+                // A zero offset marks a chunk that was never written (incomplete file).
+                if (!r.read(offset) || offset == 0 || offset >= mData.size()) return false;
+            }
+            return true;
+        }
+
+        bool ExrDecoder::uncompress(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize, std::vector<uint8_t>& scratch) const
+        {
+            scratch.resize(dstSize);
+            uint8_t* pTmp = scratch.data();
+
+            if (mCompression == Compression::RLE)
+            {
+                // Runs are encoded with a signed count. Negative: -count literal bytes follow. Non-negative: the next byte is repeated count + 1 times.
+                size_t in = 0, out = 0;
+                while (in < srcSize)
+                {
+                    const int count = (int8_t)pSrc[in++];
+                    if (count < 0)
+                    {
+                        if (srcSize - in < size_t(-count) || dstSize - out < size_t(-count)) return false;
+                        std::memcpy(pTmp + out, pSrc + in, -count);
+                        in += -count;
+                        out += -count;
+                    }
+                    else
+                    {
+                        if (in >= srcSize || dstSize - out < size_t(count + 1)) return false;
+                        std::memset(pTmp + out, pSrc[in++], count + 1);
+                        out += count + 1;
+                    }
+                }
+                if (out != dstSize) return false;
+            }
+            else if (mCompression == Compression::ZIPS || mCompression == Compression::ZIP)
+            {
+                if (FreeImage_ZLibUncompress(pTmp, (DWORD)dstSize, const_cast<BYTE*>(pSrc), (DWORD)srcSize) != dstSize) return false;
+            }
+            else
+            {
+                return false;
+            }
+
+            // Undo the byte predictor.
+            for (size_t i = 1; i < dstSize; i++) pTmp[i] = uint8_t(int(pTmp[i - 1]) + int(pTmp[i]) - 128);
+
+            // Interleave the two halves of the buffer.
+            const uint8_t* pLo = pTmp;
+            const uint8_t* pHi = pTmp + (dstSize + 1) / 2;
+            for (size_t i = 0; i < dstSize; i++) pDst[i] = (i & 1) ? *pHi++ : *pLo++;
+            return true;
+        }
+
+        bool ExrDecoder::decodeChunk(size_t index, uint8_t* pDst, uint32_t rowPitch, bool isTopDown, std::vector<uint8_t>& unpacked, std::vector<uint8_t>& scratch, std::vector<float>& planes) const
+        {
+            Reader r(mData.data(), mData.size(), mOffsets[index]);
+            uint32_t x0 = 0, y0 = 0, width = 0, lineCount = 0;
+            if (mIsTiled)
+            {
+                int32_t tileX, tileY, levelX, levelY;
+                if (!r.read(tileX) || !r.read(tileY) || !r.read(levelX) || !r.read(levelY)) return false;
+                if (tileX < 0 || tileY < 0 || uint32_t(tileX) >= mTileCountX || levelX != 0 || levelY != 0) return false;
+                if (size_t(tileY) * mTileCountX + tileX != index) return false;
+                x0 = tileX * mTileWidth;
+                y0 = tileY * mTileHeight;
+                width = std::min(mTileWidth, mWidth - x0);
+                lineCount = std::min(mTileHeight, mHeight - y0);
+            }
+            else
+            {
+                int32_t y;
+                if (!r.read(y) || int64_t(y) - mMinY != int64_t(index) * mLinesPerBlock) return false;
+                y0 = uint32_t(index) * mLinesPerBlock;
+                width = mWidth;
+                lineCount = std::min(mLinesPerBlock, mHeight - y0);
+            }
+
+            int32_t packedSize;
+            if (!r.read(packedSize) || packedSize < 0) return false;
+            const uint8_t* pPacked = r.skip(packedSize);
+            if (!pPacked) return false;
+
+            // Blocks that don't compress are stored as is, whatever the compression of the file.
+            const size_t lineSize = size_t(width) * mPixelSize;
+            const size_t size = lineCount * lineSize;
+            const uint8_t* pData = pPacked;
+            if (size_t(packedSize) < size)
+            {
+                unpacked.resize(size);
+                if (!uncompress(pPacked, packedSize, unpacked.data(), size, scratch)) return false;
+                pData = unpacked.data();
+            }
+            else if (size_t(packedSize) != size)
+            {
+                return false;
+            }
+
+            planes.resize(4 * size_t(width));
+            for (uint32_t line = 0; line < lineCount; line++)
+            {
+                const uint8_t* pLine = pData + line * lineSize;
+                const float* pPlanes[4] = {};
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    if (mRGBA[c] < 0) continue;
+                    const Channel& channel = mChannels[mRGBA[c]];
+                    const uint8_t* pSrc = pLine + size_t(width) * channel.offset;
+                    float* pPlane = planes.data() + size_t(c) * width;
+                    if (channel.type == PixelType::Half) convertHalfToFloat(reinterpret_cast<const uint16_t*>(pSrc), pPlane, width);
+                    else std::memcpy(pPlane, pSrc, width * sizeof(float));
+                    pPlanes[c] = pPlane;
+                }
+
+                float* pRow = getDstRow(pDst, rowPitch, mHeight, y0 + line, isTopDown) + 4 * size_t(x0);
+                interleaveRGBA32Float(pPlanes[0], pPlanes[1], pPlanes[2], pPlanes[3], pRow, width);
+            }
+            return true;
+        }
+
+        bool ExrDecoder::decode(uint8_t* pDst, uint32_t rowPitch, bool isTopDown) const
+        {
+            // Scanline files with one line per block are decoded in batches to amortize the scratch allocations.
+            const size_t chunksPerTask = mIsTiled ? 1 : std::max(16u / mLinesPerBlock, 1u);
+            const auto tasks = NumericRange<size_t>(0, (mOffsets.size() + chunksPerTask - 1) / chunksPerTask);
+
+            std::atomic<bool> success = true;
+            std::for_each(std::execution::par, tasks.begin(), tasks.end(), [&](size_t task)
+            {
+                std::vector<uint8_t> unpacked, scratch;
+                std::vector<float> planes;
+                const size_t end = std::min((task + 1) * chunksPerTask, mOffsets.size());
+                for (size_t i = task * chunksPerTask; i < end && success; i++)
+                {
+                    if (!decodeChunk(i, pDst, rowPitch, isTopDown, unpacked, scratch, planes)) success = false;
+                }
+            });
+            return success;
+        }
+
+        /** Radiance HDR decoder.
+            Scanlines are located with a quick pass over the run-length headers and then decoded in parallel.
+        */
+        class HdrDecoder : public ImageDecoder
+        {
+        public:
+            bool decode(uint8_t* pDst, uint32_t rowPitch, bool isTopDown) const override;
+
+        protected:
+            bool parseHeader() override;
+
+        private:
+            void decodeScanline(uint32_t y, uint8_t* pPlanes) const;
+
+            bool mIsFlat = false;                   ///< True if pixels are stored without run-length encoding.
+            size_t mPixelOffset = 0;                ///< File offset of the pixel data.
+            std::vector<size_t> mScanlineOffsets;   ///< File offsets of the scanlines.
+        };
+
+        bool HdrDecoder::parseHeader()
+        {
+            Reader r(mData.data(), mData.size());
+            std::string line;
+            if (!r.readLine(line) || line.compare(0, 2, "#?") != 0) return false;
+            while (true)
+            {
+                if (!r.readLine(line)) return false;
+                if (line.empty()) break;
+                if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe") return false;
+            }
+
+            // Only the standard orientation is supported, with the top scanline first.
+            if (!r.readLine(line)) return false;
+            std::istringstream resolution(line);
+            std::string axisY, axisX;
+            int64_t width = 0, height = 0;
+            resolution >> axisY >> height >> axisX >> width;
+            if (!resolution || axisY != "-Y" || axisX != "+X") return false;
+            if (!isValidImageSize(width, height)) return false;
+            mWidth = (uint32_t)width;
+            mHeight = (uint32_t)height;
+
+            // Scanlines of width 8 to 32767 may be run-length encoded, which is marked by a header of 2, 2 and the width.
+            // Files without the header on the first scanline store flat RGBE pixels.
+            mPixelOffset = r.getOffset();
+            const uint8_t* p = mData.data() + mPixelOffset;
+            const size_t remaining = r.remaining();
+            mIsFlat = mWidth < 8 || mWidth > 0x7fff || remaining < 4 || p[0] != 2 || p[1] != 2 || (p[2] & 0x80) != 0;
+            if (mIsFlat) return remaining >= size_t(mWidth) * mHeight * 4;
+
+            mScanlineOffsets.resize(mHeight);
+            for (uint32_t y = 0; y < mHeight; y++)
+            {
+                mScanlineOffsets[y] = r.getOffset();
+                uint8_t header[4];
+                if (!r.read(header) || header[0] != 2 || header[1] != 2 || ((header[2] << 8) | header[3]) != (int)mWidth) return false;
+
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    for (uint32_t x = 0; x < mWidth;)
+                    {
+                        uint8_t count;
+                        if (!r.read(count)) return false;
+                        // Counts above 128 repeat the next byte count - 128 times, other counts are followed by count literal bytes.
+                        const uint32_t run = count > 128 ? count - 128 : count;
+                        if (run == 0 || x + run > mWidth || !r.skip(count > 128 ? 1 : run)) return false;
+                        x += run;
+                    }
+                }
+            }
+            return true;
+        }
+
+        void HdrDecoder::decodeScanline(uint32_t y, uint8_t* pPlanes) const
+        {
+            if (mIsFlat)
+            {
+                const uint8_t* pSrc = mData.data() + mPixelOffset + size_t(y) * mWidth * 4;
+                for (uint32_t x = 0; x < mWidth; x++)
+                {
+                    for (uint32_t c = 0; c < 4; c++) pPlanes[c * mWidth + x] = pSrc[4 * x + c];
+                }
+                return;
+            }
+
+            // The run lengths were validated by parseHeader().
+            const uint8_t* pSrc = mData.data() + mScanlineOffsets[y] + 4;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                uint8_t* pPlane = pPlanes + c * mWidth;
+                for (uint32_t x = 0; x < mWidth;)
+                {
+                    const uint8_t count = *pSrc++;
+                    if (count > 128)
+                    {
+                        std::memset(pPlane + x, *pSrc++, count - 128);
+                        x += count - 128;
+                    }
+                    else
+                    {
+                        std::memcpy(pPlane + x, pSrc, count);
+                        pSrc += count;
+                        x += count;
+                    }
+                }
+            }
+        }
+
+        bool HdrDecoder::decode(uint8_t* pDst, uint32_t rowPitch, bool isTopDown) const
+        {
+            const uint32_t kLinesPerTask = 16;
+            const auto tasks = NumericRange<uint32_t>(0, (mHeight + kLinesPerTask - 1) / kLinesPerTask);
+
+            std::for_each(std::execution::par, tasks.begin(), tasks.end(), [&](uint32_t task)
+            {
+                std::vector<uint8_t> planes(4 * size_t(mWidth));
+                const uint32_t begin = task * kLinesPerTask;
+                const uint32_t end = std::min(begin + kLinesPerTask, mHeight);
+                for (uint32_t y = begin; y < end; y++)
+                {
+                    decodeScanline(y, planes.data());
+                    const uint8_t* p = planes.data();
+                    convertRGBEToRGBA32Float(p, p + mWidth, p + 2 * mWidth, p + 3 * mWidth, getDstRow(pDst, rowPitch, mHeight, y, isTopDown), mWidth);
+                }
+            });
+            return true;
+        }
+    }
+
+    std::unique_ptr<ImageDecoder> ImageDecoder::create(Format format)
+    {
+        switch (format)
+        {
+        case Format::Exr:
+            return std::make_unique<ExrDecoder>();
+        case Format::Hdr:
+            return std::make_unique<HdrDecoder>();
+        default:
+            should_not_get_here();
+            return nullptr;
+        }
+    }
+
+    bool ImageDecoder::open(const std::string& path)
+    {
+        std::ifstream stream(path, std::ios::binary | std::ios::ate);
+        if (!stream) return false;
+        std::vector<uint8_t> data((size_t)stream.tellg());
+        stream.seekg(0);
+        if (!stream.read(reinterpret_cast<char*>(data.data()), data.size())) return false;
+        return open(std::move(data));
+    }
+
+    bool ImageDecoder::open(std::vector<uint8_t> data)
+    {
+        mData = std::move(data);
+        mWidth = mHeight = 0;
+        mHasAlpha = false;
+        return parseHeader();
+    }
+}
@@ -0,0 +1,102 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+
+namespace Falcor
+{
+    /** Parallel decoder for the common subset of an image file format.
+        Decoders produce RGBA32Float pixels and decode independent chunks of the image (scanline blocks or tiles) on multiple threads.
+        They reject files that use features they don't support, so that the caller can fall back to a general loader.
+    */
+    class dlldecl ImageDecoder
+    {
+    public:
+        enum class Format
+        {
+            Exr,    ///< OpenEXR. Single-part scanline or tiled files with NONE, RLE, ZIPS or ZIP compression and HALF or FLOAT RGB[A] channels.
+            Hdr,    ///< Radiance HDR. RGBE files with the standard -Y +X orientation, run-length encoded or flat.
+        };
+
+        virtual ~ImageDecoder() = default;
+
+        /** Create a decoder.
+            \param[in] format File format.
+            \return A new decoder.
+        */
+        static std::unique_ptr<ImageDecoder> create(Format format);
+
+        /** Read a file and parse its header.
+            \param[in] path Path of the file.
+            \return True if the file can be decoded.
+        */
+        bool open(const std::string& path);
+
+        /** Parse the header of a file held in memory.
+            \param[in] data File contents.
+            \return True if the file can be decoded.
+        */
+        bool open(std::vector<uint8_t> data);
+
+        /** Decode the image.
+            \param[out] pDst Destination RGBA32Float pixels.
+            \param[in] rowPitch Row pitch of the destination in bytes.
+            \param[in] isTopDown If true, the top row of the image is stored first, otherwise the bottom row is stored first.
+            \return True if successful. The destination contents are undefined if decoding fails.
+        */
+        virtual bool decode(uint8_t* pDst, uint32_t rowPitch, bool isTopDown) const = 0;
+
+        /** Get the image width in pixels.
+        */
+        uint32_t getWidth() const { return mWidth; }
+
+        /** Get the image height in pixels.
+        */
+        uint32_t getHeight() const { return mHeight; }
+
+        /** Check if the file has an alpha channel. Images without alpha are decoded with alpha set to 1.
+        */
+        bool hasAlpha() const { return mHasAlpha; }
+
+        /** Get the size of the file in bytes.
+        */
+        size_t getFileSize() const { return mData.size(); }
+
+    protected:
+        ImageDecoder() = default;
+
+        /** Parse the header in mData and set the image properties.
+            \return True if the file can be decoded.
+        */
+        virtual bool parseHeader() = 0;
+
+        std::vector<uint8_t> mData;
+        uint32_t mWidth = 0;
+        uint32_t mHeight = 0;
+        bool mHasAlpha = false;
+    };
+}
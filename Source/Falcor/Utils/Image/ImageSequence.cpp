@@ -0,0 +1,277 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "ImageSequence.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        double getElapsedSeconds(CpuTimer::TimePoint start)
+        {
+            return CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1e-3;
+        }
+    }
+
+    ImageSequence::ImageSequence(DecodeFunc decode, const Desc& desc)
+        : mDecode(std::move(decode))
+        , mDesc(desc)
+        , mSlots(std::max(1u, std::min(desc.bufferSize, desc.frameCount)))
+    {
+        // Start decoding from the first frame right away
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            schedule();
+        }
+
+        const uint32_t threadCount = std::max(1u, std::min(desc.threadCount, (uint32_t)mSlots.size()));
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            mThreads.emplace_back(&ImageSequence::runWorker, this);
+        }
+    }
+
+    ImageSequence::~ImageSequence()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+        }
+        mCondition.notify_all();
+        for (auto& thread : mThreads) thread.join();
+    }
+
+    ImageSequence::UniquePtr ImageSequence::create(DecodeFunc decode, const Desc& desc)
+    {
+        if (desc.frameCount == 0 || !decode) return nullptr;
+        return UniquePtr(new ImageSequence(std::move(decode), desc));
+    }
+
+    ImageSequence::UniquePtr ImageSequence::createFromFiles(const std::string& pattern, uint32_t firstFrame, Desc desc, bool isTopDown)
+    {
+        if (formatFilename(pattern, firstFrame).empty())
+        {
+            logError("ImageSequence: Filename pattern '" + pattern + "' doesn't contain a frame number.");
+            return nullptr;
+        }
+
+        // Count the consecutive files starting at the first frame
+        if (desc.frameCount == 0)
+        {
+            std::string fullPath;
+            while (findFileInDataDirectories(formatFilename(pattern, firstFrame + desc.frameCount), fullPath)) desc.frameCount++;
+        }
+        if (desc.frameCount == 0)
+        {
+            logError("ImageSequence: Can't find the first frame '" + formatFilename(pattern, firstFrame) + "'.");
+            return nullptr;
+        }
+
+        auto decode = [pattern, firstFrame, isTopDown](uint32_t frame)
+        {
+            return Bitmap::createFromFile(formatFilename(pattern, firstFrame + frame), isTopDown);
+        };
+        return create(decode, desc);
+    }
+
+    std::string ImageSequence::formatFilename(const std::string& pattern, uint32_t frame)
+    {
+        // printf-style conversion, %d or %0Nd
+        for (size_t p = pattern.find('%'); p != std::string::npos; p = pattern.find('%', p + 1))
+        {
+            size_t end = p + 1;
+            while (end < pattern.size() && std::isdigit((unsigned char)pattern[end])) end++;
+            if (end < pattern.size() && pattern[end] == 'd')
+            {
+                const std::string spec = pattern.substr(p, end - p) + "u";
+                char number[32];
+                std::snprintf(number, sizeof(number), spec.c_str(), frame);
+                return pattern.substr(0, p) + number + pattern.substr(end + 1);
+            }
+        }
+
+        // Last run of '#' characters
+        const size_t last = pattern.find_last_of('#');
+        if (last == std::string::npos) return "";
+        size_t first = last;
+        while (first > 0 && pattern[first - 1] == '#') first--;
+
+        std::string number = std::to_string(frame);
+        const size_t digits = last - first + 1;
+        if (number.size() < digits) number.insert(0, digits - number.size(), '0');
+        return pattern.substr(0, first) + number + pattern.substr(last + 1);
+    }
+
+    ImageSequence::FramePtr ImageSequence::getFrame(uint32_t frame)
+    {
+        if (frame >= mDesc.frameCount) return nullptr;
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mPosition = frame;
+        mStats.requests++;
+        schedule();
+        mCondition.notify_all();
+
+        Slot* pSlot = findSlot(frame);
+        if (pSlot && pSlot->state == SlotState::Ready)
+        {
+            mStats.hits++;
+        }
+        else
+        {
+            // The frame is the nearest one to the playback position, so the workers pick it up next
+            mStats.misses++;
+            auto start = CpuTimer::getCurrentTimePoint();
+            mCondition.wait(lock, [&]() { pSlot = findSlot(frame); return pSlot && pSlot->state == SlotState::Ready; });
+            const double waitTime = getElapsedSeconds(start);
+            mStats.waitTime += waitTime;
+            mStats.maxWaitTime = std::max(mStats.maxWaitTime, waitTime);
+        }
+
+        pSlot->requested = true;
+        return pSlot->pFrame;
+    }
+
+    bool ImageSequence::isFrameReady(uint32_t frame) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const Slot* pSlot = findSlot(frame);
+        return pSlot && pSlot->state == SlotState::Ready;
+    }
+
+    ImageSequence::Stats ImageSequence::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Stats stats = mStats;
+        stats.framesReady = (uint32_t)std::count_if(mSlots.begin(), mSlots.end(), [](const Slot& s) { return s.state == SlotState::Ready; });
+        return stats;
+    }
+
+    void ImageSequence::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats = {};
+    }
+
+    uint32_t ImageSequence::getDistance(uint32_t frame) const
+    {
+        if (mDesc.loop) return (frame + mDesc.frameCount - mPosition) % mDesc.frameCount;
+        return frame >= mPosition ? frame - mPosition : std::numeric_limits<uint32_t>::max();
+    }
+
+    ImageSequence::Slot* ImageSequence::findSlot(uint32_t frame)
+    {
+        for (auto& slot : mSlots)
+        {
+            if (slot.state != SlotState::Empty && slot.frame == frame) return &slot;
+        }
+        return nullptr;
+    }
+
+    const ImageSequence::Slot* ImageSequence::findSlot(uint32_t frame) const
+    {
+        return const_cast<ImageSequence*>(this)->findSlot(frame);
+    }
+
+    void ImageSequence::schedule()
+    {
+        // The window holds the frames from the playback position onwards, one per slot.
+        const uint32_t window = (uint32_t)mSlots.size();
+        for (uint32_t distance = 0; distance < window; distance++)
+        {
+            if (!mDesc.loop && mPosition + distance >= mDesc.frameCount) break;
+            const uint32_t frame = (mPosition + distance) % mDesc.frameCount;
+            if (findSlot(frame)) continue;
+
+            // Reuse an empty slot, or else the slot whose frame is farthest outside the window. Frames just behind the
+            // playback position are the farthest when looping. Slots being decoded can't be reused until they are done.
+            Slot* pVictim = nullptr;
+            uint32_t victimDistance = 0;
+            for (auto& slot : mSlots)
+            {
+                if (slot.state == SlotState::Empty)
+                {
+                    pVictim = &slot;
+                    break;
+                }
+                if (slot.state == SlotState::Decoding) continue;
+
+                const uint32_t slotDistance = getDistance(slot.frame);
+                if (slotDistance >= window && (!pVictim || slotDistance > victimDistance))
+                {
+                    pVictim = &slot;
+                    victimDistance = slotDistance;
+                }
+            }
+            if (!pVictim) break;
+
+            if (pVictim->state == SlotState::Ready && !pVictim->requested) mStats.framesDiscarded++;
+            *pVictim = {};
+            pVictim->frame = frame;
+            pVictim->state = SlotState::Pending;
+        }
+    }
+
+    void ImageSequence::runWorker()
+    {
+        while (true)
+        {
+            Slot* pSlot = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this]() { return mTerminate || std::any_of(mSlots.begin(), mSlots.end(), [](const Slot& s) { return s.state == SlotState::Pending; }); });
+                if (mTerminate) return;
+
+                // Decode the pending frame nearest to the playback position
+                for (auto& slot : mSlots)
+                {
+                    if (slot.state == SlotState::Pending && (!pSlot || getDistance(slot.frame) < getDistance(pSlot->frame))) pSlot = &slot;
+                }
+                pSlot->state = SlotState::Decoding;
+            }
+
+            // The slot is not reused while decoding, so it can be accessed without the lock until the result is stored
+            auto start = CpuTimer::getCurrentTimePoint();
+            FramePtr pFrame = mDecode(pSlot->frame);
+            const double decodeTime = getElapsedSeconds(start);
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                pSlot->pFrame = std::move(pFrame);
+                pSlot->state = SlotState::Ready;
+                mStats.framesDecoded++;
+                if (!pSlot->pFrame) mStats.decodeFailures++;
+                mStats.decodeTime += decodeTime;
+
+                // Frames that didn't fit while the slot was busy can be scheduled now
+                schedule();
+            }
+            mCondition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,181 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Bitmap.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Falcor
+{
+    /** Playback of an image sequence with frames decoded ahead of time on worker threads.
+
+        Decoded frames are held in a ring buffer of host images. Requesting a frame moves the playback position
+        to it, and the workers decode the frames following it until the ring buffer is full. Slots holding frames
+        behind the playback position are reused first. When playback keeps up with the decoders, each request
+        finds its frame ready (a hit). Otherwise the request waits for the frame to be decoded (a miss).
+
+        The frames are loaded with a decode function, which maps a frame index to a bitmap. This is normally
+        Bitmap::createFromFile() applied to a filename pattern, but can be any function, e.g. for testing.
+    */
+    class dlldecl ImageSequence
+    {
+    public:
+        using UniquePtr = std::unique_ptr<ImageSequence>;
+        using FramePtr = std::shared_ptr<const Bitmap>;
+
+        /** Function loading a frame. Called on worker threads, concurrently for different frames.
+            \param[in] frame Frame index in [0, frameCount).
+            \return The frame, or nullptr on error.
+        */
+        using DecodeFunc = std::function<Bitmap::UniqueConstPtr(uint32_t frame)>;
+
+        struct Desc
+        {
+            uint32_t frameCount = 0;    ///< Number of frames in the sequence.
+            uint32_t bufferSize = 8;    ///< Number of decoded frames held in the ring buffer, including the current one.
+            uint32_t threadCount = 2;   ///< Number of decoding threads.
+            bool loop = true;           ///< Continue decoding from the first frame after the last one.
+        };
+
+        /** Playback statistics.
+        */
+        struct Stats
+        {
+            uint64_t requests = 0;          ///< Number of getFrame() calls.
+            uint64_t hits = 0;              ///< Requests for frames that were already decoded.
+            uint64_t misses = 0;            ///< Requests that waited for their frame to be decoded.
+            uint64_t framesDecoded = 0;     ///< Number of frames decoded, including failures.
+            uint64_t decodeFailures = 0;    ///< Number of frames the decode function failed to load.
+            uint64_t framesDiscarded = 0;   ///< Decoded frames that were evicted without being requested, e.g. after seeking.
+            double decodeTime = 0.0;        ///< Total decode time in seconds, summed over the workers.
+            double waitTime = 0.0;          ///< Total time in seconds getFrame() waited on misses.
+            double maxWaitTime = 0.0;       ///< Longest wait of a single getFrame() call in seconds.
+            uint32_t framesReady = 0;       ///< Number of decoded frames currently in the ring buffer.
+
+            /** Get the fraction of requests that were hits.
+            */
+            double getHitRate() const { return requests > 0 ? double(hits) / requests : 0.0; }
+
+            /** Get the average decode time of a frame in seconds.
+            */
+            double getAverageDecodeTime() const { return framesDecoded > 0 ? decodeTime / framesDecoded : 0.0; }
+
+            /** Get the average latency of getFrame() calls in seconds.
+            */
+            double getAverageWaitTime() const { return requests > 0 ? waitTime / requests : 0.0; }
+        };
+
+        /** Destructor. Waits for frames that are being decoded.
+        */
+        ~ImageSequence();
+
+        /** Create a sequence loading the frames with a custom function.
+            \param[in] decode Function loading a frame.
+            \param[in] desc Sequence settings.
+            \return A new object, or nullptr if the sequence is empty.
+        */
+        static UniquePtr create(DecodeFunc decode, const Desc& desc);
+
+        /** Create a sequence of image files, loaded with Bitmap::createFromFile().
+            \param[in] pattern Filename pattern, see formatFilename(). Can include a path. Files that can't be found relative to the current directory are searched for in the data directories.
+            \param[in] firstFrame Frame number of the first file.
+            \param[in] desc Sequence settings. If frameCount is zero, the sequence covers all consecutive files starting at firstFrame.
+            \param[in] isTopDown Memory layout of the images, see Bitmap::createFromFile().
+            \return A new object, or nullptr if the pattern is invalid or the first file doesn't exist.
+        */
+        static UniquePtr createFromFiles(const std::string& pattern, uint32_t firstFrame, Desc desc, bool isTopDown = true);
+
+        /** Get the filename of a frame.
+            The frame number replaces either a printf-style integer conversion ("frame%d.png", "frame%04d.png"),
+            or the last run of '#' characters, which gives the minimum number of digits ("frame####.png").
+            \param[in] pattern Filename pattern.
+            \param[in] frame Frame number.
+            \return The filename, or an empty string if the pattern doesn't contain a frame number.
+        */
+        static std::string formatFilename(const std::string& pattern, uint32_t frame);
+
+        /** Get a frame and move the playback position to it. Blocks until the frame is decoded.
+            \param[in] frame Frame index in [0, frameCount).
+            \return The frame, or nullptr if it failed to load. The frame remains valid after it is evicted from the ring buffer.
+        */
+        FramePtr getFrame(uint32_t frame);
+
+        /** Check if a frame is decoded and ready without waiting.
+        */
+        bool isFrameReady(uint32_t frame) const;
+
+        /** Get the number of frames in the sequence.
+        */
+        uint32_t getFrameCount() const { return mDesc.frameCount; }
+
+        /** Get the playback statistics.
+        */
+        Stats getStats() const;
+
+        /** Reset the playback statistics.
+        */
+        void resetStats();
+
+    private:
+        ImageSequence(DecodeFunc decode, const Desc& desc);
+
+        enum class SlotState
+        {
+            Empty,      ///< Unused.
+            Pending,    ///< Waiting for a worker.
+            Decoding,   ///< A worker is decoding the frame.
+            Ready,      ///< The frame is decoded. pFrame is nullptr if decoding failed.
+        };
+
+        struct Slot
+        {
+            uint32_t frame = 0;
+            SlotState state = SlotState::Empty;
+            bool requested = false;     ///< True if the frame was returned by getFrame().
+            FramePtr pFrame;
+        };
+
+        uint32_t getDistance(uint32_t frame) const;
+        Slot* findSlot(uint32_t frame);
+        const Slot* findSlot(uint32_t frame) const;
+        void schedule();
+        void runWorker();
+
+        const DecodeFunc mDecode;
+        const Desc mDesc;
+        std::vector<Slot> mSlots;                   ///< Ring buffer. Each slot holds one frame.
+        uint32_t mPosition = 0;                     ///< Playback position, the frame last passed to getFrame().
+
+        std::vector<std::thread> mThreads;          ///< Decoding threads.
+        mutable std::mutex mMutex;                  ///< Protects the slots, position and statistics.
+        std::condition_variable mCondition;         ///< Signaled when slots change state or the workers should terminate.
+        bool mTerminate = false;                    ///< Flag to terminate the workers.
+        Stats mStats;
+    };
+}
@@ -0,0 +1,385 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "PixelConversion.h"
+#include <immintrin.h>
+#include <intrin.h>
+
+namespace Falcor
+{
+    namespace
+    {
+        // The kernels use SSE2 unconditionally (it is part of x64). SSSE3 and F16C are checked at runtime.
+        struct CpuFeatures
+        {
+            bool ssse3 = false;
+            bool f16c = false;
+
+            CpuFeatures()
+            {
+                int info[4];
+                __cpuid(info, 0);
+                if (info[0] < 1) return;
+                __cpuid(info, 1);
+                ssse3 = (info[2] & (1 << 9)) != 0;
+
+                // F16C uses VEX encoding, which requires the OS to save the AVX register state.
+                const bool osxsave = (info[2] & (1 << 27)) != 0;
+                const bool avx = (info[2] & (1 << 28)) != 0;
+                f16c = (info[2] & (1 << 29)) != 0 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+            }
+        };
+
+        const CpuFeatures& getCpuFeatures()
+        {
+            static const CpuFeatures features;
+            return features;
+        }
+
+        float asFloat(uint32_t bits) { float f; std::memcpy(&f, &bits, sizeof(f)); return f; }
+        uint32_t asUint(float f) { uint32_t bits; std::memcpy(&bits, &f, sizeof(bits)); return bits; }
+
+        float halfToFloat(uint16_t h)
+        {
+            const uint32_t sign = uint32_t(h & 0x8000) << 16;
+            const uint32_t exponent = (h >> 10) & 0x1f;
+            const uint32_t mantissa = h & 0x3ff;
+
+            if (exponent == 0x1f) return asFloat(sign | 0x7f800000 | (mantissa != 0 ? 0x400000 : 0) | (mantissa << 13)); // Inf or quiet NaN
+            if (exponent != 0) return asFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+            return asFloat(sign | asUint(float(mantissa) * 5.9604644775390625e-8f)); // Zero or denormal, mantissa * 2^-24
+        }
+
+        uint16_t floatToHalf(float f)
+        {
+            uint32_t bits = asUint(f);
+            const uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+            bits &= 0x7fffffff;
+
+            if (bits >= 0x7f800000) return uint16_t(sign | 0x7c00 | (bits > 0x7f800000 ? 0x200 | ((bits >> 13) & 0x3ff) : 0)); // Inf or quiet NaN
+            if (bits >= 0x477ff000) return uint16_t(sign | 0x7c00); // Rounds to Inf
+            if (bits < 0x38800000)
+            {
+                // Half denormals are multiples of 2^-24, which is the ulp of floats in [0.5, 1). The addition rounds to nearest even.
+                return uint16_t(sign | (asUint(asFloat(bits) + 0.5f) - 0x3f000000));
+            }
+            // Rebias the exponent and round to nearest even.
+            bits += 0xc8000fff + ((bits >> 13) & 1);
+            return uint16_t(sign | (bits >> 13));
+        }
+
+        float rgbeScale(uint8_t e)
+        {
+            return e != 0 ? std::ldexp(1.f, int(e) - 136) : 0.f;
+        }
+
+        __m128 loadBytes4(const uint8_t* p)
+        {
+            int32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            const __m128i zero = _mm_setzero_si128();
+            return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero));
+        }
+
+        // BT.601 limited range RGB to YUV weights in 8-bit fixed point.
+        struct YUVWeights { int16_t r, g, b; int32_t offset; };
+        const YUVWeights kYWeights = { 66, 129, 25, 16 };
+        const YUVWeights kUWeights = { -38, -74, 112, 128 };
+        const YUVWeights kVWeights = { 112, -94, -18, 128 };
+
+        uint8_t applyYUVWeights(const YUVWeights& w, int32_t r, int32_t g, int32_t b)
+        {
+            return uint8_t(((w.r * r + w.g * g + w.b * b + 128) >> 8) + w.offset);
+        }
+
+        __m128i loadYUVWeights(const YUVWeights& w, bool bgra)
+        {
+            const int16_t c0 = bgra ? w.b : w.r;
+            const int16_t c2 = bgra ? w.r : w.b;
+            return _mm_setr_epi16(c0, w.g, c2, 0, c0, w.g, c2, 0);
+        }
+
+        /** Applies YUV weights to four pixels with 16-bit channels, two pixels in lo and two in hi.
+            Returns the four results as 32-bit values.
+        */
+        __m128i applyYUVWeights(__m128i lo, __m128i hi, __m128i weights, __m128i offset)
+        {
+            // madd gives (r * wr + g * wg, b * wb) for each pixel, which are summed pairwise.
+            const __m128 a = _mm_castsi128_ps(_mm_madd_epi16(lo, weights));
+            const __m128 b = _mm_castsi128_ps(_mm_madd_epi16(hi, weights));
+            const __m128i sum = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+            return _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(128)), 8), offset);
+        }
+
+        /** Returns the rounded average of the two pixels in v, which holds the 16-bit channel sums of two rows.
+            The result is in the low four lanes.
+        */
+        __m128i averagePixelPair(__m128i v)
+        {
+            return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(v, _mm_srli_si128(v, 8)), _mm_set1_epi16(2)), 2);
+        }
+    }
+
+    void convertHalfToFloat(const uint16_t* pSrc, float* pDst, size_t count)
+    {
+        size_t i = 0;
+        if (getCpuFeatures().f16c)
+        {
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc + i));
+                _mm_storeu_ps(pDst + i, _mm_cvtph_ps(h));
+            }
+        }
+        for (; i < count; i++) pDst[i] = halfToFloat(pSrc[i]);
+    }
+
+    void convertFloatToHalf(const float* pSrc, uint16_t* pDst, size_t count)
+    {
+        size_t i = 0;
+        if (getCpuFeatures().f16c)
+        {
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128i h = _mm_cvtps_ph(_mm_loadu_ps(pSrc + i), _MM_FROUND_TO_NEAREST_INT);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + i), h);
+            }
+        }
+        for (; i < count; i++) pDst[i] = floatToHalf(pSrc[i]);
+    }
+
+    void convertRGBToRGBA32Float(const float* pSrc, float* pDst, size_t pixelCount, float alpha)
+    {
+        const __m128 a = _mm_set1_ps(alpha);
+        size_t i = 0;
+        for (; i + 4 <= pixelCount; i += 4)
+        {
+            // Four pixels r0g0b0r1 g1b1r2g2 b2r3g3b3.
+            const float* pIn = pSrc + 3 * i;
+            const __m128 v0 = _mm_loadu_ps(pIn);
+            const __m128 v1 = _mm_loadu_ps(pIn + 4);
+            const __m128 v2 = _mm_loadu_ps(pIn + 8);
+
+            const __m128 p0 = _mm_shuffle_ps(v0, _mm_unpackhi_ps(v0, a), _MM_SHUFFLE(1, 0, 1, 0));
+            const __m128 p1 = _mm_shuffle_ps(_mm_shuffle_ps(v0, v1, _MM_SHUFFLE(0, 0, 3, 3)), _mm_shuffle_ps(v1, a, _MM_SHUFFLE(0, 0, 1, 1)), _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 p2 = _mm_shuffle_ps(_mm_shuffle_ps(v1, v2, _MM_SHUFFLE(0, 0, 3, 2)), _mm_shuffle_ps(v2, a, _MM_SHUFFLE(0, 0, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+            const __m128 p3 = _mm_shuffle_ps(v2, _mm_shuffle_ps(v2, a, _MM_SHUFFLE(0, 0, 3, 3)), _MM_SHUFFLE(2, 0, 2, 1));
+
+            float* pOut = pDst + 4 * i;
+            _mm_storeu_ps(pOut, p0);
+            _mm_storeu_ps(pOut + 4, p1);
+            _mm_storeu_ps(pOut + 8, p2);
+            _mm_storeu_ps(pOut + 12, p3);
+        }
+        for (; i < pixelCount; i++)
+        {
+            pDst[4 * i + 0] = pSrc[3 * i + 0];
+            pDst[4 * i + 1] = pSrc[3 * i + 1];
+            pDst[4 * i + 2] = pSrc[3 * i + 2];
+            pDst[4 * i + 3] = alpha;
+        }
+    }
+
+    void interleaveRGBA32Float(const float* pR, const float* pG, const float* pB, const float* pA, float* pDst, size_t pixelCount)
+    {
+        const __m128 one = _mm_set1_ps(1.f);
+        size_t i = 0;
+        for (; i + 4 <= pixelCount; i += 4)
+        {
+            __m128 r = _mm_loadu_ps(pR + i);
+            __m128 g = _mm_loadu_ps(pG + i);
+            __m128 b = _mm_loadu_ps(pB + i);
+            __m128 a = pA ? _mm_loadu_ps(pA + i) : one;
+            _MM_TRANSPOSE4_PS(r, g, b, a);
+
+            float* pOut = pDst + 4 * i;
+            _mm_storeu_ps(pOut, r);
+            _mm_storeu_ps(pOut + 4, g);
+            _mm_storeu_ps(pOut + 8, b);
+            _mm_storeu_ps(pOut + 12, a);
+        }
+        for (; i < pixelCount; i++)
+        {
+            pDst[4 * i + 0] = pR[i];
+            pDst[4 * i + 1] = pG[i];
+            pDst[4 * i + 2] = pB[i];
+            pDst[4 * i + 3] = pA ? pA[i] : 1.f;
+        }
+    }
+
+    void convertBGRToBGRX8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount)
+    {
+        size_t i = 0;
+        if (getCpuFeatures().ssse3)
+        {
+            const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+
+            // Each iteration loads 16 bytes but consumes 12, so stop while at least 16 source bytes remain.
+            for (; i + 6 <= pixelCount; i += 4)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 3 * i));
+                v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 4 * i), v);
+            }
+        }
+        for (; i < pixelCount; i++)
+        {
+            pDst[4 * i + 0] = pSrc[3 * i + 0];
+            pDst[4 * i + 1] = pSrc[3 * i + 1];
+            pDst[4 * i + 2] = pSrc[3 * i + 2];
+            pDst[4 * i + 3] = 0xff;
+        }
+    }
+
+    void convertRGBEToRGBA32Float(const uint8_t* pR, const uint8_t* pG, const uint8_t* pB, const uint8_t* pE, float* pDst, size_t pixelCount)
+    {
+        auto convertPixel = [&](size_t i)
+        {
+            const float scale = rgbeScale(pE[i]);
+            pDst[4 * i + 0] = pR[i] * scale;
+            pDst[4 * i + 1] = pG[i] * scale;
+            pDst[4 * i + 2] = pB[i] * scale;
+            pDst[4 * i + 3] = 1.f;
+        };
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i minNormal = _mm_set1_epi32(9);
+        size_t i = 0;
+        for (; i + 4 <= pixelCount; i += 4)
+        {
+            int32_t e4;
+            std::memcpy(&e4, pE + i, sizeof(e4));
+            const __m128i e = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(e4), zero), zero);
+
+            // The scale 2^(e-136) is a normal float for e >= 10 and is built directly from the exponent bits.
+            // Zero exponents give zero pixels. Exponents 1-9 give denormal scales, which take the scalar path.
+            const __m128i isNormal = _mm_cmpgt_epi32(e, minNormal);
+            const __m128i isZero = _mm_cmpeq_epi32(e, zero);
+            if (_mm_movemask_epi8(_mm_or_si128(isNormal, isZero)) != 0xffff)
+            {
+                for (size_t j = i; j < i + 4; j++) convertPixel(j);
+                continue;
+            }
+            const __m128 scale = _mm_and_ps(_mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(e, minNormal), 23)), _mm_castsi128_ps(isNormal));
+
+            __m128 r = _mm_mul_ps(loadBytes4(pR + i), scale);
+            __m128 g = _mm_mul_ps(loadBytes4(pG + i), scale);
+            __m128 b = _mm_mul_ps(loadBytes4(pB + i), scale);
+            __m128 a = _mm_set1_ps(1.f);
+            _MM_TRANSPOSE4_PS(r, g, b, a);
+
+            float* pOut = pDst + 4 * i;
+            _mm_storeu_ps(pOut, r);
+            _mm_storeu_ps(pOut + 4, g);
+            _mm_storeu_ps(pOut + 8, b);
+            _mm_storeu_ps(pOut + 12, a);
+        }
+        for (; i < pixelCount; i++) convertPixel(i);
+    }
+
+    void convertRGBA8ToYUV(const uint8_t* pSrc, ptrdiff_t srcPitch, bool bgra, uint32_t width, uint32_t height, uint8_t* pY, size_t yPitch, uint8_t* pU, uint8_t* pV, size_t uvPitch, bool subsampleY)
+    {
+        if (width == 0 || height == 0) return;
+
+        const uint32_t ri = bgra ? 2 : 0;
+        const uint32_t bi = bgra ? 0 : 2;
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i yWeights = loadYUVWeights(kYWeights, bgra);
+        const __m128i uWeights = loadYUVWeights(kUWeights, bgra);
+        const __m128i vWeights = loadYUVWeights(kVWeights, bgra);
+        const __m128i yOffset = _mm_set1_epi32(kYWeights.offset);
+        const __m128i uvOffset = _mm_set1_epi32(kUWeights.offset);
+
+        auto convertLuma = [&](__m128i v0, __m128i v1, uint8_t* pDst)
+        {
+            const __m128i y0 = applyYUVWeights(_mm_unpacklo_epi8(v0, zero), _mm_unpackhi_epi8(v0, zero), yWeights, yOffset);
+            const __m128i y1 = applyYUVWeights(_mm_unpacklo_epi8(v1, zero), _mm_unpackhi_epi8(v1, zero), yWeights, yOffset);
+            const __m128i y = _mm_packs_epi32(y0, y1);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst), _mm_packus_epi16(y, y));
+        };
+
+        // Each chroma row covers one or two source rows. The chroma of a single row is computed by using the row twice.
+        const uint32_t chromaHeight = subsampleY ? (height + 1) / 2 : height;
+        for (uint32_t cy = 0; cy < chromaHeight; cy++)
+        {
+            const uint32_t y0 = subsampleY ? 2 * cy : cy;
+            const bool hasRow1 = subsampleY && y0 + 1 < height;
+            const uint8_t* pRow0 = pSrc + (ptrdiff_t)y0 * srcPitch;
+            const uint8_t* pRow1 = hasRow1 ? pRow0 + srcPitch : pRow0;
+            uint8_t* pY0 = pY + y0 * yPitch;
+            uint8_t* pY1 = pY0 + yPitch;
+            uint8_t* pURow = pU + cy * uvPitch;
+            uint8_t* pVRow = pV + cy * uvPitch;
+
+            uint32_t x = 0;
+            for (; x + 8 <= width; x += 8)
+            {
+                const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + 4 * x));
+                const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + 4 * x + 16));
+                const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + 4 * x));
+                const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + 4 * x + 16));
+
+                convertLuma(a0, a1, pY0 + x);
+                if (hasRow1) convertLuma(b0, b1, pY1 + x);
+
+                // Average 2x2 blocks with 16-bit channels. Each of c01 and c23 holds two averaged pixels.
+                const __m128i s0 = averagePixelPair(_mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero)));
+                const __m128i s1 = averagePixelPair(_mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero)));
+                const __m128i s2 = averagePixelPair(_mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero)));
+                const __m128i s3 = averagePixelPair(_mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero)));
+                const __m128i c01 = _mm_unpacklo_epi64(s0, s1);
+                const __m128i c23 = _mm_unpacklo_epi64(s2, s3);
+
+                const __m128i u = applyYUVWeights(c01, c23, uWeights, uvOffset);
+                const __m128i v = applyYUVWeights(c01, c23, vWeights, uvOffset);
+                const __m128i uv = _mm_packus_epi16(_mm_packs_epi32(u, v), zero);
+                const int32_t u4 = _mm_cvtsi128_si32(uv);
+                const int32_t v4 = _mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+                std::memcpy(pURow + x / 2, &u4, sizeof(u4));
+                std::memcpy(pVRow + x / 2, &v4, sizeof(v4));
+            }
+            for (; x < width; x++)
+            {
+                const uint8_t* p0 = pRow0 + 4 * x;
+                const uint8_t* p1 = pRow1 + 4 * x;
+                pY0[x] = applyYUVWeights(kYWeights, p0[ri], p0[1], p0[bi]);
+                if (hasRow1) pY1[x] = applyYUVWeights(kYWeights, p1[ri], p1[1], p1[bi]);
+
+                if ((x & 1) == 0)
+                {
+                    const uint32_t dx = x + 1 < width ? 4 : 0;
+                    int32_t rgb[3];
+                    for (uint32_t c = 0; c < 3; c++) rgb[c] = (p0[c] + p0[dx + c] + p1[c] + p1[dx + c] + 2) >> 2;
+                    pURow[x / 2] = applyYUVWeights(kUWeights, rgb[ri], rgb[1], rgb[bi]);
+                    pVRow[x / 2] = applyYUVWeights(kVWeights, rgb[ri], rgb[1], rgb[bi]);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,99 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+
+namespace Falcor
+{
+    // Kernels for converting pixel data between the layouts used by image files and textures.
+    // All pointers may be unaligned. Source and destination must not overlap.
+
+    /** Convert 16-bit floats to 32-bit floats.
+        \param[in] pSrc Source values.
+        \param[out] pDst Destination values.
+        \param[in] count Number of values.
+    */
+    dlldecl void convertHalfToFloat(const uint16_t* pSrc, float* pDst, size_t count);
+
+    /** Convert 32-bit floats to 16-bit floats, rounding to nearest even.
+        \param[in] pSrc Source values.
+        \param[out] pDst Destination values.
+        \param[in] count Number of values.
+    */
+    dlldecl void convertFloatToHalf(const float* pSrc, uint16_t* pDst, size_t count);
+
+    /** Expand RGB32Float pixels to RGBA32Float pixels.
+        \param[in] pSrc Source pixels.
+        \param[out] pDst Destination pixels.
+        \param[in] pixelCount Number of pixels.
+        \param[in] alpha Value of the inserted alpha channel.
+    */
+    dlldecl void convertRGBToRGBA32Float(const float* pSrc, float* pDst, size_t pixelCount, float alpha = 1.f);
+
+    /** Interleave separate channel planes into RGBA32Float pixels.
+        \param[in] pR Red channel.
+        \param[in] pG Green channel.
+        \param[in] pB Blue channel.
+        \param[in] pA Alpha channel, or nullptr to set alpha to 1.
+        \param[out] pDst Destination pixels.
+        \param[in] pixelCount Number of pixels.
+    */
+    dlldecl void interleaveRGBA32Float(const float* pR, const float* pG, const float* pB, const float* pA, float* pDst, size_t pixelCount);
+
+    /** Expand 24-bit BGR pixels to 32-bit BGRX pixels with X set to 0xff.
+        \param[in] pSrc Source pixels.
+        \param[out] pDst Destination pixels.
+        \param[in] pixelCount Number of pixels.
+    */
+    dlldecl void convertBGRToBGRX8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount);
+
+    /** Convert planar RGBE pixels (shared exponent, as stored in Radiance HDR files) to RGBA32Float pixels with alpha set to 1.
+        \param[in] pR Red mantissas.
+        \param[in] pG Green mantissas.
+        \param[in] pB Blue mantissas.
+        \param[in] pE Exponents.
+        \param[out] pDst Destination pixels.
+        \param[in] pixelCount Number of pixels.
+    */
+    dlldecl void convertRGBEToRGBA32Float(const uint8_t* pR, const uint8_t* pG, const uint8_t* pB, const uint8_t* pE, float* pDst, size_t pixelCount);
+
+    /** Convert 8-bit RGBA or BGRA pixels to planar 8-bit YUV using the BT.601 limited range coefficients.
+        Chroma is the average of 2x1 (4:2:2) or 2x2 (4:2:0) pixel blocks. The last column and row are replicated for odd sizes.
+        \param[in] pSrc First source row.
+        \param[in] srcPitch Source row pitch in bytes. Pass a pointer to the last row and a negative pitch to flip the image vertically.
+        \param[in] bgra True if the source pixels are BGRA, false if they are RGBA.
+        \param[in] width Image width in pixels.
+        \param[in] height Image height in pixels.
+        \param[out] pY Luma plane of width x height values.
+        \param[in] yPitch Luma row pitch in bytes.
+        \param[out] pU U plane of ceil(width / 2) values per row.
+        \param[out] pV V plane of ceil(width / 2) values per row.
+        \param[in] uvPitch Chroma row pitch in bytes.
+        \param[in] subsampleY True for 4:2:0 (ceil(height / 2) chroma rows), false for 4:2:2 (height chroma rows).
+    */
+    dlldecl void convertRGBA8ToYUV(const uint8_t* pSrc, ptrdiff_t srcPitch, bool bgra, uint32_t width, uint32_t height, uint8_t* pY, size_t yPitch, uint8_t* pU, uint8_t* pV, size_t uvPitch, bool subsampleY);
+}
@@ -63,4 +63,87 @@ namespace Falcor
         t = perp_stark(n);
         b = cross(n, t);
     }
+
+    /** Computes the cosine of the half angle of the minimum bounding cone that encloses an AABB, as seen from a particular viewpoint.
+        This is the host-side equivalent of the function with the same name in MathHelpers.slang.
+        \param[in] origin Viewpoint origin.
+        \param[in] aabbMin minimum corner of the AABB.
+        \param[in] aabbMax maximum corner of the AABB.
+        \param[out] coneDir normalized vector defining the cone's axis.
+        \param[out] sinTheta Sine of the angle from the central direction to the cone edge. If the AABB can't be bounded we return 0.
+        \param[out] cosTheta Cosine of the angle from the central direction to the cone edge. If the AABB can't be bounded we return -1 (max cone).
+    */
+    inline void boundBoxSubtendedConeAngleCenter(const float3& origin, const float3& aabbMin, const float3& aabbMax,
+                                                 float3& coneDir, float& sinTheta, float& cosTheta)
+    {
+        const float3 center = (aabbMax + aabbMin) * 0.5f;
+        const float3 extent = (aabbMax - aabbMin) * 0.5f;
+        const float3 dir = center - origin;
+        const float extSqr = glm::dot(extent, extent);
+        const float distSqr = glm::dot(dir, dir);
+
+        coneDir = glm::normalize(dir);
+
+        const float3 e[4] =
+        {
+            float3(extent.x, extent.y, extent.z),
+            float3(extent.x, extent.y, -extent.z),
+            float3(extent.x, -extent.y, extent.z),
+            float3(extent.x, -extent.y, -extent.z)
+        };
+
+        cosTheta = 1.f;
+        sinTheta = 0.f;
+
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            const float d = std::abs(glm::dot(dir, e[i]));
+            const float x = distSqr - d;
+            if (x < 1e-5f)
+            {
+                cosTheta = -1.f;
+                sinTheta = 0.f;
+                return;
+            }
+
+            const float y = std::sqrt(std::max(0.f, distSqr * extSqr - d * d));
+            const float z = std::sqrt(x * x + y * y);
+            cosTheta = std::min(cosTheta, x / z);
+            sinTheta = std::max(sinTheta, y / z);
+        }
+    }
+
+    /** Computes the cone bounding an AABB, centered on the average direction to its corners, as seen from a particular viewpoint.
+        This is the host-side equivalent of the function with the same name in MathHelpers.slang.
+        \param[in] origin Viewpoint origin.
+        \param[in] aabbMin minimum corner of the AABB.
+        \param[in] aabbMax maximum corner of the AABB.
+        \param[out] coneDir central cone direction (normalized) or null vector if origin is inside the AABB.
+        \param[out] sinTheta sine of the angle.
+        \param[out] cosTheta cosine of the angle.
+    */
+    inline void boundBoxSubtendedConeAngleAverage(const float3& origin, const float3& aabbMin, const float3& aabbMax,
+                                                  float3& coneDir, float& sinTheta, float& cosTheta)
+    {
+        if (glm::all(glm::greaterThanEqual(origin, aabbMin)) && glm::all(glm::lessThanEqual(origin, aabbMax)))
+        {
+            coneDir = float3(0.f);
+            sinTheta = 0.f;
+            cosTheta = -1.f;
+            return;
+        }
+
+        auto getCorner = [&](uint32_t i)
+        {
+            return float3((i & 1) ? aabbMin.x : aabbMax.x, (i & 2) ? aabbMin.y : aabbMax.y, (i & 4) ? aabbMin.z : aabbMax.z);
+        };
+
+        float3 dirSum = float3(0.f);
+        for (uint32_t i = 0; i < 8; i++) dirSum += glm::normalize(getCorner(i) - origin);
+        coneDir = glm::normalize(dirSum);
+
+        cosTheta = 1.f;
+        for (uint32_t i = 0; i < 8; i++) cosTheta = std::min(cosTheta, glm::dot(glm::normalize(getCorner(i) - origin), coneDir));
+        sinTheta = std::sqrt(std::max(0.f, 1.f - cosTheta * cosTheta));
+    }
 }
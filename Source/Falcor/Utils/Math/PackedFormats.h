@@ -27,6 +27,8 @@
  **************************************************************************/
 #pragma once
 #include "Utils/Math/Vector.h"
+#include <algorithm>
+#include <cmath>
 
 /** Host-side utility functions for format conversion.
 
@@ -84,4 +86,38 @@ namespace Falcor
         float2 octNormal = glm::unpackSnorm2x16(packedNormal);
         return oct_to_ndir_snorm(octNormal);
     }
+
+    /** Encode a non-negative RGB value in the 32-bit shared-exponent format (R9G9B9E5).
+        Each component is stored with a 9-bit mantissa and the three components share a 5-bit exponent.
+        The absolute error of each component is at most 2^-9 times the largest component (or 2^-25 below 2^-16).
+        Values are clamped to [0,65408], negative values and NaNs are stored as zero.
+    */
+    inline uint32_t encodeRGB9E5(float3 color)
+    {
+        float c[3];
+        for (int i = 0; i < 3; i++) c[i] = std::isnan(color[i]) ? 0.f : std::clamp(color[i], 0.f, 65408.f);
+        const float maxComponent = std::max(c[0], std::max(c[1], c[2]));
+
+        // Shared exponent with a bias of 16, chosen so that the largest component fits in 9 bits.
+        int exponent = (maxComponent > 0.f ? std::max(-16, (int)std::floor(std::log2(maxComponent))) : -16) + 16;
+        float scale = std::exp2(float(exponent - 24));
+        if ((uint32_t)std::floor(maxComponent / scale + 0.5f) == 512)
+        {
+            exponent++;
+            scale *= 2.f;
+        }
+
+        uint32_t packedColor = uint32_t(exponent) << 27;
+        for (int i = 0; i < 3; i++) packedColor |= (uint32_t)std::floor(c[i] / scale + 0.5f) << (9 * i);
+        return packedColor;
+    }
+
+    /** Decode an RGB value stored in the 32-bit shared-exponent format (R9G9B9E5).
+        See encodeRGB9E5() for details.
+    */
+    inline float3 decodeRGB9E5(uint32_t packedColor)
+    {
+        const float scale = std::exp2(float(int(packedColor >> 27) - 24));
+        return float3(packedColor & 0x1ff, (packedColor >> 9) & 0x1ff, (packedColor >> 18) & 0x1ff) * scale;
+    }
 }
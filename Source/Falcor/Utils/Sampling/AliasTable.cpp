@@ -27,12 +27,75 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "AliasTable.h"
+#include <execution>
 
 namespace Falcor
 {
+    namespace
+    {
+        // Number of weights processed per parallel task. The chunking is fixed so the result doesn't depend on the thread count.
+        const size_t kChunkSize = 1 << 16;
+
+        // Number of table slots whose permuted indices are computed before gathering their entries.
+        const uint32_t kShuffleBatchSize = 64;
+
+        // Number of Feistel rounds of the slot permutation.
+        const uint32_t kFeistelRounds = 4;
+
+        uint32_t hash(uint32_t x)
+        {
+            x ^= x >> 16;
+            x *= 0x7feb352d;
+            x ^= x >> 15;
+            x *= 0x846ca68b;
+            x ^= x >> 16;
+            return x;
+        }
+
+        /** Pseudorandom permutation of [0, count) using a balanced Feistel network with cycle walking.
+        */
+        class Permutation
+        {
+        public:
+            Permutation(uint32_t count, uint64_t seed)
+                : mCount(count)
+            {
+                while ((1ull << (2 * mHalfBits)) < count) mHalfBits++;
+                mHalfMask = (1u << mHalfBits) - 1;
+                for (uint32_t r = 0; r < kFeistelRounds; r++) mKeys[r] = hash((uint32_t)seed ^ hash((uint32_t)(seed >> 32) + r));
+            }
+
+            uint32_t operator()(uint32_t index) const
+            {
+                // The network permutes [0, 4^halfBits), which is less than 4x the count. Walk the cycle until we're back in range.
+                do index = encrypt(index); while (index >= mCount);
+                return index;
+            }
+
+        private:
+            uint32_t encrypt(uint32_t x) const
+            {
+                uint32_t left = x >> mHalfBits;
+                uint32_t right = x & mHalfMask;
+                for (uint32_t r = 0; r < kFeistelRounds; r++)
+                {
+                    uint32_t f = hash(right ^ mKeys[r]) & mHalfMask;
+                    std::swap(left, right);
+                    right ^= f;
+                }
+                return (left << mHalfBits) | right;
+            }
+
+            uint32_t mCount;
+            uint32_t mHalfBits = 1;
+            uint32_t mHalfMask;
+            uint32_t mKeys[kFeistelRounds];
+        };
+    }
+
     AliasTable::SharedPtr AliasTable::create(std::vector<float> weights, std::mt19937& rng)
     {
-        return SharedPtr(new AliasTable(std::move(weights), rng));
+        return SharedPtr(new AliasTable(weights, rng));
     }
 
     void AliasTable::setShaderData(const ShaderVar& var) const
@@ -43,85 +106,224 @@ namespace Falcor
         var["weightSum"] = (float)mWeightSum;
     }
 
-    AliasTable::AliasTable(std::vector<float> weights, std::mt19937& rng)
-        : mCount((uint32_t)weights.size())
+    std::vector<AliasTable::Item> AliasTable::build(const std::vector<float>& weights, uint64_t seed, double* pWeightSum)
     {
         if (weights.size() > std::numeric_limits<uint32_t>::max()) throw std::exception("Too many entries for alias table.");
 
-        std::uniform_int_distribution<uint32_t> rngDist;
-
-        mpWeights = Buffer::createStructured(sizeof(float), mCount, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, weights.data());
-
-        mWeightSum = 0.0;
-        for (float f : weights) mWeightSum += f;
+        const uint32_t count = (uint32_t)weights.size();
+        const size_t chunkCount = (count + kChunkSize - 1) / kChunkSize;
+        const auto chunks = NumericRange<size_t>(0, chunkCount);
+        auto chunkRange = [&](size_t chunk) { return std::make_pair((uint32_t)(chunk * kChunkSize), (uint32_t)std::min((size_t)count, (chunk + 1) * kChunkSize)); };
 
-        double factor = mCount / mWeightSum;
-        for (float& f : weights) f = (float)(f * factor);
-
-        std::vector<uint32_t> permutation(mCount);
-        for (uint32_t i = 0; i < mCount; ++i) permutation[i] = i;
-        std::sort(permutation.begin(), permutation.end(), [&](uint32_t a, uint32_t b) { return weights[a] < weights[b]; });
+        // Sum the weights per chunk, then sum the chunks in order.
+        std::vector<double> chunkSums(chunkCount);
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
+        {
+            auto [begin, end] = chunkRange(chunk);
+            double sum = 0.0;
+            for (uint32_t i = begin; i < end; i++) sum += weights[i];
+            chunkSums[chunk] = sum;
+        });
 
-        std::vector<float> thresholds(mCount);
-        std::vector<uint32_t> redirect(mCount);
-        std::vector<uint2> mergedTable(mCount);
+        double weightSum = 0.0;
+        for (double sum : chunkSums) weightSum += sum;
+        if (pWeightSum) *pWeightSum = weightSum;
 
-        uint32_t head = 0;
-        uint32_t tail = mCount - 1;
+        // Weights scaled to an average of 1. With all weights zero we sample uniformly.
+        const double scale = weightSum > 0.0 ? count / weightSum : 0.0;
+        auto scaledWeight = [&](uint32_t i) { return scale > 0.0 ? weights[i] * scale : 1.0; };
 
-        while (head != tail)
+        // Count small weights (< 1) per chunk and compute the offsets of each chunk in the lists of small and large weights.
+        std::vector<uint32_t> chunkSmallCounts(chunkCount);
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
         {
-            int i = permutation[head];
-            int j = permutation[tail];
+            auto [begin, end] = chunkRange(chunk);
+            uint32_t smallCount = 0;
+            for (uint32_t i = begin; i < end; i++) smallCount += scaledWeight(i) < 1.0 ? 1 : 0;
+            chunkSmallCounts[chunk] = smallCount;
+        });
 
-            thresholds[i] = weights[i];
-            redirect[i] = j;
-            weights[j] -= 1.f - weights[i];
+        std::vector<uint32_t> chunkSmallOffsets(chunkCount);
+        uint32_t smallCount = 0;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            chunkSmallOffsets[chunk] = smallCount;
+            smallCount += chunkSmallCounts[chunk];
+        }
+        const uint32_t largeCount = count - smallCount;
 
-            if (head == tail - 1)
-            {
-                thresholds[j] = 1.f;
-                redirect[j] = j;
-                break;
-            }
-            else if (weights[j] < 1.f)
-            {
-                std::swap(permutation[head], permutation[tail]);
-                tail--;
-            }
-            else
+        // Stable split into small weights at the front and large weights at the back of the index list.
+        // Along with it, compute the per-chunk inclusive prefix sums of the deficits (1 - w) of the small weights and of the excesses (w - 1) of the large weights.
+        std::vector<uint32_t> indices(count);
+        std::vector<double> prefix(count);
+        std::vector<double> chunkDeficits(chunkCount);
+        std::vector<double> chunkExcesses(chunkCount);
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
+        {
+            auto [begin, end] = chunkRange(chunk);
+            uint32_t small = chunkSmallOffsets[chunk];
+            uint32_t large = smallCount + (begin - chunkSmallOffsets[chunk]);
+            double deficit = 0.0, excess = 0.0;
+            for (uint32_t i = begin; i < end; i++)
             {
-                head++;
+                double w = scaledWeight(i);
+                if (w < 1.0)
+                {
+                    deficit += 1.0 - w;
+                    prefix[small] = deficit;
+                    indices[small++] = i;
+                }
+                else
+                {
+                    excess += w - 1.0;
+                    prefix[large] = excess;
+                    indices[large++] = i;
+                }
             }
-        }
+            chunkDeficits[chunk] = deficit;
+            chunkExcesses[chunk] = excess;
+        });
 
-        for (uint32_t i = 0; i < mCount; ++i)
+        // Add the totals of the preceding chunks to get the global prefix sums.
+        std::vector<double> chunkDeficitOffsets(chunkCount), chunkExcessOffsets(chunkCount);
+        double deficitSum = 0.0, excessSum = 0.0;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++)
         {
-            permutation[i] = i;
+            chunkDeficitOffsets[chunk] = deficitSum;
+            chunkExcessOffsets[chunk] = excessSum;
+            deficitSum += chunkDeficits[chunk];
+            excessSum += chunkExcesses[chunk];
         }
 
-        for (uint32_t i = 0; i < mCount; ++i)
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
         {
-            uint32_t dst = i + (rngDist(rng) % (mCount - i));
-            std::swap(thresholds[i], thresholds[dst]);
-            std::swap(redirect[i], redirect[dst]);
-            std::swap(permutation[i], permutation[dst]);
-        }
+            auto [begin, end] = chunkRange(chunk);
+            uint32_t small = chunkSmallOffsets[chunk];
+            uint32_t large = smallCount + (begin - chunkSmallOffsets[chunk]);
+            for (uint32_t i = small; i < small + chunkSmallCounts[chunk]; i++) prefix[i] += chunkDeficitOffsets[chunk];
+            for (uint32_t i = large; i < large + (end - begin) - chunkSmallCounts[chunk]; i++) prefix[i] += chunkExcessOffsets[chunk];
+        });
 
-        struct Item
+        // Pair the small and large weights. The deficit of small weight i is covered by the large weight whose excess range
+        // contains the start of the deficit range of i. A large weight j is used up by the first small weight i whose deficit
+        // range ends past the excess range of j. The remainder of j is then covered by the next large weight j + 1.
+        // This produces the same pairing as the serial algorithm processing the small and large weights in order.
+        struct Entry
         {
             float threshold;
-            uint32_t indexA;
-            uint32_t indexB;
-            uint32_t _pad;
+            uint32_t alias;
         };
+        std::vector<Entry> entries(count);
+        const double* deficits = prefix.data();
+        const double* excesses = prefix.data() + smallCount;
 
-        std::vector<Item> items(mCount);
-        for (uint32_t i = 0; i < mCount; ++i)
+        if (largeCount == 0)
         {
-            items[i] = { thresholds[i], redirect[i], permutation[i], 0 };
+            // Only possible due to rounding when all weights are close to 1.
+            std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
+            {
+                auto [begin, end] = chunkRange(chunk);
+                for (uint32_t i = begin; i < end; i++) entries[i] = { 1.f, i };
+            });
+        }
+        else
+        {
+            const auto smallChunks = NumericRange<size_t>(0, (smallCount + kChunkSize - 1) / kChunkSize);
+            std::for_each(std::execution::par, smallChunks.begin(), smallChunks.end(), [&](size_t chunk)
+            {
+                uint32_t begin = (uint32_t)(chunk * kChunkSize);
+                uint32_t end = (uint32_t)std::min((size_t)smallCount, (chunk + 1) * kChunkSize);
+                double start = begin > 0 ? deficits[begin - 1] : 0.0;
+                uint32_t j = (uint32_t)(std::lower_bound(excesses, excesses + largeCount, start) - excesses);
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    start = i > 0 ? deficits[i - 1] : 0.0;
+                    while (j < largeCount && excesses[j] < start) j++;
+                    entries[indices[i]] = { (float)scaledWeight(indices[i]), indices[smallCount + std::min(j, largeCount - 1)] };
+                }
+            });
+
+            const auto largeChunks = NumericRange<size_t>(0, (largeCount + kChunkSize - 1) / kChunkSize);
+            std::for_each(std::execution::par, largeChunks.begin(), largeChunks.end(), [&](size_t chunk)
+            {
+                uint32_t begin = (uint32_t)(chunk * kChunkSize);
+                uint32_t end = (uint32_t)std::min((size_t)largeCount, (chunk + 1) * kChunkSize);
+                uint32_t i = (uint32_t)(std::upper_bound(deficits, deficits + smallCount, excesses[begin]) - deficits);
+                for (uint32_t j = begin; j < end; j++)
+                {
+                    while (i < smallCount && deficits[i] <= excesses[j]) i++;
+                    uint32_t index = indices[smallCount + j];
+                    if (i < smallCount && j + 1 < largeCount)
+                    {
+                        entries[index] = { (float)std::max(0.0, 1.0 + excesses[j] - deficits[i]), indices[smallCount + j + 1] };
+                    }
+                    else
+                    {
+                        entries[index] = { 1.f, index };
+                    }
+                }
+            });
         }
 
+        indices = {};
+        prefix = {};
+
+        // Shuffle the table slots. The gather is bound by cache misses, so the permuted indices are computed in batches
+        // ahead of the loads to keep the memory accesses independent of the branches in the permutation.
+        Permutation permutation(count, seed);
+        std::vector<Item> items(count);
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
+        {
+            auto [begin, end] = chunkRange(chunk);
+            uint32_t batch[kShuffleBatchSize];
+            for (uint32_t i = begin; i < end; i += kShuffleBatchSize)
+            {
+                uint32_t batchSize = std::min(kShuffleBatchSize, end - i);
+                for (uint32_t k = 0; k < batchSize; k++) batch[k] = permutation(i + k);
+                for (uint32_t k = 0; k < batchSize; k++)
+                {
+                    const Entry& entry = entries[batch[k]];
+                    items[i + k] = { entry.threshold, entry.alias, batch[k], 0 };
+                }
+            }
+        });
+
+        return items;
+    }
+
+    std::vector<double> AliasTable::benchmarkBuild(const std::vector<uint32_t>& counts)
+    {
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> uniform;
+        std::vector<double> times;
+        for (uint32_t N : counts)
+        {
+            std::vector<float> weights(N);
+            for (auto& w : weights) w = uniform(rng);
+
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            auto items = AliasTable::build(weights, 0);
+            double ms = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+            logInfo("AliasTable build (" + std::to_string(N) + " entries): " + std::to_string(ms) + " ms, " + std::to_string(N / (ms * 1000.0)) + " M entries/s");
+            times.push_back(ms);
+        }
+        return times;
+    }
+
+    AliasTable::AliasTable(const std::vector<float>& weights, std::mt19937& rng)
+        : mCount((uint32_t)weights.size())
+    {
+        const uint64_t seed = ((uint64_t)rng() << 32) | rng();
+        std::vector<Item> items = build(weights, seed, &mWeightSum);
+
+        mpWeights = Buffer::createStructured(sizeof(float), mCount, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, weights.data());
         mpItems = Buffer::createStructured(sizeof(Item), mCount, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, items.data());
     }
+
+    SCRIPT_BINDING(AliasTable)
+    {
+        pybind11::class_<AliasTable, AliasTable::SharedPtr> aliasTable(m, "AliasTable");
+        aliasTable.def_static("benchmarkBuild", &AliasTable::benchmarkBuild, "counts"_a);
+    }
 }
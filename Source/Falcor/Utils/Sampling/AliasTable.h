@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include <random>
+#include <vector>
 
 namespace Falcor
 {
@@ -37,6 +38,17 @@ namespace Falcor
     public:
         using SharedPtr = std::shared_ptr<AliasTable>;
 
+        /** Alias table item. Matches the layout of AliasTable::Item in AliasTable.slang.
+            A table slot selected uniformly at random returns 'indexB' if a uniform random number is below 'threshold', and 'indexA' otherwise.
+        */
+        struct Item
+        {
+            float threshold;                ///< Probability of returning 'indexB' in this slot.
+            uint32_t indexA;                ///< Alias index.
+            uint32_t indexB;                ///< Index of the weight owning this slot.
+            uint32_t _pad;
+        };
+
         /** Create an alias table.
             The weights don't need to be normalized to sum up to 1.
             \param[in] weights The weights we'd like to sample each entry proportional to.
@@ -45,6 +57,27 @@ namespace Falcor
         */
         static SharedPtr create(std::vector<float> weights, std::mt19937& rng);
 
+        /** Build the items of an alias table on the host.
+            The table is built in linear time in parallel on all CPU cores. Weights are split into small and large weights
+            using parallel prefix sums, and each small weight is paired with the large weight covering its position in the
+            prefix sum of the excess weights (a Vose-style partition without the serial work list).
+            The table slots are shuffled with a seeded pseudorandom permutation. The result only depends on the weights and
+            the seed, not on the number of threads. If all weights are zero, all items are sampled uniformly.
+            \param[in] weights The weights we'd like to sample each entry proportional to. The weights don't need to be normalized.
+            \param[in] seed Seed of the shuffle of the table slots.
+            \param[out] pWeightSum Optional total sum of the weights.
+            \return List of table items, one per weight.
+        */
+        static std::vector<Item> build(const std::vector<float>& weights, uint64_t seed, double* pWeightSum = nullptr);
+
+        /** Measure the time to build tables of pseudo-random weights on the host.
+            This is not part of the unit tests as large tables need several GB of memory. Run it from a script instead,
+            e.g. AliasTable.benchmarkBuild([1000000, 10000000, 100000000]).
+            \param[in] counts Number of weights of each table to build.
+            \return Build time in milliseconds of each table.
+        */
+        static std::vector<double> benchmarkBuild(const std::vector<uint32_t>& counts);
+
         /** Bind the alias table data to a given shader var.
             \param[in] var The shader variable to set the data into.
         */
@@ -59,7 +92,7 @@ namespace Falcor
         double getWeightSum() const { return mWeightSum; }
 
     private:
-        AliasTable(std::vector<float> weights, std::mt19937& rng);
+        AliasTable(const std::vector<float>& weights, std::mt19937& rng);
 
         uint32_t mCount;                    ///< Number of items in the alias table.
         double mWeightSum;                  ///< Total weight of all elements used to create the alias table.
@@ -0,0 +1,179 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "BlueNoiseSampleGenerator.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const char kMaskVarName[] = "gBlueNoiseSampleGeneratorMask";
+
+        // Parameters of the void-and-cluster method.
+        const float kSigma = 1.5f;              ///< Standard deviation of the Gaussian energy filter in texels.
+        const float kInitialDensity = 0.1f;     ///< Fraction of texels set in the initial binary pattern.
+        const uint32_t kSeed = 1;               ///< Seed of the initial binary pattern.
+
+        /** Creates a blue-noise dither array with the void-and-cluster method.
+            See "The void-and-cluster method for dither array generation", Ulichney, 1993.
+            \param[in] size Width and height of the array. Must be a power of two.
+            \return Rank of each texel in [0, size^2), in scanline order.
+        */
+        std::vector<uint32_t> createVoidAndClusterRanks(uint32_t size)
+        {
+            assert(isPowerOf2(size));
+            const uint32_t count = size * size;
+            const uint32_t mask = size - 1;
+
+            // Gaussian filter with toroidal wrap-around, centered at texel (0,0).
+            std::vector<float> filter(count);
+            for (uint32_t y = 0; y < size; y++)
+            {
+                for (uint32_t x = 0; x < size; x++)
+                {
+                    float dx = (float)std::min(x, size - x);
+                    float dy = (float)std::min(y, size - y);
+                    filter[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.f * kSigma * kSigma));
+                }
+            }
+
+            // The energy of a texel is the filtered sum of the set texels. Setting or clearing a texel updates the energy incrementally.
+            std::vector<float> energy(count, 0.f);
+            std::vector<uint8_t> pattern(count, 0);
+            auto set = [&](uint32_t i, bool value)
+            {
+                pattern[i] = value ? 1 : 0;
+                const float sign = value ? 1.f : -1.f;
+                const uint32_t ix = i & mask, iy = i / size;
+                for (uint32_t y = 0; y < size; y++)
+                {
+                    const float* pFilterRow = &filter[((y - iy) & mask) * size];
+                    float* pEnergyRow = &energy[y * size];
+                    for (uint32_t x = 0; x < size; x++) pEnergyRow[x] += sign * pFilterRow[(x - ix) & mask];
+                }
+            };
+
+            // The tightest cluster is the set texel with the highest energy, the largest void the unset texel with the lowest energy.
+            auto findTightestCluster = [&]()
+            {
+                uint32_t best = 0;
+                float bestEnergy = -std::numeric_limits<float>::infinity();
+                for (uint32_t i = 0; i < count; i++) if (pattern[i] && energy[i] > bestEnergy) { best = i; bestEnergy = energy[i]; }
+                return best;
+            };
+            auto findLargestVoid = [&]()
+            {
+                uint32_t best = 0;
+                float bestEnergy = std::numeric_limits<float>::infinity();
+                for (uint32_t i = 0; i < count; i++) if (!pattern[i] && energy[i] < bestEnergy) { best = i; bestEnergy = energy[i]; }
+                return best;
+            };
+
+            // Create the initial binary pattern from random points, then move points from the tightest
+            // cluster to the largest void until the pattern is evenly distributed.
+            std::mt19937 rng(kSeed);
+            const uint32_t initialCount = std::max(1u, (uint32_t)(count * kInitialDensity));
+            for (uint32_t n = 0; n < initialCount;)
+            {
+                uint32_t i = rng() % count;
+                if (!pattern[i]) { set(i, true); n++; }
+            }
+
+            for (uint32_t iteration = 0; iteration < count; iteration++)
+            {
+                uint32_t cluster = findTightestCluster();
+                set(cluster, false);
+                uint32_t largestVoid = findLargestVoid();
+                set(largestVoid, true);
+                if (largestVoid == cluster) break;
+            }
+
+            std::vector<uint32_t> ranks(count);
+            const std::vector<uint8_t> initialPattern = pattern;
+            const std::vector<float> initialEnergy = energy;
+
+            // Rank the points of the initial pattern by removing the tightest clusters.
+            for (uint32_t rank = initialCount; rank-- > 0;)
+            {
+                uint32_t cluster = findTightestCluster();
+                set(cluster, false);
+                ranks[cluster] = rank;
+            }
+
+            // Rank the remaining texels by filling the largest voids.
+            // Once more than half of the texels are set, the largest void is also the tightest cluster of unset texels,
+            // so this covers both the second and third phase of the original method.
+            pattern = initialPattern;
+            energy = initialEnergy;
+            for (uint32_t rank = initialCount; rank < count; rank++)
+            {
+                uint32_t largestVoid = findLargestVoid();
+                set(largestVoid, true);
+                ranks[largestVoid] = rank;
+            }
+
+            return ranks;
+        }
+    }
+
+    BlueNoiseSampleGenerator::SharedPtr BlueNoiseSampleGenerator::create()
+    {
+        return SharedPtr(new BlueNoiseSampleGenerator());
+    }
+
+    BlueNoiseSampleGenerator::BlueNoiseSampleGenerator()
+        : SampleGenerator(SAMPLE_GENERATOR_BLUE_NOISE)
+    {
+        const auto& mask = getMask();
+        mpMask = Buffer::createTyped<uint32_t>((uint32_t)mask.size(), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, mask.data());
+    }
+
+    bool BlueNoiseSampleGenerator::setShaderData(const ShaderVar& var) const
+    {
+        assert(var.isValid());
+
+        auto maskVar = var.findMember(kMaskVarName);
+        if (!maskVar.isValid()) return false;
+        maskVar = mpMask;
+        return true;
+    }
+
+    const std::vector<uint32_t>& BlueNoiseSampleGenerator::getMask()
+    {
+        static const std::vector<uint32_t> sMask = []()
+        {
+            // Map the ranks to the centers of equally sized intervals in 32-bit fixed point.
+            std::vector<uint32_t> mask = createVoidAndClusterRanks(kBlueNoiseMaskSize);
+            const uint32_t shift = 32 - 2 * kBlueNoiseMaskSizeLog2;
+            for (auto& v : mask) v = (v << shift) + (1u << (shift - 1));
+            return mask;
+        }();
+        return sMask;
+    }
+}
@@ -0,0 +1,95 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "SampleGenerator.h"
+#include "SobolSequence.slangh"
+#include "BlueNoiseMask.slangh"
+
+namespace Falcor
+{
+    /** Blue-noise sample generator.
+
+        On the GPU, the generator is implemented in BlueNoiseSampleGenerator.slang.
+        This class creates the blue-noise mask and binds it to the shader.
+        The nested State class is the host implementation, which produces the
+        same samples as the GPU for the same pixel and sample number.
+    */
+    class dlldecl BlueNoiseSampleGenerator : public SampleGenerator
+    {
+    public:
+        using SharedPtr = std::shared_ptr<BlueNoiseSampleGenerator>;
+
+        /** Create a new object.
+        */
+        static SharedPtr create();
+
+        /** Binds the blue-noise mask to a shader variable.
+            \param[in] var Shader variable of the program that uses the sample generator.
+            \return false if the program doesn't use the blue-noise sample generator, true otherwise.
+        */
+        virtual bool setShaderData(const ShaderVar& var) const override;
+
+        /** Get the blue-noise mask.
+            The mask has kBlueNoiseMaskSize^2 texels in scanline order, each holding a 32-bit fixed-point offset in [0,1).
+            The offsets are a permutation of the centers of kBlueNoiseMaskSize^2 equally sized intervals.
+            The mask is created with the void-and-cluster method on first use.
+        */
+        static const std::vector<uint32_t>& getMask();
+
+        /** Host version of the per-pixel generator state in BlueNoiseSampleGenerator.slang.
+        */
+        class State
+        {
+        public:
+            /** Create the generator for a given pixel and sample number.
+                \param[in] pixel Pixel id.
+                \param[in] sampleNumber Sample number, i.e., index of the point in the sequence.
+            */
+            State(uint2 pixel, uint32_t sampleNumber) : mPixel(pixel), mIndex(sampleNumber), mMask(getMask()) {}
+
+            /** Returns the next dimension of the point as 32-bit fixed-point value.
+            */
+            uint32_t next()
+            {
+                uint32_t offset = mMask[getBlueNoiseMaskIndex(mPixel, mDimension)];
+                return shuffledScrambledSobol(mIndex, mDimension++, kBlueNoiseSequenceSeed) + offset;
+            }
+
+        private:
+            uint2 mPixel;
+            uint32_t mIndex;
+            uint32_t mDimension = 0;
+            const std::vector<uint32_t>& mMask;
+        };
+
+    protected:
+        BlueNoiseSampleGenerator();
+
+        Buffer::SharedPtr mpMask;   ///< Blue-noise mask on the GPU.
+    };
+}
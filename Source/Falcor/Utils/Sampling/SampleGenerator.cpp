@@ -27,6 +27,8 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "SampleGenerator.h"
+#include "SobolSampleGenerator.h"
+#include "BlueNoiseSampleGenerator.h"
 
 namespace Falcor
 {
@@ -67,6 +69,8 @@ namespace Falcor
     {
         registerType(SAMPLE_GENERATOR_TINY_UNIFORM, "Tiny uniform (32-bit)", [] () { return SharedPtr(new SampleGenerator(SAMPLE_GENERATOR_TINY_UNIFORM)); });
         registerType(SAMPLE_GENERATOR_UNIFORM, "Uniform (128-bit)", [] () { return SharedPtr(new SampleGenerator(SAMPLE_GENERATOR_UNIFORM)); });
+        registerType(SAMPLE_GENERATOR_SOBOL, "Owen-scrambled Sobol", [] () { return SobolSampleGenerator::create(); });
+        registerType(SAMPLE_GENERATOR_BLUE_NOISE, "Blue-noise Sobol", [] () { return BlueNoiseSampleGenerator::create(); });
     }
 
     // Automatically register basic sampler types.
@@ -85,4 +85,35 @@ namespace Falcor
 
         friend struct RegisterSampleGenerators;
     };
+
+    /** Convenience functions for generating 1D/2D/3D values in the range [0,1) with host sample generators.
+        These match the functions in SampleGeneratorInterface.slang, so a host generator that returns
+        the same values from next() as its GPU counterpart also produces the same samples.
+    */
+    template<typename S>
+    float sampleNext1D(S& sg)
+    {
+        // Use upper 24 bits and divide by 2^24 to get a number u in [0,1).
+        uint32_t bits = sg.next();
+        return (bits >> 8) * 0x1p-24f;
+    }
+
+    template<typename S>
+    float2 sampleNext2D(S& sg)
+    {
+        float2 sample;
+        sample.x = sampleNext1D(sg);
+        sample.y = sampleNext1D(sg);
+        return sample;
+    }
+
+    template<typename S>
+    float3 sampleNext3D(S& sg)
+    {
+        float3 sample;
+        sample.x = sampleNext1D(sg);
+        sample.y = sampleNext1D(sg);
+        sample.z = sampleNext1D(sg);
+        return sample;
+    }
 }
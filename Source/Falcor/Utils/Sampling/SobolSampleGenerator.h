@@ -0,0 +1,74 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "SampleGenerator.h"
+#include "SobolSequence.slangh"
+
+namespace Falcor
+{
+    /** Owen-scrambled Sobol sample generator.
+
+        On the GPU, the generator is implemented in SobolSampleGenerator.slang.
+        It doesn't need any data, so this class only selects the type.
+        The nested State class is the host implementation, which produces the
+        same samples as the GPU for the same pixel and sample number.
+    */
+    class dlldecl SobolSampleGenerator : public SampleGenerator
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SobolSampleGenerator>;
+
+        /** Create a new object.
+        */
+        static SharedPtr create() { return SharedPtr(new SobolSampleGenerator()); }
+
+        /** Host version of the per-pixel generator state in SobolSampleGenerator.slang.
+        */
+        class State
+        {
+        public:
+            /** Create the generator for a given pixel and sample number.
+                \param[in] pixel Pixel id.
+                \param[in] sampleNumber Sample number, i.e., index of the point in the sequence of the pixel.
+            */
+            State(uint2 pixel, uint32_t sampleNumber) : mIndex(sampleNumber), mSeed(getSobolPixelSeed(pixel)) {}
+
+            /** Returns the next dimension of the point as 32-bit fixed-point value.
+            */
+            uint32_t next() { return shuffledScrambledSobol(mIndex, mDimension++, mSeed); }
+
+        private:
+            uint32_t mIndex;
+            uint32_t mSeed;
+            uint32_t mDimension = 0;
+        };
+
+    protected:
+        SobolSampleGenerator() : SampleGenerator(SAMPLE_GENERATOR_SOBOL) {}
+    };
+}
@@ -30,6 +30,7 @@
 #include "TimeReport.h"
 #include "Utils/Logger.h"
 #include "Utils/StringUtils.h"
+#include "Core/Platform/OS.h"
 
 namespace Falcor
 {
@@ -46,9 +47,11 @@ namespace Falcor
 
     void TimeReport::printToLog()
     {
-        for (const auto& [task, duration] : mMeasurements)
+        for (const auto& m : mMeasurements)
         {
-            logInfo(padStringToLength(task + ":", 25) + " " + std::to_string(duration) + " s");
+            std::string msg = padStringToLength(m.name + ":", 25) + " " + std::to_string(m.duration) + " s";
+            if (m.peakWorkingSetSize > 0) msg += " (memory " + formatByteSize(m.workingSetSize) + ", peak " + formatByteSize(m.peakWorkingSetSize) + ")";
+            logInfo(msg);
         }
     }
 
@@ -57,12 +60,12 @@ namespace Falcor
         auto currentTime = CpuTimer::getCurrentTimePoint();
         std::chrono::duration<double> duration = currentTime - mLastMeasureTime;
         mLastMeasureTime = currentTime;
-        mMeasurements.push_back({name, duration.count()});
+        mMeasurements.push_back({ name, duration.count(), getProcessWorkingSetSize(), getProcessPeakWorkingSetSize() });
     }
 
     void TimeReport::addTotal(const std::string name)
     {
-        double total = std::accumulate(mMeasurements.begin(), mMeasurements.end(), 0.0, [] (double t, auto &&m) { return t + m.second; });
-        mMeasurements.push_back({"Total", total});
+        double total = std::accumulate(mMeasurements.begin(), mMeasurements.end(), 0.0, [] (double t, auto &&m) { return t + m.duration; });
+        mMeasurements.push_back({ name, total, getProcessWorkingSetSize(), getProcessPeakWorkingSetSize() });
     }
 }
@@ -35,6 +35,8 @@ namespace Falcor
 {
     /** Utility class to record a number of timing measurements and print them afterwards.
         This is mainly intended for measuring longer running tasks on the CPU.
+        Each measurement also records the physical memory used by the process at the end of the task,
+        and the peak physical memory used so far. A task that raised the peak shows up as an increase in the latter.
     */
     class dlldecl TimeReport
     {
@@ -61,7 +63,15 @@ namespace Falcor
         void addTotal(const std::string name = "Total");
 
     private:
+        struct Measurement
+        {
+            std::string name;
+            double duration = 0.0;              ///< Duration in seconds.
+            uint64_t workingSetSize = 0;        ///< Physical memory used by the process after the task in bytes.
+            uint64_t peakWorkingSetSize = 0;    ///< Peak physical memory used by the process so far in bytes.
+        };
+
         CpuTimer::TimePoint mLastMeasureTime;
-        std::vector<std::pair<std::string, double>> mMeasurements;
+        std::vector<Measurement> mMeasurements;
     };
 }
@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "VideoEncoder.h"
+#include "Utils/Image/PixelConversion.h"
 
 extern "C"
 {
@@ -99,7 +100,7 @@ namespace Falcor
             return false;
         }
 
-        AVCodecContext* createCodecContext(AVFormatContext* pCtx, uint32_t width, uint32_t height, uint32_t fps, float bitrateMbps, uint32_t gopSize, AVCodecID codecID, AVCodec* pCodec)
+        AVCodecContext* createCodecContext(AVFormatContext* pCtx, uint32_t width, uint32_t height, uint32_t fps, float bitrateMbps, uint32_t gopSize, uint32_t threadCount, AVCodecID codecID, AVCodec* pCodec)
         {
             // Initialize the codec context
             AVCodecContext* pCodecCtx = avcodec_alloc_context3(pCodec);
@@ -111,6 +112,10 @@ namespace Falcor
             pCodecCtx->gop_size = gopSize;
             pCodecCtx->pix_fmt = getPictureFormatFromCodec(codecID);
 
+            // Let the codec use frame and slice threading. It uses whichever it supports.
+            pCodecCtx->thread_count = (int)threadCount;
+            pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
             // Some formats want stream headers to be separate
             if (pCtx->oformat->flags & AVFMT_GLOBALHEADER)
             {
@@ -166,7 +171,7 @@ namespace Falcor
             return pFrame;
         }
 
-        bool openVideo(AVCodec* pCodec, AVCodecContext* pCodecCtx, AVFrame*& pFrame, const std::string& filename)
+        bool openVideo(AVCodec* pCodec, AVCodecContext* pCodecCtx, const std::string& filename)
         {
             AVDictionary* param = nullptr;
 
@@ -188,15 +193,18 @@ namespace Falcor
                 return error(filename, "Can't open video codec.");
             }
             av_dict_free(&param);
-
-            // create a frame
-            pFrame = allocateFrame(pCodecCtx->pix_fmt, pCodecCtx->width, pCodecCtx->height, filename);
-            if (pFrame == nullptr)
-            {
-                return false;
-            }
             return true;
         }
+
+        bool isPlanarYUV(AVPixelFormat format)
+        {
+            return format == AV_PIX_FMT_YUV420P || format == AV_PIX_FMT_YUV422P;
+        }
+
+        double getElapsedSeconds(CpuTimer::TimePoint start)
+        {
+            return CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1e-3;
+        }
     }
 
     VideoEncoder::VideoEncoder(const std::string& filename)
@@ -253,14 +261,14 @@ namespace Falcor
             return false;
         }
 
-        mpCodecContext = createCodecContext(mpOutputContext, desc.width, desc.height, desc.fps, desc.bitrateMbps, desc.gopSize, getCodecID(desc.codec), pVideoCodec);
+        mpCodecContext = createCodecContext(mpOutputContext, desc.width, desc.height, desc.fps, desc.bitrateMbps, desc.gopSize, desc.codecThreadCount, getCodecID(desc.codec), pVideoCodec);
         if(mpCodecContext == nullptr)
         {
             return false;
         }
 
         // Open the video stream
-        if(openVideo(pVideoCodec, mpCodecContext, mpFrame, mFilename) == false)
+        if(openVideo(pVideoCodec, mpCodecContext, mFilename) == false)
         {
             return false;
         }
@@ -288,17 +296,37 @@ namespace Falcor
 
         mFormat = desc.format;
         mRowPitch = getFormatBytesPerBlock(desc.format) * desc.width;
-        if(desc.flipY)
+        mFlipY = desc.flipY;
+        mDropFramesWhenFull = desc.dropFramesWhenFull;
+
+        // Planar YUV frames are converted with our own SIMD kernel. Other codec formats use SWScale.
+        assert(isFormatSupported(desc.format));
+        if(isPlanarYUV(mpCodecContext->pix_fmt) == false)
         {
-            mpFlippedImage = new uint8_t[desc.height * mRowPitch];
+            mpSwsContext = sws_getContext(desc.width, desc.height, getPictureFormatFromFalcorFormat(desc.format), desc.width, desc.height, mpCodecContext->pix_fmt, SWS_POINT, nullptr, nullptr, nullptr);
+            if(mpSwsContext == nullptr)
+            {
+                return error(mFilename, "Failed to allocate SWScale context");
+            }
         }
 
-        assert(isFormatSupported(desc.format));
-        mpSwsContext = sws_getContext(desc.width, desc.height, getPictureFormatFromFalcorFormat(desc.format), desc.width, desc.height, mpCodecContext->pix_fmt, SWS_POINT, nullptr, nullptr, nullptr);
-        if(mpSwsContext == nullptr)
+        // Allocate the frame queues
+        const uint32_t queueSize = std::max(desc.queueSize, 1u);
+        for(uint32_t i = 0; i < queueSize; i++)
         {
-            return error(mFilename, "Failed to allocate SWScale context");
+            AVFrame* pFrame = allocateFrame(mpCodecContext->pix_fmt, desc.width, desc.height, mFilename);
+            if(pFrame == nullptr)
+            {
+                return false;
+            }
+            mFrames.push_back(pFrame);
+            mFrameData.emplace_back(desc.height * mRowPitch);
+            mFreeFrames.push(i);
+            mFreeData.push(i);
         }
+
+        mConversionThread = std::thread(&VideoEncoder::runConversion, this);
+        mEncodingThread = std::thread(&VideoEncoder::runEncoding, this);
         return true;
     }
 
@@ -337,6 +365,15 @@ namespace Falcor
 
     void VideoEncoder::endCapture()
     {
+        // Let the threads finish the queued frames
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+        }
+        mCondition.notify_all();
+        if(mConversionThread.joinable()) mConversionThread.join();
+        if(mEncodingThread.joinable()) mEncodingThread.join();
+
         if(mpOutputContext)
         {
             // Flush the codex
@@ -347,52 +384,207 @@ namespace Falcor
 
             avio_closep(&mpOutputContext->pb);
             avcodec_free_context(&mpCodecContext);
-            av_frame_free(&mpFrame);
+            for(auto& pFrame : mFrames) av_frame_free(&pFrame);
             sws_freeContext(mpSwsContext);
             avformat_free_context(mpOutputContext);
             mpOutputContext = nullptr;
             mpOutputStream = nullptr;
+            mpSwsContext = nullptr;
+            mFrames.clear();
+            mFrameData.clear();
+            mEndTime = CpuTimer::getCurrentTimePoint();
+
+            if(mStats.framesSubmitted > 0)
+            {
+                const Stats stats = getStats();
+                logInfo("Video capture " + mFilename + ": encoded " + std::to_string(stats.framesEncoded) + " frames at " + std::to_string(stats.encodedFps) + " fps, dropped " + std::to_string(stats.framesDropped) +
+                    " frames, stalled " + std::to_string(stats.stallCount) + " times for " + std::to_string(stats.stallTime) + " seconds.");
+            }
         }
-        safe_delete(mpFlippedImage)
     }
 
-    void VideoEncoder::appendFrame(const void* pData)
+    bool VideoEncoder::appendFrame(const void* pData)
     {
-        if(mpFlippedImage)
+        uint32_t index;
         {
-            // Flip the image
-            for(int32_t h = 0; h < mpCodecContext->height; h++)
+            std::unique_lock<std::mutex> lock(mMutex);
+            if(mTerminate || mFrameData.empty())
+            {
+                return false;
+            }
+
+            if(mStats.framesSubmitted++ == 0)
             {
-                const uint8_t* pSrc = (uint8_t*)pData + h * mRowPitch;
-                uint8_t* pDst = mpFlippedImage + (mpCodecContext->height - 1 - h) * mRowPitch;
-                memcpy(pDst, pSrc, mRowPitch);
+                mStartTime = CpuTimer::getCurrentTimePoint();
             }
 
-            pData = mpFlippedImage;
+            if(mFreeData.empty())
+            {
+                if(mDropFramesWhenFull)
+                {
+                    mStats.framesDropped++;
+                    return false;
+                }
+
+                // Back-pressure: wait for the conversion thread to release a frame copy
+                auto start = CpuTimer::getCurrentTimePoint();
+                mCondition.wait(lock, [this]() { return !mFreeData.empty(); });
+                mStats.stallCount++;
+                mStats.stallTime += getElapsedSeconds(start);
+            }
+
+            index = mFreeData.front();
+            mFreeData.pop();
         }
 
-        uint8_t* src[AV_NUM_DATA_POINTERS] = {0};
-        int32_t rowPitch[AV_NUM_DATA_POINTERS] = {0};
-        src[0] = (uint8_t*)pData;
-        rowPitch[0] = (int32_t)mRowPitch;
+        // Copy outside the lock so that the threads can keep working
+        std::memcpy(mFrameData[index].data(), pData, mFrameData[index].size());
 
-        // Scale and convert the image
-        sws_scale(mpSwsContext, src, rowPitch, 0, mpCodecContext->height, mpFrame->data, mpFrame->linesize);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mPendingData.push(index);
+        }
+        mCondition.notify_all();
+        return true;
+    }
 
-        // Encode the frame
-        int r = avcodec_send_frame(mpCodecContext, mpFrame);
-        mpFrame->pts++;
-        if(r == AVERROR(EAGAIN))
+    VideoEncoder::Stats VideoEncoder::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Stats stats = mStats;
+        stats.queuedFrames = (uint32_t)(mPendingData.size() + mPendingFrames.size());
+        if(stats.framesSubmitted > 0)
         {
-            if(flush(mpCodecContext, mpOutputContext, mpOutputStream, mFilename) == false)
+            const auto end = mpOutputContext ? CpuTimer::getCurrentTimePoint() : mEndTime;
+            const double seconds = CpuTimer::calcDuration(mStartTime, end) * 1e-3;
+            stats.encodedFps = seconds > 0 ? stats.framesEncoded / seconds : 0;
+        }
+        return stats;
+    }
+
+    void VideoEncoder::convertFrame(const uint8_t* pData, AVFrame* pFrame)
+    {
+        // A negative pitch flips the image
+        const uint8_t* pSrc = pData;
+        ptrdiff_t pitch = (ptrdiff_t)mRowPitch;
+        if(mFlipY)
+        {
+            pSrc += (mpCodecContext->height - 1) * pitch;
+            pitch = -pitch;
+        }
+
+        if(mpSwsContext == nullptr)
+        {
+            const bool bgra = getPictureFormatFromFalcorFormat(mFormat) == AV_PIX_FMT_BGRA;
+            const bool subsampleY = mpCodecContext->pix_fmt == AV_PIX_FMT_YUV420P;
+            convertRGBA8ToYUV(pSrc, pitch, bgra, mpCodecContext->width, mpCodecContext->height, pFrame->data[0], (size_t)pFrame->linesize[0], pFrame->data[1], pFrame->data[2], (size_t)pFrame->linesize[1], subsampleY);
+        }
+        else
+        {
+            const uint8_t* src[AV_NUM_DATA_POINTERS] = { pSrc };
+            int32_t rowPitch[AV_NUM_DATA_POINTERS] = { (int32_t)pitch };
+            sws_scale(mpSwsContext, src, rowPitch, 0, mpCodecContext->height, pFrame->data, pFrame->linesize);
+        }
+    }
+
+    void VideoEncoder::runConversion()
+    {
+        while(true)
+        {
+            uint32_t dataIndex, frameIndex;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this]() { return (!mPendingData.empty() && !mFreeFrames.empty()) || (mTerminate && mPendingData.empty()); });
+                if(mPendingData.empty()) break;
+
+                dataIndex = mPendingData.front();
+                mPendingData.pop();
+                frameIndex = mFreeFrames.front();
+                mFreeFrames.pop();
+            }
+
+            // The codec may still reference the frame buffers when using frame threading. Make them writable, which copies them if needed.
+            auto start = CpuTimer::getCurrentTimePoint();
+            AVFrame* pFrame = mFrames[frameIndex];
+            bool converted = av_frame_make_writable(pFrame) >= 0;
+            if(converted)
+            {
+                convertFrame(mFrameData[dataIndex].data(), pFrame);
+            }
+            else
             {
-                return;
+                error(mFilename, "Can't make video frame writable");
             }
+            const double conversionTime = getElapsedSeconds(start);
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mFreeData.push(dataIndex);
+                if(converted)
+                {
+                    pFrame->pts = mNextPts++;
+                    mPendingFrames.push(frameIndex);
+                }
+                else
+                {
+                    mFreeFrames.push(frameIndex);
+                    mStats.framesDropped++;
+                }
+                mStats.conversionTime += conversionTime;
+            }
+            mCondition.notify_all();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mConversionDone = true;
         }
-        else if(r < 0)
+        mCondition.notify_all();
+    }
+
+    void VideoEncoder::runEncoding()
+    {
+        while(true)
         {
-            error(mFilename, "Can't send video frame");
-            return;
+            uint32_t frameIndex;
+            bool encodingFailed;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this]() { return !mPendingFrames.empty() || mConversionDone; });
+                if(mPendingFrames.empty()) break;
+
+                frameIndex = mPendingFrames.front();
+                mPendingFrames.pop();
+                encodingFailed = mEncodingFailed;
+            }
+
+            // After a codec error the frames are discarded, so that appendFrame() doesn't block forever
+            auto start = CpuTimer::getCurrentTimePoint();
+            bool encoded = false;
+            if(encodingFailed == false)
+            {
+                int r = avcodec_send_frame(mpCodecContext, mFrames[frameIndex]);
+                if(r < 0)
+                {
+                    error(mFilename, "Can't send video frame");
+                }
+                else
+                {
+                    // Write all packets the codec has ready, so that it never refuses the next frame
+                    encoded = flush(mpCodecContext, mpOutputContext, mpOutputStream, mFilename);
+                }
+            }
+            const double encodingTime = getElapsedSeconds(start);
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mFreeFrames.push(frameIndex);
+                if(encoded) mStats.framesEncoded++;
+                else mStats.framesDropped++;
+                mEncodingFailed = mEncodingFailed || !encoded;
+                mStats.encodingTime += encodingTime;
+            }
+            mCondition.notify_all();
         }
     }
 
@@ -26,6 +26,11 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #pragma once
+#include "Utils/Timing/CpuTimer.h"
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
 
 struct AVFormatContext;
 struct AVStream;
@@ -35,6 +40,13 @@ struct AVCodecContext;
 
 namespace Falcor
 {
+    /** Video encoder writing frames to a file using FFmpeg.
+
+        Frames are encoded asynchronously. appendFrame() copies the frame into a bounded queue and returns.
+        A conversion thread converts queued frames to the codec pixel format, and an encoding thread
+        passes them to the codec and writes the packets to the file. When the queue is full, appendFrame()
+        either blocks until a slot is available or drops the frame, see Desc::dropFramesWhenFull.
+    */
     class dlldecl VideoEncoder
     {
     public:
@@ -61,6 +73,24 @@ namespace Falcor
             ResourceFormat format = ResourceFormat::BGRA8UnormSrgb;
             bool flipY = false;
             std::string filename;
+            uint32_t queueSize = 4;             ///< Number of frames that can wait for conversion and encoding. Must be at least 1.
+            bool dropFramesWhenFull = false;    ///< If true, appendFrame() drops the frame when the queue is full. If false, it waits for a free slot.
+            uint32_t codecThreadCount = 0;      ///< Number of threads used by the codec. 0 lets the codec choose based on the number of CPU cores.
+        };
+
+        /** Encoder statistics.
+        */
+        struct Stats
+        {
+            uint64_t framesSubmitted = 0;   ///< Number of appendFrame() calls.
+            uint64_t framesEncoded = 0;     ///< Number of frames passed to the codec.
+            uint64_t framesDropped = 0;     ///< Number of frames dropped because the queue was full.
+            uint64_t stallCount = 0;        ///< Number of appendFrame() calls that waited for a free slot.
+            double stallTime = 0;           ///< Total time in seconds appendFrame() waited for free slots.
+            double conversionTime = 0;      ///< Total time in seconds spent converting frames to the codec pixel format.
+            double encodingTime = 0;        ///< Total time in seconds spent encoding frames and writing packets.
+            double encodedFps = 0;          ///< Frames encoded per second, measured from the first appendFrame() call.
+            uint32_t queuedFrames = 0;      ///< Number of frames waiting for conversion or encoding.
         };
 
         ~VideoEncoder();
@@ -71,9 +101,22 @@ namespace Falcor
         */
         static UniquePtr create(const Desc& desc);
 
-        void appendFrame(const void* pData);
+        /** Queue a frame for encoding.
+            The frame data is copied, so the memory can be reused when the call returns.
+            Dropped frames are left out of the video, which shortens it.
+            \param[in] pData Frame of width x height pixels in the format given at creation, with tightly packed rows.
+            \return True if the frame was queued, false if it was dropped.
+        */
+        bool appendFrame(const void* pData);
+
+        /** Wait for all queued frames to be encoded and close the file.
+        */
         void endCapture();
 
+        /** Get the encoder statistics.
+        */
+        Stats getStats() const;
+
         static bool isFormatSupported(ResourceFormat format);
         static FileDialogFilterVec getSupportedContainerForCodec(Codec codec);
 
@@ -81,15 +124,41 @@ namespace Falcor
         VideoEncoder(const std::string& filename);
         bool init(const Desc& desc);
 
+        void runConversion();
+        void runEncoding();
+        void convertFrame(const uint8_t* pData, AVFrame* pFrame);
+
         AVFormatContext* mpOutputContext = nullptr;
         AVStream*        mpOutputStream  = nullptr;
-        AVFrame*         mpFrame         = nullptr;
         SwsContext*      mpSwsContext    = nullptr;
         AVCodecContext*  mpCodecContext = nullptr;
 
         const std::string mFilename;
         ResourceFormat mFormat;
         uint32_t mRowPitch = 0;
-        uint8_t* mpFlippedImage = nullptr; // Used in case the image memory layout if bottom->top
+        bool mFlipY = false;
+        bool mDropFramesWhenFull = false;
+
+        // Frame queues. Frames move from mFreeData to mPendingData in appendFrame(), are converted into one of the
+        // codec frames by the conversion thread, and pass from mPendingFrames back to mFreeFrames in the encoding thread.
+        std::vector<std::vector<uint8_t>> mFrameData;   ///< Copies of appended frames.
+        std::vector<AVFrame*> mFrames;                  ///< Frames in the codec pixel format.
+        std::queue<uint32_t> mFreeData;                 ///< Indices of unused frame copies.
+        std::queue<uint32_t> mPendingData;              ///< Indices of frame copies waiting for conversion.
+        std::queue<uint32_t> mFreeFrames;               ///< Indices of unused codec frames.
+        std::queue<uint32_t> mPendingFrames;            ///< Indices of codec frames waiting for encoding.
+
+        std::thread mConversionThread;
+        std::thread mEncodingThread;
+        mutable std::mutex mMutex;                      ///< Protects the queues, flags and statistics.
+        std::condition_variable mCondition;             ///< Signaled when any queue or flag changes.
+        bool mTerminate = false;                        ///< Set by endCapture() to stop the threads once the queues are empty.
+        bool mConversionDone = false;                   ///< Set when the conversion thread has finished.
+        bool mEncodingFailed = false;                   ///< Set after a codec error. Later frames are discarded.
+        int64_t mNextPts = 0;                           ///< Presentation timestamp of the next converted frame.
+
+        Stats mStats;
+        CpuTimer::TimePoint mStartTime;
+        CpuTimer::TimePoint mEndTime;
     };
 }
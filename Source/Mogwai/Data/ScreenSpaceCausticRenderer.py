@@ -134,6 +134,7 @@ def getSSCRGraph(myFilter, lateFiltering, enableDebugTools):
     g.addEdge("GBuffer.specRough", "ScreenSpaceCaustics.mtlSpecRough")
     g.addEdge("GBuffer.emissive", "ScreenSpaceCaustics.mtlEmissive")
     g.addEdge("GBuffer.matlExtra", "ScreenSpaceCaustics.mtlParams")
+    g.addEdge("GBuffer.mvec", "ScreenSpaceCaustics.mvec")
     if myFilter == MyFilter.SVGF:
         g.addEdge("ScreenSpaceCaustics.albedo", "SSCR_SVGFPass.Albedo")
         g.addEdge("GBuffer.emissive", "SSCR_SVGFPass.Emission")
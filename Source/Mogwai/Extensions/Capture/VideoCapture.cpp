@@ -70,6 +70,14 @@ namespace Mogwai
             CaptureTrigger::renderUI(w);
             w.separator();
             mpEncoderUI->render(w, true);
+
+            for (const auto& e : mEncoders)
+            {
+                if (!e.pEncoder) continue;
+                const auto stats = e.pEncoder->getStats();
+                w.text(e.output + ": " + std::to_string(stats.framesEncoded) + " frames encoded (" + std::to_string((uint32_t)stats.encodedFps) + " fps), " +
+                    std::to_string(stats.queuedFrames) + " queued, " + std::to_string(stats.framesDropped) + " dropped, " + std::to_string(stats.stallCount) + " stalls");
+            }
         }
     }
 
@@ -114,6 +122,7 @@ namespace Mogwai
     void VideoCapture::endRange(RenderGraph* pGraph, const Range& r)
     {
         for (const auto& e : mEncoders) e.pEncoder->endCapture();
+        mEncoders.clear();
     }
 
     void VideoCapture::triggerFrame(RenderContext* pCtx, RenderGraph* pGraph, uint64_t frameID)
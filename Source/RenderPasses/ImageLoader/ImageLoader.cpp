@@ -38,6 +38,11 @@ namespace
     const std::string kSrgb = "srgb";
     const std::string kArraySlice = "arrayIndex";
     const std::string kMipLevel = "mipLevel";
+    const std::string kSequence = "sequence";
+    const std::string kFirstFrame = "firstFrame";
+    const std::string kFrameCount = "frameCount";
+    const std::string kPrefetchCount = "prefetchCount";
+    const std::string kLoop = "loop";
 
     void regImageLoader(pybind11::module& m)
     {
@@ -82,6 +87,11 @@ ImageLoader::ImageLoader(const Dictionary& dict)
         else if (key == kMips) mGenerateMips = value;
         else if (key == kArraySlice) mArraySlice = value;
         else if (key == kMipLevel) mMipLevel = value;
+        else if (key == kSequence) mSequence = value;
+        else if (key == kFirstFrame) mFirstFrame = value;
+        else if (key == kFrameCount) mFrameCount = value;
+        else if (key == kPrefetchCount) mPrefetchCount = value;
+        else if (key == kLoop) mLoop = value;
         else logWarning("Unknown field '" + key + "' in a ImageLoader dictionary");
     }
 
@@ -90,11 +100,16 @@ ImageLoader::ImageLoader(const Dictionary& dict)
         // Find the full path of the specified image.
         // We retain this for later as the search paths may change during execution.
         std::string fullPath;
-        if (findFileInDataDirectories(mImageName, fullPath))
+        if (mSequence)
+        {
+            // Sequence patterns don't name an existing file. The frames are searched for when they are loaded.
+            load(mImageName);
+        }
+        else if (findFileInDataDirectories(mImageName, fullPath))
         {
             load(fullPath);
         }
-        if (!mpTex) throw std::runtime_error("ImageLoader() - Failed to load image file '" + mImageName + "'");
+        if (!mpTex && !mpSequence) throw std::runtime_error("ImageLoader() - Failed to load image file '" + mImageName + "'");
     }
 }
 
@@ -107,12 +122,20 @@ Dictionary ImageLoader::getScriptingDictionary()
     dict[kSrgb] = mLoadSRGB;
     dict[kArraySlice] = mArraySlice;
     dict[kMipLevel] = mMipLevel;
+    if (mSequence)
+    {
+        dict[kSequence] = mSequence;
+        dict[kFirstFrame] = mFirstFrame;
+        dict[kFrameCount] = mFrameCount;
+        dict[kPrefetchCount] = mPrefetchCount;
+        dict[kLoop] = mLoop;
+    }
     return dict;
 }
 
 void ImageLoader::compile(RenderContext* pContext, const CompileData& compileData)
 {
-    if (!mpTex) throw std::runtime_error("ImageLoader::compile() - No image loaded!");
+    if (!mpTex && !mpSequence) throw std::runtime_error("ImageLoader::compile() - No image loaded!");
 }
 
 void ImageLoader::execute(RenderContext* pContext, const RenderData& renderData)
@@ -121,6 +144,8 @@ void ImageLoader::execute(RenderContext* pContext, const RenderData& renderData)
     assert(pDstTex);
     mOutputFormat = pDstTex->getFormat();
 
+    if (mpSequence) updateSequenceFrame(pContext);
+
     if (!mpTex)
     {
         pContext->clearRtv(pDstTex->getRTV().get(), float4(0, 0, 0, 0));
@@ -137,6 +162,34 @@ void ImageLoader::renderUI(Gui::Widgets& widget)
     bool reloadImage = widget.textbox("Image File", mImageName);
     reloadImage |= widget.checkbox("Load As SRGB", mLoadSRGB);
     reloadImage |= widget.checkbox("Generate Mipmaps", mGenerateMips);
+    reloadImage |= widget.checkbox("Image Sequence", mSequence);
+    widget.tooltip("Load the image file as a filename pattern with a frame number, e.g. 'frame####.exr' or 'frame%04d.exr'.\n"
+        "The sequence frame follows the global clock frame.", true);
+
+    if (mSequence)
+    {
+        reloadImage |= widget.var("First Frame", mFirstFrame);
+        reloadImage |= widget.var("Frame Count", mFrameCount);
+        widget.tooltip("Number of frames in the sequence. Zero uses all consecutive files starting at the first frame.", true);
+        reloadImage |= widget.var("Prefetch Count", mPrefetchCount, 1u, 64u);
+        widget.tooltip("Number of decoded frames held in memory ahead of playback.", true);
+        reloadImage |= widget.checkbox("Loop", mLoop);
+
+        if (mpSequence)
+        {
+            const auto stats = mpSequence->getStats();
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(2)
+                << "Frame: " << mSequenceFrame << " / " << mpSequence->getFrameCount() << "\n"
+                << "Prefetched frames: " << stats.framesReady << "\n"
+                << "Hits: " << stats.hits << " Misses: " << stats.misses << " (" << stats.getHitRate() * 100.0 << "% hit rate)\n"
+                << "Average decode time: " << stats.getAverageDecodeTime() * 1e3 << " ms\n"
+                << "Average wait time: " << stats.getAverageWaitTime() * 1e3 << " ms (max " << stats.maxWaitTime * 1e3 << " ms)\n"
+                << "Discarded frames: " << stats.framesDiscarded << " Failures: " << stats.decodeFailures;
+            widget.text(oss.str());
+            if (widget.button("Reset Stats")) mpSequence->resetStats();
+        }
+    }
 
     if (widget.button("Load File"))
     {
@@ -161,5 +214,46 @@ void ImageLoader::renderUI(Gui::Widgets& widget)
 void ImageLoader::load(const std::string& filename)
 {
     mImageName = stripDataDirectories(filename);
-    mpTex = Texture::createFromFile(mImageName, mGenerateMips, mLoadSRGB);
+    mpSequence = nullptr;
+    mpSequenceFrame = nullptr;
+
+    if (mSequence)
+    {
+        // The texture is created when the first frame is uploaded
+        ImageSequence::Desc desc;
+        desc.frameCount = mFrameCount;
+        desc.bufferSize = std::max(mPrefetchCount, 1u);
+        desc.loop = mLoop;
+        mpSequence = ImageSequence::createFromFiles(mImageName, mFirstFrame, desc);
+        mpTex = nullptr;
+    }
+    else
+    {
+        mpTex = Texture::createFromFile(mImageName, mGenerateMips, mLoadSRGB);
+    }
+}
+
+void ImageLoader::updateSequenceFrame(RenderContext* pContext)
+{
+    const uint64_t clockFrame = gpFramework->getGlobalClock().getFrame();
+    const uint32_t frameCount = mpSequence->getFrameCount();
+    const uint32_t frame = mLoop ? uint32_t(clockFrame % frameCount) : (uint32_t)std::min<uint64_t>(clockFrame, frameCount - 1);
+
+    // Keep showing the previous frame if the new one failed to load
+    ImageSequence::FramePtr pFrame = mpSequence->getFrame(frame);
+    if (!pFrame || pFrame == mpSequenceFrame) return;
+    mpSequenceFrame = pFrame;
+    mSequenceFrame = frame;
+
+    // Reuse the texture unless the frame size or format changed
+    const ResourceFormat format = mLoadSRGB ? linearToSrgbFormat(pFrame->getFormat()) : pFrame->getFormat();
+    if (!mpTex || mpTex->getWidth() != pFrame->getWidth() || mpTex->getHeight() != pFrame->getHeight() || mpTex->getFormat() != format)
+    {
+        mpTex = Texture::create2D(pFrame->getWidth(), pFrame->getHeight(), format, 1, mGenerateMips ? Texture::kMaxPossible : 1, pFrame->getData());
+    }
+    else
+    {
+        pContext->updateSubresourceData(mpTex.get(), 0, pFrame->getData());
+        if (mGenerateMips) mpTex->generateMips(pContext);
+    }
 }
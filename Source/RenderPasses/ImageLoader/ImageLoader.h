@@ -50,6 +50,7 @@ public:
 
 private:
     ImageLoader(const Dictionary& dict);
+    void updateSequenceFrame(RenderContext* pContext);
 
     ResourceFormat mOutputFormat = ResourceFormat::Unknown;
     Texture::SharedPtr mpTex;
@@ -58,4 +59,14 @@ private:
     uint32_t mMipLevel = 0;
     bool mGenerateMips = false;
     bool mLoadSRGB = true;
+
+    // Image sequence playback. The image name is a filename pattern, and the frame follows the global clock.
+    bool mSequence = false;                         ///< Load the image name as an image sequence.
+    uint32_t mFirstFrame = 0;                       ///< Frame number of the first file.
+    uint32_t mFrameCount = 0;                       ///< Number of frames, or 0 to use all consecutive files.
+    uint32_t mPrefetchCount = 8;                    ///< Number of decoded frames held ahead of playback.
+    bool mLoop = true;                              ///< Loop the sequence, or else hold the last frame.
+    ImageSequence::UniquePtr mpSequence;
+    ImageSequence::FramePtr mpSequenceFrame;        ///< Frame currently uploaded to mpTex.
+    uint32_t mSequenceFrame = 0;                    ///< Index of the frame in mpTex.
 };
@@ -95,6 +95,9 @@ namespace
     const std::string kPathDebugOutput = "paths";
     const std::string kInternalDebugOutput = "debug_visualisation";
 
+    // Render pass input channels.
+    const std::string kMotionVectorInput = "mvec";
+
     const ChannelList kOutputTextures =
     {
         { kColorOutput,         "gOutputColor",         "Output color (linear)",                     true /* optional */                           },
@@ -116,12 +119,24 @@ namespace
 static_assert(has_vtable<ScreenSpaceCausticsParams>::value == false, "ScreenSpaceCausticsParams must be non-virtual");
 static_assert(sizeof(ScreenSpaceCausticsParams) % 16 == 0, "ScreenSpaceCausticsParams size should be a multiple of 16");
 
+static_assert(has_vtable<ProjectionVolumeData>::value == false, "ProjectionVolumeData must be non-virtual");
+static_assert(sizeof(ProjectionVolumeData) % 16 == 0, "ProjectionVolumeData size should be a multiple of 16");
+
 static_assert(has_vtable<CachingPointData>::value == false, "CachingPointData must be non-virtual");
 static_assert(sizeof(CachingPointData) % 16 == 0, "CachingPointData size should be a multiple of 16");
 
 static_assert(has_vtable<PathToCachingPointData>::value == false, "PathToCachingPointData must be non-virtual");
 static_assert(sizeof(PathToCachingPointData) % 16 == 0, "PathToCachingPointData size should be a multiple of 16");
 
+static_assert(has_vtable<PackedCachingPointData>::value == false, "PackedCachingPointData must be non-virtual");
+static_assert(sizeof(PackedCachingPointData) % 16 == 0, "PackedCachingPointData size should be a multiple of 16");
+
+static_assert(has_vtable<PackedPathToCachingPointData>::value == false, "PackedPathToCachingPointData must be non-virtual");
+static_assert(sizeof(PackedPathToCachingPointData) % 16 == 0, "PackedPathToCachingPointData size should be a multiple of 16");
+
+static_assert(has_vtable<ProgressivePhotonState>::value == false, "ProgressivePhotonState must be non-virtual");
+static_assert(sizeof(ProgressivePhotonState) % 16 == 0, "ProgressivePhotonState size should be a multiple of 16");
+
 static_assert(has_vtable<CachingDebugData>::value == false, "CachingDebugData must be non-virtual");
 static_assert(sizeof(CachingDebugData) % 16 == 0, "CachingDebugData size should be a multiple of 16");
 
@@ -295,6 +310,8 @@ RenderPassReflection ScreenSpaceCaustics::reflect(const CompileData& compileData
     auto& pathDebugOutput = reflection.addOutput(pathDebugDesc.name, pathDebugDesc.desc);
     pathDebugOutput.bindFlags(pathDebugOutput.getBindFlags() | ResourceBindFlags::RenderTarget);
 
+    reflection.addInput(kMotionVectorInput, "Motion vectors, used to reproject caching points into the previous frame").flags(RenderPassReflection::Field::Flags::Optional);
+
     return reflection;
 }
 
@@ -331,12 +348,32 @@ void ScreenSpaceCaustics::compile(RenderContext* pRenderContext, const CompileDa
     mpPreviousAccumulatedPhotonCount->setName(mName + ".PreviousAccumulatedPhotonCount");
     pRenderContext->clearUAV(mpPreviousAccumulatedPhotonCount->getUAV().get(), uint4(0u));
 
+    mpAccumulatedStatsHigh = Buffer::create(byteSize, ResourceBindFlags::UnorderedAccess | ResourceBindFlags::ShaderResource);
+    assert(mpAccumulatedStatsHigh);
+    mpAccumulatedStatsHigh->setName(mName + ".AccumulatedStatsHigh");
+    pRenderContext->clearUAV(mpAccumulatedStatsHigh->getUAV().get(), uint4(0u));
+
+    // The progressive states are allocated in execute(), and only when the progressive radius schedule is used.
+    mpProgressiveState = nullptr;
+
     mPixelCount = pixelCount;
     mResetTemporalReuse = true;
 
     if (mSharedCustomParams.useCache) recreateCachingData(pRenderContext);
 }
 
+void ScreenSpaceCaustics::prepareExecute(const RenderData& renderData)
+{
+    // Rebuild the projection volumes on the CPU. Clustering the casters is the costliest CPU work of the pass
+    // in animated scenes, and doesn't need the render context. The volumes are uploaded in execute().
+    if (mpScene)
+    {
+        auto const materialsChanged = is_set(mpScene->getUpdates(), Scene::UpdateFlags::MaterialsChanged);
+        if (materialsChanged) computeListOfSpecularMaterials();
+        if (materialsChanged || is_set(mpScene->getUpdates(), Scene::UpdateFlags::MeshesMoved)) computeProjectionVolume();
+    }
+}
+
 void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderData& renderData)
 {
     if (mOptionsChanged) mResetTemporalReuse = true;
@@ -381,6 +418,12 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
         pRenderContext->clearUAV(countUAV.get(), uint4(0));
     }
 
+    // The compact caching data stores the caching point depth in a few bits only.
+    if (mUseCompactCachingData && mSharedParams.maxBounces > kPackedCachingPointMaxDepth)
+    {
+        logWarning("ScreenSpaceCaustics: Compact caching data supports at most " + std::to_string(kPackedCachingPointMaxDepth) + " bounces. Clamping the max path length.");
+        mSharedParams.maxBounces = kPackedCachingPointMaxDepth;
+    }
     mSharedParams.maxNonSpecularBounces = mSharedParams.maxBounces;
     mSharedLightTracingParams.maxBounces = mSharedParams.maxBounces;
     mSharedLightTracingParams.maxNonSpecularBounces = mSharedCustomParams.usePhotonsForAll ? mSharedLightTracingParams.maxBounces :
@@ -392,7 +435,8 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
     assert(mpLightTracingEmissiveSampler);
     mpLightTracingEmissiveSampler->update(pRenderContext);
 
-    if (mSharedCustomParams.useCache && !mpCache) recreateCachingData(pRenderContext);
+    if (mSharedCustomParams.useCache && (!mpCache || mRecreateCachingData)) recreateCachingData(pRenderContext);
+    mRecreateCachingData = false;
 
     auto& pPreviousFrameCachingData = mPerFrameCachingData[1 - mSelectedFrameCachingData];
     auto& pCurrentFrameCachingData = mPerFrameCachingData[mSelectedFrameCachingData];
@@ -405,8 +449,25 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
     pPathTracingProgram->addDefine("USE_FIXED_SEARCH_RADIUS", mUseFixedSearchRadius ? "1" : "0");
     pPathTracingProgram->addDefine("CAP_SEARCH_RADIUS", mCapSearchRadius ? "1" : "0");
     pPathTracingProgram->addDefine("SEPARATE_AABB_STORAGE", mSeparateAABBStorage ? "1" : "0");
+
+    // The progressive radius schedule relies on the temporal reuse pass to detect disocclusions.
+    const bool useProgressiveRadius = mUseProgressiveRadius && !mDisableTemporalReuse;
+    pPathTracingProgram->addDefine("USE_PROGRESSIVE_RADIUS", useProgressiveRadius ? "1" : "0");
+    if (!useProgressiveRadius)
+    {
+        // The shaders don't access the states without the define, so a null buffer is bound instead.
+        mpProgressiveState = nullptr;
+    }
+    else if (!mpProgressiveState)
+    {
+        mpProgressiveState = Buffer::createStructured(sizeof(ProgressivePhotonState), mPixelCount);
+        assert(mpProgressiveState);
+        mpProgressiveState->setName(mName + ".ProgressiveState");
+        pRenderContext->clearUAV(mpProgressiveState->getUAV().get(), uint4(0u));
+    }
     mCollectionPointReuse.pProgram->addDefine("CAP_COLLECTING_POINTS", mCapReuseCollectingPoints ? "1" : "0");
     mCollectionPointReuse.pProgram->addDefine("INTERPOLATE_AABB_DATA", mInterpolatePreviousContributions ? "1" : "0");
+    mCollectionPointReuse.pProgram->addDefine("USE_REPROJECTION", mUseReprojectionReuse && renderData[kMotionVectorInput] ? "1" : "0");
     RtProgram::SharedPtr pProgram = mTracer.pProgram;
     setLTStaticParams(pProgram.get());
     pProgram->addDefine("USE_CACHE", mSharedCustomParams.useCache ? "1" : "0");
@@ -414,6 +475,24 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
     pProgram->addDefine("LATE_BSDF_APPLICATION", mLateBSDFApplication ? "1" : "0");
     mCopy.pProgram->addDefine("USE_CACHE", mSharedCustomParams.useCache ? "1" : "0");
     mCopy.pProgram->addDefine("LATE_BSDF_APPLICATION", mLateBSDFApplication ? "1" : "0");
+    mCopy.pProgram->addDefine("USE_PROGRESSIVE_RADIUS", useProgressiveRadius ? "1" : "0");
+
+    // Select the formats of the per-pixel caching and stats buffers.
+    {
+        bool layoutChanged = false;
+        for (Program* pCachingProgram : { (Program*)pPathTracingProgram.get(), (Program*)mGenerateAABBs.pProgram.get(), (Program*)mCollectionPointReuse.pProgram.get(), (Program*)pProgram.get(),
+                                          (Program*)mApplyBSDF.pProgram.get(), (Program*)mCopy.pProgram.get(), (Program*)mDownloadDebug.pProgram.get(), (Program*)mDebugVisualiser.pProgram.get() })
+        {
+            layoutChanged = pCachingProgram->addDefine("USE_COMPACT_CACHING_DATA", mUseCompactCachingData ? "1" : "0") || layoutChanged;
+            layoutChanged = pCachingProgram->addDefine("USE_WIDE_ACCUMULATION", mUseWideAccumulation ? "1" : "0") || layoutChanged;
+        }
+        if (layoutChanged)
+        {
+            mPathTracing.pVars = nullptr;
+            mTracer.pVars = nullptr;
+            mDebugVisualiser.pVars = ComputeVars::create(mDebugVisualiser.pProgram.get());
+        }
+    }
     if (mSharedCustomParams.useCache && mpCache)
     {
         mpCache->prepareProgram(pPathTracingProgram);
@@ -513,6 +592,7 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
 
     mpPixelDebug->prepareProgram(pProgram, mTracer.pVars->getRootVar());
     mpPixelStats->prepareProgram(pProgram, mTracer.pVars->getRootVar());
+    mpPathDebug->setSelectedPixel(mDebugSelectedPixel);
     mpPathDebug->prepareProgram(pProgram);
     mpPathDebug->setShaderData(mTracer.pVars->getRootVar());
 
@@ -533,6 +613,11 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
         mPathTracing.pCacheRelatedBlock["sceneMax"] = sceneBounds.maxPoint;
         mPathTracing.pCacheRelatedBlock["maxSearchRadius"] = mMaxSearchRadius;
 
+        // Caching points of this frame are stored relative to the current camera position.
+        pCurrentFrameCachingData.cachingPointOrigin = mpScene->getCamera()->getPosition();
+        mPathTracing.pCacheRelatedBlock["cachingPointOrigin"] = pCurrentFrameCachingData.cachingPointOrigin;
+        mPathTracing.pCacheRelatedBlock["progressiveState"] = mpProgressiveState;
+
         if (!mSeparateAABBStorage) mPathTracing.pCacheRelatedBlock["aabbs"] = mpCache->getAabbBuffer();
 
         mPathTracing.pCacheRelatedBlock["currentFramePixelCoords"] = pCurrentFrameCachingData.pIndexToPixelMap;
@@ -540,6 +625,9 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
         mPathTracing.pCacheRelatedBlock["pathToCachingPointData"] = mpPathToCachingPointData;
     }
 
+    // Clear the progressive states before path tracing uses their radii, so that a reset restarts from the footprint-based radius.
+    if (mResetTemporalReuse && mpProgressiveState) pRenderContext->clearUAV(mpProgressiveState->getUAV().get(), uint4(0u));
+
     if (!mSharedCustomParams.usePhotonsForAll || mSharedCustomParams.useCache)
     {
         PROFILE("ScreenSpaceCaustics::execute()_pathTracing");
@@ -564,12 +652,16 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
     if (mSharedCustomParams.useCache && (!mResetTemporalReuse && !mDisableTemporalReuse))
     {
         mCollectionPointReuse.pVars->getRootVar()["gTraversedAABBCount"] = renderData[kTraversedAABBCount] ? renderData[kTraversedAABBCount]->asTexture() : Texture::SharedPtr();
+        mCollectionPointReuse.pVars->getRootVar()["gMotionVectors"] = renderData[kMotionVectorInput] ? renderData[kMotionVectorInput]->asTexture() : Texture::SharedPtr();
 
         mCollectionPointReuse.pBlock["frameDim"] = mSharedParams.frameDim;
         mCollectionPointReuse.pBlock["maxUsedCollectingPoints"] = mMaxReuseCollectingPoints;
 
         mCollectionPointReuse.pBlock["aabbBVH"].setSrv(mpCache->getAccelerationStructure());
 
+        mCollectionPointReuse.pBlock["previousFrameCachingPointOrigin"] = pPreviousFrameCachingData.cachingPointOrigin;
+        mCollectionPointReuse.pBlock["currentFrameCachingPointOrigin"] = pCurrentFrameCachingData.cachingPointOrigin;
+
         mCollectionPointReuse.pBlock["previousFramePixelCoords"] = pPreviousFrameCachingData.pIndexToPixelMap;
         mCollectionPointReuse.pBlock["previousFrameCachingPointData"] = pPreviousFrameCachingData.pCachingPointData;
         mCollectionPointReuse.pBlock["previousFrameStatsOutput"] = pCurrentFrameCachingData.pAccumulatedStats;
@@ -589,6 +681,7 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
     }
 
     pRenderContext->clearUAV(pCurrentFrameCachingData.pAccumulatedStats->getUAV().get(), float4(0.0f));
+    if (mUseWideAccumulation) pRenderContext->clearUAV(mpAccumulatedStatsHigh->getUAV().get(), uint4(0u));
 
     if (mEnableDebug)
     {
@@ -617,6 +710,7 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
 
             pGlobalVars["pathToCachingPointData"] = mpPathToCachingPointData;
             pGlobalVars["statsOutput"] = pCurrentFrameCachingData.pAccumulatedStats;
+            pGlobalVars["statsHighOutput"] = mpAccumulatedStatsHigh;
 
             PROFILE("ScreenSpaceCaustics::execute()_applyBSDF");
             mpScene->raytrace(pRenderContext, mApplyBSDF.pProgram.get(), mApplyBSDF.pVars, uint3(mSharedParams.frameDim, 1));
@@ -626,11 +720,14 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
         pGlobalVars["Params"]["frameDim"] = targetDim;
         pGlobalVars["Params"]["disableTemporalReuse"] = mDisableTemporalReuse ? 1 : 0;
         pGlobalVars["Params"]["reuseAlpha"] = mResetTemporalReuse ? 0.0f : mReuseAlpha;
+        pGlobalVars["Params"]["progressiveAlpha"] = mProgressiveRadiusAlpha;
 
         pGlobalVars["currentFrameStatsOutput"] = pCurrentFrameCachingData.pAccumulatedStats;
+        pGlobalVars["currentFrameStatsHighOutput"] = mpAccumulatedStatsHigh;
         pGlobalVars["pathToCachingPointData"] = mpPathToCachingPointData;
 
         pGlobalVars["previousFrameStatsOutput"] = pPreviousFrameCachingData.pAccumulatedStats;
+        pGlobalVars["progressiveState"] = mpProgressiveState;
         pGlobalVars["gOutputColor"] = colorTexture;
         pGlobalVars["gOutputCount"] = countResource ? countResource->asTexture() : Texture::SharedPtr();
         pGlobalVars["gOutputSearchRadius"] = searchRadiusResource ? searchRadiusResource->asTexture() : Texture::SharedPtr();
@@ -649,6 +746,8 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
         auto pGlobalVars = mDownloadDebug.pVars->getRootVar();
         pGlobalVars["Params"]["frameDim"] = targetDim;
         pGlobalVars["Params"]["selectedPixel"] = mDebugSelectedPixel;
+        pGlobalVars["Params"]["previousFrameCachingPointOrigin"] = pPreviousFrameCachingData.cachingPointOrigin;
+        pGlobalVars["Params"]["currentFrameCachingPointOrigin"] = pCurrentFrameCachingData.cachingPointOrigin;
 
         pGlobalVars["previousFramePixelCoords"] = pPreviousFrameCachingData.pIndexToPixelMap;
         pGlobalVars["previousFrameStatsOutput"] = mpPreviousAccumulatedStats;
@@ -656,6 +755,7 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
 
         pGlobalVars["currentFramePixelCoords"] = pCurrentFrameCachingData.pIndexToPixelMap;
         pGlobalVars["currentFrameStatsOutput"] = pCurrentFrameCachingData.pAccumulatedStats;
+        pGlobalVars["currentFrameStatsHighOutput"] = mpAccumulatedStatsHigh;
         pGlobalVars["currentFrameCachingPointData"] = pCurrentFrameCachingData.pCachingPointData;
 
         pGlobalVars["pathToCachingPointData"] = mpPathToCachingPointData;
@@ -686,6 +786,7 @@ void ScreenSpaceCaustics::execute(RenderContext* pRenderContext, const RenderDat
 
         pGlobalVars["currentFramePixelCoords"] = pCurrentFrameCachingData.pIndexToPixelMap;
         pGlobalVars["currentFrameStatsOutput"] = pCurrentFrameCachingData.pAccumulatedStats;
+        pGlobalVars["currentFrameStatsHighOutput"] = mpAccumulatedStatsHigh;
         pGlobalVars["currentFrameCachingPointData"] = pCurrentFrameCachingData.pCachingPointData;
 
         pGlobalVars["pathToCachingPointData"] = mpPathToCachingPointData;
@@ -730,7 +831,7 @@ void ScreenSpaceCaustics::renderUI(Gui::Widgets& widget)
         "The supported range is [1," + std::to_string(kMaxLightSamplesPerVertex) + "].", true);
 
     uint maxPathLength = mSharedParams.maxBounces + 2u;
-    if (widget.var("Max path length", maxPathLength, 2u, kMaxPathLength + 2u))
+    if (widget.var("Max path length", maxPathLength, 2u, (mUseCompactCachingData ? kPackedCachingPointMaxDepth : kMaxPathLength) + 2u))
     {
         mSharedParams.maxBounces = maxPathLength - 2u; // -1 for segments to bounces conversion, -1 as first handled by the G-buffer.
         dirty = true;
@@ -766,6 +867,13 @@ void ScreenSpaceCaustics::renderUI(Gui::Widgets& widget)
     }
 
     dirty |= widget.checkbox("Ignore projection volume", mSharedCustomParams.ignoreProjectionVolume);
+    if (widget.var("Max projection volumes", mMaxProjectionVolumeCount, 1u, 64u))
+    {
+        if (mpScene) computeProjectionVolume();
+        mHitRateEstimates.clear();
+        dirty = true;
+    }
+    widget.tooltip("The specular casters are clustered into at most that many boxes, and light paths are guided towards those boxes instead of a single box enclosing all casters.");
     dirty |= widget.checkbox("Accumulate non-specular photons too", mSharedCustomParams.usePhotonsForAll);
     dirty |= widget.checkbox("Allow single diffuse bounce on caustic paths", mAllowSingleDiffuseBounce);
     widget.tooltip("Only when caching is disabled");
@@ -788,6 +896,10 @@ void ScreenSpaceCaustics::renderUI(Gui::Widgets& widget)
         dirty = true;
     }
 
+    dirty = widget.checkbox("Wide photon accumulation", mUseWideAccumulation) || dirty;
+    widget.tooltip("Accumulate photon contributions as 64-bit fixed point (40 fractional bits) instead of 32-bit fixed point (28 fractional bits, saturating at 16).\n"
+                   "This avoids overflows with bright caustics and precision loss with dim ones, at the cost of an extra buffer and atomic per channel.");
+
     // Draw sub-group for caching options.
     auto cachingGroup = widget.group("##Caching", mSharedCustomParams.useCache);
     dirty = widget.checkbox("Caching", mSharedCustomParams.useCache, true) || dirty;
@@ -815,7 +927,29 @@ void ScreenSpaceCaustics::renderUI(Gui::Widgets& widget)
         dirty = widget.var("Reuse alpha", mReuseAlpha, 0.0f, 1.0f) || dirty;
         widget.tooltip("A reuse of 0 will only use new data while 1 will only use old data.");
 
+        dirty = widget.checkbox("Progressive search radius", mUseProgressiveRadius) || dirty;
+        widget.tooltip("Accumulate the photons of each collection point over frames and shrink its search radius progressively, "
+                       "as in stochastic progressive photon mapping. The result converges while the view is static instead of settling at a fixed bias. "
+                       "This replaces the blending by the reuse alpha, and requires temporal reuse to detect disocclusions.");
+        dirty = widget.var("Progressive alpha", mProgressiveRadiusAlpha, 0.01f, 1.0f) || dirty;
+        widget.tooltip("Fraction of the new photons kept per frame. Smaller values shrink the search radius faster.");
+
         dirty = widget.checkbox("Interpolate previous contributions", mInterpolatePreviousContributions) || dirty;
+
+        dirty = widget.checkbox("Reprojection reuse", mUseReprojectionReuse) || dirty;
+        widget.tooltip("Find the previous caching point of each pixel by reprojecting it with the motion vectors, validated by depth, normal and material. "
+                       "The spatial query against the previous caching points is only used when this fails. Requires the 'mvec' input to be connected.");
+
+        if (widget.checkbox("Compact caching data", mUseCompactCachingData))
+        {
+            mRecreateCachingData = true;
+            dirty = true;
+        }
+        widget.tooltip("Store the per-pixel caching point and camera path data in quantised formats (octahedral directions, depth along the camera ray, "
+                       "shared-exponent throughput and log-encoded radius), which halves their memory footprint and bandwidth.\n"
+                       "The max path length is limited to " + std::to_string(kPackedCachingPointMaxDepth + 2u) + " with this layout.");
+
+        renderMemoryUI(widget);
     }
     cachingGroup.release();
 
@@ -919,7 +1053,22 @@ void ScreenSpaceCaustics::renderUI(Gui::Widgets& widget)
     const float3& pvMax = mSharedCustomParams.projectionVolumeMax;
     widget.text("Projection volume:\n"\
                 "\tmin=( " + std::to_string(pvMin.x) + " " + std::to_string(pvMin.y) + " " + std::to_string(pvMin.z) + " )\n"\
-                "\tmax=( " + std::to_string(pvMax.x) + " " + std::to_string(pvMax.y) + " " + std::to_string(pvMax.z) + " )");
+                "\tmax=( " + std::to_string(pvMax.x) + " " + std::to_string(pvMax.y) + " " + std::to_string(pvMax.z) + " )\n"\
+                "\tcount=" + std::to_string(mProjectionVolumes.size()));
+
+    if (mpScene && widget.button("Estimate hit rates")) estimateProjectionVolumeHitRates();
+    widget.tooltip("Estimates, for each number of projection volumes up to the maximum, the fraction of photons that would hit a specular caster.");
+    if (!mHitRateEstimates.empty())
+    {
+        std::string table = "Volumes  Hit rate  Avg. solid angle\n";
+        for (const auto& estimate : mHitRateEstimates)
+        {
+            char line[64];
+            std::snprintf(line, sizeof(line), "%7u  %7.2f%%  %.4f sr\n", estimate.volumeCount, estimate.getHitRate() * 100.f, estimate.averageSolidAngle);
+            table += line;
+        }
+        widget.text(table);
+    }
 
     renderLoggingUI(widget);
 
@@ -1060,6 +1209,7 @@ void ScreenSpaceCaustics::computerEmissionMaterialIndex()
 void ScreenSpaceCaustics::computeProjectionVolume()
 {
     AABB projectionVolume;
+    mCasterBounds.clear();
     const auto& globalMatrices = mpScene->getAnimationController()->getGlobalMatrices();
     const auto meshInstanceCount = mpScene->getMeshInstanceCount();
     for (uint32_t meshInstanceID = 0; meshInstanceID < meshInstanceCount; ++meshInstanceID)
@@ -1070,11 +1220,79 @@ void ScreenSpaceCaustics::computeProjectionVolume()
         const auto& meshBound = mpScene->getMeshBounds(meshInstance.meshID);
         const auto& instanceTransform = globalMatrices[meshInstance.globalMatrixID];
 
-        projectionVolume.include(meshBound.transform(instanceTransform));
+        mCasterBounds.push_back(meshBound.transform(instanceTransform));
+        projectionVolume.include(mCasterBounds.back());
     }
 
     mSharedCustomParams.projectionVolumeMin = projectionVolume.minPoint;
     mSharedCustomParams.projectionVolumeMax = projectionVolume.maxPoint;
+
+    // Cluster the casters into several volumes. Without any caster, keep the (invalid) enclosing box so that
+    // the sampling code behaves as it did with a single volume.
+    mProjectionVolumes = ProjectionVolumeBuilder::build(mCasterBounds, mMaxProjectionVolumeCount);
+    if (mProjectionVolumes.empty()) mProjectionVolumes.push_back(projectionVolume);
+    mProjectionVolumesDirty = true;
+}
+
+void ScreenSpaceCaustics::uploadProjectionVolumes()
+{
+    std::vector<ProjectionVolumeData> volumeData(mProjectionVolumes.size());
+    for (size_t i = 0; i < mProjectionVolumes.size(); ++i)
+    {
+        volumeData[i].minPoint = mProjectionVolumes[i].minPoint;
+        volumeData[i].maxPoint = mProjectionVolumes[i].maxPoint;
+    }
+
+    if (!mpProjectionVolumes || mpProjectionVolumes->getElementCount() < volumeData.size())
+    {
+        mpProjectionVolumes = Buffer::createStructured(sizeof(ProjectionVolumeData), (uint32_t)volumeData.size(), ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, volumeData.data(), false);
+    }
+    else
+    {
+        mpProjectionVolumes->setBlob(volumeData.data(), 0, volumeData.size() * sizeof(ProjectionVolumeData));
+    }
+    mProjectionVolumesDirty = false;
+}
+
+void ScreenSpaceCaustics::estimateProjectionVolumeHitRates()
+{
+    // Gather the emitters: point and directional lights, and a subset of the emissive triangles.
+    using Emitter = ProjectionVolumeBuilder::Emitter;
+    const uint32_t kMaxTriangleEmitterCount = 1024;
+    std::vector<Emitter> emitters;
+    for (uint32_t lightID = 0; lightID < mpScene->getLightCount(); ++lightID)
+    {
+        const auto& pLight = mpScene->getLight(lightID);
+        const auto& lightData = pLight->getData();
+        if (pLight->getType() == LightType::Point) emitters.push_back({ Emitter::Type::Point, lightData.posW, lightData.dirW });
+        else if (pLight->getType() == LightType::Directional) emitters.push_back({ Emitter::Type::Directional, lightData.posW, lightData.dirW });
+    }
+    if (mpScene->useEmissiveLights())
+    {
+        const auto& triangles = mpScene->getLightCollection(gpDevice->getRenderContext())->getMeshLightTriangles();
+        const size_t stride = std::max<size_t>(1, triangles.size() / kMaxTriangleEmitterCount);
+        for (size_t i = 0; i < triangles.size(); i += stride) emitters.push_back({ Emitter::Type::Triangle, triangles[i].getCenter(), triangles[i].normal });
+    }
+
+    mHitRateEstimates.clear();
+    if (emitters.empty() || mCasterBounds.empty())
+    {
+        logWarning("ScreenSpaceCaustics: cannot estimate hit rates without point/directional/emissive lights and specular casters.");
+        return;
+    }
+
+    const uint32_t kSamplesPerEmitter = 4096;
+    std::string log = "ScreenSpaceCaustics: projection volume hit rates\n";
+    for (uint32_t volumeCount = 1; volumeCount <= mMaxProjectionVolumeCount; ++volumeCount)
+    {
+        const auto volumes = ProjectionVolumeBuilder::build(mCasterBounds, volumeCount);
+        if (!mHitRateEstimates.empty() && volumes.size() == mHitRateEstimates.back().volumeCount) break;
+
+        mHitRateEstimates.push_back(ProjectionVolumeBuilder::estimateHitRate(volumes, mCasterBounds, emitters, kSamplesPerEmitter));
+        const auto& estimate = mHitRateEstimates.back();
+        log += "  " + std::to_string(estimate.volumeCount) + " volume(s): hit rate " + std::to_string(estimate.getHitRate() * 100.f) + "%, average solid angle " + std::to_string(estimate.averageSolidAngle) + " sr\n";
+    }
+    logInfo(log);
 }
 
 void ScreenSpaceCaustics::recreateCachingData(RenderContext* pRenderContext)
@@ -1089,7 +1307,7 @@ void ScreenSpaceCaustics::recreateCachingData(RenderContext* pRenderContext)
         perFrameData.pIndexToPixelMap->setName(mName + ".IndexToPixelMap" + indexing);
         pRenderContext->clearUAV(perFrameData.pIndexToPixelMap->getUAV().get(), uint4(std::numeric_limits<uint32_t>::max()));
 
-        perFrameData.pCachingPointData = Buffer::createStructured(sizeof(CachingPointData), mPixelCount);
+        perFrameData.pCachingPointData = Buffer::createStructured(mUseCompactCachingData ? sizeof(PackedCachingPointData) : sizeof(CachingPointData), mPixelCount);
         assert(perFrameData.pCachingPointData);
         perFrameData.pCachingPointData->setName(mName + ".CacheCustomData" + indexing);
 
@@ -1100,7 +1318,7 @@ void ScreenSpaceCaustics::recreateCachingData(RenderContext* pRenderContext)
     assert(mPixelCount == mSharedParams.frameDim.x * mSharedParams.frameDim.y);
     mpCache->allocate(mSharedParams.frameDim);
 
-    mpPathToCachingPointData = Buffer::createStructured(sizeof(PathToCachingPointData), mPixelCount);
+    mpPathToCachingPointData = Buffer::createStructured(mUseCompactCachingData ? sizeof(PackedPathToCachingPointData) : sizeof(PathToCachingPointData), mPixelCount);
     assert(mpPathToCachingPointData);
     mpPathToCachingPointData->setName(mName + ".PathToCachingPointData");
 }
@@ -1180,6 +1398,35 @@ void ScreenSpaceCaustics::prepareVars()
     mTracer.pVars->setParameterBlock(kParameterBlockName, mTracer.pParameterBlock);
 }
 
+void ScreenSpaceCaustics::renderMemoryUI(Gui::Widgets& widget)
+{
+    auto getSize = [](const Buffer::SharedPtr& pBuffer) { return pBuffer ? pBuffer->getSize() : 0ull; };
+    auto toMB = [](uint64_t byteSize) { return std::to_string(byteSize / (1024 * 1024)) + " MB"; };
+
+    uint64_t cachingPointBytes = 0, statsBytes = 0, indexBytes = 0;
+    for (const auto& perFrameData : mPerFrameCachingData)
+    {
+        cachingPointBytes += getSize(perFrameData.pCachingPointData);
+        statsBytes += getSize(perFrameData.pAccumulatedStats);
+        indexBytes += getSize(perFrameData.pIndexToPixelMap);
+    }
+    const uint64_t pathBytes = getSize(mpPathToCachingPointData);
+    const uint64_t aabbBytes = mpCache ? getSize(mpCache->getAabbBuffer()) : 0ull;
+    const uint64_t progressiveBytes = getSize(mpProgressiveState);
+    const uint64_t wideAccumulationBytes = mUseWideAccumulation ? getSize(mpAccumulatedStatsHigh) : 0ull;
+    const uint64_t totalBytes = cachingPointBytes + pathBytes + statsBytes + indexBytes + aabbBytes + progressiveBytes + wideAccumulationBytes;
+
+    const uint64_t pixelCount = std::max(1u, mPixelCount);
+    widget.text("Caching memory: " + toMB(totalBytes) + " (" + std::to_string(totalBytes / pixelCount) + " B/pixel)\n"
+                "\tcaching points (x2): " + toMB(cachingPointBytes) + "\n"
+                "\tpaths to caching points: " + toMB(pathBytes) + "\n"
+                "\taccumulated stats (x2): " + toMB(statsBytes) + "\n"
+                "\tindex to pixel maps (x2): " + toMB(indexBytes) + "\n"
+                "\tAABBs: " + toMB(aabbBytes) + "\n"
+                "\tprogressive radius state: " + toMB(progressiveBytes) + "\n"
+                "\twide accumulation: " + toMB(wideAccumulationBytes));
+}
+
 void ScreenSpaceCaustics::renderDebugUI(Gui::Widgets& widget)
 {
     bool dirty = false;
@@ -1346,12 +1593,7 @@ void ScreenSpaceCaustics::setTracerData(const RenderData& renderData)
     auto pBlock = mTracer.pParameterBlock;
     assert(pBlock);
 
-    if (mpScene)
-    {
-        auto const materialsChanged = is_set(mpScene->getUpdates(), Scene::UpdateFlags::MaterialsChanged);
-        if (materialsChanged) computeListOfSpecularMaterials();
-        if (materialsChanged || is_set(mpScene->getUpdates(), Scene::UpdateFlags::MeshesMoved)) computeProjectionVolume();
-    }
+    if (mProjectionVolumesDirty) uploadProjectionVolumes();
 
     // Upload parameters struct.
     pBlock["customParams"].setBlob(mSharedCustomParams);
@@ -1367,8 +1609,13 @@ void ScreenSpaceCaustics::setTracerData(const RenderData& renderData)
     pBlock["pixelCoords"] = pCurrentFrameCachingData.pIndexToPixelMap;
     pBlock["cachingPointData"] = pCurrentFrameCachingData.pCachingPointData;
     pBlock["pathToCachingPointData"] = mpPathToCachingPointData;
+    pBlock["cachingPointOrigin"] = pCurrentFrameCachingData.cachingPointOrigin;
 
     pBlock["statsOutput"] = pCurrentFrameCachingData.pAccumulatedStats;
+    pBlock["statsHighOutput"] = mpAccumulatedStatsHigh;
+
+    pBlock["projectionVolumes"]["volumes"] = mpProjectionVolumes;
+    pBlock["projectionVolumes"]["count"] = mpProjectionVolumes ? (uint32_t)mProjectionVolumes.size() : 0u;
 
     // Bind emissive light sampler.
     if (mUseEmissiveSampler)
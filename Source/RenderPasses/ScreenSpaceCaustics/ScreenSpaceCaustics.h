@@ -29,6 +29,7 @@
 #include "Falcor.h"
 #include "FalcorExperimental.h"
 #include "ScreenSpaceCausticsParams.slang"
+#include "RenderPasses/Shared/Caustics/ProjectionVolumeBuilder.h"
 #include "RenderPasses/Shared/PathTracer/PathTracer.h"
 #include "Utils/AccelerationStructures/CachingViaBVH.h"
 #include "Utils/Debug/PathDebug.h"
@@ -51,6 +52,7 @@ public:
     virtual Dictionary getScriptingDictionary() override;
     virtual RenderPassReflection reflect(const CompileData& compileData) override;
     virtual void compile(RenderContext* pRenderContext, const CompileData& compileData) override;
+    virtual void prepareExecute(const RenderData& renderData) override;
     virtual void execute(RenderContext* pRenderContext, const RenderData& renderData) override;
     virtual void renderUI(Gui::Widgets& widget) override;
     virtual void setScene(RenderContext* pRenderContext, const Scene::SharedPtr& pScene) override;
@@ -66,10 +68,13 @@ private:
     void computeListOfSpecularMaterials();
     void computerEmissionMaterialIndex();
     void computeProjectionVolume();
+    void uploadProjectionVolumes();
+    void estimateProjectionVolumeHitRates();
     void prepareVars();
     void recreateVars() { mTracer.pVars = nullptr; }
     void recreateCachingData(RenderContext* pRenderContext);
     void renderDebugUI(Gui::Widgets& widget);
+    void renderMemoryUI(Gui::Widgets& widget);
     void setLTStaticParams(Program* pProgram) const;
     void setTracerData(const RenderData& renderData);
 
@@ -77,7 +82,8 @@ private:
     {
         Buffer::SharedPtr pAccumulatedStats;                        ///< Indexed by pixel coordinates. Format: float4, with .rgb = accumulated radiance, .a (uint) = photon count.
         Buffer::SharedPtr pIndexToPixelMap;                         ///< Indexed by the AABB's geometry global index, gives its corresponding pixel coordinates or 0xFFFFFFFF if invalid. Format is: 16 MSB = pixel.y, 16 LSB = pixel.x.
-        Buffer::SharedPtr pCachingPointData;                        ///< Indexed by pixel coordinates. For the format, see struct CachingPointData.
+        Buffer::SharedPtr pCachingPointData;                        ///< Indexed by pixel coordinates. For the format, see struct CachingPointData (or PackedCachingPointData if compact caching data is used).
+        float3            cachingPointOrigin = float3(0.f);         ///< Origin relative to which the positions in pCachingPointData are stored when compact caching data is used.
     };
 
     // Internal state
@@ -86,9 +92,10 @@ private:
     PathDebug::SharedPtr            mpPathDebug;
     PathDebugSegmentID              mSelectedSegmentID;
     std::array<PerFrameCachingData, 2> mPerFrameCachingData;
-    Buffer::SharedPtr               mpPathToCachingPointData;       ///< Indexed by pixel coordinates. For the format, see struct PathToCachingPointData.
+    Buffer::SharedPtr               mpPathToCachingPointData;       ///< Indexed by pixel coordinates. For the format, see struct PathToCachingPointData (or PackedPathToCachingPointData if compact caching data is used).
     Buffer::SharedPtr               mpEmissiveTriangles;
     Buffer::SharedPtr               mpEmissiveTriangleCount;
+    Buffer::SharedPtr               mpProjectionVolumes;            ///< Projection volumes towards which light paths are guided. For the format, see struct ProjectionVolumeData.
 
     // Configuration
     PathTracerParams                mSharedLightTracingParams;
@@ -99,21 +106,31 @@ private:
     float                           mSearchRadius = 1e-3f;
     float                           mMaxSearchRadius = 5e-3f;
     float                           mReuseAlpha = 0.8f;
+    float                           mProgressiveRadiusAlpha = 2.f / 3.f; ///< Fraction of the new photons kept per frame by the progressive radius schedule.
     uint32_t                        mMaxReuseCollectingPoints = 80;
     uint32_t                        mMaxContributionToCollectingPoints = 80;
+    uint32_t                        mMaxProjectionVolumeCount = 1;  ///< Maximum number of projection volumes the specular casters are clustered into.
     bool                            mUseFixedSearchRadius = false;
     bool                            mCapSearchRadius = true;
     bool                            mDisableTemporalReuse = false;
     bool                            mInterpolatePreviousContributions = true;
+    bool                            mUseReprojectionReuse = true;   ///< Look up previous caching points by reprojection with the motion vectors (if connected) before the spatial query.
     bool                            mCapReuseCollectingPoints = false;
     bool                            mCapContributiongCollectingPoints = false;
     bool                            mLateBSDFApplication = true;
     bool                            mSeparateAABBStorage = true;
     bool                            mAllowSingleDiffuseBounce = false;
     bool                            mRestrictEmissionByMaterials = false;
+    bool                            mUseProgressiveRadius = false;  ///< Shrink the search radius progressively (SPPM) instead of blending with mReuseAlpha.
+    bool                            mUseWideAccumulation = false;   ///< Accumulate photon contributions as 64-bit instead of 32-bit fixed point.
+    bool                            mUseCompactCachingData = false; ///< Store the per-pixel caching data in the packed formats (16B + 32B instead of 32B + 48B per pixel).
 
     // Runtime
     std::vector<bool>               mIsMaterialSpecular;
+    std::vector<AABB>               mCasterBounds;                  ///< World-space bounds of all instances using a specular material.
+    std::vector<AABB>               mProjectionVolumes;
+    bool                            mProjectionVolumesDirty = false; ///< Set when mProjectionVolumes changed on the CPU and must be uploaded to mpProjectionVolumes.
+    std::vector<ProjectionVolumeBuilder::HitRateEstimate> mHitRateEstimates;
     SurfaceAreaMethod               mSelectedSurfaceAreaMethod = SurfaceAreaMethod::PixelCornerProjection;
     uint32_t                        mSelectedFrameCachingData = 0;
     uint32_t                        mPixelCount = 0u;
@@ -123,6 +140,7 @@ private:
     bool                            mResetTemporalReuse = true;
     bool                            mEnableDebug = false;
     bool                            mRecomputeEmissiveTriangleList = false;
+    bool                            mRecreateCachingData = false;
 
     // Shader program.
     ComputePass::SharedPtr mpRestricter;
@@ -171,6 +189,8 @@ private:
     // Debug
     Buffer::SharedPtr               mpPreviousAccumulatedStats;
     Buffer::SharedPtr               mpPreviousAccumulatedPhotonCount;
+    Buffer::SharedPtr               mpAccumulatedStatsHigh;         ///< High words of the radiance accumulated in the current frame stats, when using wide accumulation.
+    Buffer::SharedPtr               mpProgressiveState;             ///< Indexed by pixel coordinates, or nullptr if the progressive radius schedule is not used. For the format, see struct ProgressivePhotonState.
     Buffer::SharedPtr               mpDeviceDebugData;
     Buffer::SharedPtr               mpHostDebugData;
     GpuFence::SharedPtr             mpDebugDataReadFence;
@@ -211,17 +231,23 @@ private:
         serialize(mSearchRadius);
         serialize(mMaxSearchRadius);
         serialize(mReuseAlpha);
+        serialize(mProgressiveRadiusAlpha);
+        serialize(mUseProgressiveRadius);
         serialize(mMaxReuseCollectingPoints);
         serialize(mMaxContributionToCollectingPoints);
+        serialize(mMaxProjectionVolumeCount);
         serialize(mUseFixedSearchRadius);
         serialize(mCapSearchRadius);
         serialize(mDisableTemporalReuse);
         serialize(mInterpolatePreviousContributions);
+        serialize(mUseReprojectionReuse);
         serialize(mCapReuseCollectingPoints);
         serialize(mCapContributiongCollectingPoints);
         serialize(mLateBSDFApplication);
         serialize(mSeparateAABBStorage);
         serialize(mRestrictEmissionByMaterials);
+        serialize(mUseCompactCachingData);
+        serialize(mUseWideAccumulation);
 
         if constexpr (loadFromDict)
         {
@@ -0,0 +1,245 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Tools/ImageProcess/ImageProcessing.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        using namespace ImageProcess;
+
+        Image::SharedPtr createRandomImage(uint32_t width, uint32_t height, std::mt19937& rng)
+        {
+            std::uniform_real_distribution<float> dist(0.f, 4.f);
+            auto pImage = Image::create(width, height);
+            for (size_t i = 0; i < pImage->getPixelCount() * 4; i++) pImage->getData()[i] = dist(rng);
+            return pImage;
+        }
+
+        Image::SharedPtr createConstantImage(uint32_t width, uint32_t height, float value)
+        {
+            auto pImage = Image::create(width, height);
+            std::fill(pImage->getData(), pImage->getData() + pImage->getPixelCount() * 4, value);
+            return pImage;
+        }
+
+        float calcLuminance(float3 color)
+        {
+            return glm::dot(color, float3(0.299f, 0.587f, 0.114f));
+        }
+
+        float3 applyUc2Curve(float3 color)
+        {
+            const float A = 0.22f, B = 0.3f, C = 0.1f, D = 0.2f, E = 0.01f, F = 0.3f;
+            return ((color * (A * color + C * B) + D * E) / (color * (A * color + B) + D * F)) - (E / F);
+        }
+
+        /** Scalar transcription of main() in ToneMapping.ps.slang, without auto exposure.
+        */
+        float3 toneMapReference(float3 color, const ToneMapSettings& settings)
+        {
+            color = settings.getColorTransform() * color;
+
+            switch (settings.op)
+            {
+            case ToneMapperOperator::Linear:
+                break;
+            case ToneMapperOperator::Reinhard:
+            {
+                float luminance = calcLuminance(color);
+                float reinhard = luminance / (luminance + 1);
+                color = color * (reinhard / luminance);
+                break;
+            }
+            case ToneMapperOperator::ReinhardModified:
+            {
+                float luminance = calcLuminance(color);
+                float reinhard = luminance * (1 + luminance / (settings.whiteMaxLuminance * settings.whiteMaxLuminance)) * (1 + luminance);
+                color = color * (reinhard / luminance);
+                break;
+            }
+            case ToneMapperOperator::HejiHableAlu:
+                color = glm::max(float3(0.f), color - 0.004f);
+                color = (color * (6.2f * color + 0.5f)) / (color * (6.2f * color + 1.7f) + 0.06f);
+                color = glm::pow(color, float3(2.2f));
+                break;
+            case ToneMapperOperator::HableUc2:
+                color = applyUc2Curve(2.f * color) * (1.f / applyUc2Curve(float3(settings.whiteScale)).x);
+                break;
+            case ToneMapperOperator::Aces:
+                color *= 0.6f;
+                color = glm::clamp((color * (2.51f * color + 0.03f)) / (color * (2.43f * color + 0.59f) + 0.14f), 0.f, 1.f);
+                break;
+            }
+
+            if (settings.clamp) color = glm::clamp(color, 0.f, 1.f);
+            return color;
+        }
+    }
+
+    CPU_TEST(ImageProcess_Accumulation)
+    {
+        const uint32_t width = 67, height = 33, frameCount = 20;
+        const size_t valueCount = (size_t)width * height * 4;
+
+        for (auto mode : { AccumulationMode::Single, AccumulationMode::SingleCompensated, AccumulationMode::Double })
+        {
+            std::mt19937 rng;
+            Accumulator accumulator(mode, width, height);
+            auto pOutput = Image::create(width, height);
+
+            // Per-value state of the corresponding entry point in Accumulate.cs.slang.
+            std::vector<float> sum(valueCount, 0.f), corr(valueCount, 0.f);
+            std::vector<double> sumDouble(valueCount, 0.0);
+
+            for (uint32_t frame = 0; frame < frameCount; frame++)
+            {
+                auto pFrame = createRandomImage(width, height, rng);
+                accumulator.accumulate(*pFrame, *pOutput);
+                EXPECT_EQ(accumulator.getFrameCount(), frame + 1);
+
+                size_t mismatchCount = 0;
+                for (size_t i = 0; i < valueCount; i++)
+                {
+                    const float color = pFrame->getData()[i];
+                    float expected;
+                    if (mode == AccumulationMode::Single)
+                    {
+                        sum[i] = sum[i] + color;
+                        expected = sum[i] / (frame + 1);
+                    }
+                    else if (mode == AccumulationMode::SingleCompensated)
+                    {
+                        float y = color - corr[i];
+                        float sumNext = sum[i] + y;
+                        corr[i] = (sumNext - sum[i]) - y;
+                        sum[i] = sumNext;
+                        expected = sumNext / (frame + 1);
+                    }
+                    else
+                    {
+                        sumDouble[i] += (double)color;
+                        expected = (float)(sumDouble[i] / (double)(frame + 1));
+                    }
+                    if (pOutput->getData()[i] != expected) mismatchCount++;
+                }
+                EXPECT_EQ(mismatchCount, 0) << "mode=" << (int)mode << " frame=" << frame;
+            }
+        }
+    }
+
+    CPU_TEST(ImageProcess_AccumulationPrecision)
+    {
+        // Many small values: the compensated and double precision averages stay exact, the standard single precision sum drifts.
+        const uint32_t frameCount = 10000;
+        auto pFrame = createConstantImage(1, 1, 0.1f);
+        auto pOutput = Image::create(1, 1);
+
+        float error[3];
+        const AccumulationMode modes[] = { AccumulationMode::Single, AccumulationMode::SingleCompensated, AccumulationMode::Double };
+        for (size_t m = 0; m < 3; m++)
+        {
+            Accumulator accumulator(modes[m], 1, 1);
+            for (uint32_t frame = 0; frame < frameCount; frame++) accumulator.accumulate(*pFrame, *pOutput);
+            error[m] = std::abs(pOutput->getData()[0] - 0.1f);
+        }
+
+        EXPECT_GE(error[0], 5e-6f);
+        EXPECT_LE(error[1], 1e-7f);
+        EXPECT_LE(error[2], 1e-7f);
+    }
+
+    CPU_TEST(ImageProcess_ToneMapOperators)
+    {
+        const ToneMapperOperator operators[] =
+        {
+            ToneMapperOperator::Linear, ToneMapperOperator::Reinhard, ToneMapperOperator::ReinhardModified,
+            ToneMapperOperator::HejiHableAlu, ToneMapperOperator::HableUc2, ToneMapperOperator::Aces,
+        };
+
+        std::mt19937 rng;
+        auto pImage = createRandomImage(64, 32, rng);
+
+        for (auto op : operators)
+        {
+            for (bool clamp : { false, true })
+            {
+                ToneMapSettings settings;
+                settings.op = op;
+                settings.clamp = clamp;
+                settings.exposureCompensation = 0.5f;
+                settings.filmSpeed = 200.f;
+                settings.whiteBalance = true;
+                settings.whitePoint = 5000.f;
+                settings.whiteMaxLuminance = 2.f;
+                settings.validate();
+
+                auto pOutput = toneMapImage(*pImage, settings, true);
+
+                size_t mismatchCount = 0;
+                for (size_t i = 0; i < pImage->getPixelCount(); i++)
+                {
+                    const float* src = pImage->getData() + i * 4;
+                    const float* dst = pOutput->getData() + i * 4;
+                    const float3 expected = toneMapReference(float3(src[0], src[1], src[2]), settings);
+                    for (int c = 0; c < 3; c++)
+                    {
+                        if (std::abs(dst[c] - expected[c]) > 1e-5f * std::max(1.f, std::abs(expected[c]))) mismatchCount++;
+                    }
+                    if (dst[3] != src[3]) mismatchCount++;
+                }
+                EXPECT_EQ(mismatchCount, 0) << "op=" << (int)op << " clamp=" << clamp;
+            }
+        }
+    }
+
+    CPU_TEST(ImageProcess_AutoExposure)
+    {
+        // The average luminance is the exponential of the mean log luminance, stored at half precision.
+        EXPECT_LE(std::abs(computeAverageLuminance(*createConstantImage(100, 60, 0.5f), true) - 0.5f), 1e-6f);
+        EXPECT_LE(std::abs(computeAverageLuminance(*createConstantImage(100, 60, 0.3f), false) - 0.3f), 1e-3f * 0.3f);
+
+        // Left half at 0.25 and right half at 1: the geometric mean is 0.5.
+        auto pImage = createConstantImage(128, 64, 1.f);
+        for (size_t i = 0; i < pImage->getPixelCount(); i++)
+        {
+            if (i % 128 < 64) std::fill(pImage->getData() + i * 4, pImage->getData() + i * 4 + 3, 0.25f);
+        }
+        EXPECT_LE(std::abs(computeAverageLuminance(*pImage, true) - 0.5f), 1e-3f * 0.5f);
+
+        // With auto exposure the average luminance is scaled to the exposure key of 0.042.
+        ToneMapSettings settings;
+        settings.op = ToneMapperOperator::Linear;
+        settings.autoExposure = true;
+        auto pOutput = toneMapImage(*createConstantImage(100, 60, 0.3f), settings, true);
+        for (int c = 0; c < 3; c++) EXPECT_LE(std::abs(pOutput->getData()[c] - 0.042f), 1e-3f * 0.042f);
+        EXPECT_EQ(pOutput->getData()[3], 0.3f);
+    }
+}
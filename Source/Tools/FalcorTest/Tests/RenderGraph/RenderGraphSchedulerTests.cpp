@@ -0,0 +1,209 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderGraph/RenderGraphScheduler.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Mock render graph that logs the order of prepare/record events.
+        */
+        struct MockGraph
+        {
+            std::atomic<uint32_t> clock = 0;
+            std::vector<uint32_t> prepareStart;
+            std::vector<uint32_t> prepareEnd;
+            std::vector<uint32_t> recordStart;
+            std::vector<uint32_t> recordEnd;
+            std::vector<uint32_t> recordOrder;
+            std::atomic<uint32_t> activePrepares = 0;
+            std::atomic<uint32_t> maxActivePrepares = 0;
+            std::chrono::milliseconds prepareDuration{ 0 };
+
+            MockGraph(uint32_t passCount)
+                : prepareStart(passCount), prepareEnd(passCount), recordStart(passCount), recordEnd(passCount)
+            {}
+
+            void prepare(uint32_t i)
+            {
+                prepareStart[i] = ++clock;
+                uint32_t active = ++activePrepares;
+                uint32_t prevMax = maxActivePrepares;
+                while (active > prevMax && !maxActivePrepares.compare_exchange_weak(prevMax, active)) {}
+                if (prepareDuration.count() > 0) std::this_thread::sleep_for(prepareDuration);
+                --activePrepares;
+                prepareEnd[i] = ++clock;
+            }
+
+            void record(uint32_t i)
+            {
+                recordStart[i] = ++clock;
+                recordOrder.push_back(i);
+                recordEnd[i] = ++clock;
+            }
+
+            void run(RenderGraphScheduler& scheduler)
+            {
+                scheduler.execute([this](uint32_t i) { prepare(i); }, [this](uint32_t i) { record(i); });
+            }
+        };
+
+        /** Check that the logged events respect the scheduling rules. Returns the number of violations.
+        */
+        uint32_t validateOrder(const RenderGraphScheduler& scheduler, const MockGraph& graph)
+        {
+            uint32_t errors = 0;
+            for (uint32_t i = 0; i < scheduler.getPassCount(); i++)
+            {
+                if (graph.recordOrder.size() <= i || graph.recordOrder[i] != i) errors++;
+                if (graph.prepareEnd[i] > graph.recordStart[i]) errors++;
+                for (uint32_t d : scheduler.getDependencies(i))
+                {
+                    if (graph.prepareStart[i] < graph.recordEnd[d]) errors++;
+                }
+            }
+            return errors;
+        }
+
+        /** Diamond 0 -> {1, 2} -> 3 and an independent pass 4.
+        */
+        void addDiamond(RenderGraphScheduler& scheduler)
+        {
+            scheduler.addDependency(1, 0);
+            scheduler.addDependency(2, 0);
+            scheduler.addDependency(3, 1);
+            scheduler.addDependency(3, 2);
+        }
+    }
+
+    CPU_TEST(RenderGraphSchedulerLevels)
+    {
+        RenderGraphScheduler scheduler(5);
+        addDiamond(scheduler);
+        scheduler.addDependency(3, 1); // Duplicates are ignored
+
+        EXPECT_EQ(scheduler.getDependencies(3).size(), 2);
+        EXPECT_EQ(scheduler.getDependents(0).size(), 2);
+        EXPECT_EQ(scheduler.getLevel(0), 0);
+        EXPECT_EQ(scheduler.getLevel(1), 1);
+        EXPECT_EQ(scheduler.getLevel(2), 1);
+        EXPECT_EQ(scheduler.getLevel(3), 2);
+        EXPECT_EQ(scheduler.getLevel(4), 0);
+        EXPECT_EQ(scheduler.getLevelCount(), 3);
+
+        // Dependencies must point backwards in the execution order.
+        bool thrown = false;
+        try { scheduler.addDependency(1, 3); }
+        catch (const std::exception&) { thrown = true; }
+        EXPECT(thrown);
+    }
+
+    CPU_TEST(RenderGraphSchedulerOrder)
+    {
+        for (uint32_t workerCount : { 0u, 1u, 4u })
+        {
+            RenderGraphScheduler scheduler(5);
+            addDiamond(scheduler);
+            scheduler.setWorkerCount(workerCount);
+
+            // Run several frames to exercise reuse of the workers.
+            for (uint32_t frame = 0; frame < 20; frame++)
+            {
+                MockGraph graph(5);
+                graph.run(scheduler);
+                EXPECT_EQ(validateOrder(scheduler, graph), 0) << "workerCount = " << workerCount << ", frame = " << frame;
+                EXPECT_EQ(scheduler.getTimings().size(), 5);
+            }
+
+            if (workerCount == 0)
+            {
+                for (const auto& t : scheduler.getTimings()) EXPECT(!t.preparedOnWorker);
+            }
+        }
+    }
+
+    CPU_TEST(RenderGraphSchedulerConcurrency)
+    {
+        // Independent passes with slow preparation are prepared concurrently by the workers.
+        const uint32_t passCount = 8;
+        RenderGraphScheduler scheduler(passCount);
+        scheduler.setWorkerCount(4);
+
+        MockGraph graph(passCount);
+        graph.prepareDuration = std::chrono::milliseconds(20);
+        graph.run(scheduler);
+
+        EXPECT_EQ(validateOrder(scheduler, graph), 0);
+        EXPECT_GT(graph.maxActivePrepares.load(), 1u);
+
+        uint32_t preparedOnWorker = 0;
+        for (const auto& t : scheduler.getTimings())
+        {
+            if (t.preparedOnWorker) preparedOnWorker++;
+            EXPECT_GE(t.prepareTime, 0.0);
+        }
+        EXPECT_GT(preparedOnWorker, 0u);
+
+        // A chain has no parallelism, each pass is prepared after the previous one has been recorded.
+        RenderGraphScheduler chain(passCount);
+        for (uint32_t i = 1; i < passCount; i++) chain.addDependency(i, i - 1);
+        chain.setWorkerCount(4);
+        MockGraph chainGraph(passCount);
+        chainGraph.prepareDuration = std::chrono::milliseconds(1);
+        chainGraph.run(chain);
+        EXPECT_EQ(validateOrder(chain, chainGraph), 0);
+        EXPECT_EQ(chainGraph.maxActivePrepares.load(), 1u);
+    }
+
+    CPU_TEST(RenderGraphSchedulerException)
+    {
+        RenderGraphScheduler scheduler(5);
+        addDiamond(scheduler);
+        scheduler.setWorkerCount(2);
+
+        // An exception thrown while preparing pass 2 reaches the caller and stops recording before pass 2.
+        std::vector<uint32_t> recorded;
+        bool thrown = false;
+        try
+        {
+            scheduler.execute([](uint32_t i) { if (i == 2) throw std::exception("prepare failed"); }, [&](uint32_t i) { recorded.push_back(i); });
+        }
+        catch (const std::exception&)
+        {
+            thrown = true;
+        }
+        EXPECT(thrown);
+        EXPECT_EQ(recorded.size(), 2);
+
+        // The scheduler can be executed again afterwards.
+        MockGraph graph(5);
+        graph.run(scheduler);
+        EXPECT_EQ(validateOrder(scheduler, graph), 0);
+    }
+}
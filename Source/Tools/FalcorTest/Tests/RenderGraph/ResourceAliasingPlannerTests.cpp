@@ -0,0 +1,232 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderGraph/ResourceAliasingPlanner.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        using Request = ResourceAliasingPlanner::Request;
+        using Plan = ResourceAliasingPlanner::Plan;
+
+        const std::string kKeyA = "Texture2D:1920x1080:RGBA16Float";
+        const std::string kKeyB = "Texture2D:1920x1080:R32Float";
+        const uint64_t kSizeA = 1920ull * 1080 * 8;
+        const uint64_t kSizeB = 1920ull * 1080 * 4;
+
+        Request makeRequest(const std::string& key, uint64_t byteSize, uint32_t first, uint32_t last, ResourceBindFlags bindFlags = ResourceBindFlags::ShaderResource | ResourceBindFlags::RenderTarget)
+        {
+            Request r;
+            r.compatibilityKey = key;
+            r.bindFlags = bindFlags;
+            r.lifetime = { first, last };
+            r.byteSize = byteSize;
+            return r;
+        }
+
+        bool overlaps(const Request& a, const Request& b)
+        {
+            return a.lifetime.first <= b.lifetime.second && b.lifetime.first <= a.lifetime.second;
+        }
+
+        /** Check the invariants that every plan must satisfy. Returns the number of violations.
+        */
+        uint32_t validatePlan(const std::vector<Request>& requests, const Plan& plan)
+        {
+            uint32_t errors = 0;
+            if (plan.requestToSlot.size() != requests.size()) return 1;
+
+            uint64_t naiveBytes = 0, plannedBytes = 0;
+            for (const auto& r : requests) naiveBytes += r.byteSize;
+
+            std::vector<uint32_t> seen(requests.size(), 0);
+            for (uint32_t s = 0; s < plan.slots.size(); s++)
+            {
+                const auto& slot = plan.slots[s];
+                plannedBytes += slot.byteSize;
+                if (slot.requests.empty()) errors++;
+                if (!slot.canAlias && slot.requests.size() != 1) errors++;
+
+                for (size_t i = 0; i < slot.requests.size(); i++)
+                {
+                    uint32_t ri = slot.requests[i];
+                    const auto& r = requests[ri];
+                    seen[ri]++;
+                    if (plan.requestToSlot[ri] != s) errors++;
+                    if (r.compatibilityKey != slot.compatibilityKey) errors++;
+                    if (r.byteSize > slot.byteSize) errors++;
+                    if ((slot.bindFlags & r.bindFlags) != r.bindFlags) errors++;
+                    if (slot.requests.size() > 1 && !r.canAlias) errors++;
+                    for (size_t j = i + 1; j < slot.requests.size(); j++)
+                    {
+                        if (overlaps(r, requests[slot.requests[j]])) errors++;
+                    }
+                }
+            }
+
+            for (uint32_t count : seen) if (count != 1) errors++;
+            if (plan.naiveBytes != naiveBytes) errors++;
+            if (plan.plannedBytes != plannedBytes) errors++;
+            if (plan.plannedBytes > plan.naiveBytes) errors++;
+            if (plan.peakBytes > plan.plannedBytes) errors++;
+            return errors;
+        }
+
+        /** Largest number of requests alive at the same execution index.
+        */
+        uint32_t maxOverlap(const std::vector<Request>& requests)
+        {
+            uint32_t result = 0;
+            for (const auto& r : requests)
+            {
+                uint32_t count = 0;
+                for (const auto& other : requests)
+                {
+                    if (other.lifetime.first <= r.lifetime.first && r.lifetime.first <= other.lifetime.second) count++;
+                }
+                result = std::max(result, count);
+            }
+            return result;
+        }
+    }
+
+    CPU_TEST(ResourceAliasingChain)
+    {
+        // Linear chain of passes where each pass reads the output of the previous one.
+        // Outputs of pass i live in [i, i + 1], so two resources are enough.
+        std::vector<Request> requests;
+        for (uint32_t i = 0; i < 6; i++) requests.push_back(makeRequest(kKeyA, kSizeA, i, i + 1));
+
+        Plan plan = ResourceAliasingPlanner::plan(requests);
+        EXPECT_EQ(validatePlan(requests, plan), 0);
+        EXPECT_EQ(plan.slots.size(), 2);
+        EXPECT_EQ(plan.naiveBytes, 6 * kSizeA);
+        EXPECT_EQ(plan.plannedBytes, 2 * kSizeA);
+        EXPECT_EQ(plan.peakBytes, 2 * kSizeA);
+
+        // Resources alternate between the two slots.
+        for (uint32_t i = 0; i < 6; i++) EXPECT_EQ(plan.requestToSlot[i], i % 2);
+    }
+
+    CPU_TEST(ResourceAliasingIncompatible)
+    {
+        // Resources with different keys never share memory, even if their lifetimes are disjoint.
+        std::vector<Request> requests =
+        {
+            makeRequest(kKeyA, kSizeA, 0, 1),
+            makeRequest(kKeyB, kSizeB, 2, 3),
+            makeRequest(kKeyA, kSizeA, 4, 5),
+        };
+
+        Plan plan = ResourceAliasingPlanner::plan(requests);
+        EXPECT_EQ(validatePlan(requests, plan), 0);
+        EXPECT_EQ(plan.slots.size(), 2);
+        EXPECT_EQ(plan.requestToSlot[0], plan.requestToSlot[2]);
+        EXPECT_NE(plan.requestToSlot[0], plan.requestToSlot[1]);
+        EXPECT_EQ(plan.plannedBytes, kSizeA + kSizeB);
+        EXPECT_EQ(plan.peakBytes, kSizeA);
+
+        // Requests that can't alias (graph outputs, internal resources) always get a slot of their own.
+        requests[2].canAlias = false;
+        plan = ResourceAliasingPlanner::plan(requests);
+        EXPECT_EQ(validatePlan(requests, plan), 0);
+        EXPECT_EQ(plan.slots.size(), 3);
+        EXPECT_EQ(plan.plannedBytes, plan.naiveBytes);
+    }
+
+    CPU_TEST(ResourceAliasingBindFlags)
+    {
+        const ResourceBindFlags kRT = ResourceBindFlags::ShaderResource | ResourceBindFlags::RenderTarget;
+        const ResourceBindFlags kUAV = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess;
+        const ResourceBindFlags kDepth = ResourceBindFlags::ShaderResource | ResourceBindFlags::DepthStencil;
+
+        EXPECT(ResourceAliasingPlanner::areBindFlagsCompatible(kRT, kUAV));
+        EXPECT(ResourceAliasingPlanner::areBindFlagsCompatible(kDepth, ResourceBindFlags::ShaderResource));
+        EXPECT(!ResourceAliasingPlanner::areBindFlagsCompatible(kDepth, kRT));
+        EXPECT(!ResourceAliasingPlanner::areBindFlagsCompatible(kDepth, kUAV));
+
+        // Render target and UAV usage can be merged into one resource with the union of the flags.
+        std::vector<Request> requests =
+        {
+            makeRequest(kKeyA, kSizeA, 0, 1, kRT),
+            makeRequest(kKeyA, kSizeA, 2, 3, kUAV),
+            makeRequest(kKeyA, kSizeA, 4, 5, kDepth),
+        };
+
+        Plan plan = ResourceAliasingPlanner::plan(requests);
+        EXPECT_EQ(validatePlan(requests, plan), 0);
+        EXPECT_EQ(plan.slots.size(), 2);
+        EXPECT_EQ(plan.requestToSlot[0], plan.requestToSlot[1]);
+        EXPECT_NE(plan.requestToSlot[0], plan.requestToSlot[2]);
+        EXPECT(plan.slots[plan.requestToSlot[0]].bindFlags == (kRT | kUAV));
+        EXPECT(plan.slots[plan.requestToSlot[2]].bindFlags == kDepth);
+    }
+
+    CPU_TEST(ResourceAliasingRandomGraphs)
+    {
+        std::mt19937 rng(7);
+
+        for (uint32_t graph = 0; graph < 200; graph++)
+        {
+            // Synthetic graph: each pass produces a few outputs that are read by a later pass.
+            // Some outputs are graph outputs which live until the end of the frame.
+            const uint32_t passCount = 2 + rng() % 30;
+            const bool singleKey = graph % 2 == 0;
+            std::vector<Request> requests;
+
+            for (uint32_t pass = 0; pass < passCount; pass++)
+            {
+                uint32_t outputCount = 1 + rng() % 3;
+                for (uint32_t o = 0; o < outputCount; o++)
+                {
+                    bool useKeyA = singleKey || rng() % 2 == 0;
+                    uint32_t lastUse = pass + rng() % std::max(1u, passCount - pass);
+                    Request r = makeRequest(useKeyA ? kKeyA : kKeyB, useKeyA ? kSizeA : kSizeB, pass, lastUse);
+                    if (!singleKey && rng() % 8 == 0)
+                    {
+                        r.lifetime.second = uint32_t(-1);
+                        r.canAlias = false;
+                    }
+                    requests.push_back(r);
+                }
+            }
+
+            Plan plan = ResourceAliasingPlanner::plan(requests);
+            EXPECT_EQ(validatePlan(requests, plan), 0);
+
+            // With a single compatibility class, greedy colouring of intervals sorted by start is optimal.
+            if (singleKey)
+            {
+                EXPECT_EQ(plan.slots.size(), maxOverlap(requests));
+                EXPECT_EQ(plan.plannedBytes, plan.peakBytes);
+            }
+        }
+    }
+}
@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "Testing/UnitTest.h"
 #include "Utils/Sampling/AliasTable.h"
+#include "Experimental/Scene/Lights/EmissivePowerSampler.h"
 
 #include "hypothesis/hypothesis.h"
 
@@ -131,6 +132,42 @@ namespace Falcor
                 ctx.unmapBuffer("weightResult");
             }
         }
+
+        /** Check that the probabilities of the table items sum up to the normalized weights.
+        */
+        void verifyItems(CPUUnitTestContext& ctx, const std::vector<float>& weights, const std::vector<AliasTable::Item>& items)
+        {
+            const uint32_t N = (uint32_t)weights.size();
+            double weightSum = 0.0;
+            for (float w : weights) weightSum += w;
+
+            std::vector<double> mass(N, 0.0);
+            for (const auto& item : items)
+            {
+                EXPECT(item.indexA < N && item.indexB < N);
+                EXPECT(item.threshold >= 0.f && item.threshold <= 1.f);
+                mass[item.indexB] += item.threshold;
+                mass[item.indexA] += 1.0 - item.threshold;
+            }
+
+            for (uint32_t i = 0; i < N; ++i)
+            {
+                EXPECT_LE(std::abs(mass[i] - weights[i] / weightSum * N), 1e-4) << "i = " << i;
+            }
+        }
+
+        std::vector<float> createWeights(uint32_t N, std::mt19937& rng)
+        {
+            // Mix of tiny, typical and a few very large weights, plus some zeros.
+            std::uniform_real_distribution<float> uniform;
+            std::vector<float> weights(N);
+            for (uint32_t i = 0; i < N; ++i)
+            {
+                float u = uniform(rng);
+                weights[i] = u < 0.01f ? 0.f : u < 0.02f ? 1000.f * uniform(rng) : std::pow(uniform(rng), 4.f);
+            }
+            return weights;
+        }
     }
 
     GPU_TEST(AliasTable)
@@ -140,4 +177,162 @@ namespace Falcor
         testAliasTable(ctx, 100);
         testAliasTable(ctx, 1000);
     }
+
+    CPU_TEST(AliasTable_Build)
+    {
+        std::mt19937 rng;
+        for (uint32_t N : { 1u, 2u, 3u, 100u, 1000u, 200000u })
+        {
+            std::vector<float> weights = createWeights(N, rng);
+            double weightSum = 0.0;
+            auto items = AliasTable::build(weights, 1234, &weightSum);
+            EXPECT_EQ(items.size(), (size_t)N);
+            verifyItems(ctx, weights, items);
+
+            // Every item owns exactly one slot.
+            std::vector<uint32_t> owners(N, 0);
+            for (const auto& item : items) owners[item.indexB]++;
+            EXPECT(std::all_of(owners.begin(), owners.end(), [](uint32_t c) { return c == 1; }));
+        }
+
+        // All weights zero or equal results in uniform sampling.
+        for (float w : { 0.f, 3.f })
+        {
+            std::vector<float> weights(1000, w);
+            verifyItems(ctx, std::vector<float>(1000, 1.f), AliasTable::build(weights, 0));
+        }
+    }
+
+    CPU_TEST(AliasTable_Seed)
+    {
+        std::mt19937 rng;
+        std::vector<float> weights = createWeights(100000, rng);
+
+        auto equal = [](const std::vector<AliasTable::Item>& a, const std::vector<AliasTable::Item>& b)
+        {
+            return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const AliasTable::Item& x, const AliasTable::Item& y)
+            {
+                return x.threshold == y.threshold && x.indexA == y.indexA && x.indexB == y.indexB;
+            });
+        };
+
+        // The same seed reproduces the table, a different seed shuffles the slots differently.
+        auto items = AliasTable::build(weights, 42);
+        EXPECT(equal(items, AliasTable::build(weights, 42)));
+        EXPECT(!equal(items, AliasTable::build(weights, 43)));
+    }
+
+    CPU_TEST(AliasTable_Sample)
+    {
+        // Sample the table on the host and verify the histogram using a chi-square test.
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> uniform;
+        const uint32_t N = 1000;
+        const uint32_t samplesPerWeight = 1000;
+
+        std::vector<float> weights(N);
+        for (auto& w : weights) w = uniform(rng);
+        for (uint32_t i = 0; i < N / 100; ++i) weights[rng() % N] = 0.f;
+
+        double weightSum = 0.0;
+        auto items = AliasTable::build(weights, rng(), &weightSum);
+
+        std::vector<double> obsFrequencies(N, 0.0);
+        for (uint32_t s = 0; s < N * samplesPerWeight; ++s)
+        {
+            const auto& item = items[std::min(N - 1, (uint32_t)(uniform(rng) * N))];
+            obsFrequencies[uniform(rng) >= item.threshold ? item.indexA : item.indexB] += 1.0;
+        }
+
+        std::vector<double> expFrequencies(N);
+        for (uint32_t i = 0; i < N; ++i) expFrequencies[i] = (weights[i] / weightSum) * N * samplesPerWeight;
+
+        const auto& [success, report] = hypothesis::chi2_test(N, obsFrequencies.data(), expFrequencies.data(), N * samplesPerWeight, 5, 0.1);
+        if (!success) std::cout << report << std::endl;
+        EXPECT(success);
+    }
+
+    CPU_TEST(AliasTable_BuildLarge)
+    {
+        // Build a table large enough to exercise the parallel build, verify it and log the build time.
+        std::mt19937 rng;
+        const uint32_t N = 1000000;
+        std::vector<float> weights = createWeights(N, rng);
+
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        auto items = AliasTable::build(weights, 0);
+        double ms = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        logInfo("AliasTable build (" + std::to_string(N) + " entries): " + std::to_string(ms) + " ms");
+
+        EXPECT_EQ(items.size(), (size_t)N);
+        verifyItems(ctx, weights, items);
+
+        // The parallel build is deterministic.
+        auto items2 = AliasTable::build(weights, 0);
+        EXPECT(std::equal(items.begin(), items.end(), items2.begin(), items2.end(), [](const AliasTable::Item& x, const AliasTable::Item& y)
+        {
+            return x.threshold == y.threshold && x.indexA == y.indexA && x.indexB == y.indexB;
+        }));
+    }
+
+    GPU_TEST(EmissivePowerSampler_AliasTableFormats)
+    {
+        // The packed and wide table formats decode to the same items, up to the half precision of the packed thresholds.
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> uniform;
+        const uint32_t samplesPerWeight = 100;
+
+        for (uint32_t N : { 1000u, 100000u })
+        {
+            std::vector<float> weights = createWeights(N, rng);
+            const uint32_t resultCount = N * samplesPerWeight;
+            std::vector<float> random(2 * resultCount);
+            std::generate(random.begin(), random.end(), [&uniform, &rng]() { return uniform(rng); });
+
+            auto sampleTable = [&](const EmissivePowerSampler::AliasTable& table)
+            {
+                Program::DefineList defines;
+                defines.add("_EMISSIVE_POWER_WIDE_ALIAS_TABLE", table.wideIndices ? "1" : "0");
+                ctx.createProgram("Tests/Sampling/EmissivePowerAliasTableTests.cs.slang", "testSampleAliasTable", defines);
+                ctx.allocateStructuredBuffer("sampleResult", resultCount);
+                ctx.allocateStructuredBuffer("random", 2 * resultCount, random.data());
+                ctx["CB"]["emissivePower"]["triangleAliasTable"] = table.fullTable;
+                ctx["CB"]["tableSize"] = N;
+                ctx["CB"]["resultCount"] = resultCount;
+                ctx.runProgram(resultCount);
+
+                const uint32_t* result = ctx.mapBuffer<const uint32_t>("sampleResult");
+                std::vector<uint32_t> samples(result, result + resultCount);
+                ctx.unmapBuffer("sampleResult");
+                return samples;
+            };
+
+            const auto packedTable = EmissivePowerSampler::createAliasTable(weights, 1234, false);
+            const auto wideTable = EmissivePowerSampler::createAliasTable(weights, 1234, true);
+            EXPECT(!packedTable.wideIndices && wideTable.wideIndices);
+            EXPECT_EQ(packedTable.weightSum, wideTable.weightSum);
+
+            const std::vector<uint32_t> packedSamples = sampleTable(packedTable);
+            const std::vector<uint32_t> wideSamples = sampleTable(wideTable);
+
+            // Only the samples falling between the half and single precision thresholds may differ.
+            uint32_t mismatchCount = 0;
+            std::vector<double> obsFrequencies(N, 0.0);
+            for (uint32_t i = 0; i < resultCount; ++i)
+            {
+                EXPECT(wideSamples[i] < N);
+                if (packedSamples[i] != wideSamples[i]) ++mismatchCount;
+                obsFrequencies[std::min(wideSamples[i], N - 1)] += 1.0;
+            }
+            EXPECT_LE(mismatchCount, resultCount / 1000) << "N = " << N;
+
+            // The wide table samples proportionally to the weights.
+            std::vector<double> expFrequencies(N);
+            for (uint32_t i = 0; i < N; ++i) expFrequencies[i] = (weights[i] / wideTable.weightSum) * resultCount;
+
+            const auto& [success, report] = hypothesis::chi2_test(N, obsFrequencies.data(), expFrequencies.data(), resultCount, 5, 0.1);
+            if (!success) std::cout << report << std::endl;
+            EXPECT(success);
+        }
+    }
 }
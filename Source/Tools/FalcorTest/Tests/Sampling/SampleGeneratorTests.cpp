@@ -27,8 +27,11 @@
  **************************************************************************/
 #include "Testing/UnitTest.h"
 #include "Utils/Sampling/SampleGenerator.h"
+#include "Utils/Sampling/SobolSampleGenerator.h"
+#include "Utils/Sampling/BlueNoiseSampleGenerator.h"
+#include <complex>
 
-/** GPU tests for the SampleGenerator utility class.
+/** Tests for the SampleGenerator utility class and the host implementations of the low-discrepancy sample generators.
 */
 
 namespace Falcor
@@ -71,7 +74,10 @@ namespace Falcor
             return r_xy;
         }
 
-        void testSampleGenerator(GPUUnitTestContext& ctx, uint32_t type, const double corrThreshold, bool testInstances)
+        /** Runs the test shader, which generates kDimensions samples for each thread of a kDispatchDim dispatch.
+            \return Number of generated samples. The samples are in the "result" buffer.
+        */
+        size_t runSampleGenerator(GPUUnitTestContext& ctx, uint32_t type)
         {
             // Create sample generator.
             SampleGenerator::SharedPtr pSampleGenerator = SampleGenerator::create(type);
@@ -90,6 +96,12 @@ namespace Falcor
 
             // Run the test.
             ctx.runProgram(kDispatchDim);
+            return numSamples;
+        }
+
+        void testSampleGenerator(GPUUnitTestContext& ctx, uint32_t type, const double corrThreshold, bool testInstances, bool testPixels = true)
+        {
+            const size_t numSamples = runSampleGenerator(ctx, type);
 
             // Readback results.
             const float* result = ctx.mapBuffer<const float>("result");
@@ -120,15 +132,18 @@ namespace Falcor
                 EXPECT_LE(corr(i), corrThreshold) << "i = " << i;
             }
 
-            // Test nearby pixels.
-            const size_t xStride = kDimensions;
-            const size_t yStride = kDispatchDim.x * kDimensions;
-            for (size_t y = 0; y < 4; y++)
+            // Test nearby pixels, if they are expected to be uncorrelated.
+            if (testPixels)
             {
-                for (size_t x = 0; x < 4; x++)
+                const size_t xStride = kDimensions;
+                const size_t yStride = kDispatchDim.x * kDimensions;
+                for (size_t y = 0; y < 4; y++)
                 {
-                    if (x == 0 && y == 0) continue;
-                    EXPECT_LE(corr(x * xStride + y * yStride), corrThreshold) << "x = " << x << " y = " << y;
+                    for (size_t x = 0; x < 4; x++)
+                    {
+                        if (x == 0 && y == 0) continue;
+                        EXPECT_LE(corr(x * xStride + y * yStride), corrThreshold) << "x = " << x << " y = " << y;
+                    }
                 }
             }
 
@@ -144,6 +159,136 @@ namespace Falcor
 
             ctx.unmapBuffer("result");
         }
+
+        /** Checks that the GPU generates the same samples as the host implementation.
+        */
+        template<typename State>
+        void testHostSampleGenerator(GPUUnitTestContext& ctx, uint32_t type)
+        {
+            runSampleGenerator(ctx, type);
+            const float* result = ctx.mapBuffer<const float>("result");
+
+            size_t mismatches = 0;
+            for (uint32_t z = 0; z < kDispatchDim.z; z++)
+            {
+                for (uint32_t y = 0; y < kDispatchDim.y; y++)
+                {
+                    for (uint32_t x = 0; x < kDispatchDim.x; x++)
+                    {
+                        // The shader draws 1D, 2D and 3D samples, which all consume successive dimensions.
+                        State sg(uint2(x, y), z);
+                        const size_t offset = ((size_t(z) * kDispatchDim.y + y) * kDispatchDim.x + x) * kDimensions;
+                        for (uint32_t i = 0; i < kDimensions; i++)
+                        {
+                            if (sampleNext1D(sg) != result[offset + i]) mismatches++;
+                        }
+                    }
+                }
+            }
+            EXPECT_EQ(mismatches, 0);
+
+            ctx.unmapBuffer("result");
+        }
+
+        /** Returns the 32-bit fixed-point samples of 'count' consecutive sample numbers in one dimension.
+        */
+        template<typename State>
+        std::vector<uint32_t> generateDimension(uint2 pixel, uint32_t dimension, uint32_t count)
+        {
+            std::vector<uint32_t> values(count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                State sg(pixel, i);
+                for (uint32_t d = 0; d < dimension; d++) sg.next();
+                values[i] = sg.next();
+            }
+            return values;
+        }
+
+        /** Checks that each interval [k/n, (k+1)/n) contains exactly one value, where n is the number of values (a power of two).
+        */
+        bool isStratified(const std::vector<uint32_t>& values)
+        {
+            assert(isPowerOf2((uint32_t)values.size()));
+            const uint32_t bits = (uint32_t)std::log2(values.size());
+            std::vector<uint32_t> counts(values.size(), 0);
+            for (uint32_t v : values) counts[bits > 0 ? v >> (32 - bits) : 0]++;
+            return std::all_of(counts.begin(), counts.end(), [](uint32_t c) { return c == 1; });
+        }
+
+        /** Average power of the low frequencies of a kBlueNoiseMaskSize^2 image, relative to the variance of the image.
+            This is one for uncorrelated values (white noise) and much smaller for blue noise.
+        */
+        double lowFrequencyPower(const std::vector<double>& image)
+        {
+            const int size = (int)kBlueNoiseMaskSize;
+            const int maxFrequency = 4;
+            double mean = 0.0, variance = 0.0;
+            for (double v : image) mean += v;
+            mean /= image.size();
+            for (double v : image) variance += (v - mean) * (v - mean);
+            variance /= image.size();
+
+            double power = 0.0;
+            uint32_t count = 0;
+            for (int ky = -maxFrequency; ky <= maxFrequency; ky++)
+            {
+                for (int kx = -maxFrequency; kx <= maxFrequency; kx++)
+                {
+                    if (kx == 0 && ky == 0) continue;
+                    std::complex<double> sum = 0.0;
+                    for (int y = 0; y < size; y++)
+                    {
+                        for (int x = 0; x < size; x++) sum += (image[y * size + x] - mean) * std::polar(1.0, -2.0 * M_PI * (kx * x + ky * y) / size);
+                    }
+                    power += std::norm(sum) / image.size();
+                    count++;
+                }
+            }
+            return power / (count * variance);
+        }
+
+        /** Estimates the integral of f over [0,1)^D with N samples per pixel for a number of pixels.
+            \return Root mean squared error over the pixels.
+        */
+        template<typename Generator, typename Func>
+        double estimateRMSE(Generator generator, Func f, uint32_t dimensions, uint32_t N, double reference)
+        {
+            const uint32_t pixelsPerSide = 16;
+            double sumSquaredError = 0.0;
+            for (uint32_t py = 0; py < pixelsPerSide; py++)
+            {
+                for (uint32_t px = 0; px < pixelsPerSide; px++)
+                {
+                    double sum = 0.0;
+                    for (uint32_t i = 0; i < N; i++)
+                    {
+                        auto sg = generator(uint2(px, py), i);
+                        float u[4];
+                        for (uint32_t d = 0; d < dimensions; d++) u[d] = sampleNext1D(sg);
+                        sum += f(u);
+                    }
+                    double error = sum / N - reference;
+                    sumSquaredError += error * error;
+                }
+            }
+            return std::sqrt(sumSquaredError / (pixelsPerSide * pixelsPerSide));
+        }
+
+        /** Pseudorandom xorshift32 generator with the same interface as the host sample generators, for reference.
+        */
+        struct UniformState
+        {
+            UniformState(uint2 pixel, uint32_t sampleNumber) : state(sobolHashCombine(getSobolPixelSeed(pixel), sampleNumber) | 1) {}
+            uint32_t next()
+            {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                return state;
+            }
+            uint32_t state;
+        };
     }
 
     /** Tests for the different types of sample generators.
@@ -161,4 +306,172 @@ namespace Falcor
     {
         testSampleGenerator(ctx, SAMPLE_GENERATOR_UNIFORM, 0.002, true);
     }
+
+    GPU_TEST(SampleGenerator_Sobol)
+    {
+        // Consecutive sample numbers are deliberately correlated (stratified), so instances are not tested.
+        testSampleGenerator(ctx, SAMPLE_GENERATOR_SOBOL, 0.0025, false);
+        testHostSampleGenerator<SobolSampleGenerator::State>(ctx, SAMPLE_GENERATOR_SOBOL);
+    }
+
+    GPU_TEST(SampleGenerator_BlueNoise)
+    {
+        // Nearby pixels are deliberately negatively correlated and all pixels share the sequence, so pixels and instances are not tested.
+        testSampleGenerator(ctx, SAMPLE_GENERATOR_BLUE_NOISE, 0.002, false, false);
+        testHostSampleGenerator<BlueNoiseSampleGenerator::State>(ctx, SAMPLE_GENERATOR_BLUE_NOISE);
+    }
+
+    CPU_TEST(SampleGenerator_SobolStratification)
+    {
+        // The first 2^m sample numbers of a pixel are stratified in every dimension, including the padded ones.
+        for (uint2 pixel : { uint2(0, 0), uint2(1, 0), uint2(17, 123) })
+        {
+            for (uint32_t dimension = 0; dimension < 3 * kSobolDimensions; dimension++)
+            {
+                auto values = generateDimension<SobolSampleGenerator::State>(pixel, dimension, 1024);
+                for (uint32_t m = 0; m <= 10; m++)
+                {
+                    std::vector<uint32_t> prefix(values.begin(), values.begin() + (size_t(1) << m));
+                    EXPECT(isStratified(prefix)) << "pixel = (" << pixel.x << ", " << pixel.y << ") dimension = " << dimension << " m = " << m;
+                }
+            }
+        }
+
+        // The first two dimensions of each group form a (0,m,2)-net: every elementary interval of area 2^-m contains one point.
+        const uint32_t m = 8;
+        for (uint32_t group = 0; group < 3; group++)
+        {
+            auto x = generateDimension<SobolSampleGenerator::State>(uint2(5, 7), group * kSobolDimensions, 1 << m);
+            auto y = generateDimension<SobolSampleGenerator::State>(uint2(5, 7), group * kSobolDimensions + 1, 1 << m);
+            for (uint32_t xBits = 0; xBits <= m; xBits++)
+            {
+                const uint32_t yBits = m - xBits;
+                std::vector<uint32_t> counts(size_t(1) << m, 0);
+                for (size_t i = 0; i < x.size(); i++)
+                {
+                    uint32_t cx = xBits > 0 ? x[i] >> (32 - xBits) : 0;
+                    uint32_t cy = yBits > 0 ? y[i] >> (32 - yBits) : 0;
+                    counts[(cy << xBits) | cx]++;
+                }
+                EXPECT(std::all_of(counts.begin(), counts.end(), [](uint32_t c) { return c == 1; })) << "group = " << group << " xBits = " << xBits;
+            }
+        }
+
+        // Pixels use different scrambles.
+        EXPECT(generateDimension<SobolSampleGenerator::State>(uint2(0, 0), 0, 16) != generateDimension<SobolSampleGenerator::State>(uint2(1, 0), 0, 16));
+        EXPECT(generateDimension<SobolSampleGenerator::State>(uint2(0, 0), 0, 16) != generateDimension<SobolSampleGenerator::State>(uint2(0, 1), 0, 16));
+    }
+
+    CPU_TEST(SampleGenerator_BlueNoiseMask)
+    {
+        const auto& mask = BlueNoiseSampleGenerator::getMask();
+        const uint32_t count = kBlueNoiseMaskSize * kBlueNoiseMaskSize;
+        EXPECT_EQ(mask.size(), (size_t)count);
+        if (mask.size() != count) return;
+
+        // The mask holds the centers of 'count' equally sized intervals in some order.
+        const uint32_t shift = 32 - 2 * kBlueNoiseMaskSizeLog2;
+        std::vector<uint32_t> counts(count, 0);
+        for (uint32_t v : mask)
+        {
+            EXPECT_EQ(v & ((1u << shift) - 1), 1u << (shift - 1));
+            counts[v >> shift]++;
+        }
+        EXPECT(std::all_of(counts.begin(), counts.end(), [](uint32_t c) { return c == 1; }));
+
+        // Blue noise has little low-frequency energy.
+        std::vector<double> image(count);
+        for (uint32_t i = 0; i < count; i++) image[i] = mask[i] * 0x1p-32;
+        double power = lowFrequencyPower(image);
+        EXPECT_LE(power, 0.01) << "power = " << power;
+    }
+
+    CPU_TEST(SampleGenerator_BlueNoise)
+    {
+        // Without the mask offset, all pixels use the same stratified sequence.
+        const auto& mask = BlueNoiseSampleGenerator::getMask();
+        for (uint32_t dimension = 0; dimension < 2 * kSobolDimensions; dimension++)
+        {
+            std::vector<uint32_t> sequence;
+            for (uint2 pixel : { uint2(0, 0), uint2(3, 9), uint2(100, 200) })
+            {
+                auto values = generateDimension<BlueNoiseSampleGenerator::State>(pixel, dimension, 256);
+                for (auto& v : values) v -= mask[getBlueNoiseMaskIndex(pixel, dimension)];
+                EXPECT(isStratified(values)) << "pixel = (" << pixel.x << ", " << pixel.y << ") dimension = " << dimension;
+
+                if (sequence.empty()) sequence = values;
+                EXPECT(values == sequence) << "pixel = (" << pixel.x << ", " << pixel.y << ") dimension = " << dimension;
+            }
+        }
+
+        // The error of estimates in neighbouring pixels is negatively correlated, so the error has less low-frequency
+        // energy than with the independently scrambled Sobol sequence, which has similar error per pixel.
+        auto f = [](float u0, float u1) { return u0 * u0 + std::sin(3.f * u1); };
+        const double reference = 1.0 / 3.0 + (1.0 - std::cos(3.0)) / 3.0;
+        auto errorImage = [&](auto generator)
+        {
+            const uint32_t N = 4;
+            std::vector<double> image(kBlueNoiseMaskSize * kBlueNoiseMaskSize);
+            for (uint32_t y = 0; y < kBlueNoiseMaskSize; y++)
+            {
+                for (uint32_t x = 0; x < kBlueNoiseMaskSize; x++)
+                {
+                    double sum = 0.0;
+                    for (uint32_t i = 0; i < N; i++)
+                    {
+                        auto sg = generator(uint2(x, y), i);
+                        float2 u = sampleNext2D(sg);
+                        sum += f(u.x, u.y);
+                    }
+                    image[y * kBlueNoiseMaskSize + x] = sum / N - reference;
+                }
+            }
+            return image;
+        };
+        double blueNoisePower = lowFrequencyPower(errorImage([](uint2 p, uint32_t i) { return BlueNoiseSampleGenerator::State(p, i); }));
+        double sobolPower = lowFrequencyPower(errorImage([](uint2 p, uint32_t i) { return SobolSampleGenerator::State(p, i); }));
+        EXPECT_LE(blueNoisePower, 0.2 * sobolPower) << "blueNoisePower = " << blueNoisePower << " sobolPower = " << sobolPower;
+    }
+
+    CPU_TEST(SampleGenerator_ConvergenceBenchmark)
+    {
+        // Integrands over [0,1)^D with known integrals.
+        struct Integrand
+        {
+            std::string name;
+            uint32_t dimensions;
+            std::function<double(const float*)> f;
+            double reference;
+        };
+        const double gaussian1D = 0.746824132812427;    // Integral of exp(-x^2) over [0,1].
+        const Integrand integrands[] =
+        {
+            { "smooth 2D", 2, [](const float* u) { return (double)u[0] * u[1]; }, 0.25 },
+            { "disk 2D", 2, [](const float* u) { return u[0] * u[0] + u[1] * u[1] < 1.f ? 1.0 : 0.0; }, M_PI / 4.0 },
+            { "gaussian 4D", 4, [](const float* u) { return std::exp(-(double)(u[0] * u[0] + u[1] * u[1] + u[2] * u[2] + u[3] * u[3])); }, std::pow(gaussian1D, 4.0) },
+        };
+
+        auto uniform = [](uint2 p, uint32_t i) { return UniformState(p, i); };
+        auto sobol = [](uint2 p, uint32_t i) { return SobolSampleGenerator::State(p, i); };
+        auto blueNoise = [](uint2 p, uint32_t i) { return BlueNoiseSampleGenerator::State(p, i); };
+
+        for (const auto& integrand : integrands)
+        {
+            for (uint32_t N : { 16u, 256u, 4096u })
+            {
+                double uniformRMSE = estimateRMSE(uniform, integrand.f, integrand.dimensions, N, integrand.reference);
+                double sobolRMSE = estimateRMSE(sobol, integrand.f, integrand.dimensions, N, integrand.reference);
+                double blueNoiseRMSE = estimateRMSE(blueNoise, integrand.f, integrand.dimensions, N, integrand.reference);
+                logInfo("SampleGenerator convergence (" + integrand.name + ", " + std::to_string(N) + " spp): RMSE uniform " + std::to_string(uniformRMSE) +
+                    ", Sobol " + std::to_string(sobolRMSE) + ", blue noise " + std::to_string(blueNoiseRMSE));
+
+                // The low-discrepancy sequences converge faster than O(N^-1/2) for these integrands.
+                if (N >= 256)
+                {
+                    EXPECT_LE(sobolRMSE, 0.5 * uniformRMSE) << integrand.name << " N = " << N;
+                    EXPECT_LE(blueNoiseRMSE, 0.5 * uniformRMSE) << integrand.name << " N = " << N;
+                }
+            }
+        }
+    }
 }
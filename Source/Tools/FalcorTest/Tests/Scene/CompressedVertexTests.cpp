@@ -0,0 +1,156 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneTypes.slang"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        std::mt19937 rng;
+        auto dist = std::uniform_real_distribution<float>();
+        float u() { return dist(rng); }
+
+        float3 randomDirection()
+        {
+            const float z = 1.f - 2.f * u();
+            const float r = std::sqrt(std::max(0.f, 1.f - z * z));
+            const float phi = 2.f * (float)M_PI * u();
+            return float3(r * std::cos(phi), r * std::sin(phi), z);
+        }
+
+        /** Returns the angle between two unit vectors. Unlike acos(dot(a, b)), this is accurate for small angles.
+        */
+        float angleBetween(const float3& a, const float3& b)
+        {
+            return 2.f * std::asin(std::min(1.f, 0.5f * glm::length(a - b)));
+        }
+
+        StaticVertexData randomVertex(const float3& origin, const float3& scale)
+        {
+            StaticVertexData v;
+            v.position = origin + scale * float3(u(), u(), u());
+            v.normal = randomDirection();
+            v.tangent = float4(randomDirection(), u() < 0.5f ? -1.f : 1.f);
+            v.texCrd = float2(u(), u()) * 16.f - 8.f;
+            return v;
+        }
+    }
+
+    CPU_TEST(CompressedVertex_Size)
+    {
+        EXPECT_EQ(sizeof(CompressedStaticVertexData), 20);
+        EXPECT_LT(sizeof(CompressedStaticVertexData), sizeof(PackedStaticVertexData));
+    }
+
+    CPU_TEST(CompressedVertex_Position)
+    {
+        const float3 origin(-12.f, 3.f, 100.f);
+        const float3 scale(40.f, 0.5f, 1000.f);
+
+        // The error is at most half a quantization step of the mesh bounds in each dimension.
+        const float3 maxError = scale * (0.5f / 65535.f) + 1e-5f * glm::abs(origin + scale);
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            StaticVertexData v = randomVertex(origin, scale);
+            CompressedStaticVertexData c(v, origin, scale);
+            float3 p = c.unpackPosition(origin, scale);
+            for (int j = 0; j < 3; j++) EXPECT_LE(std::abs(p[j] - v.position[j]), maxError[j]) << "i = " << i << ", j = " << j;
+        }
+
+        // The corners of the bounds are reproduced exactly.
+        for (const float3& p : { origin, origin + scale })
+        {
+            StaticVertexData v = randomVertex(origin, scale);
+            v.position = p;
+            EXPECT_EQ(CompressedStaticVertexData(v, origin, scale).unpackPosition(origin, scale), p);
+        }
+
+        // Positions outside the bounds are clamped, and degenerate bounds reproduce the origin.
+        StaticVertexData v = randomVertex(origin, scale);
+        v.position = origin - scale;
+        EXPECT_EQ(CompressedStaticVertexData(v, origin, scale).unpackPosition(origin, scale), origin);
+        v.position = origin + float3(1.f);
+        EXPECT_EQ(CompressedStaticVertexData(v, origin, float3(0.f)).unpackPosition(origin, float3(0.f)), origin);
+    }
+
+    CPU_TEST(CompressedVertex_NormalTangent)
+    {
+        const float3 origin(0.f);
+        const float3 scale(1.f);
+
+        // 16-bit octahedral encoding has an angular error well below 0.01 degrees.
+        const float maxAngle = 2e-4f;
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            StaticVertexData v = randomVertex(origin, scale);
+            StaticVertexData d = CompressedStaticVertexData(v, origin, scale).unpack(origin, scale);
+            EXPECT_LE(angleBetween(d.normal, v.normal), maxAngle) << "i = " << i;
+            EXPECT_LE(angleBetween(float3(d.tangent), float3(v.tangent)), maxAngle) << "i = " << i;
+            EXPECT_EQ(d.tangent.w, v.tangent.w) << "i = " << i;
+        }
+
+        // A zero tangent sign marks an invalid tangent and is preserved.
+        StaticVertexData v = randomVertex(origin, scale);
+        v.tangent.w = 0.f;
+        EXPECT_EQ(CompressedStaticVertexData(v, origin, scale).unpack(origin, scale).tangent.w, 0.f);
+    }
+
+    CPU_TEST(CompressedVertex_TexCrd)
+    {
+        const float3 origin(0.f);
+        const float3 scale(1.f);
+
+        // Half precision has an 11-bit significand, so the relative rounding error is at most 2^-11.
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            StaticVertexData v = randomVertex(origin, scale);
+            float2 texCrd = CompressedStaticVertexData(v, origin, scale).unpackTexCrd();
+            EXPECT_LE(std::abs(texCrd.x - v.texCrd.x), std::abs(v.texCrd.x) * std::exp2(-11.f)) << "i = " << i;
+            EXPECT_LE(std::abs(texCrd.y - v.texCrd.y), std::abs(v.texCrd.y) * std::exp2(-11.f)) << "i = " << i;
+        }
+    }
+
+    CPU_TEST(CompressedVertex_FromPacked)
+    {
+        // The scene builder compresses vertices from the default packed format. Check that the round trip keeps the attributes.
+        const float3 origin(-1.f);
+        const float3 scale(2.f);
+
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            StaticVertexData v = randomVertex(origin, scale);
+            StaticVertexData d = CompressedStaticVertexData(PackedStaticVertexData(v).unpack(), origin, scale).unpack(origin, scale);
+            EXPECT_LE(glm::length(d.position - v.position), 1e-4f) << "i = " << i;
+            EXPECT_LE(angleBetween(d.normal, v.normal), 2e-3f) << "i = " << i;
+            EXPECT_LE(angleBetween(float3(d.tangent), float3(v.tangent)), 4e-4f) << "i = " << i;
+            EXPECT_EQ(d.tangent.w, v.tangent.w) << "i = " << i;
+        }
+    }
+}
@@ -0,0 +1,201 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/DuplicateMeshDetector.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const float kTolerance = 1e-4f;
+
+        /** Create a bumpy sphere with a UV parameterization and 32-bit indices.
+        */
+        void createBumpySphere(uint32_t segments, std::vector<StaticVertexData>& vertices, std::vector<uint32_t>& indices)
+        {
+            const uint32_t rings = segments / 2;
+            for (uint32_t r = 0; r <= rings; r++)
+            {
+                for (uint32_t s = 0; s <= segments; s++)
+                {
+                    const float theta = (float)M_PI * r / rings, phi = 2.f * (float)M_PI * s / segments;
+                    const float3 n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+                    const float radius = 1.f + 0.1f * std::sin(5.f * phi) * std::sin(3.f * theta);
+                    StaticVertexData v;
+                    v.position = n * radius;
+                    v.normal = n;
+                    v.tangent = float4(-std::sin(phi), 0.f, std::cos(phi), 1.f);
+                    v.texCrd = float2((float)s / segments, (float)r / rings);
+                    vertices.push_back(v);
+                }
+            }
+            for (uint32_t r = 0; r < rings; r++)
+            {
+                for (uint32_t s = 0; s < segments; s++)
+                {
+                    const uint32_t v00 = r * (segments + 1) + s, v01 = v00 + 1, v10 = v00 + segments + 1, v11 = v10 + 1;
+                    for (uint32_t i : { v00, v01, v10, v10, v01, v11 }) indices.push_back(i);
+                }
+            }
+        }
+
+        /** Bake a transform into vertex data.
+        */
+        std::vector<StaticVertexData> transformVertices(const std::vector<StaticVertexData>& vertices, const glm::mat4& transform)
+        {
+            const glm::mat3 normalTransform = glm::transpose(glm::inverse(glm::mat3(transform)));
+            std::vector<StaticVertexData> result = vertices;
+            for (auto& v : result)
+            {
+                v.position = float3(transform * float4(v.position, 1.f));
+                v.normal = glm::normalize(normalTransform * v.normal);
+                v.tangent = float4(glm::normalize(glm::mat3(transform) * float3(v.tangent)), v.tangent.w);
+            }
+            return result;
+        }
+
+        DuplicateMeshDetector::Mesh createMesh(const std::vector<StaticVertexData>& vertices, const std::vector<uint32_t>& indices, const glm::mat4& transform = glm::identity<glm::mat4>())
+        {
+            DuplicateMeshDetector::Mesh mesh;
+            mesh.vertices = vertices.data();
+            mesh.vertexCount = (uint32_t)vertices.size();
+            mesh.indexData = indices.data();
+            mesh.indexCount = (uint32_t)indices.size();
+            mesh.transform = transform;
+            return mesh;
+        }
+
+        glm::mat4 createRigidTransform(float angle, float3 axis, float3 translation)
+        {
+            return glm::translate(glm::identity<glm::mat4>(), translation) * glm::rotate(glm::identity<glm::mat4>(), angle, glm::normalize(axis));
+        }
+
+        float maxDifference(const glm::mat4& a, const glm::mat4& b)
+        {
+            float d = 0.f;
+            for (int c = 0; c < 4; c++) for (int r = 0; r < 4; r++) d = std::max(d, std::abs(a[c][r] - b[c][r]));
+            return d;
+        }
+    }
+
+    CPU_TEST(DuplicateMeshDetector_RegisterPoints)
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> u(-1.f, 1.f);
+
+        for (uint32_t iter = 0; iter < 20; iter++)
+        {
+            std::vector<float3> src(100), dst(100);
+            for (auto& p : src) p = float3(u(rng), u(rng), u(rng)) * 10.f;
+
+            const glm::mat4 transform = createRigidTransform(u(rng) * (float)M_PI, float3(u(rng), u(rng), u(rng)), float3(u(rng), u(rng), u(rng)) * 100.f);
+            for (size_t i = 0; i < src.size(); i++) dst[i] = float3(transform * float4(src[i], 1.f));
+
+            const glm::mat4 result = DuplicateMeshDetector::registerPoints(src.data(), dst.data(), src.size());
+            EXPECT_LE(maxDifference(result, transform), 1e-3f) << "iter = " << iter;
+        }
+
+        // Planar point sets still determine the rotation.
+        std::vector<float3> src = { float3(0, 0, 0), float3(1, 0, 0), float3(0, 1, 0), float3(2, 3, 0) };
+        std::vector<float3> dst;
+        const glm::mat4 transform = createRigidTransform(2.f, float3(1, 2, 3), float3(5, -1, 2));
+        for (const auto& p : src) dst.push_back(float3(transform * float4(p, 1.f)));
+        EXPECT_LE(maxDifference(DuplicateMeshDetector::registerPoints(src.data(), dst.data(), src.size()), transform), 1e-4f);
+    }
+
+    CPU_TEST(DuplicateMeshDetector_Detect)
+    {
+        std::vector<StaticVertexData> vertices;
+        std::vector<uint32_t> indices;
+        createBumpySphere(32, vertices, indices);
+
+        // Copies with a baked rigid transform, with a rigid node transform, with a baked scale and with different UVs.
+        const glm::mat4 bakedTransform = createRigidTransform(1.f, float3(1, 1, 0), float3(10, 0, 0));
+        const glm::mat4 nodeTransform = createRigidTransform(-2.f, float3(0, 1, 1), float3(0, 0, -20));
+        const auto bakedVertices = transformVertices(vertices, bakedTransform);
+        const auto scaledVertices = transformVertices(vertices, glm::scale(glm::identity<glm::mat4>(), float3(1.01f)));
+        auto otherUVVertices = bakedVertices;
+        otherUVVertices[0].texCrd.x += 0.5f;
+
+        std::vector<DuplicateMeshDetector::Mesh> meshes =
+        {
+            createMesh(vertices, indices),
+            createMesh(bakedVertices, indices),
+            createMesh(vertices, indices, nodeTransform),
+            createMesh(scaledVertices, indices),
+            createMesh(otherUVVertices, indices),
+        };
+
+        // A mesh with a different key is never matched.
+        meshes.push_back(createMesh(bakedVertices, indices));
+        meshes.back().key = 1;
+
+        DuplicateMeshDetector::Stats stats;
+        const auto matches = DuplicateMeshDetector::detect(meshes, kTolerance, &stats);
+        EXPECT_EQ(matches.size(), meshes.size());
+
+        EXPECT_EQ(matches[0].prototypeID, DuplicateMeshDetector::kInvalidID);
+        EXPECT_EQ(matches[1].prototypeID, 0);
+        EXPECT_LE(maxDifference(matches[1].transform, bakedTransform), 1e-4f);
+        EXPECT_EQ(matches[2].prototypeID, 0);
+        EXPECT_LE(maxDifference(matches[2].transform, nodeTransform), 1e-4f);
+        EXPECT_EQ(matches[3].prototypeID, DuplicateMeshDetector::kInvalidID);
+        EXPECT_EQ(matches[4].prototypeID, DuplicateMeshDetector::kInvalidID);
+        EXPECT_EQ(matches[5].prototypeID, DuplicateMeshDetector::kInvalidID);
+
+        EXPECT_EQ(stats.meshCount, 6);
+        EXPECT_EQ(stats.prototypeCount, 1);
+        EXPECT_EQ(stats.duplicateCount, 2);
+        EXPECT_EQ(stats.vertexCount, 6 * vertices.size());
+    }
+
+    CPU_TEST(DuplicateMeshDetector_Tolerance)
+    {
+        std::vector<StaticVertexData> vertices;
+        std::vector<uint32_t> indices;
+        createBumpySphere(16, vertices, indices);
+
+        const glm::mat4 transform = createRigidTransform(0.5f, float3(0, 0, 1), float3(0, 3, 0));
+        auto noisyVertices = transformVertices(vertices, transform);
+        auto perturbedVertices = noisyVertices;
+
+        // Noise well below the tolerance is accepted, a single vertex moved by 1% of the radius is not.
+        std::mt19937 rng(2);
+        std::uniform_real_distribution<float> u(-1.f, 1.f);
+        for (auto& v : noisyVertices) v.position += float3(u(rng), u(rng), u(rng)) * 1e-6f;
+        perturbedVertices[10].position += float3(0.01f, 0.f, 0.f);
+
+        std::vector<DuplicateMeshDetector::Mesh> meshes = { createMesh(vertices, indices), createMesh(noisyVertices, indices), createMesh(perturbedVertices, indices) };
+        const auto matches = DuplicateMeshDetector::detect(meshes, kTolerance);
+
+        EXPECT_EQ(matches[1].prototypeID, 0);
+        EXPECT_LE(matches[1].error, kTolerance * 1.1f);
+        EXPECT_EQ(matches[2].prototypeID, DuplicateMeshDetector::kInvalidID);
+    }
+}
@@ -0,0 +1,322 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Experimental/Scene/Lights/EmissiveTriangleIntegrator.h"
+#include "Experimental/Scene/Lights/LightCollection.h"
+#include "Scene/SceneBuilder.h"
+#include "Utils/Color/ColorHelpers.slang"
+#include <filesystem>
+
+namespace Falcor
+{
+    namespace
+    {
+        using Triangle = EmissiveTriangleIntegrator::Triangle;
+        using Material = EmissiveTriangleIntegrator::Material;
+
+        Triangle createTriangle(float2 t0, float2 t1, float2 t2, float area = 1.f, uint32_t materialID = 0)
+        {
+            Triangle triangle;
+            triangle.texCoords[0] = t0;
+            triangle.texCoords[1] = t1;
+            triangle.texCoords[2] = t2;
+            triangle.area = area;
+            triangle.materialID = materialID;
+            return triangle;
+        }
+
+        Material createMaterial(uint32_t textureID, float emissiveFactor = 1.f)
+        {
+            Material material;
+            material.textureID = textureID;
+            material.emissiveFactor = emissiveFactor;
+            return material;
+        }
+
+        /** Adds an RGBA32Float texture with the given texels.
+        */
+        uint32_t addTexture(EmissiveTriangleIntegrator& integrator, uint32_t width, uint32_t height, const std::vector<float3>& texels)
+        {
+            std::vector<float> data;
+            for (const auto& t : texels) data.insert(data.end(), { t.x, t.y, t.z, 1.f });
+            return integrator.addTexture(width, height, ResourceFormat::RGBA32Float, data.data());
+        }
+
+        float expectedFlux(float3 averageRadiance, float area)
+        {
+            return luminance(averageRadiance) * area * (float)M_PI;
+        }
+
+        bool isClose(float3 a, float3 b, float epsilon)
+        {
+            return glm::all(glm::lessThanEqual(glm::abs(a - b), float3(epsilon)));
+        }
+    }
+
+    CPU_TEST(EmissiveIntegratorUntextured)
+    {
+        EmissiveTriangleIntegrator integrator;
+
+        Material material;
+        material.emissive = float3(1.f, 2.f, 3.f);
+        material.emissiveFactor = 0.5f;
+
+        std::vector<Triangle> triangles = { createTriangle(float2(0.f), float2(1.f, 0.f), float2(0.f, 1.f), 2.f), createTriangle(float2(0.f), float2(0.f), float2(0.f), 0.f) };
+        auto result = integrator.integrate(triangles, { material });
+
+        EXPECT_EQ(result.size(), 2);
+        EXPECT(result[0].averageRadiance == float3(0.5f, 1.f, 1.5f));
+        EXPECT_EQ(result[0].flux, expectedFlux(float3(0.5f, 1.f, 1.5f), 2.f));
+        EXPECT_EQ(result[1].flux, 0.f);
+        EXPECT_EQ(integrator.getStats().triangleCount, 2);
+        EXPECT_EQ(integrator.getStats().texturedTriangleCount, 0);
+    }
+
+    CPU_TEST(EmissiveIntegratorConstantTexture)
+    {
+        // Every triangle over a constant texture has the texture's radiance, regardless of size, position and mip.
+        EmissiveTriangleIntegrator integrator(Sampler::AddressMode::Wrap, Sampler::AddressMode::Wrap, 16);
+        const float3 color(0.25f, 0.5f, 2.f);
+        uint32_t textureID = addTexture(integrator, 64, 32, std::vector<float3>(64 * 32, color));
+        EXPECT_EQ(textureID, 0);
+
+        std::vector<Triangle> triangles =
+        {
+            createTriangle(float2(0.f), float2(1.f, 0.f), float2(0.f, 1.f), 3.f),
+            createTriangle(float2(0.1f, 0.1f), float2(0.1001f, 0.1f), float2(0.1f, 0.1002f)),
+            createTriangle(float2(-3.2f, 5.1f), float2(7.9f, 4.3f), float2(0.3f, -2.7f)),
+            createTriangle(float2(0.3f, 0.3f), float2(0.3f, 0.3f), float2(0.3f, 0.3f)),
+        };
+        auto result = integrator.integrate(triangles, { createMaterial(textureID, 4.f) });
+
+        for (size_t i = 0; i < triangles.size(); i++)
+        {
+            EXPECT(isClose(result[i].averageRadiance, color * 4.f, 1e-5f)) << "triangle " << i;
+            EXPECT(std::abs(result[i].flux - expectedFlux(color * 4.f, triangles[i].area)) <= 1e-4f * result[i].flux) << "triangle " << i;
+        }
+        EXPECT_EQ(integrator.getStats().texturedTriangleCount, 4);
+    }
+
+    CPU_TEST(EmissiveIntegratorCoverage)
+    {
+        // Texels are weighted by their exact overlap with the triangle.
+        EmissiveTriangleIntegrator integrator;
+        const float3 a(1.f, 0.f, 0.f), b(0.f, 0.f, 4.f);
+        uint32_t textureID = addTexture(integrator, 2, 1, { a, b });
+
+        // In texel space, this triangle covers 3/4 of the left texel and 1/4 of the right texel.
+        // A small triangle that doesn't cover any texel center gets the texel it lies within.
+        std::vector<Triangle> triangles =
+        {
+            createTriangle(float2(0.f), float2(1.f, 0.f), float2(0.f, 1.f)),
+            createTriangle(float2(0.7f, 0.4f), float2(0.71f, 0.4f), float2(0.7f, 0.41f)),
+        };
+        auto result = integrator.integrate(triangles, { createMaterial(textureID) });
+
+        EXPECT(isClose(result[0].averageRadiance, a * 0.75f + b * 0.25f, 1e-6f));
+        EXPECT(isClose(result[1].averageRadiance, b, 1e-6f));
+        EXPECT_EQ(integrator.getStats().texelCount, 3);
+    }
+
+    CPU_TEST(EmissiveIntegratorAddressModes)
+    {
+        // The triangle covers the texture's second repetition in u, or the area to its right.
+        const float3 a(1.f, 0.f, 0.f), b(0.f, 0.f, 4.f);
+        const Triangle triangle = createTriangle(float2(1.f, 0.f), float2(2.f, 0.f), float2(1.f, 1.f));
+
+        auto integrate = [&](Sampler::AddressMode mode)
+        {
+            EmissiveTriangleIntegrator integrator(mode, Sampler::AddressMode::Wrap);
+            uint32_t textureID = addTexture(integrator, 2, 1, { a, b });
+            return integrator.integrate({ triangle }, { createMaterial(textureID) })[0].averageRadiance;
+        };
+
+        EXPECT(isClose(integrate(Sampler::AddressMode::Wrap), a * 0.75f + b * 0.25f, 1e-6f));
+        EXPECT(isClose(integrate(Sampler::AddressMode::Mirror), b * 0.75f + a * 0.25f, 1e-6f));
+        EXPECT(isClose(integrate(Sampler::AddressMode::Clamp), b, 1e-6f));
+        EXPECT(isClose(integrate(Sampler::AddressMode::MirrorOnce), b, 1e-6f));
+        EXPECT(isClose(integrate(Sampler::AddressMode::Border), float3(0.f), 1e-6f));
+    }
+
+    CPU_TEST(EmissiveIntegratorFormats)
+    {
+        EmissiveTriangleIntegrator integrator;
+        const Triangle triangle = createTriangle(float2(0.f), float2(1.f, 0.f), float2(0.f, 1.f));
+
+        const uint8_t rgba8[4] = { 64, 128, 255, 0 };
+        const uint16_t rgba16[4] = { 0x3c00, 0x4000, 0x3800, 0x3c00 }; // 1, 2, 0.5, 1
+        const float r32 = 3.f;
+
+        std::vector<Material> materials =
+        {
+            createMaterial(integrator.addTexture(1, 1, ResourceFormat::RGBA8Unorm, rgba8)),
+            createMaterial(integrator.addTexture(1, 1, ResourceFormat::RGBA8UnormSrgb, rgba8)),
+            createMaterial(integrator.addTexture(1, 1, ResourceFormat::BGRA8Unorm, rgba8)),
+            createMaterial(integrator.addTexture(1, 1, ResourceFormat::RGBA16Float, rgba16)),
+            createMaterial(integrator.addTexture(1, 1, ResourceFormat::R32Float, &r32)),
+        };
+        std::vector<Triangle> triangles(materials.size(), triangle);
+        for (uint32_t i = 0; i < triangles.size(); i++) triangles[i].materialID = i;
+        auto result = integrator.integrate(triangles, materials);
+
+        EXPECT(isClose(result[0].averageRadiance, float3(64.f, 128.f, 255.f) / 255.f, 1e-6f));
+        EXPECT(isClose(result[1].averageRadiance, float3(sRGBToLinear(64.f / 255.f), sRGBToLinear(128.f / 255.f), 1.f), 1e-6f));
+        EXPECT(isClose(result[2].averageRadiance, float3(255.f, 128.f, 64.f) / 255.f, 1e-6f));
+        EXPECT(isClose(result[3].averageRadiance, float3(1.f, 2.f, 0.5f), 1e-6f));
+        EXPECT(isClose(result[4].averageRadiance, float3(3.f, 0.f, 0.f), 1e-6f));
+
+        // Compressed formats are not supported.
+        EXPECT(!EmissiveTriangleIntegrator::isFormatSupported(ResourceFormat::BC1Unorm));
+        EXPECT_EQ(integrator.addTexture(4, 4, ResourceFormat::BC1Unorm, rgba8), EmissiveTriangleIntegrator::kNoTexture);
+    }
+
+    CPU_TEST(EmissiveIntegratorMips)
+    {
+        // Large triangles are integrated over coarser mips, which only blurs the texels along their edges.
+        const uint32_t size = 256;
+        std::vector<float3> texels(size * size);
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++) texels[y * size + x] = float3(float(x) / size, float(y) / size, ((x / 8 + y / 8) & 1) ? 1.f : 0.f);
+        }
+
+        std::vector<Triangle> triangles =
+        {
+            createTriangle(float2(0.f), float2(1.f, 0.f), float2(0.f, 1.f)),
+            createTriangle(float2(0.1f, 0.2f), float2(0.9f, 0.4f), float2(0.3f, 0.8f)),
+            createTriangle(float2(0.5f, 0.5f), float2(0.6f, 0.5f), float2(0.5f, 0.7f)),
+        };
+
+        EmissiveTriangleIntegrator reference(Sampler::AddressMode::Wrap, Sampler::AddressMode::Wrap, size * size);
+        auto expected = reference.integrate(triangles, { createMaterial(addTexture(reference, size, size, texels)) });
+        const uint64_t referenceTexelCount = reference.getStats().texelCount;
+
+        EmissiveTriangleIntegrator integrator(Sampler::AddressMode::Wrap, Sampler::AddressMode::Wrap, 64);
+        auto result = integrator.integrate(triangles, { createMaterial(addTexture(integrator, size, size, texels)) });
+        EXPECT_LE(integrator.getStats().texelCount, 3 * 64);
+        EXPECT_GT(referenceTexelCount, 10 * integrator.getStats().texelCount);
+
+        for (size_t i = 0; i < triangles.size(); i++)
+        {
+            EXPECT(isClose(result[i].averageRadiance, expected[i].averageRadiance, 0.03f)) << "triangle " << i;
+        }
+    }
+
+    CPU_TEST(EmissiveIntegratorCache)
+    {
+        const std::string cacheDirectory = (std::filesystem::temp_directory_path() / "EmissiveIntegratorTests").string();
+        std::filesystem::remove_all(cacheDirectory);
+
+        std::vector<float3> texels(16 * 16);
+        for (size_t i = 0; i < texels.size(); i++) texels[i] = float3(float(i % 7), float(i % 5), float(i % 3));
+
+        std::vector<Triangle> triangles;
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            float2 t0(i * 0.01f, i * 0.003f);
+            triangles.push_back(createTriangle(t0, t0 + float2(0.2f, 0.f), t0 + float2(0.f, 0.3f), 1.f + i, i % 2));
+        }
+        Material untextured;
+        untextured.emissive = float3(1.f);
+
+        // The first integration writes the cache, the second loads it.
+        EmissiveTriangleIntegrator integrator;
+        std::vector<Material> materials = { createMaterial(addTexture(integrator, 16, 16, texels)), untextured };
+        auto result = integrator.integrateCached(triangles, materials, cacheDirectory);
+        EXPECT(!integrator.getStats().cached);
+        EXPECT(!std::filesystem::is_empty(cacheDirectory));
+
+        EmissiveTriangleIntegrator cachedIntegrator;
+        addTexture(cachedIntegrator, 16, 16, texels);
+        auto cachedResult = cachedIntegrator.integrateCached(triangles, materials, cacheDirectory);
+        EXPECT(cachedIntegrator.getStats().cached);
+        EXPECT_EQ(cachedIntegrator.getStats().texturedTriangleCount, 500);
+        EXPECT(std::memcmp(result.data(), cachedResult.data(), result.size() * sizeof(EmissiveFlux)) == 0);
+
+        // Changing the texels doesn't use the cached results.
+        texels[0] = float3(100.f);
+        EmissiveTriangleIntegrator otherIntegrator;
+        addTexture(otherIntegrator, 16, 16, texels);
+        otherIntegrator.integrateCached(triangles, materials, cacheDirectory);
+        EXPECT(!otherIntegrator.getStats().cached);
+
+        std::filesystem::remove_all(cacheDirectory);
+    }
+
+    GPU_TEST(EmissiveIntegratorHostMatchesGPU)
+    {
+        // An emissive sphere with a smooth texture, so that each triangle covers many texels whose average
+        // doesn't depend much on whether the edge texels are weighted by their overlap or by their center.
+        const uint32_t width = 256, height = 128;
+        std::vector<float> texels(size_t(width) * height * 4);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                float* p = &texels[(size_t(y) * width + x) * 4];
+                p[0] = 0.2f + float(x) / width;
+                p[1] = 0.2f + float(y) / height;
+                p[2] = 0.5f + 0.25f * std::sin(float(x + y) * 0.05f);
+                p[3] = 1.f;
+            }
+        }
+
+        Falcor::Material::SharedPtr pMaterial = Falcor::Material::create("Emissive");
+        pMaterial->setEmissiveTexture(Texture::create2D(width, height, ResourceFormat::RGBA32Float, 1, 1, texels.data()));
+        pMaterial->setEmissiveFactor(2.f);
+
+        SceneBuilder::SharedPtr pBuilder = SceneBuilder::create();
+        uint32_t meshID = pBuilder->addTriangleMesh(TriangleMesh::createSphere(1.f, 16, 8), pMaterial);
+        pBuilder->addMeshInstance(pBuilder->addNode(SceneBuilder::Node{ "Sphere", glm::mat4(1.f), glm::mat4(1.f) }), meshID);
+        Scene::SharedPtr pScene = pBuilder->getScene();
+        EXPECT_NE(pScene, nullptr);
+        if (!pScene) return;
+
+        auto pHost = LightCollection::create(ctx.getRenderContext(), pScene, true);
+        auto pDevice = LightCollection::create(ctx.getRenderContext(), pScene, false);
+        EXPECT_EQ(pHost->getIntegrationStats().triangleCount, pHost->getTotalLightCount());
+        EXPECT_EQ(pDevice->getIntegrationStats().triangleCount, 0u);
+
+        const auto& hostTriangles = pHost->getMeshLightTriangles();
+        const auto& deviceTriangles = pDevice->getMeshLightTriangles();
+        EXPECT_EQ(hostTriangles.size(), deviceTriangles.size());
+        if (hostTriangles.size() != deviceTriangles.size()) return;
+
+        double hostFlux = 0.0, deviceFlux = 0.0;
+        for (size_t i = 0; i < hostTriangles.size(); i++)
+        {
+            const float3 host = hostTriangles[i].averageRadiance;
+            const float3 device = deviceTriangles[i].averageRadiance;
+            EXPECT(isClose(host, device, 0.03f * std::max(device.x, std::max(device.y, device.z)))) << "triangle = " << i;
+            EXPECT_LE(std::abs(hostTriangles[i].flux - deviceTriangles[i].flux), 0.03f * deviceTriangles[i].flux) << "triangle = " << i;
+            hostFlux += hostTriangles[i].flux;
+            deviceFlux += deviceTriangles[i].flux;
+        }
+        EXPECT_LE(std::abs(hostFlux - deviceFlux), 1e-2 * deviceFlux);
+    }
+}
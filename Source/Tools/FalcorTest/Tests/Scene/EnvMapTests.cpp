@@ -28,6 +28,10 @@
 #include "Testing/UnitTest.h"
 #include "Experimental/Scene/Lights/EnvMap.h"
 #include "Experimental/Scene/Lights/EnvMapSampler.h"
+#include "Experimental/Scene/Lights/EnvMapImportanceMap.h"
+#include "Utils/Image/PixelConversion.h"
+#include <filesystem>
+#include <random>
 
 namespace Falcor
 {
@@ -35,6 +39,27 @@ namespace Falcor
     {
         // This file is located in the Media/ directory fetched by packman.
         const char kEnvMapFile[] = "LightProbes/20050806-03_hd.hdr";
+
+        const float kInv4Pi = (float)(0.25 * M_1_PI);
+
+        /** Creates an RGBA32Float environment map with radiance varying over the sphere.
+        */
+        Bitmap::UniqueConstPtr createTestEnvMap(uint32_t width, uint32_t height)
+        {
+            std::vector<float> pixels(size_t(width) * height * 4);
+            for (uint32_t y = 0; y < height; y++)
+            {
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    float* p = &pixels[(size_t(y) * width + x) * 4];
+                    p[0] = 0.1f + float(x) / width;
+                    p[1] = 0.1f + float(y) / height;
+                    p[2] = (x == width / 4 && y == height / 3) ? 100.f : 0.5f;
+                    p[3] = 1.f;
+                }
+            }
+            return Bitmap::create(width, height, ResourceFormat::RGBA32Float, reinterpret_cast<const uint8_t*>(pixels.data()));
+        }
     }
 
     GPU_TEST(EnvMap)
@@ -46,7 +71,7 @@ namespace Falcor
         EXPECT_NE(pEnvMap, nullptr);
         if (pEnvMap == nullptr) return;
 
-        EnvMapSampler::SharedPtr pEnvMapSampler = EnvMapSampler::create(ctx.getRenderContext(), pEnvMap);
+        EnvMapSampler::SharedPtr pEnvMapSampler = EnvMapSampler::create(ctx.getRenderContext(), pEnvMap, false);
         EXPECT_NE(pEnvMapSampler, nullptr);
         if (pEnvMapSampler == nullptr) return;
 
@@ -64,4 +89,200 @@ namespace Falcor
         EXPECT_EQ(w, h);
         EXPECT_EQ(w, 1 << (mipCount - 1));
     }
+
+    GPU_TEST(EnvMapImportanceMapHostMatchesGPU)
+    {
+        EnvMap::SharedPtr pEnvMap = EnvMap::create(kEnvMapFile);
+        EXPECT_NE(pEnvMap, nullptr);
+        if (pEnvMap == nullptr) return;
+
+        auto pHostSampler = EnvMapSampler::create(ctx.getRenderContext(), pEnvMap, true);
+        auto pDeviceSampler = EnvMapSampler::create(ctx.getRenderContext(), pEnvMap, false);
+        auto pHostMap = pHostSampler->getImportanceMap();
+        auto pDeviceMap = pDeviceSampler->getImportanceMap();
+        EXPECT_EQ(pHostMap->getWidth(), pDeviceMap->getWidth());
+        EXPECT_EQ(pHostMap->getMipCount(), pDeviceMap->getMipCount());
+        if (pHostMap->getWidth() != pDeviceMap->getWidth() || pHostMap->getMipCount() != pDeviceMap->getMipCount()) return;
+
+        // The GPU filters with reduced precision weights, so compare the texels with a relative tolerance.
+        // The coarser mips average over many texels and match more closely.
+        for (uint32_t mip = 0; mip < pHostMap->getMipCount(); mip++)
+        {
+            std::vector<uint8_t> hostData = ctx.getRenderContext()->readTextureSubresource(pHostMap.get(), pHostMap->getSubresourceIndex(0, mip));
+            std::vector<uint8_t> deviceData = ctx.getRenderContext()->readTextureSubresource(pDeviceMap.get(), pDeviceMap->getSubresourceIndex(0, mip));
+            EXPECT_EQ(hostData.size(), deviceData.size());
+            if (hostData.size() != deviceData.size()) return;
+
+            const float* pHost = reinterpret_cast<const float*>(hostData.data());
+            const float* pDevice = reinterpret_cast<const float*>(deviceData.data());
+            const float tolerance = mip == 0 ? 2e-2f : 5e-3f;
+            size_t errors = 0;
+            for (size_t i = 0; i < hostData.size() / sizeof(float); i++)
+            {
+                if (std::abs(pHost[i] - pDevice[i]) > tolerance * std::max(std::abs(pDevice[i]), 1e-3f)) errors++;
+            }
+            EXPECT_EQ(errors, 0) << "mip = " << mip;
+        }
+    }
+
+    CPU_TEST(EnvMapImportanceMapConstant)
+    {
+        // A constant environment map has a uniform importance map and a pdf of 1/4pi.
+        const float radiance[4] = { 0.5f, 1.f, 2.f, 1.f };
+        std::vector<float> pixels(64 * 32 * 4);
+        for (size_t i = 0; i < pixels.size(); i++) pixels[i] = radiance[i % 4];
+        auto pEnvMap = Bitmap::create(64, 32, ResourceFormat::RGBA32Float, reinterpret_cast<const uint8_t*>(pixels.data()));
+
+        auto pMap = EnvMapImportanceMap::create(*pEnvMap, 16, 4);
+        EXPECT_NE(pMap, nullptr);
+        if (pMap == nullptr) return;
+        EXPECT_EQ(pMap->getDimension(), 16);
+        EXPECT_EQ(pMap->getMipCount(), 5);
+        EXPECT_EQ(pMap->getData().size(), 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2 + 1);
+
+        const float luminance = 0.2126f * radiance[0] + 0.7152f * radiance[1] + 0.0722f * radiance[2];
+        for (float v : pMap->getData()) EXPECT(std::abs(v - luminance) < 1e-5f) << "v = " << v;
+
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> u(0.f, 1.f);
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            auto s = pMap->sample(float2(u(rng), u(rng)));
+            EXPECT(std::abs(glm::length(s.dir) - 1.f) < 1e-4f);
+            EXPECT(std::abs(s.pdf - kInv4Pi) < 1e-5f) << "pdf = " << s.pdf;
+            EXPECT(std::abs(pMap->evalPdf(s.dir) - kInv4Pi) < 1e-5f);
+        }
+    }
+
+    CPU_TEST(EnvMapImportanceMapFormats)
+    {
+        // The importance map is the same for RGBA32Float and half float input, up to half float precision.
+        const uint32_t width = 32, height = 16;
+        auto pReference = createTestEnvMap(width, height);
+        const float* pSrc = reinterpret_cast<const float*>(pReference->getData());
+
+        std::vector<uint16_t> halves(size_t(width) * height * 4);
+        convertFloatToHalf(pSrc, halves.data(), halves.size());
+        auto pHalf = Bitmap::create(width, height, ResourceFormat::RGBA16Float, reinterpret_cast<const uint8_t*>(halves.data()));
+
+        std::vector<float> rgb(size_t(width) * height * 3);
+        for (size_t i = 0; i < size_t(width) * height; i++) for (size_t c = 0; c < 3; c++) rgb[i * 3 + c] = pSrc[i * 4 + c];
+        auto pRGB = Bitmap::create(width, height, ResourceFormat::RGB32Float, reinterpret_cast<const uint8_t*>(rgb.data()));
+
+        auto pMapReference = EnvMapImportanceMap::create(*pReference, 8, 4);
+        auto pMapHalf = EnvMapImportanceMap::create(*pHalf, 8, 4);
+        auto pMapRGB = EnvMapImportanceMap::create(*pRGB, 8, 4);
+        EXPECT(pMapReference && pMapHalf && pMapRGB);
+        if (!pMapReference || !pMapHalf || !pMapRGB) return;
+
+        for (size_t i = 0; i < pMapReference->getData().size(); i++)
+        {
+            float ref = pMapReference->getData()[i];
+            EXPECT_EQ(pMapRGB->getData()[i], ref) << "i = " << i;
+            EXPECT(std::abs(pMapHalf->getData()[i] - ref) <= 1e-3f * ref) << "i = " << i;
+        }
+
+        // Integer formats other than 8-bit unorm are not supported.
+        std::vector<uint32_t> uints(size_t(width) * height * 4);
+        auto pUint = Bitmap::create(width, height, ResourceFormat::RGBA32Uint, reinterpret_cast<const uint8_t*>(uints.data()));
+        EXPECT_EQ(EnvMapImportanceMap::create(*pUint, 8, 4), nullptr);
+    }
+
+    CPU_TEST(EnvMapImportanceMapMips)
+    {
+        auto pEnvMap = createTestEnvMap(128, 64);
+        auto pMap = EnvMapImportanceMap::create(*pEnvMap, 32, 16);
+        EXPECT_NE(pMap, nullptr);
+        if (pMap == nullptr) return;
+
+        // Each texel is the average of the 2x2 texels below it.
+        for (uint32_t mip = 1; mip < pMap->getMipCount(); mip++)
+        {
+            uint32_t dim = pMap->getDimension() >> mip;
+            for (uint32_t y = 0; y < dim; y++)
+            {
+                for (uint32_t x = 0; x < dim; x++)
+                {
+                    float avg = 0.25f * (pMap->getTexel(mip - 1, uint2(2 * x, 2 * y)) + pMap->getTexel(mip - 1, uint2(2 * x + 1, 2 * y)) +
+                        pMap->getTexel(mip - 1, uint2(2 * x, 2 * y + 1)) + pMap->getTexel(mip - 1, uint2(2 * x + 1, 2 * y + 1)));
+                    float v = pMap->getTexel(mip, uint2(x, y));
+                    EXPECT(std::abs(v - avg) <= 1e-5f * avg) << "mip = " << mip << " texel = (" << x << ", " << y << ")";
+                }
+            }
+        }
+    }
+
+    CPU_TEST(EnvMapImportanceMapSampling)
+    {
+        auto pEnvMap = createTestEnvMap(128, 64);
+        auto pMap = EnvMapImportanceMap::create(*pEnvMap, 8, 16);
+        EXPECT_NE(pMap, nullptr);
+        if (pMap == nullptr) return;
+
+        const uint32_t dim = pMap->getDimension();
+        const float avg = pMap->getTexel(pMap->getMipCount() - 1, uint2(0));
+
+        // Each texel covers a solid angle of 4pi/N^2, so the pdf integrates to one.
+        double integral = 0.0;
+        for (uint32_t y = 0; y < dim; y++) for (uint32_t x = 0; x < dim; x++) integral += pMap->getTexel(0, uint2(x, y)) / avg * kInv4Pi * (4.0 * M_PI / (dim * dim));
+        EXPECT(std::abs(integral - 1.0) < 1e-4) << "integral = " << integral;
+
+        // Draw samples and check that the pdf agrees with evalPdf() and that texels are chosen proportionally to their value.
+        const uint32_t sampleCount = 1 << 18;
+        std::vector<uint32_t> histogram(dim * dim, 0);
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> u(0.f, 1.f);
+        uint32_t pdfMismatches = 0;
+        for (uint32_t i = 0; i < sampleCount; i++)
+        {
+            auto s = pMap->sample(float2(u(rng), u(rng)));
+            histogram[s.texel.y * dim + s.texel.x]++;
+
+            float expected = pMap->getTexel(0, s.texel) / avg * kInv4Pi;
+            EXPECT(std::abs(s.pdf - expected) <= 1e-5f * expected);
+
+            // Directions on texel borders may map back to a neighbouring texel due to rounding.
+            float pdf = pMap->evalPdf(s.dir);
+            if (std::abs(pdf - s.pdf) > 1e-4f * s.pdf) pdfMismatches++;
+        }
+        EXPECT_LE(pdfMismatches, sampleCount / 1000) << "pdfMismatches = " << pdfMismatches;
+
+        for (uint32_t y = 0; y < dim; y++)
+        {
+            for (uint32_t x = 0; x < dim; x++)
+            {
+                double p = pMap->getTexel(0, uint2(x, y)) / (avg * dim * dim);
+                double expected = p * sampleCount;
+                double sigma = std::sqrt(expected * (1.0 - p));
+                EXPECT(std::abs(histogram[y * dim + x] - expected) <= 5.0 * sigma + 1.0) << "texel = (" << x << ", " << y << ") count = " << histogram[y * dim + x] << " expected = " << expected;
+            }
+        }
+    }
+
+    CPU_TEST(EnvMapImportanceMapCache)
+    {
+        const std::string cacheDirectory = (std::filesystem::temp_directory_path() / "EnvMapImportanceMapTests").string();
+        std::filesystem::remove_all(cacheDirectory);
+
+        // The first call builds the map and writes the cache, the second loads it.
+        auto pBuilt = EnvMapImportanceMap::createFromFile(kEnvMapFile, 64, 16, cacheDirectory);
+        EXPECT_NE(pBuilt, nullptr);
+        if (pBuilt == nullptr) return;
+        EXPECT(!std::filesystem::is_empty(cacheDirectory));
+
+        auto pCached = EnvMapImportanceMap::createFromFile(kEnvMapFile, 64, 16, cacheDirectory);
+        EXPECT_NE(pCached, nullptr);
+        if (pCached == nullptr) return;
+        EXPECT(pCached->getData() == pBuilt->getData());
+
+        // Different build parameters don't use the cached map.
+        auto pOther = EnvMapImportanceMap::createFromFile(kEnvMapFile, 32, 16, cacheDirectory);
+        EXPECT_NE(pOther, nullptr);
+        if (pOther != nullptr) EXPECT_EQ(pOther->getDimension(), 32);
+
+        // DDS files are not supported on the host.
+        EXPECT_EQ(EnvMapImportanceMap::createFromFile("LightProbes/hallstatt4_hd.dds", 64, 16, cacheDirectory), nullptr);
+
+        std::filesystem::remove_all(cacheDirectory);
+    }
 }
@@ -0,0 +1,386 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Material/VirtualTextureCache.h"
+#include <filesystem>
+
+namespace Falcor
+{
+    namespace
+    {
+        using PageID = VirtualTexturePageFile::PageID;
+
+        const uint32_t kPageSize = 64;
+        const uint32_t kBorder = 2;
+
+        std::string getTempPath(const std::string& name)
+        {
+            return (std::filesystem::temp_directory_path() / name).string();
+        }
+
+        /** Create an RGBA8Unorm bitmap with the texel coordinates encoded in each texel.
+        */
+        Bitmap::UniqueConstPtr createCoordBitmap(uint32_t width, uint32_t height)
+        {
+            std::vector<uint8_t> data(size_t(width) * height * 4);
+            for (uint32_t y = 0; y < height; y++)
+            {
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    uint8_t* p = &data[(size_t(y) * width + x) * 4];
+                    p[0] = uint8_t(x & 0xff);
+                    p[1] = uint8_t(y & 0xff);
+                    p[2] = uint8_t((x >> 8) | ((y >> 8) << 4));
+                    p[3] = 255;
+                }
+            }
+            return Bitmap::create(width, height, ResourceFormat::RGBA8Unorm, data.data());
+        }
+
+        /** Write a page file with textures of the given sizes.
+        */
+        VirtualTexturePageFile::SharedPtr createPageFile(const std::string& name, const std::vector<uint2>& sizes)
+        {
+            auto pBuilder = VirtualTexturePageFile::Builder::create(getTempPath(name), kPageSize, kBorder, true);
+            if (!pBuilder) return nullptr;
+            for (size_t i = 0; i < sizes.size(); i++)
+            {
+                auto mips = VirtualTexturePageFile::generateMips(*createCoordBitmap(sizes[i].x, sizes[i].y), false);
+                if (pBuilder->addTexture(mips, ResourceFormat::RGBA8Unorm, "texture" + std::to_string(i)) != i) return nullptr;
+            }
+            return pBuilder->finalize();
+        }
+
+        VirtualTextureCache::Trace createTrace(const std::vector<std::vector<uint32_t>>& frames, uint32_t mip = 0)
+        {
+            // Pages are given as indices into the first row of a mip of texture 0.
+            VirtualTextureCache::Trace trace;
+            for (const auto& frame : frames)
+            {
+                std::vector<PageID> pages;
+                for (uint32_t x : frame) pages.push_back({ 0, mip, x, 0 });
+                trace.push_back(pages);
+            }
+            return trace;
+        }
+    }
+
+    CPU_TEST(VirtualTexture_GenerateMips)
+    {
+        const float texels[4 * 2][4] =
+        {
+            { 1.f, 0.f, 0.f, 1.f }, { 3.f, 0.f, 0.f, 1.f }, { 5.f, 0.f, 0.f, 1.f }, { 7.f, 0.f, 0.f, 1.f },
+            { 1.f, 4.f, 0.f, 1.f }, { 3.f, 4.f, 0.f, 1.f }, { 5.f, 4.f, 0.f, 1.f }, { 7.f, 4.f, 0.f, 1.f },
+        };
+        auto pBitmap = Bitmap::create(4, 2, ResourceFormat::RGBA32Float, reinterpret_cast<const uint8_t*>(texels));
+        auto mips = VirtualTexturePageFile::generateMips(*pBitmap, false);
+
+        EXPECT_EQ(mips.size(), 3);
+        EXPECT_EQ(mips[1]->getWidth(), 2);
+        EXPECT_EQ(mips[1]->getHeight(), 1);
+        EXPECT_EQ(mips[2]->getWidth(), 1);
+        const float* pMip1 = reinterpret_cast<const float*>(mips[1]->getData());
+        EXPECT_EQ(pMip1[0], 2.f);
+        EXPECT_EQ(pMip1[1], 2.f);
+        EXPECT_EQ(pMip1[4], 6.f);
+        EXPECT_EQ(reinterpret_cast<const float*>(mips[2]->getData())[0], 4.f);
+
+        // sRGB texels are averaged in linear space.
+        const uint8_t srgbTexels[2][4] = { { 0, 0, 0, 0 }, { 255, 255, 255, 255 } };
+        auto pSrgb = Bitmap::create(2, 1, ResourceFormat::RGBA8Unorm, &srgbTexels[0][0]);
+        auto srgbMips = VirtualTexturePageFile::generateMips(*pSrgb, true);
+        EXPECT_EQ(srgbMips.size(), 2);
+        EXPECT_EQ(srgbMips[1]->getData()[0], 188);
+        EXPECT_EQ(srgbMips[1]->getData()[3], 128);
+        EXPECT_EQ(VirtualTexturePageFile::generateMips(*pSrgb, false)[1]->getData()[0], 128);
+
+        EXPECT(VirtualTexturePageFile::generateMips(*Bitmap::create(4, 4, ResourceFormat::BC1Unorm, nullptr), false).empty());
+    }
+
+    CPU_TEST(VirtualTexture_PageFile)
+    {
+        const uint32_t width = 300, height = 200;
+        auto pPageFile = createPageFile("falcor_vt_pagefile.vtpf", { uint2(width, height), uint2(16, 16) });
+        EXPECT(pPageFile != nullptr);
+        if (!pPageFile) return;
+
+        EXPECT_EQ(pPageFile->getTextureCount(), 2);
+        EXPECT_EQ(pPageFile->findTexture("texture1"), 1);
+        EXPECT_EQ(pPageFile->findTexture("missing"), VirtualTexturePageFile::kInvalidTexture);
+
+        // 300x200, 150x100, 75x50 and 37x25 texels, where the last fits into a single page.
+        const auto& desc = pPageFile->getTexture(0);
+        EXPECT_EQ(desc.mipCount, 4);
+        EXPECT_EQ(desc.pageCount, 5 * 4 + 3 * 2 + 2 * 1 + 1);
+        EXPECT_EQ(pPageFile->getTexture(1).mipCount, 1);
+        EXPECT_EQ(pPageFile->getTexture(1).pageCount, 1);
+        EXPECT(pPageFile->getPageCount(0, 1) == uint2(3, 2));
+        EXPECT(!pPageFile->isValidPage({ 0, 1, 3, 0 }));
+        EXPECT(!pPageFile->isValidPage({ 0, 4, 0, 0 }));
+
+        // Check that every texel of the base mip pages, including the borders, matches the wrapped source texel.
+        const uint32_t paddedSize = pPageFile->getPaddedPageSize();
+        std::vector<uint8_t> page(desc.pageBytes);
+        uint32_t errors = 0;
+        for (uint32_t py = 0; py < 4; py++)
+        {
+            for (uint32_t px = 0; px < 5; px++)
+            {
+                EXPECT(pPageFile->readPage({ 0, 0, px, py }, page.data()));
+                for (uint32_t r = 0; r < paddedSize; r++)
+                {
+                    for (uint32_t c = 0; c < paddedSize; c++)
+                    {
+                        const uint32_t x = (px * kPageSize + c + width - kBorder) % width;
+                        const uint32_t y = (py * kPageSize + r + height - kBorder) % height;
+                        const uint8_t* p = &page[(r * paddedSize + c) * 4];
+                        if (p[0] != (x & 0xff) || p[1] != (y & 0xff) || p[2] != ((x >> 8) | ((y >> 8) << 4))) errors++;
+                    }
+                }
+            }
+        }
+        EXPECT_EQ(errors, 0);
+
+        // Check a page of a coarser mip against the generated mip chain.
+        auto mips = VirtualTexturePageFile::generateMips(*createCoordBitmap(width, height), false);
+        EXPECT(pPageFile->readPage({ 0, 2, 1, 0 }, page.data()));
+        const uint8_t* pInterior = &page[(kBorder * paddedSize + kBorder) * 4];
+        EXPECT_EQ(std::memcmp(pInterior, mips[2]->getData() + kPageSize * 4, 4), 0);
+
+        // Reopen the file and compare the directory.
+        auto pReopened = VirtualTexturePageFile::open(pPageFile->getFilename());
+        EXPECT(pReopened != nullptr);
+        if (pReopened)
+        {
+            EXPECT_EQ(pReopened->getTextureCount(), 2);
+            EXPECT_EQ(pReopened->getTexture(0).pageCount, desc.pageCount);
+            EXPECT_EQ(pReopened->getTexture(0).dataOffset, desc.dataOffset);
+            EXPECT(pReopened->getTexture(0).format == ResourceFormat::RGBA8Unorm);
+        }
+    }
+
+    CPU_TEST(VirtualTexture_PageTable)
+    {
+        auto pPageFile = createPageFile("falcor_vt_pagetable.vtpf", { uint2(512, 256) });
+        if (!pPageFile) { EXPECT(false); return; }
+
+        VirtualTextureCache::Desc desc;
+        desc.physicalPageCount = 16;
+        auto pCache = VirtualTextureCache::create(pPageFile, desc);
+        EXPECT(pCache != nullptr);
+        if (!pCache) return;
+
+        // Mips are 8x4, 4x2, 2x1 and 1x1 pages. Initially only the coarsest mip is resident.
+        const uint32_t coarsestSlot = pCache->getSlot({ 0, 3, 0, 0 });
+        EXPECT_NE(coarsestSlot, VirtualTextureCache::kInvalidSlot);
+        EXPECT_EQ(pCache->getPageUpdates().size(), 1);
+        const uint32_t coarsestEntry = coarsestSlot | (3 << 24);
+        for (uint32_t mip = 0; mip < 4; mip++)
+        {
+            uint2 pageCount = pPageFile->getPageCount(0, mip);
+            const uint32_t* pTable = pCache->getPageTable(0, mip);
+            for (uint32_t i = 0; i < pageCount.x * pageCount.y; i++) EXPECT_EQ(pTable[i], coarsestEntry);
+        }
+
+        // Load a page of mip 1. The pages of mip 0 it covers resolve to it, the others still to the coarsest mip.
+        pCache->requestPages({ { 0, 1, 2, 1 } });
+        pCache->update(true);
+        const uint32_t slot = pCache->getSlot({ 0, 1, 2, 1 });
+        EXPECT_NE(slot, VirtualTextureCache::kInvalidSlot);
+        EXPECT_EQ(pCache->getPageUpdates().size(), 1);
+        EXPECT(pCache->getPageUpdates()[0].page == PageID({ 0, 1, 2, 1 }));
+
+        const uint32_t* pTable = pCache->getPageTable(0, 0);
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            for (uint32_t x = 0; x < 8; x++)
+            {
+                const bool covered = x / 2 == 2 && y / 2 == 1;
+                EXPECT_EQ(pTable[y * 8 + x], covered ? (slot | (1 << 24)) : coarsestEntry) << "x=" << x << " y=" << y;
+            }
+        }
+        EXPECT_EQ(VirtualTextureCache::getEntrySlot(pCache->getPageTableEntry({ 0, 0, 5, 3 })), slot);
+        EXPECT_EQ(VirtualTextureCache::getEntryMip(pCache->getPageTableEntry({ 0, 0, 5, 3 })), 1);
+        EXPECT_EQ(pCache->getPageTableEntry({ 0, 2, 1, 0 }), coarsestEntry);
+
+        // The physical page holds the page data.
+        std::vector<uint8_t> page(pPageFile->getTexture(0).pageBytes);
+        EXPECT(pPageFile->readPage({ 0, 1, 2, 1 }, page.data()));
+        EXPECT_EQ(std::memcmp(pCache->getSlotData(slot), page.data(), page.size()), 0);
+    }
+
+    CPU_TEST(VirtualTexture_LRU)
+    {
+        auto pPageFile = createPageFile("falcor_vt_lru.vtpf", { uint2(1024, 64) });
+        if (!pPageFile) { EXPECT(false); return; }
+
+        // One physical page for the coarsest mip and three for the base mip pages.
+        VirtualTextureCache::Desc desc;
+        desc.physicalPageCount = 4;
+        auto pCache = VirtualTextureCache::create(pPageFile, desc);
+        if (!pCache) { EXPECT(false); return; }
+
+        auto stats = pCache->replayTrace(createTrace({ { 0 }, { 1 }, { 2 }, { 0 }, { 3 } }));
+        EXPECT_EQ(stats.frames, 5);
+        EXPECT_EQ(stats.requests, 5);
+        EXPECT_EQ(stats.hits, 1);
+        EXPECT_EQ(stats.misses, 4);
+        EXPECT_EQ(stats.pagesLoaded, 4);
+        EXPECT_EQ(stats.pagesEvicted, 1);
+        EXPECT_EQ(stats.residentPages, 4);
+
+        // Page 1 was the least recently requested page.
+        EXPECT(!pCache->isResident({ 0, 0, 1, 0 }));
+        EXPECT(pCache->isResident({ 0, 0, 0, 0 }));
+        EXPECT(pCache->isResident({ 0, 0, 2, 0 }));
+        EXPECT(pCache->isResident({ 0, 0, 3, 0 }));
+        EXPECT(pCache->isResident({ 0, 4, 0, 0 }));
+
+        // Requesting more pages than fit defers the rest, and pages requested in the same frame are never evicted.
+        stats = pCache->replayTrace(createTrace({ { 4, 5, 6, 7, 8 }, { 4, 5, 6, 7, 8 } }));
+        EXPECT_EQ(stats.requests, 10);
+        EXPECT_EQ(stats.pagesLoaded, 3);
+        EXPECT_EQ(stats.pagesEvicted, 3);
+        EXPECT_EQ(stats.loadsDeferred, 4);
+        EXPECT_EQ(stats.hits, 3);
+        EXPECT(pCache->isResident({ 0, 0, 4, 0 }));
+        EXPECT(pCache->isResident({ 0, 0, 6, 0 }));
+        EXPECT(!pCache->isResident({ 0, 0, 7, 0 }));
+
+        // Coarse mips are loaded first.
+        desc.maxLoadsPerUpdate = 1;
+        pCache = VirtualTextureCache::create(pPageFile, desc);
+        pCache->requestPages({ { 0, 0, 9, 0 }, { 0, 2, 1, 0 } });
+        pCache->update(true);
+        EXPECT(pCache->isResident({ 0, 2, 1, 0 }));
+        EXPECT(!pCache->isResident({ 0, 0, 9, 0 }));
+        EXPECT_EQ(pCache->getStats().loadsDeferred, 1);
+    }
+
+    CPU_TEST(VirtualTexture_Trace)
+    {
+        auto pPageFile = createPageFile("falcor_vt_trace.vtpf", { uint2(1024, 1024), uint2(256, 128) });
+        if (!pPageFile) { EXPECT(false); return; }
+
+        // Record a trace of a camera panning over the base mip, with coarser mips in the distance.
+        VirtualTextureCache::Desc desc;
+        desc.physicalPageCount = 24;
+        auto pCache = VirtualTextureCache::create(pPageFile, desc);
+        if (!pCache) { EXPECT(false); return; }
+
+        pCache->setTraceRecording(true);
+        for (uint32_t frame = 0; frame < 32; frame++)
+        {
+            std::vector<PageID> pages;
+            for (uint32_t y = 0; y < 4; y++)
+            {
+                for (uint32_t x = 0; x < 4; x++) pages.push_back({ 0, 0, (frame / 4 + x) % 16, y });
+            }
+            pages.push_back({ 0, 1, frame % 8, 7 });
+            pages.push_back({ 0, 1, frame % 8, 7 }); // Duplicates count once.
+            pages.push_back({ 1, 0, frame % 4, 0 });
+            pages.push_back({ 0, 0, 16, 0 }); // Invalid pages are ignored.
+            pCache->requestPages(pages);
+            pCache->update(true);
+        }
+        pCache->setTraceRecording(false);
+        const auto& trace = pCache->getRecordedTrace();
+        EXPECT_EQ(trace.size(), 32);
+        EXPECT_EQ(trace[0].size(), 18);
+
+        // Save and load the trace.
+        const std::string path = getTempPath("falcor_vt_trace.txt");
+        EXPECT(VirtualTextureCache::saveTrace(path, trace));
+        VirtualTextureCache::Trace loaded;
+        EXPECT(VirtualTextureCache::loadTrace(path, loaded));
+        std::filesystem::remove(path);
+        EXPECT(loaded == trace);
+
+        // Replaying the trace on new caches gives the same results.
+        auto pCache1 = VirtualTextureCache::create(pPageFile, desc);
+        auto pCache2 = VirtualTextureCache::create(pPageFile, desc);
+        auto stats1 = pCache1->replayTrace(loaded);
+        auto stats2 = pCache2->replayTrace(loaded);
+        EXPECT_EQ(stats1.requests, 32 * 18);
+        EXPECT_EQ(stats1.hits + stats1.misses, stats1.requests);
+        EXPECT_GT(stats1.hits, 0);
+        EXPECT_GT(stats1.pagesEvicted, 0);
+        EXPECT_EQ(stats1.hits, stats2.hits);
+        EXPECT_EQ(stats1.pagesLoaded, stats2.pagesLoaded);
+        EXPECT_EQ(stats1.pagesEvicted, stats2.pagesEvicted);
+        for (uint32_t mip = 0; mip < 3; mip++)
+        {
+            uint2 pageCount = pPageFile->getPageCount(0, mip);
+            EXPECT_EQ(std::memcmp(pCache1->getPageTable(0, mip), pCache2->getPageTable(0, mip), pageCount.x * pageCount.y * sizeof(uint32_t)), 0);
+        }
+
+        // A larger budget gives a higher hit rate.
+        desc.physicalPageCount = 64;
+        auto stats3 = VirtualTextureCache::create(pPageFile, desc)->replayTrace(loaded);
+        EXPECT_GT(stats3.getHitRate(), stats1.getHitRate());
+    }
+
+    CPU_TEST(VirtualTexture_AsyncLoads)
+    {
+        auto pPageFile = createPageFile("falcor_vt_async.vtpf", { uint2(1024, 1024) });
+        if (!pPageFile) { EXPECT(false); return; }
+
+        VirtualTextureCache::Desc desc;
+        desc.physicalPageCount = 128;
+        desc.threadCount = 4;
+        auto pCache = VirtualTextureCache::create(pPageFile, desc);
+        if (!pCache) { EXPECT(false); return; }
+
+        std::vector<PageID> pages;
+        for (uint32_t y = 0; y < 8; y++)
+        {
+            for (uint32_t x = 0; x < 8; x++) pages.push_back({ 0, 0, x, y });
+        }
+
+        // Keep requesting the pages without waiting, until all are resident.
+        uint32_t updates = 0;
+        for (uint32_t frame = 0; frame < 1000; frame++)
+        {
+            pCache->requestPages(pages);
+            pCache->update();
+            updates += (uint32_t)pCache->getPageUpdates().size();
+            if (pCache->getStats().residentPages == 1 + pages.size()) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        EXPECT_EQ(updates, pages.size());
+        EXPECT_EQ(pCache->getStats().pagesLoaded, pages.size());
+        EXPECT_EQ(pCache->getStats().pendingPages, 0);
+
+        std::vector<uint8_t> page(pPageFile->getTexture(0).pageBytes);
+        for (const auto& p : pages)
+        {
+            EXPECT(pPageFile->readPage(p, page.data()));
+            EXPECT_EQ(std::memcmp(pCache->getSlotData(pCache->getSlot(p)), page.data(), page.size()), 0);
+        }
+    }
+}
@@ -0,0 +1,154 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/MeshSimplifier.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Create a grid of size x size quads in the xz-plane with a height function. If 'seam' is set, the vertices of the
+            middle column are duplicated, as for a UV seam, and the right half of the grid uses the duplicates.
+        */
+        void createGrid(uint32_t size, bool seam, std::function<float(float, float)> height, std::vector<float3>& positions, std::vector<uint32_t>& indices)
+        {
+            const uint32_t n = size + 1;
+            const uint32_t mid = size / 2;
+            for (uint32_t y = 0; y < n; y++)
+            {
+                for (uint32_t x = 0; x < n; x++) positions.push_back(float3(x, height((float)x, (float)y), y) / (float)size);
+            }
+            std::vector<uint32_t> seamVertex(n);
+            for (uint32_t y = 0; y < n; y++)
+            {
+                seamVertex[y] = y * n + mid;
+                if (seam)
+                {
+                    seamVertex[y] = (uint32_t)positions.size();
+                    positions.push_back(positions[y * n + mid]);
+                }
+            }
+
+            auto vertex = [&](uint32_t x, uint32_t y, bool rightHalf) { return rightHalf && x == mid ? seamVertex[y] : y * n + x; };
+            for (uint32_t y = 0; y < size; y++)
+            {
+                for (uint32_t x = 0; x < size; x++)
+                {
+                    bool right = x >= mid;
+                    uint32_t v00 = vertex(x, y, right), v10 = vertex(x + 1, y, right), v01 = vertex(x, y + 1, right), v11 = vertex(x + 1, y + 1, right);
+                    for (uint32_t i : { v00, v01, v10, v10, v01, v11 }) indices.push_back(i);
+                }
+            }
+        }
+
+        float3 getNormal(const std::vector<float3>& positions, const uint32_t* t)
+        {
+            return glm::cross(positions[t[1]] - positions[t[0]], positions[t[2]] - positions[t[0]]);
+        }
+    }
+
+    CPU_TEST(MeshSimplifier_FlatGrid)
+    {
+        std::vector<float3> positions;
+        std::vector<uint32_t> indices;
+        createGrid(32, false, [](float, float) { return 0.f; }, positions, indices);
+
+        auto result = MeshSimplifier::simplify(positions.data(), positions.size(), indices, indices.size() / 8, 1e-3f);
+        EXPECT_LE(result.indices.size(), indices.size() / 4);
+        EXPECT_LE(result.error, 1e-5f);
+
+        // The area and orientation are preserved, and the border is untouched.
+        float area = 0.f;
+        std::set<uint32_t> used(result.indices.begin(), result.indices.end());
+        for (size_t i = 0; i < result.indices.size(); i += 3)
+        {
+            float3 n = getNormal(positions, &result.indices[i]);
+            EXPECT_GT(n.y, 0.f);
+            area += glm::length(n) * 0.5f;
+        }
+        EXPECT_LE(std::abs(area - 1.f), 1e-4f);
+        for (uint32_t v = 0; v < positions.size(); v++)
+        {
+            const float3& p = positions[v];
+            if (p.x == 0.f || p.x == 1.f || p.z == 0.f || p.z == 1.f) EXPECT(used.count(v) == 1) << "border vertex " << v << " was removed";
+        }
+    }
+
+    CPU_TEST(MeshSimplifier_PreservesSeams)
+    {
+        std::vector<float3> positions;
+        std::vector<uint32_t> indices;
+        createGrid(32, true, [](float x, float y) { return 0.1f * std::sin(x * 0.3f) * std::cos(y * 0.2f); }, positions, indices);
+        const uint32_t seamStart = 33 * 33;
+
+        auto result = MeshSimplifier::simplify(positions.data(), positions.size(), indices, indices.size() / 4, 1.f);
+        EXPECT_LT(result.indices.size(), indices.size() / 2);
+
+        // Every seam vertex is kept on both sides, and triangles never mix the two sides of the seam.
+        std::set<uint32_t> used(result.indices.begin(), result.indices.end());
+        for (uint32_t y = 0; y <= 32; y++)
+        {
+            EXPECT(used.count(y * 33 + 16) == 1);
+            EXPECT(used.count(seamStart + y) == 1);
+        }
+        for (size_t i = 0; i < result.indices.size(); i += 3)
+        {
+            bool hasLeft = false, hasRight = false;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint32_t v = result.indices[i + k];
+                const float x = positions[v].x * 32.f;
+                if (v >= seamStart || x > 16.5f) hasRight = true;
+                if ((v < seamStart && x == 16.f) || x < 15.5f) hasLeft = true;
+            }
+            EXPECT(!(hasLeft && hasRight));
+        }
+    }
+
+    CPU_TEST(MeshSimplifier_ErrorBound)
+    {
+        std::vector<float3> positions;
+        std::vector<uint32_t> indices;
+        createGrid(48, false, [](float x, float y) { return 0.2f * std::sin(x * 0.25f) * std::sin(y * 0.25f) * 48.f; }, positions, indices);
+
+        // A tighter error bound must stop earlier with a smaller error.
+        auto coarse = MeshSimplifier::simplify(positions.data(), positions.size(), indices, 0, 0.05f);
+        auto fine = MeshSimplifier::simplify(positions.data(), positions.size(), indices, 0, 0.005f);
+        EXPECT_LE(coarse.error, 0.05f);
+        EXPECT_LE(fine.error, 0.005f);
+        EXPECT_LT(coarse.indices.size(), fine.indices.size());
+        EXPECT_LT(fine.indices.size(), indices.size());
+
+        // No triangle flips relative to the up-facing surface.
+        for (size_t i = 0; i < coarse.indices.size(); i += 3) EXPECT_GT(getNormal(positions, &coarse.indices[i]).y, 0.f);
+
+        // A zero error bound on a curved surface only allows collapses of exactly coplanar vertices.
+        auto none = MeshSimplifier::simplify(positions.data(), positions.size(), indices, 0, 0.f);
+        EXPECT_LE(none.error, 1e-6f);
+    }
+}
@@ -0,0 +1,276 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneMeshlets.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        std::mt19937 rng;
+        auto dist = std::uniform_real_distribution<float>();
+        float3 randomFloat3() { return float3(dist(rng), dist(rng), dist(rng)); }
+
+        /** Create an indexed UV sphere (mesh 0) and a non-indexed soup of random triangles (mesh 1).
+        */
+        SceneMeshlets::Geometry createGeometry()
+        {
+            SceneMeshlets::Geometry g;
+
+            const uint32_t rings = 24, segments = 48;
+            for (uint32_t r = 0; r <= rings; r++)
+            {
+                for (uint32_t s = 0; s <= segments; s++)
+                {
+                    float theta = (float)M_PI * r / rings, phi = 2.f * (float)M_PI * s / segments;
+                    g.positions.push_back(float3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+                }
+            }
+            for (uint32_t r = 0; r < rings; r++)
+            {
+                for (uint32_t s = 0; s < segments; s++)
+                {
+                    uint32_t v = r * (segments + 1) + s;
+                    for (uint32_t i : { v, v + 1, v + segments + 1, v + 1, v + segments + 2, v + segments + 1 }) g.indices.push_back(i);
+                }
+            }
+
+            SceneMeshlets::Geometry::Mesh sphere;
+            sphere.vertexCount = (uint32_t)g.positions.size();
+            sphere.triangleCount = (uint32_t)g.indices.size() / 3;
+            g.meshes.push_back(sphere);
+
+            SceneMeshlets::Geometry::Mesh soup;
+            soup.vertexOffset = (uint32_t)g.positions.size();
+            soup.triangleCount = 500;
+            soup.isIndexed = false;
+            for (uint32_t t = 0; t < soup.triangleCount; t++)
+            {
+                float3 p = randomFloat3() * 4.f - 2.f;
+                for (uint32_t k = 0; k < 3; k++) g.positions.push_back(p + randomFloat3() * 0.2f);
+            }
+            g.meshes.push_back(soup);
+
+            return g;
+        }
+
+        float3 getPosition(const SceneMeshlets::Geometry& g, uint32_t meshID, uint32_t vertex)
+        {
+            return g.positions[g.meshes[meshID].vertexOffset + vertex];
+        }
+
+        bool isTriangleBackfacing(const float3 p[3], const float3& viewPos)
+        {
+            float3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+            return glm::dot(n, viewPos - p[0]) <= 0.f;
+        }
+    }
+
+    CPU_TEST(SceneMeshlets_Partition)
+    {
+        rng.seed(1);
+        SceneMeshlets::Geometry g = createGeometry();
+        SceneMeshlets::Options options;
+        options.maxVertices = 64;
+        options.maxTriangles = 96;
+        SceneMeshlets::SharedPtr pMeshlets = SceneMeshlets::create(g, options);
+
+        const auto& stats = pMeshlets->getStats();
+        EXPECT_EQ(stats.meshCount, 2u);
+        EXPECT_EQ(stats.triangleCount, (uint64_t)(g.meshes[0].triangleCount + g.meshes[1].triangleCount));
+        EXPECT_EQ(stats.meshletCount, (uint64_t)pMeshlets->getMeshlets().size());
+
+        for (uint32_t meshID = 0; meshID < 2; meshID++)
+        {
+            const auto& mesh = g.meshes[meshID];
+            const auto& range = pMeshlets->getMeshRange(meshID);
+            EXPECT_GE(range.meshletCount, (mesh.triangleCount + options.maxTriangles - 1) / options.maxTriangles);
+
+            // Every triangle must appear exactly once with its original winding.
+            std::map<std::tuple<uint32_t, uint32_t, uint32_t>, uint32_t> triangles;
+            for (uint32_t t = 0; t < mesh.triangleCount; t++)
+            {
+                uint32_t v[3];
+                for (uint32_t k = 0; k < 3; k++) v[k] = mesh.isIndexed ? g.indices[mesh.indexOffset + 3 * t + k] : 3 * t + k;
+                triangles[{ v[0], v[1], v[2] }]++;
+            }
+
+            for (uint32_t i = range.meshletOffset; i < range.meshletOffset + range.meshletCount; i++)
+            {
+                const auto& meshlet = pMeshlets->getMeshlet(i);
+                EXPECT_EQ(meshlet.meshID, meshID);
+                EXPECT_LE(meshlet.vertexCount, options.maxVertices);
+                EXPECT_LE(meshlet.triangleCount, options.maxTriangles);
+                EXPECT_GE(meshlet.triangleCount, 1u);
+
+                for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+                {
+                    float3 p = getPosition(g, meshID, pMeshlets->getVertices()[meshlet.vertexOffset + v]);
+                    EXPECT_LE(glm::length(p - meshlet.center), meshlet.radius * 1.0001f + 1e-6f);
+                }
+                for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+                {
+                    uint3 local = SceneMeshlets::unpackTriangle(pMeshlets->getTriangles()[meshlet.triangleOffset + t]);
+                    EXPECT(local.x < meshlet.vertexCount && local.y < meshlet.vertexCount && local.z < meshlet.vertexCount);
+                    const uint32_t* vertices = pMeshlets->getVertices().data() + meshlet.vertexOffset;
+                    triangles[{ vertices[local.x], vertices[local.y], vertices[local.z] }]--;
+                }
+            }
+
+            for (const auto& it : triangles) EXPECT_EQ(it.second, 0u);
+        }
+
+        // The sphere is connected, so the meshlets should be close to full.
+        const auto& sphereRange = pMeshlets->getMeshRange(0);
+        EXPECT_LE(sphereRange.meshletCount, 2 * g.meshes[0].triangleCount / options.maxTriangles + 1);
+    }
+
+    CPU_TEST(SceneMeshlets_ConeIsConservative)
+    {
+        rng.seed(2);
+        SceneMeshlets::Geometry g = createGeometry();
+        SceneMeshlets::SharedPtr pMeshlets = SceneMeshlets::create(g);
+
+        // Clockwise front faces turn the sphere inside out.
+        g.meshes[0].isFrontFaceCW = true;
+        SceneMeshlets::SharedPtr pFlipped = SceneMeshlets::create(g);
+
+        uint32_t culledCount = 0, cullableCount = 0, meshletCount = 0;
+        for (const auto& p : { pMeshlets, pFlipped })
+        {
+            bool isFrontFaceCW = p == pFlipped;
+            const auto& range = p->getMeshRange(0);
+            for (uint32_t i = range.meshletOffset; i < range.meshletOffset + range.meshletCount; i++)
+            {
+                const auto& meshlet = p->getMeshlet(i);
+                if (meshlet.coneCutoff < 1.f) cullableCount++;
+                meshletCount++;
+
+                for (uint32_t j = 0; j < 100; j++)
+                {
+                    float3 viewPos = randomFloat3() * 8.f - 4.f;
+                    if (!SceneMeshlets::isBackfacing(meshlet, viewPos)) continue;
+                    culledCount++;
+
+                    // All triangles of a culled meshlet must be backfacing.
+                    for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+                    {
+                        uint3 local = SceneMeshlets::unpackTriangle(p->getTriangles()[meshlet.triangleOffset + t]);
+                        const uint32_t* vertices = p->getVertices().data() + meshlet.vertexOffset;
+                        float3 v[3] = { getPosition(g, 0, vertices[local.x]), getPosition(g, 0, vertices[local.y]), getPosition(g, 0, vertices[local.z]) };
+                        if (isFrontFaceCW) std::swap(v[1], v[2]);
+                        EXPECT(isTriangleBackfacing(v, viewPos));
+                    }
+                }
+            }
+        }
+        EXPECT_GT(culledCount, 0u);
+        EXPECT_GT(cullableCount, meshletCount / 2);
+    }
+
+    CPU_TEST(SceneMeshlets_Cull)
+    {
+        rng.seed(3);
+        SceneMeshlets::Geometry g = createGeometry();
+        SceneMeshlets::SharedPtr pMeshlets = SceneMeshlets::create(g);
+        const auto& range = pMeshlets->getMeshRange(0);
+
+        // An identity view-projection gives the frustum [-1,1] x [-1,1] x [0,1].
+        // Moving the unit sphere far away culls everything against the frustum.
+        glm::mat4 far = glm::translate(glm::mat4(1.f), float3(10.f, 0.f, 0.f));
+        auto stats = pMeshlets->cull(0, far, glm::mat4(1.f), float3(0.f, 0.f, -5.f));
+        EXPECT_EQ(stats.testedCount, (uint64_t)range.meshletCount);
+        EXPECT_EQ(stats.frustumCulledCount, (uint64_t)range.meshletCount);
+
+        // Inside the frustum with a distant viewer on the -z axis, part of the back half of the sphere is cone culled
+        // while the front half is visible.
+        glm::mat4 inside = glm::scale(glm::translate(glm::mat4(1.f), float3(0.f, 0.f, 0.5f)), float3(0.4f));
+        std::vector<uint32_t> visible;
+        stats = pMeshlets->cull(0, inside, glm::mat4(1.f), float3(0.f, 0.f, -100.f), &visible);
+        EXPECT_EQ(stats.frustumCulledCount, 0u);
+        EXPECT_GT(stats.coneCulledCount, 0u);
+        EXPECT_EQ(visible.size(), (size_t)(stats.testedCount - stats.coneCulledCount));
+
+        std::set<uint32_t> visibleSet(visible.begin(), visible.end());
+        for (uint32_t i = range.meshletOffset; i < range.meshletOffset + range.meshletCount; i++)
+        {
+            const auto& meshlet = pMeshlets->getMeshlet(i);
+            if (meshlet.center.z < -0.1f) EXPECT(visibleSet.count(i) == 1);
+            if (meshlet.center.z > 0.5f && meshlet.coneCutoff < 0.5f) EXPECT(visibleSet.count(i) == 0);
+        }
+    }
+
+    CPU_TEST(SceneMeshlets_CullMirrored)
+    {
+        rng.seed(4);
+        SceneMeshlets::Geometry g = createGeometry();
+        SceneMeshlets::SharedPtr pMeshlets = SceneMeshlets::create(g);
+        const auto& range = pMeshlets->getMeshRange(0);
+
+        // A mirrored instance of the sphere. The scene flips the front face winding of instances whose transform has
+        // a negative determinant, so in world space a triangle is front facing if its transformed winding, flipped, faces the viewer.
+        const glm::mat4 mirrored = glm::scale(glm::translate(glm::mat4(1.f), float3(0.f, 0.f, 0.5f)), float3(-0.4f, 0.4f, 0.4f));
+        EXPECT(glm::determinant(glm::mat3(mirrored)) < 0.f);
+
+        uint64_t coneCulledCount = 0;
+        for (uint32_t j = 0; j < 20; j++)
+        {
+            const float3 viewPos = glm::normalize(randomFloat3() * 2.f - 1.f) * 5.f;
+            std::vector<uint32_t> visible;
+            auto stats = pMeshlets->cull(0, mirrored, glm::mat4(1.f), viewPos, &visible);
+            coneCulledCount += stats.coneCulledCount;
+
+            // No meshlet with a front facing triangle may be culled.
+            std::set<uint32_t> visibleSet(visible.begin(), visible.end());
+            for (uint32_t i = range.meshletOffset; i < range.meshletOffset + range.meshletCount; i++)
+            {
+                const auto& meshlet = pMeshlets->getMeshlet(i);
+                if (visibleSet.count(i) || meshlet.coneCutoff >= 1.f) continue;
+
+                for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+                {
+                    uint3 local = SceneMeshlets::unpackTriangle(pMeshlets->getTriangles()[meshlet.triangleOffset + t]);
+                    const uint32_t* vertices = pMeshlets->getVertices().data() + meshlet.vertexOffset;
+                    float3 v[3];
+                    for (uint32_t k = 0; k < 3; k++) v[k] = float3(mirrored * float4(getPosition(g, 0, vertices[local[k]]), 1.f));
+                    std::swap(v[1], v[2]);
+                    EXPECT(isTriangleBackfacing(v, viewPos));
+                }
+            }
+
+            // The half of the sphere facing the viewer is visible.
+            for (uint32_t i = range.meshletOffset; i < range.meshletOffset + range.meshletCount; i++)
+            {
+                const float3 center = float3(mirrored * float4(pMeshlets->getMeshlet(i).center, 1.f));
+                if (glm::dot(center - float3(0.f, 0.f, 0.5f), glm::normalize(viewPos)) > 0.2f) EXPECT(visibleSet.count(i) == 1);
+            }
+        }
+        EXPECT_GT(coneCulledCount, 0u);
+    }
+}
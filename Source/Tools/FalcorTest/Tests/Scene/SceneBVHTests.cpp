@@ -0,0 +1,322 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneBVH.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        std::mt19937 rng;
+        auto dist = std::uniform_real_distribution<float>();
+        float3 randomFloat3() { return float3(dist(rng), dist(rng), dist(rng)); }
+
+        /** Create a synthetic scene with an indexed height field mesh and a non-indexed mesh of random triangles,
+            instanced several times with random transforms.
+        */
+        SceneBVH::Geometry createGeometry(uint32_t triangleCount)
+        {
+            SceneBVH::Geometry g;
+
+            // Mesh 0: indexed, a bumpy height field grid.
+            const uint32_t gridSize = std::max(2u, (uint32_t)std::sqrt(triangleCount / 2.f) + 1);
+            for (uint32_t y = 0; y < gridSize; y++)
+            {
+                for (uint32_t x = 0; x < gridSize; x++)
+                {
+                    float2 uv = float2(x, y) / float(gridSize - 1);
+                    g.positions.push_back(float3(uv.x * 4.f - 2.f, dist(rng) * 0.5f, uv.y * 4.f - 2.f));
+                }
+            }
+            for (uint32_t y = 0; y + 1 < gridSize; y++)
+            {
+                for (uint32_t x = 0; x + 1 < gridSize; x++)
+                {
+                    uint32_t v = y * gridSize + x;
+                    for (uint32_t i : { v, v + 1, v + gridSize, v + 1, v + gridSize + 1, v + gridSize }) g.indices.push_back(i);
+                }
+            }
+
+            SceneBVH::Geometry::Mesh indexed;
+            indexed.vertexOffset = 0;
+            indexed.indexOffset = 0;
+            indexed.triangleCount = (uint32_t)g.indices.size() / 3;
+            indexed.isIndexed = true;
+            g.meshes.push_back(indexed);
+
+            // Mesh 1: non-indexed, small triangles.
+            SceneBVH::Geometry::Mesh nonIndexed;
+            nonIndexed.vertexOffset = (uint32_t)g.positions.size();
+            nonIndexed.triangleCount = triangleCount;
+            nonIndexed.isIndexed = false;
+            for (uint32_t t = 0; t < triangleCount; t++)
+            {
+                float3 p = randomFloat3() * 4.f - 2.f;
+                for (uint32_t k = 0; k < 3; k++) g.positions.push_back(p + (randomFloat3() * 0.5f - 0.25f) / std::cbrt((float)triangleCount / 100.f));
+            }
+            g.meshes.push_back(nonIndexed);
+
+            for (uint32_t i = 0; i < 6; i++) g.instances.push_back({ i % 2, i });
+            return g;
+        }
+
+        std::vector<glm::mat4> createMatrices(uint32_t count)
+        {
+            std::vector<glm::mat4> matrices;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                glm::mat4 m = glm::translate(glm::mat4(1.f), randomFloat3() * 10.f - 5.f);
+                m = glm::rotate(m, dist(rng) * 6.28f, glm::normalize(randomFloat3() + 0.1f));
+                m = glm::scale(m, float3(0.5f) + randomFloat3());
+                matrices.push_back(m);
+            }
+            return matrices;
+        }
+
+        std::vector<SceneBVH::Ray> createRays(uint32_t count)
+        {
+            std::vector<SceneBVH::Ray> rays(count);
+            for (auto& ray : rays)
+            {
+                ray.origin = randomFloat3() * 20.f - 10.f;
+                float3 target = randomFloat3() * 8.f - 4.f;
+                ray.dir = glm::normalize(target - ray.origin);
+                ray.tMax = dist(rng) < 0.25f ? 10.f : std::numeric_limits<float>::infinity();
+            }
+            return rays;
+        }
+
+        /** Reference intersection of a ray with a world-space triangle.
+        */
+        bool intersectReference(const float3 p[3], const SceneBVH::Ray& ray, float& t)
+        {
+            const float3 e1 = p[1] - p[0];
+            const float3 e2 = p[2] - p[0];
+            const float3 pvec = glm::cross(ray.dir, e2);
+            const float det = glm::dot(e1, pvec);
+            if (det == 0.f) return false;
+            const float3 tvec = ray.origin - p[0];
+            const float u = glm::dot(tvec, pvec) / det;
+            const float3 qvec = glm::cross(tvec, e1);
+            const float v = glm::dot(ray.dir, qvec) / det;
+            t = glm::dot(e2, qvec) / det;
+            return u >= 0.f && v >= 0.f && u + v <= 1.f && t >= ray.tMin && t <= ray.tMax;
+        }
+
+        void getWorldTriangle(const SceneBVH::Geometry& g, const std::vector<glm::mat4>& matrices, uint32_t instanceID, uint32_t triangleIndex, float3 p[3])
+        {
+            const auto& instance = g.instances[instanceID];
+            const auto& mesh = g.meshes[instance.meshID];
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t v = mesh.isIndexed ? g.indices[mesh.indexOffset + 3 * triangleIndex + k] : 3 * triangleIndex + k;
+                p[k] = float3(matrices[instance.matrixID] * float4(g.positions[mesh.vertexOffset + v], 1.f));
+            }
+        }
+
+        /** Brute force closest hit distance, or infinity if there is no hit.
+        */
+        float closestHitReference(const SceneBVH::Geometry& g, const std::vector<glm::mat4>& matrices, const SceneBVH::Ray& ray)
+        {
+            float closest = std::numeric_limits<float>::infinity();
+            for (uint32_t instanceID = 0; instanceID < g.instances.size(); instanceID++)
+            {
+                const auto& mesh = g.meshes[g.instances[instanceID].meshID];
+                for (uint32_t t = 0; t < mesh.triangleCount; t++)
+                {
+                    float3 p[3];
+                    getWorldTriangle(g, matrices, instanceID, t, p);
+                    float hitT;
+                    if (intersectReference(p, ray, hitT)) closest = std::min(closest, hitT);
+                }
+            }
+            return closest;
+        }
+
+        bool isClose(float a, float b)
+        {
+            return std::abs(a - b) <= 1e-3f * std::max(1.f, std::abs(b));
+        }
+
+        void verifyClosestHits(CPUUnitTestContext& ctx, const SceneBVH& bvh, const SceneBVH::Geometry& g, const std::vector<glm::mat4>& matrices, const std::vector<SceneBVH::Ray>& rays)
+        {
+            for (const auto& ray : rays)
+            {
+                SceneBVH::Hit hit;
+                bool isHit = bvh.closestHit(ray, hit);
+                float refT = closestHitReference(g, matrices, ray);
+                EXPECT_EQ(isHit, refT < std::numeric_limits<float>::infinity());
+                if (!isHit || !(refT < std::numeric_limits<float>::infinity())) continue;
+                EXPECT(isClose(hit.t, refT)) << "t = " << hit.t << " expected " << refT;
+
+                // The reported triangle and barycentrics must reproduce the hit point.
+                float3 p[3];
+                getWorldTriangle(g, matrices, hit.instanceID, hit.primitiveIndex, p);
+                float3 hitPos = (1.f - hit.barycentrics.x - hit.barycentrics.y) * p[0] + hit.barycentrics.x * p[1] + hit.barycentrics.y * p[2];
+                EXPECT(glm::length(hitPos - (ray.origin + hit.t * ray.dir)) < 1e-3f);
+            }
+        }
+    }
+
+    CPU_TEST(SceneBVH_ClosestHit)
+    {
+        rng.seed(1);
+        SceneBVH::Geometry g = createGeometry(300);
+        std::vector<glm::mat4> matrices = createMatrices((uint32_t)g.instances.size());
+        SceneBVH::SharedPtr pBVH = SceneBVH::create(g, matrices);
+
+        const auto& stats = pBVH->getStats();
+        EXPECT_EQ(stats.meshCount, 2u);
+        EXPECT_EQ(stats.instanceCount, 6u);
+        EXPECT_EQ(stats.triangleCount, (uint64_t)(g.meshes[0].triangleCount + g.meshes[1].triangleCount));
+
+        verifyClosestHits(ctx, *pBVH, g, matrices, createRays(2000));
+    }
+
+    CPU_TEST(SceneBVH_AnyHit)
+    {
+        rng.seed(2);
+        SceneBVH::Geometry g = createGeometry(300);
+        std::vector<glm::mat4> matrices = createMatrices((uint32_t)g.instances.size());
+        SceneBVH::SharedPtr pBVH = SceneBVH::create(g, matrices);
+
+        for (const auto& ray : createRays(2000))
+        {
+            float refT = closestHitReference(g, matrices, ray);
+            EXPECT_EQ(pBVH->anyHit(ray), refT < std::numeric_limits<float>::infinity());
+        }
+    }
+
+    CPU_TEST(SceneBVH_StreamMatchesSingleRay)
+    {
+        rng.seed(3);
+        SceneBVH::Geometry g = createGeometry(500);
+        std::vector<glm::mat4> matrices = createMatrices((uint32_t)g.instances.size());
+        SceneBVH::SharedPtr pBVH = SceneBVH::create(g, matrices);
+
+        // Use a ray count that is not a multiple of the packet size to test partial packets.
+        std::vector<SceneBVH::Ray> rays = createRays(SceneBVH::kPacketSize * 100 + 7);
+        std::vector<SceneBVH::Hit> hits(rays.size());
+        std::vector<uint8_t> occluded(rays.size());
+        pBVH->closestHit(rays.data(), hits.data(), rays.size());
+        pBVH->anyHit(rays.data(), occluded.data(), rays.size());
+
+        for (size_t i = 0; i < rays.size(); i++)
+        {
+            SceneBVH::Hit hit;
+            bool isHit = pBVH->closestHit(rays[i], hit);
+            EXPECT_EQ(hits[i].isValid(), isHit);
+            EXPECT_EQ(occluded[i] != 0, isHit);
+            if (isHit && hits[i].isValid()) EXPECT(isClose(hits[i].t, hit.t));
+        }
+    }
+
+    CPU_TEST(SceneBVH_UpdateTransforms)
+    {
+        rng.seed(4);
+        SceneBVH::Geometry g = createGeometry(200);
+        std::vector<glm::mat4> matrices = createMatrices((uint32_t)g.instances.size());
+        SceneBVH::SharedPtr pBVH = SceneBVH::create(g, matrices);
+
+        matrices = createMatrices((uint32_t)g.instances.size());
+        pBVH->updateTransforms(matrices);
+        verifyClosestHits(ctx, *pBVH, g, matrices, createRays(1000));
+    }
+
+    CPU_TEST(SceneBVH_Empty)
+    {
+        SceneBVH::SharedPtr pBVH = SceneBVH::create(SceneBVH::Geometry(), {});
+        SceneBVH::Ray ray;
+        SceneBVH::Hit hit;
+        EXPECT(!pBVH->closestHit(ray, hit));
+        EXPECT(!hit.isValid());
+        EXPECT(!pBVH->anyHit(ray));
+    }
+
+    CPU_TEST(SceneBVH_DepthIsBounded)
+    {
+        // Boxes at distances doubling along x. With two bins, every SAH split separates the farthest box from the rest,
+        // so without the depth limit the hierarchy would get deeper with every box.
+        const uint32_t boxCount = 120;
+        std::vector<AABB> bounds(boxCount);
+        for (uint32_t i = 0; i < boxCount; i++)
+        {
+            float x = std::ldexp(1.f, (int)i - 60);
+            bounds[i] = AABB(float3(x, 0.f, 0.f), float3(x * 1.25f, 1.f, 1.f));
+        }
+
+        BVH4::BuildOptions options;
+        options.binCount = 2;
+        options.maxLeafSize = 1;
+        options.maxDepth = 12;
+        BVH4 bvh;
+        bvh.build(bounds, options);
+        EXPECT_LE(bvh.getDepth(), 12u);
+        EXPECT_EQ(bvh.getPrimitiveIndices().size(), (size_t)boxCount);
+
+        // A ray through the middle of each box finds it, and only it.
+        for (uint32_t i = 0; i < boxCount; i++)
+        {
+            const float3 origin = float3(bounds[i].center().x, 0.5f, -1.f);
+            std::vector<uint32_t> hits;
+            float tMax = 10.f;
+            bvh.traverse(origin, float3(0.f, 0.f, 1.f), 0.f, tMax, [&](uint32_t j, float&) { hits.push_back(j); return false; });
+            EXPECT(hits.size() == 1 && hits[0] == i);
+        }
+    }
+
+    CPU_TEST(SceneBVH_Benchmark)
+    {
+        // Primary rays from a pinhole camera looking at a large synthetic scene.
+        rng.seed(5);
+        SceneBVH::Geometry g = createGeometry(50000);
+        std::vector<glm::mat4> matrices = createMatrices((uint32_t)g.instances.size());
+        SceneBVH::SharedPtr pBVH = SceneBVH::create(g, matrices);
+
+        const uint32_t width = 512, height = 512;
+        std::vector<SceneBVH::Ray> rays((size_t)width * height);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                float2 ndc = float2(2, -2) * ((float2(x, y) + 0.5f) / float2(width, height)) + float2(-1, 1);
+                SceneBVH::Ray& ray = rays[(size_t)y * width + x];
+                ray.origin = float3(0.f, 0.f, 20.f);
+                ray.dir = glm::normalize(float3(ndc.x * 0.4f, ndc.y * 0.4f, -1.f));
+            }
+        }
+
+        SceneBVH::BenchmarkResult result = pBVH->benchmark(rays);
+        EXPECT_GT(result.closestHitSingle, 0.0);
+        EXPECT_GT(result.closestHitStream, 0.0);
+        logInfo("SceneBVH benchmark (" + std::to_string(pBVH->getStats().triangleCount) + " triangles, " + std::to_string(rays.size()) + " primary rays): " +
+            "closest hit " + std::to_string(result.closestHitSingle) + " / " + std::to_string(result.closestHitStream) + " Mrays/s (single / stream), " +
+            "any hit " + std::to_string(result.anyHitSingle) + " / " + std::to_string(result.anyHitStream) + " Mrays/s (single / stream)");
+    }
+}
@@ -0,0 +1,116 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneBuilder.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Build a scene of static spheres placed on a grid, with the given triangle budget per BLAS.
+            All spheres are non-instanced static meshes, so they start out in a single mesh group.
+        */
+        Scene::SharedPtr createSphereGrid(SceneBuilder::Flags flags, uint32_t gridSize, const TriangleMesh::SharedPtr& pSphere, size_t maxTriangles)
+        {
+            SceneBuilder::SharedPtr pBuilder = SceneBuilder::create(flags);
+            pBuilder->setMaxTrianglesPerBLAS(maxTriangles);
+            Material::SharedPtr pMaterial = Material::create("Sphere");
+
+            for (uint32_t y = 0; y < gridSize; y++)
+            {
+                for (uint32_t x = 0; x < gridSize; x++)
+                {
+                    uint32_t meshID = pBuilder->addTriangleMesh(pSphere, pMaterial);
+                    SceneBuilder::Node node = { "Sphere", glm::translate(glm::mat4(1.f), float3(2.f * x, 0.f, 2.f * y)), glm::mat4(1.f) };
+                    pBuilder->addMeshInstance(pBuilder->addNode(node), meshID);
+                }
+            }
+            return pBuilder->getScene();
+        }
+    }
+
+    GPU_TEST(SceneBuilder_SplitMeshGroupSAH)
+    {
+        TriangleMesh::SharedPtr pSphere = TriangleMesh::createSphere(0.5f, 32, 16);
+        const size_t sphereTriangleCount = pSphere->getIndices().size() / 3;
+        const size_t maxTriangles = 3 * sphereTriangleCount;
+
+        Scene::SharedPtr pReference = createSphereGrid(SceneBuilder::Flags::Default, 4, pSphere, SceneBuilder::kDefaultMaxTrianglesPerBLAS);
+        EXPECT(pReference != nullptr);
+        if (!pReference) return;
+        const auto& referenceStats = pReference->getSceneStats();
+        EXPECT_EQ(referenceStats.meshGroupCount, 1u);
+
+        // Split with SAH. All groups are within the budget and no triangles are lost.
+        Scene::SharedPtr pScene = createSphereGrid(SceneBuilder::Flags::Default, 4, pSphere, maxTriangles);
+        EXPECT(pScene != nullptr);
+        if (!pScene) return;
+        const auto& stats = pScene->getSceneStats();
+        EXPECT_GE(stats.meshGroupCount, div_round_up(referenceStats.uniqueTriangleCount, (uint64_t)maxTriangles));
+        EXPECT_LE(stats.meshGroupMaxTriangleCount, maxTriangles);
+        EXPECT_EQ(stats.uniqueTriangleCount, referenceStats.uniqueTriangleCount);
+        EXPECT_GT(stats.meshGroupTraversalCost, 0.f);
+    }
+
+    GPU_TEST(SceneBuilder_SplitMeshGroupMidpoint)
+    {
+        // The midpoint strategy splits to the same triangle budget as SAH.
+        TriangleMesh::SharedPtr pSphere = TriangleMesh::createSphere(0.5f, 32, 16);
+        const size_t sphereTriangleCount = pSphere->getIndices().size() / 3;
+        const size_t maxTriangles = 3 * sphereTriangleCount;
+
+        Scene::SharedPtr pSAH = createSphereGrid(SceneBuilder::Flags::Default, 4, pSphere, maxTriangles);
+        Scene::SharedPtr pMidpoint = createSphereGrid(SceneBuilder::Flags::RTMidpointMeshGroupSplit, 4, pSphere, maxTriangles);
+        EXPECT(pSAH != nullptr && pMidpoint != nullptr);
+        if (!pSAH || !pMidpoint) return;
+
+        const auto& stats = pMidpoint->getSceneStats();
+        EXPECT_GE(stats.meshGroupCount, div_round_up(stats.uniqueTriangleCount, (uint64_t)maxTriangles));
+        EXPECT_LE(stats.meshGroupMaxTriangleCount, maxTriangles);
+        EXPECT_EQ(stats.uniqueTriangleCount, pSAH->getSceneStats().uniqueTriangleCount);
+        EXPECT_GT(stats.meshGroupTraversalCost, 0.f);
+    }
+
+    GPU_TEST(SceneBuilder_SplitMeshSAH)
+    {
+        // A single mesh over the budget is split along its own SAH planes.
+        TriangleMesh::SharedPtr pSphere = TriangleMesh::createSphere(0.5f, 256, 128);
+        const size_t sphereTriangleCount = pSphere->getIndices().size() / 3;
+        const size_t maxTriangles = sphereTriangleCount / 5;
+
+        Scene::SharedPtr pReference = createSphereGrid(SceneBuilder::Flags::Default, 1, pSphere, SceneBuilder::kDefaultMaxTrianglesPerBLAS);
+        Scene::SharedPtr pScene = createSphereGrid(SceneBuilder::Flags::Default, 1, pSphere, maxTriangles);
+        EXPECT(pReference != nullptr && pScene != nullptr);
+        if (!pReference || !pScene) return;
+
+        const auto& stats = pScene->getSceneStats();
+        EXPECT_GE(stats.meshGroupCount, 5u);
+        EXPECT_LE(stats.meshGroupMaxTriangleCount, maxTriangles);
+        EXPECT_EQ(stats.uniqueTriangleCount, pReference->getSceneStats().uniqueTriangleCount);
+    }
+}
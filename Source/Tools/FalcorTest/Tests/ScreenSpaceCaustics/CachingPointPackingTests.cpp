@@ -0,0 +1,183 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderPasses/Shared/Caustics/CachingPointPacking.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        std::mt19937 rng;
+        auto dist = std::uniform_real_distribution<float>();
+        float u() { return dist(rng); }
+
+        float3 randomDirection()
+        {
+            const float z = 1.f - 2.f * u();
+            const float r = std::sqrt(std::max(0.f, 1.f - z * z));
+            const float phi = 2.f * (float)M_PI * u();
+            return float3(r * std::cos(phi), r * std::sin(phi), z);
+        }
+
+        /** Returns the angle between two unit vectors. Unlike acos(dot(a, b)), this is accurate for small angles.
+        */
+        float angleBetween(const float3& a, const float3& b)
+        {
+            return 2.f * std::asin(std::min(1.f, 0.5f * glm::length(a - b)));
+        }
+    }
+
+    CPU_TEST(CachingPointPacking_Sizes)
+    {
+        EXPECT_EQ(sizeof(CachingPointData), 32);
+        EXPECT_EQ(sizeof(PackedCachingPointData), 16);
+        EXPECT_EQ(sizeof(PathToCachingPointData), 48);
+        EXPECT_EQ(sizeof(PackedPathToCachingPointData), 32);
+    }
+
+    CPU_TEST(CachingPointPacking_LogRadius)
+    {
+        // Zero, negative and NaN radii are all stored as zero.
+        EXPECT_EQ(decodeLogRadius(encodeLogRadius(0.f, 12), 12), 0.f);
+        EXPECT_EQ(decodeLogRadius(encodeLogRadius(-1.f, 16), 16), 0.f);
+        EXPECT_EQ(decodeLogRadius(encodeLogRadius(std::numeric_limits<float>::quiet_NaN(), 16), 16), 0.f);
+
+        // Out-of-range radii are clamped to the representable range.
+        EXPECT_EQ(decodeLogRadius(encodeLogRadius(1e-30f, 12), 12), std::exp2(kPackedRadiusLog2Min));
+        EXPECT_EQ(decodeLogRadius(encodeLogRadius(1e30f, 12), 12), std::exp2(kPackedRadiusLog2Max));
+
+        // In-range radii have a bounded relative error: half a quantization step in log2 space.
+        for (uint32_t bitCount : { kPackedCachingPointRadiusBits, kPackedPathRadiusBits })
+        {
+            const float maxLog2Error = 0.5f * (kPackedRadiusLog2Max - kPackedRadiusLog2Min) / float((1u << bitCount) - 2u);
+            const float maxRelativeError = std::exp2(maxLog2Error) - 1.f + 1e-6f;
+            for (uint32_t i = 0; i < 10000; i++)
+            {
+                const float radius = std::exp2(kPackedRadiusLog2Min + u() * (kPackedRadiusLog2Max - kPackedRadiusLog2Min));
+                const float decoded = decodeLogRadius(encodeLogRadius(radius, bitCount), bitCount);
+                EXPECT_LE(std::abs(decoded - radius), maxRelativeError * radius) << "radius = " << radius << ", bitCount = " << bitCount;
+            }
+        }
+    }
+
+    CPU_TEST(CachingPointPacking_RGB9E5)
+    {
+        EXPECT_EQ(decodeRGB9E5(encodeRGB9E5(float3(0.f))), float3(0.f));
+        EXPECT_EQ(decodeRGB9E5(encodeRGB9E5(float3(-1.f, 0.f, 0.f))), float3(0.f));
+        EXPECT_EQ(decodeRGB9E5(encodeRGB9E5(float3(1e10f))), float3(65408.f));
+
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            const float scale = std::exp2(u() * 30.f - 14.f);
+            const float3 color = float3(u(), u(), u()) * scale;
+            const float3 decoded = decodeRGB9E5(encodeRGB9E5(color));
+            const float maxComponent = std::max(color.x, std::max(color.y, color.z));
+            for (int c = 0; c < 3; c++)
+            {
+                EXPECT_LE(std::abs(decoded[c] - color[c]), std::max(maxComponent, std::exp2(-16.f)) / 512.f) << "color = (" << color.x << ", " << color.y << ", " << color.z << ")";
+            }
+        }
+    }
+
+    CPU_TEST(CachingPointPacking_CachingPoint)
+    {
+        const float3 origin = float3(1.f, -2.f, 3.f);
+
+        // A point at the origin must not produce NaNs.
+        {
+            CachingPointData data = {};
+            data.position = origin;
+            data.normal = float3(0.f, 1.f, 0.f);
+            const CachingPointData decoded = unpackCachingPoint(packCachingPoint(data, origin), origin);
+            EXPECT_EQ(decoded.position, origin);
+        }
+
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            CachingPointData data;
+            const float distance = std::exp2(u() * 14.f - 4.f);
+            data.position = origin + randomDirection() * distance;
+            data.searchRadius = std::exp2(u() * 16.f - 14.f);
+            data.normal = randomDirection();
+            const uint32_t depth = i % (kPackedCachingPointMaxDepth + 1);
+            const uint32_t materialID = i % 0x10000;
+            data.depthAndMaterialID = (depth << 16) | materialID;
+
+            const CachingPointData decoded = unpackCachingPoint(packCachingPoint(data, origin), origin);
+
+            // The position error is proportional to the distance from the origin.
+            EXPECT_LE(glm::length(decoded.position - data.position), 1e-4f * distance) << "distance = " << distance;
+            EXPECT_LE(std::abs(decoded.searchRadius - data.searchRadius), 3e-3f * data.searchRadius);
+            EXPECT_LE(angleBetween(decoded.normal, data.normal), 1e-4f);
+            EXPECT_EQ(decoded.depthAndMaterialID, data.depthAndMaterialID);
+        }
+
+        // Depths beyond the supported bounce count are saturated.
+        CachingPointData data = {};
+        data.normal = float3(0.f, 0.f, 1.f);
+        data.depthAndMaterialID = (100u << 16) | 42u;
+        const CachingPointData decoded = unpackCachingPoint(packCachingPoint(data, origin), origin);
+        EXPECT_EQ(decoded.depthAndMaterialID, (kPackedCachingPointMaxDepth << 16) | 42u);
+    }
+
+    CPU_TEST(CachingPointPacking_PathToCachingPoint)
+    {
+        // Pixels without caching point are flagged by a non-positive search radius.
+        {
+            PathToCachingPointData data = {};
+            data.searchRadius = -1.f;
+            data.incomingCameraDir = float3(0.f, 0.f, 1.f);
+            EXPECT_EQ(unpackPathToCachingPoint(packPathToCachingPoint(data)).searchRadius, 0.f);
+        }
+
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            PathToCachingPointData data;
+            data.incomingCameraDir = randomDirection();
+            data.searchRadius = std::exp2(u() * 16.f - 14.f);
+            data.pathThroughput = float3(u(), u(), u()) * std::exp2(u() * 8.f - 4.f);
+            data.materialIDAndHitInfoType = (i << 16) | (i % 3);
+            data.hitInfoInstanceID = i * 7919u;
+            data.hitInfoPrimitiveIndex = i * 104729u;
+            data.hitInfoBarycentrics = float2(u(), u());
+
+            const PathToCachingPointData decoded = unpackPathToCachingPoint(packPathToCachingPoint(data));
+
+            const float maxThroughput = std::max(data.pathThroughput.x, std::max(data.pathThroughput.y, data.pathThroughput.z));
+            EXPECT_LE(angleBetween(decoded.incomingCameraDir, data.incomingCameraDir), 1e-4f);
+            EXPECT_LE(std::abs(decoded.searchRadius - data.searchRadius), 2e-4f * data.searchRadius);
+            EXPECT_LE(glm::length(decoded.pathThroughput - data.pathThroughput), 2.f * std::max(maxThroughput, std::exp2(-16.f)) / 512.f);
+            EXPECT_EQ(decoded.materialIDAndHitInfoType, data.materialIDAndHitInfoType);
+            EXPECT_EQ(decoded.hitInfoInstanceID, data.hitInfoInstanceID);
+            EXPECT_EQ(decoded.hitInfoPrimitiveIndex, data.hitInfoPrimitiveIndex);
+            EXPECT_LE(std::abs(decoded.hitInfoBarycentrics.x - data.hitInfoBarycentrics.x), 1.f / 65535.f);
+            EXPECT_LE(std::abs(decoded.hitInfoBarycentrics.y - data.hitInfoBarycentrics.y), 1.f / 65535.f);
+        }
+    }
+}
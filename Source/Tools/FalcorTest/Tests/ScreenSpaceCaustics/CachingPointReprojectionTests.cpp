@@ -0,0 +1,232 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderPasses/Shared/Caustics/CachingPointReprojection.h"
+#include <optional>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint2 kFrameDim = uint2(96, 64);
+        const uint32_t kGroundMaterialID = 1;
+        const uint32_t kSphereMaterialID = 2;
+        const float3 kSphereCenter = float3(0.f, 1.f, 0.f);
+        const float kSphereRadius = 1.f;
+
+        /** Minimal pinhole camera, with screen-space coordinates in [0,1] and the origin in the top-left corner.
+        */
+        struct TestCamera
+        {
+            float3 position;
+            float3 forward;
+            float3 right;
+            float3 up;
+            float tanHalfFovY = 0.5f;
+
+            TestCamera(const float3& pos, const float3& target) : position(pos)
+            {
+                forward = glm::normalize(target - pos);
+                right = glm::normalize(glm::cross(forward, float3(0.f, 1.f, 0.f)));
+                up = glm::cross(right, forward);
+            }
+
+            float aspect() const { return float(kFrameDim.x) / float(kFrameDim.y); }
+
+            float3 rayDir(const float2& uv) const
+            {
+                const float2 ndc = float2(2.f * uv.x - 1.f, 1.f - 2.f * uv.y);
+                return glm::normalize(forward + ndc.x * tanHalfFovY * aspect() * right + ndc.y * tanHalfFovY * up);
+            }
+
+            float2 project(const float3& p) const
+            {
+                const float3 d = p - position;
+                const float z = glm::dot(d, forward);
+                const float2 ndc = float2(glm::dot(d, right) / (z * tanHalfFovY * aspect()), glm::dot(d, up) / (z * tanHalfFovY));
+                return float2(0.5f * (ndc.x + 1.f), 0.5f * (1.f - ndc.y));
+            }
+        };
+
+        /** Traces the primary ray of a pixel against a ground plane and a sphere, and returns the caching point at the hit.
+        */
+        std::optional<CachingPointData> traceCachingPoint(const TestCamera& camera, const uint2& pixel)
+        {
+            const float3 dir = camera.rayDir((float2(pixel) + 0.5f) / float2(kFrameDim));
+            float tMin = std::numeric_limits<float>::infinity();
+            CachingPointData data = {};
+
+            const float3 oc = camera.position - kSphereCenter;
+            const float b = glm::dot(oc, dir);
+            const float disc = b * b - (glm::dot(oc, oc) - kSphereRadius * kSphereRadius);
+            if (disc >= 0.f && -b - std::sqrt(disc) > 0.f)
+            {
+                tMin = -b - std::sqrt(disc);
+                data.position = camera.position + tMin * dir;
+                data.normal = glm::normalize(data.position - kSphereCenter);
+                data.depthAndMaterialID = kSphereMaterialID;
+            }
+            if (dir.y < 0.f && -camera.position.y / dir.y < tMin)
+            {
+                tMin = -camera.position.y / dir.y;
+                data.position = camera.position + tMin * dir;
+                data.normal = float3(0.f, 1.f, 0.f);
+                data.depthAndMaterialID = kGroundMaterialID;
+            }
+            if (!std::isfinite(tMin)) return std::nullopt;
+            // Footprint of the pixel on the surface, as estimated from the ray cone in PathTracing.rt.slang.
+            data.searchRadius = 2.f * tMin * camera.tanHalfFovY / kFrameDim.y / std::max(1e-3f, std::abs(glm::dot(data.normal, dir)));
+            return data;
+        }
+
+        struct ReprojectionResult
+        {
+            uint32_t cachingPointCount = 0;
+            uint32_t matchingCount = 0;         ///< Caching points reprojecting to a previous caching point on the same surface, within a few footprints.
+            uint32_t validCount = 0;            ///< Caching points that found a valid previous caching point by reprojection.
+            uint32_t falsePositiveCount = 0;    ///< Valid reprojections to a non-matching caching point.
+        };
+
+        /** Renders the caching points of both frames, derives the motion vectors from the exact geometry
+            as the G-buffer would, and reprojects all current caching points.
+        */
+        ReprojectionResult simulateReprojection(const TestCamera& previousCamera, const TestCamera& currentCamera)
+        {
+            std::vector<std::optional<CachingPointData>> previousFrame(kFrameDim.x * kFrameDim.y);
+            for (uint32_t y = 0; y < kFrameDim.y; y++)
+                for (uint32_t x = 0; x < kFrameDim.x; x++) previousFrame[y * kFrameDim.x + x] = traceCachingPoint(previousCamera, uint2(x, y));
+
+            ReprojectionResult result;
+            for (uint32_t y = 0; y < kFrameDim.y; y++)
+            {
+                for (uint32_t x = 0; x < kFrameDim.x; x++)
+                {
+                    const uint2 pixel(x, y);
+                    const auto current = traceCachingPoint(currentCamera, pixel);
+                    if (!current) continue;
+                    result.cachingPointCount++;
+
+                    const float2 motionVector = previousCamera.project(current->position) - (float2(pixel) + 0.5f) / float2(kFrameDim);
+                    uint2 previousPixel;
+                    if (!reprojectPixel(pixel, motionVector, kFrameDim, previousPixel)) continue;
+
+                    const auto& previous = previousFrame[previousPixel.y * kFrameDim.x + previousPixel.x];
+                    if (!previous) continue;
+
+                    const bool isMatching = previous->depthAndMaterialID == current->depthAndMaterialID &&
+                                            glm::length(previous->position - current->position) <= 4.f * current->searchRadius;
+                    if (isMatching) result.matchingCount++;
+                    if (!isValidReprojection(*current, *previous)) continue;
+
+                    result.validCount++;
+                    if (!isMatching) result.falsePositiveCount++;
+                }
+            }
+            return result;
+        }
+    }
+
+    CPU_TEST(CachingPointReprojection_ReprojectPixel)
+    {
+        uint2 previousPixel;
+        EXPECT(reprojectPixel(uint2(10, 20), float2(0.f), kFrameDim, previousPixel));
+        EXPECT_EQ(previousPixel.x, 10);
+        EXPECT_EQ(previousPixel.y, 20);
+
+        EXPECT(reprojectPixel(uint2(10, 20), float2(-3.f, 2.f) / float2(kFrameDim), kFrameDim, previousPixel));
+        EXPECT_EQ(previousPixel.x, 7);
+        EXPECT_EQ(previousPixel.y, 22);
+
+        EXPECT(!reprojectPixel(uint2(0, 0), float2(-1.f, 0.f) / float2(kFrameDim), kFrameDim, previousPixel));
+        EXPECT(!reprojectPixel(kFrameDim - 1u, float2(0.f, 1.f) / float2(kFrameDim), kFrameDim, previousPixel));
+    }
+
+    CPU_TEST(CachingPointReprojection_Validation)
+    {
+        CachingPointData current = {};
+        current.position = float3(0.f);
+        current.normal = float3(0.f, 0.f, 1.f);
+        current.depthAndMaterialID = 3;
+        current.searchRadius = 0.05f;
+
+        CachingPointData previous = current;
+        EXPECT(isValidReprojection(current, previous));
+
+        // Only caching points at the primary hit are reprojected, and the depths must match.
+        previous.depthAndMaterialID = (1 << 16) | 3;
+        EXPECT(!isValidReprojection(current, previous));
+        EXPECT(!isValidReprojection(previous, previous));
+        EXPECT(!isValidReprojection(previous, current));
+
+        previous = current;
+        previous.depthAndMaterialID = 4;
+        EXPECT(!isValidReprojection(current, previous));
+
+        previous = current;
+        previous.normal = glm::normalize(float3(1.f, 0.f, 1.f));
+        EXPECT(!isValidReprojection(current, previous));
+
+        // The previous point must lie within the search radius, close to the tangent plane.
+        previous = current;
+        previous.position = float3(0.04f, 0.f, 0.f);
+        EXPECT(isValidReprojection(current, previous));
+        previous.position = float3(0.f, 0.06f, 0.f);
+        EXPECT(!isValidReprojection(current, previous));
+        previous.position = float3(0.f, 0.f, 0.04f);
+        EXPECT(!isValidReprojection(current, previous));
+
+        // A point moved sideways on a surface at the same distance from the camera is rejected.
+        previous.position = float3(3.f, 0.f, 0.f);
+        EXPECT(!isValidReprojection(current, previous));
+    }
+
+    CPU_TEST(CachingPointReprojection_CameraMotion)
+    {
+        const float3 target = float3(0.f, 0.5f, 0.f);
+        const TestCamera camera(float3(0.f, 2.f, 6.f), target);
+
+        // Static camera: every caching point reprojects onto itself.
+        {
+            const auto result = simulateReprojection(camera, camera);
+            EXPECT_GT(result.cachingPointCount, 0u);
+            EXPECT_EQ(result.validCount, result.cachingPointCount);
+            EXPECT_EQ(result.falsePositiveCount, 0u);
+        }
+
+        // Translating and rotating camera: caching points that moved out of the frame or got disoccluded are rejected,
+        // and nearly all others are still found.
+        for (const float3& offset : { float3(0.1f, 0.f, 0.f), float3(0.3f, 0.1f, -0.2f), float3(-0.5f, 0.f, 0.5f) })
+        {
+            const TestCamera previousCamera(camera.position + offset, target + 0.5f * offset);
+            const auto result = simulateReprojection(previousCamera, camera);
+            EXPECT_LT(result.matchingCount, result.cachingPointCount);
+            EXPECT_GE(result.validCount, uint32_t(0.95f * result.matchingCount));
+            EXPECT_EQ(result.falsePositiveCount, 0u);
+        }
+    }
+}
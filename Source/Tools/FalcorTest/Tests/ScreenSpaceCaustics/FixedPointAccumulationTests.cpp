@@ -0,0 +1,145 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderPasses/Shared/Caustics/FixedPointAccumulation.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        struct SimulationResult
+        {
+            double maxRelativeError = 0.0;  ///< Largest relative error of the accumulated sum over all trials.
+            double overflowRate = 0.0;      ///< Fraction of trials where a value was clamped or the sum wrapped around.
+        };
+
+        /** Simulates the accumulation of photon contributions into one pixel, and measures the error against a double-precision sum.
+            \param[in] useSplitFixed Use the 64-bit split format instead of the 32-bit one.
+            \param[in] photonCount Number of photons accumulated per trial.
+            \param[in] meanValue Mean contribution of a photon (exponentially distributed).
+            \param[in] trialCount Number of trials.
+        */
+        SimulationResult simulateAccumulation(bool useSplitFixed, uint32_t photonCount, float meanValue, uint32_t trialCount)
+        {
+            std::mt19937 rng;
+            std::exponential_distribution<float> dist(1.f / meanValue);
+
+            const double maxFixedValue = double(1u << (32 - kFixedBitCount));
+            const double maxSplitFixedValue = double(1u << (64 - kSplitFixedFractionBits));
+
+            SimulationResult result;
+            uint32_t overflowCount = 0;
+            for (uint32_t trial = 0; trial < trialCount; trial++)
+            {
+                double exactSum = 0.0;
+                double maxValue = 0.0;
+                uint32_t fixedSum = 0;
+                uint2 splitFixedSum = uint2(0);
+                for (uint32_t i = 0; i < photonCount; i++)
+                {
+                    const float value = dist(rng);
+                    exactSum += value;
+                    maxValue = std::max(maxValue, (double)value);
+                    if (useSplitFixed) addSplitFixed(splitFixedSum, toSplitFixed(value));
+                    else fixedSum += toFixed(value);
+                }
+
+                const double sum = useSplitFixed ? fromSplitFixed(splitFixedSum) : fromFixed(fixedSum);
+                const double maxRepresentable = useSplitFixed ? maxSplitFixedValue : maxFixedValue;
+                if (exactSum >= maxRepresentable || maxValue >= maxRepresentable - 1.0) overflowCount++;
+                result.maxRelativeError = std::max(result.maxRelativeError, std::abs(sum - exactSum) / exactSum);
+            }
+            result.overflowRate = double(overflowCount) / trialCount;
+            return result;
+        }
+    }
+
+    CPU_TEST(FixedPointAccumulation_RoundTrip)
+    {
+        for (float value : { 0.f, 1e-9f, 3.5e-6f, 0.25f, 1.f, 13.7f, 4096.5f, 1e6f })
+        {
+            const float decoded = fromSplitFixed(toSplitFixed(value));
+            EXPECT_LE(std::abs(decoded - value), std::max(value * 1.2e-7f, std::exp2(-float(kSplitFixedFractionBits))));
+        }
+        EXPECT_EQ(fromSplitFixed(toSplitFixed(-1.f)), 0.f);
+        EXPECT_EQ(fromSplitFixed(toSplitFixed(1e9f)), 16777215.f);
+
+        EXPECT_LE(std::abs(fromFixed(toFixed(0.3f)) - 0.3f), std::exp2(-float(kFixedBitCount)));
+        EXPECT_EQ(fromFixed(toFixed(100.f)), 15.f);
+    }
+
+    CPU_TEST(FixedPointAccumulation_Carry)
+    {
+        // Low words summing past 2^32 must carry into the high word.
+        const uint2 value = toSplitFixed(0.75f * std::exp2(32.f - float(kSplitFixedFractionBits)));
+        EXPECT_EQ(value.y, 0);
+
+        uint2 sum = uint2(0);
+        for (uint32_t i = 0; i < 5; i++) addSplitFixed(sum, value);
+        EXPECT_EQ(sum.y, 3);
+        EXPECT_EQ(fromSplitFixed(sum), 3.75f * std::exp2(32.f - float(kSplitFixedFractionBits)));
+
+        // Values with both words set.
+        uint2 largeSum = uint2(0);
+        for (uint32_t i = 0; i < 1000; i++) addSplitFixed(largeSum, toSplitFixed(1234.5678f));
+        EXPECT_LE(std::abs(fromSplitFixed(largeSum) - 1234567.8f), 1.f);
+    }
+
+    CPU_TEST(FixedPointAccumulation_Simulation)
+    {
+        const uint32_t trialCount = 8;
+
+        // Dim caustic: the 32-bit format loses most of the precision, as each contribution is close to its resolution of 2^-28.
+        {
+            const auto fixed = simulateAccumulation(false, 1000, 1e-8f, trialCount);
+            const auto splitFixed = simulateAccumulation(true, 1000, 1e-8f, trialCount);
+            EXPECT_GE(fixed.maxRelativeError, 1e-2);
+            EXPECT_LE(splitFixed.maxRelativeError, 1e-4);
+        }
+
+        // Moderate contributions: both formats are accurate.
+        {
+            const auto fixed = simulateAccumulation(false, 1000, 1e-3f, trialCount);
+            const auto splitFixed = simulateAccumulation(true, 1000, 1e-3f, trialCount);
+            EXPECT_EQ(fixed.overflowRate, 0.0);
+            EXPECT_LE(fixed.maxRelativeError, 1e-4);
+            EXPECT_LE(splitFixed.maxRelativeError, 1e-6);
+        }
+
+        // Bright caustic with many photons per pixel: the 32-bit sum wraps around past 16.
+        for (uint32_t photonCount : { 100u, 10000u, 1000000u })
+        {
+            const auto fixed = simulateAccumulation(false, photonCount, 0.5f, trialCount);
+            const auto splitFixed = simulateAccumulation(true, photonCount, 0.5f, trialCount);
+            if (photonCount >= 10000) EXPECT_EQ(fixed.overflowRate, 1.0);
+            EXPECT_EQ(splitFixed.overflowRate, 0.0);
+            EXPECT_LE(splitFixed.maxRelativeError, 1e-6);
+        }
+    }
+}
@@ -0,0 +1,204 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderPasses/Shared/Caustics/ProgressivePhotonMapping.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const char kShaderFile[] = "Tests/ScreenSpaceCaustics/ProgressivePhotonMappingTests.cs.slang";
+
+        /** Inputs of one call to updateProgressivePhotonState(), laid out as in the test shader.
+        */
+        struct UpdateInput
+        {
+            float3 frameRadiance;
+            float framePhotonCount;
+            float frameRadius;
+            float alpha;
+        };
+
+        /** Simple photon gathering setup used to compare the progressive radius schedule against a fixed radius.
+            Photons are distributed over the square [-1,1]^2 with a density of 1 + |p|^2 / kScale^2, and the reflected
+            radiance is estimated at the origin. The exact value is 1, while a gather with radius r converges to 1 + r^2 / (2 kScale^2).
+        */
+        const float kScale = 0.5f;
+        const uint32_t kPhotonsPerFrame = 4096;
+
+        float photonDensity(const float2& p)
+        {
+            return 1.f + glm::dot(p, p) / (kScale * kScale);
+        }
+
+        /** Gathers one frame of photons with the given radius.
+            \param[out] photonCount Number of photons within the radius.
+            \return Radiance estimate.
+        */
+        float gatherFrame(std::mt19937& rng, float radius, uint32_t& photonCount)
+        {
+            std::uniform_real_distribution<float> dist(-1.f, 1.f);
+            const float photonWeight = 4.f / kPhotonsPerFrame;
+
+            float flux = 0.f;
+            photonCount = 0;
+            for (uint32_t i = 0; i < kPhotonsPerFrame; i++)
+            {
+                const float2 p(dist(rng), dist(rng));
+                if (glm::dot(p, p) > radius * radius) continue;
+                flux += photonWeight * photonDensity(p);
+                photonCount++;
+            }
+            return flux / ((float)M_PI * radius * radius);
+        }
+    }
+
+    CPU_TEST(ProgressivePhotonMapping_Update)
+    {
+        ProgressivePhotonState state = {};
+        EXPECT_EQ(sizeof(ProgressivePhotonState), 32);
+
+        // First frame restarts the invalid state.
+        state = updateProgressivePhotonState(state, float3(2.f), 10.f, 1.f, 0.5f);
+        EXPECT_EQ(state.iterationCount, 1);
+        EXPECT_EQ(state.photonCount, 5.f);
+        EXPECT_LE(std::abs(state.radius - std::sqrt(0.5f)), 1e-6f);
+        EXPECT_EQ(state.radiance.x, 2.f);
+
+        // Second frame: N' = 5 + 0.5 * 10, R'^2 = R^2 * 10 / 15.
+        const float radius = state.radius;
+        state = updateProgressivePhotonState(state, float3(4.f), 10.f, radius, 0.5f);
+        EXPECT_EQ(state.iterationCount, 2);
+        EXPECT_EQ(state.photonCount, 10.f);
+        EXPECT_LE(std::abs(state.radius * state.radius - radius * radius * 10.f / 15.f), 1e-6f);
+        EXPECT_EQ(state.radiance.x, 3.f);
+
+        // No photons: the radius is kept, but the frame still counts towards the mean.
+        state = updateProgressivePhotonState(state, float3(0.f), 0.f, state.radius, 0.5f);
+        EXPECT_EQ(state.iterationCount, 3);
+        EXPECT_EQ(state.photonCount, 10.f);
+        EXPECT_LE(std::abs(state.radius * state.radius - radius * radius * 10.f / 15.f), 1e-6f);
+        EXPECT_EQ(state.radiance.x, 2.f);
+
+        // An invalid state (e.g. after a disocclusion) is restarted.
+        ProgressivePhotonState resetState = state;
+        resetState.radius = 0.f;
+        resetState = updateProgressivePhotonState(resetState, float3(7.f), 4.f, 2.f, 0.75f);
+        EXPECT_EQ(resetState.iterationCount, 1);
+        EXPECT_EQ(resetState.photonCount, 3.f);
+        EXPECT_EQ(resetState.radiance.x, 7.f);
+        EXPECT_LE(std::abs(resetState.radius - 2.f * std::sqrt(0.75f)), 1e-6f);
+    }
+
+    CPU_TEST(ProgressivePhotonMapping_Convergence)
+    {
+        const float initialRadius = 0.5f;
+        const uint32_t frameCount = 1000;
+        const float alpha = 2.f / 3.f;
+
+        std::mt19937 rng;
+        ProgressivePhotonState state = {};
+        float fixedRadiusSum = 0.f;
+        float previousRadius = initialRadius;
+
+        for (uint32_t frame = 0; frame < frameCount; frame++)
+        {
+            uint32_t photonCount;
+            const float radius = state.radius > 0.f ? state.radius : initialRadius;
+            const float radiance = gatherFrame(rng, radius, photonCount);
+            state = updateProgressivePhotonState(state, float3(radiance), (float)photonCount, radius, alpha);
+
+            EXPECT_LE(state.radius, previousRadius);
+            previousRadius = state.radius;
+
+            fixedRadiusSum += gatherFrame(rng, initialRadius, photonCount);
+        }
+
+        // With a fixed radius, the estimate settles at a bias of r^2 / (2 kScale^2) = 0.5.
+        const float fixedRadiusError = std::abs(fixedRadiusSum / frameCount - 1.f);
+        EXPECT_GE(fixedRadiusError, 0.45f);
+
+        // The progressive estimate keeps converging towards the exact value.
+        const float progressiveError = std::abs(state.radiance.x - 1.f);
+        EXPECT_LT(state.radius, 0.5f * initialRadius);
+        EXPECT_LE(progressiveError, 0.25f * fixedRadiusError);
+        EXPECT_EQ(state.iterationCount, frameCount);
+    }
+
+    GPU_TEST(ProgressivePhotonMapping_HostMatchesGPU)
+    {
+        // Random states, including invalid ones, and frame inputs, including frames without photons.
+        const uint32_t testCount = 4096;
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> dist(0.f, 1.f);
+
+        std::vector<ProgressivePhotonState> states(testCount);
+        std::vector<UpdateInput> inputs(testCount);
+        for (uint32_t i = 0; i < testCount; i++)
+        {
+            ProgressivePhotonState& state = states[i];
+            state = {};
+            state.radiance = float3(dist(rng), dist(rng), dist(rng)) * 10.f;
+            state.radius = (i % 8 == 0) ? 0.f : dist(rng);
+            state.photonCount = std::floor(dist(rng) * 1000.f);
+            state.iterationCount = i % 100;
+
+            UpdateInput& input = inputs[i];
+            input.frameRadiance = float3(dist(rng), dist(rng), dist(rng)) * 10.f;
+            input.framePhotonCount = (i % 16 == 1) ? 0.f : std::floor(dist(rng) * 100.f);
+            input.frameRadius = state.radius > 0.f ? state.radius : 0.5f;
+            input.alpha = 0.25f + 0.75f * dist(rng);
+        }
+
+        ctx.createProgram(kShaderFile, "testUpdate");
+        ctx.allocateStructuredBuffer("gStates", testCount, states.data(), states.size() * sizeof(ProgressivePhotonState));
+        ctx.allocateStructuredBuffer("gInputs", testCount, inputs.data(), inputs.size() * sizeof(UpdateInput));
+        ctx.allocateStructuredBuffer("gResult", testCount);
+        ctx["TestCB"]["resultSize"] = testCount;
+        ctx.runProgram(testCount);
+
+        auto relError = [](float a, float b) { return std::abs(a - b) / std::max(std::abs(b), 1e-6f); };
+
+        const ProgressivePhotonState* result = ctx.mapBuffer<const ProgressivePhotonState>("gResult");
+        for (uint32_t i = 0; i < testCount; i++)
+        {
+            const UpdateInput& input = inputs[i];
+            const ProgressivePhotonState ref = updateProgressivePhotonState(states[i], input.frameRadiance, input.framePhotonCount, input.frameRadius, input.alpha);
+
+            EXPECT_EQ(result[i].iterationCount, ref.iterationCount) << "state " << i;
+            EXPECT_LE(relError(result[i].photonCount, ref.photonCount), 1e-6f) << "state " << i;
+            EXPECT_LE(relError(result[i].radius, ref.radius), 1e-5f) << "state " << i;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                EXPECT_LE(relError(result[i].radiance[c], ref.radiance[c]), 1e-5f) << "state " << i << ", channel " << c;
+            }
+        }
+        ctx.unmapBuffer("gResult");
+    }
+}
@@ -0,0 +1,245 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderPasses/Shared/Caustics/ProjectionVolumeBuilder.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Creates a grid of small boxes in the xz-plane, spaced far apart from each other.
+        */
+        std::vector<AABB> createScatteredCasters(uint32_t countPerSide, float spacing, float size)
+        {
+            std::vector<AABB> casters;
+            for (uint32_t i = 0; i < countPerSide; ++i)
+            {
+                for (uint32_t j = 0; j < countPerSide; ++j)
+                {
+                    const float3 minPoint = float3(i * spacing, 0.f, j * spacing);
+                    casters.push_back(AABB(minPoint, minPoint + float3(size)));
+                }
+            }
+            return casters;
+        }
+
+        using Emitter = ProjectionVolumeBuilder::Emitter;
+
+        std::vector<Emitter> createPointEmitters(const std::vector<float3>& positions)
+        {
+            std::vector<Emitter> emitters;
+            for (const float3& pos : positions) emitters.push_back({ Emitter::Type::Point, pos });
+            return emitters;
+        }
+
+        bool contains(const AABB& outer, const AABB& inner)
+        {
+            return glm::all(glm::lessThanEqual(outer.minPoint, inner.minPoint)) && glm::all(glm::greaterThanEqual(outer.maxPoint, inner.maxPoint));
+        }
+    }
+
+    CPU_TEST(ProjectionVolumeBuilder_SingleVolume)
+    {
+        const auto casters = createScatteredCasters(3, 10.f, 0.5f);
+        const auto volumes = ProjectionVolumeBuilder::build(casters, 1);
+
+        AABB expected;
+        for (const auto& caster : casters) expected.include(caster);
+
+        EXPECT_EQ(volumes.size(), 1);
+        EXPECT(volumes[0] == expected);
+
+        // Invalid bounds are skipped, and no bounds give no volume.
+        EXPECT(ProjectionVolumeBuilder::build({ AABB() }, 4).empty());
+        EXPECT(ProjectionVolumeBuilder::build({}, 4).empty());
+    }
+
+    CPU_TEST(ProjectionVolumeBuilder_SeparatedGroups)
+    {
+        // Two tight groups of casters at opposite ends of the scene.
+        std::vector<AABB> casters;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            casters.push_back(AABB(float3(i * 0.25f, 0.f, 0.f), float3(i * 0.25f + 0.2f, 0.2f, 0.2f)));
+            casters.push_back(AABB(float3(100.f + i * 0.25f, 0.f, 0.f), float3(100.f + i * 0.25f + 0.2f, 0.2f, 0.2f)));
+        }
+
+        const auto volumes = ProjectionVolumeBuilder::build(casters, 2);
+        EXPECT_EQ(volumes.size(), 2);
+        if (volumes.size() != 2) return;
+
+        // Each volume should only enclose one of the groups.
+        for (const auto& volume : volumes)
+        {
+            EXPECT_LT(volume.extent().x, 1.f);
+        }
+
+        // Every caster must be enclosed by at least one volume.
+        for (const auto& caster : casters)
+        {
+            EXPECT(contains(volumes[0], caster) || contains(volumes[1], caster));
+        }
+    }
+
+    CPU_TEST(ProjectionVolumeBuilder_VolumeCount)
+    {
+        const auto casters = createScatteredCasters(4, 10.f, 0.5f);
+        for (uint32_t maxVolumeCount : { 1u, 2u, 3u, 8u, 16u, 64u })
+        {
+            const auto volumes = ProjectionVolumeBuilder::build(casters, maxVolumeCount);
+            EXPECT_LE(volumes.size(), std::min<size_t>(maxVolumeCount, casters.size())) << "maxVolumeCount = " << maxVolumeCount;
+            EXPECT_GE(volumes.size(), 1);
+
+            for (const auto& caster : casters)
+            {
+                bool enclosed = false;
+                for (const auto& volume : volumes) enclosed = enclosed || contains(volume, caster);
+                EXPECT(enclosed) << "maxVolumeCount = " << maxVolumeCount;
+            }
+        }
+
+        // With one volume per caster, the volumes should be the casters themselves.
+        const auto volumes = ProjectionVolumeBuilder::build(casters, (uint32_t)casters.size());
+        EXPECT_EQ(volumes.size(), casters.size());
+    }
+
+    CPU_TEST(ProjectionVolumeBuilder_HitRate)
+    {
+        const auto casters = createScatteredCasters(4, 10.f, 0.5f);
+        const auto emitters = createPointEmitters({ float3(15.f, 20.f, 15.f), float3(0.f, 10.f, 30.f), float3(-5.f, 5.f, -5.f) });
+        const uint32_t samplesPerEmitter = 10000;
+
+        const auto singleVolume = ProjectionVolumeBuilder::build(casters, 1);
+        const auto perCasterVolumes = ProjectionVolumeBuilder::build(casters, (uint32_t)casters.size());
+
+        const auto singleEstimate = ProjectionVolumeBuilder::estimateHitRate(singleVolume, casters, emitters, samplesPerEmitter, 1u);
+        const auto perCasterEstimate = ProjectionVolumeBuilder::estimateHitRate(perCasterVolumes, casters, emitters, samplesPerEmitter, 1u);
+
+        EXPECT_EQ(singleEstimate.sampleCount, emitters.size() * samplesPerEmitter);
+        EXPECT_EQ(singleEstimate.volumeCount, 1);
+        EXPECT_EQ(perCasterEstimate.volumeCount, casters.size());
+
+        // Tight volumes around each caster must focus the photons much better than one scene-wide box.
+        EXPECT_LT(singleEstimate.getHitRate(), 0.1f);
+        EXPECT_GT(perCasterEstimate.getHitRate(), 0.5f);
+        EXPECT_LT(perCasterEstimate.averageSolidAngle, singleEstimate.averageSolidAngle);
+
+        // Sampling a cone that exactly bounds a caster from far away should almost always hit it.
+        const std::vector<AABB> sphereLikeCaster = { AABB(float3(-0.5f), float3(0.5f)) };
+        const auto farEstimate = ProjectionVolumeBuilder::estimateHitRate(sphereLikeCaster, sphereLikeCaster, createPointEmitters({ float3(0.f, 0.f, 100.f) }), samplesPerEmitter, 3u);
+        EXPECT_GT(farEstimate.getHitRate(), 0.5f);
+
+        // The estimate is reproducible for a given seed.
+        const auto repeatedEstimate = ProjectionVolumeBuilder::estimateHitRate(perCasterVolumes, casters, emitters, samplesPerEmitter, 1u);
+        EXPECT_EQ(repeatedEstimate.hitCount, perCasterEstimate.hitCount);
+    }
+
+    CPU_TEST(ProjectionVolumeBuilder_HitRateEmitterTypes)
+    {
+        const std::vector<AABB> box = { AABB(float3(-0.5f), float3(0.5f)) };
+        const uint32_t samplesPerEmitter = 10000;
+
+        // Inside a volume, the cone covers the whole sphere, so every photon leaves through the volume.
+        const auto pointInside = ProjectionVolumeBuilder::estimateHitRate(box, box, { { Emitter::Type::Point, float3(0.1f, 0.f, 0.f) } }, samplesPerEmitter, 1u);
+        EXPECT_EQ(pointInside.sampleCount, samplesPerEmitter);
+        EXPECT_EQ(pointInside.hitCount, samplesPerEmitter);
+
+        const auto triangleInside = ProjectionVolumeBuilder::estimateHitRate(box, box, { { Emitter::Type::Triangle, float3(0.1f, 0.f, 0.f), float3(0.f, 1.f, 0.f) } }, samplesPerEmitter, 1u);
+        EXPECT_GT(triangleInside.getHitRate(), 0.4f);
+        EXPECT_LT(triangleInside.getHitRate(), 0.6f);
+
+        // Triangles only emit on their front side.
+        const auto triangleFacing = ProjectionVolumeBuilder::estimateHitRate(box, box, { { Emitter::Type::Triangle, float3(0.f, 10.f, 0.f), float3(0.f, -1.f, 0.f) } }, samplesPerEmitter, 1u);
+        const auto triangleFacingAway = ProjectionVolumeBuilder::estimateHitRate(box, box, { { Emitter::Type::Triangle, float3(0.f, 10.f, 0.f), float3(0.f, 1.f, 0.f) } }, samplesPerEmitter, 1u);
+        EXPECT_GT(triangleFacing.getHitRate(), 0.5f);
+        EXPECT_EQ(triangleFacingAway.hitCount, 0);
+
+        // Directional lights sample the projected area of the volumes.
+        const auto casters = createScatteredCasters(4, 10.f, 0.5f);
+        const std::vector<Emitter> sun = { { Emitter::Type::Directional, float3(0.f), float3(0.f, -1.f, 0.f) } };
+        const auto singleEstimate = ProjectionVolumeBuilder::estimateHitRate(ProjectionVolumeBuilder::build(casters, 1), casters, sun, samplesPerEmitter, 1u);
+        const auto perCasterEstimate = ProjectionVolumeBuilder::estimateHitRate(ProjectionVolumeBuilder::build(casters, (uint32_t)casters.size()), casters, sun, samplesPerEmitter, 1u);
+        EXPECT_EQ(singleEstimate.sampleCount, samplesPerEmitter);
+        EXPECT_LT(singleEstimate.getHitRate(), 0.1f);
+        EXPECT_GT(perCasterEstimate.getHitRate(), 0.99f);
+        EXPECT_EQ(perCasterEstimate.averageSolidAngle, 0.f);
+    }
+
+    CPU_TEST(ProjectionVolumeBuilder_DirectionPdf)
+    {
+        // The first volume contains the origin, the others are seen from outside.
+        const std::vector<AABB> volumes =
+        {
+            AABB(float3(-1.f), float3(1.f)),
+            AABB(float3(3.f, 0.f, 0.f), float3(4.f, 1.f, 1.f)),
+            AABB(float3(0.f, 5.f, -2.f), float3(2.f, 6.f, 2.f)),
+        };
+        const float3 origin = float3(0.2f, -0.1f, 0.3f);
+        const uint32_t sampleCount = 200000;
+
+        for (bool useCenterCone : { false, true })
+        {
+            std::mt19937 rng(7u);
+            std::uniform_real_distribution<float> dist(0.f, 1.f);
+
+            // The pdf integrates to one over the sphere of directions.
+            double pdfSum = 0.0;
+            for (uint32_t i = 0; i < sampleCount; ++i)
+            {
+                const float z = 1.f - 2.f * dist(rng);
+                const float r = std::sqrt(std::max(0.f, 1.f - z * z));
+                const float phi = 2.f * glm::pi<float>() * dist(rng);
+                pdfSum += ProjectionVolumeBuilder::evalDirectionPdf(volumes, origin, useCenterCone, float3(r * std::cos(phi), r * std::sin(phi), z));
+            }
+            const double pdfIntegral = 4.0 * glm::pi<double>() * pdfSum / sampleCount;
+            EXPECT_LE(std::abs(pdfIntegral - 1.0), 0.01) << "useCenterCone = " << useCenterCone << ", integral = " << pdfIntegral;
+
+            // Every sample succeeds and reports the pdf of the mixture, so the inverse pdfs sum up to the whole sphere.
+            uint32_t failedCount = 0;
+            double inversePdfSum = 0.0;
+            for (uint32_t i = 0; i < sampleCount; ++i)
+            {
+                float3 dir;
+                float pdf;
+                const float uSelect = dist(rng);
+                const float2 u = float2(dist(rng), dist(rng));
+                if (!ProjectionVolumeBuilder::sampleDirection(volumes, origin, useCenterCone, uSelect, u, dir, pdf))
+                {
+                    ++failedCount;
+                    continue;
+                }
+                EXPECT_LE(std::abs(pdf - ProjectionVolumeBuilder::evalDirectionPdf(volumes, origin, useCenterCone, dir)), 1e-3f * pdf);
+                inversePdfSum += 1.0 / pdf;
+            }
+            EXPECT_EQ(failedCount, 0);
+            const double sphereEstimate = inversePdfSum / sampleCount / (4.0 * glm::pi<double>());
+            EXPECT_LE(std::abs(sphereEstimate - 1.0), 0.01) << "useCenterCone = " << useCenterCone << ", estimate = " << sphereEstimate;
+        }
+    }
+}
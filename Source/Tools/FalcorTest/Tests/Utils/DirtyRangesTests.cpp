@@ -0,0 +1,160 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Algorithm/DirtyRanges.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        using Range = DirtyRanges::Range;
+
+        /** Buffer stand-in recording the writes made by DirtyRanges::upload().
+        */
+        struct RecordingBuffer
+        {
+            std::vector<uint8_t> data;
+            std::vector<std::pair<size_t, size_t>> writes;
+
+            bool setBlob(const void* pData, size_t offset, size_t size)
+            {
+                std::memcpy(data.data() + offset, pData, size);
+                writes.push_back({ offset, size });
+                return true;
+            }
+        };
+    }
+
+    CPU_TEST(DirtyRanges_Coalesce)
+    {
+        DirtyRanges ranges;
+        EXPECT(ranges.empty());
+        EXPECT(ranges.coalesce().empty());
+
+        // Sequential marks are merged as they are added.
+        for (uint32_t i = 10; i < 20; i++) ranges.mark(i);
+        EXPECT_EQ(ranges.coalesce().size(), 1);
+        EXPECT(ranges.coalesce()[0] == (Range{ 10, 20 }));
+
+        // Out of order and overlapping marks.
+        ranges.mark(30, 40);
+        ranges.mark(0, 5);
+        ranges.mark(35, 45);
+        ranges.mark(4, 11);
+        ranges.mark(50);
+        ranges.mark(7, 7); // Empty range is ignored.
+
+        const auto& result = ranges.coalesce();
+        EXPECT_EQ(result.size(), 3);
+        EXPECT(result[0] == (Range{ 0, 20 }));
+        EXPECT(result[1] == (Range{ 30, 45 }));
+        EXPECT(result[2] == (Range{ 50, 51 }));
+        EXPECT_EQ(ranges.getDirtyCount(), 36);
+
+        // Merge ranges separated by small gaps.
+        const auto& merged = ranges.coalesce(5);
+        EXPECT_EQ(merged.size(), 2);
+        EXPECT(merged[0] == (Range{ 0, 20 }));
+        EXPECT(merged[1] == (Range{ 30, 51 }));
+
+        ranges.clear();
+        EXPECT(ranges.empty());
+    }
+
+    CPU_TEST(DirtyRanges_Random)
+    {
+        // Compare the coalesced ranges against a per-element reference.
+        std::mt19937 rng(0);
+        const uint32_t n = 1000;
+
+        for (uint32_t iter = 0; iter < 100; iter++)
+        {
+            DirtyRanges ranges;
+            std::vector<bool> dirty(n, false);
+            uint32_t markCount = (uint32_t)(rng() % 50);
+            for (uint32_t i = 0; i < markCount; i++)
+            {
+                uint32_t begin = (uint32_t)(rng() % n);
+                uint32_t end = std::min(n, begin + (uint32_t)(rng() % 20));
+                ranges.mark(begin, end);
+                for (uint32_t j = begin; j < end; j++) dirty[j] = true;
+            }
+
+            std::vector<bool> result(n, false);
+            uint32_t prevEnd = 0;
+            bool first = true;
+            for (const auto& r : ranges.coalesce())
+            {
+                EXPECT_LT(r.begin, r.end);
+                if (!first) EXPECT_GT(r.begin, prevEnd) << "Ranges must be sorted, disjoint and not adjoining";
+                for (uint32_t j = r.begin; j < r.end; j++) result[j] = true;
+                prevEnd = r.end;
+                first = false;
+            }
+            EXPECT(result == dirty);
+        }
+    }
+
+    CPU_TEST(DirtyRanges_Upload)
+    {
+        const uint32_t n = 64;
+        std::vector<uint32_t> elements(n);
+        for (uint32_t i = 0; i < n; i++) elements[i] = i;
+
+        RecordingBuffer buffer;
+        buffer.data.resize(n * sizeof(uint32_t), 0);
+
+        DirtyRanges ranges;
+        ranges.mark(60, 64);
+        ranges.mark(3);
+        ranges.mark(4);
+        ranges.mark(8);
+
+        uint64_t bytes = ranges.upload(&buffer, elements.data(), sizeof(uint32_t));
+        EXPECT_EQ(bytes, 7 * sizeof(uint32_t));
+        EXPECT_EQ(buffer.writes.size(), 3);
+        EXPECT(ranges.empty());
+
+        // Only the dirty elements are written.
+        const uint32_t* pData = reinterpret_cast<const uint32_t*>(buffer.data.data());
+        for (uint32_t i = 0; i < n; i++)
+        {
+            bool dirty = i == 3 || i == 4 || i == 8 || i >= 60;
+            EXPECT_EQ(pData[i], dirty ? i : 0) << "i = " << i;
+        }
+
+        // With a gap tolerance the writes are merged.
+        buffer.writes.clear();
+        ranges.mark(3);
+        ranges.mark(8);
+        bytes = ranges.upload(&buffer, elements.data(), sizeof(uint32_t), 4);
+        EXPECT_EQ(bytes, 6 * sizeof(uint32_t));
+        EXPECT_EQ(buffer.writes.size(), 1);
+    }
+}
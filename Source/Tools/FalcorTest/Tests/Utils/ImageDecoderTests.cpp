@@ -0,0 +1,504 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/ImageDecoder.h"
+#include "Utils/Image/PixelConversion.h"
+#include <FreeImage.h>
+#include <filesystem>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        enum class ExrCompression : uint8_t
+        {
+            None = 0,
+            RLE = 1,
+            ZIPS = 2,
+            ZIP = 3,
+            PIZ = 4,
+        };
+
+        struct ExrDesc
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            int32_t minX = 0;
+            int32_t minY = 0;
+            bool hasAlpha = true;
+            bool isHalf = true;
+            ExrCompression compression = ExrCompression::None;
+            uint32_t tileSize = 0;  ///< Tile size, or 0 for a scanline file.
+        };
+
+        template<typename T>
+        void append(std::vector<uint8_t>& data, const T& value)
+        {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+            data.insert(data.end(), p, p + sizeof(T));
+        }
+
+        void appendString(std::vector<uint8_t>& data, const std::string& str)
+        {
+            data.insert(data.end(), str.begin(), str.end());
+            data.push_back(0);
+        }
+
+        void appendAttribute(std::vector<uint8_t>& data, const std::string& name, const std::string& type, const std::vector<uint8_t>& value)
+        {
+            appendString(data, name);
+            appendString(data, type);
+            append(data, (int32_t)value.size());
+            data.insert(data.end(), value.begin(), value.end());
+        }
+
+        /** Compress a block as described in the OpenEXR file layout: split even and odd bytes, apply the byte predictor, then run-length encode or deflate.
+        */
+        std::vector<uint8_t> compressExrBlock(const std::vector<uint8_t>& raw, ExrCompression compression)
+        {
+            const size_t size = raw.size();
+            std::vector<uint8_t> tmp(size);
+            for (size_t i = 0; i < size; i++) tmp[(i & 1) ? (size + 1) / 2 + i / 2 : i / 2] = raw[i];
+            for (size_t i = size - 1; i > 0; i--) tmp[i] = uint8_t(int(tmp[i]) - int(tmp[i - 1]) + 128);
+
+            std::vector<uint8_t> packed;
+            if (compression == ExrCompression::RLE)
+            {
+                for (size_t i = 0; i < size;)
+                {
+                    size_t run = 1;
+                    while (i + run < size && run < 128 && tmp[i + run] == tmp[i]) run++;
+                    if (run >= 3)
+                    {
+                        packed.push_back(uint8_t(run - 1));
+                        packed.push_back(tmp[i]);
+                        i += run;
+                        continue;
+                    }
+                    size_t literal = 1;
+                    while (i + literal < size && literal < 127 && !(i + literal + 2 < size && tmp[i + literal] == tmp[i + literal + 1] && tmp[i + literal] == tmp[i + literal + 2])) literal++;
+                    packed.push_back(uint8_t(-int(literal)));
+                    packed.insert(packed.end(), tmp.begin() + i, tmp.begin() + i + literal);
+                    i += literal;
+                }
+            }
+            else
+            {
+                packed.resize(size + size / 100 + 64);
+                DWORD packedSize = FreeImage_ZLibCompress(packed.data(), (DWORD)packed.size(), tmp.data(), (DWORD)size);
+                packed.resize(packedSize);
+            }
+            return packed;
+        }
+
+        /** Encode an EXR file from top-down RGBA pixels.
+            Chunks are written in reverse order to check that the decoder follows the offset table.
+        */
+        std::vector<uint8_t> encodeExr(const ExrDesc& desc, const std::vector<float>& pixels)
+        {
+            // Channels are sorted by name. Each entry is the index of the channel in an RGBA pixel.
+            std::vector<uint32_t> channels = desc.hasAlpha ? std::vector<uint32_t>{ 3, 2, 1, 0 } : std::vector<uint32_t>{ 2, 1, 0 };
+            const char* kNames[] = { "R", "G", "B", "A" };
+
+            std::vector<uint8_t> data;
+            append(data, 20000630u);
+            append(data, 2u | (desc.tileSize ? 0x200u : 0u));
+
+            std::vector<uint8_t> value;
+            for (uint32_t c : channels)
+            {
+                appendString(value, kNames[c]);
+                append(value, desc.isHalf ? 1 : 2);
+                append(value, 0u);
+                append(value, 1);
+                append(value, 1);
+            }
+            value.push_back(0);
+            appendAttribute(data, "channels", "chlist", value);
+
+            appendAttribute(data, "comments", "string", { 'T', 'e', 's', 't' });
+            appendAttribute(data, "compression", "compression", { (uint8_t)desc.compression });
+
+            value.clear();
+            append(value, desc.minX);
+            append(value, desc.minY);
+            append(value, desc.minX + int32_t(desc.width) - 1);
+            append(value, desc.minY + int32_t(desc.height) - 1);
+            appendAttribute(data, "dataWindow", "box2i", value);
+            appendAttribute(data, "displayWindow", "box2i", value);
+
+            if (desc.tileSize)
+            {
+                value.clear();
+                append(value, desc.tileSize);
+                append(value, desc.tileSize);
+                value.push_back(0);
+                appendAttribute(data, "tiles", "tiledesc", value);
+            }
+            data.push_back(0);
+
+            // Chunk rectangles (x, y, width, height).
+            std::vector<uint4> chunks;
+            if (desc.tileSize)
+            {
+                for (uint32_t y = 0; y < desc.height; y += desc.tileSize)
+                {
+                    for (uint32_t x = 0; x < desc.width; x += desc.tileSize) chunks.push_back({ x, y, std::min(desc.tileSize, desc.width - x), std::min(desc.tileSize, desc.height - y) });
+                }
+            }
+            else
+            {
+                const uint32_t linesPerBlock = desc.compression == ExrCompression::ZIP ? 16 : 1;
+                for (uint32_t y = 0; y < desc.height; y += linesPerBlock) chunks.push_back({ 0, y, desc.width, std::min(linesPerBlock, desc.height - y) });
+            }
+
+            const size_t offsetTable = data.size();
+            data.resize(data.size() + chunks.size() * sizeof(uint64_t));
+
+            for (size_t i = chunks.size(); i-- > 0;)
+            {
+                const uint4 chunk = chunks[i];
+                std::vector<uint8_t> raw;
+                for (uint32_t y = chunk.y; y < chunk.y + chunk.w; y++)
+                {
+                    for (uint32_t c : channels)
+                    {
+                        for (uint32_t x = chunk.x; x < chunk.x + chunk.z; x++)
+                        {
+                            const float v = pixels[4 * (size_t(y) * desc.width + x) + c];
+                            if (desc.isHalf)
+                            {
+                                uint16_t h;
+                                convertFloatToHalf(&v, &h, 1);
+                                append(raw, h);
+                            }
+                            else append(raw, v);
+                        }
+                    }
+                }
+
+                std::vector<uint8_t> packed = desc.compression == ExrCompression::None ? raw : compressExrBlock(raw, desc.compression);
+                if (packed.size() >= raw.size()) packed = raw;
+
+                const uint64_t offset = data.size();
+                std::memcpy(data.data() + offsetTable + i * sizeof(uint64_t), &offset, sizeof(offset));
+                if (desc.tileSize)
+                {
+                    append(data, int32_t(chunk.x / desc.tileSize));
+                    append(data, int32_t(chunk.y / desc.tileSize));
+                    append(data, 0);
+                    append(data, 0);
+                }
+                else
+                {
+                    append(data, desc.minY + int32_t(chunk.y));
+                }
+                append(data, (int32_t)packed.size());
+                data.insert(data.end(), packed.begin(), packed.end());
+            }
+            return data;
+        }
+
+        /** Create top-down RGBA test pixels. Values are representable as halfs and mostly smooth, so that blocks compress, with a noisy band that doesn't.
+        */
+        std::vector<float> createPixels(uint32_t width, uint32_t height, bool hasAlpha)
+        {
+            std::mt19937 rng;
+            std::vector<float> pixels(4 * size_t(width) * height);
+            for (uint32_t y = 0; y < height; y++)
+            {
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    for (uint32_t c = 0; c < 4; c++)
+                    {
+                        float v = (y > height / 2 && y < height / 2 + 4) ? float(rng() % 4096) / 64.f - 32.f : float((x * 3 + y * 5 + c * 7) % 64) / 16.f - 1.f;
+                        if (c == 3) v = hasAlpha ? std::abs(v) : 1.f;
+                        pixels[4 * (size_t(y) * width + x) + c] = v;
+                    }
+                }
+            }
+            return pixels;
+        }
+
+        /** Decode an image with both row orders and compare to the expected top-down RGBA pixels.
+        */
+        void checkDecode(CPUUnitTestContext& ctx, ImageDecoder& decoder, const std::vector<float>& expected, const std::string& desc)
+        {
+            const uint32_t width = decoder.getWidth();
+            const uint32_t height = decoder.getHeight();
+            const uint32_t rowPitch = width * 4 * sizeof(float);
+            for (bool isTopDown : { true, false })
+            {
+                std::vector<float> pixels(4 * size_t(width) * height, -1.f);
+                EXPECT(decoder.decode(reinterpret_cast<uint8_t*>(pixels.data()), rowPitch, isTopDown)) << desc;
+                for (uint32_t y = 0; y < height; y++)
+                {
+                    const float* pRow = pixels.data() + 4 * size_t(isTopDown ? y : height - 1 - y) * width;
+                    const float* pExpected = expected.data() + 4 * size_t(y) * width;
+                    if (std::memcmp(pRow, pExpected, rowPitch) != 0)
+                    {
+                        EXPECT(false) << desc << ", isTopDown = " << isTopDown << ", mismatch in row " << y;
+                        break;
+                    }
+                }
+            }
+        }
+
+        /** Get top-down RGBA pixels from a FreeImage bitmap of type FIT_RGBF or FIT_RGBAF.
+        */
+        std::vector<float> getFreeImagePixels(FIBITMAP* pDib)
+        {
+            const uint32_t width = FreeImage_GetWidth(pDib);
+            const uint32_t height = FreeImage_GetHeight(pDib);
+            const bool hasAlpha = FreeImage_GetImageType(pDib) == FIT_RGBAF;
+            std::vector<float> pixels(4 * size_t(width) * height);
+            for (uint32_t y = 0; y < height; y++)
+            {
+                const float* pSrc = reinterpret_cast<const float*>(FreeImage_GetScanLine(pDib, height - 1 - y));
+                float* pDst = pixels.data() + 4 * size_t(y) * width;
+                if (hasAlpha) std::memcpy(pDst, pSrc, 4 * sizeof(float) * width);
+                else convertRGBToRGBA32Float(pSrc, pDst, width);
+            }
+            return pixels;
+        }
+
+        /** Create a FreeImage bitmap from top-down RGBA pixels.
+        */
+        FIBITMAP* createFreeImageBitmap(uint32_t width, uint32_t height, bool hasAlpha, const std::vector<float>& pixels)
+        {
+            FIBITMAP* pDib = FreeImage_AllocateT(hasAlpha ? FIT_RGBAF : FIT_RGBF, width, height);
+            for (uint32_t y = 0; y < height; y++)
+            {
+                float* pDst = reinterpret_cast<float*>(FreeImage_GetScanLine(pDib, height - 1 - y));
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    for (uint32_t c = 0; c < (hasAlpha ? 4u : 3u); c++) *pDst++ = pixels[4 * (size_t(y) * width + x) + c];
+                }
+            }
+            return pDib;
+        }
+    }
+
+    CPU_TEST(ImageDecoder_ExrScanline)
+    {
+        for (auto compression : { ExrCompression::None, ExrCompression::RLE, ExrCompression::ZIPS, ExrCompression::ZIP })
+        {
+            for (bool isHalf : { true, false })
+            {
+                for (bool hasAlpha : { true, false })
+                {
+                    ExrDesc desc;
+                    desc.width = 67;
+                    desc.height = 41;
+                    desc.minX = -3;
+                    desc.minY = 5;
+                    desc.hasAlpha = hasAlpha;
+                    desc.isHalf = isHalf;
+                    desc.compression = compression;
+
+                    const std::string name = "compression = " + std::to_string((int)compression) + ", isHalf = " + std::to_string(isHalf) + ", hasAlpha = " + std::to_string(hasAlpha);
+                    const auto pixels = createPixels(desc.width, desc.height, hasAlpha);
+
+                    auto pDecoder = ImageDecoder::create(ImageDecoder::Format::Exr);
+                    EXPECT(pDecoder->open(encodeExr(desc, pixels))) << name;
+                    EXPECT_EQ(pDecoder->getWidth(), desc.width);
+                    EXPECT_EQ(pDecoder->getHeight(), desc.height);
+                    EXPECT_EQ(pDecoder->hasAlpha(), hasAlpha);
+                    checkDecode(ctx, *pDecoder, pixels, name);
+                }
+            }
+        }
+    }
+
+    CPU_TEST(ImageDecoder_ExrTiled)
+    {
+        for (auto compression : { ExrCompression::None, ExrCompression::ZIP })
+        {
+            ExrDesc desc;
+            desc.width = 37;
+            desc.height = 50;
+            desc.compression = compression;
+            desc.tileSize = 16;
+
+            const auto pixels = createPixels(desc.width, desc.height, true);
+            auto pDecoder = ImageDecoder::create(ImageDecoder::Format::Exr);
+            EXPECT(pDecoder->open(encodeExr(desc, pixels)));
+            checkDecode(ctx, *pDecoder, pixels, "tiled, compression = " + std::to_string((int)compression));
+        }
+    }
+
+    CPU_TEST(ImageDecoder_ExrUnsupported)
+    {
+        ExrDesc desc;
+        desc.width = 16;
+        desc.height = 16;
+        const auto pixels = createPixels(desc.width, desc.height, true);
+        auto pDecoder = ImageDecoder::create(ImageDecoder::Format::Exr);
+
+        // Unsupported compression.
+        desc.compression = ExrCompression::PIZ;
+        EXPECT(!pDecoder->open(encodeExr(desc, pixels)));
+
+        // Truncated files fail either when reading the offset table or when decoding.
+        desc.compression = ExrCompression::ZIP;
+        auto data = encodeExr(desc, pixels);
+        data.resize(data.size() - 10);
+        if (pDecoder->open(data))
+        {
+            std::vector<float> result(pixels.size());
+            EXPECT(!pDecoder->decode(reinterpret_cast<uint8_t*>(result.data()), desc.width * 16, true));
+        }
+
+        // Not an EXR file.
+        EXPECT(!pDecoder->open(std::vector<uint8_t>(256, 0)));
+    }
+
+    CPU_TEST(ImageDecoder_HdrFlat)
+    {
+        // Scanlines narrower than 8 pixels can't be run-length encoded.
+        const uint32_t width = 5, height = 3;
+        std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+        std::vector<uint8_t> data(header.begin(), header.end());
+
+        std::vector<float> expected;
+        for (uint32_t i = 0; i < width * height; i++)
+        {
+            const uint8_t rgbe[4] = { uint8_t(i * 10), uint8_t(i * 3), 255, uint8_t(i == 4 ? 0 : 120 + i) };
+            data.insert(data.end(), rgbe, rgbe + 4);
+            const float scale = rgbe[3] != 0 ? (float)std::ldexp(1.0, rgbe[3] - 136) : 0.f;
+            expected.insert(expected.end(), { rgbe[0] * scale, rgbe[1] * scale, rgbe[2] * scale, 1.f });
+        }
+
+        auto pDecoder = ImageDecoder::create(ImageDecoder::Format::Hdr);
+        EXPECT(pDecoder->open(data));
+        EXPECT_EQ(pDecoder->getWidth(), width);
+        EXPECT_EQ(pDecoder->getHeight(), height);
+        EXPECT(!pDecoder->hasAlpha());
+        checkDecode(ctx, *pDecoder, expected, "flat HDR");
+
+        // Other orientations are not supported.
+        header = "#?RADIANCE\n\n+Y 3 +X 5\n";
+        data.assign(header.begin(), header.end());
+        data.resize(data.size() + 4 * width * height);
+        EXPECT(!pDecoder->open(data));
+    }
+
+    CPU_TEST(ImageDecoder_FreeImageFiles)
+    {
+        // Decode files written by FreeImage and compare to the pixels loaded by FreeImage.
+        const uint32_t width = 300, height = 200;
+        const std::string path = (std::filesystem::temp_directory_path() / "ImageDecoderTests").string();
+
+        struct File { FREE_IMAGE_FORMAT format; int flags; bool hasAlpha; const char* ext; };
+        const File files[] =
+        {
+            { FIF_EXR, EXR_FLOAT | EXR_NONE, true, ".exr" },
+            { FIF_EXR, EXR_FLOAT | EXR_ZIP, false, ".exr" },
+            { FIF_EXR, EXR_ZIP, true, ".exr" },
+            { FIF_HDR, 0, false, ".hdr" },
+        };
+
+        for (const auto& file : files)
+        {
+            const std::string filename = path + file.ext;
+            const auto pixels = createPixels(width, height, file.hasAlpha);
+            FIBITMAP* pDib = createFreeImageBitmap(width, height, file.hasAlpha, pixels);
+            EXPECT(FreeImage_Save(file.format, pDib, filename.c_str(), file.flags)) << filename;
+            FreeImage_Unload(pDib);
+
+            pDib = FreeImage_Load(file.format, filename.c_str());
+            const auto expected = getFreeImagePixels(pDib);
+            FreeImage_Unload(pDib);
+
+            auto pDecoder = ImageDecoder::create(file.format == FIF_EXR ? ImageDecoder::Format::Exr : ImageDecoder::Format::Hdr);
+            EXPECT(pDecoder->open(filename)) << filename << ", flags = " << file.flags;
+            EXPECT_EQ(pDecoder->getFileSize(), std::filesystem::file_size(filename));
+            checkDecode(ctx, *pDecoder, expected, filename);
+
+            // Bitmap loads the file with the decoder. Bitmaps are top-down, with the row pitch of RGBA32Float.
+            Bitmap::resetLoadStats();
+            auto pBitmap = Bitmap::createFromFile(filename, true);
+            EXPECT(pBitmap != nullptr);
+            EXPECT_EQ(pBitmap->getFormat(), ResourceFormat::RGBA32Float);
+            EXPECT(std::memcmp(pBitmap->getData(), expected.data(), expected.size() * sizeof(float)) == 0) << filename;
+
+            const auto stats = Bitmap::getLoadStats();
+            const auto it = stats.find(file.format == FIF_EXR ? "EXR" : "HDR");
+            EXPECT(it != stats.end());
+            if (it != stats.end())
+            {
+                EXPECT_EQ(it->second.fileCount, 1);
+                EXPECT_EQ(it->second.decoderFileCount, 1);
+                EXPECT_EQ(it->second.pixelCount, width * height);
+            }
+            std::filesystem::remove(filename);
+        }
+    }
+
+    CPU_TEST(ImageDecoder_Benchmark)
+    {
+        // Compare loading large HDR images with Bitmap (parallel decoders) and with FreeImage alone.
+        const uint32_t width = 4096, height = 2048;
+        const std::string path = (std::filesystem::temp_directory_path() / "ImageDecoderBenchmark").string();
+        const auto pixels = createPixels(width, height, true);
+
+        struct File { FREE_IMAGE_FORMAT format; int flags; bool hasAlpha; const char* ext; const char* name; };
+        const File files[] =
+        {
+            { FIF_EXR, EXR_ZIP, true, ".exr", "EXR half ZIP" },
+            { FIF_EXR, EXR_FLOAT | EXR_NONE, false, ".exr", "EXR float uncompressed" },
+            { FIF_HDR, 0, false, ".hdr", "HDR" },
+        };
+
+        for (const auto& file : files)
+        {
+            const std::string filename = path + file.ext;
+            FIBITMAP* pDib = createFreeImageBitmap(width, height, file.hasAlpha, pixels);
+            FreeImage_Save(file.format, pDib, filename.c_str(), file.flags);
+            FreeImage_Unload(pDib);
+            const double megabytes = std::filesystem::file_size(filename) * 1e-6;
+
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            pDib = FreeImage_Load(file.format, filename.c_str());
+            const auto reference = getFreeImagePixels(pDib);
+            FreeImage_Unload(pDib);
+            double freeImageMs = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+            startTime = CpuTimer::getCurrentTimePoint();
+            auto pBitmap = Bitmap::createFromFile(filename, true);
+            double bitmapMs = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+            EXPECT(pBitmap != nullptr);
+            if (pBitmap) EXPECT(std::memcmp(pBitmap->getData(), reference.data(), reference.size() * sizeof(float)) == 0) << file.name;
+
+            logInfo(std::string("Image load (") + file.name + ", " + std::to_string(width) + "x" + std::to_string(height) + "): FreeImage " + std::to_string(freeImageMs) + " ms (" + std::to_string(megabytes / (freeImageMs * 1e-3)) + " MB/s), " +
+                "Bitmap " + std::to_string(bitmapMs) + " ms (" + std::to_string(megabytes / (bitmapMs * 1e-3)) + " MB/s), speedup " + std::to_string(freeImageMs / bitmapMs) + "x");
+            std::filesystem::remove(filename);
+        }
+    }
+}
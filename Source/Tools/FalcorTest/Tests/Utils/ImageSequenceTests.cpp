@@ -0,0 +1,266 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/ImageSequence.h"
+#include <filesystem>
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Create a 1x1 RGBA32Float bitmap holding the frame index.
+        */
+        Bitmap::UniqueConstPtr createFrame(uint32_t frame)
+        {
+            const float pixel[4] = { (float)frame, 0.f, 0.f, 1.f };
+            return Bitmap::create(1, 1, ResourceFormat::RGBA32Float, reinterpret_cast<const uint8_t*>(pixel));
+        }
+
+        float getFrameValue(const ImageSequence::FramePtr& pFrame)
+        {
+            return pFrame ? reinterpret_cast<const float*>(pFrame->getData())[0] : -1.f;
+        }
+
+        /** Decode function that takes a fixed time per frame and counts the decoded frames.
+        */
+        struct TestDecoder
+        {
+            std::chrono::milliseconds delay{ 0 };
+            std::vector<std::atomic<uint32_t>> decodeCount;
+
+            TestDecoder(uint32_t frameCount, uint32_t delayMs) : delay(delayMs), decodeCount(frameCount) {}
+
+            ImageSequence::DecodeFunc getFunc()
+            {
+                return [this](uint32_t frame)
+                {
+                    if (delay.count() > 0) std::this_thread::sleep_for(delay);
+                    decodeCount[frame]++;
+                    return createFrame(frame);
+                };
+            }
+        };
+
+        /** Wait until a frame is decoded, or the timeout expires.
+        */
+        bool waitForFrame(const ImageSequence& sequence, uint32_t frame)
+        {
+            for (uint32_t i = 0; i < 1000 && !sequence.isFrameReady(frame); i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return sequence.isFrameReady(frame);
+        }
+    }
+
+    CPU_TEST(ImageSequence_FormatFilename)
+    {
+        EXPECT_EQ(ImageSequence::formatFilename("frame%d.png", 7), "frame7.png");
+        EXPECT_EQ(ImageSequence::formatFilename("frame%04d.exr", 7), "frame0007.exr");
+        EXPECT_EQ(ImageSequence::formatFilename("frame%04d.exr", 123456), "frame123456.exr");
+        EXPECT_EQ(ImageSequence::formatFilename("dir/f_####.hdr", 42), "dir/f_0042.hdr");
+        EXPECT_EQ(ImageSequence::formatFilename("#/f_##.hdr", 3), "#/f_03.hdr");
+        EXPECT_EQ(ImageSequence::formatFilename("100%_%03d.png", 5), "100%_005.png");
+        EXPECT_EQ(ImageSequence::formatFilename("frame.png", 5), "");
+    }
+
+    CPU_TEST(ImageSequence_Playback)
+    {
+        // Play the sequence twice with looping. Every frame must be correct and decoded once per pass.
+        const uint32_t frameCount = 20;
+        TestDecoder decoder(frameCount, 1);
+        ImageSequence::Desc desc;
+        desc.frameCount = frameCount;
+        desc.bufferSize = 4;
+        desc.threadCount = 2;
+        auto pSequence = ImageSequence::create(decoder.getFunc(), desc);
+        EXPECT(pSequence != nullptr);
+        if (!pSequence) return;
+
+        for (uint32_t i = 0; i < 2 * frameCount; i++)
+        {
+            EXPECT_EQ(getFrameValue(pSequence->getFrame(i % frameCount)), (float)(i % frameCount)) << "i = " << i;
+        }
+
+        const auto stats = pSequence->getStats();
+        EXPECT_EQ(stats.requests, 2 * frameCount);
+        EXPECT_EQ(stats.hits + stats.misses, stats.requests);
+        EXPECT_EQ(stats.decodeFailures, 0);
+        EXPECT_EQ(stats.framesDiscarded, 0);
+        EXPECT_LE(stats.framesReady, desc.bufferSize);
+
+        // The frames ahead of the last one are decoded a third time by the prefetching.
+        for (uint32_t frame = 0; frame < frameCount; frame++)
+        {
+            EXPECT_GE(decoder.decodeCount[frame].load(), 2u) << "frame = " << frame;
+            EXPECT_LE(decoder.decodeCount[frame].load(), 3u) << "frame = " << frame;
+        }
+        EXPECT_LE(stats.framesDecoded, 2 * frameCount + desc.bufferSize);
+    }
+
+    CPU_TEST(ImageSequence_Prefetch)
+    {
+        // Requests slower than decoding find their frames ready, except the first one.
+        const uint32_t frameCount = 30;
+        TestDecoder decoder(frameCount, 2);
+        ImageSequence::Desc desc;
+        desc.frameCount = frameCount;
+        desc.bufferSize = 4;
+        auto pSequence = ImageSequence::create(decoder.getFunc(), desc);
+        EXPECT(pSequence != nullptr);
+        if (!pSequence) return;
+
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            EXPECT_EQ(getFrameValue(pSequence->getFrame(i)), (float)i);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        const auto stats = pSequence->getStats();
+        EXPECT_GE(stats.hits, frameCount - 3);
+        EXPECT_GE(stats.getHitRate(), 0.9);
+        EXPECT_GT(stats.getAverageDecodeTime(), 0.0);
+    }
+
+    CPU_TEST(ImageSequence_Window)
+    {
+        // The ring buffer is filled with the current frame and the following ones, and nothing past them is decoded.
+        const uint32_t frameCount = 16;
+        TestDecoder decoder(frameCount, 0);
+        ImageSequence::Desc desc;
+        desc.frameCount = frameCount;
+        desc.bufferSize = 5;
+        desc.loop = false;
+        auto pSequence = ImageSequence::create(decoder.getFunc(), desc);
+        EXPECT(pSequence != nullptr);
+        if (!pSequence) return;
+
+        for (uint32_t position : { 0u, 3u, 9u, 14u })
+        {
+            pSequence->getFrame(position);
+            const uint32_t last = std::min(position + desc.bufferSize, frameCount) - 1;
+            for (uint32_t frame = position; frame <= last; frame++) EXPECT(waitForFrame(*pSequence, frame)) << "position = " << position;
+            for (uint32_t frame = position; frame < frameCount; frame++)
+            {
+                EXPECT_EQ(pSequence->isFrameReady(frame), frame <= last) << "position = " << position << ", frame = " << frame;
+            }
+            EXPECT_LE(pSequence->getStats().framesReady, desc.bufferSize);
+        }
+
+        // Without looping, nothing is decoded past the end.
+        EXPECT_EQ(decoder.decodeCount[0].load(), 1u);
+        EXPECT(pSequence->getFrame(frameCount) == nullptr);
+    }
+
+    CPU_TEST(ImageSequence_Seek)
+    {
+        // Seeking evicts the prefetched frames that are not needed anymore.
+        const uint32_t frameCount = 100;
+        TestDecoder decoder(frameCount, 0);
+        ImageSequence::Desc desc;
+        desc.frameCount = frameCount;
+        desc.bufferSize = 8;
+        auto pSequence = ImageSequence::create(decoder.getFunc(), desc);
+        EXPECT(pSequence != nullptr);
+        if (!pSequence) return;
+
+        EXPECT_EQ(getFrameValue(pSequence->getFrame(0)), 0.f);
+        EXPECT(waitForFrame(*pSequence, 7));
+        EXPECT_EQ(getFrameValue(pSequence->getFrame(50)), 50.f);
+        EXPECT(waitForFrame(*pSequence, 57));
+        EXPECT_EQ(getFrameValue(pSequence->getFrame(3)), 3.f);
+        for (uint32_t frame = 3; frame <= 10; frame++) EXPECT(waitForFrame(*pSequence, frame));
+
+        // The first request may find its frame decoded already. Both seeks miss.
+        const auto stats = pSequence->getStats();
+        EXPECT_GE(stats.misses, 2);
+        EXPECT_LE(stats.misses, 3);
+        EXPECT_GE(stats.framesDiscarded, 7u);
+        EXPECT_EQ(stats.framesReady, desc.bufferSize);
+        EXPECT_GT(stats.maxWaitTime, 0.0);
+
+        pSequence->resetStats();
+        EXPECT_EQ(pSequence->getStats().requests, 0);
+    }
+
+    CPU_TEST(ImageSequence_DecodeFailure)
+    {
+        ImageSequence::Desc desc;
+        desc.frameCount = 6;
+        auto decode = [](uint32_t frame) { return frame == 3 ? nullptr : createFrame(frame); };
+        auto pSequence = ImageSequence::create(decode, desc);
+        EXPECT(pSequence != nullptr);
+        if (!pSequence) return;
+
+        for (uint32_t i = 0; i < desc.frameCount; i++)
+        {
+            EXPECT_EQ(getFrameValue(pSequence->getFrame(i)), i == 3 ? -1.f : (float)i);
+        }
+        EXPECT_EQ(pSequence->getStats().decodeFailures, 1);
+
+        desc.frameCount = 0;
+        EXPECT(ImageSequence::create(decode, desc) == nullptr);
+    }
+
+    CPU_TEST(ImageSequence_Files)
+    {
+        // Write a sequence of flat Radiance HDR files, where the red channel of frame i is i.
+        const std::string path = (std::filesystem::temp_directory_path() / "ImageSequenceTests").string();
+        std::filesystem::create_directories(path);
+        const std::string pattern = path + "/frame_####.hdr";
+        const uint32_t firstFrame = 10, frameCount = 6;
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            std::ofstream file(ImageSequence::formatFilename(pattern, firstFrame + i), std::ios::binary);
+            file << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y 3 +X 5\n";
+            for (uint32_t p = 0; p < 15; p++) file << (char)i << (char)0 << (char)0 << (char)136;
+        }
+
+        // The frame count is detected from the files.
+        ImageSequence::Desc desc;
+        auto pSequence = ImageSequence::createFromFiles(pattern, firstFrame, desc);
+        EXPECT(pSequence != nullptr);
+        if (pSequence)
+        {
+            EXPECT_EQ(pSequence->getFrameCount(), frameCount);
+            for (uint32_t i = 0; i < frameCount; i++)
+            {
+                auto pFrame = pSequence->getFrame(i);
+                EXPECT(pFrame != nullptr);
+                if (!pFrame) continue;
+                EXPECT_EQ(pFrame->getWidth(), 5);
+                EXPECT_EQ(pFrame->getHeight(), 3);
+                EXPECT_EQ(getFrameValue(pFrame), (float)i);
+            }
+        }
+
+        EXPECT(ImageSequence::createFromFiles(path + "/frame.hdr", firstFrame, desc) == nullptr);
+        EXPECT(ImageSequence::createFromFiles(pattern, 0, desc) == nullptr);
+
+        pSequence = nullptr;
+        std::filesystem::remove_all(path);
+    }
+}
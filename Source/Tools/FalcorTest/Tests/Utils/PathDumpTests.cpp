@@ -0,0 +1,154 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Debug/PathDump.h"
+#include <filesystem>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kMaxVertexCount = 4;
+        const uint32_t kRecordStride = sizeof(PathDebugRecordHeader) + (kMaxVertexCount - 1) * sizeof(uint2);
+
+        /** Encode a record the same way as pathDebugEndPath() in PathDebug.slang.
+            Vertices are encoded as deltas to the previous decoded vertex, except the direction of a missed path.
+        */
+        void encodeRecord(uint8_t* pRecord, uint32_t ticket, uint32_t pathIndex, const std::vector<float3>& vertices, bool missed)
+        {
+            const uint32_t tag = ticket & 0xffff;
+
+            PathDebugRecordHeader header;
+            header.ticket = ticket;
+            header.pathIndex = pathIndex;
+            header.vertexCount = (uint32_t)vertices.size();
+            header.flags = (tag << 16) | (missed ? 1 : 0);
+            header.origin = vertices[0];
+            std::memcpy(pRecord, &header, sizeof(header));
+
+            float3 prev = vertices[0];
+            for (size_t i = 1; i < vertices.size(); i++)
+            {
+                const bool isDirection = missed && i + 1 == vertices.size();
+                const uint3 h = f32tof16(isDirection ? vertices[i] : vertices[i] - prev);
+                if (!isDirection) prev += f16tof32(h);
+
+                const uint2 v = { h.x | (h.y << 16), h.z | (tag << 16) };
+                std::memcpy(pRecord + sizeof(header) + (i - 1) * sizeof(uint2), &v, sizeof(v));
+            }
+        }
+
+        bool isClose(float3 a, float3 b) { return glm::length(a - b) < 1e-2f; }
+    }
+
+    CPU_TEST(PathDump_Decode)
+    {
+        std::vector<uint8_t> records(4 * kRecordStride, 0);
+        encodeRecord(records.data() + 0 * kRecordStride, 1, 7, { float3(0, 0, 0), float3(1, 0, 0), float3(1, 2, 0), float3(1, 2, 3) }, false);
+        encodeRecord(records.data() + 1 * kRecordStride, 5, 3, { float3(10, 0, 0), float3(10, 1, 0), float3(0, 0, 1) }, true);
+        // Record 2 is empty.
+        // Record 3 is torn: a vertex carries the tag of a different ticket.
+        encodeRecord(records.data() + 3 * kRecordStride, 9, 4, { float3(0, 0, 0), float3(1, 1, 1) }, false);
+        records[3 * kRecordStride + sizeof(PathDebugRecordHeader) + 6] ^= 1;
+
+        PathDump::FrameHeader header;
+        header.frameIndex = 2;
+        header.matchingPathCount = 12;
+        header.recordCount = 4;
+        header.recordStride = kRecordStride;
+
+        auto pDump = PathDump::decode(header, records.data());
+        const auto& paths = pDump->getPaths();
+        const auto& vertices = pDump->getVertices();
+        EXPECT_EQ(paths.size(), 2);
+        EXPECT_EQ(vertices.size(), 7);
+
+        EXPECT_EQ(paths[0].frameIndex, 2);
+        EXPECT_EQ(paths[0].pathIndex, 7);
+        EXPECT_EQ(paths[0].vertexCount, 4);
+        EXPECT(!paths[0].missed);
+        EXPECT(isClose(vertices[paths[0].firstVertex + 3], float3(1, 2, 3)));
+
+        EXPECT_EQ(paths[1].pathIndex, 3);
+        EXPECT_EQ(paths[1].vertexCount, 3);
+        EXPECT(paths[1].missed);
+        EXPECT(isClose(vertices[paths[1].firstVertex + 1], float3(10, 1, 0)));
+        EXPECT(isClose(vertices[paths[1].firstVertex + 2], float3(0, 0, 1)));
+
+        const auto stats = pDump->computeStats();
+        EXPECT_EQ(stats.frameCount, 1);
+        EXPECT_EQ(stats.matchingPathCount, 12);
+        EXPECT_EQ(stats.pathCount, 2);
+        EXPECT_EQ(stats.missedPathCount, 1);
+        EXPECT_EQ(stats.tornRecordCount, 1);
+        EXPECT_EQ(stats.segmentCount, 4);
+        EXPECT_LE(std::abs(stats.meanVertexCount - 3.5), 1e-6);
+        EXPECT_LE(std::abs(stats.meanSegmentLength - 7.0 / 4.0), 1e-2);
+        EXPECT(isClose(stats.bounds.minPoint, float3(0, 0, 0)));
+        EXPECT(isClose(stats.bounds.maxPoint, float3(10, 2, 3)));
+    }
+
+    CPU_TEST(PathDump_File)
+    {
+        const std::string path = (std::filesystem::temp_directory_path() / "PathDumpTests.pathdump").string();
+
+        std::vector<uint8_t> records(2 * kRecordStride, 0);
+        encodeRecord(records.data() + 0 * kRecordStride, 1, 0, { float3(0, 0, 0), float3(0, 1, 0) }, false);
+        encodeRecord(records.data() + 1 * kRecordStride, 2, 1, { float3(0, 0, 0), float3(0, 0, 2), float3(0, 0, 1) }, true);
+
+        {
+            auto pWriter = PathDump::Writer::create(path);
+            for (uint32_t frame = 0; frame < 3; frame++)
+            {
+                PathDump::FrameHeader header;
+                header.frameIndex = frame;
+                header.matchingPathCount = 2;
+                header.recordCount = frame == 1 ? 1 : 2;
+                header.recordStride = kRecordStride;
+                pWriter->writeFrame(header, records.data());
+            }
+            EXPECT_EQ(pWriter->getFrameCount(), 3);
+        }
+
+        auto pDump = PathDump::load(path);
+        std::filesystem::remove(path);
+
+        const auto& paths = pDump->getPaths();
+        EXPECT_EQ(paths.size(), 5);
+        EXPECT_EQ(paths[2].frameIndex, 1);
+        EXPECT_EQ(paths[4].frameIndex, 2);
+        EXPECT(paths[4].missed);
+
+        const auto stats = pDump->computeStats();
+        EXPECT_EQ(stats.frameCount, 3);
+        EXPECT_EQ(stats.matchingPathCount, 6);
+        EXPECT_EQ(stats.vertexCountHistogram.size(), 4);
+        EXPECT_EQ(stats.vertexCountHistogram[2], 3);
+        EXPECT_EQ(stats.vertexCountHistogram[3], 2);
+    }
+}
@@ -0,0 +1,264 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/PixelConversion.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        uint32_t asUint(float f) { uint32_t bits; std::memcpy(&bits, &f, sizeof(bits)); return bits; }
+        float asFloat(uint32_t bits) { float f; std::memcpy(&f, &bits, sizeof(f)); return f; }
+
+        bool isNaNHalf(uint16_t h) { return (h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0; }
+    }
+
+    CPU_TEST(PixelConversion_HalfToFloat)
+    {
+        // Convert all halfs in bulk (vectorized) and one at a time (scalar).
+        std::vector<uint16_t> halfs(65536);
+        std::iota(halfs.begin(), halfs.end(), 0);
+
+        std::vector<float> bulk(halfs.size());
+        convertHalfToFloat(halfs.data(), bulk.data(), halfs.size());
+
+        for (size_t i = 0; i < halfs.size(); i++)
+        {
+            float single;
+            convertHalfToFloat(&halfs[i], &single, 1);
+
+            if (isNaNHalf(halfs[i]))
+            {
+                EXPECT(std::isnan(bulk[i])) << "i = " << i;
+                EXPECT(std::isnan(single)) << "i = " << i;
+            }
+            else
+            {
+                EXPECT_EQ(asUint(bulk[i]), asUint(single)) << "i = " << i;
+                EXPECT_EQ(bulk[i], f16tof32((uint32_t)halfs[i])) << "i = " << i;
+            }
+        }
+    }
+
+    CPU_TEST(PixelConversion_FloatToHalf)
+    {
+        std::vector<float> values;
+        std::vector<uint16_t> expected;
+
+        // All non-NaN halfs round trip.
+        for (uint32_t h = 0; h < 65536; h++)
+        {
+            if (isNaNHalf((uint16_t)h)) continue;
+            values.push_back(f16tof32(h));
+            expected.push_back((uint16_t)h);
+        }
+
+        // Values between two consecutive halfs round to the nearest, ties to even.
+        for (uint32_t h = 0; h < 0x7bff; h++)
+        {
+            const float lo = f16tof32(h);
+            const float hi = f16tof32(h + 1);
+            const float mid = (lo + hi) * 0.5f;
+            for (uint32_t sign : { 0u, 0x8000u })
+            {
+                const float s = sign ? -1.f : 1.f;
+                values.push_back(s * mid);
+                expected.push_back(uint16_t(sign | ((h & 1) ? h + 1 : h)));
+                values.push_back(s * std::nextafter(mid, 0.f));
+                expected.push_back(uint16_t(sign | h));
+                values.push_back(s * std::nextafter(mid, hi));
+                expected.push_back(uint16_t(sign | (h + 1)));
+            }
+        }
+
+        // Overflow to infinity starts at the midpoint between the largest half and 2^16.
+        values.push_back(65520.f);
+        expected.push_back(0x7c00);
+        values.push_back(std::nextafter(65520.f, 0.f));
+        expected.push_back(0x7bff);
+        values.push_back(-1e10f);
+        expected.push_back(0xfc00);
+        values.push_back(1e-10f);
+        expected.push_back(0);
+
+        std::vector<uint16_t> bulk(values.size());
+        convertFloatToHalf(values.data(), bulk.data(), values.size());
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            uint16_t single;
+            convertFloatToHalf(&values[i], &single, 1);
+            EXPECT_EQ(bulk[i], expected[i]) << "value = " << values[i];
+            EXPECT_EQ(single, expected[i]) << "value = " << values[i];
+        }
+
+        // NaNs stay NaNs.
+        const float nan[4] = { asFloat(0x7fc00000), asFloat(0xffc00001), asFloat(0x7f800001), asFloat(0x7fffffff) };
+        uint16_t nanHalfs[4];
+        convertFloatToHalf(nan, nanHalfs, 4);
+        for (uint16_t h : nanHalfs) EXPECT(isNaNHalf(h)) << "h = " << h;
+    }
+
+    CPU_TEST(PixelConversion_Swizzle)
+    {
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> uniform(-10.f, 10.f);
+
+        // Cover the vectorized loops and the scalar tails.
+        for (size_t count = 0; count < 40; count++)
+        {
+            std::vector<float> rgb(3 * count), planes(4 * count);
+            for (auto& v : rgb) v = uniform(rng);
+            for (auto& v : planes) v = uniform(rng);
+            std::vector<uint8_t> bgr(3 * count);
+            for (auto& v : bgr) v = (uint8_t)rng();
+
+            std::vector<float> rgba(4 * count);
+            convertRGBToRGBA32Float(rgb.data(), rgba.data(), count, 0.5f);
+            for (size_t i = 0; i < count; i++)
+            {
+                for (size_t c = 0; c < 3; c++) EXPECT_EQ(rgba[4 * i + c], rgb[3 * i + c]) << "count = " << count << ", i = " << i;
+                EXPECT_EQ(rgba[4 * i + 3], 0.5f);
+            }
+
+            for (bool hasAlpha : { false, true })
+            {
+                const float* p = planes.data();
+                interleaveRGBA32Float(p, p + count, p + 2 * count, hasAlpha ? p + 3 * count : nullptr, rgba.data(), count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    for (size_t c = 0; c < 3; c++) EXPECT_EQ(rgba[4 * i + c], planes[c * count + i]) << "count = " << count << ", i = " << i;
+                    EXPECT_EQ(rgba[4 * i + 3], hasAlpha ? planes[3 * count + i] : 1.f);
+                }
+            }
+
+            std::vector<uint8_t> bgrx(4 * count);
+            convertBGRToBGRX8(bgr.data(), bgrx.data(), count);
+            for (size_t i = 0; i < count; i++)
+            {
+                for (size_t c = 0; c < 3; c++) EXPECT_EQ(bgrx[4 * i + c], bgr[3 * i + c]) << "count = " << count << ", i = " << i;
+                EXPECT_EQ(bgrx[4 * i + 3], 0xff);
+            }
+        }
+    }
+
+    CPU_TEST(PixelConversion_RGBE)
+    {
+        // All exponents, including zero and the ones producing denormal scales.
+        const size_t count = 4 * 256;
+        std::mt19937 rng;
+        std::vector<uint8_t> planes(4 * count);
+        for (auto& v : planes) v = (uint8_t)rng();
+        for (size_t i = 0; i < count; i++) planes[3 * count + i] = uint8_t(i / 4);
+
+        std::vector<float> rgba(4 * count);
+        const uint8_t* p = planes.data();
+        convertRGBEToRGBA32Float(p, p + count, p + 2 * count, p + 3 * count, rgba.data(), count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const int e = planes[3 * count + i];
+            const float scale = e != 0 ? (float)std::ldexp(1.0, e - 136) : 0.f;
+            for (size_t c = 0; c < 3; c++) EXPECT_EQ(rgba[4 * i + c], planes[c * count + i] * scale) << "i = " << i << ", e = " << e;
+            EXPECT_EQ(rgba[4 * i + 3], 1.f);
+        }
+    }
+
+    CPU_TEST(PixelConversion_RGBA8ToYUV)
+    {
+        // Reference BT.601 limited range conversion in 8-bit fixed point.
+        auto toY = [](int r, int g, int b) { return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16; };
+        auto toU = [](int r, int g, int b) { return ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128; };
+        auto toV = [](int r, int g, int b) { return ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128; };
+
+        EXPECT_EQ(toY(0, 0, 0), 16);
+        EXPECT_EQ(toY(255, 255, 255), 235);
+        EXPECT_EQ(toU(255, 255, 255), 128);
+        EXPECT_EQ(toV(255, 255, 255), 128);
+
+        std::mt19937 rng;
+
+        // Odd and even sizes cover the vectorized loop, the scalar tail and the replicated last row and column.
+        for (uint32_t width : { 1u, 2u, 7u, 8u, 9u, 16u, 23u })
+        {
+            for (uint32_t height : { 1u, 2u, 3u, 6u })
+            {
+                std::vector<uint8_t> src(4 * width * height);
+                for (auto& v : src) v = (uint8_t)rng();
+                if (width == 16) std::fill(src.begin(), src.end(), uint8_t(255)); // Extreme values
+
+                for (bool bgra : { false, true })
+                {
+                    for (bool flipY : { false, true })
+                    {
+                        for (bool subsampleY : { false, true })
+                        {
+                            const uint32_t chromaWidth = (width + 1) / 2;
+                            const uint32_t chromaHeight = subsampleY ? (height + 1) / 2 : height;
+                            const size_t yPitch = width + 3, uvPitch = chromaWidth + 5;
+                            std::vector<uint8_t> y(yPitch * height), u(uvPitch * chromaHeight), v(uvPitch * chromaHeight);
+
+                            const ptrdiff_t pitch = 4 * (ptrdiff_t)width;
+                            const uint8_t* pSrc = flipY ? src.data() + (height - 1) * pitch : src.data();
+                            convertRGBA8ToYUV(pSrc, flipY ? -pitch : pitch, bgra, width, height, y.data(), yPitch, u.data(), v.data(), uvPitch, subsampleY);
+
+                            auto pixel = [&](uint32_t px, uint32_t py, uint32_t c)
+                            {
+                                const uint32_t row = flipY ? height - 1 - py : py;
+                                const uint32_t channel = bgra && c != 1 ? 2 - c : c;
+                                return (int)src[4 * (row * width + px) + channel];
+                            };
+
+                            for (uint32_t py = 0; py < height; py++)
+                            {
+                                for (uint32_t px = 0; px < width; px++)
+                                {
+                                    EXPECT_EQ((int)y[py * yPitch + px], toY(pixel(px, py, 0), pixel(px, py, 1), pixel(px, py, 2))) << "width = " << width << ", height = " << height << ", x = " << px << ", y = " << py;
+                                }
+                            }
+
+                            for (uint32_t cy = 0; cy < chromaHeight; cy++)
+                            {
+                                for (uint32_t cx = 0; cx < chromaWidth; cx++)
+                                {
+                                    const uint32_t x0 = 2 * cx, x1 = std::min(x0 + 1, width - 1);
+                                    const uint32_t y0 = subsampleY ? 2 * cy : cy, y1 = subsampleY ? std::min(y0 + 1, height - 1) : y0;
+                                    int rgb[3];
+                                    for (uint32_t c = 0; c < 3; c++) rgb[c] = (pixel(x0, y0, c) + pixel(x1, y0, c) + pixel(x0, y1, c) + pixel(x1, y1, c) + 2) >> 2;
+
+                                    EXPECT_EQ((int)u[cy * uvPitch + cx], toU(rgb[0], rgb[1], rgb[2])) << "width = " << width << ", height = " << height << ", x = " << cx << ", y = " << cy;
+                                    EXPECT_EQ((int)v[cy * uvPitch + cx], toV(rgb[0], rgb[1], rgb[2])) << "width = " << width << ", height = " << height << ", x = " << cx << ", y = " << cy;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
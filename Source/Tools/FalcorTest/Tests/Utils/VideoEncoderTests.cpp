@@ -0,0 +1,163 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Video/VideoEncoder.h"
+#include <filesystem>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Fill a BGRA frame with a gradient that moves with the frame index.
+        */
+        void fillFrame(std::vector<uint8_t>& frame, uint32_t width, uint32_t height, uint32_t frameIndex)
+        {
+            frame.resize(4 * width * height);
+            for (uint32_t y = 0; y < height; y++)
+            {
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    uint8_t* p = frame.data() + 4 * (y * width + x);
+                    p[0] = uint8_t(x + frameIndex);
+                    p[1] = uint8_t(y + 2 * frameIndex);
+                    p[2] = uint8_t(x ^ y);
+                    p[3] = 0xff;
+                }
+            }
+        }
+
+        VideoEncoder::Desc createDesc(VideoEncoder::Codec codec, uint32_t width, uint32_t height, const std::string& name)
+        {
+            VideoEncoder::Desc desc;
+            desc.codec = codec;
+            desc.width = width;
+            desc.height = height;
+            desc.format = ResourceFormat::BGRA8Unorm;
+            desc.filename = (std::filesystem::temp_directory_path() / name).string() + "." + VideoEncoder::getSupportedContainerForCodec(codec)[0].ext;
+            return desc;
+        }
+    }
+
+    CPU_TEST(VideoEncoder_Encode)
+    {
+        const uint32_t frameCount = 30;
+        std::vector<std::vector<uint8_t>> frames(frameCount);
+        for (uint32_t i = 0; i < frameCount; i++) fillFrame(frames[i], 320, 180, i);
+
+        // Raw video is converted with SWScale, the other codecs with the YUV conversion kernel.
+        for (auto codec : { VideoEncoder::Codec::Raw, VideoEncoder::Codec::MPEG2, VideoEncoder::Codec::MPEG4 })
+        {
+            for (bool flipY : { false, true })
+            {
+                auto desc = createDesc(codec, 320, 180, "VideoEncoderTests");
+                desc.flipY = flipY;
+                desc.queueSize = 2;
+                auto pEncoder = VideoEncoder::create(desc);
+                EXPECT(pEncoder != nullptr) << "codec = " << (int)codec;
+                if (!pEncoder) continue;
+
+                for (const auto& frame : frames) EXPECT(pEncoder->appendFrame(frame.data()));
+                pEncoder->endCapture();
+                EXPECT(!pEncoder->appendFrame(frames[0].data()));
+
+                // Without dropping, all frames are encoded.
+                const auto stats = pEncoder->getStats();
+                EXPECT_EQ(stats.framesSubmitted, frameCount);
+                EXPECT_EQ(stats.framesEncoded, frameCount);
+                EXPECT_EQ(stats.framesDropped, 0);
+                EXPECT_EQ(stats.queuedFrames, 0);
+                EXPECT_GT(stats.encodedFps, 0.0);
+
+                EXPECT(std::filesystem::exists(desc.filename));
+                if (std::filesystem::exists(desc.filename))
+                {
+                    EXPECT_GT(std::filesystem::file_size(desc.filename), 0);
+                    std::filesystem::remove(desc.filename);
+                }
+            }
+        }
+    }
+
+    CPU_TEST(VideoEncoder_DropFrames)
+    {
+        std::vector<uint8_t> frame;
+        fillFrame(frame, 1280, 720, 0);
+
+        auto desc = createDesc(VideoEncoder::Codec::MPEG4, 1280, 720, "VideoEncoderDropTests");
+        desc.queueSize = 1;
+        desc.dropFramesWhenFull = true;
+        auto pEncoder = VideoEncoder::create(desc);
+        EXPECT(pEncoder != nullptr);
+        if (!pEncoder) return;
+
+        // Submit faster than the encoder can keep up. Whether frames are dropped depends on timing, but the counts must add up.
+        uint64_t accepted = 0;
+        for (uint32_t i = 0; i < 100; i++) accepted += pEncoder->appendFrame(frame.data()) ? 1 : 0;
+        pEncoder->endCapture();
+
+        const auto stats = pEncoder->getStats();
+        EXPECT_EQ(stats.framesSubmitted, 100);
+        EXPECT_EQ(stats.framesEncoded, accepted);
+        EXPECT_EQ(stats.framesEncoded + stats.framesDropped, stats.framesSubmitted);
+        EXPECT_EQ(stats.stallCount, 0);
+
+        std::filesystem::remove(desc.filename);
+    }
+
+    CPU_TEST(VideoEncoder_Benchmark)
+    {
+        // Sustained frame rate of encoding synthetic 1080p frames, as seen by the producer.
+        const uint32_t width = 1920, height = 1080, frameCount = 120;
+        std::vector<std::vector<uint8_t>> frames(8);
+        for (uint32_t i = 0; i < frames.size(); i++) fillFrame(frames[i], width, height, i);
+
+        for (uint32_t queueSize : { 1u, 4u, 8u })
+        {
+            auto desc = createDesc(VideoEncoder::Codec::MPEG4, width, height, "VideoEncoderBenchmark");
+            desc.bitrateMbps = 20;
+            desc.queueSize = queueSize;
+            auto pEncoder = VideoEncoder::create(desc);
+            EXPECT(pEncoder != nullptr);
+            if (!pEncoder) return;
+
+            auto start = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < frameCount; i++) pEncoder->appendFrame(frames[i % frames.size()].data());
+            const double submitTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1e-3;
+            pEncoder->endCapture();
+            const double totalTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1e-3;
+
+            const auto stats = pEncoder->getStats();
+            EXPECT_EQ(stats.framesEncoded, frameCount);
+            logInfo("VideoEncoder queue size " + std::to_string(queueSize) + ": " + std::to_string(frameCount / totalTime) + " fps sustained, " +
+                std::to_string(stats.stallTime / submitTime * 100.0) + "% of submit time stalled, conversion " + std::to_string(stats.conversionTime / frameCount * 1e3) +
+                " ms/frame, encoding " + std::to_string(stats.encodingTime / frameCount * 1e3) + " ms/frame");
+
+            std::filesystem::remove(desc.filename);
+        }
+    }
+}
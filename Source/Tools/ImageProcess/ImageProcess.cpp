@@ -0,0 +1,449 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "ImageProcessing.h"
+
+#include <FreeImage.h>
+#include <args.hxx>
+
+#include <cstdio>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <regex>
+#include <string>
+
+/** Offline post-processing of image sequences.
+
+    Reproduces the AccumulatePass and ToneMapper render passes on the CPU, so that captured
+    frames can be re-accumulated and re-tone mapped without running Mogwai again.
+    The per-pixel math follows Accumulate.cs.slang and ToneMapping.ps.slang operation by operation,
+    using SSE on RGBA pixels. Frames are decoded, tone mapped and written on a pool of worker threads,
+    while the accumulation runs in frame order on the main thread.
+*/
+
+using namespace Falcor;
+using namespace ImageProcess;
+
+/** Fixed size pool of worker threads running tasks in submission order.
+*/
+class ThreadPool
+{
+public:
+    ThreadPool(uint32_t threadCount)
+    {
+        for (uint32_t i = 0; i < threadCount; i++) mThreads.emplace_back([this]() { run(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+        for (auto& t : mThreads) t.join();
+    }
+
+    /** Queue a task. Exceptions thrown by the task are rethrown by the returned future.
+    */
+    template<typename Func>
+    auto submit(Func func) -> std::future<decltype(func())>
+    {
+        auto pTask = std::make_shared<std::packaged_task<decltype(func())()>>(std::move(func));
+        auto future = pTask->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTasks.push_back([pTask]() { (*pTask)(); });
+        }
+        mCondition.notify_one();
+        return future;
+    }
+
+private:
+    void run()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this]() { return mStop || !mTasks.empty(); });
+                if (mTasks.empty()) return;
+                task = std::move(mTasks.front());
+                mTasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> mThreads;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mStop = false;
+};
+
+/** Load an image as RGBA32F.
+*/
+static Image::SharedPtr loadImage(const std::string& filename)
+{
+    FREE_IMAGE_FORMAT fifFormat = FIF_UNKNOWN;
+
+    // Determine file format.
+    fifFormat = FreeImage_GetFileType(filename.c_str(), 0);
+    if (fifFormat == FIF_UNKNOWN) fifFormat = FreeImage_GetFIFFromFilename(filename.c_str());
+    if (fifFormat == FIF_UNKNOWN) throw std::runtime_error("Unknown image format");
+    if (!FreeImage_FIFSupportsReading(fifFormat)) throw std::runtime_error("Unsupported image format");
+
+    // Read image.
+    FIBITMAP* srcBitmap = FreeImage_Load(fifFormat, filename.c_str());
+    if (!srcBitmap) throw std::runtime_error("Cannot read image");
+
+    // Convert to RGBA32F.
+    FIBITMAP* floatBitmap = FreeImage_ConvertToRGBAF(srcBitmap);
+    FreeImage_Unload(srcBitmap);
+    if (!floatBitmap) throw std::runtime_error("Cannot convert to RGBA float format");
+
+    // Create image.
+    auto image = Image::create(FreeImage_GetWidth(floatBitmap), FreeImage_GetHeight(floatBitmap));
+    int bytesPerPixel = 4 * sizeof(float);
+    FreeImage_ConvertToRawBits(reinterpret_cast<BYTE*>(image->getData()), floatBitmap, bytesPerPixel * image->getWidth(), bytesPerPixel * 8, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, true);
+    FreeImage_Unload(floatBitmap);
+
+    return image;
+}
+
+/** Save the image. Float formats store the values as is, 8-bit formats are rounded to nearest like UNORM render targets.
+    \param[in] image Image to save.
+    \param[in] filename Filename, the extension determines the file format.
+    \param[in] srgb Apply the sRGB transfer function to 8-bit formats, as when capturing an sRGB render target.
+*/
+static void saveImage(const Image& image, const std::string& filename, bool srgb)
+{
+    FREE_IMAGE_FORMAT fifFormat = FIF_UNKNOWN;
+
+    // Determine file format.
+    fifFormat = FreeImage_GetFIFFromFilename(filename.c_str());
+    if (fifFormat == FIF_UNKNOWN) throw std::runtime_error("Unknown image format");
+    if (!FreeImage_FIFSupportsWriting(fifFormat)) throw std::runtime_error("Unsupported image format");
+
+    bool writeFloat = fifFormat == FIF_EXR || fifFormat == FIF_PFM || fifFormat == FIF_HDR;
+    bool writeAlpha = fifFormat == FIF_EXR || fifFormat == FIF_PNG;
+
+    auto toUnorm8 = [srgb](float v, bool isAlpha)
+    {
+        v = glm::clamp(v, 0.f, 1.f);
+        if (srgb && !isAlpha) v = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.f / 2.4f) - 0.055f;
+        return (uint8_t)(v * 255.f + 0.5f);
+    };
+
+    // Create bitmap.
+    FIBITMAP* bitmap;
+    const float* src = image.getData();
+    const uint32_t width = image.getWidth();
+    const uint32_t height = image.getHeight();
+    if (writeFloat)
+    {
+        bitmap = FreeImage_AllocateT(writeAlpha ? FIT_RGBAF : FIT_RGBF, width, height);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            float* dst = reinterpret_cast<float*>(FreeImage_GetScanLine(bitmap, height - y - 1));
+            if (writeAlpha)
+            {
+                std::memcpy(dst, src, width * 4 * sizeof(float));
+                src += width * 4;
+            }
+            else
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    dst[0] = src[0];
+                    dst[1] = src[1];
+                    dst[2] = src[2];
+                    dst += 3;
+                    src += 4;
+                }
+            }
+        }
+    }
+    else
+    {
+        bitmap = FreeImage_Allocate(width, height, writeAlpha ? 32 : 24);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            uint8_t* dst = reinterpret_cast<uint8_t*>(FreeImage_GetScanLine(bitmap, height - y - 1));
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                dst[2] = toUnorm8(src[0], false);
+                dst[1] = toUnorm8(src[1], false);
+                dst[0] = toUnorm8(src[2], false);
+                if (writeAlpha) dst[3] = toUnorm8(src[3], true);
+                dst += writeAlpha ? 4 : 3;
+                src += 4;
+            }
+        }
+    }
+
+    // Write image.
+    bool success = FreeImage_Save(fifFormat, bitmap, filename.c_str());
+    FreeImage_Unload(bitmap);
+    if (!success) throw std::runtime_error("Cannot write image");
+}
+
+struct ProcessOptions
+{
+    AccumulationMode accumulationMode = AccumulationMode::None;
+    bool writeAll = false;                      ///< Write the accumulated output after every frame.
+    std::optional<ToneMapSettings> toneMap;     ///< Tone mapper settings, if tone mapping is enabled.
+    bool srgb = false;                          ///< Apply the sRGB transfer function to 8-bit outputs.
+    uint32_t threadCount = 1;
+};
+
+static std::string getOutputFilename(const std::string& output, size_t frame, bool isPattern)
+{
+    if (!isPattern) return output;
+    std::vector<char> buffer(output.size() + 32);
+    std::snprintf(buffer.data(), buffer.size(), output.c_str(), (int)frame);
+    return buffer.data();
+}
+
+static bool processSequence(const std::vector<std::string>& inputs, const std::string& output, const ProcessOptions& options)
+{
+    const bool multipleOutputs = inputs.size() > 1 && (options.accumulationMode == AccumulationMode::None || options.writeAll);
+    if (multipleOutputs && !std::regex_match(output, std::regex("[^%]*%0?[0-9]*d[^%]*")))
+    {
+        std::cerr << "Output must be a pattern with a frame number such as 'out.%04d.exr' when writing multiple frames." << std::endl;
+        return false;
+    }
+
+    // Keep a bounded number of frames in flight, so that memory use doesn't depend on the sequence length.
+    ThreadPool pool(options.threadCount);
+    const size_t maxFramesInFlight = 2 * (size_t)options.threadCount;
+    std::deque<std::future<Image::SharedPtr>> loads;
+    std::deque<std::future<void>> writes;
+    size_t nextLoad = 0;
+
+    auto submitLoad = [&]()
+    {
+        const std::string filename = inputs[nextLoad++];
+        loads.push_back(pool.submit([filename]()
+        {
+            try
+            {
+                return loadImage(filename);
+            }
+            catch (const std::runtime_error& e)
+            {
+                throw std::runtime_error("Cannot load image from '" + filename + "' (Error: " + e.what() + ").");
+            }
+        }));
+    };
+
+    auto writeImage = [&options](Image::SharedPtr pImage, const std::string& filename, bool parallel)
+    {
+        if (options.toneMap) pImage = toneMapImage(*pImage, *options.toneMap, parallel);
+        try
+        {
+            saveImage(*pImage, filename, options.srgb);
+        }
+        catch (const std::runtime_error& e)
+        {
+            throw std::runtime_error("Cannot save image to '" + filename + "' (Error: " + e.what() + ").");
+        }
+    };
+
+    auto submitWrite = [&](Image::SharedPtr pImage, size_t frame)
+    {
+        while (writes.size() >= maxFramesInFlight)
+        {
+            writes.front().get();
+            writes.pop_front();
+        }
+        const std::string filename = getOutputFilename(output, frame, multipleOutputs);
+        writes.push_back(pool.submit([writeImage, pImage, filename]() { writeImage(pImage, filename, false); }));
+    };
+
+    try
+    {
+        std::unique_ptr<Accumulator> pAccumulator;
+        Image::SharedPtr pLastOutput;
+
+        while (nextLoad < inputs.size() && loads.size() < maxFramesInFlight) submitLoad();
+
+        for (size_t frame = 0; frame < inputs.size(); frame++)
+        {
+            auto pFrame = loads.front().get();
+            loads.pop_front();
+            if (nextLoad < inputs.size()) submitLoad();
+
+            if (options.accumulationMode == AccumulationMode::None)
+            {
+                pLastOutput = pFrame;
+            }
+            else
+            {
+                if (!pAccumulator) pAccumulator = std::make_unique<Accumulator>(options.accumulationMode, pFrame->getWidth(), pFrame->getHeight());
+                pLastOutput = Image::create(pFrame->getWidth(), pFrame->getHeight());
+                pAccumulator->accumulate(*pFrame, *pLastOutput);
+            }
+
+            if (multipleOutputs) submitWrite(pLastOutput, frame);
+        }
+
+        while (!writes.empty())
+        {
+            writes.front().get();
+            writes.pop_front();
+        }
+
+        // A single output is processed on the main thread with all threads working on its tiles.
+        if (!multipleOutputs) writeImage(pLastOutput, output, true);
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static const std::vector<std::pair<std::string, AccumulationMode>> kAccumulationModes =
+{
+    { "single", AccumulationMode::Single },
+    { "compensated", AccumulationMode::SingleCompensated },
+    { "double", AccumulationMode::Double },
+};
+
+static const std::vector<std::pair<std::string, ToneMapperOperator>> kOperators =
+{
+    { "linear", ToneMapperOperator::Linear },
+    { "reinhard", ToneMapperOperator::Reinhard },
+    { "reinhardModified", ToneMapperOperator::ReinhardModified },
+    { "hejiHableAlu", ToneMapperOperator::HejiHableAlu },
+    { "hableUc2", ToneMapperOperator::HableUc2 },
+    { "aces", ToneMapperOperator::Aces },
+};
+
+template<typename T>
+static bool findOption(const std::vector<std::pair<std::string, T>>& options, const std::string& name, const std::string& what, T& value)
+{
+    auto it = std::find_if(options.begin(), options.end(), [&name] (const auto& option) { return option.first == name; });
+    if (it != options.end())
+    {
+        value = it->second;
+        return true;
+    }
+
+    std::cerr << "Unknown " << what << " '" << name << "'. Available values:";
+    for (const auto& option : options) std::cerr << " " << option.first;
+    std::cerr << std::endl;
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    args::ArgumentParser parser("Utility to accumulate and tone map image sequences on the CPU, matching the AccumulatePass and ToneMapper render passes.");
+    parser.helpParams.programName = "ImageProcess";
+    args::HelpFlag helpFlag(parser, "help", "Display this help menu.", {'h', "help"});
+    args::ValueFlag<std::string> outputFlag(parser, "filename", "The output image, or a pattern such as 'out.%04d.exr' when writing multiple frames.", {'o'}, args::Options::Required);
+    args::ValueFlag<std::string> accumulateFlag(parser, "mode", "Accumulate the frames (single, compensated, double).", {'a', "accumulate"});
+    args::Flag writeAllFlag(parser, "", "Write the accumulated output after every frame.", {"write-all"});
+    args::ValueFlag<std::string> toneMapFlag(parser, "operator", "Tone map the output (linear, reinhard, reinhardModified, hejiHableAlu, hableUc2, aces).", {'t', "tonemap"});
+    args::Flag autoExposureFlag(parser, "", "Enable auto exposure.", {"auto-exposure"});
+    args::ValueFlag<float> exposureCompensationFlag(parser, "stops", "Exposure compensation (in F-stops).", {"exposure-compensation"});
+    args::ValueFlag<float> filmSpeedFlag(parser, "iso", "Film speed (ISO).", {"film-speed"});
+    args::ValueFlag<float> fNumberFlag(parser, "f", "Lens f-number.", {"f-number"});
+    args::ValueFlag<float> shutterFlag(parser, "value", "Reciprocal of the shutter time.", {"shutter"});
+    args::ValueFlag<float> whitePointFlag(parser, "kelvin", "Enable white balance with the given white point (K).", {"white-point"});
+    args::ValueFlag<float> whiteMaxLuminanceFlag(parser, "value", "White luminance of the reinhardModified operator.", {"white-max-luminance"});
+    args::ValueFlag<float> whiteScaleFlag(parser, "value", "Linear white of the hableUc2 operator.", {"white-scale"});
+    args::Flag noClampFlag(parser, "", "Don't clamp the tone mapped output to [0,1].", {"no-clamp"});
+    args::Flag srgbFlag(parser, "", "Apply the sRGB transfer function to 8-bit outputs.", {"srgb"});
+    args::ValueFlag<uint32_t> threadsFlag(parser, "count", "Number of worker threads (default: all hardware threads).", {'j', "threads"});
+    args::PositionalList<std::string> inputsList(parser, "inputs", "The input frames, in order.", args::Options::Required);
+    args::CompletionFlag completionFlag(parser, {"complete"});
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (const args::Completion& e)
+    {
+        std::cout << e.what();
+        return 0;
+    }
+    catch (const args::Help&)
+    {
+        std::cout << parser;
+        return 0;
+    }
+    catch (const args::ParseError& e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    catch (const args::RequiredError& e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    ProcessOptions options;
+    if (accumulateFlag && !findOption(kAccumulationModes, args::get(accumulateFlag), "accumulation mode", options.accumulationMode)) return 1;
+    options.writeAll = writeAllFlag;
+    options.srgb = srgbFlag;
+    options.threadCount = threadsFlag ? std::max(args::get(threadsFlag), 1u) : std::max(std::thread::hardware_concurrency(), 1u);
+
+    if (toneMapFlag)
+    {
+        ToneMapSettings settings;
+        if (!findOption(kOperators, args::get(toneMapFlag), "tone mapping operator", settings.op)) return 1;
+        settings.autoExposure = autoExposureFlag;
+        if (exposureCompensationFlag) settings.exposureCompensation = args::get(exposureCompensationFlag);
+        if (filmSpeedFlag) settings.filmSpeed = args::get(filmSpeedFlag);
+        if (fNumberFlag) settings.fNumber = args::get(fNumberFlag);
+        if (shutterFlag) settings.shutter = args::get(shutterFlag);
+        settings.whiteBalance = whitePointFlag;
+        if (whitePointFlag) settings.whitePoint = args::get(whitePointFlag);
+        if (whiteMaxLuminanceFlag) settings.whiteMaxLuminance = args::get(whiteMaxLuminanceFlag);
+        if (whiteScaleFlag) settings.whiteScale = args::get(whiteScaleFlag);
+        settings.clamp = !noClampFlag;
+        settings.validate();
+        options.toneMap = settings;
+    }
+
+    return processSequence(args::get(inputsList), args::get(outputFlag), options) ? 0 : 1;
+}
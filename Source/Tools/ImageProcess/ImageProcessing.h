@@ -0,0 +1,482 @@
+/***************************************************************************
+ # Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Utils/HostDeviceShared.slangh"
+#include "Utils/Color/ColorUtils.h"
+#include "RenderPasses/ToneMapper/ToneMapperParams.slang"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/** CPU versions of the AccumulatePass and ToneMapper render passes used by the ImageProcess tool.
+
+    The per-pixel math follows Accumulate.cs.slang and ToneMapping.ps.slang operation by operation,
+    using SSE on RGBA pixels. Image file I/O is left to the tool, so that this can be tested without it.
+*/
+namespace ImageProcess
+{
+    using namespace Falcor;
+
+    // Number of pixels processed per tile.
+    static const size_t kTileSize = 4096;
+
+    /** Runs func(i) for all i in [0, count), on all hardware threads if parallel is set.
+    */
+    template<typename Func>
+    void forEach(size_t count, bool parallel, Func func)
+    {
+        if (!parallel)
+        {
+            for (size_t i = 0; i < count; i++) func(i);
+            return;
+        }
+
+        std::atomic<size_t> next = 0;
+        auto worker = [&]()
+        {
+            for (size_t i = next++; i < count; i = next++) func(i);
+        };
+
+        size_t threadCount = std::min((size_t)std::max(std::thread::hardware_concurrency(), 1u), std::max(count, (size_t)1));
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < threadCount; i++) threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads) t.join();
+    }
+
+    class Image
+    {
+    public:
+        using SharedPtr = std::shared_ptr<Image>;
+
+        uint32_t getWidth() const { return mWidth; }
+        uint32_t getHeight() const { return mHeight; }
+        size_t getPixelCount() const { return (size_t)mWidth * mHeight; }
+        const float* getData() const { return mData.get(); }
+        float* getData() { return mData.get(); }
+
+        static SharedPtr create(uint32_t width, uint32_t height) { return SharedPtr(new Image(width, height)); }
+
+    private:
+        uint32_t mWidth;
+        uint32_t mHeight;
+        std::unique_ptr<float[]> mData;
+
+        Image(uint32_t width, uint32_t height)
+            : mWidth(width)
+            , mHeight(height)
+            , mData(std::make_unique<float[]>((size_t)width * height * 4))
+        {}
+    };
+
+    enum class AccumulationMode
+    {
+        None,
+        Single,             ///< Single precision standard summation.
+        SingleCompensated,  ///< Single precision compensated (Kahan) summation.
+        Double,             ///< Double precision standard summation.
+    };
+
+    /** CPU version of the AccumulatePass.
+        Each mode performs the same IEEE single/double precision operations as the corresponding entry point in Accumulate.cs.slang.
+        The compensated mode relies on the compiler not reassociating the SSE intrinsics, which holds for all supported compilers.
+    */
+    class Accumulator
+    {
+    public:
+        Accumulator(AccumulationMode mode, uint32_t width, uint32_t height)
+            : mMode(mode)
+            , mWidth(width)
+            , mHeight(height)
+        {
+            const size_t valueCount = (size_t)width * height * 4;
+            if (mode == AccumulationMode::Double) mSumDouble.resize(valueCount, 0.0);
+            else mSum.resize(valueCount, 0.f);
+            if (mode == AccumulationMode::SingleCompensated) mCorr.resize(valueCount, 0.f);
+        }
+
+        /** Add a frame to the running sum and write the current average.
+            \param[in] frame Frame to accumulate.
+            \param[out] output Accumulated average.
+        */
+        void accumulate(const Image& frame, Image& output)
+        {
+            if (frame.getWidth() != mWidth || frame.getHeight() != mHeight) throw std::runtime_error("Cannot accumulate frames with different resolutions");
+
+            const size_t pixelCount = frame.getPixelCount();
+            const size_t tileCount = (pixelCount + kTileSize - 1) / kTileSize;
+            const float* pSrc = frame.getData();
+            float* pDst = output.getData();
+
+            forEach(tileCount, true, [&](size_t tile)
+            {
+                const size_t begin = tile * kTileSize * 4;
+                const size_t end = std::min(pixelCount, (tile + 1) * kTileSize) * 4;
+
+                switch (mMode)
+                {
+                case AccumulationMode::Single:
+                {
+                    const __m128 n = _mm_set1_ps((float)(mFrameCount + 1));
+                    for (size_t i = begin; i < end; i += 4)
+                    {
+                        __m128 sum = _mm_add_ps(_mm_loadu_ps(&mSum[i]), _mm_loadu_ps(pSrc + i));
+                        _mm_storeu_ps(&mSum[i], sum);
+                        _mm_storeu_ps(pDst + i, _mm_div_ps(sum, n));
+                    }
+                    break;
+                }
+                case AccumulationMode::SingleCompensated:
+                {
+                    const __m128 n = _mm_set1_ps((float)(mFrameCount + 1));
+                    for (size_t i = begin; i < end; i += 4)
+                    {
+                        __m128 sum = _mm_loadu_ps(&mSum[i]);
+                        __m128 y = _mm_sub_ps(_mm_loadu_ps(pSrc + i), _mm_loadu_ps(&mCorr[i]));
+                        __m128 sumNext = _mm_add_ps(sum, y);
+                        _mm_storeu_ps(&mSum[i], sumNext);
+                        _mm_storeu_ps(&mCorr[i], _mm_sub_ps(_mm_sub_ps(sumNext, sum), y));
+                        _mm_storeu_ps(pDst + i, _mm_div_ps(sumNext, n));
+                    }
+                    break;
+                }
+                case AccumulationMode::Double:
+                {
+                    const __m128d n = _mm_set1_pd((double)(mFrameCount + 1));
+                    for (size_t i = begin; i < end; i += 4)
+                    {
+                        __m128 color = _mm_loadu_ps(pSrc + i);
+                        __m128d sumLo = _mm_add_pd(_mm_loadu_pd(&mSumDouble[i]), _mm_cvtps_pd(color));
+                        __m128d sumHi = _mm_add_pd(_mm_loadu_pd(&mSumDouble[i + 2]), _mm_cvtps_pd(_mm_movehl_ps(color, color)));
+                        _mm_storeu_pd(&mSumDouble[i], sumLo);
+                        _mm_storeu_pd(&mSumDouble[i + 2], sumHi);
+                        _mm_storeu_ps(pDst + i, _mm_movelh_ps(_mm_cvtpd_ps(_mm_div_pd(sumLo, n)), _mm_cvtpd_ps(_mm_div_pd(sumHi, n))));
+                    }
+                    break;
+                }
+                default:
+                    break;
+                }
+            });
+
+            mFrameCount++;
+        }
+
+        uint32_t getFrameCount() const { return mFrameCount; }
+
+    private:
+        AccumulationMode mMode;
+        uint32_t mWidth;
+        uint32_t mHeight;
+        uint32_t mFrameCount = 0;
+        std::vector<float> mSum;            ///< Running sum for the single precision modes.
+        std::vector<float> mCorr;           ///< Running compensation term for the compensated mode.
+        std::vector<double> mSumDouble;     ///< Running sum for the double precision mode.
+    };
+
+    /** Tone mapper settings, with the same defaults and ranges as the ToneMapper render pass.
+    */
+    struct ToneMapSettings
+    {
+        ToneMapperOperator op = ToneMapperOperator::Aces;
+        bool autoExposure = false;
+        float exposureCompensation = 0.f;   ///< Exposure compensation (in F-stops).
+        float filmSpeed = 100.f;            ///< Film speed (ISO), only used when auto exposure is disabled.
+        float fNumber = 1.f;                ///< Lens speed, only used when auto exposure is disabled.
+        float shutter = 1.f;                ///< Reciprocal of shutter time, only used when auto exposure is disabled.
+        bool whiteBalance = false;
+        float whitePoint = 6500.f;          ///< White point (K).
+        bool clamp = true;                  ///< Clamp output to [0,1].
+        float whiteMaxLuminance = 1.f;      ///< Parameter used in ReinhardModified operator.
+        float whiteScale = 11.2f;           ///< Parameter used in HableUc2 operator.
+
+        /** Clamp the settings to the ranges enforced by the ToneMapper setters.
+        */
+        void validate()
+        {
+            exposureCompensation = glm::clamp(exposureCompensation, -12.f, 12.f);
+            filmSpeed = glm::clamp(filmSpeed, 1.f, 6400.f);
+            fNumber = glm::clamp(fNumber, 0.1f, 100.f);
+            shutter = glm::clamp(shutter, 0.1f, 10000.f);
+            whitePoint = glm::clamp(whitePoint, 1905.f, 25000.f);
+            whiteScale = std::max(0.001f, whiteScale);
+        }
+
+        /** Compute the color transform with the exposure baked in, like ToneMapper::updateColorTransform().
+        */
+        float3x3 getColorTransform() const
+        {
+            float3x3 whiteBalanceTransform = whiteBalance ? calculateWhiteBalanceTransformRGB_Rec709(whitePoint) : glm::identity<float3x3>();
+
+            // Exposure scale due to exposure compensation.
+            float exposureScale = std::pow(2.f, exposureCompensation);
+            float manualExposureScale = 1.f;
+            if (!autoExposure)
+            {
+                float normConstant = 1.f / 100.f;
+                manualExposureScale = (normConstant * filmSpeed) / (shutter * fNumber * fNumber);
+            }
+            return whiteBalanceTransform * exposureScale * manualExposureScale;
+        }
+    };
+
+    inline uint32_t getLowerPowerOf2(uint32_t a)
+    {
+        uint32_t result = 1;
+        while (result * 2 <= a) result *= 2;
+        return result;
+    }
+
+    inline float roundToHalf(float v) { return f16tof32(f32tof16(v)); }
+
+    /** Compute the average luminance used for auto exposure, like the luminance pass of the ToneMapper.
+        The GPU renders the log luminance of the bilinearly filtered input (wrap addressing) to an R16Float
+        texture of the next lower power of two size, then averages it down to a single texel with the mip chain.
+        \param[in] image Input image.
+        \param[in] parallel Process the rows on all hardware threads.
+        \return Average luminance.
+    */
+    inline float computeAverageLuminance(const Image& image, bool parallel)
+    {
+        const uint32_t srcWidth = image.getWidth();
+        const uint32_t srcHeight = image.getHeight();
+        uint32_t width = getLowerPowerOf2(srcWidth);
+        uint32_t height = getLowerPowerOf2(srcHeight);
+        std::vector<float> level((size_t)width * height);
+
+        auto fetch = [&](int x, int y)
+        {
+            const int w = (int)srcWidth, h = (int)srcHeight;
+            x = ((x % w) + w) % w;
+            y = ((y % h) + h) % h;
+            const float* p = image.getData() + ((size_t)y * srcWidth + x) * 4;
+            return float3(p[0], p[1], p[2]);
+        };
+
+        forEach(height, parallel, [&](size_t y)
+        {
+            const float v = (((float)y + 0.5f) / height) * srcHeight - 0.5f;
+            const float fy = std::floor(v);
+            const float ty = v - fy;
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const float u = (((float)x + 0.5f) / width) * srcWidth - 0.5f;
+                const float fx = std::floor(u);
+                const float tx = u - fx;
+                const int ix = (int)fx, iy = (int)fy;
+                float3 color = glm::mix(glm::mix(fetch(ix, iy), fetch(ix + 1, iy), tx), glm::mix(fetch(ix, iy + 1), fetch(ix + 1, iy + 1), tx), ty);
+                float luminance = glm::dot(color, float3(0.299f, 0.587f, 0.114f));
+                level[y * width + x] = roundToHalf(std::log2(std::max(0.0001f, luminance)));
+            }
+        });
+
+        // Each mip is a 2x2 box filter of the previous one (a single texel along dimensions that are already 1).
+        while (width > 1 || height > 1)
+        {
+            const uint32_t nextWidth = std::max(width / 2, 1u);
+            const uint32_t nextHeight = std::max(height / 2, 1u);
+            const uint32_t dx = width > 1 ? 1 : 0;
+            const uint32_t dy = height > 1 ? width : 0;
+            std::vector<float> next((size_t)nextWidth * nextHeight);
+            for (uint32_t y = 0; y < nextHeight; y++)
+            {
+                for (uint32_t x = 0; x < nextWidth; x++)
+                {
+                    const size_t i = (size_t)(y * (height > 1 ? 2 : 1)) * width + x * (width > 1 ? 2 : 1);
+                    next[y * nextWidth + x] = roundToHalf(0.25f * (level[i] + level[i + dx] + level[i + dy] + level[i + dx + dy]));
+                }
+            }
+            level = std::move(next);
+            width = nextWidth;
+            height = nextHeight;
+        }
+
+        return std::exp2(level[0]);
+    }
+
+    /** CPU version of ToneMapping.ps.slang, operating on one RGBA pixel in an SSE register.
+    */
+    class ToneMapKernel
+    {
+    public:
+        ToneMapKernel(const ToneMapSettings& settings, float averageLuminance)
+            : mSettings(settings)
+        {
+            const float3x3 transform = settings.getColorTransform();
+            for (int i = 0; i < 3; i++) mColorTransform[i] = _mm_setr_ps(transform[i][0], transform[i][1], transform[i][2], 0.f);
+
+            const float kExposureKey = 0.042f;
+            mExposure = _mm_set1_ps(settings.autoExposure ? kExposureKey / averageLuminance : 1.f);
+
+            // Matches 1 / applyUc2Curve(float3(gParams.whiteScale)).x
+            mUc2WhiteScale = _mm_div_ps(_mm_set1_ps(1.f), applyUc2Curve(_mm_set1_ps(settings.whiteScale)));
+        }
+
+        __m128 operator()(__m128 color) const
+        {
+            __m128 c = color;
+            if (mSettings.autoExposure) c = _mm_mul_ps(c, mExposure);
+
+            // Apply color grading: mul(finalColor, (float3x3) gParams.colorTransform).
+            c = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 0, 0, 0)), mColorTransform[0]),
+                _mm_mul_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1)), mColorTransform[1])),
+                _mm_mul_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 2, 2, 2)), mColorTransform[2]));
+
+            c = toneMap(c);
+            if (mSettings.clamp) c = saturate(c);
+
+            // Keep the input alpha.
+            const __m128 rgbMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+            return _mm_or_ps(_mm_and_ps(rgbMask, c), _mm_andnot_ps(rgbMask, color));
+        }
+
+    private:
+        static __m128 set(float v) { return _mm_set1_ps(v); }
+        static __m128 saturate(__m128 c) { return _mm_min_ps(_mm_max_ps(c, _mm_setzero_ps()), set(1.f)); }
+
+        /** Returns the luminance, broadcast to all components.
+        */
+        static __m128 calcLuminance(__m128 c)
+        {
+            __m128 m = _mm_mul_ps(c, _mm_setr_ps(0.299f, 0.587f, 0.114f, 0.f));
+            __m128 s = _mm_add_ss(_mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1))), _mm_movehl_ps(m, m));
+            return _mm_shuffle_ps(s, s, _MM_SHUFFLE(0, 0, 0, 0));
+        }
+
+        static __m128 applyUc2Curve(__m128 c)
+        {
+            const float A = 0.22f; // Shoulder Strength
+            const float B = 0.3f;  // Linear Strength
+            const float C = 0.1f;  // Linear Angle
+            const float D = 0.2f;  // Toe Strength
+            const float E = 0.01f; // Toe Numerator
+            const float F = 0.3f;  // Toe Denominator
+
+            __m128 num = _mm_add_ps(_mm_mul_ps(c, _mm_add_ps(_mm_mul_ps(set(A), c), set(C * B))), set(D * E));
+            __m128 den = _mm_add_ps(_mm_mul_ps(c, _mm_add_ps(_mm_mul_ps(set(A), c), set(B))), set(D * F));
+            return _mm_sub_ps(_mm_div_ps(num, den), set(E / F));
+        }
+
+        __m128 toneMap(__m128 c) const
+        {
+            switch (mSettings.op)
+            {
+            case ToneMapperOperator::Linear:
+                return c;
+            case ToneMapperOperator::Reinhard:
+            {
+                __m128 luminance = calcLuminance(c);
+                __m128 reinhard = _mm_div_ps(luminance, _mm_add_ps(luminance, set(1.f)));
+                return _mm_mul_ps(c, _mm_div_ps(reinhard, luminance));
+            }
+            case ToneMapperOperator::ReinhardModified:
+            {
+                __m128 luminance = calcLuminance(c);
+                __m128 whiteSqr = set(mSettings.whiteMaxLuminance * mSettings.whiteMaxLuminance);
+                __m128 reinhard = _mm_mul_ps(_mm_mul_ps(luminance, _mm_add_ps(set(1.f), _mm_div_ps(luminance, whiteSqr))), _mm_add_ps(set(1.f), luminance));
+                return _mm_mul_ps(c, _mm_div_ps(reinhard, luminance));
+            }
+            case ToneMapperOperator::HejiHableAlu:
+            {
+                c = _mm_max_ps(_mm_setzero_ps(), _mm_sub_ps(c, set(0.004f)));
+                __m128 num = _mm_mul_ps(c, _mm_add_ps(_mm_mul_ps(set(6.2f), c), set(0.5f)));
+                __m128 den = _mm_add_ps(_mm_mul_ps(c, _mm_add_ps(_mm_mul_ps(set(6.2f), c), set(1.7f))), set(0.06f));
+                c = _mm_div_ps(num, den);
+
+                // Result includes sRGB conversion. There is no SSE pow, so this is done per component.
+                alignas(16) float v[4];
+                _mm_store_ps(v, c);
+                for (int i = 0; i < 3; i++) v[i] = std::pow(v[i], 2.2f);
+                return _mm_load_ps(v);
+            }
+            case ToneMapperOperator::HableUc2:
+            {
+                const float exposureBias = 2.0f;
+                return _mm_mul_ps(applyUc2Curve(_mm_mul_ps(set(exposureBias), c)), mUc2WhiteScale);
+            }
+            case ToneMapperOperator::Aces:
+            {
+                // Cancel out the pre-exposure mentioned in
+                // https://knarkowicz.wordpress.com/2016/01/06/aces-filmic-tone-mapping-curve/
+                c = _mm_mul_ps(c, set(0.6f));
+
+                const float A = 2.51f;
+                const float B = 0.03f;
+                const float C = 2.43f;
+                const float D = 0.59f;
+                const float E = 0.14f;
+
+                __m128 num = _mm_mul_ps(c, _mm_add_ps(_mm_mul_ps(set(A), c), set(B)));
+                __m128 den = _mm_add_ps(_mm_mul_ps(c, _mm_add_ps(_mm_mul_ps(set(C), c), set(D))), set(E));
+                return saturate(_mm_div_ps(num, den));
+            }
+            default:
+                return c;
+            }
+        }
+
+        ToneMapSettings mSettings;
+        __m128 mColorTransform[3];
+        __m128 mExposure;
+        __m128 mUc2WhiteScale;
+    };
+
+    /** Tone map an image.
+        \param[in] image Input image.
+        \param[in] settings Tone mapper settings.
+        \param[in] parallel Process the tiles on all hardware threads.
+        \return Tone mapped image.
+    */
+    inline Image::SharedPtr toneMapImage(const Image& image, const ToneMapSettings& settings, bool parallel)
+    {
+        const float averageLuminance = settings.autoExposure ? computeAverageLuminance(image, parallel) : 1.f;
+        const ToneMapKernel kernel(settings, averageLuminance);
+
+        auto pOutput = Image::create(image.getWidth(), image.getHeight());
+        const size_t pixelCount = image.getPixelCount();
+        const size_t tileCount = (pixelCount + kTileSize - 1) / kTileSize;
+        const float* pSrc = image.getData();
+        float* pDst = pOutput->getData();
+
+        forEach(tileCount, parallel, [&](size_t tile)
+        {
+            const size_t end = std::min(pixelCount, (tile + 1) * kTileSize) * 4;
+            for (size_t i = tile * kTileSize * 4; i < end; i += 4) _mm_storeu_ps(pDst + i, kernel(_mm_loadu_ps(pSrc + i)));
+        });
+
+        return pOutput;
+    }
+}